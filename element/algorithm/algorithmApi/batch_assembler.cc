@@ -0,0 +1,171 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "batch_assembler.h"
+
+#include <algorithm>
+
+namespace sophon_stream {
+namespace element {
+
+BatchAssembler::BatchAssembler(std::vector<int> batchSizes,
+                               std::chrono::microseconds maxWait,
+                               int keyNumber, InfoGetter infoGetter)
+    : mBatchSizes(std::move(batchSizes)),
+      mMaxWait(maxWait),
+      mInfoGetter(std::move(infoGetter)) {
+  mBatchSizes.erase(std::remove_if(mBatchSizes.begin(), mBatchSizes.end(),
+                                   [](int size) { return size <= 0; }),
+                    mBatchSizes.end());
+  std::sort(mBatchSizes.begin(), mBatchSizes.end());
+  mBatchSizes.erase(std::unique(mBatchSizes.begin(), mBatchSizes.end()),
+                    mBatchSizes.end());
+  if (mBatchSizes.empty()) mBatchSizes.push_back(1);
+
+  keyNumber = keyNumber > 0 ? keyNumber : 1;
+  mKeys.reserve(keyNumber);
+  for (int i = 0; i < keyNumber; ++i) {
+    mKeys.push_back(std::make_unique<KeyState>());
+  }
+}
+
+int BatchAssembler::selectBatchSize(const std::vector<int>& batchSizes,
+                                    int number, bool allowLeftover) {
+  if (allowLeftover) {
+    // 不超过number的最大batch，剩下的数据留给下一个batch，不需要补齐
+    auto it = std::upper_bound(batchSizes.begin(), batchSizes.end(), number);
+    if (it != batchSizes.begin()) return *std::prev(it);
+  }
+  auto it = std::lower_bound(batchSizes.begin(), batchSizes.end(), number);
+  return it == batchSizes.end() ? batchSizes.back() : *it;
+}
+
+BatchAssembler::Batch BatchAssembler::assemble(int key, const PopFunction& pop,
+                                               const WaitPredicate& canWait) {
+  KeyState& state = *mKeys[key];
+  const int lookahead = getMaxBatchSize() * LOOKAHEAD_BATCHES;
+  bool wait = canWait();
+  fill(state, pop, wait ? lookahead : getMaxBatchSize());
+
+  while (!ready(state, wait, std::chrono::steady_clock::now())) {
+    std::chrono::microseconds timeout = MAX_POP_WAIT;
+    if (state.total > 0 && mMaxWait.count() >= 0) {
+      auto remaining = std::chrono::ceil<std::chrono::microseconds>(
+          oldestArrival(state) + mMaxWait - std::chrono::steady_clock::now());
+      timeout = std::max(std::min(timeout, remaining),
+                         std::chrono::microseconds::zero());
+    }
+    auto data = pop(timeout);
+    if (data) {
+      stage(state, std::move(data));
+      fill(state, pop, lookahead);
+    }
+    wait = canWait();
+  }
+  return take(state, wait);
+}
+
+void BatchAssembler::stage(KeyState& state, std::shared_ptr<void> data) {
+  Entry entry;
+  entry.info = mInfoGetter(data);
+  entry.data = std::move(data);
+  entry.arrival = std::chrono::steady_clock::now();
+  ++state.total;
+  if (!entry.info.filtered) ++state.pending;
+  if (!entry.info.filtered && entry.info.endOfStream) ++state.endOfStreams;
+  state.channels[entry.info.channel].push_back(std::move(entry));
+}
+
+void BatchAssembler::fill(KeyState& state, const PopFunction& pop, int limit) {
+  while (state.total < limit) {
+    auto data = pop(std::chrono::microseconds::zero());
+    if (!data) break;
+    stage(state, std::move(data));
+  }
+}
+
+bool BatchAssembler::ready(const KeyState& state, bool wait,
+                           std::chrono::steady_clock::time_point now) const {
+  if (!wait) return true;
+  if (state.pending >= getMaxBatchSize()) return true;
+  // 码流结束帧不等待，尽快送到下游
+  if (state.endOfStreams > 0) return true;
+  return state.total > 0 && mMaxWait.count() >= 0 &&
+         now - oldestArrival(state) >= mMaxWait;
+}
+
+std::chrono::steady_clock::time_point BatchAssembler::oldestArrival(
+    const KeyState& state) const {
+  auto oldest = std::chrono::steady_clock::time_point::max();
+  for (const auto& channel : state.channels) {
+    if (!channel.second.empty())
+      oldest = std::min(oldest, channel.second.front().arrival);
+  }
+  return oldest;
+}
+
+BatchAssembler::Batch BatchAssembler::take(KeyState& state, bool wait) {
+  Batch batch;
+  int number = std::min(state.pending, getMaxBatchSize());
+  if (number > 0) batch.batchSize = selectBatchSize(mBatchSizes, number, wait);
+  int count = std::min(number, batch.batchSize);
+
+  // 队首的filtered数据不影响顺序，随当前batch推送
+  auto flushFiltered = [&](std::deque<Entry>& queue) {
+    while (!queue.empty() && queue.front().info.filtered) {
+      batch.all.push_back(std::move(queue.front().data));
+      queue.pop_front();
+      --state.total;
+    }
+  };
+
+  // 各路码流轮流取一个，merge和split遇到码流结束帧即停止，结束帧放在最后
+  std::vector<std::shared_ptr<void>> endOfStreams;
+  auto it = state.channels.lower_bound(state.nextChannel);
+  int taken = 0;
+  while (taken < count) {
+    if (it == state.channels.end()) it = state.channels.begin();
+    auto& queue = it->second;
+    flushFiltered(queue);
+    if (!queue.empty()) {
+      Entry& entry = queue.front();
+      batch.all.push_back(entry.data);
+      if (entry.info.endOfStream) {
+        endOfStreams.push_back(std::move(entry.data));
+        --state.endOfStreams;
+      } else {
+        batch.items.push_back(std::move(entry.data));
+      }
+      queue.pop_front();
+      --state.total;
+      --state.pending;
+      ++taken;
+      state.nextChannel = it->first + 1;
+    }
+    if (queue.empty()) {
+      it = state.channels.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (it = state.channels.begin(); it != state.channels.end();) {
+    flushFiltered(it->second);
+    if (it->second.empty()) {
+      it = state.channels.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  batch.items.insert(batch.items.end(), endOfStreams.begin(),
+                     endOfStreams.end());
+  return batch;
+}
+
+}  // namespace element
+}  // namespace sophon_stream
@@ -0,0 +1,170 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_ALGORITHMAPI_BATCH_ASSEMBLER_H_
+#define SOPHON_STREAM_ELEMENT_ALGORITHMAPI_BATCH_ASSEMBLER_H_
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace element {
+
+/**
+ * @brief 从dataPipe中取数据组成推理的batch
+ * @details
+ * 原来的doWork一直等到凑满max_batch个数据，负载低时一帧可能等待很久。
+ * 这里第一个数据到达后最多等待maxWait，超时后按已有的数据组batch，
+ * 并在bmodel编译的batch中选择：可以留下数据给下一个batch时取不超过
+ * 数据数的最大batch，不需要补齐；否则取不小于数据数的最小batch。
+ * 同一dataPipe中的数据按码流分开暂存，组batch时各路码流轮流取一个，
+ * 一路码流数据较多时不会挤占其他码流；每一路码流内的顺序不变。
+ * 暂存的数据跨assemble调用保留，每个key（一般为dataPipeId）一份，
+ * 同一个key只应由一个线程调用
+ */
+class BatchAssembler : public ::sophon_stream::common::NoCopyable {
+ public:
+  struct ItemInfo {
+    int channel = 0;
+    bool endOfStream = false;
+    /**
+     * @brief 不参与处理，只随同一路码流的数据一起推送
+     */
+    bool filtered = false;
+  };
+  using InfoGetter = std::function<ItemInfo(const std::shared_ptr<void>& data)>;
+  /**
+   * @brief 取一个数据，最多等待timeout，timeout为0时不等待；没有数据时返回nullptr
+   */
+  using PopFunction =
+      std::function<std::shared_ptr<void>(std::chrono::microseconds timeout)>;
+  /**
+   * @brief 没有凑满batch时是否可以继续等待，
+   * 一般为Element::shouldWaitInputData，pool调度和element停止时返回false
+   */
+  using WaitPredicate = std::function<bool()>;
+
+  struct Batch {
+    /**
+     * @brief 参与处理的数据，码流结束帧排在最后
+     */
+    std::vector<std::shared_ptr<void>> items;
+    /**
+     * @brief 包括filtered在内的全部数据，按推送顺序排列
+     */
+    std::vector<std::shared_ptr<void>> all;
+    /**
+     * @brief 选中的bmodel batch，不小于items的数量，没有数据时为0
+     */
+    int batchSize = 0;
+  };
+
+  /**
+   * @brief 一次阻塞取数据的最长时间，超时后重新检查能否继续等待
+   */
+  static constexpr std::chrono::microseconds MAX_POP_WAIT{200000};
+  /**
+   * @brief 可以等待时最多暂存多少个batch的数据，用于在码流之间轮流取数据
+   */
+  static constexpr int LOOKAHEAD_BATCHES = 2;
+
+  /**
+   * @param[in] batchSizes : bmodel编译的batch
+   * @param[in] maxWait : 第一个数据最多等待的时间，小于0时一直等到batch满
+   * @param[in] keyNumber : key的数量，assemble的key取值为[0, keyNumber)
+   * @param[in] infoGetter : 一般为getMetadataInfo<common::ObjectMetadata>
+   */
+  BatchAssembler(std::vector<int> batchSizes, std::chrono::microseconds maxWait,
+                 int keyNumber, InfoGetter infoGetter);
+
+  /**
+   * @brief 组一个batch
+   * @details
+   * 满足以下任一条件时返回：暂存的数据凑满最大的batch；有码流结束帧；
+   * 最早暂存的数据已等待maxWait；canWait返回false。
+   * canWait返回false时只取最多一个batch的数据，并全部返回，不留暂存
+   */
+  Batch assemble(int key, const PopFunction& pop, const WaitPredicate& canWait);
+
+  /**
+   * @brief 为number个数据选择batch
+   * @param[in] allowLeftover : 是否可以只取一部分数据
+   */
+  static int selectBatchSize(const std::vector<int>& batchSizes, int number,
+                             bool allowLeftover);
+
+  int getMaxBatchSize() const { return mBatchSizes.back(); }
+
+  /**
+   * @brief 从ObjectMetadata中取组batch需要的信息
+   */
+  template <typename T>
+  static ItemInfo getMetadataInfo(const std::shared_ptr<void>& data) {
+    auto objectMetadata = std::static_pointer_cast<T>(data);
+    ItemInfo info;
+    info.channel = objectMetadata->mFrame->mChannelIdInternal;
+    info.endOfStream = objectMetadata->mFrame->mEndOfStream;
+    info.filtered = objectMetadata->mFilter;
+    return info;
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<void> data;
+    ItemInfo info;
+    std::chrono::steady_clock::time_point arrival;
+  };
+
+  struct KeyState {
+    /**
+     * @brief 按码流暂存的数据，key为channel
+     */
+    std::map<int, std::deque<Entry>> channels;
+    /**
+     * @brief 下一个batch从不小于nextChannel的码流开始取
+     */
+    int nextChannel = 0;
+    int total = 0;
+    /**
+     * @brief 不含filtered的数据数
+     */
+    int pending = 0;
+    int endOfStreams = 0;
+  };
+
+  void stage(KeyState& state, std::shared_ptr<void> data);
+  /**
+   * @brief 不等待地取数据，直到暂存的数据达到limit
+   */
+  void fill(KeyState& state, const PopFunction& pop, int limit);
+  bool ready(const KeyState& state, bool wait,
+             std::chrono::steady_clock::time_point now) const;
+  /**
+   * @brief 最早暂存的数据的到达时间，没有暂存时返回time_point::max()
+   */
+  std::chrono::steady_clock::time_point oldestArrival(
+      const KeyState& state) const;
+  Batch take(KeyState& state, bool wait);
+
+  std::vector<int> mBatchSizes;
+  const std::chrono::microseconds mMaxWait;
+  const InfoGetter mInfoGetter;
+  std::vector<std::unique_ptr<KeyState>> mKeys;
+};
+
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_ALGORITHMAPI_BATCH_ASSEMBLER_H_
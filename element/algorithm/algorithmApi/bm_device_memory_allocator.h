@@ -0,0 +1,72 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_ALGORITHMAPI_BM_DEVICE_MEMORY_ALLOCATOR_H_
+#define SOPHON_STREAM_ELEMENT_ALGORITHMAPI_BM_DEVICE_MEMORY_ALLOCATOR_H_
+
+#include <mutex>
+#include <unordered_map>
+
+#include "common/bmnn_utils.h"
+#include "common/common_defs.h"
+#include "device_memory_pool.h"
+
+namespace sophon_stream {
+namespace element {
+
+/**
+ * @brief 用bm_malloc_device_byte_heap在指定heap上申请设备内存
+ * @details 持有BMNNHandle的引用，pool中的块晚于element释放时handle仍然有效
+ */
+class BmDeviceMemoryAllocator : public DeviceMemoryAllocator,
+                                public ::sophon_stream::common::NoCopyable {
+ public:
+  BmDeviceMemoryAllocator(BMNNHandlePtr handle, int heapId)
+      : mHandlePtr(std::move(handle)),
+        mHandle(mHandlePtr->handle()),
+        mHeapId(heapId) {}
+
+  DeviceMemoryBlock allocate(std::size_t size) override {
+    bm_device_mem_t mem;
+    if (BM_SUCCESS != bm_malloc_device_byte_heap(mHandle, &mem, mHeapId,
+                                                 static_cast<unsigned>(size)))
+      return {};
+    std::uint64_t address = bm_mem_get_device_addr(mem);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMems[address] = mem;
+    return {address, size};
+  }
+
+  void free(const DeviceMemoryBlock& block) override {
+    bm_device_mem_t mem;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mMems.find(block.address);
+      if (it == mMems.end()) return;
+      mem = it->second;
+      mMems.erase(it);
+    }
+    bm_free_device(mHandle, mem);
+  }
+
+ private:
+  const BMNNHandlePtr mHandlePtr;
+  const bm_handle_t mHandle;
+  const int mHeapId;
+  std::mutex mMutex;
+  /**
+   * @brief bm_free_device需要申请时得到的bm_device_mem_t
+   */
+  std::unordered_map<std::uint64_t, bm_device_mem_t> mMems;
+};
+
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_ALGORITHMAPI_BM_DEVICE_MEMORY_ALLOCATOR_H_
@@ -20,6 +20,8 @@
 #include "common/bmnn_utils.h"
 #include "common/common_defs.h"
 #include "common/object_metadata.h"
+#include "batch_assembler.h"
+#include "device_memory_pool.h"
 
 namespace sophon_stream {
 namespace element {
@@ -32,6 +34,21 @@ class Context {
  public:
   Context() = default;
   virtual ~Context() = default;
+
+  /**
+   * @brief 推理输入输出tensor的设备内存池，为空时每次直接申请和释放
+   */
+  std::shared_ptr<DeviceMemoryPool> deviceMemoryPool;
+  /**
+   * @brief 拆分batch输出时每个ObjectMetadata直接引用batch输出中自己的部分，
+   * 不再申请和复制，batch输出在所有引用释放后才释放
+   */
+  bool outputTensorViews = false;
+  /**
+   * @brief 组batch时第一个数据最多等待的时间，单位微秒，小于0时一直等到batch满，
+   * 参见BatchAssembler
+   */
+  int maxBatchWaitUs = -1;
 };
 
 }  // namespace element
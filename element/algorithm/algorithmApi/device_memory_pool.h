@@ -0,0 +1,252 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_ALGORITHMAPI_DEVICE_MEMORY_POOL_H_
+#define SOPHON_STREAM_ELEMENT_ALGORITHMAPI_DEVICE_MEMORY_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace element {
+
+/**
+ * @brief 一块设备内存，address为0表示申请失败
+ */
+struct DeviceMemoryBlock {
+  std::uint64_t address = 0;
+  std::size_t size = 0;
+};
+
+/**
+ * @brief 设备内存的申请和释放
+ * @details
+ * 只用地址和大小描述一块内存，不依赖bmlib；
+ * 实现见bm_device_memory_allocator.h，没有设备时可用HostMemoryAllocator代替
+ */
+class DeviceMemoryAllocator {
+ public:
+  virtual ~DeviceMemoryAllocator() = default;
+
+  /**
+   * @brief 申请至少size字节，返回块的size为实际大小
+   */
+  virtual DeviceMemoryBlock allocate(std::size_t size) = 0;
+
+  /**
+   * @brief block必须是allocate返回的块
+   */
+  virtual void free(const DeviceMemoryBlock& block) = 0;
+};
+
+/**
+ * @brief 用host内存模拟设备内存，用于没有设备时测试DeviceMemoryPool
+ */
+class HostMemoryAllocator : public DeviceMemoryAllocator,
+                            public ::sophon_stream::common::NoCopyable {
+ public:
+  DeviceMemoryBlock allocate(std::size_t size) override {
+    void* data = std::malloc(size);
+    if (!data) return {};
+    ++mAllocations;
+    mLiveBytes += size;
+    return {reinterpret_cast<std::uint64_t>(data), size};
+  }
+
+  void free(const DeviceMemoryBlock& block) override {
+    ++mFrees;
+    mLiveBytes -= block.size;
+    std::free(reinterpret_cast<void*>(block.address));
+  }
+
+  std::uint64_t getAllocations() const { return mAllocations; }
+  std::uint64_t getFrees() const { return mFrees; }
+  std::size_t getLiveBytes() const { return mLiveBytes; }
+
+ private:
+  std::atomic<std::uint64_t> mAllocations{0};
+  std::atomic<std::uint64_t> mFrees{0};
+  std::atomic<std::size_t> mLiveBytes{0};
+};
+
+struct DeviceMemoryPoolStats {
+  /**
+   * @brief 向下层allocator申请和释放的次数
+   */
+  std::uint64_t upstreamAllocations = 0;
+  std::uint64_t upstreamFrees = 0;
+  /**
+   * @brief allocate命中缓存的次数
+   */
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  /**
+   * @brief 缓存中空闲块的总大小
+   */
+  std::size_t cachedBytes = 0;
+  /**
+   * @brief 使用中的块按size class取整后的总大小，以及实际请求的总大小，
+   * 两者之差为取整浪费的内存
+   */
+  std::size_t inUseBytes = 0;
+  std::size_t requestedBytes = 0;
+};
+
+/**
+ * @brief 按size class缓存设备内存块
+ * @details
+ * 推理每个batch都要申请和释放大小相同的输入输出tensor，
+ * 这里把释放的块按大小分类缓存起来，下次申请同一类大小时直接复用。
+ * size class为不小于MIN_BLOCK_SIZE、每个2的幂之间再四等分的大小，
+ * 取整浪费不超过请求大小的25%。
+ * 缓存的空闲块超过maxCachedBytes时，多出的块直接还给下层allocator；
+ * 下层申请失败时先释放全部缓存再重试一次。所有接口都是线程安全的
+ */
+class DeviceMemoryPool : public DeviceMemoryAllocator,
+                         public std::enable_shared_from_this<DeviceMemoryPool>,
+                         public ::sophon_stream::common::NoCopyable {
+ public:
+  static constexpr std::size_t MIN_BLOCK_SIZE = 4096;
+
+  DeviceMemoryPool(std::shared_ptr<DeviceMemoryAllocator> upstream,
+                   std::size_t maxCachedBytes)
+      : mUpstream(std::move(upstream)), mMaxCachedBytes(maxCachedBytes) {}
+
+  ~DeviceMemoryPool() override { trim(); }
+
+  static std::size_t roundSize(std::size_t size) {
+    if (size <= MIN_BLOCK_SIZE) return MIN_BLOCK_SIZE;
+    std::size_t base = MIN_BLOCK_SIZE;
+    while (base * 2 <= size) base *= 2;
+    std::size_t step = base / 4;
+    return base + (size - base + step - 1) / step * step;
+  }
+
+  DeviceMemoryBlock allocate(std::size_t size) override {
+    std::size_t classSize = roundSize(size);
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mFreeBlocks.find(classSize);
+      if (it != mFreeBlocks.end() && !it->second.empty()) {
+        DeviceMemoryBlock block{it->second.back(), classSize};
+        it->second.pop_back();
+        mStats.cachedBytes -= classSize;
+        ++mStats.hits;
+        markInUse(block, size);
+        return block;
+      }
+      ++mStats.misses;
+    }
+
+    DeviceMemoryBlock block = mUpstream->allocate(classSize);
+    if (!block.address) {
+      // 其他大小的空闲块可能占着设备内存
+      trim();
+      block = mUpstream->allocate(classSize);
+      if (!block.address) return {};
+    }
+    block.size = classSize;
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mStats.upstreamAllocations;
+    markInUse(block, size);
+    return block;
+  }
+
+  void free(const DeviceMemoryBlock& block) override {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mRequestedBytes.find(block.address);
+      if (it != mRequestedBytes.end()) {
+        mStats.requestedBytes -= it->second;
+        mRequestedBytes.erase(it);
+      }
+      mStats.inUseBytes -= block.size;
+      if (mStats.cachedBytes + block.size <= mMaxCachedBytes) {
+        mFreeBlocks[block.size].push_back(block.address);
+        mStats.cachedBytes += block.size;
+        return;
+      }
+      ++mStats.upstreamFrees;
+    }
+    mUpstream->free(block);
+  }
+
+  /**
+   * @brief 申请一块引用计数的内存，最后一个引用释放时归还到pool
+   * @details 返回的块持有pool的引用，pool必须由shared_ptr管理
+   * @return 申请失败时返回nullptr
+   */
+  std::shared_ptr<const DeviceMemoryBlock> acquire(std::size_t size) {
+    DeviceMemoryBlock block = allocate(size);
+    if (!block.address) return nullptr;
+    auto self = shared_from_this();
+    return std::shared_ptr<const DeviceMemoryBlock>(
+        new DeviceMemoryBlock(block), [self](const DeviceMemoryBlock* p) {
+          self->free(*p);
+          delete p;
+        });
+  }
+
+  /**
+   * @brief 把所有空闲块还给下层allocator
+   */
+  void trim() {
+    std::vector<DeviceMemoryBlock> blocks;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (auto& freeBlocks : mFreeBlocks) {
+        for (std::uint64_t address : freeBlocks.second)
+          blocks.push_back({address, freeBlocks.first});
+      }
+      mFreeBlocks.clear();
+      mStats.cachedBytes = 0;
+      mStats.upstreamFrees += blocks.size();
+    }
+    for (const auto& block : blocks) mUpstream->free(block);
+  }
+
+  DeviceMemoryPoolStats getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+  }
+
+ private:
+  void markInUse(const DeviceMemoryBlock& block, std::size_t size) {
+    mRequestedBytes[block.address] = size;
+    mStats.requestedBytes += size;
+    mStats.inUseBytes += block.size;
+  }
+
+  const std::shared_ptr<DeviceMemoryAllocator> mUpstream;
+  const std::size_t mMaxCachedBytes;
+
+  mutable std::mutex mMutex;
+  /**
+   * @brief key为size class，value为空闲块的地址
+   */
+  std::unordered_map<std::size_t, std::vector<std::uint64_t>> mFreeBlocks;
+  /**
+   * @brief 使用中的块实际请求的大小，用于统计取整浪费
+   */
+  std::unordered_map<std::uint64_t, std::size_t> mRequestedBytes;
+  DeviceMemoryPoolStats mStats;
+};
+
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_ALGORITHMAPI_DEVICE_MEMORY_POOL_H_
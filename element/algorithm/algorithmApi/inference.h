@@ -7,6 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "context.h"
 
 namespace sophon_stream {
@@ -17,52 +19,49 @@ class Inference {
   Inference() = default;
   virtual ~Inference() = default;
 
+  /**
+   * @brief soc上后处理会mmap每个ObjectMetadata的输出，
+   * 引用batch输出时每一份的起始地址需要按页对齐
+   */
+  static constexpr std::size_t OUTPUT_VIEW_ALIGNMENT = 4096;
+
   template <typename T, typename U = Context,
             typename std::enable_if<std::is_base_of<U, T>::value, int>::type* =
                 nullptr>
   std::shared_ptr<sophon_stream::common::bmTensors> mergeInputDeviceMem(
       std::shared_ptr<T> context, common::ObjectMetadatas& objectMetadatas) {
     // 合并inputBMtensors，并且申请连续的outputBMtensors
+    // 按数据数选择bmodel中不小于它的最小batch，不再总是补齐到max_batch
+    int stage = getBatchStage(context, objectMetadatas.size());
+    auto& stageInfo = context->bmNetwork->m_netinfo->stages[stage];
+    int batch = stageInfo.input_shapes[0].dims[0];
+    auto slabs = context->deviceMemoryPool ? std::make_shared<DeviceSlabs>()
+                                           : nullptr;
     std::shared_ptr<sophon_stream::common::bmTensors> inputTensors =
-        std::make_shared<sophon_stream::common::bmTensors>();
-    inputTensors.reset(
-        new sophon_stream::common::bmTensors(),
-        [](sophon_stream::common::bmTensors* p) {
-          for (int i = 0; i < p->tensors.size(); ++i)
-            if (p->tensors[i]->device_mem.u.device.device_addr != 0) {
-              bm_free_device(p->handle, p->tensors[i]->device_mem);
-            }
-          delete p;
-          p = nullptr;
-        });
-    inputTensors->handle = context->handle;
+        makeTensors(context->handle, slabs);
     inputTensors->tensors.resize(context->input_num);
     for (int i = 0; i < context->input_num; ++i) {
       inputTensors->tensors[i] = std::make_shared<bm_tensor_t>();
       inputTensors->tensors[i]->dtype =
           context->bmNetwork->m_netinfo->input_dtypes[i];
-      inputTensors->tensors[i]->shape =
-          context->bmNetwork->m_netinfo->stages[0].input_shapes[i];
+      inputTensors->tensors[i]->shape = stageInfo.input_shapes[i];
       inputTensors->tensors[i]->st_mode = BM_STORE_1N;
       // 计算大小
-      int input_bytes = context->max_batch *
-                        inputTensors->tensors[i]->shape.dims[1] *
+      int input_bytes = batch * inputTensors->tensors[i]->shape.dims[1] *
                         context->net_h * context->net_w;
       if (BM_FLOAT32 == context->bmNetwork->m_netinfo->input_dtypes[0])
         input_bytes *= 4;
       // malloc空间
-      auto ret = bm_malloc_device_byte_heap(
-          inputTensors->handle, &inputTensors->tensors[i]->device_mem, STREAM_NPU_HEAP,
-          input_bytes);
-      STREAM_CHECK(ret == 0, "Alloc Device Memory Failed! Program Terminated.")
+      allocDeviceMem(context, inputTensors->tensors[i]->device_mem, input_bytes,
+                     slabs.get());
       // d2d
       for (int j = 0; j < objectMetadatas.size(); ++j) {
         if (objectMetadatas[j]->mFrame->mEndOfStream) break;
         bm_memcpy_d2d_byte(
             inputTensors->handle, inputTensors->tensors[i]->device_mem,
-            j * input_bytes / context->max_batch,
+            j * input_bytes / batch,
             objectMetadatas[j]->mInputBMtensors->tensors[i]->device_mem, 0,
-            input_bytes / context->max_batch);
+            input_bytes / batch);
       }
     }
     return inputTensors;
@@ -73,19 +72,10 @@ class Inference {
                 nullptr>
   std::shared_ptr<sophon_stream::common::bmTensors> getOutputDeviceMem(
       std::shared_ptr<T> context) {
+    auto slabs = context->deviceMemoryPool ? std::make_shared<DeviceSlabs>()
+                                           : nullptr;
     std::shared_ptr<sophon_stream::common::bmTensors> outputTensors =
-        std::make_shared<sophon_stream::common::bmTensors>();
-    outputTensors.reset(
-        new sophon_stream::common::bmTensors(),
-        [](sophon_stream::common::bmTensors* p) {
-          for (int i = 0; i < p->tensors.size(); ++i)
-            if (p->tensors[i]->device_mem.u.device.device_addr != 0) {
-              bm_free_device(p->handle, p->tensors[i]->device_mem);
-            }
-          delete p;
-          p = nullptr;
-        });
-    outputTensors->handle = context->handle;
+        makeTensors(context->handle, slabs);
     outputTensors->tensors.resize(context->output_num);
     for (int i = 0; i < context->output_num; ++i) {
       outputTensors->tensors[i] = std::make_shared<bm_tensor_t>();
@@ -111,10 +101,8 @@ class Inference {
         max_size *= 2;
       
       // malloc空间
-      auto ret = bm_malloc_device_byte_heap(
-          outputTensors->handle, &outputTensors->tensors[i]->device_mem, STREAM_NPU_HEAP,
-          max_size);
-      STREAM_CHECK(ret == 0, "Alloc Device Memory Failed! Program Terminated.")
+      allocDeviceMem(context, outputTensors->tensors[i]->device_mem, max_size,
+                     slabs.get());
     }
     return outputTensors;
   }
@@ -126,56 +114,130 @@ class Inference {
       std::shared_ptr<T> context, common::ObjectMetadatas& objectMetadatas,
       std::shared_ptr<sophon_stream::common::bmTensors> outputTensors) {
     // 把outputTensors的显存拆出来给objectMetadatas
+    // 每一份的shape取自最大batch的stage，stages[0]不一定是最大batch
+    int maxStage = getBatchStage(context, context->max_batch);
+    auto& maxStageInfo = context->bmNetwork->m_netinfo->stages[maxStage];
+    std::vector<size_t> slice_sizes(context->output_num);
+    for (int j = 0; j < context->output_num; ++j) {
+      size_t max_size = 0;
+      for (int s = 0; s < context->bmNetwork->m_netinfo->stage_num; s++) {
+        size_t out_size = bmrt_shape_count(
+            &context->bmNetwork->m_netinfo->stages[s].output_shapes[j]);
+        if (max_size < out_size) {
+          max_size = out_size;
+        }
+      }
+      if (BM_FLOAT32 == context->bmNetwork->m_netinfo->output_dtypes[j])
+        max_size *= 4;
+      slice_sizes[j] = max_size / context->max_batch;
+    }
+    bool use_views =
+        context->outputTensorViews &&
+        (!context->bmNetwork->is_soc ||
+         std::all_of(slice_sizes.begin(), slice_sizes.end(), [](size_t size) {
+           return size % OUTPUT_VIEW_ALIGNMENT == 0;
+         }));
+
     for (int i = 0; i < objectMetadatas.size(); ++i) {
       if (objectMetadatas[i]->mFrame->mEndOfStream) break;
+      // 引用batch输出时由batch输出的引用计数决定何时释放
+      std::shared_ptr<DeviceSlabs> slabs;
+      std::shared_ptr<void> owner;
+      if (use_views) {
+        owner = outputTensors;
+      } else if (context->deviceMemoryPool) {
+        slabs = std::make_shared<DeviceSlabs>();
+        owner = slabs;
+      }
       objectMetadatas[i]->mOutputBMtensors =
-          std::make_shared<sophon_stream::common::bmTensors>();
-      objectMetadatas[i]->mOutputBMtensors.reset(
-          new sophon_stream::common::bmTensors(),
-          [](sophon_stream::common::bmTensors* p) {
-            for (int i = 0; i < p->tensors.size(); ++i)
-              if (p->tensors[i]->device_mem.u.device.device_addr != 0) {
-                bm_free_device(p->handle, p->tensors[i]->device_mem);
-              }
-            delete p;
-            p = nullptr;
-          });
+          makeTensors(context->handle, owner);
       objectMetadatas[i]->mOutputBMtensors->tensors.resize(context->output_num);
-      objectMetadatas[i]->mOutputBMtensors->handle = context->handle;
       for (int j = 0; j < context->output_num; ++j) {
         objectMetadatas[i]->mOutputBMtensors->tensors[j] =
             std::make_shared<bm_tensor_t>();
         objectMetadatas[i]->mOutputBMtensors->tensors[j]->dtype =
             context->bmNetwork->m_netinfo->output_dtypes[j];
         objectMetadatas[i]->mOutputBMtensors->tensors[j]->shape =
-            context->bmNetwork->m_netinfo->stages[0].output_shapes[j];
+            maxStageInfo.output_shapes[j];
         objectMetadatas[i]->mOutputBMtensors->tensors[j]->shape.dims[0] /=
             context->max_batch;
         objectMetadatas[i]->mOutputBMtensors->tensors[j]->st_mode = BM_STORE_1N;
-        size_t max_size = 0;
-        for (int s = 0; s < context->bmNetwork->m_netinfo->stage_num; s++) {
-          size_t out_size = bmrt_shape_count(
-              &context->bmNetwork->m_netinfo->stages[s].output_shapes[j]);
-          if (max_size < out_size) {
-            max_size = out_size;
-          }
+        size_t max_size = slice_sizes[j];
+        bm_device_mem_t& mem =
+            objectMetadatas[i]->mOutputBMtensors->tensors[j]->device_mem;
+        if (use_views) {
+          mem = bm_mem_from_device(
+              bm_mem_get_device_addr(outputTensors->tensors[j]->device_mem) +
+                  i * max_size,
+              max_size);
+          continue;
         }
-        if (BM_FLOAT32 == context->bmNetwork->m_netinfo->output_dtypes[j])
-          max_size *= 4;
-        max_size /= context->max_batch;
-        auto ret = bm_malloc_device_byte_heap(
-            objectMetadatas[i]->mOutputBMtensors->handle,
-            &objectMetadatas[i]->mOutputBMtensors->tensors[j]->device_mem, STREAM_NPU_HEAP,
-            max_size);
-        STREAM_CHECK(ret == 0,
-                     "Alloc Device Memory Failed! Program Terminated.")
-        bm_memcpy_d2d_byte(
-            context->handle,
-            objectMetadatas[i]->mOutputBMtensors->tensors[j]->device_mem, 0,
-            outputTensors->tensors[j]->device_mem, i * max_size, max_size);
+        allocDeviceMem(context, mem, max_size, slabs.get());
+        bm_memcpy_d2d_byte(context->handle, mem, 0,
+                           outputTensors->tensors[j]->device_mem,
+                           i * max_size, max_size);
       }
     }
   }
+
+ protected:
+  /**
+   * @brief bmodel中batch不小于number的最小stage，只有一个stage时总是0
+   */
+  template <typename T>
+  static int getBatchStage(std::shared_ptr<T> context, int number) {
+    int batch = context->bmNetwork->get_nearest_batch(number);
+    auto netinfo = context->bmNetwork->m_netinfo;
+    for (int s = 0; s < netinfo->stage_num; ++s) {
+      if (netinfo->stages[s].input_shapes[0].dims[0] == batch) return s;
+    }
+    return 0;
+  }
+
+  /**
+   * @brief 从DeviceMemoryPool申请的块，随bmTensors一起释放
+   */
+  using DeviceSlabs = std::vector<std::shared_ptr<const DeviceMemoryBlock>>;
+
+  /**
+   * @brief 新建bmTensors
+   * @param owner 为空时bmTensors释放时bm_free_device其中的显存；
+   * 否则显存属于owner（DeviceSlabs或被引用的batch输出），只释放对owner的引用
+   */
+  static std::shared_ptr<sophon_stream::common::bmTensors> makeTensors(
+      bm_handle_t handle, std::shared_ptr<void> owner) {
+    std::shared_ptr<sophon_stream::common::bmTensors> tensors(
+        new sophon_stream::common::bmTensors(),
+        [owner](sophon_stream::common::bmTensors* p) {
+          for (int i = 0; !owner && i < p->tensors.size(); ++i)
+            if (p->tensors[i]->device_mem.u.device.device_addr != 0) {
+              bm_free_device(p->handle, p->tensors[i]->device_mem);
+            }
+          delete p;
+          p = nullptr;
+        });
+    tensors->handle = handle;
+    return tensors;
+  }
+
+  /**
+   * @brief slabs不为空时从context->deviceMemoryPool申请，并记录在slabs中
+   */
+  template <typename T>
+  static void allocDeviceMem(std::shared_ptr<T> context, bm_device_mem_t& mem,
+                             size_t size, DeviceSlabs* slabs) {
+    if (slabs) {
+      auto slab = context->deviceMemoryPool->acquire(size);
+      STREAM_CHECK(slab != nullptr,
+                   "Alloc Device Memory Failed! Program Terminated.")
+      mem = bm_mem_from_device(slab->address, size);
+      slabs->push_back(slab);
+      return;
+    }
+    auto ret = bm_malloc_device_byte_heap(context->handle, &mem,
+                                          STREAM_NPU_HEAP, size);
+    STREAM_CHECK(ret == 0, "Alloc Device Memory Failed! Program Terminated.")
+  }
 };
 
 }  // namespace element
@@ -0,0 +1,162 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "post_process_pool.h"
+
+#include <sys/prctl.h>
+
+#include <chrono>
+#include <string>
+
+#include "common/logger.h"
+#include "worker_pool.h"
+
+namespace sophon_stream {
+namespace element {
+
+PostProcessPool::PostProcessPool(int threadNumber, int queueDepth,
+                                 int keyNumber)
+    : mThreadNumber(threadNumber > 0 ? threadNumber : 1),
+      mQueueDepth(queueDepth > 0 ? queueDepth : mThreadNumber * 2) {
+  keyNumber = keyNumber > 0 ? keyNumber : 1;
+  mKeys.reserve(keyNumber);
+  for (int i = 0; i < keyNumber; ++i) {
+    mKeys.push_back(std::make_unique<KeyState>());
+  }
+}
+
+PostProcessPool::~PostProcessPool() { stop(); }
+
+void PostProcessPool::start() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning) return;
+    mRunning = true;
+  }
+  IVS_INFO("Start post process pool, thread number: {0:d}, queue depth: {1:d}",
+           mThreadNumber, mQueueDepth);
+  mThreads.reserve(mThreadNumber);
+  for (int i = 0; i < mThreadNumber; ++i) {
+    mThreads.emplace_back(&PostProcessPool::run, this, i);
+  }
+}
+
+void PostProcessPool::stop() {
+  drain();
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mRunning) return;
+    mRunning = false;
+  }
+  mTaskCond.notify_all();
+  for (auto& thread : mThreads) {
+    if (thread.joinable()) thread.join();
+  }
+  mThreads.clear();
+  IVS_INFO("Stop post process pool finish");
+}
+
+void PostProcessPool::submit(int key, Task task, Finish finish) {
+  auto job = std::make_shared<Job>();
+  job->task = std::move(task);
+  job->finish = std::move(finish);
+  job->key = key % static_cast<int>(mKeys.size());
+
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (!mRunning) {
+      // 线程池未启动时在当前线程完成
+      lock.unlock();
+      if (job->task) job->task(0);
+      if (job->finish) job->finish();
+      return;
+    }
+    if (mInFlight >= mQueueDepth) {
+      // 在pool调度的worker上阻塞时让出执行名额
+      framework::WorkerPool::BlockingScope blockingScope;
+      mFinishCond.wait(lock, [this] { return mInFlight < mQueueDepth; });
+    }
+    ++mInFlight;
+  }
+
+  // 先进入key的顺序队列，再交给线程执行，保证release时能看到它
+  {
+    auto& keyState = *mKeys[job->key];
+    std::lock_guard<std::mutex> lock(keyState.mutex);
+    keyState.jobs.push_back(job);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTasks.push_back(std::move(job));
+  }
+  mTaskCond.notify_one();
+}
+
+void PostProcessPool::drain() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  mFinishCond.wait(lock, [this] { return mInFlight == 0; });
+}
+
+int PostProcessPool::getInFlight() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mInFlight;
+}
+
+double PostProcessPool::getBusySeconds() const {
+  return mBusyNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+}
+
+void PostProcessPool::run(int workerId) {
+  prctl(PR_SET_NAME, ("post_" + std::to_string(workerId)).c_str());
+  while (true) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mTaskCond.wait(lock, [this] { return !mRunning || !mTasks.empty(); });
+      if (mTasks.empty()) return;
+      job = std::move(mTasks.front());
+      mTasks.pop_front();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    if (job->task) job->task(workerId);
+    auto end = std::chrono::steady_clock::now();
+    mBusyNanoseconds.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+            .count(),
+        std::memory_order_relaxed);
+
+    release(job);
+  }
+}
+
+void PostProcessPool::release(const std::shared_ptr<Job>& job) {
+  auto& keyState = *mKeys[job->key];
+  std::unique_lock<std::mutex> lock(keyState.mutex);
+  job->done = true;
+  // 正在release的线程会在下一轮检查到这个job
+  if (keyState.releasing) return;
+  keyState.releasing = true;
+  while (!keyState.jobs.empty() && keyState.jobs.front()->done) {
+    std::shared_ptr<Job> front = std::move(keyState.jobs.front());
+    keyState.jobs.pop_front();
+    lock.unlock();
+    if (front->finish) front->finish();
+    {
+      std::lock_guard<std::mutex> inFlightLock(mMutex);
+      --mInFlight;
+    }
+    mFinishCond.notify_all();
+    lock.lock();
+  }
+  keyState.releasing = false;
+}
+
+}  // namespace element
+}  // namespace sophon_stream
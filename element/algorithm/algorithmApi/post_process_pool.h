@@ -0,0 +1,140 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_ALGORITHMAPI_POST_PROCESS_POOL_H_
+#define SOPHON_STREAM_ELEMENT_ALGORITHMAPI_POST_PROCESS_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace element {
+
+/**
+ * @brief 与推理线程解耦的后处理线程池
+ * @details
+ * 推理线程把一个batch的后处理提交到线程池后立即返回，去取下一个batch，
+ * 后处理由线程池中的线程并行完成。后处理完成的顺序不确定，
+ * 同一个key（一般为dataPipeId，同一路码流总在同一个dataPipe中）的任务按提交顺序调用finish，
+ * 因此推送到下游的数据仍保持每一路码流内的顺序。
+ * 已提交但finish尚未调用的任务数达到queueDepth时，submit阻塞，避免推理线程无限领先。
+ */
+class PostProcessPool : public ::sophon_stream::common::NoCopyable {
+ public:
+  /**
+   * @brief 在线程池中执行的后处理，workerId为[0, threadNumber)，
+   * 可用于索引每个线程独占的资源
+   */
+  using Task = std::function<void(int workerId)>;
+  /**
+   * @brief 后处理完成后按提交顺序调用，一般用于把数据推送到下游
+   */
+  using Finish = std::function<void()>;
+
+  /**
+   * @param[in] threadNumber : 后处理线程数
+   * @param[in] queueDepth : 已提交但尚未finish的任务数上限，<= 0时取threadNumber * 2
+   * @param[in] keyNumber : key的数量，submit的key取值为[0, keyNumber)
+   */
+  PostProcessPool(int threadNumber, int queueDepth, int keyNumber);
+
+  ~PostProcessPool();
+
+  void start();
+
+  /**
+   * @brief 等待已提交的任务全部完成后停止线程
+   */
+  void stop();
+
+  /**
+   * @brief 提交一个后处理任务
+   * @brief 同一个key的任务应由同一个线程提交，finish的调用顺序与提交顺序一致
+   */
+  void submit(int key, Task task, Finish finish);
+
+  /**
+   * @brief 阻塞直到已提交的任务全部finish
+   */
+  void drain();
+
+  int getThreadNumber() const { return mThreadNumber; }
+
+  /**
+   * @brief 已提交但尚未finish的任务数
+   */
+  int getInFlight();
+
+  /**
+   * @brief 所有后处理线程执行Task的累计时间，单位秒
+   */
+  double getBusySeconds() const;
+
+ private:
+  struct Job {
+    Task task;
+    Finish finish;
+    int key;
+    /**
+     * @brief task已执行完，由KeyState::mutex保护
+     */
+    bool done = false;
+  };
+
+  struct KeyState {
+    std::mutex mutex;
+    /**
+     * @brief 按提交顺序排列的未finish任务
+     */
+    std::deque<std::shared_ptr<Job>> jobs;
+    /**
+     * @brief 有线程正在按顺序调用finish，其他线程完成task后只做标记
+     */
+    bool releasing = false;
+  };
+
+  void run(int workerId);
+
+  /**
+   * @brief 标记job完成，并从队首开始依次调用已完成任务的finish
+   */
+  void release(const std::shared_ptr<Job>& job);
+
+  const int mThreadNumber;
+  const int mQueueDepth;
+
+  std::vector<std::unique_ptr<KeyState>> mKeys;
+  std::vector<std::thread> mThreads;
+
+  std::mutex mMutex;
+  std::condition_variable mTaskCond;
+  /**
+   * @brief 任务finish后通知等待队列空间或drain的线程
+   */
+  std::condition_variable mFinishCond;
+  std::deque<std::shared_ptr<Job>> mTasks;
+  int mInFlight = 0;
+  bool mRunning = false;
+
+  std::atomic<std::uint64_t> mBusyNanoseconds{0};
+};
+
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_ALGORITHMAPI_POST_PROCESS_POOL_H_
@@ -0,0 +1,727 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "yolo_decode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STREAM_YOLO_DECODE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STREAM_YOLO_DECODE_NEON 1
+#endif
+
+namespace sophon_stream {
+namespace element {
+
+namespace {
+
+// exp的Cephes多项式近似，相对误差约1e-7，向量实现和标量实现使用同一组系数
+constexpr float EXP_HI = 88.0f;
+constexpr float EXP_LO = -88.0f;
+constexpr float LOG2E = 1.44269504088896341f;
+constexpr float LN2_HI = 0.693359375f;
+constexpr float LN2_LO = -2.12194440e-4f;
+constexpr float EXP_P0 = 1.9875691500e-4f;
+constexpr float EXP_P1 = 1.3981999507e-3f;
+constexpr float EXP_P2 = 8.3334519073e-3f;
+constexpr float EXP_P3 = 4.1665795894e-2f;
+constexpr float EXP_P4 = 1.6666665459e-1f;
+constexpr float EXP_P5 = 5.0000001201e-1f;
+
+/**
+ * @brief 列优先数据按块求类别最大值，块内的累加缓冲区留在L1中
+ */
+constexpr int COLUMN_BLOCK = 1024;
+
+float expScalar(float x) {
+  x = std::min(std::max(x, EXP_LO), EXP_HI);
+  float fx = std::floor(x * LOG2E + 0.5f);
+  x = x - fx * LN2_HI;
+  x = x - fx * LN2_LO;
+  float z = x * x;
+  float y = EXP_P0;
+  y = y * x + EXP_P1;
+  y = y * x + EXP_P2;
+  y = y * x + EXP_P3;
+  y = y * x + EXP_P4;
+  y = y * x + EXP_P5;
+  y = y * z + x + 1.f;
+  int32_t bits = (static_cast<int32_t>(fx) + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return y * scale;
+}
+
+float sigmoidScalar(float x) { return 1.f / (1.f + expScalar(-x)); }
+
+/**
+ * @brief logit(p) = log(p / (1 - p))，sigmoid(x) > p 等价于 x > logit(p)
+ */
+float logit(float p) {
+  if (p <= 0.f) return -std::numeric_limits<float>::infinity();
+  if (p >= 1.f) return std::numeric_limits<float>::infinity();
+  return std::log(p / (1.f - p));
+}
+
+/**
+ * @brief NMS中当前保留的框
+ */
+struct NmsBox {
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+  float area;
+};
+
+/**
+ * @brief 以下内核都只处理前若干个元素并返回处理的个数，剩余部分由标量代码完成
+ */
+using RowMaxKernel = int (*)(const float* values, int num, float* maxValue);
+using MaxAccumulateKernel = int (*)(float* acc, const float* values, int num);
+using ExpKernel = int (*)(const float* in, float* out, int num);
+using SuppressKernel = int (*)(const NmsBox& a, const float* x1,
+                               const float* y1, const float* x2,
+                               const float* y2, const float* area, int num,
+                               float thresh, uint8_t* suppressed);
+
+int rowMaxNone(const float*, int, float*) { return 0; }
+int maxAccumulateNone(float*, const float*, int) { return 0; }
+int expNone(const float*, float*, int) { return 0; }
+int suppressNone(const NmsBox&, const float*, const float*, const float*,
+                 const float*, const float*, int, float, uint8_t*) {
+  return 0;
+}
+
+void suppressScalar(const NmsBox& a, const float* x1, const float* y1,
+                    const float* x2, const float* y2, const float* area,
+                    int begin, int num, float thresh, uint8_t* suppressed) {
+  for (int j = begin; j < num; ++j) {
+    float left = std::max(a.x1, x1[j]);
+    float top = std::max(a.y1, y1[j]);
+    float right = std::min(a.x2, x2[j]);
+    float bottom = std::min(a.y2, y2[j]);
+    float overlap =
+        std::max(0.0f, right - left) * std::max(0.0f, bottom - top);
+    if (overlap / (a.area + area[j] - overlap) > thresh) suppressed[j] = 1;
+  }
+}
+
+#if STREAM_YOLO_DECODE_X86
+
+inline __m128 expSse2(__m128 x) {
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_LO)), _mm_set1_ps(EXP_HI));
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2E)), _mm_set1_ps(0.5f));
+  // SSE2没有floor：截断后对大于原值的元素减1
+  __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  fx = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), _mm_set1_ps(1.f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_HI)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_LO)));
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(EXP_P0);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P1));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P2));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P3));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P4));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P5));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1.f));
+  __m128i bits = _mm_slli_epi32(
+      _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(bits));
+}
+
+int rowMaxSse2(const float* values, int num, float* maxValue) {
+  int n = num / 4 * 4;
+  if (n == 0) return 0;
+  __m128 m = _mm_loadu_ps(values);
+  for (int i = 4; i < n; i += 4) m = _mm_max_ps(m, _mm_loadu_ps(values + i));
+  m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+  *maxValue = _mm_cvtss_f32(m);
+  return n;
+}
+
+int maxAccumulateSse2(float* acc, const float* values, int num) {
+  int n = num / 4 * 4;
+  for (int i = 0; i < n; i += 4)
+    _mm_storeu_ps(acc + i, _mm_max_ps(_mm_loadu_ps(acc + i),
+                                      _mm_loadu_ps(values + i)));
+  return n;
+}
+
+int expSse2Kernel(const float* in, float* out, int num) {
+  int n = num / 4 * 4;
+  for (int i = 0; i < n; i += 4)
+    _mm_storeu_ps(out + i, expSse2(_mm_loadu_ps(in + i)));
+  return n;
+}
+
+int sigmoidSse2(const float* in, float* out, int num) {
+  const __m128 one = _mm_set1_ps(1.f);
+  int n = num / 4 * 4;
+  for (int i = 0; i < n; i += 4) {
+    __m128 e = expSse2(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(in + i)));
+    _mm_storeu_ps(out + i, _mm_div_ps(one, _mm_add_ps(one, e)));
+  }
+  return n;
+}
+
+int suppressSse2(const NmsBox& a, const float* x1, const float* y1,
+                 const float* x2, const float* y2, const float* area, int num,
+                 float thresh, uint8_t* suppressed) {
+  const __m128 ax1 = _mm_set1_ps(a.x1);
+  const __m128 ay1 = _mm_set1_ps(a.y1);
+  const __m128 ax2 = _mm_set1_ps(a.x2);
+  const __m128 ay2 = _mm_set1_ps(a.y2);
+  const __m128 aarea = _mm_set1_ps(a.area);
+  const __m128 th = _mm_set1_ps(thresh);
+  const __m128 zero = _mm_setzero_ps();
+  int n = num / 4 * 4;
+  for (int j = 0; j < n; j += 4) {
+    __m128 w = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(ax2, _mm_loadu_ps(x2 + j)),
+                                           _mm_max_ps(ax1, _mm_loadu_ps(x1 + j))));
+    __m128 h = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(ay2, _mm_loadu_ps(y2 + j)),
+                                           _mm_max_ps(ay1, _mm_loadu_ps(y1 + j))));
+    __m128 overlap = _mm_mul_ps(w, h);
+    __m128 iou = _mm_div_ps(
+        overlap,
+        _mm_sub_ps(_mm_add_ps(aarea, _mm_loadu_ps(area + j)), overlap));
+    int mask = _mm_movemask_ps(_mm_cmpgt_ps(iou, th));
+    while (mask) {
+      suppressed[j + __builtin_ctz(mask)] = 1;
+      mask &= mask - 1;
+    }
+  }
+  return n;
+}
+
+__attribute__((target("avx2"))) inline __m256 expAvx2(__m256 x) {
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)),
+                    _mm256_set1_ps(EXP_HI));
+  __m256 fx = _mm256_floor_ps(_mm256_add_ps(
+      _mm256_mul_ps(x, _mm256_set1_ps(LOG2E)), _mm256_set1_ps(0.5f)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(LN2_HI)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(LN2_LO)));
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(EXP_P0);
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P1));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P2));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P3));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P4));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P5));
+  y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, z), x),
+                    _mm256_set1_ps(1.f));
+  __m256i bits = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(bits));
+}
+
+__attribute__((target("avx2"))) int rowMaxAvx2(const float* values, int num,
+                                               float* maxValue) {
+  int n = num / 8 * 8;
+  if (n == 0) return 0;
+  __m256 m = _mm256_loadu_ps(values);
+  for (int i = 8; i < n; i += 8)
+    m = _mm256_max_ps(m, _mm256_loadu_ps(values + i));
+  __m128 h = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+  h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+  h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+  *maxValue = _mm_cvtss_f32(h);
+  return n;
+}
+
+__attribute__((target("avx2"))) int maxAccumulateAvx2(float* acc,
+                                                      const float* values,
+                                                      int num) {
+  int n = num / 8 * 8;
+  for (int i = 0; i < n; i += 8)
+    _mm256_storeu_ps(acc + i, _mm256_max_ps(_mm256_loadu_ps(acc + i),
+                                            _mm256_loadu_ps(values + i)));
+  return n;
+}
+
+__attribute__((target("avx2"))) int expAvx2Kernel(const float* in, float* out,
+                                                  int num) {
+  int n = num / 8 * 8;
+  for (int i = 0; i < n; i += 8)
+    _mm256_storeu_ps(out + i, expAvx2(_mm256_loadu_ps(in + i)));
+  return n;
+}
+
+__attribute__((target("avx2"))) int sigmoidAvx2(const float* in, float* out,
+                                                int num) {
+  const __m256 one = _mm256_set1_ps(1.f);
+  int n = num / 8 * 8;
+  for (int i = 0; i < n; i += 8) {
+    __m256 e =
+        expAvx2(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(in + i)));
+    _mm256_storeu_ps(out + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+  }
+  return n;
+}
+
+__attribute__((target("avx2"))) int suppressAvx2(
+    const NmsBox& a, const float* x1, const float* y1, const float* x2,
+    const float* y2, const float* area, int num, float thresh,
+    uint8_t* suppressed) {
+  const __m256 ax1 = _mm256_set1_ps(a.x1);
+  const __m256 ay1 = _mm256_set1_ps(a.y1);
+  const __m256 ax2 = _mm256_set1_ps(a.x2);
+  const __m256 ay2 = _mm256_set1_ps(a.y2);
+  const __m256 aarea = _mm256_set1_ps(a.area);
+  const __m256 th = _mm256_set1_ps(thresh);
+  const __m256 zero = _mm256_setzero_ps();
+  int n = num / 8 * 8;
+  for (int j = 0; j < n; j += 8) {
+    __m256 w = _mm256_max_ps(
+        zero, _mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(x2 + j)),
+                            _mm256_max_ps(ax1, _mm256_loadu_ps(x1 + j))));
+    __m256 h = _mm256_max_ps(
+        zero, _mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(y2 + j)),
+                            _mm256_max_ps(ay1, _mm256_loadu_ps(y1 + j))));
+    __m256 overlap = _mm256_mul_ps(w, h);
+    __m256 iou = _mm256_div_ps(
+        overlap, _mm256_sub_ps(_mm256_add_ps(aarea, _mm256_loadu_ps(area + j)),
+                               overlap));
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(iou, th, _CMP_GT_OQ));
+    while (mask) {
+      suppressed[j + __builtin_ctz(mask)] = 1;
+      mask &= mask - 1;
+    }
+  }
+  return n;
+}
+
+#endif  // STREAM_YOLO_DECODE_X86
+
+#if STREAM_YOLO_DECODE_NEON
+
+inline float32x4_t expNeon(float32x4_t x) {
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(EXP_LO)), vdupq_n_f32(EXP_HI));
+  float32x4_t fx = vrndmq_f32(
+      vaddq_f32(vmulq_f32(x, vdupq_n_f32(LOG2E)), vdupq_n_f32(0.5f)));
+  x = vsubq_f32(x, vmulq_f32(fx, vdupq_n_f32(LN2_HI)));
+  x = vsubq_f32(x, vmulq_f32(fx, vdupq_n_f32(LN2_LO)));
+  float32x4_t z = vmulq_f32(x, x);
+  float32x4_t y = vdupq_n_f32(EXP_P0);
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P1));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P2));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P3));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P4));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P5));
+  y = vaddq_f32(vaddq_f32(vmulq_f32(y, z), x), vdupq_n_f32(1.f));
+  int32x4_t bits =
+      vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127)), 23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(bits));
+}
+
+int rowMaxNeon(const float* values, int num, float* maxValue) {
+  int n = num / 4 * 4;
+  if (n == 0) return 0;
+  float32x4_t m = vld1q_f32(values);
+  for (int i = 4; i < n; i += 4) m = vmaxq_f32(m, vld1q_f32(values + i));
+  *maxValue = vmaxvq_f32(m);
+  return n;
+}
+
+int maxAccumulateNeon(float* acc, const float* values, int num) {
+  int n = num / 4 * 4;
+  for (int i = 0; i < n; i += 4)
+    vst1q_f32(acc + i, vmaxq_f32(vld1q_f32(acc + i), vld1q_f32(values + i)));
+  return n;
+}
+
+int expNeonKernel(const float* in, float* out, int num) {
+  int n = num / 4 * 4;
+  for (int i = 0; i < n; i += 4) vst1q_f32(out + i, expNeon(vld1q_f32(in + i)));
+  return n;
+}
+
+int sigmoidNeon(const float* in, float* out, int num) {
+  const float32x4_t one = vdupq_n_f32(1.f);
+  int n = num / 4 * 4;
+  for (int i = 0; i < n; i += 4) {
+    float32x4_t e = expNeon(vnegq_f32(vld1q_f32(in + i)));
+    vst1q_f32(out + i, vdivq_f32(one, vaddq_f32(one, e)));
+  }
+  return n;
+}
+
+int suppressNeon(const NmsBox& a, const float* x1, const float* y1,
+                 const float* x2, const float* y2, const float* area, int num,
+                 float thresh, uint8_t* suppressed) {
+  const float32x4_t ax1 = vdupq_n_f32(a.x1);
+  const float32x4_t ay1 = vdupq_n_f32(a.y1);
+  const float32x4_t ax2 = vdupq_n_f32(a.x2);
+  const float32x4_t ay2 = vdupq_n_f32(a.y2);
+  const float32x4_t aarea = vdupq_n_f32(a.area);
+  const float32x4_t th = vdupq_n_f32(thresh);
+  const float32x4_t zero = vdupq_n_f32(0.f);
+  int n = num / 4 * 4;
+  for (int j = 0; j < n; j += 4) {
+    float32x4_t w =
+        vmaxq_f32(zero, vsubq_f32(vminq_f32(ax2, vld1q_f32(x2 + j)),
+                                  vmaxq_f32(ax1, vld1q_f32(x1 + j))));
+    float32x4_t h =
+        vmaxq_f32(zero, vsubq_f32(vminq_f32(ay2, vld1q_f32(y2 + j)),
+                                  vmaxq_f32(ay1, vld1q_f32(y1 + j))));
+    float32x4_t overlap = vmulq_f32(w, h);
+    float32x4_t iou = vdivq_f32(
+        overlap, vsubq_f32(vaddq_f32(aarea, vld1q_f32(area + j)), overlap));
+    uint32x4_t mask = vcgtq_f32(iou, th);
+    if (vmaxvq_u32(mask) == 0) continue;
+    uint32_t lanes[4];
+    vst1q_u32(lanes, mask);
+    for (int k = 0; k < 4; ++k)
+      if (lanes[k]) suppressed[j + k] = 1;
+  }
+  return n;
+}
+
+#endif  // STREAM_YOLO_DECODE_NEON
+
+}  // namespace
+
+/**
+ * @brief 按CPU选择的一组内核
+ */
+struct YoloDecodeKernels {
+  const char* name;
+  RowMaxKernel rowMax;
+  MaxAccumulateKernel maxAccumulate;
+  ExpKernel exp;
+  ExpKernel sigmoid;
+  SuppressKernel suppress;
+};
+
+namespace {
+
+using Kernels = YoloDecodeKernels;
+
+const Kernels SCALAR_KERNELS = {"scalar", rowMaxNone, maxAccumulateNone,
+                                expNone, expNone, suppressNone};
+
+Kernels selectKernels() {
+#if STREAM_YOLO_DECODE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {"avx2",        rowMaxAvx2,  maxAccumulateAvx2,
+            expAvx2Kernel, sigmoidAvx2, suppressAvx2};
+  return {"sse2",        rowMaxSse2,  maxAccumulateSse2,
+          expSse2Kernel, sigmoidSse2, suppressSse2};
+#elif STREAM_YOLO_DECODE_NEON
+  return {"neon",        rowMaxNeon,  maxAccumulateNeon,
+          expNeonKernel, sigmoidNeon, suppressNeon};
+#endif
+  return SCALAR_KERNELS;
+}
+
+const Kernels& getKernels() {
+  static const Kernels kernels = selectKernels();
+  return kernels;
+}
+
+void expImpl(const Kernels& kernels, const float* in, float* out, int num) {
+  for (int i = kernels.exp(in, out, num); i < num; ++i)
+    out[i] = expScalar(in[i]);
+}
+
+void sigmoidImpl(const Kernels& kernels, const float* in, float* out,
+                 int num) {
+  for (int i = kernels.sigmoid(in, out, num); i < num; ++i)
+    out[i] = sigmoidScalar(in[i]);
+}
+
+}  // namespace
+
+YoloDecoder::YoloDecoder(const YoloDecodeConfig& config)
+    : mConfig(config),
+      mKernels(config.scalarKernels ? &SCALAR_KERNELS : &getKernels()) {}
+
+void YoloDecoder::clear() { mCandidates.clear(); }
+
+float YoloDecoder::rowMax(const float* values, int num) const {
+  float maxValue = -std::numeric_limits<float>::infinity();
+  for (int i = mKernels->rowMax(values, num, &maxValue); i < num; ++i)
+    if (values[i] > maxValue) maxValue = values[i];
+  return maxValue;
+}
+
+void YoloDecoder::decodeAnchorGrid(const float* data, int featH, int featW,
+                                   int nout,
+                                   const std::vector<std::vector<int>>& anchors,
+                                   int netW, int netH) {
+  const int classNum = nout - 5;
+  const int area = featH * featW;
+  const float logitMin = logit(mConfig.minThresh);
+  mPendingIndex.clear();
+  mPendingClass.clear();
+  mPendingValues.clear();
+
+  // 只有objectness和类别logit都超过logit(minThresh)的框才可能通过阈值，
+  // 这里不做任何sigmoid，每个框通常只读取objectness一个值
+  auto pend = [&](int index, int classId, const float* ptr) {
+    mPendingIndex.push_back(index);
+    mPendingClass.push_back(classId);
+    mPendingValues.insert(mPendingValues.end(), ptr, ptr + 5);
+    mPendingValues.push_back(ptr[5 + classId]);
+  };
+  const int total = static_cast<int>(anchors.size()) * area;
+  for (int index = 0; index < total; ++index) {
+    const float* ptr = data + static_cast<std::size_t>(index) * nout;
+    if (!(ptr[4] > logitMin)) continue;
+    if (mConfig.multiLabel) {
+      for (int c = 0; c < classNum; ++c)
+        if (ptr[5 + c] > logitMin) pend(index, c, ptr);
+      continue;
+    }
+    float maxValue = rowMax(ptr + 5, classNum);
+    if (!(maxValue > logitMin)) continue;
+    int classId = std::find(ptr + 5, ptr + 5 + classNum, maxValue) - (ptr + 5);
+    if (classId == classNum) continue;
+    pend(index, classId, ptr);
+  }
+  if (mPendingIndex.empty()) return;
+
+  // 通过的框每个6个值：x, y, w, h, objectness, 类别，一次批量sigmoid
+  sigmoidImpl(*mKernels, mPendingValues.data(), mPendingValues.data(),
+              static_cast<int>(mPendingValues.size()));
+  for (std::size_t k = 0; k < mPendingIndex.size(); ++k) {
+    const float* v = mPendingValues.data() + k * 6;
+    int classId = mPendingClass[k];
+    float score = v[4] * v[5];
+    if (!(score > classThresh(classId))) continue;
+    int anchorIdx = mPendingIndex[k] / area;
+    int cell = mPendingIndex[k] % area;
+    float cx = (v[0] * 2 - 0.5f + cell % featW) / featW * netW;
+    float cy = (v[1] * 2 - 0.5f + cell / featW) / featH * netH;
+    float w = v[2] * 2;
+    float h = v[3] * 2;
+    w = w * w * anchors[anchorIdx][0];
+    h = h * h * anchors[anchorIdx][1];
+    mCandidates.push_back(
+        {cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, score, classId});
+  }
+}
+
+void YoloDecoder::decodeRows(const float* data, int boxNum, int nout,
+                             bool objectness) {
+  const int classOffset = objectness ? 5 : 4;
+  const int classNum = nout - classOffset;
+  for (int i = 0; i < boxNum; ++i) {
+    const float* ptr = data + static_cast<std::size_t>(i) * nout;
+    float obj = 1.f;
+    if (objectness) {
+      obj = ptr[4];
+      if (!(obj > mConfig.minThresh)) continue;
+    }
+    const float* cls = ptr + classOffset;
+    auto push = [&](int classId, float score) {
+      mCandidates.push_back({ptr[0] - ptr[2] / 2, ptr[1] - ptr[3] / 2,
+                             ptr[0] + ptr[2] / 2, ptr[1] + ptr[3] / 2, score,
+                             classId});
+    };
+    if (mConfig.multiLabel) {
+      for (int c = 0; c < classNum; ++c)
+        if (obj * cls[c] > classThresh(c)) push(c, obj * cls[c]);
+      continue;
+    }
+    float maxValue = rowMax(cls, classNum);
+    float score = obj * maxValue;
+    if (!(score > mConfig.minThresh)) continue;
+    int classId = std::find(cls, cls + classNum, maxValue) - cls;
+    if (classId < classNum && score > classThresh(classId))
+      push(classId, score);
+  }
+}
+
+void YoloDecoder::decodeColumns(const float* data, int boxNum, int nout) {
+  const int classNum = nout - 4;
+  if (classNum <= 0) return;
+  const float* cls = data + static_cast<std::size_t>(4) * boxNum;
+  mMaxBuffer.resize(COLUMN_BLOCK);
+  float* acc = mMaxBuffer.data();
+  for (int begin = 0; begin < boxNum; begin += COLUMN_BLOCK) {
+    const int len = std::min(COLUMN_BLOCK, boxNum - begin);
+    // 按块逐行取最大值，每次读取一行中连续的len个值
+    std::copy(cls + begin, cls + begin + len, acc);
+    for (int c = 1; c < classNum; ++c) {
+      const float* row = cls + static_cast<std::size_t>(c) * boxNum + begin;
+      for (int j = mKernels->maxAccumulate(acc, row, len); j < len; ++j)
+        acc[j] = std::max(acc[j], row[j]);
+    }
+    for (int j = 0; j < len; ++j) {
+      if (!(acc[j] > mConfig.minThresh)) continue;
+      const int i = begin + j;
+      auto push = [&](int classId, float score) {
+        float cx = data[i];
+        float cy = data[boxNum + i];
+        float w = data[2 * boxNum + i];
+        float h = data[3 * boxNum + i];
+        mCandidates.push_back(
+            {cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, score, classId});
+      };
+      if (mConfig.multiLabel) {
+        for (int c = 0; c < classNum; ++c) {
+          float score = cls[static_cast<std::size_t>(c) * boxNum + i];
+          if (score > classThresh(c)) push(c, score);
+        }
+        continue;
+      }
+      int classId = 0;
+      while (classId < classNum &&
+             cls[static_cast<std::size_t>(classId) * boxNum + i] != acc[j])
+        ++classId;
+      if (classId < classNum && acc[j] > classThresh(classId))
+        push(classId, acc[j]);
+    }
+  }
+}
+
+void YoloDecoder::decodeGridStride(const float* data, int boxNum, int nout,
+                                   const int* gridX, const int* gridY,
+                                   const int* strides) {
+  const int classNum = nout - 5;
+  mPendingIndex.clear();
+  mPendingClass.clear();
+  mPendingScore.clear();
+  mPendingValues.clear();
+  for (int i = 0; i < boxNum; ++i) {
+    const float* ptr = data + static_cast<std::size_t>(i) * nout;
+    float obj = ptr[4];
+    if (!(obj > mConfig.minThresh)) continue;
+    float maxValue = rowMax(ptr + 5, classNum);
+    float score = obj * maxValue;
+    if (!(score > mConfig.minThresh)) continue;
+    int classId = std::find(ptr + 5, ptr + 5 + classNum, maxValue) - (ptr + 5);
+    if (classId == classNum || !(score > classThresh(classId))) continue;
+    mPendingIndex.push_back(i);
+    mPendingClass.push_back(classId);
+    mPendingScore.push_back(score);
+    mPendingValues.push_back(ptr[2]);
+    mPendingValues.push_back(ptr[3]);
+  }
+  if (mPendingIndex.empty()) return;
+
+  expImpl(*mKernels, mPendingValues.data(), mPendingValues.data(),
+          static_cast<int>(mPendingValues.size()));
+  for (std::size_t k = 0; k < mPendingIndex.size(); ++k) {
+    const int i = mPendingIndex[k];
+    const float* ptr = data + static_cast<std::size_t>(i) * nout;
+    float stride = strides[i];
+    float cx = (ptr[0] + gridX[i]) * stride;
+    float cy = (ptr[1] + gridY[i]) * stride;
+    float w = mPendingValues[2 * k] * stride;
+    float h = mPendingValues[2 * k + 1] * stride;
+    mCandidates.push_back({cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2,
+                           mPendingScore[k], mPendingClass[k]});
+  }
+}
+
+void YoloDecoder::nms(std::vector<YoloDetection>& out) {
+  out.clear();
+  mKept.clear();
+  const int num = static_cast<int>(mCandidates.size());
+  if (num == 0) return;
+
+  mOrder.resize(num);
+  if (mConfig.agnostic) {
+    for (int i = 0; i < num; ++i) mOrder[i] = i;
+    nmsGroup(mOrder.data(), num);
+  } else {
+    // 按类别计数排序，不同类别之间不会互相抑制
+    int groupNum = 0;
+    for (const auto& det : mCandidates)
+      groupNum = std::max(groupNum, det.classId + 1);
+    mGroupCount.assign(groupNum, 0);
+    mGroupOffset.assign(groupNum + 1, 0);
+    for (const auto& det : mCandidates) ++mGroupCount[det.classId];
+    for (int c = 0; c < groupNum; ++c)
+      mGroupOffset[c + 1] = mGroupOffset[c] + mGroupCount[c];
+    for (int i = 0; i < num; ++i)
+      mOrder[mGroupOffset[mCandidates[i].classId]++] = i;
+    for (int c = 0, begin = 0; c < groupNum; ++c) {
+      if (mGroupCount[c] > 0) nmsGroup(mOrder.data() + begin, mGroupCount[c]);
+      begin += mGroupCount[c];
+    }
+  }
+
+  std::sort(mKept.begin(), mKept.end(), [this](int a, int b) {
+    const auto& da = mCandidates[a];
+    const auto& db = mCandidates[b];
+    return da.score > db.score || (da.score == db.score && a < b);
+  });
+  if (mConfig.maxDet > 0 && static_cast<int>(mKept.size()) > mConfig.maxDet)
+    mKept.resize(mConfig.maxDet);
+  out.reserve(mKept.size());
+  for (int index : mKept) out.push_back(mCandidates[index]);
+}
+
+void YoloDecoder::nmsGroup(int* indices, int num) {
+  auto byScore = [this](int a, int b) {
+    const auto& da = mCandidates[a];
+    const auto& db = mCandidates[b];
+    return da.score > db.score || (da.score == db.score && a < b);
+  };
+  int keep = num;
+  if (mConfig.topKPerClass > 0 && num > mConfig.topKPerClass) {
+    keep = mConfig.topKPerClass;
+    std::partial_sort(indices, indices + keep, indices + num, byScore);
+  } else {
+    std::sort(indices, indices + num, byScore);
+  }
+
+  mBoxX1.resize(keep);
+  mBoxY1.resize(keep);
+  mBoxX2.resize(keep);
+  mBoxY2.resize(keep);
+  mBoxArea.resize(keep);
+  for (int i = 0; i < keep; ++i) {
+    const auto& det = mCandidates[indices[i]];
+    mBoxX1[i] = det.x1;
+    mBoxY1[i] = det.y1;
+    mBoxX2[i] = det.x2;
+    mBoxY2[i] = det.y2;
+    mBoxArea[i] = (det.x2 - det.x1) * (det.y2 - det.y1);
+  }
+  mSuppressed.assign(keep, 0);
+  for (int i = 0; i < keep; ++i) {
+    if (mSuppressed[i]) continue;
+    mKept.push_back(indices[i]);
+    NmsBox a{mBoxX1[i], mBoxY1[i], mBoxX2[i], mBoxY2[i], mBoxArea[i]};
+    const int begin = i + 1;
+    const int rest = keep - begin;
+    int done = mKernels->suppress(a, &mBoxX1[begin], &mBoxY1[begin],
+                                  &mBoxX2[begin], &mBoxY2[begin],
+                                  &mBoxArea[begin], rest, mConfig.nmsThresh,
+                                  &mSuppressed[begin]);
+    suppressScalar(a, &mBoxX1[begin], &mBoxY1[begin], &mBoxX2[begin],
+                   &mBoxY2[begin], &mBoxArea[begin], done, rest,
+                   mConfig.nmsThresh, &mSuppressed[begin]);
+  }
+}
+
+void yoloSigmoid(const float* in, float* out, int num) {
+  sigmoidImpl(getKernels(), in, out, num);
+}
+
+void yoloExp(const float* in, float* out, int num) {
+  expImpl(getKernels(), in, out, num);
+}
+
+const char* yoloDecodeBackend() { return getKernels().name; }
+
+}  // namespace element
+}  // namespace sophon_stream
@@ -0,0 +1,195 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_YOLO_DECODE_H_
+#define SOPHON_STREAM_ELEMENT_YOLO_DECODE_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace sophon_stream {
+namespace element {
+
+/**
+ * @brief 解码得到的候选框，坐标为网络输入尺度下的左上、右下角点
+ */
+struct YoloDetection {
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+  float score;
+  int classId;
+};
+
+struct YoloDecodeConfig {
+  /**
+   * @brief 所有类别阈值中的最小值，用于在sigmoid之前提前拒绝
+   */
+  float minThresh = 0.5f;
+  /**
+   * @brief 每个类别的置信度阈值，为空或类别超出范围时使用minThresh
+   */
+  std::vector<float> classThresh;
+  float nmsThresh = 0.5f;
+  /**
+   * @brief 为true时不区分类别做NMS
+   */
+  bool agnostic = false;
+  /**
+   * @brief 为true时一个框中所有超过阈值的类别都作为候选，否则只取最大的类别
+   */
+  bool multiLabel = false;
+  /**
+   * @brief NMS前每个类别最多保留的候选数，<= 0表示不限制
+   */
+  int topKPerClass = 1024;
+  /**
+   * @brief NMS后最多保留的结果数，<= 0表示不限制
+   */
+  int maxDet = 0;
+  /**
+   * @brief 只使用标量实现，用于和SIMD实现对比
+   */
+  bool scalarKernels = false;
+};
+
+/**
+ * @brief 按context中的阈值配置生成YoloDecodeConfig，各yolo算法的context字段一致
+ */
+template <typename Context>
+YoloDecodeConfig makeYoloDecodeConfig(Context& context) {
+  YoloDecodeConfig config;
+  config.minThresh = context.thresh_conf_min;
+  config.nmsThresh = context.thresh_nms;
+  if (context.class_thresh_valid) {
+    config.classThresh.reserve(context.class_names.size());
+    for (const auto& name : context.class_names)
+      config.classThresh.push_back(context.thresh_conf[name]);
+  }
+  return config;
+}
+
+struct YoloDecodeKernels;
+
+/**
+ * @brief yolo系列CPU后处理共用的解码和NMS
+ * @details
+ * 1. 扫描阶段只读取判定所需的值：先用objectness（或类别最大值）和minThresh比较，
+ *    logits输出在logit空间比较，不计算sigmoid；类别最大值用SIMD求取；
+ * 2. 通过扫描的少量候选集中起来，用向量化的exp/sigmoid批量解码框和分数；
+ * 3. NMS按类别分组，组内按分数排序并保留前topKPerClass个，
+ *    贪心抑制时用SIMD一次计算一个框与其余所有框的IoU。
+ * 对象持有所有中间缓冲区，一个线程使用一个对象，逐帧调用clear()复用。
+ */
+class YoloDecoder {
+ public:
+  explicit YoloDecoder(const YoloDecodeConfig& config);
+
+  /**
+   * @brief 清空候选框，开始处理新的一帧
+   */
+  void clear();
+
+  /**
+   * @brief yolov5/yolov7未解码的5维输出中的一层，[anchor][h][w][5 + class]，全部是logits
+   * @param anchors 这一层每个anchor的{w, h}
+   */
+  void decodeAnchorGrid(const float* data, int featH, int featW, int nout,
+                        const std::vector<std::vector<int>>& anchors,
+                        int netW, int netH);
+
+  /**
+   * @brief 已解码的行优先输出[box][nout]，前4个值是cx, cy, w, h
+   * @param objectness 为true时第5个值是objectness，类别分数从第6个值开始
+   */
+  void decodeRows(const float* data, int boxNum, int nout, bool objectness);
+
+  /**
+   * @brief 已解码的列优先输出[nout][box]（yolov8），前4行是cx, cy, w, h，之后是类别分数
+   */
+  void decodeColumns(const float* data, int boxNum, int nout);
+
+  /**
+   * @brief yolox输出[box][5 + class]，中心为(v + grid) * stride，宽高为exp(v) * stride
+   */
+  void decodeGridStride(const float* data, int boxNum, int nout,
+                        const int* gridX, const int* gridY,
+                        const int* strides);
+
+  /**
+   * @brief 通过阈值的候选框，调用方可以在NMS前修改坐标或删除元素
+   */
+  std::vector<YoloDetection>& candidates() { return mCandidates; }
+
+  /**
+   * @brief 对候选框做NMS，结果按分数从高到低写入out
+   */
+  void nms(std::vector<YoloDetection>& out);
+
+ private:
+  float classThresh(int classId) const {
+    return classId < static_cast<int>(mConfig.classThresh.size())
+               ? mConfig.classThresh[classId]
+               : mConfig.minThresh;
+  }
+
+  /**
+   * @brief 连续存放的num个值中的最大值
+   */
+  float rowMax(const float* values, int num) const;
+
+  /**
+   * @brief 对一个类别（agnostic时为全部）的候选做排序、top-k和贪心抑制
+   */
+  void nmsGroup(int* indices, int num);
+
+  YoloDecodeConfig mConfig;
+  const YoloDecodeKernels* mKernels;
+  std::vector<YoloDetection> mCandidates;
+
+  // 扫描阶段通过的候选：原始数据中的位置、类别、分数以及待批量变换的值
+  std::vector<int> mPendingIndex;
+  std::vector<int> mPendingClass;
+  std::vector<float> mPendingScore;
+  std::vector<float> mPendingValues;
+  std::vector<float> mMaxBuffer;
+
+  // NMS工作区
+  std::vector<int> mOrder;
+  std::vector<int> mGroupCount;
+  std::vector<int> mGroupOffset;
+  std::vector<float> mBoxX1;
+  std::vector<float> mBoxY1;
+  std::vector<float> mBoxX2;
+  std::vector<float> mBoxY2;
+  std::vector<float> mBoxArea;
+  std::vector<uint8_t> mSuppressed;
+  std::vector<int> mKept;
+};
+
+/**
+ * @brief 批量计算out[i] = 1 / (1 + exp(-in[i]))，in和out可以是同一数组
+ */
+void yoloSigmoid(const float* in, float* out, int num);
+
+/**
+ * @brief 批量计算out[i] = exp(in[i])，in和out可以是同一数组
+ */
+void yoloExp(const float* in, float* out, int num);
+
+/**
+ * @brief 当前使用的实现："avx2"、"sse2"、"neon"或"scalar"
+ */
+const char* yoloDecodeBackend();
+
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_YOLO_DECODE_H_
@@ -10,6 +10,8 @@
 #ifndef SOPHON_STREAM_ELEMENT_BYTETRACK_H_
 #define SOPHON_STREAM_ELEMENT_BYTETRACK_H_
 
+#include <unordered_map>
+
 #include "bytetrack_bytetracker.h"
 
 namespace sophon_stream {
@@ -40,15 +42,44 @@ class Bytetrack : public ::sophon_stream::framework::Element {
       "correct_box";
   static constexpr const char* CONFIG_INTERNAL_AGNOSTIC_FIELD =
       "agnostic";
+  static constexpr const char* CONFIG_INTERNAL_BATCH_MODE_FIELD = "batch_mode";
+  static constexpr const char* CONFIG_INTERNAL_MAX_BATCH_FIELD = "max_batch";
 
  private:
   std::shared_ptr<BytetrackContext> mContext;  // context对象
 
   std::map<int, std::shared_ptr<BYTETracker>> mByteTrackerMap;
 
+  /**
+   * @brief 批量模式下一个dataPipe的状态，只由该dataPipe的doWork访问
+   */
+  struct BatchWorker {
+    /**
+     * @brief key为mChannelIdInternal，收到该路的结束帧时删除
+     */
+    std::unordered_map<int, std::shared_ptr<BYTETracker>> trackers;
+    KalmanFilter kalmanFilter;
+    KalmanBatch predictBatch;
+    KalmanBatch updateBatch;
+    common::ObjectMetadatas pending;
+    /**
+     * @brief pending中每帧是所在路的第几帧
+     */
+    std::vector<int> frameRounds;
+    std::unordered_map<int, int> channelFrames;
+    /**
+     * @brief 本轮参与跟踪的tracker及其帧在pending中的下标
+     */
+    std::vector<std::pair<BYTETracker*, int>> round;
+  };
+
+  std::map<int, std::shared_ptr<BatchWorker>> mBatchWorkerMap;
+
   common::ErrorCode initContext(const std::string& json);
   void process(int dataPipeId,
                std::shared_ptr<common::ObjectMetadata>& objectMetadata);
+  common::ErrorCode doWorkBatch(int dataPipeId);
+  void processBatch(BatchWorker& worker);
 };
 
 }  // namespace bytetrack
@@ -0,0 +1,120 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_BYTETRACK_ASSOCIATION_H_
+#define SOPHON_STREAM_ELEMENT_BYTETRACK_ASSOCIATION_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace sophon_stream {
+namespace element {
+namespace bytetrack {
+
+/**
+ * @brief 按列存放的tlbr框，轨迹和检测在关联前打包到这里，供IoU内核连续读取
+ */
+struct TlbrBoxes {
+  std::vector<float> x1;
+  std::vector<float> y1;
+  std::vector<float> x2;
+  std::vector<float> y2;
+  /**
+   * @brief (x2 - x1 + 1) * (y2 - y1 + 1)，与原实现的面积计算一致
+   */
+  std::vector<float> area;
+
+  std::size_t size() const { return x1.size(); }
+
+  /**
+   * @brief 清空但保留容量，逐帧复用
+   */
+  void clear();
+
+  void push_back(float left, float top, float right, float bottom);
+};
+
+/**
+ * @brief 计算IoU距离矩阵 cost[i * b.size() + j] = 1 - IoU(a[i], b[j])
+ * @details 按CPU选择AVX/SSE2/NEON实现，cost按行连续存放，容量逐帧复用
+ */
+void iouDistanceMatrix(const TlbrBoxes& a, const TlbrBoxes& b,
+                       std::vector<float>& cost);
+
+/**
+ * @brief 逐元素的标量实现，作为SIMD实现的参照
+ */
+void iouDistanceMatrixScalar(const TlbrBoxes& a, const TlbrBoxes& b,
+                             std::vector<float>& cost);
+
+/**
+ * @brief 当前IoU内核使用的实现："avx"、"sse2"、"neon"或"scalar"
+ */
+const char* iouKernelBackend();
+
+/**
+ * @brief 带门限的矩形线性分配
+ * @details
+ * 与原来把rows x cols矩阵扩展成(rows + cols)方阵、填充thresh / 2后调用lapjv的结果等价：
+ * 只有cost < thresh的元素能形成匹配，因此先按这些元素把行和列划分为互不相连的连通分量，
+ * 孤立的行列直接判为未匹配，只有一条边的分量直接匹配，其余分量各自扩展成小方阵后
+ * 用Jonker-Volgenant最短增广路求解。拥挤场景中分量通常只有几个目标，
+ * 代价远小于对整个扩展方阵求解。所有中间缓冲区都是成员，跨帧复用，稳定后不再分配内存。
+ */
+class SparseLapjv {
+ public:
+  /**
+   * @brief 求解分配，三个输出数组先清空再写入
+   * @param cost rows x cols，按行连续存放
+   * @param[out] matches (行, 列)，按行号递增
+   * @param[out] unmatchedRows 按行号递增
+   * @param[out] unmatchedCols 按列号递增
+   */
+  void solve(const float* cost, int rows, int cols, float thresh,
+             std::vector<std::pair<int, int>>& matches,
+             std::vector<int>& unmatchedRows, std::vector<int>& unmatchedCols);
+
+ private:
+  int findRoot(int node);
+
+  void solveComponent(const float* cost, int cols, float thresh);
+
+  void solveDense(int n);
+
+  // 连通分量
+  std::vector<int> mParent;
+  std::vector<int> mComponentCount;
+  std::vector<int> mComponentOffset;
+  std::vector<int> mComponentNodes;
+  std::vector<int> mComponentRows;
+  std::vector<int> mComponentCols;
+
+  // 原矩阵上的结果
+  std::vector<int> mRowSolution;
+  std::vector<int> mColSolution;
+
+  // 分量的扩展方阵及最短增广路的工作区
+  std::vector<float> mDense;
+  std::vector<double> mRowPotential;
+  std::vector<double> mColPotential;
+  std::vector<double> mShortest;
+  std::vector<int> mPath;
+  std::vector<int> mColForRow;
+  std::vector<int> mRowForCol;
+  std::vector<int> mRemaining;
+  std::vector<char> mRowVisited;
+  std::vector<char> mColVisited;
+};
+
+}  // namespace bytetrack
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_BYTETRACK_ASSOCIATION_H_
@@ -10,9 +10,11 @@
 #ifndef SOPHON_STREAM_ELEMENT_BYTETRACK_BYTETRACKER_H_
 #define SOPHON_STREAM_ELEMENT_BYTETRACK_BYTETRACKER_H_
 
-#include <opencv2/opencv.hpp>
+#include <map>
+#include <memory>
+#include <vector>
 
-#include "bytetrack_lapjv.h"
+#include "bytetrack_association.h"
 #include "bytetrack_strack.h"
 #include "common/error_code.h"
 #include "common/object_metadata.h"
@@ -32,6 +34,14 @@ struct BytetrackContext {
   int minBoxArea;
   bool correctBox;
   bool agnostic;
+  /**
+   * @brief 每个线程批量处理所负责的多路码流，每路一个BYTETracker
+   */
+  bool batchMode;
+  /**
+   * @brief 批量模式下每次doWork最多取出的帧数，为0时与输入队列的容量相同
+   */
+  int maxBatch;
 };
 
 class BYTETracker {
@@ -41,6 +51,18 @@ class BYTETracker {
 
   void update(std::shared_ptr<common::ObjectMetadata>& objects);
 
+  /**
+   * @brief update()拆分成的三个阶段，供多路批量跟踪使用：
+   * begin_update把需要预测的轨迹加入predict_batch，associate把需要校正的轨迹加入update_batch，
+   * 调用者在阶段之间对多路合并后的batch执行一次KalmanFilter::predict/update
+   */
+  void begin_update(std::shared_ptr<common::ObjectMetadata>& objects,
+                    KalmanBatch& predict_batch);
+
+  void associate(KalmanBatch& update_batch);
+
+  void end_update(std::shared_ptr<common::ObjectMetadata>& objects);
+
  private:
   void joint_stracks(STracks& tlista, STracks& tlistb, STracks& results);
 
@@ -49,23 +71,17 @@ class BYTETracker {
   void remove_duplicate_stracks(STracks& resa, STracks& resb, STracks& stracksa,
                                 STracks& stracksb);
 
-  void linear_assignment(std::vector<std::vector<float>>& cost_matrix,
-                         int cost_matrix_size, int cost_matrix_size_size,
-                         float thresh, std::vector<std::vector<int>>& matches,
+  void linear_assignment(const std::vector<float>& cost_matrix, int rows,
+                         int cols, float thresh,
+                         std::vector<std::pair<int, int>>& matches,
                          std::vector<int>& unmatched_a,
                          std::vector<int>& unmatched_b);
 
+  /**
+   * @brief 计算按行连续存放的IoU距离矩阵，atracks.size() x btracks.size()
+   */
   void iou_distance(const STracks& atracks, const STracks& btracks,
-                    std::vector<std::vector<float>>& cost_matrix);
-
-  void ious(std::vector<std::vector<float>>& atlbrs,
-            std::vector<std::vector<float>>& btlbrs,
-            std::vector<std::vector<float>>& results);
-
-  void lapjv(const std::vector<std::vector<float>>& cost,
-             std::vector<int>& rowsol, std::vector<int>& colsol,
-             bool extend_cost = false, float cost_limit = LONG_MAX,
-             bool return_cost = true);
+                    std::vector<float>& cost_matrix);
 
  private:
   float track_thresh;
@@ -85,6 +101,30 @@ class BYTETracker {
   STracks removed_stracks;
 
   std::shared_ptr<KalmanFilter> kalman_filter;
+  KalmanBatch predict_batch;
+  KalmanBatch update_batch;
+
+  // 一帧内跨阶段的轨迹列表，end_update结束时清空
+  STracks detections;
+  STracks detections_low;
+  STracks unconfirmed;
+  STracks strack_pool;
+  STracks activated_stracks;
+  STracks refind_stracks;
+  STracks temp_lost_stracks;
+  STracks update_stracks;
+
+  // 关联过程的缓冲区，逐帧复用
+  TlbrBoxes atlbrs;
+  TlbrBoxes btlbrs;
+  SparseLapjv lapjv_solver;
+  std::vector<float> dists;
+  std::vector<std::pair<int, int>> matches;
+  std::vector<int> u_track;
+  std::vector<int> u_detection;
+  std::vector<int> u_unconfirmed;
+  std::vector<char> dupa;
+  std::vector<char> dupb;
 };
 
 }  // namespace bytetrack
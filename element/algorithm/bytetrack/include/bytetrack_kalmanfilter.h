@@ -10,30 +10,68 @@
 #ifndef SOPHON_STREAM_ELEMENT_BYTETRACK_KALMANFILTER_H_
 #define SOPHON_STREAM_ELEMENT_BYTETRACK_KALMANFILTER_H_
 
+#include <array>
 #include <cstddef>
-#include <opencv2/opencv.hpp>
+#include <vector>
 
 namespace sophon_stream {
 namespace element {
 namespace bytetrack {
 
+/**
+ * @brief 一条轨迹的卡尔曼滤波状态，状态为(x, y, a, h, vx, vy, va, vh)
+ */
+struct KalmanState {
+  float mean[8];
+  /**
+   * @brief 8x8协方差矩阵，按行存放
+   */
+  float covariance[64];
+};
+
+/**
+ * @brief 一次批量预测或校正的轨迹列表，measurements为(x, y, a, h)，只在校正时使用
+ */
+struct KalmanBatch {
+  std::vector<KalmanState*> states;
+  std::vector<std::array<float, 4>> measurements;
+
+  void clear() {
+    states.clear();
+    measurements.clear();
+  }
+  std::size_t size() const { return states.size(); }
+  bool empty() const { return states.empty(); }
+};
+
+/**
+ * @brief 匀速模型的卡尔曼滤波，predict/update对一批轨迹统一计算
+ * @details
+ * 计算前把各轨迹的状态按8条一组转置到packed数组中，每组用一组8路向量指令同时计算，
+ * 结果再写回各轨迹。S = HPH' + R的求逆用LDL'分解，不需要开方。
+ * 与原先逐条调用cv::KalmanFilter的公式一致，结果只有浮点舍入上的差别。
+ */
 class KalmanFilter {
  public:
-  static const double chi2inv95[10];
   KalmanFilter();
   ~KalmanFilter();
-  std::pair<cv::Mat, cv::Mat> initiate(const cv::Mat& measurement);
-  std::pair<cv::Mat, cv::Mat> predict(const cv::Mat& mean,
-                                      const cv::Mat& covariance);
-  std::pair<cv::Mat, cv::Mat> update(const cv::Mat& mean,
-                                     const cv::Mat& covariance,
-                                     const cv::Mat& measurement);
-  cv::Mat gating_distance(const cv::Mat& mean, const cv::Mat& covariance,
-                          const std::vector<cv::Mat>& measurements,
-                          bool only_position = false);
+
+  void initiate(const float measurement[4], KalmanState& state) const;
+
+  void predict(const KalmanBatch& batch);
+
+  void update(const KalmanBatch& batch);
 
  private:
-  std::unique_ptr<cv::KalmanFilter> opencv_kf;
+  struct Block;
+
+  void gather(const KalmanBatch& batch, bool withMeasurement);
+  void scatter(const KalmanBatch& batch);
+
+  /**
+   * @brief packed状态数组，每个Block保存8条轨迹，跨帧复用
+   */
+  std::vector<Block> blocks;
   float _std_weight_position;
   float _std_weight_velocity;
 };
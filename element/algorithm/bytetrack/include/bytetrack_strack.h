@@ -10,6 +10,8 @@
 #ifndef SOPHON_STREAM_ELEMENT_BYTETRACK_STRACK_H_
 #define SOPHON_STREAM_ELEMENT_BYTETRACK_STRACK_H_
 
+#include <memory>
+
 #include "bytetrack_kalmanfilter.h"
 
 namespace sophon_stream {
@@ -24,8 +26,11 @@ class STrack {
   ~STrack();
 
   std::vector<float> static tlbr_to_tlwh(std::vector<float>& tlbr);
+  /**
+   * @brief 把stracks加入predict_batch，由调用者统一执行KalmanFilter::predict
+   */
   void static multi_predict(std::vector<std::shared_ptr<STrack>>& stracks,
-                            std::shared_ptr<KalmanFilter> kalman_filter);
+                            KalmanBatch& predict_batch);
   void static_tlwh();
   void static_tlbr();
   std::vector<float> tlwh_to_xyah(std::vector<float> tlwh_tmp);
@@ -36,13 +41,16 @@ class STrack {
   int end_frame();
 
   void activate(std::shared_ptr<KalmanFilter> kalman_filter, int frame_id);
-  void re_activate(std::shared_ptr<KalmanFilter> kalman_filter,
-                   std::shared_ptr<STrack> new_track, int frame_id,
-                   bool correct_box, bool new_id = false);
-  void update(std::shared_ptr<KalmanFilter> kalman_filter,
-              std::shared_ptr<STrack> new_track, int frame_id, bool correct_box);
-  void kalman_correct_box(std::shared_ptr<KalmanFilter> kalman_filter,
-                   std::shared_ptr<STrack> new_track, bool correct_box);
+  /**
+   * @brief correct_box为true时把观测加入update_batch，
+   * 调用者执行KalmanFilter::update后需调用static_tlwh()和static_tlbr()更新框
+   */
+  void re_activate(KalmanBatch& update_batch, std::shared_ptr<STrack> new_track,
+                   int frame_id, bool correct_box, bool new_id = false);
+  void update(KalmanBatch& update_batch, std::shared_ptr<STrack> new_track,
+              int frame_id, bool correct_box);
+  void kalman_correct_box(KalmanBatch& update_batch,
+                          std::shared_ptr<STrack> new_track, bool correct_box);
 
  public:
   bool is_activated;
@@ -56,8 +64,7 @@ class STrack {
   int tracklet_len;
   int start_frame;
 
-  cv::Mat mean;
-  cv::Mat covariance;
+  KalmanState kalman;
   float score;
   int class_id;
 };
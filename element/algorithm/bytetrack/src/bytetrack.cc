@@ -9,6 +9,7 @@
 
 #include "bytetrack.h"
 
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
 #include "common/logger.h"
@@ -67,12 +68,29 @@ common::ErrorCode Bytetrack::initContext(const std::string& json) {
     mContext->agnostic =
         agnosticIt != configure.end() ? agnosticIt->get<bool>() : true;
 
+    auto batchModeIt = configure.find(CONFIG_INTERNAL_BATCH_MODE_FIELD);
+    mContext->batchMode =
+        batchModeIt != configure.end() ? batchModeIt->get<bool>() : false;
+
+    auto maxBatchIt = configure.find(CONFIG_INTERNAL_MAX_BATCH_FIELD);
+    mContext->maxBatch =
+        maxBatchIt != configure.end() ? maxBatchIt->get<int>() : 0;
+    if (mContext->maxBatch < 0) {
+      IVS_WARN(
+          "Bytetrack::initContext: invalid max_batch {0}, use the input "
+          "queue capacity",
+          mContext->maxBatch);
+      mContext->maxBatch = 0;
+    }
+
     IVS_DEBUG(
         "Bytetrack::initContext: frameRate: {0}, trackBuffer: {1}, "
         "trackThresh: {2}, "
-        "highThresh: {3}, matchThresh: {4}, correctBox: {5}, agnostic: {6}",
+        "highThresh: {3}, matchThresh: {4}, correctBox: {5}, agnostic: {6}, "
+        "batchMode: {7}, maxBatch: {8}",
         mContext->frameRate, mContext->trackBuffer, mContext->trackThresh,
-        mContext->highThresh, mContext->matchThresh, mContext->correctBox, mContext->agnostic);
+        mContext->highThresh, mContext->matchThresh, mContext->correctBox,
+        mContext->agnostic, mContext->batchMode, mContext->maxBatch);
 
   } while (false);
 
@@ -99,9 +117,12 @@ common::ErrorCode Bytetrack::initInternal(const std::string& json) {
 
     IVS_DEBUG("Bytetrack threadNumber: {0}", threadNumber);
 
-    // 初始化 tracker
+    // 初始化 tracker，批量模式下每路的tracker在收到第一帧时创建
     for (int t = 0; t < threadNumber; ++t) {
-      mByteTrackerMap[t] = std::make_shared<BYTETracker>(mContext);
+      if (mContext->batchMode)
+        mBatchWorkerMap[t] = std::make_shared<BatchWorker>();
+      else
+        mByteTrackerMap[t] = std::make_shared<BYTETracker>(mContext);
     }
 
   } while (false);
@@ -126,10 +147,117 @@ void Bytetrack::process(
   }
 }
 
+/**
+ * 批量跟踪，第r轮处理每路的第r帧：
+ * 先对本轮所有路的轨迹统一做一次卡尔曼预测，各路分别做关联后，再统一做一次卡尔曼校正。
+ * 同一路的帧分在相邻的轮次中依次处理，保证每路按到达顺序跟踪
+ */
+void Bytetrack::processBatch(BatchWorker& worker) {
+  worker.frameRounds.resize(worker.pending.size());
+  worker.channelFrames.clear();
+  int rounds = 0;
+  for (std::size_t i = 0; i < worker.pending.size(); ++i) {
+    int channel = worker.pending[i]->mFrame->mChannelIdInternal;
+    worker.frameRounds[i] = worker.channelFrames[channel]++;
+    rounds = std::max(rounds, worker.frameRounds[i] + 1);
+  }
+
+  for (int r = 0; r < rounds; ++r) {
+    worker.round.clear();
+    for (std::size_t i = 0; i < worker.pending.size(); ++i) {
+      auto& obj = worker.pending[i];
+      if (worker.frameRounds[i] != r || obj->mFilter) continue;
+      int channel = obj->mFrame->mChannelIdInternal;
+      if (obj->mFrame->mEndOfStream) {
+        worker.trackers.erase(channel);
+        continue;
+      }
+      auto& tracker = worker.trackers[channel];
+      if (!tracker) tracker = std::make_shared<BYTETracker>(mContext);
+      worker.round.emplace_back(tracker.get(), i);
+    }
+    if (worker.round.empty()) continue;
+
+    worker.predictBatch.clear();
+    for (auto& job : worker.round)
+      job.first->begin_update(worker.pending[job.second], worker.predictBatch);
+    worker.kalmanFilter.predict(worker.predictBatch);
+
+    worker.updateBatch.clear();
+    for (auto& job : worker.round) job.first->associate(worker.updateBatch);
+    worker.kalmanFilter.update(worker.updateBatch);
+
+    for (auto& job : worker.round)
+      job.first->end_update(worker.pending[job.second]);
+  }
+}
+
+common::ErrorCode Bytetrack::doWorkBatch(int dataPipeId) {
+  common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
+
+  int inputPort = getInputPorts()[0];
+  int outputPort = getSinkElementFlag() ? 0 : getOutputPorts()[0];
+
+  auto workerIt = mBatchWorkerMap.find(dataPipeId);
+  if (mBatchWorkerMap.end() == workerIt) {
+    IVS_WARN("empty batch worker for dataPipeId : {0}", dataPipeId);
+    return errorCode;
+  }
+  BatchWorker& worker = *workerIt->second;
+
+  // 等到第一帧后，取出队列中已有的帧，不再等待，最多取maxBatch帧。
+  // 上游持续推送时队列不会变空，不限制数量会一直取下去而不输出结果
+  worker.pending.clear();
+  std::shared_ptr<void> data;
+  while (getThreadStatus() == ThreadStatus::RUN) {
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+    if (data || !shouldWaitInputData()) break;
+  }
+  std::size_t maxBatch = static_cast<std::size_t>(mContext->maxBatch);
+  if (data && 0 == maxBatch) {
+    // 未配置时与这条连接的队列容量相同，容量按连接配置
+    auto connector = getInputConnector(inputPort).lock();
+    maxBatch = connector
+                   ? connector->getDataPipe(dataPipeId)->getConfig().capacity
+                   : DEFAULT_DATA_PIPE_CAPACITY;
+  }
+  while (data) {
+    worker.pending.push_back(
+        std::static_pointer_cast<common::ObjectMetadata>(data));
+    if (worker.pending.size() >= maxBatch) break;
+    data = popInputData(inputPort, dataPipeId);
+  }
+  if (worker.pending.empty()) return errorCode;
+
+  processBatch(worker);
+
+  for (auto& obj : worker.pending) {
+    int channel_id_internal = obj->mFrame->mChannelIdInternal;
+    int pipeId =
+        getSinkElementFlag()
+            ? 0
+            : (channel_id_internal % getOutputConnectorCapacity(outputPort));
+
+    errorCode =
+        pushOutputData(outputPort, pipeId, std::static_pointer_cast<void>(obj));
+    if (common::ErrorCode::SUCCESS != errorCode) {
+      IVS_WARN(
+          "Send data fail, element id: {0:d}, output port: {1:d}, data: "
+          "{2:p}",
+          getId(), outputPort, static_cast<void*>(obj.get()));
+    }
+  }
+  worker.pending.clear();
+
+  return common::ErrorCode::SUCCESS;
+}
+
 /**
   运行
 */
 common::ErrorCode Bytetrack::doWork(int dataPipeId) {
+  if (mContext->batchMode) return doWorkBatch(dataPipeId);
+
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
 
   std::vector<int> inputPorts = getInputPorts();
@@ -150,10 +278,10 @@ common::ErrorCode Bytetrack::doWork(int dataPipeId) {
   std::shared_ptr<common::ObjectMetadata> objectMetadata = nullptr;
 
   while (getThreadStatus() == ThreadStatus::RUN) {
-    auto data = popInputData(inputPort, dataPipeId);
+    auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
     if (!data) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
+      if (shouldWaitInputData()) continue;
+      break;
     }
     objectMetadata = std::static_pointer_cast<common::ObjectMetadata>(data);
     pendingObjectMetadatas.push_back(objectMetadata);
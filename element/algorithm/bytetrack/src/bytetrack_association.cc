@@ -0,0 +1,404 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "bytetrack_association.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STREAM_BYTETRACK_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STREAM_BYTETRACK_NEON 1
+#endif
+
+namespace sophon_stream {
+namespace element {
+namespace bytetrack {
+
+void TlbrBoxes::clear() {
+  x1.clear();
+  y1.clear();
+  x2.clear();
+  y2.clear();
+  area.clear();
+}
+
+void TlbrBoxes::push_back(float left, float top, float right, float bottom) {
+  x1.push_back(left);
+  y1.push_back(top);
+  x2.push_back(right);
+  y2.push_back(bottom);
+  area.push_back((right - left + 1) * (bottom - top + 1));
+}
+
+namespace {
+
+/**
+ * @brief a中一个框的坐标和面积
+ */
+struct RowBox {
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+  float area;
+};
+
+/**
+ * @brief 计算一行中前若干列，返回已处理的列数，剩余的列由标量代码完成
+ */
+using IouRowKernel = std::size_t (*)(const RowBox& a, const TlbrBoxes& b,
+                                     float* out);
+
+void iouRowScalar(const RowBox& a, const TlbrBoxes& b, std::size_t begin,
+                  float* out) {
+  for (std::size_t j = begin; j < b.size(); ++j) {
+    float iw = std::min(a.x2, b.x2[j]) - std::max(a.x1, b.x1[j]) + 1;
+    float ih = std::min(a.y2, b.y2[j]) - std::max(a.y1, b.y1[j]) + 1;
+    float iou = 0;
+    if (iw > 0 && ih > 0) {
+      float inter = iw * ih;
+      iou = inter / (a.area + b.area[j] - inter);
+    }
+    out[j] = 1 - iou;
+  }
+}
+
+std::size_t iouRowNone(const RowBox&, const TlbrBoxes&, float*) { return 0; }
+
+#if STREAM_BYTETRACK_X86
+
+std::size_t iouRowSse2(const RowBox& a, const TlbrBoxes& b, float* out) {
+  const __m128 ax1 = _mm_set1_ps(a.x1);
+  const __m128 ay1 = _mm_set1_ps(a.y1);
+  const __m128 ax2 = _mm_set1_ps(a.x2);
+  const __m128 ay2 = _mm_set1_ps(a.y2);
+  const __m128 aarea = _mm_set1_ps(a.area);
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 zero = _mm_setzero_ps();
+  std::size_t n = b.size() / 4 * 4;
+  for (std::size_t j = 0; j < n; j += 4) {
+    __m128 iw = _mm_add_ps(_mm_sub_ps(_mm_min_ps(ax2, _mm_loadu_ps(&b.x2[j])),
+                                      _mm_max_ps(ax1, _mm_loadu_ps(&b.x1[j]))),
+                           one);
+    __m128 ih = _mm_add_ps(_mm_sub_ps(_mm_min_ps(ay2, _mm_loadu_ps(&b.y2[j])),
+                                      _mm_max_ps(ay1, _mm_loadu_ps(&b.y1[j]))),
+                           one);
+    __m128 valid = _mm_and_ps(_mm_cmpgt_ps(iw, zero), _mm_cmpgt_ps(ih, zero));
+    __m128 inter = _mm_mul_ps(iw, ih);
+    __m128 ua =
+        _mm_sub_ps(_mm_add_ps(aarea, _mm_loadu_ps(&b.area[j])), inter);
+    __m128 iou = _mm_and_ps(valid, _mm_div_ps(inter, ua));
+    _mm_storeu_ps(out + j, _mm_sub_ps(one, iou));
+  }
+  return n;
+}
+
+__attribute__((target("avx"))) std::size_t iouRowAvx(const RowBox& a,
+                                                      const TlbrBoxes& b,
+                                                      float* out) {
+  const __m256 ax1 = _mm256_set1_ps(a.x1);
+  const __m256 ay1 = _mm256_set1_ps(a.y1);
+  const __m256 ax2 = _mm256_set1_ps(a.x2);
+  const __m256 ay2 = _mm256_set1_ps(a.y2);
+  const __m256 aarea = _mm256_set1_ps(a.area);
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 zero = _mm256_setzero_ps();
+  std::size_t n = b.size() / 8 * 8;
+  for (std::size_t j = 0; j < n; j += 8) {
+    __m256 iw = _mm256_add_ps(
+        _mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(&b.x2[j])),
+                      _mm256_max_ps(ax1, _mm256_loadu_ps(&b.x1[j]))),
+        one);
+    __m256 ih = _mm256_add_ps(
+        _mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(&b.y2[j])),
+                      _mm256_max_ps(ay1, _mm256_loadu_ps(&b.y1[j]))),
+        one);
+    __m256 valid = _mm256_and_ps(_mm256_cmp_ps(iw, zero, _CMP_GT_OQ),
+                                 _mm256_cmp_ps(ih, zero, _CMP_GT_OQ));
+    __m256 inter = _mm256_mul_ps(iw, ih);
+    __m256 ua = _mm256_sub_ps(
+        _mm256_add_ps(aarea, _mm256_loadu_ps(&b.area[j])), inter);
+    __m256 iou = _mm256_and_ps(valid, _mm256_div_ps(inter, ua));
+    _mm256_storeu_ps(out + j, _mm256_sub_ps(one, iou));
+  }
+  return n;
+}
+
+#endif  // STREAM_BYTETRACK_X86
+
+#if STREAM_BYTETRACK_NEON
+
+std::size_t iouRowNeon(const RowBox& a, const TlbrBoxes& b, float* out) {
+  const float32x4_t ax1 = vdupq_n_f32(a.x1);
+  const float32x4_t ay1 = vdupq_n_f32(a.y1);
+  const float32x4_t ax2 = vdupq_n_f32(a.x2);
+  const float32x4_t ay2 = vdupq_n_f32(a.y2);
+  const float32x4_t aarea = vdupq_n_f32(a.area);
+  const float32x4_t one = vdupq_n_f32(1.f);
+  const float32x4_t zero = vdupq_n_f32(0.f);
+  std::size_t n = b.size() / 4 * 4;
+  for (std::size_t j = 0; j < n; j += 4) {
+    float32x4_t iw = vaddq_f32(vsubq_f32(vminq_f32(ax2, vld1q_f32(&b.x2[j])),
+                                         vmaxq_f32(ax1, vld1q_f32(&b.x1[j]))),
+                               one);
+    float32x4_t ih = vaddq_f32(vsubq_f32(vminq_f32(ay2, vld1q_f32(&b.y2[j])),
+                                         vmaxq_f32(ay1, vld1q_f32(&b.y1[j]))),
+                               one);
+    uint32x4_t valid = vandq_u32(vcgtq_f32(iw, zero), vcgtq_f32(ih, zero));
+    float32x4_t inter = vmulq_f32(iw, ih);
+    float32x4_t ua =
+        vsubq_f32(vaddq_f32(aarea, vld1q_f32(&b.area[j])), inter);
+    float32x4_t iou = vreinterpretq_f32_u32(
+        vandq_u32(valid, vreinterpretq_u32_f32(vdivq_f32(inter, ua))));
+    vst1q_f32(out + j, vsubq_f32(one, iou));
+  }
+  return n;
+}
+
+#endif  // STREAM_BYTETRACK_NEON
+
+struct IouImpl {
+  const char* name;
+  IouRowKernel row;
+};
+
+IouImpl selectImpl() {
+#if STREAM_BYTETRACK_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx")) return {"avx", iouRowAvx};
+  return {"sse2", iouRowSse2};
+#elif STREAM_BYTETRACK_NEON
+  return {"neon", iouRowNeon};
+#endif
+  return {"scalar", iouRowNone};
+}
+
+const IouImpl& getImpl() {
+  static const IouImpl impl = selectImpl();
+  return impl;
+}
+
+template <typename Kernel>
+void iouDistanceMatrixImpl(const TlbrBoxes& a, const TlbrBoxes& b,
+                           std::vector<float>& cost, Kernel kernel) {
+  cost.resize(a.size() * b.size());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    RowBox box{a.x1[i], a.y1[i], a.x2[i], a.y2[i], a.area[i]};
+    float* out = cost.data() + i * b.size();
+    iouRowScalar(box, b, kernel(box, b, out), out);
+  }
+}
+
+}  // namespace
+
+void iouDistanceMatrix(const TlbrBoxes& a, const TlbrBoxes& b,
+                       std::vector<float>& cost) {
+  iouDistanceMatrixImpl(a, b, cost, getImpl().row);
+}
+
+void iouDistanceMatrixScalar(const TlbrBoxes& a, const TlbrBoxes& b,
+                             std::vector<float>& cost) {
+  iouDistanceMatrixImpl(a, b, cost, iouRowNone);
+}
+
+const char* iouKernelBackend() { return getImpl().name; }
+
+void SparseLapjv::solve(const float* cost, int rows, int cols, float thresh,
+                        std::vector<std::pair<int, int>>& matches,
+                        std::vector<int>& unmatchedRows,
+                        std::vector<int>& unmatchedCols) {
+  matches.clear();
+  unmatchedRows.clear();
+  unmatchedCols.clear();
+  mRowSolution.assign(rows, -1);
+  mColSolution.assign(cols, -1);
+
+  if (rows > 0 && cols > 0) {
+    // 行为节点[0, rows)，列为节点[rows, rows + cols)，cost < thresh的元素为边
+    int nodes = rows + cols;
+    mParent.resize(nodes);
+    for (int i = 0; i < nodes; ++i) mParent[i] = i;
+    for (int i = 0; i < rows; ++i) {
+      const float* row = cost + static_cast<std::size_t>(i) * cols;
+      for (int j = 0; j < cols; ++j) {
+        if (row[j] >= thresh) continue;
+        int ra = findRoot(i);
+        int rb = findRoot(rows + j);
+        if (ra != rb) mParent[rb] = ra;
+      }
+    }
+
+    // 按根节点计数排序，每个分量内的节点按编号递增，行在前列在后
+    mComponentCount.assign(nodes, 0);
+    for (int i = 0; i < nodes; ++i) {
+      mParent[i] = findRoot(i);
+      ++mComponentCount[mParent[i]];
+    }
+    mComponentOffset.resize(nodes + 1);
+    mComponentOffset[0] = 0;
+    for (int i = 0; i < nodes; ++i)
+      mComponentOffset[i + 1] = mComponentOffset[i] + mComponentCount[i];
+    std::copy(mComponentOffset.begin(), mComponentOffset.end() - 1,
+              mComponentCount.begin());
+    mComponentNodes.resize(nodes);
+    for (int i = 0; i < nodes; ++i)
+      mComponentNodes[mComponentCount[mParent[i]]++] = i;
+
+    for (int root = 0; root < nodes; ++root) {
+      int begin = mComponentOffset[root];
+      int end = mComponentOffset[root + 1];
+      if (end - begin < 2) continue;
+      mComponentRows.clear();
+      mComponentCols.clear();
+      for (int k = begin; k < end; ++k) {
+        int node = mComponentNodes[k];
+        if (node < rows)
+          mComponentRows.push_back(node);
+        else
+          mComponentCols.push_back(node - rows);
+      }
+      if (mComponentRows.size() == 1 && mComponentCols.size() == 1) {
+        mRowSolution[mComponentRows[0]] = mComponentCols[0];
+        mColSolution[mComponentCols[0]] = mComponentRows[0];
+        continue;
+      }
+      solveComponent(cost, cols, thresh);
+    }
+  }
+
+  for (int i = 0; i < rows; ++i) {
+    if (mRowSolution[i] >= 0)
+      matches.emplace_back(i, mRowSolution[i]);
+    else
+      unmatchedRows.push_back(i);
+  }
+  for (int j = 0; j < cols; ++j) {
+    if (mColSolution[j] < 0) unmatchedCols.push_back(j);
+  }
+}
+
+int SparseLapjv::findRoot(int node) {
+  while (mParent[node] != node) {
+    mParent[node] = mParent[mParent[node]];
+    node = mParent[node];
+  }
+  return node;
+}
+
+void SparseLapjv::solveComponent(const float* cost, int cols, float thresh) {
+  // 与原实现相同的扩展：行或列与哑元配对的代价为thresh / 2，哑元之间为0
+  int p = mComponentRows.size();
+  int q = mComponentCols.size();
+  int n = p + q;
+  float half = thresh / 2.0;
+  mDense.resize(static_cast<std::size_t>(n) * n);
+  for (int i = 0; i < n; ++i) {
+    float* dense = mDense.data() + static_cast<std::size_t>(i) * n;
+    if (i < p) {
+      const float* row =
+          cost + static_cast<std::size_t>(mComponentRows[i]) * cols;
+      for (int j = 0; j < q; ++j) dense[j] = row[mComponentCols[j]];
+      std::fill(dense + q, dense + n, half);
+    } else {
+      std::fill(dense, dense + q, half);
+      std::fill(dense + q, dense + n, 0.f);
+    }
+  }
+
+  solveDense(n);
+
+  for (int i = 0; i < p; ++i) {
+    int j = mColForRow[i];
+    if (j < q) {
+      mRowSolution[mComponentRows[i]] = mComponentCols[j];
+      mColSolution[mComponentCols[j]] = mComponentRows[i];
+    }
+  }
+}
+
+void SparseLapjv::solveDense(int n) {
+  // Jonker-Volgenant最短增广路：每次从一个空闲行出发，
+  // 用对偶变量化简后的代价做Dijkstra，找到最近的空闲列后沿路径增广
+  const double inf = std::numeric_limits<double>::infinity();
+  mRowPotential.assign(n, 0);
+  mColPotential.assign(n, 0);
+  mShortest.resize(n);
+  mPath.resize(n);
+  mColForRow.assign(n, -1);
+  mRowForCol.assign(n, -1);
+  mRemaining.resize(n);
+  mRowVisited.resize(n);
+  mColVisited.resize(n);
+
+  for (int curRow = 0; curRow < n; ++curRow) {
+    std::fill(mShortest.begin(), mShortest.end(), inf);
+    std::fill(mRowVisited.begin(), mRowVisited.end(), 0);
+    std::fill(mColVisited.begin(), mColVisited.end(), 0);
+    // 倒序存放，与拿到最后一个空闲列时的选择顺序一致
+    for (int k = 0; k < n; ++k) mRemaining[k] = n - k - 1;
+    int numRemaining = n;
+
+    double minVal = 0;
+    int i = curRow;
+    int sink = -1;
+    while (sink == -1) {
+      mRowVisited[i] = 1;
+      const float* row = mDense.data() + static_cast<std::size_t>(i) * n;
+      int index = -1;
+      double lowest = inf;
+      for (int k = 0; k < numRemaining; ++k) {
+        int j = mRemaining[k];
+        double reduced =
+            minVal + row[j] - mRowPotential[i] - mColPotential[j];
+        if (reduced < mShortest[j]) {
+          mPath[j] = i;
+          mShortest[j] = reduced;
+        }
+        if (mShortest[j] < lowest ||
+            (mShortest[j] == lowest && mRowForCol[j] == -1)) {
+          lowest = mShortest[j];
+          index = k;
+        }
+      }
+      minVal = lowest;
+      int j = mRemaining[index];
+      if (mRowForCol[j] == -1)
+        sink = j;
+      else
+        i = mRowForCol[j];
+      mColVisited[j] = 1;
+      mRemaining[index] = mRemaining[--numRemaining];
+    }
+
+    mRowPotential[curRow] += minVal;
+    for (int r = 0; r < n; ++r) {
+      if (mRowVisited[r] && r != curRow)
+        mRowPotential[r] += minVal - mShortest[mColForRow[r]];
+    }
+    for (int c = 0; c < n; ++c) {
+      if (mColVisited[c]) mColPotential[c] -= minVal - mShortest[c];
+    }
+
+    int j = sink;
+    while (true) {
+      int r = mPath[j];
+      mRowForCol[j] = r;
+      std::swap(mColForRow[r], j);
+      if (r == curRow) break;
+    }
+  }
+}
+
+}  // namespace bytetrack
+}  // namespace element
+}  // namespace sophon_stream
@@ -10,6 +10,9 @@
 #include "bytetrack_bytetracker.h"
 
 #include <fstream>
+
+#include "common/object_pool.h"
+
 namespace sophon_stream {
 namespace element {
 namespace bytetrack {
@@ -32,21 +35,20 @@ BYTETracker::BYTETracker(const std::shared_ptr<BytetrackContext> mContext) {
 BYTETracker::~BYTETracker() {}
 
 void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
+  predict_batch.clear();
+  begin_update(objects, predict_batch);
+  this->kalman_filter->predict(predict_batch);
+  update_batch.clear();
+  associate(update_batch);
+  this->kalman_filter->update(update_batch);
+  end_update(objects);
+}
+
+void BYTETracker::begin_update(std::shared_ptr<common::ObjectMetadata>& objects,
+                               KalmanBatch& predict_batch) {
   ////////////////// Step 1: Get detections //////////////////
   this->frame_id++;
-  STracks activated_stracks;
-  STracks refind_stracks;
-  STracks detections;
-  STracks detections_low;
-  STracks detections_cp;
-  STracks tracked_stracks_swap;
-  STracks resa, resb;
   STracks temp_tracked_stracks;
-  STracks temp_lost_stracks;
-  STracks unconfirmed;
-  STracks strack_pool;
-  STracks r_tracked_stracks;
-  STracks output_stracks;
 
   if (objects->mDetectedObjectMetadatas.size() > 0) {
     for (auto subObj : objects->mDetectedObjectMetadatas) {
@@ -85,27 +87,28 @@ void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
   }
   ////////////////// Step 2: First association, with IoU //////////////////
   joint_stracks(temp_tracked_stracks, this->lost_stracks, strack_pool);
-  STrack::multi_predict(strack_pool, this->kalman_filter);
+  STrack::multi_predict(strack_pool, predict_batch);
+}
 
-  std::vector<std::vector<float>> dists;
-  int dist_size = strack_pool.size(), dist_size_size = detections.size();
-  iou_distance(strack_pool, detections, dists);
+void BYTETracker::associate(KalmanBatch& update_batch) {
+  STracks detections_cp;
+  STracks r_tracked_stracks;
 
-  std::vector<std::vector<int>> matches;
-  std::vector<int> u_track, u_detection;
-  linear_assignment(dists, dist_size, dist_size_size, match_thresh, matches,
-                    u_track, u_detection);
+  iou_distance(strack_pool, detections, dists);
+  linear_assignment(dists, strack_pool.size(), detections.size(), match_thresh,
+                    matches, u_track, u_detection);
   for (int i = 0; i < matches.size(); i++) {
-    std::shared_ptr<STrack> track = strack_pool[matches[i][0]];
-    std::shared_ptr<STrack> det = detections[matches[i][1]];
+    std::shared_ptr<STrack> track = strack_pool[matches[i].first];
+    std::shared_ptr<STrack> det = detections[matches[i].second];
     if (track->state == TrackState::Tracked) {
-      track->update(this->kalman_filter, det, this->frame_id,
-                    this->correct_box);
+      track->update(update_batch, det, this->frame_id, this->correct_box);
       activated_stracks.push_back(track);
+      update_stracks.push_back(track);
     } else {
-      track->re_activate(this->kalman_filter, det, this->frame_id,
-                         this->correct_box, false);
+      track->re_activate(update_batch, det, this->frame_id, this->correct_box,
+                         false);
       refind_stracks.push_back(track);
+      update_stracks.push_back(track);
     }
   }
   ////////////////// Step 3: Second association, using low score dets
@@ -122,28 +125,22 @@ void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
     }
   }
 
-  dists.clear();
   iou_distance(r_tracked_stracks, detections, dists);
-  dist_size = r_tracked_stracks.size();
-  dist_size_size = detections.size();
-
-  matches.clear();
-  u_track.clear();
-  u_detection.clear();
-  linear_assignment(dists, dist_size, dist_size_size, 0.5, matches, u_track,
-                    u_detection);
+  linear_assignment(dists, r_tracked_stracks.size(), detections.size(), 0.5,
+                    matches, u_track, u_detection);
 
   for (int i = 0; i < matches.size(); i++) {
-    std::shared_ptr<STrack> track = r_tracked_stracks[matches[i][0]];
-    std::shared_ptr<STrack> det = detections[matches[i][1]];
+    std::shared_ptr<STrack> track = r_tracked_stracks[matches[i].first];
+    std::shared_ptr<STrack> det = detections[matches[i].second];
     if (track->state == TrackState::Tracked) {
-      track->update(this->kalman_filter, det, this->frame_id,
-                    this->correct_box);
+      track->update(update_batch, det, this->frame_id, this->correct_box);
       activated_stracks.push_back(track);
+      update_stracks.push_back(track);
     } else {
-      track->re_activate(this->kalman_filter, det, this->frame_id,
-                         this->correct_box, false);
+      track->re_activate(update_batch, det, this->frame_id, this->correct_box,
+                         false);
       refind_stracks.push_back(track);
+      update_stracks.push_back(track);
     }
   }
 
@@ -159,22 +156,16 @@ void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
   detections.clear();
   detections.assign(detections_cp.begin(), detections_cp.end());
 
-  dists.clear();
   iou_distance(unconfirmed, detections, dists);
-  dist_size = unconfirmed.size();
-  dist_size_size = detections.size();
-
-  matches.clear();
-  std::vector<int> u_unconfirmed;
-  u_detection.clear();
-  linear_assignment(dists, dist_size, dist_size_size, 0.7, matches,
+  linear_assignment(dists, unconfirmed.size(), detections.size(), 0.7, matches,
                     u_unconfirmed, u_detection);
 
   for (int i = 0; i < matches.size(); i++) {
-    unconfirmed[matches[i][0]]->update(this->kalman_filter,
-                                       detections[matches[i][1]],
-                                       this->frame_id, this->correct_box);
-    activated_stracks.push_back(unconfirmed[matches[i][0]]);
+    unconfirmed[matches[i].first]->update(update_batch,
+                                          detections[matches[i].second],
+                                          this->frame_id, this->correct_box);
+    activated_stracks.push_back(unconfirmed[matches[i].first]);
+    update_stracks.push_back(unconfirmed[matches[i].first]);
   }
 
   for (int i = 0; i < u_unconfirmed.size(); i++) {
@@ -189,6 +180,20 @@ void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
     track->activate(this->kalman_filter, this->frame_id);
     activated_stracks.push_back(track);
   }
+}
+
+void BYTETracker::end_update(std::shared_ptr<common::ObjectMetadata>& objects) {
+  STracks tracked_stracks_swap;
+  STracks resa, resb;
+  STracks output_stracks;
+
+  // 校正后的卡尔曼状态已由调用者写回，据此更新这些轨迹的框
+  if (this->correct_box) {
+    for (int i = 0; i < update_stracks.size(); i++) {
+      update_stracks[i]->static_tlwh();
+      update_stracks[i]->static_tlbr();
+    }
+  }
   ////////////////// Step 5: Update state //////////////////
   for (int i = 0; i < this->lost_stracks.size(); i++) {
     if (this->frame_id - this->lost_stracks[i]->end_frame() >
@@ -236,12 +241,10 @@ void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
   objects->mDetectedObjectMetadatas.clear();
   objects->mTrackedObjectMetadatas.clear();
   for (auto track_box : output_stracks) {
-    std::shared_ptr<common::ObjectMetadata> subOutputMetaData =
-        std::make_shared<common::ObjectMetadata>();
     std::shared_ptr<common::DetectedObjectMetadata> mDetectedObjectMetadata =
-        std::make_shared<common::DetectedObjectMetadata>();
+        common::makePooled<common::DetectedObjectMetadata>();
     std::shared_ptr<common::TrackedObjectMetadata> mTrackedObjectMetadata =
-        std::make_shared<common::TrackedObjectMetadata>();
+        common::makePooled<common::TrackedObjectMetadata>();
 
     mDetectedObjectMetadata->mBox.mX =
         track_box->tlwh[0] < 0 ? 0 : track_box->tlwh[0];
@@ -272,6 +275,16 @@ void BYTETracker::update(std::shared_ptr<common::ObjectMetadata>& objects) {
     objects->mDetectedObjectMetadatas.push_back(mDetectedObjectMetadata);
     objects->mTrackedObjectMetadatas.push_back(mTrackedObjectMetadata);
   }
+
+  // 释放本帧的检测和中间结果
+  detections.clear();
+  detections_low.clear();
+  unconfirmed.clear();
+  strack_pool.clear();
+  activated_stracks.clear();
+  refind_stracks.clear();
+  temp_lost_stracks.clear();
+  update_stracks.clear();
 }
 
 void BYTETracker::joint_stracks(STracks& tlista, STracks& tlistb,
@@ -314,253 +327,52 @@ void BYTETracker::sub_stracks(STracks& tlista, STracks& tlistb) {
 void BYTETracker::remove_duplicate_stracks(STracks& resa, STracks& resb,
                                            STracks& stracksa,
                                            STracks& stracksb) {
-  std::vector<std::vector<float>> pdist;
-  iou_distance(stracksa, stracksb, pdist);
-  std::vector<std::pair<int, int>> pairs;
-  for (int i = 0; i < pdist.size(); i++) {
-    for (int j = 0; j < pdist[i].size(); j++) {
-      if (pdist[i][j] < 0.15) {
-        pairs.push_back(std::pair<int, int>(i, j));
-      }
+  iou_distance(stracksa, stracksb, dists);
+  dupa.assign(stracksa.size(), 0);
+  dupb.assign(stracksb.size(), 0);
+  for (int i = 0; i < stracksa.size(); i++) {
+    const float* pdist = dists.data() + i * stracksb.size();
+    for (int j = 0; j < stracksb.size(); j++) {
+      if (pdist[j] >= 0.15) continue;
+      int timep = stracksa[i]->frame_id - stracksa[i]->start_frame;
+      int timeq = stracksb[j]->frame_id - stracksb[j]->start_frame;
+      if (timep > timeq)
+        dupb[j] = 1;
+      else
+        dupa[i] = 1;
     }
   }
 
-  std::vector<int> dupa, dupb;
-  for (int i = 0; i < pairs.size(); i++) {
-    int timep = stracksa[pairs[i].first]->frame_id -
-                stracksa[pairs[i].first]->start_frame;
-    int timeq = stracksb[pairs[i].second]->frame_id -
-                stracksb[pairs[i].second]->start_frame;
-    if (timep > timeq)
-      dupb.push_back(pairs[i].second);
-    else
-      dupa.push_back(pairs[i].first);
-  }
-
   for (int i = 0; i < stracksa.size(); i++) {
-    std::vector<int>::iterator iter = find(dupa.begin(), dupa.end(), i);
-    if (iter == dupa.end()) {
-      resa.push_back(stracksa[i]);
-    }
+    if (!dupa[i]) resa.push_back(stracksa[i]);
   }
-
   for (int i = 0; i < stracksb.size(); i++) {
-    std::vector<int>::iterator iter = find(dupb.begin(), dupb.end(), i);
-    if (iter == dupb.end()) {
-      resb.push_back(stracksb[i]);
-    }
+    if (!dupb[i]) resb.push_back(stracksb[i]);
   }
 }
 
-void BYTETracker::linear_assignment(
-    std::vector<std::vector<float>>& cost_matrix, int cost_matrix_size,
-    int cost_matrix_size_size, float thresh,
-    std::vector<std::vector<int>>& matches, std::vector<int>& unmatched_a,
-    std::vector<int>& unmatched_b) {
-  if (cost_matrix.size() == 0) {
-    for (int i = 0; i < cost_matrix_size; i++) {
-      unmatched_a.push_back(i);
-    }
-    for (int i = 0; i < cost_matrix_size_size; i++) {
-      unmatched_b.push_back(i);
-    }
-    return;
-  }
-  std::vector<int> rowsol;
-  std::vector<int> colsol;
-  lapjv(cost_matrix, rowsol, colsol, true, thresh);
-  for (int i = 0; i < rowsol.size(); i++) {
-    if (rowsol[i] >= 0) {
-      std::vector<int> match;
-      match.push_back(i);
-      match.push_back(rowsol[i]);
-      matches.push_back(match);
-    } else {
-      unmatched_a.push_back(i);
-    }
-  }
-  for (int i = 0; i < colsol.size(); i++) {
-    if (colsol[i] < 0) {
-      unmatched_b.push_back(i);
-    }
-  }
-}
-
-void BYTETracker::ious(std::vector<std::vector<float>>& atlbrs,
-                       std::vector<std::vector<float>>& btlbrs,
-                       std::vector<std::vector<float>>& results) {
-  if (atlbrs.size() * btlbrs.size() == 0) return;
-
-  results.resize(atlbrs.size());
-  for (int i = 0; i < results.size(); i++) {
-    results[i].resize(btlbrs.size());
-  }
-
-  // bbox_ious
-  for (int k = 0; k < btlbrs.size(); k++) {
-    std::vector<float> ious_tmp;
-    float box_area =
-        (btlbrs[k][2] - btlbrs[k][0] + 1) * (btlbrs[k][3] - btlbrs[k][1] + 1);
-    for (int n = 0; n < atlbrs.size(); n++) {
-      float iw = std::min(atlbrs[n][2], btlbrs[k][2]) -
-                 std::max(atlbrs[n][0], btlbrs[k][0]) + 1;
-      if (iw > 0) {
-        float ih = std::min(atlbrs[n][3], btlbrs[k][3]) -
-                   std::max(atlbrs[n][1], btlbrs[k][1]) + 1;
-        if (ih > 0) {
-          float ua = (atlbrs[n][2] - atlbrs[n][0] + 1) *
-                         (atlbrs[n][3] - atlbrs[n][1] + 1) +
-                     box_area - iw * ih;
-          results[n][k] = iw * ih / ua;
-        } else {
-          results[n][k] = 0.0;
-        }
-      } else {
-        results[n][k] = 0.0;
-      }
-    }
-  }
+void BYTETracker::linear_assignment(const std::vector<float>& cost_matrix,
+                                    int rows, int cols, float thresh,
+                                    std::vector<std::pair<int, int>>& matches,
+                                    std::vector<int>& unmatched_a,
+                                    std::vector<int>& unmatched_b) {
+  lapjv_solver.solve(cost_matrix.data(), rows, cols, thresh, matches,
+                     unmatched_a, unmatched_b);
 }
 
 void BYTETracker::iou_distance(const STracks& atracks, const STracks& btracks,
-                               std::vector<std::vector<float>>& cost_matrix) {
-  if (atracks.size() * btracks.size() == 0) return;
-
-  std::vector<std::vector<float>> atlbrs, btlbrs;
+                               std::vector<float>& cost_matrix) {
+  atlbrs.clear();
+  btlbrs.clear();
   for (int i = 0; i < atracks.size(); i++) {
-    atlbrs.push_back(atracks[i]->tlbr);
+    const std::vector<float>& tlbr = atracks[i]->tlbr;
+    atlbrs.push_back(tlbr[0], tlbr[1], tlbr[2], tlbr[3]);
   }
   for (int i = 0; i < btracks.size(); i++) {
-    btlbrs.push_back(btracks[i]->tlbr);
-  }
-
-  std::vector<std::vector<float>> _ious;
-  ious(atlbrs, btlbrs, _ious);
-  for (int i = 0; i < _ious.size(); i++) {
-    std::vector<float> _iou;
-    for (int j = 0; j < _ious[i].size(); j++) {
-      _iou.push_back(1 - _ious[i][j]);
-    }
-    cost_matrix.push_back(_iou);
-  }
-}
-
-void BYTETracker::lapjv(const std::vector<std::vector<float>>& cost,
-                        std::vector<int>& rowsol, std::vector<int>& colsol,
-                        bool extend_cost, float cost_limit, bool return_cost) {
-  std::vector<std::vector<float>> cost_c;
-  cost_c.assign(cost.begin(), cost.end());
-
-  std::vector<std::vector<float>> cost_c_extended;
-
-  int n_rows = cost.size();
-  int n_cols = cost[0].size();
-  rowsol.resize(n_rows);
-  colsol.resize(n_cols);
-
-  int n = 0;
-  if (n_rows == n_cols) {
-    n = n_rows;
-  } else {
-    if (!extend_cost) {
-      std::cout << "set extend_cost=True" << std::endl;
-      system("pause");
-      exit(0);
-    }
-  }
-  if (extend_cost || cost_limit < LONG_MAX) {
-    n = n_rows + n_cols;
-    cost_c_extended.resize(n);
-
-    for (int i = 0; i < cost_c_extended.size(); i++)
-      cost_c_extended[i].resize(n);
-
-    if (cost_limit < LONG_MAX) {
-      for (int i = 0; i < cost_c_extended.size(); i++) {
-        for (int j = 0; j < cost_c_extended[i].size(); j++) {
-          cost_c_extended[i][j] = cost_limit / 2.0;
-        }
-      }
-    } else {
-      float cost_max = -1;
-      for (int i = 0; i < cost_c.size(); i++) {
-        for (int j = 0; j < cost_c[i].size(); j++) {
-          if (cost_c[i][j] > cost_max) cost_max = cost_c[i][j];
-        }
-      }
-      for (int i = 0; i < cost_c_extended.size(); i++) {
-        for (int j = 0; j < cost_c_extended[i].size(); j++) {
-          cost_c_extended[i][j] = cost_max + 1;
-        }
-      }
-    }
-    for (int i = n_rows; i < cost_c_extended.size(); i++) {
-      for (int j = n_cols; j < cost_c_extended[i].size(); j++) {
-        cost_c_extended[i][j] = 0;
-      }
-    }
-    for (int i = 0; i < n_rows; i++) {
-      for (int j = 0; j < n_cols; j++) {
-        cost_c_extended[i][j] = cost_c[i][j];
-      }
-    }
-
-    cost_c.clear();
-    cost_c.assign(cost_c_extended.begin(), cost_c_extended.end());
-  }
-  double** cost_ptr;
-  cost_ptr = new double*[sizeof(double*) * n];
-  for (int i = 0; i < n; i++) cost_ptr[i] = new double[sizeof(double) * n];
-
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      cost_ptr[i][j] = cost_c[i][j];
-    }
-  }
-
-  int* x_c = new int[sizeof(int) * n];
-  int* y_c = new int[sizeof(int) * n];
-
-  int ret = lapjv_internal(n, cost_ptr, x_c, y_c);
-  if (ret != 0) {
-    std::cout << "Calculate Wrong!" << std::endl;
-    system("pause");
-    exit(0);
-  }
-
-  double opt = 0.0;
-  if (n != n_rows) {
-    for (int i = 0; i < n; i++) {
-      if (x_c[i] >= n_cols) x_c[i] = -1;
-      if (y_c[i] >= n_rows) y_c[i] = -1;
-    }
-    for (int i = 0; i < n_rows; i++) {
-      rowsol[i] = x_c[i];
-    }
-    for (int i = 0; i < n_cols; i++) {
-      colsol[i] = y_c[i];
-    }
-
-    if (return_cost) {
-      for (int i = 0; i < rowsol.size(); i++) {
-        if (rowsol[i] != -1) {
-          // cout << i << "\t" << rowsol[i] << "\t" << cost_ptr[i][rowsol[i]] <<
-          // endl;
-          opt += cost_ptr[i][rowsol[i]];
-        }
-      }
-    }
-  } else if (return_cost) {
-    for (int i = 0; i < rowsol.size(); i++) {
-      opt += cost_ptr[i][rowsol[i]];
-    }
-  }
-  for (int i = 0; i < n; i++) {
-    delete[] cost_ptr[i];
+    const std::vector<float>& tlbr = btracks[i]->tlbr;
+    btlbrs.push_back(tlbr[0], tlbr[1], tlbr[2], tlbr[3]);
   }
-  delete[] cost_ptr;
-  delete[] x_c;
-  delete[] y_c;
+  iouDistanceMatrix(atlbrs, btlbrs, cost_matrix);
 }
 
 }  // namespace bytetrack
@@ -9,150 +9,217 @@
 
 #include "bytetrack_kalmanfilter.h"
 
+#include <cstring>
+
 namespace sophon_stream {
 namespace element {
 namespace bytetrack {
 
-void Cholesky(const cv::Mat& A, cv::Mat& S) {
-  S = A.clone();
-  cv::Cholesky((float*)S.ptr(), S.step, S.rows, NULL, 0, 0);
-  S = S.t();
-  for (int i = 1; i < S.rows; i++) {
-    for (int j = 0; j < i; j++) {
-      S.at<float>(i, j) = 0;
-    }
+namespace {
+
+constexpr int LANES = 8;
+
+/**
+ * @brief 8条轨迹的同一个分量，x86上编译为SSE/AVX指令，aarch64上编译为NEON指令
+ */
+typedef float Lanes __attribute__((vector_size(LANES * sizeof(float))));
+
+/**
+ * @brief 补齐最后一组时使用的状态，h = 1且协方差为单位阵，保证计算中不出现除0
+ */
+const KalmanState PADDING_STATE = [] {
+  KalmanState state{};
+  state.mean[2] = 1;
+  state.mean[3] = 1;
+  for (int i = 0; i < 8; ++i) state.covariance[i * 8 + i] = 1;
+  return state;
+}();
+
+const std::array<float, 4> PADDING_MEASUREMENT = {0, 0, 1, 1};
+
+/**
+ * @brief 解 S x = b，S = L D L'，L为单位下三角
+ */
+struct Ldl4 {
+  Lanes l10, l20, l30, l21, l31, l32;
+  Lanes d0, d1, d2, d3;
+
+  void solve(Lanes& b0, Lanes& b1, Lanes& b2, Lanes& b3) const {
+    b1 = b1 - l10 * b0;
+    b2 = b2 - l20 * b0 - l21 * b1;
+    b3 = b3 - l30 * b0 - l31 * b1 - l32 * b2;
+    b0 = b0 / d0;
+    b1 = b1 / d1;
+    b2 = b2 / d2;
+    b3 = b3 / d3;
+    b2 = b2 - l32 * b3;
+    b1 = b1 - l21 * b2 - l31 * b3;
+    b0 = b0 - l10 * b1 - l20 * b2 - l30 * b3;
   }
-}
+};
+
+}  // namespace
 
-// sisyphus
-const double KalmanFilter::chi2inv95[10] = {
-    0, 3.8415, 5.9915, 7.8147, 9.4877, 11.070, 12.592, 14.067, 15.507, 16.919};
+struct KalmanFilter::Block {
+  Lanes mean[8];
+  Lanes covariance[8][8];
+  Lanes measurement[4];
+};
 
 KalmanFilter::KalmanFilter() {
   this->_std_weight_position = 1. / 20;
   this->_std_weight_velocity = 1. / 160;
-
-  opencv_kf = std::make_unique<cv::KalmanFilter>(8, 4);
-  // 设置状态转移矩阵
-  opencv_kf->transitionMatrix =
-      (cv::Mat_<float>(8, 8) << 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0,
-       0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0,
-       0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1);
-
-  // 设置测量矩阵
-  opencv_kf->measurementMatrix =
-      (cv::Mat_<float>(4, 8) << 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0,
-       0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0);
 }
 
 KalmanFilter::~KalmanFilter() {}
 
-std::pair<cv::Mat, cv::Mat> KalmanFilter::initiate(const cv::Mat& measurement) {
-  cv::Mat mean_pos = measurement.clone();
-  cv::Mat mean_vel = cv::Mat::zeros(1, 4, CV_32F);
+void KalmanFilter::initiate(const float measurement[4],
+                            KalmanState& state) const {
+  float std[8];
+  std[0] = 2 * _std_weight_position * measurement[3];
+  std[1] = 2 * _std_weight_position * measurement[3];
+  std[2] = 1e-2;
+  std[3] = 2 * _std_weight_position * measurement[3];
+  std[4] = 10 * _std_weight_velocity * measurement[3];
+  std[5] = 10 * _std_weight_velocity * measurement[3];
+  std[6] = 1e-5;
+  std[7] = 10 * _std_weight_velocity * measurement[3];
 
-  cv::Mat mean(1, 8, CV_32F);
   for (int i = 0; i != 4; i++) {
-    mean.at<float>(0, i) = mean_pos.at<float>(0, i);
-    mean.at<float>(0, i + 4) = mean_vel.at<float>(0, i);
+    state.mean[i] = measurement[i];
+    state.mean[i + 4] = 0;
   }
-
-  cv::Mat std(1, 8, CV_32F);
-  std.at<float>(0) = 2 * _std_weight_position * measurement.at<float>(0, 3);
-  std.at<float>(1) = 2 * _std_weight_position * measurement.at<float>(0, 3);
-  std.at<float>(2) = 1e-2;
-  std.at<float>(3) = 2 * _std_weight_position * measurement.at<float>(0, 3);
-  std.at<float>(4) = 10 * _std_weight_velocity * measurement.at<float>(0, 3);
-  std.at<float>(5) = 10 * _std_weight_velocity * measurement.at<float>(0, 3);
-  std.at<float>(6) = 1e-5;
-  std.at<float>(7) = 10 * _std_weight_velocity * measurement.at<float>(0, 3);
-
-  cv::Mat tmp = std.mul(std);
-  cv::Mat var = cv::Mat::diag(tmp);
-
-  return std::make_pair(mean, var);
-}
-
-std::pair<cv::Mat, cv::Mat> KalmanFilter::predict(const cv::Mat& mean,
-                                                  const cv::Mat& covariance) {
-  float std_pos = _std_weight_position * mean.at<float>(3) *
-                  _std_weight_position * mean.at<float>(3);
-  float std_vel = _std_weight_velocity * mean.at<float>(3) *
-                  _std_weight_velocity * mean.at<float>(3);
-  opencv_kf->processNoiseCov =
-      (cv::Mat_<float>(8, 8) << std_pos, 0, 0, 0, 0, 0, 0, 0, 0, std_pos, 0, 0,
-       0, 0, 0, 0, 0, 0, 1e-4, 0, 0, 0, 0, 0, 0, 0, 0, std_pos, 0, 0, 0, 0, 0,
-       0, 0, 0, std_vel, 0, 0, 0, 0, 0, 0, 0, 0, std_vel, 0, 0, 0, 0, 0, 0, 0,
-       0, 1e-10, 0, 0, 0, 0, 0, 0, 0, 0, std_vel);
-  opencv_kf->statePost = mean.t();
-  opencv_kf->errorCovPost = covariance;
-
-  opencv_kf->predict();
-
-  return std::make_pair(opencv_kf->statePost.t(), opencv_kf->errorCovPost);
+  std::memset(state.covariance, 0, sizeof(state.covariance));
+  for (int i = 0; i != 8; i++) state.covariance[i * 8 + i] = std[i] * std[i];
 }
 
-std::pair<cv::Mat, cv::Mat> KalmanFilter::update(const cv::Mat& mean,
-                                                 const cv::Mat& covariance,
-                                                 const cv::Mat& measurement) {
-  opencv_kf->statePre = mean.t();
-  opencv_kf->errorCovPre = covariance;
-  float std_pos = _std_weight_position * mean.at<float>(3) *
-                  _std_weight_position * mean.at<float>(3);
-  opencv_kf->measurementNoiseCov =
-      (cv::Mat_<float>(4, 4) << std_pos, 0, 0, 0, 0, std_pos, 0, 0, 0, 0, 1e-2,
-       0, 0, 0, 0, std_pos);
-
-  opencv_kf->correct(measurement.t());
-
-  return std::make_pair(opencv_kf->statePost.t(), opencv_kf->errorCovPost);
+void KalmanFilter::gather(const KalmanBatch& batch, bool withMeasurement) {
+  blocks.resize((batch.size() + LANES - 1) / LANES);
+  for (std::size_t b = 0; b < blocks.size(); ++b) {
+    Block& block = blocks[b];
+    for (int l = 0; l < LANES; ++l) {
+      std::size_t k = b * LANES + l;
+      const KalmanState& state =
+          k < batch.size() ? *batch.states[k] : PADDING_STATE;
+      for (int i = 0; i < 8; ++i) {
+        block.mean[i][l] = state.mean[i];
+        for (int j = 0; j < 8; ++j)
+          block.covariance[i][j][l] = state.covariance[i * 8 + j];
+      }
+      if (withMeasurement) {
+        const std::array<float, 4>& z =
+            k < batch.size() ? batch.measurements[k] : PADDING_MEASUREMENT;
+        for (int i = 0; i < 4; ++i) block.measurement[i][l] = z[i];
+      }
+    }
+  }
 }
 
-cv::Mat KalmanFilter::gating_distance(const cv::Mat& mean,
-                                      const cv::Mat& covariance,
-                                      const std::vector<cv::Mat>& measurements,
-                                      bool only_position) {
-  if (only_position) {
-    printf("not implement!");
-    exit(0);
+void KalmanFilter::scatter(const KalmanBatch& batch) {
+  for (std::size_t k = 0; k < batch.size(); ++k) {
+    const Block& block = blocks[k / LANES];
+    int l = k % LANES;
+    KalmanState& state = *batch.states[k];
+    for (int i = 0; i < 8; ++i) {
+      state.mean[i] = block.mean[i][l];
+      for (int j = 0; j < 8; ++j)
+        state.covariance[i * 8 + j] = block.covariance[i][j][l];
+    }
   }
+}
 
-  cv::Mat std(1, 4, CV_32F);
-  std.at<float>(0) = _std_weight_position * mean.at<float>(3);
-  std.at<float>(1) = _std_weight_position * mean.at<float>(3);
-  std.at<float>(2) = 1e-1;
-  std.at<float>(3) = _std_weight_position * mean.at<float>(3);
-
-  cv::Mat mean1 = opencv_kf->measurementMatrix * mean.t();
-  cv::Mat covariance1 = opencv_kf->measurementMatrix * covariance *
-                        opencv_kf->measurementMatrix.t();
-
-  cv::Mat diag = cv::Mat::zeros(4, 4, CV_32F);
-  diag.at<float>(0, 0) = std.at<float>(0) * std.at<float>(0);
-  diag.at<float>(1, 1) = std.at<float>(1) * std.at<float>(1);
-  diag.at<float>(2, 2) = std.at<float>(2) * std.at<float>(2);
-  diag.at<float>(3, 3) = std.at<float>(3) * std.at<float>(3);
-
-  covariance1 += diag;
-
-  cv::Mat d(measurements.size(), 4, CV_32F);
-  int pos = 0;
-  for (const auto& box : measurements) {
-    cv::Mat diff = box - mean1.t();
-    diff.copyTo(d.row(pos++));
+void KalmanFilter::predict(const KalmanBatch& batch) {
+  if (batch.empty()) return;
+  gather(batch, false);
+  for (Block& block : blocks) {
+    Lanes* m = block.mean;
+    Lanes(*P)[8] = block.covariance;
+    Lanes std_pos = _std_weight_position * m[3] * _std_weight_position * m[3];
+    Lanes std_vel = _std_weight_velocity * m[3] * _std_weight_velocity * m[3];
+
+    // x' = F x，F = [I I; 0 I]
+    for (int i = 0; i < 4; ++i) m[i] = m[i] + m[i + 4];
+
+    // P' = F P F' + Q，只计算上三角再对称复制
+    Lanes FP[8][8];
+    for (int i = 0; i < 8; ++i) {
+      for (int j = 0; j < 8; ++j)
+        FP[i][j] = i < 4 ? P[i][j] + P[i + 4][j] : P[i][j];
+    }
+    for (int i = 0; i < 8; ++i) {
+      for (int j = i; j < 8; ++j)
+        P[i][j] = j < 4 ? FP[i][j] + FP[i][j + 4] : FP[i][j];
+    }
+    P[0][0] += std_pos;
+    P[1][1] += std_pos;
+    P[2][2] += 1e-4f;
+    P[3][3] += std_pos;
+    P[4][4] += std_vel;
+    P[5][5] += std_vel;
+    P[6][6] += 1e-10f;
+    P[7][7] += std_vel;
+    for (int i = 1; i < 8; ++i) {
+      for (int j = 0; j < i; ++j) P[i][j] = P[j][i];
+    }
   }
+  scatter(batch);
+}
 
-  cv::Mat cvCovariance = covariance1;
-  cv::Mat factor;
-  Cholesky(cvCovariance, factor);
-
-  cv::Mat cvD = d;
-  cv::Mat cvZ = factor.inv(cv::DECOMP_CHOLESKY) * cvD.t();
-  cv::Mat cvZZ = cvZ.mul(cvZ);
-  cv::Mat cvSquareMaha = cv::Mat::zeros(1, cvZZ.cols, CV_32F);
-  cv::reduce(cvZZ, cvSquareMaha, 0, cv::REDUCE_SUM);
+void KalmanFilter::update(const KalmanBatch& batch) {
+  if (batch.empty()) return;
+  gather(batch, true);
+  for (Block& block : blocks) {
+    Lanes* m = block.mean;
+    Lanes(*P)[8] = block.covariance;
+    Lanes std_pos = _std_weight_position * m[3] * _std_weight_position * m[3];
+
+    // S = H P H' + R，H取前4个分量
+    Lanes S00 = P[0][0] + std_pos, S01 = P[0][1], S02 = P[0][2],
+          S03 = P[0][3];
+    Lanes S11 = P[1][1] + std_pos, S12 = P[1][2], S13 = P[1][3];
+    Lanes S22 = P[2][2] + 1e-2f, S23 = P[2][3];
+    Lanes S33 = P[3][3] + std_pos;
+
+    Ldl4 ldl;
+    ldl.d0 = S00;
+    ldl.l10 = S01 / ldl.d0;
+    ldl.l20 = S02 / ldl.d0;
+    ldl.l30 = S03 / ldl.d0;
+    ldl.d1 = S11 - ldl.l10 * ldl.l10 * ldl.d0;
+    ldl.l21 = (S12 - ldl.l20 * ldl.l10 * ldl.d0) / ldl.d1;
+    ldl.l31 = (S13 - ldl.l30 * ldl.l10 * ldl.d0) / ldl.d1;
+    ldl.d2 = S22 - ldl.l20 * ldl.l20 * ldl.d0 - ldl.l21 * ldl.l21 * ldl.d1;
+    ldl.l32 = (S23 - ldl.l30 * ldl.l20 * ldl.d0 - ldl.l31 * ldl.l21 * ldl.d1) /
+              ldl.d2;
+    ldl.d3 = S33 - ldl.l30 * ldl.l30 * ldl.d0 - ldl.l31 * ldl.l31 * ldl.d1 -
+             ldl.l32 * ldl.l32 * ldl.d2;
+
+    // K' = S^-1 H P，H P即P的前4行，对其每一列解方程
+    Lanes HP[4][8];
+    Lanes Kt[4][8];
+    for (int j = 0; j < 8; ++j) {
+      for (int k = 0; k < 4; ++k) Kt[k][j] = HP[k][j] = P[k][j];
+      ldl.solve(Kt[0][j], Kt[1][j], Kt[2][j], Kt[3][j]);
+    }
 
-  return cvSquareMaha;
+    // x' = x + K (z - H x)，P' = P - K H P
+    Lanes innovation[4];
+    for (int k = 0; k < 4; ++k) innovation[k] = block.measurement[k] - m[k];
+    for (int i = 0; i < 8; ++i) {
+      m[i] = m[i] + Kt[0][i] * innovation[0] + Kt[1][i] * innovation[1] +
+             Kt[2][i] * innovation[2] + Kt[3][i] * innovation[3];
+    }
+    for (int i = 0; i < 8; ++i) {
+      for (int j = i; j < 8; ++j) {
+        P[i][j] = P[i][j] - (Kt[0][i] * HP[0][j] + Kt[1][i] * HP[1][j] +
+                             Kt[2][i] * HP[2][j] + Kt[3][i] * HP[3][j]);
+      }
+    }
+    for (int i = 1; i < 8; ++i) {
+      for (int j = 0; j < i; ++j) P[i][j] = P[j][i];
+    }
+  }
+  scatter(batch);
 }
 
 }  // namespace bytetrack
@@ -43,14 +43,7 @@ void STrack::activate(std::shared_ptr<KalmanFilter> kalman_filter,
   _tlwh_tmp[2] = this->_tlwh[2];
   _tlwh_tmp[3] = this->_tlwh[3];
   std::vector<float> xyah = tlwh_to_xyah(_tlwh_tmp);
-  cv::Mat xyah_box(1, 4, CV_32F);
-  xyah_box.at<float>(0) = xyah[0];
-  xyah_box.at<float>(1) = xyah[1];
-  xyah_box.at<float>(2) = xyah[2];
-  xyah_box.at<float>(3) = xyah[3];
-  auto mc = kalman_filter->initiate(xyah_box);
-  this->mean = mc.first.clone();
-  this->covariance = mc.second.clone();
+  kalman_filter->initiate(xyah.data(), this->kalman);
 
   static_tlwh();
   static_tlbr();
@@ -65,19 +58,13 @@ void STrack::activate(std::shared_ptr<KalmanFilter> kalman_filter,
   this->start_frame = frame_id;
 }
 
-void STrack::kalman_correct_box(std::shared_ptr<KalmanFilter> kalman_filter,
-                         std::shared_ptr<STrack> new_track, bool correct_box) {
+void STrack::kalman_correct_box(KalmanBatch& update_batch,
+                                std::shared_ptr<STrack> new_track,
+                                bool correct_box) {
   if (correct_box) {
     std::vector<float> xyah = tlwh_to_xyah(new_track->tlwh);
-    cv::Mat xyah_box(1, 4, CV_32F);
-    xyah_box.at<float>(0) = xyah[0];
-    xyah_box.at<float>(1) = xyah[1];
-    xyah_box.at<float>(2) = xyah[2];
-    xyah_box.at<float>(3) = xyah[3];
-    auto mc = kalman_filter->update(this->mean, this->covariance, xyah_box);
-    this->mean = mc.first.clone();
-    this->covariance = mc.second.clone();
-    static_tlwh();
+    update_batch.states.push_back(&this->kalman);
+    update_batch.measurements.push_back({xyah[0], xyah[1], xyah[2], xyah[3]});
   } else {
     if (this->state == TrackState::New) {
       this->tlwh = this->_tlwh;
@@ -87,10 +74,10 @@ void STrack::kalman_correct_box(std::shared_ptr<KalmanFilter> kalman_filter,
   }
 }
 
-void STrack::re_activate(std::shared_ptr<KalmanFilter> kalman_filter,
+void STrack::re_activate(KalmanBatch& update_batch,
                          std::shared_ptr<STrack> new_track, int frame_id,
                          bool correct_box, bool new_id) {
-  kalman_correct_box(kalman_filter, new_track, correct_box);
+  kalman_correct_box(update_batch, new_track, correct_box);
   static_tlbr();
 
   this->tracklet_len = 0;
@@ -101,12 +88,13 @@ void STrack::re_activate(std::shared_ptr<KalmanFilter> kalman_filter,
   if (new_id) this->track_id = next_id();
 }
 
-void STrack::update(std::shared_ptr<KalmanFilter> kalman_filter,
-                    std::shared_ptr<STrack> new_track, int frame_id, bool correct_box) {
+void STrack::update(KalmanBatch& update_batch,
+                    std::shared_ptr<STrack> new_track, int frame_id,
+                    bool correct_box) {
   this->frame_id = frame_id;
   this->tracklet_len++;
 
-  kalman_correct_box(kalman_filter, new_track, correct_box);
+  kalman_correct_box(update_batch, new_track, correct_box);
   static_tlbr();
 
   this->state = TrackState::Tracked;
@@ -123,10 +111,10 @@ void STrack::static_tlwh() {
     return;
   }
 
-  tlwh[0] = mean.at<float>(0);
-  tlwh[1] = mean.at<float>(1);
-  tlwh[2] = mean.at<float>(2);
-  tlwh[3] = mean.at<float>(3);
+  tlwh[0] = kalman.mean[0];
+  tlwh[1] = kalman.mean[1];
+  tlwh[2] = kalman.mean[2];
+  tlwh[3] = kalman.mean[3];
 
   tlwh[2] *= tlwh[3];
   tlwh[0] -= tlwh[2] / 2;
@@ -169,14 +157,12 @@ int STrack::next_id() {
 int STrack::end_frame() { return this->frame_id; }
 
 void STrack::multi_predict(std::vector<std::shared_ptr<STrack>>& stracks,
-                           std::shared_ptr<KalmanFilter> kalman_filter) {
+                           KalmanBatch& predict_batch) {
   for (int i = 0; i < stracks.size(); i++) {
     if (stracks[i]->state != TrackState::Tracked) {
-      stracks[i]->mean.at<float>(7) = 0;
+      stracks[i]->kalman.mean[7] = 0;
     }
-    auto mc = kalman_filter->predict(stracks[i]->mean, stracks[i]->covariance);
-    stracks[i]->mean = mc.first.clone();
-    stracks[i]->covariance = mc.second.clone();
+    predict_batch.states.push_back(&stracks[i]->kalman);
   }
 }
 
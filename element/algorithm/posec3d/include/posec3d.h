@@ -10,6 +10,10 @@
 #ifndef SOPHON_STREAM_ELEMENT_POSEC3D_H_
 #define SOPHON_STREAM_ELEMENT_POSEC3D_H_
 
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "element_factory.h"
 #include "group.h"
 #include "posec3d_context.h"
@@ -75,6 +79,10 @@ class Posec3d : public ::sophon_stream::framework::Element {
   static constexpr const char* CONFIG_INTERNAL_CLASS_NAMES_FILE_FIELD =
       "class_names_file";
   static constexpr const char* CONFIG_INTERNAL_FRAMES_NUM_FIELD = "frames_num";
+  static constexpr const char* CONFIG_INTERNAL_HEATMAP_THREADS_FIELD =
+      "heatmap_threads";
+  static constexpr const char* CONFIG_INTERNAL_WINDOW_FIELD = "window";
+  static constexpr const char* CONFIG_INTERNAL_STRIDE_FIELD = "stride";
 
  private:
   std::shared_ptr<Posec3dContext> mContext;          // context对象
@@ -89,8 +97,58 @@ class Posec3d : public ::sophon_stream::framework::Element {
   std::string mFpsProfilerName;
   ::sophon_stream::common::FpsProfiler mFpsProfiler;
 
+  /**
+   * @brief 前处理阶段一路视频的状态，只由该路所在dataPipe的doWork访问
+   */
+  struct ChannelClip {
+    ChannelClip(int window, int stride) : window(window, stride) {}
+    PoseClipWindow window;
+    /**
+     * @brief 上次输出之后收到的帧，输出窗口时一起发送
+     */
+    common::ObjectMetadatas pending;
+  };
+
+  /**
+   * @brief key为mChannelIdInternal，收到该路的结束帧时删除
+   */
+  std::unordered_map<int, std::shared_ptr<ChannelClip>> mChannelClips;
+  std::mutex mChannelClipsMutex;
+
+  /**
+   * @brief pcie模式下的host端heatmap，下标为dataPipeId
+   * @details
+   * 同一dataPipe的doWork不会并发执行，heatmap拷贝到设备内存后即不再使用，
+   * 因此同一dataPipe上的各路共用一块；soc模式下直接写入设备内存，不申请
+   */
+  std::vector<PoseHeatmapCanvas> mCanvases;
+
+  /**
+   * @brief 后处理阶段每路最近一次的识别结果，赋给之后的非主帧
+   */
+  std::unordered_map<
+      int, std::vector<std::shared_ptr<common::RecognizedObjectMetadata>>>
+      mLatestResults;
+  std::mutex mLatestResultsMutex;
+
   common::ErrorCode initContext(const std::string& json);
   void process(common::ObjectMetadatas& objectMetadatas);
+
+  /**
+   * @brief 前处理阶段：按路累积关键点，直到某一路需要输出一个窗口
+   * @param objectMetadatas 输出窗口的主帧，已完成前处理
+   * @param pendingObjectMetadatas 需要发送的帧，主帧在其所在路的帧之前
+   */
+  void collectClip(int inputPort, int dataPipeId,
+                   common::ObjectMetadatas& objectMetadatas,
+                   common::ObjectMetadatas& pendingObjectMetadatas);
+  std::shared_ptr<ChannelClip> getChannelClip(int channelId);
+  void eraseChannelClip(int channelId);
+
+  /**
+   * @brief 后处理阶段：主帧更新该路的识别结果，其余帧使用该路最近一次的结果
+   */
+  void assignResults(common::ObjectMetadatas& pendingObjectMetadatas);
 };
 
 }  // namespace posec3d
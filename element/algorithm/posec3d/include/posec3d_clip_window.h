@@ -0,0 +1,90 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_POSEC3D_CLIP_WINDOW_H_
+#define SOPHON_STREAM_ELEMENT_POSEC3D_CLIP_WINDOW_H_
+
+#include <vector>
+
+#include "posec3d_heatmap.h"
+
+namespace sophon_stream {
+namespace element {
+namespace posec3d {
+
+/**
+ * @brief 一路视频最近window帧的关键点，环形存储
+ * @details
+ * 每帧的关键点在进入时整理为连续数组，之后每个窗口直接复制，不再从
+ * ObjectMetadata中提取。每进入stride帧、且已有window帧时输出一次，
+ * 相邻两次输出的窗口重叠window - stride帧；stride等于window时窗口不重叠。
+ * 不是线程安全的，同一路视频只应由一个线程访问
+ */
+class PoseClipWindow {
+ public:
+  PoseClipWindow(int window, int stride);
+
+  /**
+   * @brief 开始新的一帧，窗口已满时覆盖最早的一帧
+   */
+  void beginFrame();
+
+  /**
+   * @brief 关键点数量K由第一个人确定，之后只取前K个，不足K个的人不添加
+   * @return 不添加时返回false
+   */
+  bool addPerson(const std::vector<float>& keypoints,
+                 const std::vector<float>& scores);
+
+  /**
+   * @brief 当前帧结束
+   * @return 是否应当输出当前窗口
+   */
+  bool endFrame();
+
+  /**
+   * @brief 按时间顺序把窗口内的帧写入poses
+   * @param defaultKeypoints 还没有出现过人时使用的关键点数量
+   */
+  void collect(PoseSequence& poses, int defaultKeypoints) const;
+
+  /**
+   * @brief 当前窗口已输出，重新开始计数
+   */
+  void markEmitted() { mNewFrames = 0; }
+
+  int getFrameNumber() const { return mSize; }
+  /**
+   * @brief 上次输出之后进入的帧数
+   */
+  int getNewFrameNumber() const { return mNewFrames; }
+
+ private:
+  struct Frame {
+    std::vector<float> keypoints;
+    std::vector<float> scores;
+  };
+
+  const int mWindow;
+  const int mStride;
+  int mKeypointNumber = 0;
+  std::vector<Frame> mFrames;
+  /**
+   * @brief 最早一帧在mFrames中的下标
+   */
+  int mHead = 0;
+  int mSize = 0;
+  int mNewFrames = 0;
+};
+
+}  // namespace posec3d
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_POSEC3D_CLIP_WINDOW_H_
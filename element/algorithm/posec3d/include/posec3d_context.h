@@ -34,6 +34,9 @@ class Posec3dContext : public ::sophon_stream::element::Context {
 
   std::vector<std::string> class_names;
   float input_scale;
+  int heatmap_threads = 1;  // 生成heatmap的线程数，不超过CPU核数
+  int clip_window;          // 每次识别使用的帧数
+  int clip_stride;          // 每隔多少帧识别一次
 };
 }  // namespace posec3d
 }  // namespace element
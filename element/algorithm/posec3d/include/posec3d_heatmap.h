@@ -0,0 +1,157 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_POSEC3D_HEATMAP_H_
+#define SOPHON_STREAM_ELEMENT_POSEC3D_HEATMAP_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace sophon_stream {
+namespace element {
+namespace posec3d {
+
+/**
+ * @brief 一段视频中每帧所有人的关键点，连续存储
+ * @details
+ * 第f帧的人按顺序排列，第p个人的第k个关键点坐标位于
+ * getKeypoints(f)[(p * K + k) * 2]，置信度位于getScores(f)[p * K + k]，
+ * K为getKeypointNumber()
+ */
+class PoseSequence {
+ public:
+  /**
+   * @brief 清空所有帧，之后每个人有numKeypoints个关键点
+   */
+  void reset(int numKeypoints);
+
+  /**
+   * @brief 开始新的一帧，之后addPerson添加到这一帧
+   */
+  void beginFrame();
+
+  /**
+   * @brief keypoints为{x, y, ...}，只取前K个关键点
+   * @return 关键点数量少于K时返回false，不添加
+   */
+  bool addPerson(const std::vector<float>& keypoints,
+                 const std::vector<float>& scores);
+
+  /**
+   * @brief 添加number个人，keypoints和scores已按K个关键点连续排列
+   */
+  void addPersons(const float* keypoints, const float* scores, int number);
+
+  int getKeypointNumber() const { return mKeypointNumber; }
+  int getFrameNumber() const {
+    return static_cast<int>(mPersonOffsets.size()) - 1;
+  }
+  int getPersonNumber(int frame) const {
+    return mPersonOffsets[frame + 1] - mPersonOffsets[frame];
+  }
+  const float* getKeypoints(int frame) const {
+    return mKeypoints.data() +
+           static_cast<std::size_t>(mPersonOffsets[frame]) * mKeypointNumber *
+               2;
+  }
+  const float* getScores(int frame) const {
+    return mScores.data() +
+           static_cast<std::size_t>(mPersonOffsets[frame]) * mKeypointNumber;
+  }
+
+  /**
+   * @brief 所有帧的关键点坐标{x, y, ...}，用于整体平移和缩放
+   */
+  std::vector<float>& getAllKeypoints() { return mKeypoints; }
+  const std::vector<float>& getAllKeypoints() const { return mKeypoints; }
+
+ private:
+  int mKeypointNumber = 0;
+  /**
+   * @brief 第f帧的人为[mPersonOffsets[f], mPersonOffsets[f + 1])
+   */
+  std::vector<int> mPersonOffsets = {0};
+  std::vector<float> mKeypoints;
+  std::vector<float> mScores;
+};
+
+struct PoseHeatmapParams {
+  /**
+   * @brief 输出的关键点通道数，超过PoseSequence关键点数量的通道全为0
+   */
+  int channels = 0;
+  int clipLen = 0;
+  int height = 0;
+  int width = 0;
+  float sigma = 0.6f;
+  /**
+   * @brief 乘在heatmap上的系数，一般为模型输入的scale
+   */
+  float scale = 1.f;
+};
+
+/**
+ * @brief 生成posec3d的输入heatmap
+ * @details
+ * heatmap前一半的布局为[clip][channel][clipLen][height][width]，
+ * 第i个采样位置属于第i / clipLen个clip的第i % clipLen帧；后一半与前一半相同。
+ * 高斯核可分离，每个关键点只计算一行和一列的一维高斯表，一维表由预先算好的
+ * 相邻两项之比递推得到，
+ * 按行取最大值写入；各采样位置写入的区域互不重叠，按采样位置分给threadNumber个线程
+ * @param frames 每个采样位置对应的PoseSequence帧号，-1表示空帧
+ * @param outNum heatmap的float个数
+ * @return frames超出heatmap前一半的容量时返回false，heatmap不被修改
+ */
+bool generatePoseHeatmap(const PoseSequence& poses,
+                         const std::vector<int>& frames,
+                         const PoseHeatmapParams& params, float* heatmap,
+                         std::size_t outNum, int threadNumber);
+
+/**
+ * @brief 重复使用的host端heatmap，结果与generatePoseHeatmap相同
+ * @details
+ * heatmap中绝大部分是0。这里记录上一次每个高斯核写入的区域，
+ * 下一次生成时只把这些区域清零，省去每次申请并清零整块内存；
+ * 布局(outNum、通道数、clipLen、长宽)改变时重新申请
+ */
+class PoseHeatmapCanvas {
+ public:
+  /**
+   * @brief heatmap中一块从offset开始、rows行width列的区域，只记录前一半
+   */
+  struct Patch {
+    std::size_t offset;
+    int width;
+    int rows;
+  };
+
+  /**
+   * @return frames超出heatmap前一半的容量时返回false，此时heatmap全为0
+   */
+  bool generate(const PoseSequence& poses, const std::vector<int>& frames,
+                const PoseHeatmapParams& params, std::size_t outNum,
+                int threadNumber);
+
+  const float* data() const { return mData.data(); }
+  std::size_t size() const { return mData.size(); }
+
+ private:
+  std::vector<float> mData;
+  PoseHeatmapParams mParams;
+  /**
+   * @brief 每个线程各自记录，避免加锁
+   */
+  std::vector<std::vector<Patch>> mPatches;
+};
+
+}  // namespace posec3d
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_POSEC3D_HEATMAP_H_
@@ -11,48 +11,49 @@
 #define SOPHON_STREAM_ELEMENT_POSEC3D_PRE_PROCESS_H_
 
 #include "algorithmApi/pre_process.h"
+#include "posec3d_clip_window.h"
 #include "posec3d_context.h"
+#include "posec3d_heatmap.h"
 
 namespace sophon_stream {
 namespace element {
 namespace posec3d {
 
-using fpptr_dim3 = std::vector<
-    std::shared_ptr<std::vector<std::shared_ptr<std::vector<float>>>>>;
-using fpptr_dim2 = std::vector<std::shared_ptr<std::vector<float>>>;
-
 class Posec3dPreProcess : public ::sophon_stream::element::PreProcess {
  public:
   /**
-   * @brief 对一个batch的数据做预处理
+   * @brief 对一路视频的一个窗口做预处理，输入tensor放在objectMetadatas[0]上
    * @param context context指针
-   * @param objectMetadatas 一个batch的数据
+   * @param objectMetadatas 本次输出的帧，第0帧为主帧
+   * @param window 这一路最近若干帧的关键点
+   * @param canvas 当前dataPipe复用的host端heatmap，pcie模式下使用
    * @return common::ErrorCode
    * common::ErrorCode::SUCCESS，中间过程失败会中断执行
    */
   common::ErrorCode preProcess(std::shared_ptr<Posec3dContext> context,
-                               common::ObjectMetadatas& objectMetadatas);
+                               common::ObjectMetadatas& objectMetadatas,
+                               const PoseClipWindow& window,
+                               PoseHeatmapCanvas& canvas);
   void init(std::shared_ptr<Posec3dContext> context);
 
  private:
   /**
-   * @brief 对一个batch的数据做重采样
-   * @param sampled_keypoints 重采样关键点结果
-   * @param sampled_keypoint_scores 重采样关键点置信度结果
+   * @brief 对一个batch的数据做重采样，只生成帧号，关键点不复制
+   * @param num_frames batch的帧数
+   * @param inds 每个采样位置对应的帧号
    * @param clip_len 每次裁剪的长度
    * @param num_clips 裁剪次数
    * @param seed 当帧数大于裁剪长度时裁剪时的随机种子
    * @return common::ErrorCode
    * common::ErrorCode::SUCCESS，中间过程失败会中断执行
    */
-  common::ErrorCode uniformSampleFrames(fpptr_dim3& sampled_keypoints,
-                                        fpptr_dim3& sampled_keypoint_scores,
+  common::ErrorCode uniformSampleFrames(int num_frames, std::vector<int>& inds,
                                         int clip_len, int num_clips, int seed);
 
   /**
    * @brief 对一个batch的关键点数据做偏移并生成下面预处理所需要的参数
    * @param objectMetadatas 一个batch的数据
-   * @param keypoints 关键点输入
+   * @param poses 关键点输入
    * @param padding padding尺寸
    * @param threshold 长宽阈值
    * @param hw_ratio 长宽比率
@@ -63,7 +64,7 @@ class Posec3dPreProcess : public ::sophon_stream::element::PreProcess {
    * common::ErrorCode::SUCCESS，中间过程失败会中断执行
    */
   common::ErrorCode poseCompact(common::ObjectMetadatas& objectMetadatas,
-                                fpptr_dim3& keypoints, float padding,
+                                PoseSequence& poses, float padding,
                                 int threshold, std::vector<float>& hw_ratio,
                                 std::vector<int>& new_shape,
                                 std::vector<float>& crop_quadruple,
@@ -71,26 +72,26 @@ class Posec3dPreProcess : public ::sophon_stream::element::PreProcess {
 
   /**
    * @brief 对一个batch的关键点数据做缩放，并生成下面预处理所需要的参数
-   * @param keypoints 关键点输入
+   * @param poses 关键点输入
    * @param scale 缩放尺寸
    * @param new_shape poseCompact输出的长宽，最终为输出的新长宽
    * @param keep_ratio 是否缩放时保持纵横比
    * @return common::ErrorCode
    * common::ErrorCode::SUCCESS，中间过程失败会中断执行
    */
-  common::ErrorCode resize(fpptr_dim3& keypoints, std::vector<int>& scale,
+  common::ErrorCode resize(PoseSequence& poses, std::vector<int>& scale,
                            std::vector<int>& new_shape, bool keep_ratio);
 
   /**
    * @brief 对一个batch的关键点数据做偏移，并生成下面预处理所需要的参数
-   * @param keypoints 关键点输入
+   * @param poses 关键点输入
    * @param new_shape resize输出的新长宽
    * @param crop_quadruple 输出的新几何属性
    * @param crop_size 裁剪尺寸
    * @return common::ErrorCode
    * common::ErrorCode::SUCCESS，中间过程失败会中断执行
    */
-  common::ErrorCode centerCrop(fpptr_dim3& keypoints,
+  common::ErrorCode centerCrop(PoseSequence& poses,
                                std::vector<int>& new_shape,
                                std::vector<float>& crop_quadruple,
                                std::vector<int>& crop_size);
@@ -98,24 +99,26 @@ class Posec3dPreProcess : public ::sophon_stream::element::PreProcess {
   /**
    * @brief 生成模型输入heatmap
    * @param context context指针
-   * @param sampled_keypoints 来自uniformSampleFrames输出的重采样关键点结果
-   * @param sampled_keypoint_scores 关键点输入
+   * @param poses 关键点输入
+   * @param inds 来自uniformSampleFrames输出的重采样帧号
    * @param new_shape centerCrop输出的新长宽
-   * @param heatmap 输出heatmap的指针
+   * @param heatmap 输出heatmap的指针，为空时写入canvas
+   * @param canvas 复用的host端heatmap
    * @param out_num 输出heatmap的长度
-   * @param sigma 缩放因子
+   * @param sigma 高斯核的标准差
    * @param scaling 缩放因子
    * @param clip_len 每次裁剪的长度
    * @return common::ErrorCode
    * common::ErrorCode::SUCCESS，中间过程失败会中断执行
    */
   common::ErrorCode generatePoseTarget(std::shared_ptr<Posec3dContext> context,
-                                       fpptr_dim3& keypoints,
-                                       fpptr_dim3& sampled_keypoints,
-                                       fpptr_dim3& sampled_keypoint_scores,
+                                       PoseSequence& poses,
+                                       const std::vector<int>& inds,
                                        std::vector<int>& new_shape,
-                                       float* heatmap, int out_num, float sigma,
-                                       float scaling, int clip_len);
+                                       float* heatmap,
+                                       PoseHeatmapCanvas& canvas, int out_num,
+                                       float sigma, float scaling,
+                                       int clip_len);
 
   /**
    * @brief 为一个batch的数据初始化设备内存
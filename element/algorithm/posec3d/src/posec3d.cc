@@ -9,6 +9,9 @@
 
 #include "posec3d.h"
 
+#include <algorithm>
+#include <thread>
+
 using namespace std::chrono_literals;
 
 namespace sophon_stream {
@@ -43,6 +46,27 @@ common::ErrorCode Posec3d::initContext(const std::string& json) {
     // 2. get input
     auto frameNum = configure.find(CONFIG_INTERNAL_FRAMES_NUM_FIELD);
     mContext->max_batch = frameNum->get<int>();
+    mContext->heatmap_threads = configure.value(
+        CONFIG_INTERNAL_HEATMAP_THREADS_FIELD, mContext->heatmap_threads);
+    // 每个线程处理的采样帧不多，超过核数只会增加开销
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores > 0 && mContext->heatmap_threads > cores) {
+      IVS_WARN("heatmap_threads {0:d} exceeds {1:d} cores, use {1:d}",
+               mContext->heatmap_threads, cores);
+      mContext->heatmap_threads = cores;
+    }
+    mContext->heatmap_threads = std::max(mContext->heatmap_threads, 1);
+    // 默认每frames_num帧识别一次，窗口互不重叠
+    mContext->clip_window =
+        configure.value(CONFIG_INTERNAL_WINDOW_FIELD, mContext->max_batch);
+    mContext->clip_stride =
+        configure.value(CONFIG_INTERNAL_STRIDE_FIELD, mContext->clip_window);
+    if (mContext->clip_window <= 0 || mContext->clip_stride <= 0) {
+      IVS_WARN("Posec3d window {0:d} and stride {1:d} must be positive",
+               mContext->clip_window, mContext->clip_stride);
+      mContext->clip_window = std::max(mContext->clip_window, 1);
+      mContext->clip_stride = std::max(mContext->clip_stride, 1);
+    }
     auto inputTensor = mContext->bmNetwork->inputTensor(0);
     mContext->input_num = mContext->bmNetwork->m_netinfo->input_num;
     mContext->m_net_crops_clips = inputTensor->get_shape()->dims[0];
@@ -120,6 +144,7 @@ common::ErrorCode Posec3d::initInternal(const std::string& json) {
     initContext(configure.dump());
     // 前处理初始化
     mPreProcess->init(mContext);
+    if (use_pre) mCanvases.resize(std::max(getThreadNumber(), 1));
     // 推理初始化
     mInference->init(mContext);
     // 后处理初始化
@@ -131,16 +156,7 @@ common::ErrorCode Posec3d::initInternal(const std::string& json) {
 
 void Posec3d::process(common::ObjectMetadatas& objectMetadatas) {
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
-  // 预处理
-  if (use_pre) {
-    errorCode = mPreProcess->preProcess(mContext, objectMetadatas);
-    if (common::ErrorCode::SUCCESS != errorCode) {
-      for (unsigned i = 0; i < objectMetadatas.size(); i++) {
-        objectMetadatas[i]->mErrorCode = errorCode;
-      }
-      return;
-    }
-  }
+  // 预处理在collectClip中按路完成
   // 推理
   if (use_infer) {
     errorCode = mInference->predict(mContext, objectMetadatas);
@@ -155,6 +171,95 @@ void Posec3d::process(common::ObjectMetadatas& objectMetadatas) {
   if (use_post) mPostProcess->postProcess(mContext, objectMetadatas);
 }
 
+std::shared_ptr<Posec3d::ChannelClip> Posec3d::getChannelClip(int channelId) {
+  std::lock_guard<std::mutex> lock(mChannelClipsMutex);
+  auto& clip = mChannelClips[channelId];
+  if (!clip)
+    clip = std::make_shared<ChannelClip>(mContext->clip_window,
+                                         mContext->clip_stride);
+  return clip;
+}
+
+void Posec3d::eraseChannelClip(int channelId) {
+  std::lock_guard<std::mutex> lock(mChannelClipsMutex);
+  mChannelClips.erase(channelId);
+}
+
+void Posec3d::collectClip(int inputPort, int dataPipeId,
+                          common::ObjectMetadatas& objectMetadatas,
+                          common::ObjectMetadatas& pendingObjectMetadatas) {
+  while (getThreadStatus() == ThreadStatus::RUN) {
+    // 如果队列为空则等待
+    auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+
+    if (!data) {
+      if (shouldWaitInputData()) continue;
+      break;
+    }
+    auto objectMetadata =
+        std::static_pointer_cast<common::ObjectMetadata>(data);
+    int channelId = objectMetadata->mFrame->mChannelIdInternal;
+    auto clip = getChannelClip(channelId);
+    bool endOfStream = objectMetadata->mFrame->mEndOfStream;
+    bool emit = false;
+    if (endOfStream) {
+      // 结束前不足stride帧的部分也识别一次
+      emit = clip->window.getNewFrameNumber() > 0;
+    } else if (!objectMetadata->mFilter) {
+      clip->window.beginFrame();
+      for (auto& poseObj : objectMetadata->mPosedObjectMetadatas) {
+        if (!clip->window.addPerson(poseObj->keypoints, poseObj->scores))
+          IVS_WARN("Posec3d skip a person with {0:d} keypoints",
+                   static_cast<int>(poseObj->scores.size()));
+      }
+      emit = clip->window.endFrame();
+    }
+    clip->pending.push_back(objectMetadata);
+
+    if (emit) {
+      // 主帧是上次输出之后的第一个有效帧，之后的帧在后处理中使用它的结果
+      auto mainIt = std::find_if(
+          clip->pending.begin(), clip->pending.end(),
+          [](const std::shared_ptr<common::ObjectMetadata>& obj) {
+            return !obj->mFilter && !obj->mFrame->mEndOfStream;
+          });
+      common::ObjectMetadatas mainObjectMetadatas = {*mainIt};
+      common::ErrorCode errorCode = mPreProcess->preProcess(
+          mContext, mainObjectMetadatas, clip->window, mCanvases[dataPipeId]);
+      clip->window.markEmitted();
+      if (common::ErrorCode::SUCCESS != errorCode) {
+        for (auto& obj : clip->pending) obj->mErrorCode = errorCode;
+      } else {
+        objectMetadatas.push_back(*mainIt);
+      }
+    }
+    if (emit || endOfStream) {
+      pendingObjectMetadatas.insert(pendingObjectMetadatas.end(),
+                                    clip->pending.begin(), clip->pending.end());
+      clip->pending.clear();
+      if (endOfStream) eraseChannelClip(channelId);
+      break;
+    }
+  }
+}
+
+void Posec3d::assignResults(common::ObjectMetadatas& pendingObjectMetadatas) {
+  std::lock_guard<std::mutex> lock(mLatestResultsMutex);
+  for (auto& objectMetadata : pendingObjectMetadatas) {
+    int channelId = objectMetadata->mFrame->mChannelIdInternal;
+    if (objectMetadata->mFrame->mEndOfStream) {
+      mLatestResults.erase(channelId);
+    } else if (objectMetadata->is_main &&
+               !objectMetadata->mRecognizedObjectMetadatas.empty()) {
+      mLatestResults[channelId] = objectMetadata->mRecognizedObjectMetadatas;
+    } else {
+      auto it = mLatestResults.find(channelId);
+      if (it != mLatestResults.end())
+        objectMetadata->mRecognizedObjectMetadatas = it->second;
+    }
+  }
+}
+
 common::ErrorCode Posec3d::doWork(int dataPipeId) {
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
 
@@ -170,32 +275,17 @@ common::ErrorCode Posec3d::doWork(int dataPipeId) {
   common::ObjectMetadatas pendingObjectMetadatas;
 
   if (use_pre) {
-    while (objectMetadatas.size() < mContext->max_batch &&
-           (getThreadStatus() == ThreadStatus::RUN)) {
-      // 如果队列为空则等待
-      auto data = popInputData(inputPort, dataPipeId);
-
-      if (!data) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        continue;
-      }
-      auto objectMetadata =
-          std::static_pointer_cast<common::ObjectMetadata>(data);
-      pendingObjectMetadatas.push_back(objectMetadata);
-      if (objectMetadata->mFrame->mEndOfStream) {
-        break;
-      }
-      if (!objectMetadata->mFilter) objectMetadatas.push_back(objectMetadata);
-    }
+    collectClip(inputPort, dataPipeId, objectMetadatas,
+                pendingObjectMetadatas);
   } else {
     while (pendingObjectMetadatas.size() < mContext->max_batch &&
            (getThreadStatus() == ThreadStatus::RUN)) {
       // 如果队列为空则等待
-      auto data = popInputData(inputPort, dataPipeId);
+      auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
 
       if (!data) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        continue;
+        if (shouldWaitInputData()) continue;
+        break;
       }
       auto objectMetadata =
           std::static_pointer_cast<common::ObjectMetadata>(data);
@@ -205,18 +295,17 @@ common::ErrorCode Posec3d::doWork(int dataPipeId) {
       }
       // all frame inputs are put into main objectMetadata, then the following
       // infer and postprocess are based on main objectMetadata
-      if (!objectMetadata->mFilter && objectMetadata->is_main)
+      if (!objectMetadata->mFilter && objectMetadata->is_main) {
         objectMetadatas.push_back(objectMetadata);
+        break;
+      }
     }
   }
 
   process(objectMetadatas);
 
-  if (use_post && objectMetadatas.size() > 0) {
-    // for all frames, they have the same action label
-    for (auto& objectMetadata : pendingObjectMetadatas)
-      objectMetadata->mRecognizedObjectMetadatas = objectMetadatas[0]->mRecognizedObjectMetadatas;
-  }
+  // 同一窗口的帧使用相同的行为标签
+  if (use_post) assignResults(pendingObjectMetadatas);
 
   for (auto& objectMetadata : pendingObjectMetadatas) {
     int channel_id_internal = objectMetadata->mFrame->mChannelIdInternal;
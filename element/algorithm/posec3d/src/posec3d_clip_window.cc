@@ -0,0 +1,71 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "posec3d_clip_window.h"
+
+#include <algorithm>
+
+namespace sophon_stream {
+namespace element {
+namespace posec3d {
+
+PoseClipWindow::PoseClipWindow(int window, int stride)
+    : mWindow(std::max(window, 1)),
+      mStride(std::max(stride, 1)),
+      mFrames(mWindow) {}
+
+void PoseClipWindow::beginFrame() {
+  int index = (mHead + mSize) % mWindow;
+  if (mSize == mWindow) {
+    mHead = (mHead + 1) % mWindow;
+  } else {
+    ++mSize;
+  }
+  // 复用被覆盖帧的内存
+  mFrames[index].keypoints.clear();
+  mFrames[index].scores.clear();
+}
+
+bool PoseClipWindow::addPerson(const std::vector<float>& keypoints,
+                               const std::vector<float>& scores) {
+  if (mKeypointNumber == 0) mKeypointNumber = static_cast<int>(scores.size());
+  if (mKeypointNumber == 0 ||
+      scores.size() < static_cast<std::size_t>(mKeypointNumber) ||
+      keypoints.size() < static_cast<std::size_t>(mKeypointNumber) * 2) {
+    return false;
+  }
+  Frame& frame = mFrames[(mHead + mSize - 1) % mWindow];
+  frame.keypoints.insert(frame.keypoints.end(), keypoints.begin(),
+                         keypoints.begin() + mKeypointNumber * 2);
+  frame.scores.insert(frame.scores.end(), scores.begin(),
+                      scores.begin() + mKeypointNumber);
+  return true;
+}
+
+bool PoseClipWindow::endFrame() {
+  ++mNewFrames;
+  return mNewFrames >= mStride && mSize == mWindow;
+}
+
+void PoseClipWindow::collect(PoseSequence& poses, int defaultKeypoints) const {
+  int numKeypoints = mKeypointNumber > 0 ? mKeypointNumber : defaultKeypoints;
+  poses.reset(numKeypoints);
+  for (int i = 0; i < mSize; ++i) {
+    const Frame& frame = mFrames[(mHead + i) % mWindow];
+    poses.beginFrame();
+    if (numKeypoints > 0) {
+      poses.addPersons(frame.keypoints.data(), frame.scores.data(),
+                       static_cast<int>(frame.scores.size()) / numKeypoints);
+    }
+  }
+}
+
+}  // namespace posec3d
+}  // namespace element
+}  // namespace sophon_stream
@@ -0,0 +1,338 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "posec3d_heatmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace sophon_stream {
+namespace element {
+namespace posec3d {
+
+void PoseSequence::reset(int numKeypoints) {
+  mKeypointNumber = numKeypoints;
+  mPersonOffsets.assign(1, 0);
+  mKeypoints.clear();
+  mScores.clear();
+}
+
+void PoseSequence::beginFrame() {
+  mPersonOffsets.push_back(mPersonOffsets.back());
+}
+
+bool PoseSequence::addPerson(const std::vector<float>& keypoints,
+                             const std::vector<float>& scores) {
+  if (keypoints.size() < static_cast<std::size_t>(mKeypointNumber) * 2 ||
+      scores.size() < static_cast<std::size_t>(mKeypointNumber)) {
+    return false;
+  }
+  mKeypoints.insert(mKeypoints.end(), keypoints.begin(),
+                    keypoints.begin() + mKeypointNumber * 2);
+  mScores.insert(mScores.end(), scores.begin(),
+                 scores.begin() + mKeypointNumber);
+  ++mPersonOffsets.back();
+  return true;
+}
+
+void PoseSequence::addPersons(const float* keypoints, const float* scores,
+                              int number) {
+  std::size_t count = static_cast<std::size_t>(number) * mKeypointNumber;
+  mKeypoints.insert(mKeypoints.end(), keypoints, keypoints + count * 2);
+  mScores.insert(mScores.end(), scores, scores + count);
+  mPersonOffsets.back() += number;
+}
+
+namespace {
+
+constexpr float SCORE_EPS = 1e-4f;
+/**
+ * @brief 递推的起点exp(-k * d^2)不能下溢，k * (R + 1)^2超过该值时不使用递推表
+ */
+constexpr double MAX_GAUSS_EXPONENT = 600.0;
+/**
+ * @brief 写入的区域超过heatmap的1/DIRTY_FILL_RATIO时整块清零，
+ * 见tools/posec3d_benchmark中不同人数下的对比
+ */
+constexpr std::size_t DIRTY_FILL_RATIO = 64;
+
+/**
+ * @brief 一个采样位置，offset为它的第0个通道在heatmap前一半中的平面
+ */
+struct Slot {
+  int frame;
+  std::size_t offset;
+};
+
+using Patch = PoseHeatmapCanvas::Patch;
+
+class SlotRenderer {
+ public:
+  /**
+   * @param clear 为false时heatmap应已全为0，不再清零采样位置
+   * @param patches 非空时记录每个高斯核写入的区域
+   */
+  SlotRenderer(const PoseSequence& poses, const PoseHeatmapParams& params,
+               float* heatmap, std::size_t half, bool clear,
+               std::vector<Patch>* patches)
+      : mPoses(poses),
+        mParams(params),
+        mHeatmap(heatmap),
+        mHalf(half),
+        mClear(clear),
+        mPatches(patches),
+        mPlaneSize(static_cast<std::size_t>(params.height) * params.width),
+        mChannelStride(mPlaneSize * params.clipLen),
+        mInvTwoSigma2(1.0 / (2.0 * params.sigma * params.sigma)),
+        mRadius(static_cast<int>(3 * params.sigma) + 2) {
+    int patch = static_cast<int>(6 * params.sigma) + 3;
+    mGaussX.resize(patch);
+    mGaussY.resize(patch);
+    // sigma过小时表中的值会溢出，退回逐点计算exp
+    if (mInvTwoSigma2 * (mRadius + 1) * (mRadius + 1) < MAX_GAUSS_EXPONENT) {
+      mStepTable.resize(2 * mRadius + 1);
+      for (int j = -mRadius; j <= mRadius; ++j)
+        mStepTable[j + mRadius] = std::exp(-mInvTwoSigma2 * (2 * j + 1));
+    }
+  }
+
+  void render(const Slot& slot) {
+    float* base = mHeatmap + slot.offset;
+    for (int c = 0; mClear && c < mParams.channels; ++c) {
+      std::memset(base + c * mChannelStride, 0, mPlaneSize * sizeof(float));
+      std::memset(base + c * mChannelStride + mHalf, 0,
+                  mPlaneSize * sizeof(float));
+    }
+
+    if (slot.frame >= 0) {
+      int numKeypoints = mPoses.getKeypointNumber();
+      int channels = std::min(mParams.channels, numKeypoints);
+      int persons = mPoses.getPersonNumber(slot.frame);
+      const float* keypoints = mPoses.getKeypoints(slot.frame);
+      const float* scores = mPoses.getScores(slot.frame);
+      for (int c = 0; c < channels; ++c) {
+        float* plane = base + c * mChannelStride;
+        for (int p = 0; p < persons; ++p) {
+          int k = p * numKeypoints + c;
+          if (scores[k] < SCORE_EPS) continue;
+          drawGaussian(plane, keypoints[k * 2], keypoints[k * 2 + 1],
+                       scores[k]);
+        }
+      }
+    }
+  }
+
+ private:
+  /**
+   * @brief 写入out[i] = exp(-(begin + i - mu)^2 / 2σ^2) * weight，i < number
+   * @details
+   * 令k = 1 / 2σ^2，x0 = floor(mu)，f = mu - x0，j = x - x0，相邻两项之比为
+   * g(j + 1) / g(j) = exp(-k(2j + 1)) * exp(2kf)，前一项只与j有关，
+   * 预先算在mStepTable中，每个关键点的每个轴只需计算两次exp
+   */
+  void fillGaussian(float* out, int begin, int number, float mu,
+                    double weight) const {
+    double x0 = std::floor(mu);
+    int j = begin - static_cast<int>(x0);
+    if (mStepTable.empty() || j < -mRadius || j + number - 1 > mRadius) {
+      for (int i = 0; i < number; ++i) {
+        double d = begin + i - mu;
+        out[i] = static_cast<float>(std::exp(-d * d * mInvTwoSigma2) * weight);
+      }
+      return;
+    }
+    double d = begin - mu;
+    double value = std::exp(-d * d * mInvTwoSigma2) * weight;
+    double ratio = std::exp(2.0 * mInvTwoSigma2 * (mu - x0));
+    const double* step = mStepTable.data() + mRadius + j;
+    for (int i = 0; i < number; ++i) {
+      out[i] = static_cast<float>(value);
+      value *= step[i] * ratio;
+    }
+  }
+
+  /**
+   * @brief exp(-(dx^2 + dy^2) / 2σ^2) = exp(-dx^2 / 2σ^2) * exp(-dy^2 / 2σ^2)，
+   * 先算一维表，再逐行与已有的值取最大值
+   */
+  void drawGaussian(float* plane, float muX, float muY, float score) {
+    const float sigma = mParams.sigma;
+    int stX = std::max(static_cast<int>(muX - 3 * sigma), 0);
+    int edX = std::min(static_cast<int>(muX + 3 * sigma) + 1, mParams.width);
+    int stY = std::max(static_cast<int>(muY - 3 * sigma), 0);
+    int edY = std::min(static_cast<int>(muY + 3 * sigma) + 1, mParams.height);
+    if (stX >= edX || stY >= edY) return;
+
+    int width = edX - stX;
+    if (mPatches) {
+      mPatches->push_back(
+          {static_cast<std::size_t>(plane - mHeatmap) +
+               static_cast<std::size_t>(stY) * mParams.width + stX,
+           width, edY - stY});
+    }
+    float* gaussX = mGaussX.data();
+    fillGaussian(gaussX, stX, width, muX, 1.0);
+    fillGaussian(mGaussY.data(), stY, edY - stY, muY,
+                 static_cast<double>(score) * mParams.scale);
+
+    // 后一半与前一半相同，同时写入
+    for (int y = stY; y < edY; ++y) {
+      float weight = mGaussY[y - stY];
+      float* row = plane + static_cast<std::size_t>(y) * mParams.width + stX;
+      float* mirror = row + mHalf;
+      for (int x = 0; x < width; ++x) {
+        float value = std::max(row[x], weight * gaussX[x]);
+        row[x] = value;
+        mirror[x] = value;
+      }
+    }
+  }
+
+  const PoseSequence& mPoses;
+  const PoseHeatmapParams& mParams;
+  float* mHeatmap;
+  const std::size_t mHalf;
+  const bool mClear;
+  std::vector<Patch>* mPatches;
+  const std::size_t mPlaneSize;
+  const std::size_t mChannelStride;
+  const double mInvTwoSigma2;
+  const int mRadius;
+  /**
+   * @brief mStepTable[j + mRadius] = exp(-k(2j + 1))，j在[-mRadius, mRadius]内
+   */
+  std::vector<double> mStepTable;
+  std::vector<float> mGaussX;
+  std::vector<float> mGaussY;
+};
+
+/**
+ * @brief 耗时以清零整块heatmap为主，每帧人数较少时与原实现相当，
+ * 人数较多时绘制部分更快，见tools/posec3d_benchmark中的实测结果
+ * @param clear 为false时heatmap应已全为0，只写入高斯核
+ * @param patches 非空时第i个线程写入的区域记录在(*patches)[i]中
+ */
+bool renderPoseHeatmap(const PoseSequence& poses,
+                       const std::vector<int>& frames,
+                       const PoseHeatmapParams& params, float* heatmap,
+                       std::size_t outNum, int threadNumber, bool clear,
+                       std::vector<std::vector<Patch>>* patches) {
+  std::size_t planeSize =
+      static_cast<std::size_t>(params.height) * params.width;
+  std::size_t clipSize = planeSize * params.channels * params.clipLen;
+  std::size_t half = outNum / 2;
+  if (clipSize == 0) return false;
+  std::size_t clips = half / clipSize;
+  std::size_t slotNumber = clips * params.clipLen;
+  if (frames.size() > slotNumber) return false;
+
+  std::vector<Slot> slots(slotNumber);
+  for (std::size_t i = 0; i < slotNumber; ++i) {
+    slots[i].frame = i < frames.size() ? frames[i] : -1;
+    slots[i].offset =
+        i / params.clipLen * clipSize + i % params.clipLen * planeSize;
+  }
+  if (clear) {
+    // 不足一个clip的尾部以及奇数个float的最后一个不属于任何采样位置
+    std::memset(heatmap + clips * clipSize, 0,
+                (half - clips * clipSize) * sizeof(float));
+    std::memset(heatmap + half + clips * clipSize, 0,
+                (outNum - half - clips * clipSize) * sizeof(float));
+  }
+
+  std::size_t workers =
+      std::min<std::size_t>(std::max(threadNumber, 1), slotNumber);
+  if (patches) {
+    patches->resize(std::max<std::size_t>(workers, 1));
+    for (auto& workerPatches : *patches) workerPatches.clear();
+  }
+  auto renderRange = [&](std::size_t worker, std::size_t begin,
+                         std::size_t end) {
+    SlotRenderer renderer(poses, params, heatmap, half, clear,
+                          patches ? &(*patches)[worker] : nullptr);
+    for (std::size_t i = begin; i < end; ++i) renderer.render(slots[i]);
+  };
+
+  if (workers <= 1) {
+    renderRange(0, 0, slotNumber);
+    return true;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  std::size_t step = (slotNumber + workers - 1) / workers;
+  for (std::size_t begin = step; begin < slotNumber; begin += step)
+    threads.emplace_back(renderRange, begin / step, begin,
+                         std::min(begin + step, slotNumber));
+  renderRange(0, 0, std::min(step, slotNumber));
+  for (auto& thread : threads) thread.join();
+  return true;
+}
+
+}  // namespace
+
+bool generatePoseHeatmap(const PoseSequence& poses,
+                         const std::vector<int>& frames,
+                         const PoseHeatmapParams& params, float* heatmap,
+                         std::size_t outNum, int threadNumber) {
+  return renderPoseHeatmap(poses, frames, params, heatmap, outNum,
+                           threadNumber, true, nullptr);
+}
+
+bool PoseHeatmapCanvas::generate(const PoseSequence& poses,
+                                 const std::vector<int>& frames,
+                                 const PoseHeatmapParams& params,
+                                 std::size_t outNum, int threadNumber) {
+  bool sameLayout = mData.size() == outNum &&
+                    mParams.channels == params.channels &&
+                    mParams.clipLen == params.clipLen &&
+                    mParams.height == params.height &&
+                    mParams.width == params.width;
+  if (!sameLayout) {
+    mData.assign(outNum, 0.f);
+    mPatches.clear();
+  }
+  mParams = params;
+
+  // 上一次之后只有高斯核覆盖的区域不为0
+  std::size_t half = outNum / 2;
+  float* heatmap = mData.data();
+  std::size_t dirty = 0;
+  for (const auto& workerPatches : mPatches) {
+    for (const Patch& patch : workerPatches)
+      dirty += static_cast<std::size_t>(patch.rows) * patch.width * 2;
+  }
+  // 区域较多时逐行随机清零比顺序清零整块更慢，退回到逐个采样位置清零
+  bool clear = dirty > outNum / DIRTY_FILL_RATIO;
+  if (!clear) {
+    for (const auto& workerPatches : mPatches) {
+      for (const Patch& patch : workerPatches) {
+        for (int y = 0; y < patch.rows; ++y) {
+          float* row = heatmap + patch.offset +
+                       static_cast<std::size_t>(y) * params.width;
+          std::memset(row, 0, patch.width * sizeof(float));
+          std::memset(row + half, 0, patch.width * sizeof(float));
+        }
+      }
+    }
+  }
+  mPatches.clear();
+  if (renderPoseHeatmap(poses, frames, params, heatmap, outNum, threadNumber,
+                        clear, &mPatches)) {
+    return true;
+  }
+  // 容量检查在写入之前，clear为true时上次的高斯核还没有被清零
+  if (clear) std::fill(mData.begin(), mData.end(), 0.f);
+  return false;
+}
+
+}  // namespace posec3d
+}  // namespace element
+}  // namespace sophon_stream
@@ -24,12 +24,11 @@ common::ErrorCode Posec3dInference::predict(
     common::ObjectMetadatas& objectMetadatas) {
   if (objectMetadatas.size() == 0) return common::ErrorCode::SUCCESS;
 
-  objectMetadatas[0]->mOutputBMtensors = getOutputDeviceMem(context);
-  int ret = context->bmNetwork->forward(
-      objectMetadatas[0]->mInputBMtensors->tensors,
-      objectMetadatas[0]->mOutputBMtensors->tensors);
-
+  // 每个主帧带有一个窗口的完整输入
   for (auto obj : objectMetadatas) {
+    obj->mOutputBMtensors = getOutputDeviceMem(context);
+    int ret = context->bmNetwork->forward(obj->mInputBMtensors->tensors,
+                                          obj->mOutputBMtensors->tensors);
     obj->mInputBMtensors = nullptr;
   }
 
@@ -23,10 +23,10 @@ namespace posec3d {
 void Posec3dPreProcess::init(std::shared_ptr<Posec3dContext> context) {}
 
 common::ErrorCode Posec3dPreProcess::uniformSampleFrames(
-    fpptr_dim3& sampled_keypoints, fpptr_dim3& sampled_keypoint_scores,
-    int clip_len, int num_clips, int seed) {
-  int num_frames = sampled_keypoints.size();
-  std::vector<int> inds;
+    int num_frames, std::vector<int>& inds, int clip_len, int num_clips,
+    int seed) {
+  inds.clear();
+  if (num_frames == 0) return common::ErrorCode::SUCCESS;
   srand(seed);
 
   // frame clip
@@ -60,21 +60,11 @@ common::ErrorCode Posec3dPreProcess::uniformSampleFrames(
     }
   }
 
-  // filter frames
-  for (int i = 0; i < inds.size(); i++) {
-    sampled_keypoints.push_back(sampled_keypoints[inds[i]]);
-    sampled_keypoint_scores.push_back(sampled_keypoint_scores[inds[i]]);
-  }
-  sampled_keypoints.erase(sampled_keypoints.begin(),
-                          sampled_keypoints.begin() + num_frames);
-  sampled_keypoint_scores.erase(sampled_keypoint_scores.begin(),
-                                sampled_keypoint_scores.begin() + num_frames);
-
   return common::ErrorCode::SUCCESS;
 }
 
 common::ErrorCode Posec3dPreProcess::poseCompact(
-    common::ObjectMetadatas& objectMetadatas, fpptr_dim3& keypoints,
+    common::ObjectMetadatas& objectMetadatas, PoseSequence& poses,
     float padding, int threshold, std::vector<float>& hw_ratio,
     std::vector<int>& new_shape, std::vector<float>& crop_quadruple,
     bool allow_imgpad) {
@@ -85,15 +75,12 @@ common::ErrorCode Posec3dPreProcess::poseCompact(
   new_shape.clear();
   new_shape.push_back(h);
   new_shape.push_back(w);
-  for (auto& obj : keypoints) {
-    for (int j = 0; j < obj->size(); j++) {
-      for (int i = 0; i < obj->at(j)->size(); i += 2) {
-        if (obj->at(j)->at(i) < min_x) min_x = obj->at(j)->at(i);
-        if (obj->at(j)->at(i + 1) < min_y) min_y = obj->at(j)->at(i + 1);
-        if (obj->at(j)->at(i) > max_x) max_x = obj->at(j)->at(i);
-        if (obj->at(j)->at(i + 1) > max_y) max_y = obj->at(j)->at(i + 1);
-      }
-    }
+  std::vector<float>& keypoints = poses.getAllKeypoints();
+  for (std::size_t i = 0; i < keypoints.size(); i += 2) {
+    min_x = std::min(min_x, keypoints[i]);
+    min_y = std::min(min_y, keypoints[i + 1]);
+    max_x = std::max(max_x, keypoints[i]);
+    max_y = std::max(max_y, keypoints[i + 1]);
   }
   if (max_x - min_x < threshold || max_y - min_y < threshold)
     return common::ErrorCode::SUCCESS;
@@ -126,13 +113,9 @@ common::ErrorCode Posec3dPreProcess::poseCompact(
     max_y = int(max_y);
   }
 
-  for (auto& obj : keypoints) {
-    for (int j = 0; j < obj->size(); j++) {
-      for (int i = 0; i < obj->at(j)->size(); i += 2) {
-        obj->at(j)->at(i) -= min_x;
-        obj->at(j)->at(i + 1) -= min_y;
-      }
-    }
+  for (std::size_t i = 0; i < keypoints.size(); i += 2) {
+    keypoints[i] -= min_x;
+    keypoints[i + 1] -= min_y;
   }
   new_shape[0] = int(max_y - min_y);
   new_shape[1] = int(max_x - min_x);
@@ -147,7 +130,7 @@ common::ErrorCode Posec3dPreProcess::poseCompact(
   return common::ErrorCode::SUCCESS;
 }
 
-common::ErrorCode Posec3dPreProcess::resize(fpptr_dim3& keypoints,
+common::ErrorCode Posec3dPreProcess::resize(PoseSequence& poses,
                                             std::vector<int>& scale,
                                             std::vector<int>& new_shape,
                                             bool keep_ratio) {
@@ -168,19 +151,16 @@ common::ErrorCode Posec3dPreProcess::resize(fpptr_dim3& keypoints,
   new_shape[0] = new_h;
   new_shape[1] = new_w;
 
-  for (auto& obj : keypoints) {
-    for (int j = 0; j < obj->size(); j++) {
-      for (int i = 0; i < obj->at(j)->size(); i += 2) {
-        obj->at(j)->at(i) *= scale_factor_x;
-        obj->at(j)->at(i + 1) *= scale_factor_y;
-      }
-    }
+  std::vector<float>& keypoints = poses.getAllKeypoints();
+  for (std::size_t i = 0; i < keypoints.size(); i += 2) {
+    keypoints[i] *= scale_factor_x;
+    keypoints[i + 1] *= scale_factor_y;
   }
   return common::ErrorCode::SUCCESS;
 }
 
 common::ErrorCode Posec3dPreProcess::centerCrop(
-    fpptr_dim3& keypoints, std::vector<int>& new_shape,
+    PoseSequence& poses, std::vector<int>& new_shape,
     std::vector<float>& crop_quadruple, std::vector<int>& crop_size) {
   int img_h = new_shape[0], img_w = new_shape[1];
   int crop_w = crop_size[0], crop_h = crop_size[1];
@@ -203,90 +183,47 @@ common::ErrorCode Posec3dPreProcess::centerCrop(
   crop_quadruple[2] = w_ratio * old_w_ratio;
   crop_quadruple[3] = h_ratio * old_h_ratio;
 
-  for (auto& obj : keypoints) {
-    for (int j = 0; j < obj->size(); j++) {
-      for (int i = 0; i < obj->at(j)->size(); i += 2) {
-        obj->at(j)->at(i) -= left;
-        obj->at(j)->at(i + 1) -= top;
-      }
-    }
+  std::vector<float>& keypoints = poses.getAllKeypoints();
+  for (std::size_t i = 0; i < keypoints.size(); i += 2) {
+    keypoints[i] -= left;
+    keypoints[i + 1] -= top;
   }
   return common::ErrorCode::SUCCESS;
 }
 
 common::ErrorCode Posec3dPreProcess::generatePoseTarget(
-    std::shared_ptr<Posec3dContext> context, fpptr_dim3& keypoints,
-    fpptr_dim3& sampled_keypoints, fpptr_dim3& sampled_keypoint_scores,
-    std::vector<int>& new_shape, float* heatmap, int out_num, float sigma,
-    float scaling, int clip_len) {
-  // gen an aug
-  const float eps = 1e-4;
+    std::shared_ptr<Posec3dContext> context, PoseSequence& poses,
+    const std::vector<int>& inds, std::vector<int>& new_shape, float* heatmap,
+    PoseHeatmapCanvas& canvas, int out_num, float sigma, float scaling,
+    int clip_len) {
   int img_h = new_shape[0], img_w = new_shape[1];
   // scale img_h, img_w and kps
   img_h = int(img_h * scaling + 0.5);
   img_w = int(img_w * scaling + 0.5);
-
-  int num_c = context->m_net_keypoints;
-  int num_frame = sampled_keypoints.size();
-  for (auto& obj : keypoints) {
-    for (int j = 0; j < obj->size(); j++) {
-      for (int i = 0; i < obj->at(j)->size(); i += 2) {
-        obj->at(j)->at(i) *= scaling;
-        obj->at(j)->at(i + 1) *= scaling;
-      }
-    }
+  if (scaling != 1.f) {
+    for (float& value : poses.getAllKeypoints()) value *= scaling;
   }
 
-  float* data = heatmap;
-  memset((void*)data, 0, out_num * sizeof(float));
-  int heatmap_start_indx = out_num / 2;
-  for (int i = 0; i < num_frame; i++) {
-    for (int j = 0; j < num_c; j++) {
-      for (int person_id = 0; person_id < sampled_keypoints[i]->size();
-           person_id++) {
-        if (sampled_keypoint_scores[i]->at(person_id)->at(j) < eps) continue;
-
-        float mu_x = sampled_keypoints[i]->at(person_id)->at(j * 2);
-        float mu_y = sampled_keypoints[i]->at(person_id)->at(j * 2 + 1);
-
-        int st_x = std::max(int(mu_x - 3 * sigma), 0);
-        int ed_x = std::min(int(mu_x + 3 * sigma) + 1, img_w);
-        int st_y = std::max(int(mu_y - 3 * sigma), 0);
-        int ed_y = std::min(int(mu_y + 3 * sigma) + 1, img_h);
-        if (st_x >= ed_x || st_y >= ed_y) continue;
-
-        float* base = data + i / clip_len * num_c * clip_len * img_h * img_w +
-                      j * clip_len * img_h * img_w +
-                      i % clip_len * img_h * img_w;
-        for (int patch_x = st_x; patch_x < ed_x; patch_x++)
-          for (int patch_y = st_y; patch_y < ed_y; patch_y++) {
-            float value = exp(-(std::pow(patch_x - mu_x, 2) +
-                                std::pow(patch_y - mu_y, 2)) /
-                              2 / std::pow(sigma, 2)) *
-                          sampled_keypoint_scores[i]->at(person_id)->at(j);
-            value *= context->input_scale;
-            if (value > *(base + patch_y * img_w + patch_x)) {
-              *(base + patch_y * img_w + patch_x) = value;
-              *(base + patch_y * img_w + patch_x + heatmap_start_indx) = value;
-              /*
-              // original implement
-              if (j == 0)
-                *(base + heatmap_start_indx + patch_y * img_w + img_w - patch_x
-              - 1) = value; else if (j % 2 == 0)
-                *(data + heatmap_start_indx + i / clip_len * num_c * clip_len *
-              img_h * img_w + (j - 1) * clip_len * img_h * img_w + i % clip_len
-              * img_h * img_w + patch_y * img_w + img_w - patch_x - 1) = value;
-              else if (j % 2 == 1)
-                *(data + heatmap_start_indx + i / clip_len * num_c * clip_len *
-              img_h * img_w + (j + 1) * clip_len * img_h * img_w + i % clip_len
-              * img_h * img_w + patch_y * img_w + img_w - patch_x - 1) = value;
-              */
-            }
-          }
-      }
-    }
+  PoseHeatmapParams params;
+  params.channels = context->m_net_keypoints;
+  params.clipLen = clip_len;
+  params.height = img_h;
+  params.width = img_w;
+  params.sigma = sigma;
+  params.scale = context->input_scale;
+  bool generated =
+      heatmap ? generatePoseHeatmap(poses, inds, params, heatmap, out_num,
+                                    context->heatmap_threads)
+              : canvas.generate(poses, inds, params, out_num,
+                                context->heatmap_threads);
+  if (!generated) {
+    IVS_ERROR(
+        "Posec3d heatmap of {0:d} frames does not fit the input tensor, "
+        "keypoints: {1:d}, clip_len: {2:d}, shape: {3:d}x{4:d}",
+        static_cast<int>(inds.size()), params.channels, clip_len, img_h,
+        img_w);
+    return common::ErrorCode::UNKNOWN;
   }
-
   return common::ErrorCode::SUCCESS;
 }
 
@@ -329,46 +266,29 @@ void Posec3dPreProcess::initTensors(std::shared_ptr<Posec3dContext> context,
 
 common::ErrorCode Posec3dPreProcess::preProcess(
     std::shared_ptr<Posec3dContext> context,
-    common::ObjectMetadatas& objectMetadatas) {
+    common::ObjectMetadatas& objectMetadatas, const PoseClipWindow& window,
+    PoseHeatmapCanvas& canvas) {
   if (objectMetadatas.size() == 0) return common::ErrorCode::SUCCESS;
   initTensors(context, objectMetadatas);
 
-  fpptr_dim3 keypoints;
-  fpptr_dim3 keypoint_scores;
-  fpptr_dim3 sampled_keypoints;
-  fpptr_dim3 sampled_keypoint_scores;
-  for (auto& obj : objectMetadatas) {
-    std::shared_ptr<fpptr_dim2> single_person_keypoints =
-        std::make_shared<fpptr_dim2>();
-    std::shared_ptr<fpptr_dim2> single_person_keypoint_scores =
-        std::make_shared<fpptr_dim2>();
-    for (auto& poseObj : obj->mPosedObjectMetadatas) {
-      single_person_keypoints->push_back(
-          std::make_shared<std::vector<float>>(poseObj->keypoints));
-      single_person_keypoint_scores->push_back(
-          std::make_shared<std::vector<float>>(poseObj->scores));
-    }
-    keypoints.push_back(single_person_keypoints);
-    keypoint_scores.push_back(single_person_keypoint_scores);
-  }
-  sampled_keypoints = keypoints;
-  sampled_keypoint_scores = keypoint_scores;
+  PoseSequence poses;
+  window.collect(poses, context->m_net_keypoints);
   int clip_len = 48, num_clips = 10;
 
   // upsample frames to get 480 objs
-  uniformSampleFrames(sampled_keypoints, sampled_keypoint_scores, clip_len,
-                      num_clips, 255);
+  std::vector<int> inds;
+  uniformSampleFrames(poses.getFrameNumber(), inds, clip_len, num_clips, 255);
   std::vector<float> hw_ratio = {1.0, 1.0};
   std::vector<int> new_shape;
   std::vector<float> crop_quadruple = {0, 0, 1, 1};
 
   // rescale anf shift keypoints
-  poseCompact(objectMetadatas, keypoints, 0.25, 10, hw_ratio, new_shape,
+  poseCompact(objectMetadatas, poses, 0.25, 10, hw_ratio, new_shape,
               crop_quadruple, true);
   std::vector<int> scale = {INT_MAX, 64};
-  resize(keypoints, scale, new_shape, true);
+  resize(poses, scale, new_shape, true);
   std::vector<int> crop_size = {64, 64};
-  centerCrop(keypoints, new_shape, crop_quadruple, crop_size);
+  centerCrop(poses, new_shape, crop_quadruple, crop_size);
   int out_num = context->m_net_crops_clips * context->m_net_channel *
                 context->m_net_keypoints * context->net_h * context->net_w;
   int size_byte = out_num * sizeof(float);
@@ -391,11 +311,12 @@ common::ErrorCode Posec3dPreProcess::preProcess(
     objectMetadatas[0]->mInputBMtensors->cpu_data.resize(1);
     objectMetadatas[0]->mInputBMtensors->cpu_data[0] = (float*)addr;
     heatmap = objectMetadatas[0]->mInputBMtensors->cpu_data[0];
-  } else
-    heatmap = new float[out_num];
-  generatePoseTarget(context, keypoints, sampled_keypoints,
-                     sampled_keypoint_scores, new_shape, heatmap, out_num, 0.6,
-                     1.0, clip_len);
+  }
+  // pcie模式下heatmap在canvas中生成，同一dataPipe复用，只清零上一次写入的区域
+  common::ErrorCode errorCode =
+      generatePoseTarget(context, poses, inds, new_shape, heatmap, canvas,
+                         out_num, 0.6, 1.0, clip_len);
+  if (errorCode != common::ErrorCode::SUCCESS) return errorCode;
 
   if (context->bmNetwork->is_soc)
     assert(BM_SUCCESS ==
@@ -407,8 +328,7 @@ common::ErrorCode Posec3dPreProcess::preProcess(
            bm_memcpy_s2d(
                context->handle,
                objectMetadatas[0]->mInputBMtensors->tensors[0]->device_mem,
-               (void*)heatmap));
-    delete[] heatmap;
+               (void*)canvas.data()));
   }
 
   objectMetadatas[0]->is_main = true;
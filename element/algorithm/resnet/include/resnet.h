@@ -48,6 +48,8 @@ class ResNet : public ::sophon_stream::framework::Element {
   static constexpr const char* CONFIG_INTERNAL_CLASS_THRESH_FIELD =
       "class_thresh";
 
+  static constexpr const char* CONFIG_INTERNAL_MAX_BATCH_WAIT_US_FIELD =
+      "max_batch_wait_us";
  private:
   std::shared_ptr<ResNetContext> mContext;      // context对象
   std::shared_ptr<ResNetMultiTask> mMultiTask;  // 推理对象
@@ -55,6 +57,12 @@ class ResNet : public ::sophon_stream::framework::Element {
 
   ::sophon_stream::common::FpsProfiler mFpsProfiler;
 
+  /**
+   * @brief 第一次doWork时按context创建，每个dataPipe暂存的数据跨doWork保留
+   */
+  std::unique_ptr<BatchAssembler> mBatchAssembler;
+  std::once_flag mBatchAssemblerFlag;
+
   common::ErrorCode initContext(const std::string& json);
   void process(common::ObjectMetadatas& objectMetadatas);
 };
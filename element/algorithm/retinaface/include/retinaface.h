@@ -91,6 +91,8 @@ class Retinaface : public ::sophon_stream::framework::Element {
   static constexpr const char* CONFIG_INTERNAL_SCORE_THRESHOLD_FIELD =
       "score_threshold";
 
+  static constexpr const char* CONFIG_INTERNAL_MAX_BATCH_WAIT_US_FIELD =
+      "max_batch_wait_us";
  private:
   std::shared_ptr<RetinafaceContext> mContext;          // context对象
   std::shared_ptr<RetinafacePreProcess> mPreProcess;    // 预处理对象
@@ -104,6 +106,12 @@ class Retinaface : public ::sophon_stream::framework::Element {
   std::string mFpsProfilerName;
   ::sophon_stream::common::FpsProfiler mFpsProfiler;
 
+  /**
+   * @brief 第一次doWork时按context创建，每个dataPipe暂存的数据跨doWork保留
+   */
+  std::unique_ptr<BatchAssembler> mBatchAssembler;
+  std::once_flag mBatchAssemblerFlag;
+
   common::ErrorCode initContext(const std::string& json);
   void process(common::ObjectMetadatas& objectMetadatas);
 };
@@ -129,10 +129,10 @@ namespace template {
     while (objectMetadatas.size() < mContext->max_batch &&
            (getThreadStatus() == ThreadStatus::RUN)) {
       // 如果队列为空则等待
-      auto data = popInputData(inputPort, dataPipeId);
+      auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
       if (!data) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        continue;
+        if (shouldWaitInputData()) continue;
+        break;
       }
 
       auto objectMetadata =
@@ -82,7 +82,17 @@ class Yolov5 : public ::sophon_stream::framework::Element {
   static constexpr const char* CONFIG_INTERNAL_HEIGHT_FILED = "height";
   static constexpr const char* CONFIG_INTERNAL_MAX_DET_FILED = "maxdet";
   static constexpr const char* CONFIG_INTERNAL_MIN_DET_FILED = "mindet";
-
+  static constexpr const char* CONFIG_INTERNAL_POST_THREAD_NUMBER_FIELD =
+      "post_thread_number";
+  static constexpr const char* CONFIG_INTERNAL_POST_QUEUE_DEPTH_FIELD =
+      "post_queue_depth";
+  static constexpr const char* CONFIG_INTERNAL_DEVICE_MEMORY_POOL_MB_FIELD =
+      "device_memory_pool_mb";
+  static constexpr const char* CONFIG_INTERNAL_OUTPUT_TENSOR_VIEWS_FIELD =
+      "output_tensor_views";
+
+  static constexpr const char* CONFIG_INTERNAL_MAX_BATCH_WAIT_US_FIELD =
+      "max_batch_wait_us";
  private:
   std::shared_ptr<Yolov5Context> mContext;          // context对象
   std::shared_ptr<Yolov5PreProcess> mPreProcess;    // 预处理对象
@@ -96,8 +106,23 @@ class Yolov5 : public ::sophon_stream::framework::Element {
   std::string mFpsProfilerName;
   ::sophon_stream::common::FpsProfiler mFpsProfiler;
 
+  /**
+   * @brief 第一次doWork时按context创建，每个dataPipe暂存的数据跨doWork保留
+   */
+  std::unique_ptr<BatchAssembler> mBatchAssembler;
+  std::once_flag mBatchAssemblerFlag;
+
   common::ErrorCode initContext(const std::string& json);
-  void process(common::ObjectMetadatas& objectMetadatas, int dataPipeId);
+  /**
+   * @brief 执行当前element负责的阶段，配置了后处理线程池时不在这里做后处理
+   */
+  common::ErrorCode process(common::ObjectMetadatas& objectMetadatas,
+                            int dataPipeId);
+  void pushObjectMetadatas(int outputPort,
+                           const common::ObjectMetadatas& objectMetadatas);
+
+  void onStart() override;
+  void onStop() override;
 };
 
 }  // namespace yolov5
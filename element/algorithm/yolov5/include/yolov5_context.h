@@ -10,7 +10,10 @@
 #ifndef SOPHON_STREAM_ELEMENT_YOLOV5_CONTEXT_H_
 #define SOPHON_STREAM_ELEMENT_YOLOV5_CONTEXT_H_
 
+#include "algorithmApi/bm_device_memory_allocator.h"
 #include "algorithmApi/context.h"
+#include "algorithmApi/post_process_pool.h"
+#include "common/metrics.h"
 
 namespace sophon_stream {
 namespace element {
@@ -82,8 +85,16 @@ class Yolov5Context : public ::sophon_stream::element::Context {
 
   bmcv_rect_t roi;
   bool roi_predefined = false;
-  int thread_number;
+  int thread_number;  // 需要独占tpu_kernel资源的线程数
   unsigned int m_max_det = UINT_MAX, m_min_det = 0;
+
+  // 后处理线程池，post_thread_number > 0时创建，推理线程只提交后处理，不等待其完成
+  int post_thread_number = 0;
+  int post_queue_depth = 0;
+  std::shared_ptr<PostProcessPool> postProcessPool;
+  // 每个batch的推理耗时，其累计值的变化率即TPU的忙碌比例
+  std::shared_ptr<common::LatencyHistogram> inferTimeHistogram =
+      std::make_shared<common::LatencyHistogram>();
 };
 }  // namespace yolov5
 }  // namespace element
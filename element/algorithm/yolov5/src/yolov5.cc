@@ -201,7 +201,41 @@ common::ErrorCode Yolov5::initContext(const std::string& json) {
       mContext->roi.crop_h =
           roi_it->find(CONFIG_INTERNAL_HEIGHT_FILED)->get<int>();
     }
-    mContext->thread_number = getThreadNumber();
+    // 8. post process pool
+    auto postThreadNumberIt =
+        configure.find(CONFIG_INTERNAL_POST_THREAD_NUMBER_FIELD);
+    if (configure.end() != postThreadNumberIt &&
+        postThreadNumberIt->is_number_integer()) {
+      mContext->post_thread_number = postThreadNumberIt->get<int>();
+    }
+    auto postQueueDepthIt =
+        configure.find(CONFIG_INTERNAL_POST_QUEUE_DEPTH_FIELD);
+    if (configure.end() != postQueueDepthIt &&
+        postQueueDepthIt->is_number_integer()) {
+      mContext->post_queue_depth = postQueueDepthIt->get<int>();
+    }
+    // 线程池中的每个后处理线程也需要一份tpu_kernel资源
+    mContext->thread_number =
+        std::max(getThreadNumber(), mContext->post_thread_number);
+    if (mContext->post_thread_number > 0) {
+      mContext->postProcessPool = std::make_shared<PostProcessPool>(
+          mContext->post_thread_number, mContext->post_queue_depth,
+          getThreadNumber());
+      mContext->postProcessPool->start();
+    }
+    // 9. device memory pool
+    int poolMb =
+        configure.value(CONFIG_INTERNAL_DEVICE_MEMORY_POOL_MB_FIELD, 0);
+    if (poolMb > 0) {
+      mContext->deviceMemoryPool = std::make_shared<DeviceMemoryPool>(
+          std::make_shared<BmDeviceMemoryAllocator>(handle, STREAM_NPU_HEAP),
+          static_cast<std::size_t>(poolMb) << 20);
+    }
+    mContext->outputTensorViews =
+        configure.value(CONFIG_INTERNAL_OUTPUT_TENSOR_VIEWS_FIELD, false);
+    // 10. dynamic batch
+    mContext->maxBatchWaitUs =
+        configure.value(CONFIG_INTERNAL_MAX_BATCH_WAIT_US_FIELD, -1);
   } while (false);
   return common::ErrorCode::SUCCESS;
 }
@@ -259,7 +293,8 @@ common::ErrorCode Yolov5::initInternal(const std::string& json) {
   return errorCode;
 }
 
-void Yolov5::process(common::ObjectMetadatas& objectMetadatas, int dataPipeId) {
+common::ErrorCode Yolov5::process(common::ObjectMetadatas& objectMetadatas,
+                                  int dataPipeId) {
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
   if (use_pre) {
     errorCode = mPreProcess->preProcess(mContext, objectMetadatas);
@@ -267,22 +302,48 @@ void Yolov5::process(common::ObjectMetadatas& objectMetadatas, int dataPipeId) {
       for (unsigned i = 0; i < objectMetadatas.size(); i++) {
         objectMetadatas[i]->mErrorCode = errorCode;
       }
-      return;
+      return errorCode;
     }
   }
   // 推理
   if (use_infer) {
+    auto inferBegin = std::chrono::steady_clock::now();
     errorCode = mInference->predict(mContext, objectMetadatas);
+    if (!objectMetadatas.empty()) {
+      mContext->inferTimeHistogram->observe(std::chrono::steady_clock::now() -
+                                            inferBegin);
+    }
     if (common::ErrorCode::SUCCESS != errorCode) {
       for (unsigned i = 0; i < objectMetadatas.size(); i++) {
         objectMetadatas[i]->mErrorCode = errorCode;
       }
-      return;
+      return errorCode;
     }
   }
-  // 后处理
-  if (use_post)
+  // 后处理，配置了线程池时由doWork提交
+  if (use_post && !mContext->postProcessPool)
     mPostProcess->postProcess(mContext, objectMetadatas, dataPipeId);
+  return errorCode;
+}
+
+void Yolov5::pushObjectMetadatas(
+    int outputPort, const common::ObjectMetadatas& objectMetadatas) {
+  for (auto& objectMetadata : objectMetadatas) {
+    int channel_id_internal = objectMetadata->mFrame->mChannelIdInternal;
+    int outDataPipeId =
+        getSinkElementFlag()
+            ? 0
+            : (channel_id_internal % getOutputConnectorCapacity(outputPort));
+    common::ErrorCode errorCode =
+        pushOutputData(outputPort, outDataPipeId,
+                       std::static_pointer_cast<void>(objectMetadata));
+    if (common::ErrorCode::SUCCESS != errorCode) {
+      IVS_WARN(
+          "Send data fail, element id: {0:d}, output port: {1:d}, data: "
+          "{2:p}",
+          getId(), outputPort, static_cast<void*>(objectMetadata.get()));
+    }
+  }
 }
 
 common::ErrorCode Yolov5::doWork(int dataPipeId) {
@@ -299,46 +360,93 @@ common::ErrorCode Yolov5::doWork(int dataPipeId) {
 
   common::ObjectMetadatas pendingObjectMetadatas;
 
-  while (objectMetadatas.size() < mContext->max_batch &&
-         (getThreadStatus() == ThreadStatus::RUN)) {
-    // 如果队列为空则等待
-    auto data = popInputData(inputPort, dataPipeId);
-    if (!data) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
-    }
+  std::call_once(mBatchAssemblerFlag, [this]() {
+    const auto& batches = mContext->bmNetwork->m_batches;
+    mBatchAssembler = std::make_unique<BatchAssembler>(
+        std::vector<int>(batches.begin(), batches.end()),
+        std::chrono::microseconds(mContext->maxBatchWaitUs), getThreadNumber(),
+        BatchAssembler::getMetadataInfo<common::ObjectMetadata>);
+  });
+  // 凑满batch、等待超过max_batch_wait_us或遇到码流结束帧时返回
+  auto batch = mBatchAssembler->assemble(
+      dataPipeId,
+      [&](std::chrono::microseconds timeout) {
+        return timeout.count() > 0
+                   ? popInputData(inputPort, dataPipeId, timeout)
+                   : popInputData(inputPort, dataPipeId);
+      },
+      [this]() { return shouldWaitInputData(); });
+  for (auto& data : batch.items)
+    objectMetadatas.push_back(
+        std::static_pointer_cast<common::ObjectMetadata>(data));
+  for (auto& data : batch.all)
+    pendingObjectMetadatas.push_back(
+        std::static_pointer_cast<common::ObjectMetadata>(data));
+
+  errorCode = process(objectMetadatas, dataPipeId);
+
+  auto postProcessPool = mContext->postProcessPool;
+  if (use_post && postProcessPool) {
+    // 后处理和推送交给线程池，当前线程立即返回取下一个batch；
+    // 同一dataPipe的batch按提交顺序推送，保持每一路码流内的顺序
+    bool needPost = common::ErrorCode::SUCCESS == errorCode;
+    postProcessPool->submit(
+        dataPipeId,
+        [this, objectMetadatas, needPost](int workerId) mutable {
+          if (needPost)
+            mPostProcess->postProcess(mContext, objectMetadatas, workerId);
+        },
+        [this, outputPort, pendingObjectMetadatas,
+         processed = objectMetadatas.size()]() {
+          pushObjectMetadatas(outputPort, pendingObjectMetadatas);
+          mFpsProfiler.add(processed);
+        });
+    return common::ErrorCode::SUCCESS;
+  }
 
-    auto objectMetadata =
-        std::static_pointer_cast<common::ObjectMetadata>(data);
-    if (!objectMetadata->mFilter) objectMetadatas.push_back(objectMetadata);
+  pushObjectMetadatas(outputPort, pendingObjectMetadatas);
+  mFpsProfiler.add(objectMetadatas.size());
 
-    pendingObjectMetadatas.push_back(objectMetadata);
+  return common::ErrorCode::SUCCESS;
+}
 
-    if (objectMetadata->mFrame->mEndOfStream) {
-      break;
-    }
+void Yolov5::onStart() {
+  auto& registry = common::MetricsRegistry::getInstance();
+  common::MetricLabels labels = getMetricLabels();
+  if (use_infer) {
+    registry.addHistogram("sophon_stream_inference_seconds",
+                          "Time spent in model inference per batch. The rate "
+                          "of its sum is the fraction of time the TPU is busy "
+                          "with this element.",
+                          labels, mContext->inferTimeHistogram);
   }
-
-  process(objectMetadatas, dataPipeId);
-
-  for (auto& objectMetadata : pendingObjectMetadatas) {
-    int channel_id_internal = objectMetadata->mFrame->mChannelIdInternal;
-    int outDataPipeId =
-        getSinkElementFlag()
-            ? 0
-            : (channel_id_internal % getOutputConnectorCapacity(outputPort));
-    errorCode = pushOutputData(outputPort, outDataPipeId,
-                               std::static_pointer_cast<void>(objectMetadata));
-    if (common::ErrorCode::SUCCESS != errorCode) {
-      IVS_WARN(
-          "Send data fail, element id: {0:d}, output port: {1:d}, data: "
-          "{2:p}",
-          getId(), outputPort, static_cast<void*>(objectMetadata.get()));
-    }
+  if (use_post && mContext->postProcessPool) {
+    std::weak_ptr<PostProcessPool> weakPool = mContext->postProcessPool;
+    registry.addGauge("sophon_stream_postprocess_pool_in_flight",
+                      "Batches submitted to the post-processing pool and not "
+                      "yet pushed downstream.",
+                      labels, [weakPool](double& value) {
+                        auto pool = weakPool.lock();
+                        if (!pool) return false;
+                        value = pool->getInFlight();
+                        return true;
+                      });
+    registry.addCounter("sophon_stream_postprocess_pool_busy_seconds_total",
+                        "Time the post-processing pool threads spent running "
+                        "post-processing.",
+                        labels, [weakPool](double& value) {
+                          auto pool = weakPool.lock();
+                          if (!pool) return false;
+                          value = pool->getBusySeconds();
+                          return true;
+                        });
   }
-  mFpsProfiler.add(objectMetadatas.size());
+}
 
-  return common::ErrorCode::SUCCESS;
+void Yolov5::onStop() {
+  // 等待已提交的后处理推送完成，之后element可以安全析构
+  if (use_post && mContext->postProcessPool)
+    mContext->postProcessPool->drain();
 }
 
 void Yolov5::setStage(bool pre, bool infer, bool post) {
@@ -11,6 +11,7 @@
 #define SOPHON_STREAM_ELEMENT_YOLOV7_POST_PROCESS_H_
 
 #include "algorithmApi/post_process.h"
+#include "algorithmApi/yolo_decode.h"
 #include "yolov7_context.h"
 
 namespace sophon_stream {
@@ -52,9 +53,6 @@ class Yolov7PostProcess : public ::sophon_stream::element::PostProcess {
   void setTpuKernelMem(std::shared_ptr<Yolov7Context> context,
                        common::ObjectMetadatas& objectMetadatas,
                        tpu_kernel& tpu_k);
-  float sigmoid(float x);
-  int argmax(float* data, int num);
-  void NMS(YoloV7BoxVec& dets, float nmsConfidence);
   void postProcessCPU(std::shared_ptr<Yolov7Context> context,
                       common::ObjectMetadatas& objectMetadatas);
   void postProcessTPUKERNEL(std::shared_ptr<Yolov7Context> context,
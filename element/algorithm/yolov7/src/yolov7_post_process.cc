@@ -9,6 +9,8 @@
 
 #include "yolov7_post_process.h"
 
+#include "common/object_pool.h"
+
 namespace sophon_stream {
 namespace element {
 namespace yolov7 {
@@ -79,58 +81,6 @@ Yolov7PostProcess::~Yolov7PostProcess() {
   }
 }
 
-int Yolov7PostProcess::argmax(float* data, int num) {
-  float max_value = 0.0;
-  int max_index = 0;
-  for (int i = 0; i < num; ++i) {
-    float value = data[i];
-    if (value > max_value) {
-      max_value = value;
-      max_index = i;
-    }
-  }
-
-  return max_index;
-}
-
-float Yolov7PostProcess::sigmoid(float x) { return 1.0 / (1 + expf(-x)); }
-
-void Yolov7PostProcess::NMS(YoloV7BoxVec& dets, float nmsConfidence) {
-  int length = dets.size();
-  int index = length - 1;
-
-  std::sort(
-      dets.begin(), dets.end(),
-      [](const YoloV7Box& a, const YoloV7Box& b) { return a.score < b.score; });
-
-  std::vector<float> areas(length);
-  for (int i = 0; i < length; i++) {
-    areas[i] = dets[i].width * dets[i].height;
-  }
-
-  while (index > 0) {
-    int i = 0;
-    while (i < index) {
-      float left = std::max(dets[index].x, dets[i].x);
-      float top = std::max(dets[index].y, dets[i].y);
-      float right = std::min(dets[index].x + dets[index].width,
-                             dets[i].x + dets[i].width);
-      float bottom = std::min(dets[index].y + dets[index].height,
-                              dets[i].y + dets[i].height);
-      float overlap =
-          std::max(0.0f, right - left) * std::max(0.0f, bottom - top);
-      if (overlap / (areas[index] + areas[i] - overlap) > nmsConfidence) {
-        areas.erase(areas.begin() + i);
-        dets.erase(dets.begin() + i);
-        index--;
-      } else {
-        i++;
-      }
-    }
-    index--;
-  }
-}
-
 void Yolov7PostProcess::setTpuKernelMem(
     std::shared_ptr<Yolov7Context> context,
     common::ObjectMetadatas& objectMetadatas, tpu_kernel& tpu_k) {
@@ -140,7 +90,7 @@ void Yolov7PostProcess::setTpuKernelMem(
   std::vector<std::vector<std::shared_ptr<bm_device_mem_t>>> in_dev_mems(
       context->max_batch,
       std::vector<std::shared_ptr<bm_device_mem_t>>(input_num));
-  for (int batch_idx = 0; batch_idx < context->max_batch; ++batch_idx) {
+  for (int batch_idx = 0; batch_idx < objectMetadatas.size(); ++batch_idx) {
     if (objectMetadatas[batch_idx]->mFrame->mEndOfStream) break;
     for (int i = 0; i < input_num; i++)
       in_dev_mems[batch_idx][i] = std::make_shared<bm_device_mem_t>(
@@ -182,7 +132,7 @@ void Yolov7PostProcess::postProcessTPUKERNEL(
     common::ObjectMetadatas& objectMetadatas, int dataPipeId) {
   tpu_kernel& tpu_k = multi_thread_tpu_kernel[dataPipeId];
   setTpuKernelMem(context, objectMetadatas, tpu_k);
-  for (int i = 0; i < context->max_batch; i++) {
+  for (int i = 0; i < objectMetadatas.size(); i++) {
     if (objectMetadatas[i]->mFrame->mEndOfStream) break;
     bm_image image = *objectMetadatas[i]->mFrame->mSpData;
     int tx1 = 0, ty1 = 0;
@@ -246,7 +196,7 @@ void Yolov7PostProcess::postProcessTPUKERNEL(
       temp_bbox.y = std::max(int(centerY - temp_bbox.height / 2), 0);
 
       std::shared_ptr<common::DetectedObjectMetadata> detData =
-          std::make_shared<common::DetectedObjectMetadata>();
+          common::makePooled<common::DetectedObjectMetadata>();
       detData->mBox.mX = temp_bbox.x;
       detData->mBox.mY = temp_bbox.y;
       detData->mBox.mWidth = temp_bbox.width;
@@ -266,7 +216,10 @@ void Yolov7PostProcess::postProcessCPU(
     std::shared_ptr<Yolov7Context> context,
     common::ObjectMetadatas& objectMetadatas) {
   if (objectMetadatas.size() == 0) return;
-  YoloV7BoxVec yolobox_vec;
+  YoloDecodeConfig config = makeYoloDecodeConfig(*context);
+  config.agnostic = true;
+  YoloDecoder decoder(config);
+  std::vector<YoloDetection> detections;
   int idx = 0;
   for (auto obj : objectMetadatas) {
     if (obj->mFrame->mEndOfStream) break;
@@ -279,7 +232,7 @@ void Yolov7PostProcess::postProcessCPU(
           obj->mOutputBMtensors->tensors[i].get(), context->bmNetwork->is_soc);
     }
 
-    yolobox_vec.clear();
+    decoder.clear();
     int frame_width = obj->mFrame->mSpData->width;
     int frame_height = obj->mFrame->mSpData->height;
 
@@ -327,9 +280,6 @@ void Yolov7PostProcess::postProcessCPU(
     auto out_tensor = outputTensors[min_idx];
     int nout = out_tensor->get_shape()->dims[context->min_dim - 1];
 
-    float* output_data = nullptr;
-    std::vector<float> decoded_data;
-
     if (context->min_dim == 3 && context->output_num != 1) {
       std::cout << "--> WARNING: the current bmodel has redundant outputs"
                 << std::endl;
@@ -346,109 +296,45 @@ void Yolov7PostProcess::postProcessCPU(
       const int anchor_num = anchors[0].size();
       assert(context->output_num == (int)anchors.size());
       assert(box_num > 0);
-      if ((int)decoded_data.size() != box_num * nout) {
-        decoded_data.resize(box_num * nout);
-      }
-      float* dst = decoded_data.data();
       for (int tidx = 0; tidx < context->output_num; ++tidx) {
         auto output_tensor = outputTensors[tidx];
         int feat_c = output_tensor->get_shape()->dims[1];
         int feat_h = output_tensor->get_shape()->dims[2];
         int feat_w = output_tensor->get_shape()->dims[3];
-        int area = feat_h * feat_w;
         assert(feat_c == anchor_num);
-        int feature_size = feat_h * feat_w * nout;
-        float* tensor_data = (float*)output_tensor->get_cpu_data();
-
-        for (int anchor_idx = 0; anchor_idx < anchor_num; anchor_idx++) {
-          float* ptr = tensor_data + anchor_idx * feature_size;
-          for (int i = 0; i < area; i++) {
-            float score = sigmoid(ptr[4]);
-            if (score >= context->thresh_conf_min) {
-              int class_id = argmax(&ptr[5], context->class_num);
-              float confidence = sigmoid(ptr[class_id + 5]);
-              float cur_class_thresh =
-                  context->class_thresh_valid
-                      ? context->thresh_conf[context->class_names[class_id]]
-                      : context->thresh_conf_min;
-              if (confidence * score >= cur_class_thresh) {
-                dst[0] = (sigmoid(ptr[0]) * 2 - 0.5 + i % feat_w) / feat_w *
-                         context->net_w;
-                dst[1] = (sigmoid(ptr[1]) * 2 - 0.5 + i / feat_w) / feat_h *
-                         context->net_h;
-                dst[2] = pow((sigmoid(ptr[2]) * 2), 2) *
-                         anchors[tidx][anchor_idx][0];
-                dst[3] = pow((sigmoid(ptr[3]) * 2), 2) *
-                         anchors[tidx][anchor_idx][1];
-                for (int d = 5; d < nout; d++) {
-                  dst[d] = sigmoid(ptr[d]);
-                }
-                float centerX = (dst[0] + 1 - tx1) / ratio - 1;
-                float centerY = (dst[1] + 1 - ty1) / ratio - 1;
-                float width = (dst[2] + 0.5) / ratio;
-                float height = (dst[3] + 0.5) / ratio;
-
-                YoloV7Box box;
-                box.x = int(centerX - width / 2);
-                if (box.x < 0) box.x = 0;
-                box.y = int(centerY - height / 2);
-                if (box.y < 0) box.y = 0;
-                box.width = width;
-                box.height = height;
-                box.class_id = class_id;
-                box.score = confidence * score;
-                yolobox_vec.push_back(box);
-              }
-            }
-            dst += nout;
-            ptr += nout;
-          }
-        }
+        decoder.decodeAnchorGrid((float*)output_tensor->get_cpu_data(), feat_h,
+                                 feat_w, nout, anchors[tidx], context->net_w,
+                                 context->net_h);
       }
-      output_data = decoded_data.data();
     } else {
       assert(box_num == 0 || box_num == out_tensor->get_shape()->dims[1]);
       box_num = out_tensor->get_shape()->dims[1];
-      output_data = (float*)out_tensor->get_cpu_data();
-      for (int i = 0; i < box_num; i++) {
-        float* ptr = output_data + i * nout;
-        float score = ptr[4];
-        int class_id = argmax(&ptr[5], context->class_num);
-        float confidence = ptr[class_id + 5];
-        if (confidence * score >
-            (context->class_thresh_valid
-                 ? context->thresh_conf[context->class_names[class_id]]
-                 : context->thresh_conf_min)) {
-          float centerX = (ptr[0] + 1 - tx1) / ratio - 1;
-          float centerY = (ptr[1] + 1 - ty1) / ratio - 1;
-          float width = (ptr[2] + 0.5) / ratio;
-          float height = (ptr[3] + 0.5) / ratio;
-
-          YoloV7Box box;
-          box.x = int(centerX - width / 2);
-          if (box.x < 0) box.x = 0;
-          box.y = int(centerY - height / 2);
-          if (box.y < 0) box.y = 0;
-          box.width = width;
-          box.height = height;
-          box.class_id = class_id;
-          box.score = confidence * score;
-          yolobox_vec.push_back(box);
-        }
-      }
+      decoder.decodeRows((float*)out_tensor->get_cpu_data(), box_num, nout,
+                         true);
     }
 
-    NMS(yolobox_vec, context->thresh_nms);
+    // 与原实现一致，先换算到原图上的整数像素框，再做不区分类别的NMS
+    for (auto& det : decoder.candidates()) {
+      float centerX = ((det.x1 + det.x2) / 2 + 1 - tx1) / ratio - 1;
+      float centerY = ((det.y1 + det.y2) / 2 + 1 - ty1) / ratio - 1;
+      float width = (det.x2 - det.x1 + 0.5) / ratio;
+      float height = (det.y2 - det.y1 + 0.5) / ratio;
+      det.x1 = std::max(int(centerX - width / 2), 0);
+      det.y1 = std::max(int(centerY - height / 2), 0);
+      det.x2 = det.x1 + int(width);
+      det.y2 = det.y1 + int(height);
+    }
+    decoder.nms(detections);
 
-    for (auto bbox : yolobox_vec) {
+    for (const auto& det : detections) {
       std::shared_ptr<common::DetectedObjectMetadata> detData =
-          std::make_shared<common::DetectedObjectMetadata>();
-      detData->mBox.mX = bbox.x;
-      detData->mBox.mY = bbox.y;
-      detData->mBox.mWidth = bbox.width;
-      detData->mBox.mHeight = bbox.height;
-      detData->mScores.push_back(bbox.score);
-      detData->mClassify = bbox.class_id;
+          common::makePooled<common::DetectedObjectMetadata>();
+      detData->mBox.mX = det.x1;
+      detData->mBox.mY = det.y1;
+      detData->mBox.mWidth = det.x2 - det.x1;
+      detData->mBox.mHeight = det.y2 - det.y1;
+      detData->mScores.push_back(det.score);
+      detData->mClassify = det.classId;
 
       if (context->roi_predefined) {
         detData->mBox.mX += context->roi.start_x;
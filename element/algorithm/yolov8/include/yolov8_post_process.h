@@ -11,6 +11,7 @@
 #define SOPHON_STREAM_ELEMENT_YOLOV8_POST_PROCESS_H_
 
 #include "algorithmApi/post_process.h"
+#include "algorithmApi/yolo_decode.h"
 #include "yolov8_context.h"
 
 namespace sophon_stream {
@@ -43,6 +44,13 @@ class Yolov8PostProcess : public ::sophon_stream::element::PostProcess {
   float sigmoid(float x);
   int argmax(float* data, int num);
   void NMS(YoloV8BoxVec& dets, float nmsConfidence);
+  YoloDecodeConfig makeDecodeConfig(std::shared_ptr<Yolov8Context> context);
+  /**
+   * @brief 对decoder中的候选框做NMS，结果按分数从高到低转换为YoloV8Box
+   */
+  void collectBoxes(YoloDecoder& decoder,
+                    std::vector<YoloDetection>& detections,
+                    YoloV8BoxVec& yolobox_vec);
   void postProcessDet(std::shared_ptr<Yolov8Context> context,
                       common::ObjectMetadatas& objectMetadatas);
   void postProcessDetOpt(std::shared_ptr<Yolov8Context> context,
@@ -10,6 +10,8 @@
 
 #include "yolov8_post_process.h"
 
+#include "common/object_pool.h"
+
 namespace sophon_stream {
 namespace element {
 namespace yolov8 {
@@ -107,6 +109,40 @@ void Yolov8PostProcess::clip_boxes(YoloV8BoxVec& yolobox_vec, int src_w,
   }
 }
 
+YoloDecodeConfig Yolov8PostProcess::makeDecodeConfig(
+    std::shared_ptr<Yolov8Context> context) {
+  YoloDecodeConfig config = makeYoloDecodeConfig(*context);
+  config.maxDet = max_det;
+  return config;
+}
+
+void Yolov8PostProcess::collectBoxes(YoloDecoder& decoder,
+                                     std::vector<YoloDetection>& detections,
+                                     YoloV8BoxVec& yolobox_vec) {
+  // 与原实现一致，在整数像素的框上做NMS
+  for (auto& det : decoder.candidates()) {
+    int x1 = det.x1;
+    int y1 = det.y1;
+    det.x2 = int(x1 + (det.x2 - det.x1));
+    det.y2 = int(y1 + (det.y2 - det.y1));
+    det.x1 = x1;
+    det.y1 = y1;
+  }
+  decoder.nms(detections);
+
+  yolobox_vec.clear();
+  for (const auto& det : detections) {
+    YoloV8Box box;
+    box.x1 = det.x1;
+    box.y1 = det.y1;
+    box.x2 = det.x2;
+    box.y2 = det.y2;
+    box.score = det.score;
+    box.class_id = det.classId;
+    yolobox_vec.push_back(box);
+  }
+}
+
 void Yolov8PostProcess::postProcessCls(
     std::shared_ptr<Yolov8Context> context,
     common::ObjectMetadatas& objectMetadatas) {
@@ -259,7 +295,7 @@ void Yolov8PostProcess::postProcessPose(
 
     for (auto bbox : yolobox_vec) {
       std::shared_ptr<common::DetectedObjectMetadata> detData =
-          std::make_shared<common::DetectedObjectMetadata>();
+          common::makePooled<common::DetectedObjectMetadata>();
 
       detData->mBox.mX = bbox.x1 - PATCH;
       detData->mBox.mY = bbox.y1 - PATCH;
@@ -291,6 +327,8 @@ void Yolov8PostProcess::postProcessDetOpt(
     std::shared_ptr<Yolov8Context> context,
     common::ObjectMetadatas& objectMetadatas) {
   YoloV8BoxVec yolobox_vec;
+  YoloDecoder decoder(makeDecodeConfig(context));
+  std::vector<YoloDetection> detections;
   int idx = 0;
   for (auto obj : objectMetadatas) {
     if (obj->mFrame->mEndOfStream) break;
@@ -302,7 +340,7 @@ void Yolov8PostProcess::postProcessDetOpt(
           context->bmNetwork->m_netinfo->output_scales[i],
           obj->mOutputBMtensors->tensors[i].get(), context->bmNetwork->is_soc);
     }
-    yolobox_vec.clear();
+    decoder.clear();
     int frame_width = obj->mFrame->mSpData->width;
     int frame_height = obj->mFrame->mSpData->height;
     int tx1 = 0, ty1 = 0;
@@ -331,7 +369,6 @@ void Yolov8PostProcess::postProcessDetOpt(
 #endif
     int min_idx = 0;
     int box_num = 0;
-    int max_wh = 7680;
     for (int i = 0; i < context->output_num; ++i) {
       auto output_shape = context->bmNetwork->outputTensor(i)->get_shape();
       auto output_dims = output_shape->num_dims;
@@ -352,60 +389,13 @@ void Yolov8PostProcess::postProcessDetOpt(
     int feat_num = out_tensor->get_shape()->dims[1];
     int nout = m_class_num + mask_num + 4;
     float* output_data = nullptr;
-    std::vector<float> decoded_data;
 
     assert(box_num == 0 || box_num == out_tensor->get_shape()->dims[2]);
     box_num = out_tensor->get_shape()->dims[2];
     output_data = (float*)out_tensor->get_cpu_data();
 
-    // Candidates
-    float* cls_conf = output_data + 4;
-    for (int i = 0; i < feat_num; i++) {
-      // best class
-      float max_value = 0.0;
-      int max_index = 0;
-      for (int j = 0; j < m_class_num; j++) {
-        float cur_value = cls_conf[i * nout + j];
-        if (cur_value > max_value) {
-          max_value = cur_value;
-          max_index = j;
-        }
-      }
-      float cur_class_thresh =
-          context->class_thresh_valid
-              ? context->thresh_conf[context->class_names[max_index]]
-              : context->thresh_conf_min;
-      if (max_value >= cur_class_thresh) {
-        YoloV8Box box;
-        box.score = max_value;
-        box.class_id = max_index;
-        int c = box.class_id * max_wh;
-        float centerX = output_data[i * nout];
-        float centerY = output_data[i * nout + 1];
-        float width = output_data[i * nout + 2];
-        float height = output_data[i * nout + 3];
-
-        box.x1 = centerX - width / 2 + c;
-        box.y1 = centerY - height / 2 + c;
-        box.x2 = box.x1 + width;
-        box.y2 = box.y1 + height;
-
-        yolobox_vec.push_back(box);
-      }
-    }
-    NMS(yolobox_vec, context->thresh_nms);
-    if (yolobox_vec.size() > max_det) {
-      yolobox_vec.erase(yolobox_vec.begin(),
-                        yolobox_vec.begin() + (yolobox_vec.size() - max_det));
-    }
-
-    for (int i = 0; i < yolobox_vec.size(); i++) {
-      int c = yolobox_vec[i].class_id * max_wh;
-      yolobox_vec[i].x1 = yolobox_vec[i].x1 - c;
-      yolobox_vec[i].y1 = yolobox_vec[i].y1 - c;
-      yolobox_vec[i].x2 = yolobox_vec[i].x2 - c;
-      yolobox_vec[i].y2 = yolobox_vec[i].y2 - c;
-    }
+    decoder.decodeRows(output_data, feat_num, nout, false);
+    collectBoxes(decoder, detections, yolobox_vec);
     clip_boxes(yolobox_vec, frame_width, frame_height);
 
     for (int i = 0; i < yolobox_vec.size(); i++) {
@@ -417,7 +407,7 @@ void Yolov8PostProcess::postProcessDetOpt(
       float height = (yolobox_vec[i].y2 - yolobox_vec[i].y1) / ratio;
 
       std::shared_ptr<common::DetectedObjectMetadata> detData =
-          std::make_shared<common::DetectedObjectMetadata>();
+          common::makePooled<common::DetectedObjectMetadata>();
       detData->mBox.mX = std::max(int(centerx - width / 2), 0);
       detData->mBox.mY = std::max(int(centery - height / 2), 0);
       detData->mBox.mWidth = width;
@@ -456,6 +446,8 @@ void Yolov8PostProcess::postProcessDet(
     common::ObjectMetadatas& objectMetadatas) {
   // Yolov8 vec
   YoloV8BoxVec yolobox_vec;
+  YoloDecoder decoder(makeDecodeConfig(context));
+  std::vector<YoloDetection> detections;
 
   int idx = 0;
   for (auto obj : objectMetadatas) {
@@ -469,7 +461,7 @@ void Yolov8PostProcess::postProcessDet(
           obj->mOutputBMtensors->tensors[i].get(), context->bmNetwork->is_soc);
     }
 
-    yolobox_vec.clear();
+    decoder.clear();
     int frame_width = obj->mFrame->mSpData->width;
     int frame_height = obj->mFrame->mSpData->height;
     int tx1 = 0, ty1 = 0;
@@ -518,10 +510,8 @@ void Yolov8PostProcess::postProcessDet(
     int m_class_num = out_tensor->get_shape()->dims[1] - mask_num - 4;
     int feature_num = out_tensor->get_shape()->dims[2];  // 8400
     int nout = m_class_num + mask_num + 4;
-    int max_wh = 7680;  // (pixels) maximum box width and height
 
     float* output_data = nullptr;
-    std::vector<float> decoded_data;
 
     if (context->min_dim == 3 && context->output_num != 1) {
       std::cout << "--> WARNING: the current bmodel has redundant outputs"
@@ -536,56 +526,8 @@ void Yolov8PostProcess::postProcessDet(
     box_num = out_tensor->get_shape()->dims[1];
     output_data =
         (float*)out_tensor->get_cpu_data();  // 如果只有一张图片不要需修改
-    float* cls_conf = output_data + 4 * feature_num;
-    for (int i = 0; i < feature_num; i++) {
-      // best class
-      float max_value = 0.0;
-      int max_index = 0;
-      for (int j = 0; j < m_class_num; j++) {
-        float cur_value = cls_conf[i + j * feature_num];
-        if (cur_value > max_value) {
-          max_value = cur_value;
-          max_index = j;
-        }
-      }
-
-      float cur_class_thresh =
-          context->class_thresh_valid
-              ? context->thresh_conf[context->class_names[max_index]]
-              : context->thresh_conf_min;
-
-      if (max_value >= cur_class_thresh) {
-        YoloV8Box box;
-        box.score = max_value;
-        box.class_id = max_index;
-        int c = box.class_id * max_wh;
-        float centerX = output_data[i + 0 * feature_num];
-        float centerY = output_data[i + 1 * feature_num];
-        float width = (output_data[i + 2 * feature_num]);
-        float height = (output_data[i + 3 * feature_num]);
-
-        box.x1 = centerX - width / 2 + c;
-        box.y1 = centerY - height / 2 + c;
-        box.x2 = box.x1 + width;
-        box.y2 = box.y1 + height;
-
-        yolobox_vec.push_back(box);
-      }
-    }
-
-    NMS(yolobox_vec, context->thresh_nms);
-    if (yolobox_vec.size() > max_det) {
-      yolobox_vec.erase(yolobox_vec.begin(),
-                        yolobox_vec.begin() + (yolobox_vec.size() - max_det));
-    }
-
-    for (int i = 0; i < yolobox_vec.size(); i++) {
-      int c = yolobox_vec[i].class_id * max_wh;
-      yolobox_vec[i].x1 = yolobox_vec[i].x1 - c;
-      yolobox_vec[i].y1 = yolobox_vec[i].y1 - c;
-      yolobox_vec[i].x2 = yolobox_vec[i].x2 - c;
-      yolobox_vec[i].y2 = yolobox_vec[i].y2 - c;
-    }
+    decoder.decodeColumns(output_data, feature_num, nout);
+    collectBoxes(decoder, detections, yolobox_vec);
 
     for (int i = 0; i < yolobox_vec.size(); i++) {
       float centerx =
@@ -604,7 +546,7 @@ void Yolov8PostProcess::postProcessDet(
 
     for (auto bbox : yolobox_vec) {
       std::shared_ptr<common::DetectedObjectMetadata> detData =
-          std::make_shared<common::DetectedObjectMetadata>();
+          common::makePooled<common::DetectedObjectMetadata>();
       detData->mBox.mX = std::max(int(bbox.x1), 0);
       detData->mBox.mY = std::max(int(bbox.y1), 0);
       detData->mBox.mWidth = bbox.x2 - bbox.x1;
@@ -70,6 +70,8 @@ class Yolox : public ::sophon_stream::framework::Element {
   static constexpr const char* CONFIG_INTERNAL_WIDTH_FILED = "width";
   static constexpr const char* CONFIG_INTERNAL_HEIGHT_FILED = "height";
 
+  static constexpr const char* CONFIG_INTERNAL_MAX_BATCH_WAIT_US_FIELD =
+      "max_batch_wait_us";
  private:
   std::shared_ptr<YoloxContext> mContext;          // context对象
   std::shared_ptr<YoloxPreProcess> mPreProcess;    // 预处理对象
@@ -83,6 +85,12 @@ class Yolox : public ::sophon_stream::framework::Element {
   std::string mFpsProfilerName;
   ::sophon_stream::common::FpsProfiler mFpsProfiler;
 
+  /**
+   * @brief 第一次doWork时按context创建，每个dataPipe暂存的数据跨doWork保留
+   */
+  std::unique_ptr<BatchAssembler> mBatchAssembler;
+  std::once_flag mBatchAssemblerFlag;
+
   common::ErrorCode initContext(const std::string& json);
   void process(common::ObjectMetadatas& objectMetadatas);
 };
@@ -11,6 +11,7 @@
 #define SOPHON_STREAM_ELEMENT_YOLOX_POST_PROCESS_H_
 
 #include "algorithmApi/post_process.h"
+#include "algorithmApi/yolo_decode.h"
 #include "yolox_context.h"
 
 namespace sophon_stream {
@@ -38,14 +39,6 @@ class YoloxPostProcess : public ::sophon_stream::element::PostProcess {
                    common::ObjectMetadatas& objectMetadatas);
   ~YoloxPostProcess() override;
 
- private:
-  float sigmoid(float x);
-  int argmax(float* data, int num);
-  float box_iou(const YoloxBox& a, const YoloxBox& b);
-
-  void nms_sorted_bboxes(const std::vector<YoloxBox>& objects,
-                         std::vector<int>& picked, float nms_threshold);
-
  private:
   int m_box_num;
   int* m_grids_x = nullptr;
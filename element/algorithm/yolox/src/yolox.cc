@@ -142,6 +142,9 @@ common::ErrorCode Yolox::initContext(const std::string& json) {
           roi_it->find(CONFIG_INTERNAL_HEIGHT_FILED)->get<int>();
     }
 
+    // 6. dynamic batch
+    mContext->maxBatchWaitUs =
+        configure.value(CONFIG_INTERNAL_MAX_BATCH_WAIT_US_FIELD, -1);
   } while (false);
 
   return common::ErrorCode::SUCCESS;
@@ -244,26 +247,28 @@ common::ErrorCode Yolox::doWork(int dataPipeId) {
 
   common::ObjectMetadatas pendingObjectMetadatas;
 
-  while (objectMetadatas.size() < mContext->max_batch &&
-         (getThreadStatus() == ThreadStatus::RUN)) {
-    // 如果队列为空则等待
-    auto data = popInputData(inputPort, dataPipeId);
-    if (!data) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
-    }
-
-    auto objectMetadata =
-        std::static_pointer_cast<common::ObjectMetadata>(data);
-
-    if (!objectMetadata->mFilter) objectMetadatas.push_back(objectMetadata);
-
-    pendingObjectMetadatas.push_back(objectMetadata);
-
-    if (objectMetadata->mFrame->mEndOfStream) {
-      break;
-    }
-  }
+  std::call_once(mBatchAssemblerFlag, [this]() {
+    const auto& batches = mContext->bmNetwork->m_batches;
+    mBatchAssembler = std::make_unique<BatchAssembler>(
+        std::vector<int>(batches.begin(), batches.end()),
+        std::chrono::microseconds(mContext->maxBatchWaitUs), getThreadNumber(),
+        BatchAssembler::getMetadataInfo<common::ObjectMetadata>);
+  });
+  // 凑满batch、等待超过max_batch_wait_us或遇到码流结束帧时返回
+  auto batch = mBatchAssembler->assemble(
+      dataPipeId,
+      [&](std::chrono::microseconds timeout) {
+        return timeout.count() > 0
+                   ? popInputData(inputPort, dataPipeId, timeout)
+                   : popInputData(inputPort, dataPipeId);
+      },
+      [this]() { return shouldWaitInputData(); });
+  for (auto& data : batch.items)
+    objectMetadatas.push_back(
+        std::static_pointer_cast<common::ObjectMetadata>(data));
+  for (auto& data : batch.all)
+    pendingObjectMetadatas.push_back(
+        std::static_pointer_cast<common::ObjectMetadata>(data));
   process(objectMetadatas);
 
   for (auto& objectMetadata : pendingObjectMetadatas) {
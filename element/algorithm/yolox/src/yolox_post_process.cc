@@ -9,6 +9,8 @@
 
 #include "yolox_post_process.h"
 
+#include "common/object_pool.h"
+
 namespace sophon_stream {
 namespace element {
 namespace yolox {
@@ -42,52 +44,6 @@ void YoloxPostProcess::init(std::shared_ptr<YoloxContext> context) {
   }
 }
 
-int YoloxPostProcess::argmax(float* data, int num) {
-  float max_value = 0.0;
-  int max_index = 0;
-  for (int i = 0; i < num; ++i) {
-    float value = data[i];
-    if (value > max_value) {
-      max_value = value;
-      max_index = i;
-    }
-  }
-  return max_index;
-}
-
-float YoloxPostProcess::sigmoid(float x) { return 1.0 / (1 + expf(-x)); }
-
-float YoloxPostProcess::box_iou(const YoloxBox& a, const YoloxBox& b) {
-  float x = std::min(a.right, b.right) - std::max(a.left, b.left);
-  float y = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
-  float w = x > 0 ? x : 0;
-  float h = y > 0 ? y : 0;
-  float i = w * h;
-  float u = a.width * a.height + b.width * b.height - i;
-  return i / (u);
-}
-
-void YoloxPostProcess::nms_sorted_bboxes(const std::vector<YoloxBox>& objects,
-                                         std::vector<int>& picked,
-                                         float nms_threshold) {
-  picked.clear();
-  const int n = objects.size();
-  int suppressed[n];
-  memset(suppressed, 0, sizeof(float) * n);
-
-  for (int i = 0; i < n; i++) {
-    if (suppressed[i] == 1) continue;
-    picked.push_back(i);
-    const YoloxBox& a = objects[i];
-    for (int j = i + 1; j < n; j++) {
-      if (suppressed[j] == 1) continue;
-      const YoloxBox& b = objects[j];
-      float iou = box_iou(a, b);
-      if (iou > nms_threshold) suppressed[j] = 1;
-    }
-  }
-}
-
 YoloxPostProcess::~YoloxPostProcess() {
   delete[] m_grids_x;
   delete[] m_grids_y;
@@ -98,6 +54,10 @@ void YoloxPostProcess::postProcess(std::shared_ptr<YoloxContext> context,
                                    common::ObjectMetadatas& objectMetadatas) {
   if (objectMetadatas.size() == 0) return;
 
+  YoloDecodeConfig config = makeYoloDecodeConfig(*context);
+  config.agnostic = true;
+  YoloDecoder decoder(config);
+  std::vector<YoloDetection> detections;
   for (auto& obj : objectMetadatas) {
     if (obj->mFrame->mEndOfStream) break;
     int frame_width = obj->mFrame->mWidth;
@@ -120,70 +80,46 @@ void YoloxPostProcess::postProcess(std::shared_ptr<YoloxContext> context,
           obj->mOutputBMtensors->tensors[i].get(), context->bmNetwork->is_soc);
     }
     float* tensor = (float*)outputTensors[0]->get_cpu_data();
-    YoloxBoxVec yolobox_vec;
     int numDim3 = context->class_num + 5;
 
-    for (size_t i = 0; i < m_box_num; ++i) {
-      // 取出物体置信度
-      float box_objectness = tensor[i * numDim3 + 4];
-      if (box_objectness < context->thresh_conf_min) continue;
-      int max_class_idx = argmax(&tensor[i * numDim3 + 5], context->class_num);
-      float box_prob = box_objectness * tensor[i * numDim3 + 5 + max_class_idx];
-      float cur_class_thresh =
-          context->class_thresh_valid
-              ? context->thresh_conf[context->class_names[max_class_idx]]
-              : context->thresh_conf_min;
-      if (box_prob > cur_class_thresh) {
-        float center_x =
-            (tensor[i * numDim3 + 0] + m_grids_x[i]) * m_expanded_strides[i];
-        float center_y =
-            (tensor[i * numDim3 + 1] + m_grids_y[i]) * m_expanded_strides[i];
-        float w_temp = exp(tensor[i * numDim3 + 2]) * m_expanded_strides[i];
-        float h_temp = exp(tensor[i * numDim3 + 3]) * m_expanded_strides[i];
-
-        center_x *= scale;
-        center_y *= scale;
-        w_temp *= scale;
-        h_temp *= scale;
-        float left = center_x - w_temp / 2;
-        float top = center_y - h_temp / 2;
-        float right = center_x + w_temp / 2;
-        float bottom = center_y + h_temp / 2;
-
-        YoloxBox box;
-        // 检查一下取值范围
-        if (w_temp < 0 || h_temp < 0 || w_temp >= frame_width ||
-            h_temp > frame_height)
-          continue;
-        box.left = (left >= 0) ? left : 0;
-        box.top = (top >= 0) ? top : 0;
-        box.right = (right < frame_width) ? right : (frame_width - 1);
-        box.bottom = (bottom < frame_height) ? bottom : (frame_height - 1);
-        box.width = box.right - box.left;
-        box.height = box.bottom - box.top;
-        if (box.width < 0 || box.height < 0) continue;
-        box.score = box_prob;
-        box.class_id = max_class_idx;
-        if (w_temp * h_temp > m_min_box_area) yolobox_vec.push_back(box);
-      }
+    decoder.clear();
+    decoder.decodeGridStride(tensor, m_box_num, numDim3, m_grids_x, m_grids_y,
+                             m_expanded_strides);
+
+    // 换算到原图并检查取值范围，规则与原实现一致
+    auto& candidates = decoder.candidates();
+    size_t kept = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      YoloDetection det = candidates[i];
+      float w_temp = (det.x2 - det.x1) * scale;
+      float h_temp = (det.y2 - det.y1) * scale;
+      if (w_temp < 0 || h_temp < 0 || w_temp >= frame_width ||
+          h_temp > frame_height)
+        continue;
+      if (w_temp * h_temp <= m_min_box_area) continue;
+      float left = det.x1 * scale;
+      float top = det.y1 * scale;
+      float right = det.x2 * scale;
+      float bottom = det.y2 * scale;
+      det.x1 = (left >= 0) ? left : 0;
+      det.y1 = (top >= 0) ? top : 0;
+      det.x2 = (right < frame_width) ? right : (frame_width - 1);
+      det.y2 = (bottom < frame_height) ? bottom : (frame_height - 1);
+      if (det.x2 - det.x1 < 0 || det.y2 - det.y1 < 0) continue;
+      candidates[kept++] = det;
     }
+    candidates.resize(kept);
+    decoder.nms(detections);
 
-    std::sort(
-        yolobox_vec.begin(), yolobox_vec.end(),
-        [](const YoloxBox& a, const YoloxBox& b) { return a.score > b.score; });
-    std::vector<int> picked;
-    nms_sorted_bboxes(yolobox_vec, picked, context->thresh_nms);
-
-    for (size_t i = 0; i < picked.size(); i++) {
-      auto bbox = yolobox_vec[picked[i]];
+    for (const auto& bbox : detections) {
       std::shared_ptr<common::DetectedObjectMetadata> detData =
-          std::make_shared<common::DetectedObjectMetadata>();
-      detData->mBox.mX = bbox.left;
-      detData->mBox.mY = bbox.top;
-      detData->mBox.mWidth = bbox.width;
-      detData->mBox.mHeight = bbox.height;
+          common::makePooled<common::DetectedObjectMetadata>();
+      detData->mBox.mX = bbox.x1;
+      detData->mBox.mY = bbox.y1;
+      detData->mBox.mWidth = bbox.x2 - bbox.x1;
+      detData->mBox.mHeight = bbox.y2 - bbox.y1;
       detData->mScores.push_back(bbox.score);
-      detData->mClassify = bbox.class_id;
+      detData->mClassify = bbox.classId;
       if (context->roi_predefined) {
         detData->mBox.mX += context->roi.start_x;
         detData->mBox.mY += context->roi.start_y;
@@ -14,6 +14,7 @@
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <queue>
+#include <vector>
 
 // for bmcv_api_ext.h
 #include "bmcv_api_ext.h"
@@ -54,6 +55,8 @@ class HTTP_Base64_Mgr {
   httplib::Server server_;
   int port_;
   std::queue<std::string> base64_queue_;
+  // grab()中解码后的JPEG数据，逐帧复用
+  std::vector<unsigned char> jpeg_buffer_;
 
   std::thread listen_thread_;
   bool is_inited_ = false;
@@ -53,11 +53,8 @@ void Decode::onStop() {
 common::ErrorCode Decode::doWork(int dataPipeId) {
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
   int inputPort = 0;
-  auto data = popInputData(inputPort, dataPipeId);
-  if (!data) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    return errorCode;
-  }
+  auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+  if (!data) return errorCode;
 
   std::shared_ptr<ChannelTask> channelTask =
       std::static_pointer_cast<ChannelTask>(data);
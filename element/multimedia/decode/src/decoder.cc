@@ -9,6 +9,8 @@
 
 #include "decoder.h"
 
+#include "common/object_pool.h"
+
 namespace sophon_stream {
 namespace element {
 namespace decode {
@@ -153,8 +155,8 @@ common::ErrorCode Decoder::process(
     int64_t pts = 0;
     spBmImage =
         decoder.grab(frame_id, eof, pts, mSampleInterval, mSampleStrategy);
-    objectMetadata = std::make_shared<common::ObjectMetadata>();
-    objectMetadata->mFrame = std::make_shared<common::Frame>();
+    objectMetadata = common::makePooled<common::ObjectMetadata>();
+    objectMetadata->mFrame = common::makePooled<common::Frame>();
     objectMetadata->mFrame->mHandle = m_handle;
     objectMetadata->mFrame->mFrameId = frame_id;
     objectMetadata->mFrame->mSpData = spBmImage;
@@ -178,8 +180,8 @@ common::ErrorCode Decoder::process(
     int64_t pts = 0;
     spBmImage =
         decoder.grab(frame_id, eof, pts, mSampleInterval, mSampleStrategy);
-    objectMetadata = std::make_shared<common::ObjectMetadata>();
-    objectMetadata->mFrame = std::make_shared<common::Frame>();
+    objectMetadata = common::makePooled<common::ObjectMetadata>();
+    objectMetadata->mFrame = common::makePooled<common::Frame>();
     objectMetadata->mFrame->mHandle = m_handle;
     objectMetadata->mFrame->mFrameId = frame_id;
     objectMetadata->mFrame->mSpData = spBmImage;
@@ -209,8 +211,8 @@ common::ErrorCode Decoder::process(
 
     spBmImage = decoder.picDec(
         m_handle, mImagePaths[mImgIndex % mImagePaths.size()].c_str());
-    objectMetadata = std::make_shared<common::ObjectMetadata>();
-    objectMetadata->mFrame = std::make_shared<common::Frame>();
+    objectMetadata = common::makePooled<common::ObjectMetadata>();
+    objectMetadata->mFrame = common::makePooled<common::Frame>();
     objectMetadata->mFrame->mHandle = m_handle;
     objectMetadata->mFrame->mFrameId = mImgIndex;
     objectMetadata->mFrame->mSpData = spBmImage;
@@ -237,8 +239,8 @@ common::ErrorCode Decoder::process(
     std::shared_ptr<bm_image> spBmImage = nullptr;
 
     spBmImage = mgr->grab(m_handle);
-    objectMetadata = std::make_shared<common::ObjectMetadata>();
-    objectMetadata->mFrame = std::make_shared<common::Frame>();
+    objectMetadata = common::makePooled<common::ObjectMetadata>();
+    objectMetadata->mFrame = common::makePooled<common::Frame>();
     objectMetadata->mFrame->mHandle = m_handle;
     objectMetadata->mFrame->mFrameId = mImgIndex++;
     objectMetadata->mFrame->mSpData = spBmImage;
@@ -280,8 +282,8 @@ common::ErrorCode Decoder::process(
       }
     }
 
-    objectMetadata = std::make_shared<common::ObjectMetadata>();
-    objectMetadata->mFrame = std::make_shared<common::Frame>();
+    objectMetadata = common::makePooled<common::ObjectMetadata>();
+    objectMetadata->mFrame = common::makePooled<common::Frame>();
     objectMetadata->mFrame->mHandle = m_handle;
     objectMetadata->mFrame->mFrameId = frame_id;
     objectMetadata->mFrame->mSpData = spBmImage;
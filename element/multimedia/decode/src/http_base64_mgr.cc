@@ -13,8 +13,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 
-#include <websocketpp/base64/base64.hpp>
-
+#include "common/base64.h"
 #include "common/common_defs.h"
 
 namespace sophon_stream {
@@ -101,16 +100,22 @@ std::shared_ptr<bm_image> HTTP_Base64_Mgr::grab(bm_handle_t& handle) {
       sleep(1);
       continue;
     }
-    std::string base64_str = base64_queue_.front();
+    std::string base64_str = std::move(base64_queue_.front());
     base64_queue_.pop();
 
-    std::string img_str = websocketpp::base64_decode(base64_str);
-    size_t size = img_str.length();
+    jpeg_buffer_.resize(common::base64DecodedMaxSize(base64_str.size()));
+    size_t size = 0;
+    if (!common::base64Decode(base64_str.data(), base64_str.size(),
+                              jpeg_buffer_.data(), size)) {
+      IVS_ERROR("Invalid base64 data, length: {0}", base64_str.size());
+      continue;
+    }
+    void* jpegData = jpeg_buffer_.data();
     // 如果传入base64数据不是jpeg格式，会报错[BMCV][error]  [MESSAGE FROM
     // bmcv_api_jpeg_dec.cpp: try_soft_decoding: 433]: jpeg-turbo read header
     // failed!
-    int ret = bmcv_image_jpeg_dec(handle, (void**)&img_str, &size, 1,
-                                  spBmImage.get());
+    int ret =
+        bmcv_image_jpeg_dec(handle, &jpegData, &size, 1, spBmImage.get());
     if (ret == BM_SUCCESS) break;
 
     IVS_ERROR("bmcv_image_jpeg_dec failed");
@@ -59,7 +59,7 @@ class Encode : public ::sophon_stream::framework::Element {
   int width = -1;
   int height = -1;
 
-  enum class WSencType {IMG_ONLY, SERIALIZED};
+  enum class WSencType {IMG_ONLY, SERIALIZED, SERIALIZED_BINARY};
   WSencType mWsEncType = WSencType::IMG_ONLY;
 
   std::string ip = "localhost";
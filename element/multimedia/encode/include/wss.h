@@ -47,6 +47,11 @@ class WSS {
 
   void init(int port, double fps);
 
+  /**
+   * @brief 以binary帧发送数据，默认为text帧，需要在send()之前设置
+   */
+  void setBinary(bool binary);
+
   // 从队列中取数据发送
   void send();
 
@@ -63,6 +68,7 @@ class WSS {
   struct timeval m_current_send_time;
   double m_fps;
   double m_frame_interval;
+  websocketpp::frame::opcode::value m_opcode = websocketpp::frame::opcode::text;
   std::queue<std::string> mImgDataQueue;
   std::mutex mQueueMtx;
 
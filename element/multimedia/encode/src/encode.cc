@@ -11,6 +11,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "common/base64.h"
+#include "common/binary_serialize.h"
 #include "common/serialize.h"
 namespace sophon_stream {
 namespace element {
@@ -112,6 +114,8 @@ common::ErrorCode Encode::initInternal(const std::string& json) {
       std::string wsEncType = wsTypeIt->get<std::string>();
       if (wsEncType == "IMG_ONLY") mWsEncType = WSencType::IMG_ONLY;
       if (wsEncType == "SERIALIZED") mWsEncType = WSencType::SERIALIZED;
+      if (wsEncType == "SERIALIZED_BINARY")
+        mWsEncType = WSencType::SERIALIZED_BINARY;
     }
 
     if (mEncodeType == EncodeType::RTSP || mEncodeType == EncodeType::RTMP ||
@@ -217,10 +221,10 @@ common::ErrorCode Encode::doWork(int dataPipeId) {
 
   std::shared_ptr<void> data;
   while (getThreadStatus() == ThreadStatus::RUN) {
-    data = popInputData(inputPort, dataPipeId);
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
     if (!data) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
+      if (shouldWaitInputData()) continue;
+      break;
     }
     break;
   }
@@ -382,6 +386,7 @@ void Encode::processWS(int dataPipeId,
     int channel_id = objectMetadata->mFrame->mChannelId;
     int server_port = std::stoi(mWSSPort) + channel_id;
     std::shared_ptr<WSS> wss = std::make_shared<WSS>();
+    wss->setBinary(mWsEncType == WSencType::SERIALIZED_BINARY);
     std::thread t(create_wss, wss.get(), server_port, mFps);
     std::thread s(send_wss, wss.get());
     std::lock_guard<std::mutex> lk(mWSSThreadsMutex);
@@ -421,8 +426,7 @@ void Encode::processWS(int dataPipeId,
 
     bmcv_image_jpeg_enc(objectMetadata->mFrame->mHandle, 1, img_to_enc.get(),
                         &jpeg_data, &out_size);
-    data =
-        websocketpp::base64_encode((const unsigned char*)jpeg_data, out_size);
+    common::base64Encode(jpeg_data, out_size, data);
     free(jpeg_data);
   }
   if (mWsEncType == WSencType::SERIALIZED) {
@@ -431,6 +435,16 @@ void Encode::processWS(int dataPipeId,
     nlohmann::json serializedObj = objectMetadata;
     data = serializedObj.dump();
   }
+  if (mWsEncType == WSencType::SERIALIZED_BINARY) {
+    objectMetadata->fps =
+        mFpsProfilers[objectMetadata->mFrame->mChannelIdInternal]->getTmpFps();
+    common::BinaryWriter writer;
+    common::serializeBinary(writer, *objectMetadata,
+                            [](const common::Frame& frame, std::string& out) {
+                              return common::frame_to_jpeg(frame, out);
+                            });
+    data = std::move(writer.buffer());
+  }
   // base64 img 存入队列
   serverIt->second->pushImgDataQueue(data);
 }
@@ -44,6 +44,11 @@ void WSS::init(int port, double fps) {
   }
 }
 
+void WSS::setBinary(bool binary) {
+  m_opcode = binary ? websocketpp::frame::opcode::binary
+                    : websocketpp::frame::opcode::text;
+}
+
 // 从队列中取数据发送
 void WSS::send() {
   while (1) {
@@ -71,7 +76,7 @@ void WSS::send() {
       std::this_thread::sleep_for(std::chrono::milliseconds(time_to_sleep));
     gettimeofday(&m_last_send_time, NULL);
     for (auto it : m_connections) {
-      m_server.send(it, data, websocketpp::frame::opcode::text);
+      m_server.send(it, data, m_opcode);
     }
   }
 }
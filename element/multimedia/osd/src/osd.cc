@@ -116,10 +116,10 @@ common::ErrorCode Osd::doWork(int dataPipeId) {
 
   std::shared_ptr<void> data;
   while (getThreadStatus() == ThreadStatus::RUN) {
-    data = popInputData(inputPort, dataPipeId);
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
     if (!data) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
+      if (shouldWaitInputData()) continue;
+      break;
     }
     break;
   }
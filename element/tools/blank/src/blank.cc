@@ -31,10 +31,9 @@ common::ErrorCode Blank::doWork(int dataPipeId) {
     outputPort = outputPorts[0];
   }
 
-  auto data = popInputData(inputPort, dataPipeId);
-  while (!data && (getThreadStatus() == ThreadStatus::RUN)) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    data = popInputData(inputPort, dataPipeId);
+  auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+  while (!data && shouldWaitInputData()) {
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
   }
   if (data == nullptr) return common::ErrorCode::SUCCESS;
 
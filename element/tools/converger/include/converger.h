@@ -10,8 +10,13 @@
 #ifndef SOPHON_STREAM_ELEMENT_CONVERGER_H_
 #define SOPHON_STREAM_ELEMENT_CONVERGER_H_
 
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "common/object_metadata.h"
 #include "element.h"
@@ -20,6 +25,28 @@ namespace sophon_stream {
 namespace element {
 namespace converger {
 
+/**
+ * @brief converger的运行统计，通过/metrics输出
+ */
+struct ConvergerStats {
+  /**
+   * @brief 等待分支的帧数量
+   */
+  std::atomic<std::int64_t> pendingFrames{0};
+  /**
+   * @brief 等待超时后被放行的帧数量
+   */
+  std::atomic<std::uint64_t> timeoutFrames{0};
+  /**
+   * @brief 等待中的帧超过max_pending_frames后被提前放行的数量
+   */
+  std::atomic<std::uint64_t> overflowFrames{0};
+  /**
+   * @brief 所属帧已放行后才到达、被丢弃的分支数据数量
+   */
+  std::atomic<std::uint64_t> lateBranches{0};
+};
+
 class Converger : public ::sophon_stream::framework::Element {
  public:
   Converger();
@@ -31,25 +58,100 @@ class Converger : public ::sophon_stream::framework::Element {
 
   static constexpr const char* CONFIG_INTERNAL_DEFAULT_PORT_FILED =
       "default_port";
+  static constexpr const char* CONFIG_INTERNAL_TIMEOUT_MS_FILED = "timeout_ms";
+  static constexpr const char* CONFIG_INTERNAL_MAX_PENDING_FRAMES_FILED =
+      "max_pending_frames";
+
+ protected:
+  void onStart() override;
 
  private:
+  /**
+   * @brief 一帧的汇聚状态，按frame_id对环形缓冲区容量取模存放
+   */
+  struct Slot {
+    /**
+     * @brief -1表示空闲
+     */
+    std::int64_t frameId = -1;
+    /**
+     * @brief 从default_port收到的主数据，分支数据先到达时为空
+     */
+    std::shared_ptr<common::ObjectMetadata> objectMetadata;
+    /**
+     * @brief 已收到的分支数据数量
+     */
+    int arrivedBranches = 0;
+    std::chrono::steady_clock::time_point arrivedTime;
+  };
+
+  /**
+   * @brief 一路码流的汇聚状态
+   */
+  struct ChannelState {
+    std::vector<Slot> slots;
+    /**
+     * @brief 已收到主数据、尚未放行的frame_id，按到达顺序排列，即输出顺序
+     */
+    std::deque<std::int64_t> pendingFrameIds;
+    /**
+     * @brief 最近一次放行的frame_id，之后到达的更早帧的分支数据直接丢弃
+     */
+    std::int64_t lastReleasedFrameId = -1;
+  };
+
+  /**
+   * @brief 上游按mChannelIdInternal % thread_number选择dataPipe，
+   * 因此同一路码流的主数据和分支数据只会由同一个dataPipe处理，各dataPipe的状态互不共享，无需加锁
+   */
+  struct DataPipeState {
+    std::unordered_map<int, ChannelState> channels;
+  };
+
+  ChannelState& getChannelState(int dataPipeId, int channelId);
+
+  /**
+   * @brief 找到frameId对应的槽位；槽位被更早的帧占用时，按顺序提前放行到该帧为止
+   */
+  Slot& acquireSlot(int channelId, ChannelState& channel, std::int64_t frameId);
+
+  void onMainData(int channelId, ChannelState& channel,
+                  std::shared_ptr<common::ObjectMetadata> objectMetadata);
+  void onBranchData(int channelId, ChannelState& channel,
+                    std::int64_t frameId);
+
+  /**
+   * @brief 按顺序放行所有已完成汇聚或等待超时的帧
+   */
+  void releaseReady(int channelId, ChannelState& channel,
+                    std::chrono::steady_clock::time_point now);
+
+  /**
+   * @brief 放行pendingFrameIds队首的帧，分支未全部到达时标记mPartiallyConverged
+   * @return 分支未全部到达时返回true
+   */
+  bool releaseFront(int channelId, ChannelState& channel);
+
   int mDefaultPort;
   /**
-   * @brief key: channel_id, value: map<frame_id, objectMetadata>
+   * @brief 等待分支的最长时间，0表示一直等待
    */
-  std::unordered_map<int,
-                     std::map<int, std::shared_ptr<common::ObjectMetadata>>>
-      mCandidates;
+  std::chrono::milliseconds mTimeout{0};
   /**
-   * @brief recored number of branches for every ObjectMetadata in default_port
+   * @brief 每路码流最多同时等待的帧数量，即环形缓冲区的容量
    */
-  std::unordered_map<int, std::unordered_map<int, int>> mBranches;
+  int mMaxPendingFrames = 256;
+
+  std::vector<std::unique_ptr<DataPipeState>> mDataPipeStates;
 
-  std::mutex mtx;
+  /**
+   * @brief 使用shared_ptr以便注册到MetricsRegistry的getter在element析构后能够判断失效
+   */
+  std::shared_ptr<ConvergerStats> mStats;
 };
 
 }  // namespace converger
 }  // namespace element
 }  // namespace sophon_stream
 
-#endif
\ No newline at end of file
+#endif
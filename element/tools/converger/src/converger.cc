@@ -12,13 +12,14 @@
 #include <nlohmann/json.hpp>
 
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "element_factory.h"
 
 namespace sophon_stream {
 namespace element {
 namespace converger {
 
-Converger::Converger() {}
+Converger::Converger() : mStats(std::make_shared<ConvergerStats>()) {}
 Converger::~Converger() {}
 
 common::ErrorCode Converger::initInternal(const std::string& json) {
@@ -32,37 +33,208 @@ common::ErrorCode Converger::initInternal(const std::string& json) {
     int _default_port =
         configure.find(CONFIG_INTERNAL_DEFAULT_PORT_FILED)->get<int>();
     mDefaultPort = _default_port;
+
+    auto timeoutIt = configure.find(CONFIG_INTERNAL_TIMEOUT_MS_FILED);
+    if (configure.end() != timeoutIt && timeoutIt->is_number_integer()) {
+      mTimeout = std::chrono::milliseconds(timeoutIt->get<int>());
+    }
+
+    auto maxPendingFramesIt =
+        configure.find(CONFIG_INTERNAL_MAX_PENDING_FRAMES_FILED);
+    if (configure.end() != maxPendingFramesIt &&
+        maxPendingFramesIt->is_number_integer()) {
+      mMaxPendingFrames = maxPendingFramesIt->get<int>();
+    }
+    if (mMaxPendingFrames <= 0) {
+      IVS_ERROR("{0} must be positive, json: {1}",
+                CONFIG_INTERNAL_MAX_PENDING_FRAMES_FILED, json);
+      errorCode = common::ErrorCode::PARSE_CONFIGURE_FAIL;
+      break;
+    }
+
+    mDataPipeStates.clear();
+    for (int i = 0; i < getThreadNumber(); ++i) {
+      mDataPipeStates.push_back(std::make_unique<DataPipeState>());
+    }
   } while (false);
   return errorCode;
 }
 
+void Converger::onStart() {
+  auto& registry = common::MetricsRegistry::getInstance();
+  common::MetricLabels labels = getMetricLabels();
+  std::weak_ptr<ConvergerStats> weakStats = mStats;
+  auto getter = [weakStats](std::atomic<std::uint64_t> ConvergerStats::*field) {
+    return [weakStats, field](double& value) {
+      auto stats = weakStats.lock();
+      if (!stats) return false;
+      value = ((*stats).*field).load(std::memory_order_relaxed);
+      return true;
+    };
+  };
+
+  registry.addGauge("sophon_stream_converger_pending_frames",
+                    "Frames waiting for their branches in the converger.",
+                    labels, [weakStats](double& value) {
+                      auto stats = weakStats.lock();
+                      if (!stats) return false;
+                      value = stats->pendingFrames.load(
+                          std::memory_order_relaxed);
+                      return true;
+                    });
+
+  common::MetricLabels timeoutLabels = labels;
+  timeoutLabels.emplace_back("reason", "timeout");
+  registry.addCounter(
+      "sophon_stream_converger_partial_frames_total",
+      "Frames released before all branches arrived.", timeoutLabels,
+      getter(&ConvergerStats::timeoutFrames));
+  common::MetricLabels overflowLabels = labels;
+  overflowLabels.emplace_back("reason", "overflow");
+  registry.addCounter(
+      "sophon_stream_converger_partial_frames_total",
+      "Frames released before all branches arrived.", overflowLabels,
+      getter(&ConvergerStats::overflowFrames));
+
+  registry.addCounter("sophon_stream_converger_late_branches_total",
+                      "Branch data dropped because its frame was already "
+                      "released.",
+                      labels, getter(&ConvergerStats::lateBranches));
+}
+
+Converger::ChannelState& Converger::getChannelState(int dataPipeId,
+                                                    int channelId) {
+  auto& channels = mDataPipeStates[dataPipeId]->channels;
+  auto channelIt = channels.find(channelId);
+  if (channels.end() != channelIt) return channelIt->second;
+  auto& channel = channels[channelId];
+  channel.slots.resize(mMaxPendingFrames);
+  return channel;
+}
+
+Converger::Slot& Converger::acquireSlot(int channelId, ChannelState& channel,
+                                        std::int64_t frameId) {
+  Slot& slot = channel.slots[frameId % mMaxPendingFrames];
+  if (slot.frameId < 0 || slot.frameId == frameId) {
+    slot.frameId = frameId;
+    return slot;
+  }
+  if (slot.objectMetadata) {
+    // 槽位被max_pending_frames帧之前的帧占用，为保证顺序，到该帧为止全部放行
+    std::int64_t occupiedFrameId = slot.frameId;
+    while (!channel.pendingFrameIds.empty() &&
+           channel.pendingFrameIds.front() <= occupiedFrameId) {
+      if (releaseFront(channelId, channel)) {
+        mStats->overflowFrames.fetch_add(1, std::memory_order_relaxed);
+        IVS_WARN(
+            "Converger pending frames exceed {0}, release frame without all "
+            "branches, channel_id = {1}, frame_id = {2}",
+            mMaxPendingFrames, channelId, occupiedFrameId);
+      }
+    }
+  }
+  // 没有主数据的槽位是主数据被上游丢弃后残留的分支计数，直接覆盖
+  slot = Slot();
+  slot.frameId = frameId;
+  return slot;
+}
+
+void Converger::onMainData(
+    int channelId, ChannelState& channel,
+    std::shared_ptr<common::ObjectMetadata> objectMetadata) {
+  std::int64_t frameId = objectMetadata->mFrame->mFrameId;
+  Slot& slot = acquireSlot(channelId, channel, frameId);
+  slot.objectMetadata = objectMetadata;
+  slot.arrivedTime = std::chrono::steady_clock::now();
+  channel.pendingFrameIds.push_back(frameId);
+  mStats->pendingFrames.fetch_add(1, std::memory_order_relaxed);
+  IVS_DEBUG(
+      "data recognized, channel_id = {0}, frame_id = {1}, num_branches = {2}",
+      channelId, frameId, objectMetadata->numBranches);
+}
+
+void Converger::onBranchData(int channelId, ChannelState& channel,
+                             std::int64_t frameId) {
+  Slot& slot = channel.slots[frameId % mMaxPendingFrames];
+  if (frameId <= channel.lastReleasedFrameId || slot.frameId > frameId) {
+    mStats->lateBranches.fetch_add(1, std::memory_order_relaxed);
+    IVS_DEBUG("late subData dropped, channel_id = {0}, frame_id = {1}",
+              channelId, frameId);
+    return;
+  }
+  Slot& acquired = acquireSlot(channelId, channel, frameId);
+  ++acquired.arrivedBranches;
+  IVS_DEBUG(
+      "data updated, channel_id = {0}, frame_id = {1}, current num_branches "
+      "= {2}",
+      channelId, frameId, acquired.arrivedBranches);
+}
+
+void Converger::releaseReady(int channelId, ChannelState& channel,
+                             std::chrono::steady_clock::time_point now) {
+  while (!channel.pendingFrameIds.empty()) {
+    std::int64_t frameId = channel.pendingFrameIds.front();
+    Slot& slot = channel.slots[frameId % mMaxPendingFrames];
+    if (slot.arrivedBranches < slot.objectMetadata->numBranches) {
+      // 当前帧不可以弹出，为了保证时序性，后续帧也不弹出
+      if (0 == mTimeout.count() || now - slot.arrivedTime < mTimeout) break;
+      mStats->timeoutFrames.fetch_add(1, std::memory_order_relaxed);
+      IVS_WARN(
+          "Converger wait branches timeout, channel_id = {0}, frame_id = {1}, "
+          "branches = {2}/{3}",
+          channelId, frameId, slot.arrivedBranches,
+          slot.objectMetadata->numBranches);
+    }
+    releaseFront(channelId, channel);
+  }
+}
+
+bool Converger::releaseFront(int channelId, ChannelState& channel) {
+  std::int64_t frameId = channel.pendingFrameIds.front();
+  channel.pendingFrameIds.pop_front();
+  Slot& slot = channel.slots[frameId % mMaxPendingFrames];
+  auto objectMetadata = slot.objectMetadata;
+  bool partial = slot.arrivedBranches < objectMetadata->numBranches;
+  objectMetadata->mPartiallyConverged = partial;
+  slot = Slot();
+  // 码流结束后重新开始的任务frame_id从头计数
+  channel.lastReleasedFrameId =
+      objectMetadata->mFrame->mEndOfStream ? -1 : frameId;
+  mStats->pendingFrames.fetch_sub(1, std::memory_order_relaxed);
+
+  IVS_DEBUG("Data converged! Now pop... channel_id = {0}, frame_id = {1}",
+            channelId, frameId);
+  int outputPort = getSinkElementFlag() ? 0 : getOutputPorts()[0];
+  int outDataPipeId =
+      getSinkElementFlag()
+          ? 0
+          : (channelId % getOutputConnectorCapacity(outputPort));
+  common::ErrorCode errorCode = pushOutputData(
+      outputPort, outDataPipeId, std::static_pointer_cast<void>(objectMetadata));
+  if (common::ErrorCode::SUCCESS != errorCode) {
+    IVS_WARN(
+        "Send data fail, element id: {0:d}, output port: {1:d}, data: "
+        "{2:p}",
+        getId(), outputPort, static_cast<void*>(objectMetadata.get()));
+  }
+  return partial;
+}
+
 common::ErrorCode Converger::doWork(int dataPipeId) {
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
   std::vector<int> inputPorts = getInputPorts();
-  std::vector<int> outputPorts = getOutputPorts();
-  int outputPort = getSinkElementFlag() ? 0 : outputPorts[0];
-
-  // 从所有inputPort中取出数据，并且做判断
-  // default_port中取出的数据，放到map里
-  auto data = popInputData(mDefaultPort, dataPipeId);
-  int retry_times = 0;
-  while (!data && (getThreadStatus() == ThreadStatus::RUN) && retry_times < 5) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    data = popInputData(mDefaultPort, dataPipeId);
-    ++retry_times;
-  }
+
+  // default_port中取出的数据放入所属码流的环形缓冲区
+  // 最多等待50ms，超时后继续收取各分支的数据
+  auto data = popInputData(mDefaultPort, dataPipeId,
+                           std::chrono::milliseconds(50));
   if (data != nullptr) {
     auto objectMetadata =
         std::static_pointer_cast<common::ObjectMetadata>(data);
-    int channel_id = objectMetadata->mFrame->mChannelIdInternal;
-    int frame_id = objectMetadata->mFrame->mFrameId;
-    // lock
-    std::unique_lock<std::mutex> lk(mtx);
-    mCandidates[channel_id][frame_id] = objectMetadata;
-    lk.unlock();
-    IVS_DEBUG(
-        "data recognized, channel_id = {0}, frame_id = {1}, num_branches = {2}",
-        channel_id, frame_id, objectMetadata->numBranches);
+    int channelId = objectMetadata->mFrame->mChannelIdInternal;
+    auto& channel = getChannelState(dataPipeId, channelId);
+    onMainData(channelId, channel, objectMetadata);
+    releaseReady(channelId, channel, std::chrono::steady_clock::now());
   }
 
   // 非default_port，取出来之后更新分支数的记录
@@ -72,71 +244,26 @@ common::ErrorCode Converger::doWork(int dataPipeId) {
     // 把某个端口给进来的subData都取出来
     while (subdata != nullptr) {
       auto subObj = std::static_pointer_cast<common::ObjectMetadata>(subdata);
-      int sub_channel_id = subObj->mFrame->mChannelIdInternal;
-      int sub_frame_id = subObj->mFrame->mFrameId;
-      IVS_DEBUG("subData recognized, channel_id = {0}, frame_id = {1}",
-                sub_channel_id, sub_frame_id);
-      // lock
-      std::unique_lock<std::mutex> lk(mtx);
-      mBranches[sub_channel_id][sub_frame_id]++;
-      lk.unlock();
-      IVS_DEBUG(
-          "data updated, channel_id = {0}, frame_id = {1}, current "
-          "num_branches "
-          "= {2}",
-          sub_channel_id, sub_frame_id,
-          mBranches[sub_channel_id][sub_frame_id]);
+      int channelId = subObj->mFrame->mChannelIdInternal;
+      auto& channel = getChannelState(dataPipeId, channelId);
+      onBranchData(channelId, channel, subObj->mFrame->mFrameId);
+      releaseReady(channelId, channel, std::chrono::steady_clock::now());
       subdata = popInputData(inputPort, dataPipeId);
     }
-    // if (subdata == nullptr) continue;
   }
 
-  // 遍历map，能弹出去的都弹出去
-  for (auto channel_it = mCandidates.begin(); channel_it != mCandidates.end();
-       ++channel_it) {
-    // 第一层：遍历所有channel
-    // 这里需要判断：如果channelId应该和自己这个datapipeId对上，就操作；否则跳过，给其它线程操作    
-    int channel_id_internal = channel_it->first;
-    int dataPipeNums = getThreadNumber();
-    if (channel_id_internal % dataPipeNums != dataPipeId) continue;
-
-    for (auto frame_it = mCandidates[channel_id_internal].begin();
-         frame_it != mCandidates[channel_id_internal].end();) {
-      // 第二层：遍历当前channel下的所有frame，有序
-      int frame_id = frame_it->first;
-      // 如果可以弹出，则弹出并循环至下一个
-      if (mBranches[channel_id_internal][frame_id] ==
-          mCandidates[channel_id_internal][frame_id]->numBranches) {
-        IVS_DEBUG("Data converged! Now pop... channel_id = {0}, frame_id = {1}",
-                  channel_id_internal, frame_id);
-        auto obj = mCandidates[channel_id_internal][frame_id];
-        int outDataPipeId = getSinkElementFlag()
-                                ? 0
-                                : (channel_id_internal %
-                                   getOutputConnectorCapacity(outputPort));
-        errorCode = pushOutputData(outputPort, outDataPipeId,
-                                   std::static_pointer_cast<void>(obj));
-        if (common::ErrorCode::SUCCESS != errorCode) {
-          IVS_WARN(
-              "Send data fail, element id: {0:d}, output port: {1:d}, data: "
-              "{2:p}",
-              getId(), outputPort, static_cast<void*>(obj.get()));
-        }
-        mCandidates[channel_id_internal].erase(frame_it++);
-        // delete mBranches[channel_id_internal][frame_id]
-        auto branchChannelIt = mBranches.find(channel_id_internal);
-        auto channelFrameIt = branchChannelIt->second.find(frame_id);
-        branchChannelIt->second.erase(channelFrameIt);
-      } else {
-        // 当前帧不可以弹出，为了保证时序性，后续帧也不弹出
-        break;
-      }
+  // 没有新数据到达的码流也要检查队首的帧是否等待超时
+  if (mTimeout.count() > 0) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& channelPair : mDataPipeStates[dataPipeId]->channels) {
+      releaseReady(channelPair.first, channelPair.second, now);
     }
   }
   return errorCode;
 }
+
 REGISTER_WORKER("converger", Converger)
 
 }  // namespace converger
 }  // namespace element
-}  // namespace sophon_stream
\ No newline at end of file
+}  // namespace sophon_stream
@@ -0,0 +1,94 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_DISTRIBUTOR_CROP_BATCH_H_
+#define SOPHON_STREAM_ELEMENT_DISTRIBUTOR_CROP_BATCH_H_
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sophon_stream {
+namespace element {
+namespace distributor {
+
+/**
+ * @brief 收集一帧中所有需要crop的区域，统一调用一次批量crop
+ * @details
+ * Image为图像类型，element中为bm_image，由bmcv_image_crop完成；
+ * 压测程序中可以换成CPU上的图像和crop函数，不依赖硬件验证批处理的逻辑。
+ */
+template <typename Image>
+class CropBatch {
+ public:
+  struct Rect {
+    int x;
+    int y;
+    int width;
+    int height;
+  };
+
+  /**
+   * @brief 批量crop，outputs按顺序与rects一一对应，失败时返回false
+   */
+  using CropFunc = std::function<bool(
+      const Image& input, const std::vector<Rect>& rects,
+      std::vector<std::shared_ptr<Image>>& outputs)>;
+
+  /**
+   * @param[in] maxBatch : 单次crop的最大数量，超出时分多次调用
+   */
+  explicit CropBatch(int maxBatch) : mMaxBatch(std::max(maxBatch, 1)) {}
+
+  /**
+   * @brief 添加一个区域，返回其下标，run之后用get取结果
+   */
+  int add(int x, int y, int width, int height) {
+    mRects.push_back({x, y, width, height});
+    return static_cast<int>(mRects.size()) - 1;
+  }
+
+  bool empty() const { return mRects.empty(); }
+  size_t size() const { return mRects.size(); }
+
+  bool run(const Image& input, const CropFunc& crop) {
+    mOutputs.clear();
+    bool success = true;
+    std::vector<Rect> rects;
+    std::vector<std::shared_ptr<Image>> outputs;
+    for (size_t begin = 0; begin < mRects.size(); begin += mMaxBatch) {
+      size_t end = std::min(mRects.size(), begin + mMaxBatch);
+      rects.assign(mRects.begin() + begin, mRects.begin() + end);
+      outputs.clear();
+      if (!crop(input, rects, outputs) || outputs.size() != rects.size()) {
+        success = false;
+        outputs.resize(rects.size());
+      }
+      mOutputs.insert(mOutputs.end(), outputs.begin(), outputs.end());
+    }
+    return success;
+  }
+
+  /**
+   * @brief 第index个区域的crop结果，crop失败时为nullptr
+   */
+  const std::shared_ptr<Image>& get(int index) const { return mOutputs[index]; }
+
+ private:
+  const size_t mMaxBatch;
+  std::vector<Rect> mRects;
+  std::vector<std::shared_ptr<Image>> mOutputs;
+};
+
+}  // namespace distributor
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_DISTRIBUTOR_CROP_BATCH_H_
@@ -11,11 +11,14 @@
 #define SOPHON_STREAM_ELEMENT_DISTRIBUTER_H_
 
 #include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "common/clocker.h"
 #include "common/object_metadata.h"
+#include "crop_batch.h"
+#include "distributor_rules.h"
 #include "element.h"
 #include "opencv2/opencv.hpp"
 
@@ -33,25 +36,33 @@ class Distributor : public ::sophon_stream::framework::Element {
   common::ErrorCode doWork(int dataPipeId) override;
 
   static constexpr const char* CONFIG_INTERNAL_RULES_FILED = "rules";
-  static constexpr const char* CONFIG_INTERNAL_PORT_FILED = "port";
-  static constexpr const char* CONFIG_INTERNAL_CLASS_NAMES_FILED = "classes";
   static constexpr const char* CONFIG_INTERNAL_DEFAULT_PORT_FILED =
       "default_port";
   static constexpr const char* CONFIG_INTERNAL_CLASS_NAMES_FILES_FILED =
       "class_names_file";
-  static constexpr const char* CONFIG_INTERNAL_TIME_INTERVAL_FILED =
-      "time_interval";
-  static constexpr const char* CONFIG_INTERNAL_FRAME_INTERVAL_FILED =
-      "frame_interval";
-  static constexpr const char* CONFIG_INTERNAL_ROUTES_FILED = "routes";
 
   static constexpr const char* CONFIG_INTERNAL_IS_AFFINE_FIELD = "is_affine";
 
+  /**
+   * @brief 单次bmcv_image_crop的最大数量，一帧的目标超出时分批
+   */
+  static constexpr int MAX_CROP_BATCH = 256;
+
  private:
-  void makeSubObjectMetadata(
-      std::shared_ptr<common::ObjectMetadata> obj,
-      std::shared_ptr<common::DetectedObjectMetadata> detObj,
-      std::shared_ptr<common::ObjectMetadata> subObj, int subId);
+  /**
+   * @brief 构造发往分支的SubObjectMetadata
+   * @param[in] cropped : crop后的小图，为nullptr时使用原图
+   */
+  void makeSubObjectMetadata(std::shared_ptr<common::ObjectMetadata> obj,
+                             std::shared_ptr<bm_image> cropped,
+                             std::shared_ptr<common::ObjectMetadata> subObj,
+                             int subId);
+  /**
+   * @brief 一次bmcv_image_crop完成一组区域的crop，作为CropBatch的CropFunc
+   */
+  bool cropImages(bm_handle_t handle, const bm_image& input,
+                  const std::vector<CropBatch<bm_image>::Rect>& rects,
+                  std::vector<std::shared_ptr<bm_image>>& outputs);
   void makeSubFaceObjectMetadata(
       std::shared_ptr<common::ObjectMetadata> obj,
       std::shared_ptr<common::FaceObjectMetadata> faceObj,
@@ -69,28 +80,12 @@ class Distributor : public ::sophon_stream::framework::Element {
   
 
   /**
-   * @brief 按时间间隔分发的所有规则。key：时间间隔，value：{类名，端口}
+   * @brief 编译后的分发规则，类别id到端口的查找表
    */
-  std::unordered_map<float, std::unordered_map<std::string, int>>
-      mTimeDistribRules;
-
-  /**
-   * @brief 按帧间隔分发的所有规则。key：帧间隔，value：{类名，端口}
-   */
-  std::unordered_map<int, std::unordered_map<std::string, int>>
-      mFrameDistribRules;
+  DistribRules mRules;
 
   std::vector<std::string> mClassNames;
   int mDefaultPort;
-  std::vector<float> mTimeIntervals;
-  std::vector<int> mFrameIntervals;
-  /**
-   * @brief
-   * 每一路数据上一次分发的时间，key：channel_id_internal，value：上次分发的时间
-   * 虽然channel_id_internal从0开始有序增长，但由于
-   * 不同channel首次进入doWork的时间先后不能确定，因此采用unordered_map而不是vector
-   */
-  std::unordered_map<int, std::vector<float>> mChannelLastTimes;
 
   sophon_stream::common::Clocker clocker;
 
@@ -0,0 +1,132 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_DISTRIBUTOR_RULES_H_
+#define SOPHON_STREAM_ELEMENT_DISTRIBUTOR_RULES_H_
+
+#include <cstdint>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "common/error_code.h"
+
+namespace sophon_stream {
+namespace element {
+namespace distributor {
+
+/**
+ * @brief 一个分发间隔下所有route编译后的结果
+ */
+struct RouteTable {
+  /**
+   * @brief 下标为类别id，第i位为1表示该类别的目标发往端口i
+   */
+  std::vector<std::uint64_t> classPorts;
+  /**
+   * @brief classes为空的route，发送整张大图
+   */
+  std::uint64_t fullFramePorts = 0;
+  /**
+   * @brief 配置了route。与原实现一致，即使类别都不在class_names_file中，也视为本帧需要分发
+   */
+  bool hasRoutes = false;
+};
+
+/**
+ * @brief 当前帧触发的路由表
+ */
+struct RouteSelection {
+  std::vector<const RouteTable*> tables;
+  bool hasRoutes = false;
+  std::uint64_t fullFramePorts = 0;
+
+  void clear() {
+    tables.clear();
+    hasRoutes = false;
+    fullFramePorts = 0;
+  }
+
+  /**
+   * @brief 类别id对应的所有端口，按位表示
+   */
+  std::uint64_t getPorts(int classId) const {
+    std::uint64_t ports = 0;
+    for (const RouteTable* table : tables) {
+      if (classId >= 0 && classId < static_cast<int>(table->classPorts.size()))
+        ports |= table->classPorts[classId];
+    }
+    return ports;
+  }
+};
+
+/**
+ * @brief distributor的分发规则
+ * @details
+ * 初始化时把按类名配置的route解析为类别id到端口的位图，每帧按类别id直接查表；
+ * 每一路码流各时间间隔上次分发的时间放在按channel_id_internal展开的数组中。
+ */
+class DistribRules {
+ public:
+  static constexpr int MAX_PORT_NUM = 64;
+
+  static constexpr const char* CONFIG_INTERNAL_PORT_FILED = "port";
+  static constexpr const char* CONFIG_INTERNAL_CLASS_NAMES_FILED = "classes";
+  static constexpr const char* CONFIG_INTERNAL_TIME_INTERVAL_FILED =
+      "time_interval";
+  static constexpr const char* CONFIG_INTERNAL_FRAME_INTERVAL_FILED =
+      "frame_interval";
+  static constexpr const char* CONFIG_INTERNAL_ROUTES_FILED = "routes";
+
+  /**
+   * @brief 编译配置中的rules数组
+   * @param[in] classNames : class_names_file中的类名，下标为类别id
+   * @param[out] error : 失败时的原因
+   */
+  common::ErrorCode compile(const nlohmann::json& rules,
+                            const std::vector<std::string>& classNames,
+                            std::string& error);
+
+  /**
+   * @brief 选出当前帧触发的时间间隔规则和帧间隔规则，并更新该路码流的分发时间
+   * @param[in] curTime : 当前时间，单位秒
+   */
+  void select(int channelIdInternal, std::int64_t frameId, float curTime,
+              bool endOfStream, RouteSelection& selection);
+
+  /**
+   * @brief 类名为ppocr的类别，需要按四个角点做透视变换
+   */
+  bool isOcrClass(int classId) const {
+    return classId >= 0 && classId < static_cast<int>(mOcrClasses.size()) &&
+           mOcrClasses[classId];
+  }
+
+ private:
+  std::vector<float> mTimeIntervals;
+  std::vector<RouteTable> mTimeTables;
+  std::vector<int> mFrameIntervals;
+  std::vector<RouteTable> mFrameTables;
+  std::vector<char> mOcrClasses;
+
+  std::mutex mTimeMutex;
+  /**
+   * @brief 每一路上一次分发的时间，
+   * 下标为channel_id_internal * mTimeIntervals.size() + 时间间隔的下标，
+   * 首次出现的channel_id_internal超出范围时扩容
+   */
+  std::vector<float> mChannelLastTimes;
+};
+
+}  // namespace distributor
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_DISTRIBUTOR_RULES_H_
@@ -20,6 +20,23 @@
 namespace sophon_stream {
 namespace element {
 namespace distributor {
+
+namespace {
+
+/**
+ * @brief 按位表示的端口展开为端口号，从小到大
+ */
+std::vector<int> portsOf(std::uint64_t ports) {
+  std::vector<int> result;
+  while (ports) {
+    result.push_back(__builtin_ctzll(ports));
+    ports &= ports - 1;
+  }
+  return result;
+}
+
+}  // namespace
+
 Distributor::Distributor() {}
 Distributor::~Distributor() {}
 
@@ -56,80 +73,13 @@ common::ErrorCode Distributor::initInternal(const std::string& json) {
     }
 
     auto rules = configure.find(CONFIG_INTERNAL_RULES_FILED);
-    for (auto& rule : *rules) {
-      auto routes = rule.find(CONFIG_INTERNAL_ROUTES_FILED);
-      auto time_interval_it = rule.find(CONFIG_INTERNAL_TIME_INTERVAL_FILED);
-      if (time_interval_it != rule.end() && time_interval_it->is_number()) {
-        float time_interval = time_interval_it->get<float>();
-        mTimeIntervals.push_back(time_interval);
-        for (auto& route : *routes) {
-          // 初始化当前interval下的每条路线
-          int port_id = route.find(CONFIG_INTERNAL_PORT_FILED)->get<int>();
-          std::vector<std::string> class_names_route =
-              route.find(CONFIG_INTERNAL_CLASS_NAMES_FILED)
-                  ->get<std::vector<std::string>>();
-          if (class_names_route.size() == 0) {
-            // 没有配置class_names，则认为是full frame
-            mTimeDistribRules[time_interval]["full_frame"] = port_id;
-          }
-          for (auto& class_name : class_names_route) {
-            mTimeDistribRules[time_interval][class_name] = port_id;
-          }
-        }
-      }
-      auto frame_interval_it = rule.find(CONFIG_INTERNAL_FRAME_INTERVAL_FILED);
-      if (frame_interval_it != rule.end() &&
-          frame_interval_it->is_number_integer()) {
-        int frame_interval = frame_interval_it->get<int>();
-        mFrameIntervals.push_back(frame_interval);
-        for (auto& route : *routes) {
-          // 初始化当前interval下的每条路线
-          int port_id = route.find(CONFIG_INTERNAL_PORT_FILED)->get<int>();
-          std::vector<std::string> class_names_route =
-              route.find(CONFIG_INTERNAL_CLASS_NAMES_FILED)
-                  ->get<std::vector<std::string>>();
-          if (class_names_route.size() == 0) {
-            // 没有配置class_names，则认为是full frame
-            mFrameDistribRules[frame_interval]["full_frame"] = port_id;
-          }
-          for (auto& class_name : class_names_route) {
-            mFrameDistribRules[frame_interval][class_name] = port_id;
-          }
-        }
-      }
-      if (time_interval_it == rule.end() && frame_interval_it == rule.end()) {
-        // 用户不配置time_interval和frame_interval，则视为对每一帧做分发，放在frame_interval相关规则里
-        int curFrameInterval = 1;
-        mFrameIntervals.push_back(curFrameInterval);
-        for (auto& route : *routes) {
-          // 初始化当前interval下的每条路线
-          int port_id = route.find(CONFIG_INTERNAL_PORT_FILED)->get<int>();
-          std::vector<std::string> class_names_route =
-              route.find(CONFIG_INTERNAL_CLASS_NAMES_FILED)
-                  ->get<std::vector<std::string>>();
-          if (class_names_route.size() == 0) {
-            // 没有配置class_names，则认为是full frame
-            mFrameDistribRules[curFrameInterval]["full_frame"] = port_id;
-          }
-          for (auto& class_name : class_names_route) {
-            mFrameDistribRules[curFrameInterval][class_name] = port_id;
-          }
-        }
-      }
-    }
-    if (mTimeIntervals.size() > 1) {
-      std::sort(mTimeIntervals.begin(), mTimeIntervals.end());
-      mTimeIntervals.erase(
-          std::unique(mTimeIntervals.begin(), mTimeIntervals.end()),
-          mTimeIntervals.end());
-    }
-    // mLastTimes = std::vector<float>(mTimeIntervals.size(), -99.0);
-    if (mFrameIntervals.size() > 1) {
-      std::sort(mFrameIntervals.begin(), mFrameIntervals.end());
-      mFrameIntervals.erase(
-          std::unique(mFrameIntervals.begin(), mFrameIntervals.end()),
-          mFrameIntervals.end());
-    }
+    STREAM_CHECK(rules != configure.end(),
+                 "rules must be array, please check your Distributor element "
+                 "configuration file");
+    std::string error;
+    errorCode = mRules.compile(*rules, mClassNames, error);
+    STREAM_CHECK(errorCode == common::ErrorCode::SUCCESS, error,
+                 ", please check your Distributor element configuration file");
 
   } while (false);
 
@@ -140,40 +90,12 @@ common::ErrorCode Distributor::initInternal(const std::string& json) {
 
 void Distributor::makeSubObjectMetadata(
     std::shared_ptr<common::ObjectMetadata> obj,
-    std::shared_ptr<common::DetectedObjectMetadata> detObj,
+    std::shared_ptr<bm_image> cropped,
     std::shared_ptr<common::ObjectMetadata> subObj, int subId) {
-  bmcv_rect_t rect;
-  if (detObj != nullptr) {
-    rect.start_x = detObj->mBox.mX;
-    rect.start_y = detObj->mBox.mY;
-    rect.crop_w = detObj->mBox.mWidth;
-    rect.crop_h = detObj->mBox.mHeight;
-  }
-
   subObj->mFrame = std::make_shared<common::Frame>();
 
   // crop or not
-  if (detObj != nullptr) {
-    std::shared_ptr<bm_image> cropped = nullptr;
-    cropped.reset(new bm_image, [](bm_image* p) {
-      bm_image_destroy(*p);
-      delete p;
-      p = nullptr;
-    });
-    bm_status_t ret =
-        bm_image_create(obj->mFrame->mHandle, rect.crop_h, rect.crop_w,
-                        obj->mFrame->mSpData->image_format,
-                        obj->mFrame->mSpData->data_type, cropped.get());
-    // #if BMCV_VERSION_MAJOR > 1
-    //     ret = bmcv_image_vpp_convert(obj->mFrame->mHandle, 1,
-    //     *obj->mFrame->mSpData,
-    //                                  cropped.get(), &rect);
-    // #else
-    ret = bmcv_image_crop(obj->mFrame->mHandle, 1, &rect, *obj->mFrame->mSpData,
-                          cropped.get());
-    // #endif
-    // STREAM_CHECK(ret == 0, "Bmcv Crop Failed! Program Terminated.")
-
+  if (cropped != nullptr) {
     subObj->mFrame->mSpData = cropped;
   } else {
     subObj->mFrame->mSpData = obj->mFrame->mSpData;
@@ -187,6 +109,43 @@ void Distributor::makeSubObjectMetadata(
   subObj->mFrame->mEndOfStream = obj->mFrame->mEndOfStream;
 }
 
+bool Distributor::cropImages(
+    bm_handle_t handle, const bm_image& input,
+    const std::vector<CropBatch<bm_image>::Rect>& rects,
+    std::vector<std::shared_ptr<bm_image>>& outputs) {
+  std::vector<bmcv_rect_t> bmRects(rects.size());
+  std::vector<bm_image> images(rects.size());
+  size_t created = 0;
+  bm_status_t ret = BM_SUCCESS;
+  for (; created < rects.size(); ++created) {
+    bmRects[created].start_x = rects[created].x;
+    bmRects[created].start_y = rects[created].y;
+    bmRects[created].crop_w = rects[created].width;
+    bmRects[created].crop_h = rects[created].height;
+    ret = bm_image_create(handle, rects[created].height, rects[created].width,
+                          input.image_format, input.data_type,
+                          &images[created]);
+    if (ret != BM_SUCCESS) break;
+  }
+  if (ret == BM_SUCCESS) {
+    ret = bmcv_image_crop(handle, rects.size(), bmRects.data(), input,
+                          images.data());
+  }
+  if (ret != BM_SUCCESS) {
+    for (size_t i = 0; i < created; ++i) bm_image_destroy(images[i]);
+    return false;
+  }
+
+  for (auto& image : images) {
+    outputs.emplace_back(new bm_image(image), [](bm_image* p) {
+      bm_image_destroy(*p);
+      delete p;
+      p = nullptr;
+    });
+  }
+  return true;
+}
+
 cv::Mat Distributor::estimateAffine2D(
     const std::vector<cv::Point2f>& src_points,
     const std::vector<cv::Point2f>& dst_points) {
@@ -543,10 +502,9 @@ common::ErrorCode Distributor::doWork(int dataPipeId) {
   std::vector<int> inputPorts = getInputPorts();
   int inputPort = inputPorts[0];
 
-  auto data = popInputData(inputPort, dataPipeId);
-  while (!data && (getThreadStatus() == ThreadStatus::RUN)) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    data = popInputData(inputPort, dataPipeId);
+  auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+  while (!data && shouldWaitInputData()) {
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
   }
   if (data == nullptr) return common::ErrorCode::SUCCESS;
 
@@ -557,41 +515,14 @@ common::ErrorCode Distributor::doWork(int dataPipeId) {
   int outDataPipeId =
       channel_id_internal % getOutputConnectorCapacity(mDefaultPort);
 
-  if (mChannelLastTimes.find(channel_id_internal) == mChannelLastTimes.end()) {
-    mChannelLastTimes[channel_id_internal] =
-        std::vector<float>(mTimeIntervals.size(), -99.0);
-  }
-  // 判断计时器规则
+  // 判断计时器规则和跳帧规则
   float cur_time = clocker.tell_ms() / 1000.0;
   int subId = 0;
-  std::unordered_map<std::string, std::unordered_set<int>> class2ports;
-  for (int i = 0; i < mChannelLastTimes[channel_id_internal].size(); ++i) {
-    if (cur_time - mChannelLastTimes[channel_id_internal][i] >
-            mTimeIntervals[i] ||
-        objectMetadata->mFrame->mEndOfStream) {
-      // IVS_DEBUG("meet time interval rules, frame id = {0}",
-      // objectMetadata->mFrame->mFrameId);
-      mChannelLastTimes[channel_id_internal][i] = cur_time;
-      for (auto class_port_it = mTimeDistribRules[mTimeIntervals[i]].begin();
-           class_port_it != mTimeDistribRules[mTimeIntervals[i]].end();
-           ++class_port_it) {
-        class2ports[class_port_it->first].insert(class_port_it->second);
-      }
-    }
-  }
-  // 判断跳帧规则
-  for (int i = 0; i < mFrameIntervals.size(); ++i) {
-    if (objectMetadata->mFrame->mFrameId % mFrameIntervals[i] == 0 ||
-        objectMetadata->mFrame->mEndOfStream) {
-      for (auto class_port_it = mFrameDistribRules[mFrameIntervals[i]].begin();
-           class_port_it != mFrameDistribRules[mFrameIntervals[i]].end();
-           ++class_port_it) {
-        class2ports[class_port_it->first].insert(class_port_it->second);
-      }
-    }
-  }
+  RouteSelection selection;
+  mRules.select(channel_id_internal, objectMetadata->mFrame->mFrameId,
+                cur_time, objectMetadata->mFrame->mEndOfStream, selection);
 
-  if (class2ports.size() > 0) {
+  if (selection.hasRoutes) {
     if (objectMetadata->mFrame->mEndOfStream) {
       std::vector<int> outputPorts = getOutputPorts();
       for (auto outPort : outputPorts) {
@@ -621,92 +552,115 @@ common::ErrorCode Distributor::doWork(int dataPipeId) {
 
     for (auto faceObj : objectMetadata->mFaceObjectMetadatas) {
       int class_id = 0;
-      std::string class_name = mClassNames[class_id];
-      if (class2ports.find(class_name) != class2ports.end()) {
-        for (auto port_it = class2ports[class_name].begin();
-             port_it != class2ports[class_name].end(); ++port_it) {
-          int target_port = *port_it;
-          // 构造SubObjectMetadata
-          std::shared_ptr<common::ObjectMetadata> subObj =
-              std::make_shared<common::ObjectMetadata>();
-          makeSubFaceObjectMetadata(objectMetadata, faceObj, subObj, subId);
-          objectMetadata->mSubObjectMetadatas.push_back(subObj);
-          ++objectMetadata->numBranches;
-
-          int outDataPipeId =
-              channel_id_internal % getOutputConnectorCapacity(target_port);
-          errorCode = pushOutputData(target_port, outDataPipeId,
-                                     std::static_pointer_cast<void>(subObj));
-          IVS_DEBUG(
-              "Sub ObjectMetadata is sent to branch, channel_id = {0}, "
-              "frame_id = {1}, subId = {2}",
-              channel_id_internal, subObj->mFrame->mFrameId, subId);
-          if (common::ErrorCode::SUCCESS != errorCode) {
-            IVS_WARN(
-                "Send data fail, element id: {0:d}, output port: {1:d}, "
-                "data: "
-                "{2:p}",
-                getId(), target_port, static_cast<void*>(subObj.get()));
-          }
+      for (int target_port : portsOf(selection.getPorts(class_id))) {
+        // 构造SubObjectMetadata
+        std::shared_ptr<common::ObjectMetadata> subObj =
+            std::make_shared<common::ObjectMetadata>();
+        makeSubFaceObjectMetadata(objectMetadata, faceObj, subObj, subId);
+        objectMetadata->mSubObjectMetadatas.push_back(subObj);
+        ++objectMetadata->numBranches;
+
+        int outDataPipeId =
+            channel_id_internal % getOutputConnectorCapacity(target_port);
+        errorCode = pushOutputData(target_port, outDataPipeId,
+                                   std::static_pointer_cast<void>(subObj));
+        IVS_DEBUG(
+            "Sub ObjectMetadata is sent to branch, channel_id = {0}, "
+            "frame_id = {1}, subId = {2}",
+            channel_id_internal, subObj->mFrame->mFrameId, subId);
+        if (common::ErrorCode::SUCCESS != errorCode) {
+          IVS_WARN(
+              "Send data fail, element id: {0:d}, output port: {1:d}, "
+              "data: "
+              "{2:p}",
+              getId(), target_port, static_cast<void*>(subObj.get()));
         }
       }
       ++subId;
     }
 
-    for (auto detObj : objectMetadata->mDetectedObjectMetadatas) {
-      int class_id = detObj->mClassify;
-      std::string class_name = mClassNames[class_id];
-      if (class2ports.find(class_name) != class2ports.end()) {
-        for (auto port_it = class2ports[class_name].begin();
-             port_it != class2ports[class_name].end(); ++port_it) {
-          int target_port = *port_it;
-          // 构造SubObjectMetadata
-          std::shared_ptr<common::ObjectMetadata> subObj =
-              std::make_shared<common::ObjectMetadata>();
-
-          if (class_name == "ppocr") {
-            makeSubOcrObjectMetadata(objectMetadata, detObj, subObj, subId);
-          } else {
-            makeSubObjectMetadata(objectMetadata, detObj, subObj, subId);
-          }
-
-          objectMetadata->mSubObjectMetadatas.push_back(subObj);
-          ++objectMetadata->numBranches;
-          int outDataPipeId =
-              channel_id_internal % getOutputConnectorCapacity(target_port);
-          errorCode = pushOutputData(target_port, outDataPipeId,
-                                     std::static_pointer_cast<void>(subObj));
-          IVS_DEBUG(
-              "Sub ObjectMetadata is sent to branch, channel_id = {0}, "
-              "frame_id = {1}, subId = {2}",
-              channel_id_internal, subObj->mFrame->mFrameId, subId);
-          if (common::ErrorCode::SUCCESS != errorCode) {
-            IVS_WARN(
-                "Send data fail, element id: {0:d}, output port: {1:d}, "
-                "data: "
-                "{2:p}",
-                getId(), target_port, static_cast<void*>(subObj.get()));
-          }
-        }
-      }
-      ++subId;
+    // 先收集本帧所有需要crop的检测框，一次完成crop，同一目标发往多个端口时共用crop结果
+    auto& detObjs = objectMetadata->mDetectedObjectMetadatas;
+    // 跟踪之后mTrackedObjectMetadatas与检测框一一对应，跟踪id随子对象下发
+    auto& trackObjs = objectMetadata->mTrackedObjectMetadatas;
+    bool withTrack = !trackObjs.empty() && trackObjs.size() == detObjs.size();
+    CropBatch<bm_image> cropBatch(MAX_CROP_BATCH);
+    std::vector<int> cropIndexs(detObjs.size(), -1);
+    for (size_t i = 0; i < detObjs.size(); ++i) {
+      int class_id = detObjs[i]->mClassify;
+      if (selection.getPorts(class_id) == 0 || mRules.isOcrClass(class_id))
+        continue;
+      const auto& box = detObjs[i]->mBox;
+      cropIndexs[i] = cropBatch.add(box.mX, box.mY, box.mWidth, box.mHeight);
+    }
+    if (!cropBatch.empty() &&
+        !cropBatch.run(*objectMetadata->mFrame->mSpData,
+                       std::bind(&Distributor::cropImages, this,
+                                 objectMetadata->mFrame->mHandle,
+                                 std::placeholders::_1, std::placeholders::_2,
+                                 std::placeholders::_3))) {
+      IVS_ERROR(
+          "Bmcv crop failed, element id: {0:d}, channel_id = {1}, frame_id = "
+          "{2}, crop number: {3}",
+          getId(), channel_id_internal, objectMetadata->mFrame->mFrameId,
+          cropBatch.size());
     }
 
-    if (class2ports.find("full_frame") != class2ports.end()) {
-      for (auto port_it = class2ports["full_frame"].begin();
-           port_it != class2ports["full_frame"].end(); ++port_it) {
-        // full_frame 分发，也是构造一个新的SubObjectMetadata
+    for (size_t i = 0; i < detObjs.size(); ++i) {
+      auto detObj = detObjs[i];
+      int class_id = detObj->mClassify;
+      bool isOcr = mRules.isOcrClass(class_id);
+      std::shared_ptr<bm_image> cropped =
+          cropIndexs[i] >= 0 ? cropBatch.get(cropIndexs[i]) : nullptr;
+      // crop失败的目标不再分发
+      if (!isOcr && cropped == nullptr) {
+        ++subId;
+        continue;
+      }
+      for (int target_port : portsOf(selection.getPorts(class_id))) {
+        // 构造SubObjectMetadata
         std::shared_ptr<common::ObjectMetadata> subObj =
             std::make_shared<common::ObjectMetadata>();
-        makeSubObjectMetadata(objectMetadata, nullptr, subObj, -1);
+
+        if (isOcr) {
+          makeSubOcrObjectMetadata(objectMetadata, detObj, subObj, subId);
+        } else {
+          makeSubObjectMetadata(objectMetadata, cropped, subObj, subId);
+        }
+        if (withTrack) subObj->mTrackedObjectMetadatas.push_back(trackObjs[i]);
+
         objectMetadata->mSubObjectMetadatas.push_back(subObj);
         ++objectMetadata->numBranches;
-        int target_port = *port_it;
         int outDataPipeId =
             channel_id_internal % getOutputConnectorCapacity(target_port);
         errorCode = pushOutputData(target_port, outDataPipeId,
                                    std::static_pointer_cast<void>(subObj));
+        IVS_DEBUG(
+            "Sub ObjectMetadata is sent to branch, channel_id = {0}, "
+            "frame_id = {1}, subId = {2}",
+            channel_id_internal, subObj->mFrame->mFrameId, subId);
+        if (common::ErrorCode::SUCCESS != errorCode) {
+          IVS_WARN(
+              "Send data fail, element id: {0:d}, output port: {1:d}, "
+              "data: "
+              "{2:p}",
+              getId(), target_port, static_cast<void*>(subObj.get()));
+        }
       }
+      ++subId;
+    }
+
+    for (int target_port : portsOf(selection.fullFramePorts)) {
+      // full_frame 分发，也是构造一个新的SubObjectMetadata
+      std::shared_ptr<common::ObjectMetadata> subObj =
+          std::make_shared<common::ObjectMetadata>();
+      makeSubObjectMetadata(objectMetadata, nullptr, subObj, -1);
+      objectMetadata->mSubObjectMetadatas.push_back(subObj);
+      ++objectMetadata->numBranches;
+      int outDataPipeId =
+          channel_id_internal % getOutputConnectorCapacity(target_port);
+      errorCode = pushOutputData(target_port, outDataPipeId,
+                                 std::static_pointer_cast<void>(subObj));
     }
   }
 
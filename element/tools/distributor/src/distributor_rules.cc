@@ -0,0 +1,160 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "distributor_rules.h"
+
+#include <map>
+
+namespace sophon_stream {
+namespace element {
+namespace distributor {
+
+namespace {
+
+constexpr const char* FULL_FRAME = "full_frame";
+
+/**
+ * @brief 把一条rule的routes合并到该间隔的{类名，端口}表中，同名类别后配置的端口生效
+ */
+bool addRoutes(const nlohmann::json& routes, std::map<std::string, int>& rules,
+               std::string& error) {
+  if (!routes.is_array()) {
+    error = "routes must be array";
+    return false;
+  }
+  for (auto& route : routes) {
+    auto portIt = route.find(DistribRules::CONFIG_INTERNAL_PORT_FILED);
+    if (portIt == route.end() || !portIt->is_number_integer() ||
+        portIt->get<int>() < 0 ||
+        portIt->get<int>() >= DistribRules::MAX_PORT_NUM) {
+      error = "port must be int in [0, 64)";
+      return false;
+    }
+    auto classesIt = route.find(DistribRules::CONFIG_INTERNAL_CLASS_NAMES_FILED);
+    if (classesIt == route.end() || !classesIt->is_array()) {
+      error = "classes must be array";
+      return false;
+    }
+    int port = portIt->get<int>();
+    // 没有配置class_names，则认为是full frame
+    if (classesIt->empty()) rules[FULL_FRAME] = port;
+    for (auto& className : *classesIt) {
+      if (!className.is_string()) {
+        error = "class name must be string";
+        return false;
+      }
+      rules[className.get<std::string>()] = port;
+    }
+  }
+  return true;
+}
+
+RouteTable makeTable(const std::map<std::string, int>& rules,
+                     const std::vector<std::string>& classNames) {
+  RouteTable table;
+  table.hasRoutes = !rules.empty();
+  table.classPorts.assign(classNames.size(), 0);
+  for (const auto& rule : rules) {
+    std::uint64_t port = std::uint64_t(1) << rule.second;
+    if (rule.first == FULL_FRAME) table.fullFramePorts |= port;
+    for (size_t id = 0; id < classNames.size(); ++id) {
+      if (classNames[id] == rule.first) table.classPorts[id] |= port;
+    }
+  }
+  return table;
+}
+
+}  // namespace
+
+common::ErrorCode DistribRules::compile(
+    const nlohmann::json& rules, const std::vector<std::string>& classNames,
+    std::string& error) {
+  if (!rules.is_array()) {
+    error = "rules must be array";
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  std::map<float, std::map<std::string, int>> timeRules;
+  std::map<int, std::map<std::string, int>> frameRules;
+  for (auto& rule : rules) {
+    auto routesIt = rule.find(CONFIG_INTERNAL_ROUTES_FILED);
+    if (routesIt == rule.end()) {
+      error = "routes must be array";
+      return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+    }
+    auto timeIntervalIt = rule.find(CONFIG_INTERNAL_TIME_INTERVAL_FILED);
+    if (timeIntervalIt != rule.end() && timeIntervalIt->is_number()) {
+      if (!addRoutes(*routesIt, timeRules[timeIntervalIt->get<float>()],
+                     error))
+        return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+    }
+    auto frameIntervalIt = rule.find(CONFIG_INTERNAL_FRAME_INTERVAL_FILED);
+    if (frameIntervalIt != rule.end() &&
+        frameIntervalIt->is_number_integer()) {
+      if (frameIntervalIt->get<int>() <= 0) {
+        error = "frame_interval must be positive";
+        return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+      }
+      if (!addRoutes(*routesIt, frameRules[frameIntervalIt->get<int>()],
+                     error))
+        return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+    }
+    if (timeIntervalIt == rule.end() && frameIntervalIt == rule.end()) {
+      // 用户不配置time_interval和frame_interval，则视为对每一帧做分发，放在frame_interval相关规则里
+      if (!addRoutes(*routesIt, frameRules[1], error))
+        return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+    }
+  }
+
+  // std::map按间隔从小到大排列，与原实现排序去重后的顺序一致
+  for (const auto& rule : timeRules) {
+    mTimeIntervals.push_back(rule.first);
+    mTimeTables.push_back(makeTable(rule.second, classNames));
+  }
+  for (const auto& rule : frameRules) {
+    mFrameIntervals.push_back(rule.first);
+    mFrameTables.push_back(makeTable(rule.second, classNames));
+  }
+  mOcrClasses.assign(classNames.size(), 0);
+  for (size_t id = 0; id < classNames.size(); ++id) {
+    mOcrClasses[id] = classNames[id] == "ppocr";
+  }
+  return common::ErrorCode::SUCCESS;
+}
+
+void DistribRules::select(int channelIdInternal, std::int64_t frameId,
+                          float curTime, bool endOfStream,
+                          RouteSelection& selection) {
+  selection.clear();
+  const size_t timeNumber = mTimeIntervals.size();
+  if (timeNumber > 0) {
+    std::lock_guard<std::mutex> lock(mTimeMutex);
+    size_t offset = static_cast<size_t>(channelIdInternal) * timeNumber;
+    if (mChannelLastTimes.size() < offset + timeNumber)
+      mChannelLastTimes.resize(offset + timeNumber, -99.0);
+    float* lastTimes = mChannelLastTimes.data() + offset;
+    for (size_t i = 0; i < timeNumber; ++i) {
+      if (curTime - lastTimes[i] > mTimeIntervals[i] || endOfStream) {
+        lastTimes[i] = curTime;
+        selection.tables.push_back(&mTimeTables[i]);
+      }
+    }
+  }
+  for (size_t i = 0; i < mFrameIntervals.size(); ++i) {
+    if (frameId % mFrameIntervals[i] == 0 || endOfStream)
+      selection.tables.push_back(&mFrameTables[i]);
+  }
+  for (const RouteTable* table : selection.tables) {
+    selection.hasRoutes |= table->hasRoutes;
+    selection.fullFramePorts |= table->fullFramePorts;
+  }
+}
+
+}  // namespace distributor
+}  // namespace element
+}  // namespace sophon_stream
@@ -0,0 +1,112 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_FAISS_FACE_GALLERY_H_
+#define SOPHON_STREAM_ELEMENT_FAISS_FACE_GALLERY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/error_code.h"
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+/**
+ * @brief 二进制底库文件头，所有字段为小端序
+ * @details
+ * 文件布局：header(64字节) | ids: int32[count] | vectors: float32[count*dims]
+ * | labels: count * {uint32长度 + 字节}。vectors的偏移按64字节对齐，
+ * mmap之后可以直接作为行优先的count*dims矩阵使用
+ */
+struct FaceGalleryHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t dims;
+  std::uint32_t reserved;
+  std::uint64_t count;
+  std::uint64_t idsOffset;
+  std::uint64_t vectorsOffset;
+  std::uint64_t labelsOffset;
+  std::uint64_t labelsBytes;
+  std::uint64_t padding;
+};
+
+static_assert(sizeof(FaceGalleryHeader) == 64,
+              "FaceGalleryHeader must be 64 bytes");
+
+/**
+ * @brief 人脸底库：每行一个特征向量、一个稳定的id和一个标签
+ * @details
+ * 二进制文件通过mmap只读映射，getVectors()直接指向映射的内存，
+ * 建立索引时从中复制，不经过中间缓冲区；文本文件（每行一个向量，
+ * 标签文件每行一个标签）解析到自有内存中，id为行号
+ */
+class FaceGallery : public ::sophon_stream::common::NoCopyable {
+ public:
+  static constexpr const char MAGIC[4] = {'S', 'S', 'F', 'G'};
+  static constexpr std::uint32_t VERSION = 1;
+
+  FaceGallery() = default;
+  ~FaceGallery();
+
+  /**
+   * @brief 文件以MAGIC开头时按二进制格式加载，labelPath被忽略；
+   * 否则按文本格式加载dbPath和labelPath
+   */
+  common::ErrorCode load(const std::string& dbPath,
+                         const std::string& labelPath);
+  common::ErrorCode loadBinary(const std::string& path);
+  common::ErrorCode loadText(const std::string& dbPath,
+                             const std::string& labelPath);
+
+  /**
+   * @brief 先写入path.tmp再rename，写入过程中崩溃不会破坏原文件
+   */
+  static common::ErrorCode saveBinary(const std::string& path, int dims,
+                                      const std::vector<int>& ids,
+                                      const std::vector<float>& vectors,
+                                      const std::vector<std::string>& labels);
+
+  /**
+   * @brief 释放映射的内存或解析的向量，id和标签保留
+   */
+  void releaseVectors();
+
+  int getDims() const { return mDims; }
+  /**
+   * @brief 当前向量是否来自mmap的二进制文件
+   */
+  bool isMapped() const { return mMapped != nullptr; }
+  std::size_t getCount() const { return mIds.size(); }
+  const float* getVectors() const { return mVectors; }
+  const std::vector<int>& getIds() const { return mIds; }
+  const std::vector<std::string>& getLabels() const { return mLabels; }
+
+ private:
+  void unmap();
+
+  int mDims = 0;
+  std::vector<int> mIds;
+  std::vector<std::string> mLabels;
+  const float* mVectors = nullptr;
+  std::vector<float> mOwnedVectors;
+  void* mMapped = nullptr;
+  std::size_t mMappedSize = 0;
+};
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_FAISS_FACE_GALLERY_H_
@@ -0,0 +1,162 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_FAISS_FACE_INDEX_H_
+#define SOPHON_STREAM_ELEMENT_FAISS_FACE_INDEX_H_
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+/**
+ * @brief 内积相似度索引，id由调用者分配，同一个id只能存在一次
+ * @details
+ * search()可以被多个线程同时调用，add()/remove()需要调用者保证与search()互斥
+ */
+class FaceIndex {
+ public:
+  virtual ~FaceIndex() = default;
+
+  virtual const char* getName() const = 0;
+  int getDims() const { return mDims; }
+  virtual std::size_t size() const = 0;
+
+  /**
+   * @brief 加载底库时调用一次，默认实现等同于add()
+   */
+  virtual void build(const int* ids, const float* vectors, int num) {
+    add(ids, vectors, num);
+  }
+  virtual void add(const int* ids, const float* vectors, int num) = 0;
+  /**
+   * @return 实际删除的数量，不存在的id被忽略
+   */
+  virtual int remove(const int* ids, int num) = 0;
+
+  /**
+   * @brief 一次查询num个向量，每个向量返回内积最大的k个结果，按相似度降序
+   * @param scores num*k个相似度
+   * @param ids num*k个id，结果不足k个时其余位置为-1
+   */
+  virtual void search(const float* queries, int num, int k, float* scores,
+                      int* ids) const = 0;
+
+  /**
+   * @brief 按当前顺序导出全部id和向量，用于保存底库
+   */
+  virtual void exportTo(std::vector<int>& ids,
+                        std::vector<float>& vectors) const = 0;
+
+ protected:
+  explicit FaceIndex(int dims) : mDims(dims) {}
+
+  const int mDims;
+};
+
+/**
+ * @brief 暴力检索，行优先连续存储，删除时用最后一行填补空位
+ * @details
+ * 每次取QUERY_BLOCK个查询向量与底库逐行计算内积，底库只需读一遍，
+ * 内积使用AVX2/SSE2/NEON实现，运行时按CPU特性选择
+ */
+class FlatIndex : public FaceIndex {
+ public:
+  explicit FlatIndex(int dims);
+
+  const char* getName() const override { return "cpu_flat"; }
+  std::size_t size() const override { return mIds.size(); }
+  void add(const int* ids, const float* vectors, int num) override;
+  int remove(const int* ids, int num) override;
+  void search(const float* queries, int num, int k, float* scores,
+              int* ids) const override;
+  void exportTo(std::vector<int>& ids,
+                std::vector<float>& vectors) const override;
+
+ private:
+  std::vector<int> mIds;
+  std::vector<float> mVectors;
+  std::unordered_map<int, std::size_t> mRows;
+};
+
+struct IvfIndexConfig {
+  /**
+   * @brief 聚类中心数量，0表示按底库大小自动选择（约sqrt(N)）；
+   * 底库小于nlist*MIN_POINTS_PER_LIST时按底库大小减少
+   */
+  int nlist = 0;
+  /**
+   * @brief 每个查询检索的聚类数量
+   */
+  int nprobe = 8;
+};
+
+/**
+ * @brief 倒排索引：按球面k-means把底库划分为nlist个列表，
+ * 查询时只检索与查询向量内积最大的nprobe个列表
+ * @details
+ * 一批查询先按列表分组，同一个列表的查询按QUERY_BLOCK成组检索。
+ * 新增的向量加入最近的列表；底库增长到聚类时的两倍以上且nlist
+ * 可以随之增加时，在add()中重新聚类
+ */
+class IvfIndex : public FaceIndex {
+ public:
+  static constexpr int MIN_POINTS_PER_LIST = 32;
+  static constexpr int TRAIN_POINTS_PER_LIST = 128;
+  static constexpr int TRAIN_ITERATIONS = 10;
+
+  IvfIndex(int dims, const IvfIndexConfig& config);
+
+  const char* getName() const override { return "cpu_ivf"; }
+  std::size_t size() const override { return mRows.size(); }
+  void build(const int* ids, const float* vectors, int num) override;
+  void add(const int* ids, const float* vectors, int num) override;
+  int remove(const int* ids, int num) override;
+  void search(const float* queries, int num, int k, float* scores,
+              int* ids) const override;
+  void exportTo(std::vector<int>& ids,
+                std::vector<float>& vectors) const override;
+
+  int getListNumber() const { return static_cast<int>(mLists.size()); }
+
+ private:
+  struct List {
+    std::vector<int> ids;
+    std::vector<float> vectors;
+  };
+
+  int chooseListNumber(std::size_t num) const;
+  void train(const float* vectors, std::size_t num);
+  void assign(const int* ids, const float* vectors, int num);
+
+  const IvfIndexConfig mConfig;
+  std::vector<float> mCentroids;
+  std::vector<List> mLists;
+  /**
+   * @brief id -> {列表, 行}
+   */
+  std::unordered_map<int, std::pair<int, std::size_t>> mRows;
+  std::size_t mTrainedSize = 0;
+};
+
+/**
+ * @brief 当前CPU上使用的内积实现名称：avx2、sse2、neon或scalar
+ */
+const char* getInnerProductKernelName();
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_FAISS_FACE_INDEX_H_
@@ -10,16 +10,31 @@
 #ifndef SOPHON_STREAM_ELEMENT_FAISS_H_
 #define SOPHON_STREAM_ELEMENT_FAISS_H_
 
-#include "bmcv_api_ext.h"
-
-#if BMCV_VERSION_MAJOR <= 1
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
 
 #include "common/object_metadata.h"
 #include "element.h"
+#include "face_index.h"
+#include "track_result_cache.h"
 
 namespace sophon_stream {
 namespace element {
 namespace faiss {
+
+/**
+ * @brief 人脸特征检索，为每个RecognizedObjectMetadata填充底库中最相似的top_k个人脸
+ * @details
+ * 一次doWork把同一个dataPipe中已到达的多帧合并为一次查询，最多max_batch个人脸。
+ * 检索后端由backend选择：tpu（bmcv_faiss_indexflatIP）、cpu_flat、cpu_ivf。
+ * 相似度低于score_threshold的候选被丢弃，没有候选时mLabelName为unknown_label。
+ * 带跟踪id的人脸按(通道, 跟踪id)缓存结果，跟踪稳定时不重复检索。
+ * 底库可以通过http接口增删和保存，修改时持有写锁，检索持有读锁
+ */
 class Faiss : public ::sophon_stream::framework::Element {
  public:
   Faiss();
@@ -29,37 +44,94 @@ class Faiss : public ::sophon_stream::framework::Element {
 
   common::ErrorCode doWork(int dataPipeId) override;
 
+  /**
+   * @brief 注册底库增删和保存的http接口
+   */
+  void registListenFunc(
+      sophon_stream::framework::ListenThread* listener) override;
+
   static constexpr const char* CONFIG_INTERNAL_DEFAULT_PORT_FILED =
       "default_port";
   static constexpr const char* CONFIG_INTERNAL_DB_DATA_PATH_FILED = "db_path";
   static constexpr const char* CONFIG_INTERNAL_LABEL_PATH_FILED = "label_path";
-  int subId = 0;
+  static constexpr const char* CONFIG_INTERNAL_SAVE_PATH_FILED = "save_path";
+  static constexpr const char* CONFIG_INTERNAL_BACKEND_FILED = "backend";
+  static constexpr const char* CONFIG_INTERNAL_DIMS_FILED = "dims";
+  static constexpr const char* CONFIG_INTERNAL_MAX_BATCH_FILED = "max_batch";
+  static constexpr const char* CONFIG_INTERNAL_NLIST_FILED = "nlist";
+  static constexpr const char* CONFIG_INTERNAL_NPROBE_FILED = "nprobe";
+  static constexpr const char* CONFIG_INTERNAL_TOP_K_FILED = "top_k";
+  static constexpr const char* CONFIG_INTERNAL_SCORE_THRESHOLD_FILED =
+      "score_threshold";
+  static constexpr const char* CONFIG_INTERNAL_UNKNOWN_LABEL_FILED =
+      "unknown_label";
+  static constexpr const char* CONFIG_INTERNAL_TRACK_CACHE_FRAMES_FILED =
+      "track_cache_frames";
+  static constexpr const char* CONFIG_INTERNAL_TRACK_CACHE_SIMILARITY_FILED =
+      "track_cache_similarity";
+
+  static constexpr const char* BACKEND_TPU = "tpu";
+  static constexpr const char* BACKEND_CPU_FLAT = "cpu_flat";
+  static constexpr const char* BACKEND_CPU_IVF = "cpu_ivf";
 
  private:
-  int mDefaultPort;
-
-  int sort_cnt = 5;
-  int query_vecs_num = 1;
-  int db_vecs_num = 300;
-  int is_transpose = 1;
-  int input_dtype = 5;
-  int output_dtype = 5;
-  int vec_dims = 512;
-
-  std::vector<std::string> mClassNames;
-  float* db_data;
-  float* output_dis;
-  int* output_inx;
-
-  void getFaceId(std::shared_ptr<common::RecognizedObjectMetadata> resnetObj);
-  bm_handle_t handle = nullptr;
-  bm_device_mem_t query_data_dev_mem;
-  bm_device_mem_t db_data_dev_mem;
-  bm_device_mem_t buffer_dev_mem;
-  bm_device_mem_t sorted_similarity_dev_mem;
-  bm_device_mem_t sorted_index_dev_mem;
-  std::mutex mutex;
-  
+  /**
+   * @brief 请求体为{"faces": [{"label": "name", "feature": [...]}]}，
+   * 返回的results中taskId为分配的id
+   */
+  void listenerAddFaces(const httplib::Request& request,
+                        httplib::Response& response);
+  /**
+   * @brief 请求体为{"labels": [...], "ids": [...]}，两者可以只给一个，
+   * 返回的results中taskId为删除的id
+   */
+  void listenerRemoveFaces(const httplib::Request& request,
+                           httplib::Response& response);
+  /**
+   * @brief 保存到配置的save_path，请求体中的path可以省略，给出时必须与save_path相同
+   */
+  void listenerSaveGallery(const httplib::Request& request,
+                           httplib::Response& response);
+
+  common::ErrorCode createIndex(const std::string& backend, int dims,
+                                const IvfIndexConfig& ivfConfig);
+
+  /**
+   * @brief 一次检索objectMetadatas中所有带特征且未命中缓存的人脸并填充结果
+   */
+  void searchFaces(
+      const std::vector<std::shared_ptr<common::ObjectMetadata>>&
+          objectMetadatas);
+
+  /**
+   * @brief 按阈值过滤k个候选，填充mTopKLabels、mScores、mTopKLabelNames和mLabelName
+   */
+  void fillResult(common::RecognizedObjectMetadata& face, const int* ids,
+                  const float* scores) const;
+
+  int mMaxBatch = 32;
+  int mTopK = 1;
+  float mScoreThreshold = std::numeric_limits<float>::lowest();
+  std::string mUnknownLabel = "unknown";
+  std::string mSavePath;
+
+  std::unique_ptr<FaceIndex> mIndex;
+  /**
+   * @brief 按id索引的标签，删除的id置空且不再分配
+   */
+  std::vector<std::string> mLabels;
+  int mNextId = 0;
+  /**
+   * @brief 底库每次修改加一，缓存的结果版本不同时失效，读写都持有mIndexMutex
+   */
+  std::uint64_t mGalleryVersion = 0;
+  std::shared_mutex mIndexMutex;
+
+  std::unique_ptr<TrackResultCache> mTrackCache;
+
+  std::string postNameAddFaces = "/faiss/AddFaces";
+  std::string postNameRemoveFaces = "/faiss/RemoveFaces";
+  std::string postNameSaveGallery = "/faiss/SaveGallery";
 };
 
 }  // namespace faiss
@@ -67,4 +139,3 @@ class Faiss : public ::sophon_stream::framework::Element {
 }  // namespace sophon_stream
 
 #endif
-#endif
\ No newline at end of file
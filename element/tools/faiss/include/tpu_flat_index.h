@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_FAISS_TPU_FLAT_INDEX_H_
+#define SOPHON_STREAM_ELEMENT_FAISS_TPU_FLAT_INDEX_H_
+
+#include "bmcv_api_ext.h"
+
+#if BMCV_VERSION_MAJOR <= 1
+
+#include <mutex>
+
+#include "face_index.h"
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+/**
+ * @brief 使用bmcv_faiss_indexflatIP的暴力检索，底库常驻设备内存
+ * @details
+ * 主机侧保留一份行优先的底库用于导出和删除。新增的行按偏移增量上传，
+ * 容量不足时按两倍扩容并整体上传；删除时用最后一行填补空位，只上传被移动的一行。
+ * 一次search()最多把maxBatch个查询合并为一次调用，设备缓冲区由内部的锁保护
+ */
+class TpuFlatIndex : public FaceIndex {
+ public:
+  static constexpr int MIN_CAPACITY = 1024;
+
+  TpuFlatIndex(int devId, int dims, int maxBatch, int maxK);
+  ~TpuFlatIndex() override;
+
+  /**
+   * @brief 申请设备句柄和查询、结果缓冲区
+   */
+  bool init();
+
+  const char* getName() const override { return "tpu"; }
+  std::size_t size() const override { return mIds.size(); }
+  void add(const int* ids, const float* vectors, int num) override;
+  int remove(const int* ids, int num) override;
+  void search(const float* queries, int num, int k, float* scores,
+              int* ids) const override;
+  void exportTo(std::vector<int>& ids,
+                std::vector<float>& vectors) const override;
+
+ private:
+  bool reserve(std::size_t rows);
+  void uploadRows(std::size_t begin, std::size_t end);
+
+  const int mDevId;
+  const int mMaxBatch;
+  const int mMaxK;
+
+  std::vector<int> mIds;
+  std::vector<float> mVectors;
+  std::unordered_map<int, std::size_t> mRows;
+
+  bm_handle_t mHandle = nullptr;
+  std::size_t mCapacity = 0;
+  bm_device_mem_t mQueryMem;
+  bm_device_mem_t mDbMem;
+  bm_device_mem_t mBufferMem;
+  bm_device_mem_t mSortedSimilarityMem;
+  bm_device_mem_t mSortedIndexMem;
+  mutable std::mutex mMutex;
+  mutable std::vector<float> mOutputScores;
+  mutable std::vector<int> mOutputRows;
+};
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif
+#endif  // SOPHON_STREAM_ELEMENT_FAISS_TPU_FLAT_INDEX_H_
@@ -0,0 +1,100 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_FAISS_TRACK_RESULT_CACHE_H_
+#define SOPHON_STREAM_ELEMENT_FAISS_TRACK_RESULT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+struct TrackResultCacheConfig {
+  /**
+   * @brief 一次检索结果最多复用的帧数，0表示不缓存
+   */
+  int maxFrames = 0;
+  /**
+   * @brief 当前特征与检索时特征的余弦相似度低于该值时重新检索
+   */
+  float minSimilarity = 0.9f;
+};
+
+/**
+ * @brief 按(通道, 跟踪id)缓存最近一次的检索结果
+ * @details
+ * 跟踪稳定时同一个人每帧的特征变化很小，命中缓存时直接复用上次的top-k，
+ * 不再检索底库。以下情况视为未命中：距离上次检索达到maxFrames帧、
+ * 特征与上次检索时相差过大、底库在此期间被修改（galleryVersion不同）。
+ * 超过maxFrames帧没有出现的跟踪id被清除。所有接口都是线程安全的
+ */
+class TrackResultCache : public ::sophon_stream::common::NoCopyable {
+ public:
+  TrackResultCache(const TrackResultCacheConfig& config, int dims, int k);
+
+  bool enabled() const { return mConfig.maxFrames > 0; }
+
+  /**
+   * @brief 命中时把缓存的k个id和相似度写入ids和scores
+   */
+  bool lookup(int channelId, long long trackId, long long frameId,
+              const float* feature, std::uint64_t galleryVersion, int* ids,
+              float* scores);
+
+  /**
+   * @brief 记录一次检索的k个结果，feature为检索使用的特征
+   */
+  void update(int channelId, long long trackId, long long frameId,
+              const float* feature, std::uint64_t galleryVersion,
+              const int* ids, const float* scores);
+
+  std::size_t size() const;
+
+ private:
+  struct Entry {
+    /**
+     * @brief 检索时的特征，已归一化
+     */
+    std::vector<float> feature;
+    std::vector<int> ids;
+    std::vector<float> scores;
+    long long searchFrameId = 0;
+    long long lastFrameId = 0;
+    std::uint64_t galleryVersion = 0;
+  };
+
+  struct Channel {
+    std::unordered_map<long long, Entry> entries;
+    long long lastExpireFrameId = 0;
+  };
+
+  /**
+   * @brief 每隔maxFrames帧清除一次长时间没有出现的跟踪id
+   */
+  void expire(Channel& channel, long long frameId);
+
+  const TrackResultCacheConfig mConfig;
+  const int mDims;
+  const int mK;
+  mutable std::mutex mMutex;
+  std::unordered_map<int, Channel> mChannels;
+};
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_FAISS_TRACK_RESULT_CACHE_H_
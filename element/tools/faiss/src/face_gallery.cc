@@ -0,0 +1,270 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "face_gallery.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "common/logger.h"
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+namespace {
+
+constexpr std::uint64_t VECTORS_ALIGN = 64;
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t align) {
+  return (value + align - 1) / align * align;
+}
+
+bool readFile(const std::string& path, std::string& content) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) return false;
+  file.seekg(0, std::ios::end);
+  content.resize(static_cast<std::size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  file.read(&content[0], content.size());
+  return static_cast<bool>(file);
+}
+
+bool writeAll(int fd, const void* data, std::size_t size) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    p += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+}  // namespace
+
+constexpr const char FaceGallery::MAGIC[4];
+
+FaceGallery::~FaceGallery() { unmap(); }
+
+void FaceGallery::unmap() {
+  if (mMapped != nullptr) {
+    munmap(mMapped, mMappedSize);
+    mMapped = nullptr;
+    mMappedSize = 0;
+  }
+}
+
+void FaceGallery::releaseVectors() {
+  unmap();
+  std::vector<float>().swap(mOwnedVectors);
+  mVectors = nullptr;
+}
+
+common::ErrorCode FaceGallery::load(const std::string& dbPath,
+                                    const std::string& labelPath) {
+  char magic[sizeof(MAGIC)] = {0};
+  std::ifstream file(dbPath, std::ios::binary);
+  if (!file.is_open()) {
+    IVS_ERROR("Can not open face gallery: {0}", dbPath);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  file.read(magic, sizeof(magic));
+  file.close();
+  if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0) return loadBinary(dbPath);
+  return loadText(dbPath, labelPath);
+}
+
+common::ErrorCode FaceGallery::loadBinary(const std::string& path) {
+  releaseVectors();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    IVS_ERROR("Can not open face gallery: {0}", path);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::uint64_t>(st.st_size) < sizeof(FaceGalleryHeader)) {
+    ::close(fd);
+    IVS_ERROR("Face gallery {0} is truncated", path);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  std::size_t size = static_cast<std::size_t>(st.st_size);
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    IVS_ERROR("Can not mmap face gallery {0}, errno: {1:d}", path, errno);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  mMapped = mapped;
+  mMappedSize = size;
+
+  const char* base = static_cast<const char*>(mapped);
+  FaceGalleryHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  std::uint64_t vectorsBytes = header.count * header.dims * sizeof(float);
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.dims == 0 ||
+      header.idsOffset + header.count * sizeof(std::int32_t) > size ||
+      header.vectorsOffset % VECTORS_ALIGN != 0 ||
+      header.vectorsOffset + vectorsBytes > size ||
+      header.labelsOffset + header.labelsBytes > size) {
+    IVS_ERROR("Face gallery {0} has an invalid header", path);
+    unmap();
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+
+  mDims = static_cast<int>(header.dims);
+  mIds.resize(header.count);
+  std::memcpy(mIds.data(), base + header.idsOffset,
+              header.count * sizeof(std::int32_t));
+  mLabels.clear();
+  mLabels.reserve(header.count);
+  const char* label = base + header.labelsOffset;
+  const char* labelEnd = label + header.labelsBytes;
+  for (std::uint64_t i = 0; i < header.count; ++i) {
+    std::uint32_t length = 0;
+    if (label + sizeof(length) > labelEnd) break;
+    std::memcpy(&length, label, sizeof(length));
+    label += sizeof(length);
+    if (label + length > labelEnd) break;
+    mLabels.emplace_back(label, length);
+    label += length;
+  }
+  if (mLabels.size() != header.count) {
+    IVS_ERROR("Face gallery {0} has truncated labels", path);
+    unmap();
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  mVectors = reinterpret_cast<const float*>(base + header.vectorsOffset);
+  // 建立索引时顺序读取全部向量
+  madvise(mapped, size, MADV_SEQUENTIAL);
+  return common::ErrorCode::SUCCESS;
+}
+
+common::ErrorCode FaceGallery::loadText(const std::string& dbPath,
+                                        const std::string& labelPath) {
+  releaseVectors();
+  std::string content;
+  if (!readFile(dbPath, content)) {
+    IVS_ERROR("Can not read face gallery: {0}", dbPath);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  // 整个文件一次读入后用strtof逐个解析，每行的列数必须与第一行相同
+  mDims = 0;
+  const char* p = content.c_str();
+  const char* end = p + content.size();
+  while (p < end) {
+    const char* lineEnd =
+        static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (lineEnd == nullptr) lineEnd = end;
+    int cols = 0;
+    char* next = nullptr;
+    for (;;) {
+      float value = std::strtof(p, &next);
+      if (next == p || next > lineEnd) break;
+      mOwnedVectors.push_back(value);
+      ++cols;
+      p = next;
+    }
+    if (cols > 0) {
+      if (mDims == 0) mDims = cols;
+      if (cols != mDims) {
+        IVS_ERROR("Face gallery {0} row {1:d} has {2:d} values, expect {3:d}",
+                  dbPath, static_cast<int>(mIds.size()), cols, mDims);
+        releaseVectors();
+        return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+      }
+      mIds.push_back(static_cast<int>(mIds.size()));
+    }
+    p = lineEnd + 1;
+  }
+  mVectors = mOwnedVectors.data();
+
+  mLabels.clear();
+  std::ifstream istream(labelPath);
+  if (!istream.is_open()) {
+    IVS_ERROR("Can not open face labels: {0}", labelPath);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  std::string line;
+  while (mLabels.size() < mIds.size() && std::getline(istream, line))
+    mLabels.push_back(line);
+  if (mLabels.size() != mIds.size()) {
+    IVS_ERROR("Face labels {0} has {1:d} lines, expect {2:d}", labelPath,
+              static_cast<int>(mLabels.size()), static_cast<int>(mIds.size()));
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  return common::ErrorCode::SUCCESS;
+}
+
+common::ErrorCode FaceGallery::saveBinary(
+    const std::string& path, int dims, const std::vector<int>& ids,
+    const std::vector<float>& vectors,
+    const std::vector<std::string>& labels) {
+  if (dims <= 0 || vectors.size() != ids.size() * dims ||
+      labels.size() != ids.size())
+    return common::ErrorCode::PARAMETER_ERROR;
+
+  FaceGalleryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.dims = static_cast<std::uint32_t>(dims);
+  header.count = ids.size();
+  header.idsOffset = sizeof(FaceGalleryHeader);
+  header.vectorsOffset = alignUp(
+      header.idsOffset + ids.size() * sizeof(std::int32_t), VECTORS_ALIGN);
+  header.labelsOffset =
+      header.vectorsOffset + vectors.size() * sizeof(float);
+  std::string labelBytes;
+  for (const auto& label : labels) {
+    std::uint32_t length = static_cast<std::uint32_t>(label.size());
+    labelBytes.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    labelBytes.append(label);
+  }
+  header.labelsBytes = labelBytes.size();
+
+  std::string tmpPath = path + ".tmp";
+  int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    IVS_ERROR("Can not create face gallery: {0}", tmpPath);
+    return common::ErrorCode::UNKNOWN;
+  }
+  std::vector<char> padding(
+      header.vectorsOffset - header.idsOffset - ids.size() * sizeof(int), 0);
+  bool ok = writeAll(fd, &header, sizeof(header)) &&
+            writeAll(fd, ids.data(), ids.size() * sizeof(int)) &&
+            writeAll(fd, padding.data(), padding.size()) &&
+            writeAll(fd, vectors.data(), vectors.size() * sizeof(float)) &&
+            writeAll(fd, labelBytes.data(), labelBytes.size()) &&
+            fsync(fd) == 0;
+  ok = ::close(fd) == 0 && ok;
+  if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    IVS_ERROR("Write face gallery {0} failed, errno: {1:d}", path, errno);
+    ::unlink(tmpPath.c_str());
+    return common::ErrorCode::UNKNOWN;
+  }
+  return common::ErrorCode::SUCCESS;
+}
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
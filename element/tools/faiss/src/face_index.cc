@@ -0,0 +1,586 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "face_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STREAM_FAISS_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STREAM_FAISS_NEON 1
+#endif
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+namespace {
+
+/**
+ * @brief 每次与底库同一行计算内积的查询向量数量
+ */
+constexpr int QUERY_BLOCK = 4;
+
+/**
+ * @brief 底库按块扫描，一块约256KB留在L2中，块内依次处理所有查询
+ */
+constexpr std::size_t ROW_TILE_BYTES = 256 << 10;
+
+/**
+ * @brief 每次与同一组查询向量计算内积的底库行数，与QUERY_BLOCK组成8个累加器，
+ * 足以掩盖FMA的延迟，每个查询向量和底库行的加载被两行/四个查询共用
+ */
+constexpr int ROW_BLOCK = 2;
+
+/**
+ * @brief 计算QUERY_BLOCK个查询向量与ROW_BLOCK行的内积，out[r * QUERY_BLOCK + j]
+ * 为第r行与第j个查询的内积。只处理前若干维并返回处理的维数，剩余部分由标量代码累加
+ */
+using DotKernel = int (*)(const float* const* queries, const float* const* rows,
+                          int dims, float* out);
+
+int dotNone(const float* const*, const float* const*, int, float* out) {
+  for (int j = 0; j < QUERY_BLOCK * ROW_BLOCK; ++j) out[j] = 0.f;
+  return 0;
+}
+
+#if STREAM_FAISS_X86
+
+inline float hsumSse2(__m128 v) {
+  __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+static_assert(QUERY_BLOCK == 4 && ROW_BLOCK == 2,
+              "kernels are unrolled for 4 queries x 2 rows");
+
+// 累加器显式写成8个变量，用数组时-O2不会展开循环，累加器会被放到栈上
+
+int dotSse2(const float* const* queries, const float* const* rows, int dims,
+            float* out) {
+  __m128 a00 = _mm_setzero_ps(), a01 = a00, a02 = a00, a03 = a00;
+  __m128 a10 = a00, a11 = a00, a12 = a00, a13 = a00;
+  int n = dims / 4 * 4;
+  for (int i = 0; i < n; i += 4) {
+    __m128 x0 = _mm_loadu_ps(rows[0] + i);
+    __m128 x1 = _mm_loadu_ps(rows[1] + i);
+    __m128 q = _mm_loadu_ps(queries[0] + i);
+    a00 = _mm_add_ps(a00, _mm_mul_ps(q, x0));
+    a10 = _mm_add_ps(a10, _mm_mul_ps(q, x1));
+    q = _mm_loadu_ps(queries[1] + i);
+    a01 = _mm_add_ps(a01, _mm_mul_ps(q, x0));
+    a11 = _mm_add_ps(a11, _mm_mul_ps(q, x1));
+    q = _mm_loadu_ps(queries[2] + i);
+    a02 = _mm_add_ps(a02, _mm_mul_ps(q, x0));
+    a12 = _mm_add_ps(a12, _mm_mul_ps(q, x1));
+    q = _mm_loadu_ps(queries[3] + i);
+    a03 = _mm_add_ps(a03, _mm_mul_ps(q, x0));
+    a13 = _mm_add_ps(a13, _mm_mul_ps(q, x1));
+  }
+  out[0] = hsumSse2(a00);
+  out[1] = hsumSse2(a01);
+  out[2] = hsumSse2(a02);
+  out[3] = hsumSse2(a03);
+  out[4] = hsumSse2(a10);
+  out[5] = hsumSse2(a11);
+  out[6] = hsumSse2(a12);
+  out[7] = hsumSse2(a13);
+  return n;
+}
+
+__attribute__((target("avx2,fma"))) inline float hsumAvx2(__m256 v) {
+  return hsumSse2(
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+__attribute__((target("avx2,fma"))) int dotAvx2(const float* const* queries,
+                                                const float* const* rows,
+                                                int dims, float* out) {
+  __m256 a00 = _mm256_setzero_ps(), a01 = a00, a02 = a00, a03 = a00;
+  __m256 a10 = a00, a11 = a00, a12 = a00, a13 = a00;
+  int n = dims / 8 * 8;
+  for (int i = 0; i < n; i += 8) {
+    __m256 x0 = _mm256_loadu_ps(rows[0] + i);
+    __m256 x1 = _mm256_loadu_ps(rows[1] + i);
+    __m256 q = _mm256_loadu_ps(queries[0] + i);
+    a00 = _mm256_fmadd_ps(q, x0, a00);
+    a10 = _mm256_fmadd_ps(q, x1, a10);
+    q = _mm256_loadu_ps(queries[1] + i);
+    a01 = _mm256_fmadd_ps(q, x0, a01);
+    a11 = _mm256_fmadd_ps(q, x1, a11);
+    q = _mm256_loadu_ps(queries[2] + i);
+    a02 = _mm256_fmadd_ps(q, x0, a02);
+    a12 = _mm256_fmadd_ps(q, x1, a12);
+    q = _mm256_loadu_ps(queries[3] + i);
+    a03 = _mm256_fmadd_ps(q, x0, a03);
+    a13 = _mm256_fmadd_ps(q, x1, a13);
+  }
+  out[0] = hsumAvx2(a00);
+  out[1] = hsumAvx2(a01);
+  out[2] = hsumAvx2(a02);
+  out[3] = hsumAvx2(a03);
+  out[4] = hsumAvx2(a10);
+  out[5] = hsumAvx2(a11);
+  out[6] = hsumAvx2(a12);
+  out[7] = hsumAvx2(a13);
+  return n;
+}
+
+#elif STREAM_FAISS_NEON
+
+int dotNeon(const float* const* queries, const float* const* rows, int dims,
+            float* out) {
+  float32x4_t a00 = vdupq_n_f32(0.f), a01 = a00, a02 = a00, a03 = a00;
+  float32x4_t a10 = a00, a11 = a00, a12 = a00, a13 = a00;
+  int n = dims / 4 * 4;
+  for (int i = 0; i < n; i += 4) {
+    float32x4_t x0 = vld1q_f32(rows[0] + i);
+    float32x4_t x1 = vld1q_f32(rows[1] + i);
+    float32x4_t q = vld1q_f32(queries[0] + i);
+    a00 = vfmaq_f32(a00, q, x0);
+    a10 = vfmaq_f32(a10, q, x1);
+    q = vld1q_f32(queries[1] + i);
+    a01 = vfmaq_f32(a01, q, x0);
+    a11 = vfmaq_f32(a11, q, x1);
+    q = vld1q_f32(queries[2] + i);
+    a02 = vfmaq_f32(a02, q, x0);
+    a12 = vfmaq_f32(a12, q, x1);
+    q = vld1q_f32(queries[3] + i);
+    a03 = vfmaq_f32(a03, q, x0);
+    a13 = vfmaq_f32(a13, q, x1);
+  }
+  out[0] = vaddvq_f32(a00);
+  out[1] = vaddvq_f32(a01);
+  out[2] = vaddvq_f32(a02);
+  out[3] = vaddvq_f32(a03);
+  out[4] = vaddvq_f32(a10);
+  out[5] = vaddvq_f32(a11);
+  out[6] = vaddvq_f32(a12);
+  out[7] = vaddvq_f32(a13);
+  return n;
+}
+
+#endif
+
+struct InnerProductKernels {
+  const char* name;
+  DotKernel dot;
+};
+
+using Kernels = InnerProductKernels;
+
+Kernels selectKernels() {
+#if STREAM_FAISS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return {"avx2", dotAvx2};
+  return {"sse2", dotSse2};
+#elif STREAM_FAISS_NEON
+  return {"neon", dotNeon};
+#endif
+  return {"scalar", dotNone};
+}
+
+const Kernels& getKernels() {
+  static const Kernels kernels = selectKernels();
+  return kernels;
+}
+
+/**
+ * @brief 保留相似度最大的k个结果的小顶堆
+ */
+class TopK {
+ public:
+  void reset(int k) {
+    mK = static_cast<std::size_t>(k);
+    mHeap.clear();
+  }
+
+  void push(float score, int id) {
+    if (mHeap.size() < mK) {
+      mHeap.emplace_back(score, id);
+      std::push_heap(mHeap.begin(), mHeap.end(), Greater());
+    } else if (mK > 0 && score > mHeap.front().first) {
+      std::pop_heap(mHeap.begin(), mHeap.end(), Greater());
+      mHeap.back() = {score, id};
+      std::push_heap(mHeap.begin(), mHeap.end(), Greater());
+    }
+  }
+
+  /**
+   * @brief 按相似度降序写出，不足k个的位置id为-1
+   */
+  void write(float* scores, int* ids) {
+    std::sort_heap(mHeap.begin(), mHeap.end(), Greater());
+    std::size_t i = 0;
+    for (; i < mHeap.size(); ++i) {
+      scores[i] = mHeap[i].first;
+      ids[i] = mHeap[i].second;
+    }
+    for (; i < mK; ++i) {
+      scores[i] = -std::numeric_limits<float>::infinity();
+      ids[i] = -1;
+    }
+  }
+
+ private:
+  using Entry = std::pair<float, int>;
+  struct Greater {
+    bool operator()(const Entry& a, const Entry& b) const {
+      return a.first > b.first;
+    }
+  };
+
+  std::size_t mK = 0;
+  std::vector<Entry> mHeap;
+};
+
+/**
+ * @brief 计算nq个查询向量与nrows行的内积，结果送入对应的堆
+ */
+void scanRows(const Kernels& kernels, const float* const* queries,
+              TopK* const* heaps, int nq, const float* rows, const int* ids,
+              std::size_t nrows, int dims) {
+  std::size_t tile = std::max<std::size_t>(
+      16, ROW_TILE_BYTES / (static_cast<std::size_t>(dims) * sizeof(float)));
+  for (std::size_t t = 0; t < nrows; t += tile) {
+    std::size_t tileEnd = std::min(nrows, t + tile);
+    for (int b = 0; b < nq; b += QUERY_BLOCK) {
+      int bn = std::min(QUERY_BLOCK, nq - b);
+      // 不足一组时重复最后一个查询向量，多出的结果丢弃
+      const float* q[QUERY_BLOCK];
+      for (int j = 0; j < QUERY_BLOCK; ++j)
+        q[j] = queries[b + std::min(j, bn - 1)];
+      for (std::size_t r = t; r < tileEnd; r += ROW_BLOCK) {
+        // 最后剩一行时重复该行，多出的结果丢弃
+        int rn =
+            static_cast<int>(std::min<std::size_t>(ROW_BLOCK, tileEnd - r));
+        const float* x[ROW_BLOCK];
+        for (int k = 0; k < ROW_BLOCK; ++k)
+          x[k] = rows + (r + std::min(k, rn - 1)) * dims;
+        float out[ROW_BLOCK * QUERY_BLOCK];
+        int i = kernels.dot(q, x, dims, out);
+        for (; i < dims; ++i)
+          for (int k = 0; k < rn; ++k)
+            for (int j = 0; j < bn; ++j)
+              out[k * QUERY_BLOCK + j] += q[j][i] * x[k][i];
+        for (int k = 0; k < rn; ++k)
+          for (int j = 0; j < bn; ++j)
+            heaps[b + j]->push(out[k * QUERY_BLOCK + j], ids[r + k]);
+      }
+    }
+  }
+}
+
+void normalize(float* v, int dims) {
+  double norm = 0;
+  for (int i = 0; i < dims; ++i) norm += static_cast<double>(v[i]) * v[i];
+  if (norm <= 0) return;
+  float scale = static_cast<float>(1.0 / std::sqrt(norm));
+  for (int i = 0; i < dims; ++i) v[i] *= scale;
+}
+
+}  // namespace
+
+const char* getInnerProductKernelName() { return getKernels().name; }
+
+FlatIndex::FlatIndex(int dims) : FaceIndex(dims) {}
+
+void FlatIndex::add(const int* ids, const float* vectors, int num) {
+  for (int i = 0; i < num; ++i) {
+    const float* v = vectors + static_cast<std::size_t>(i) * mDims;
+    auto it = mRows.find(ids[i]);
+    if (it != mRows.end()) {
+      // 已存在的id覆盖原来的向量
+      std::copy(v, v + mDims, mVectors.begin() + it->second * mDims);
+      continue;
+    }
+    mRows.emplace(ids[i], mIds.size());
+    mIds.push_back(ids[i]);
+    mVectors.insert(mVectors.end(), v, v + mDims);
+  }
+}
+
+int FlatIndex::remove(const int* ids, int num) {
+  int removed = 0;
+  for (int i = 0; i < num; ++i) {
+    auto it = mRows.find(ids[i]);
+    if (it == mRows.end()) continue;
+    std::size_t row = it->second;
+    std::size_t last = mIds.size() - 1;
+    mRows.erase(it);
+    if (row != last) {
+      mIds[row] = mIds[last];
+      std::copy(mVectors.begin() + last * mDims,
+                mVectors.begin() + (last + 1) * mDims,
+                mVectors.begin() + row * mDims);
+      mRows[mIds[row]] = row;
+    }
+    mIds.pop_back();
+    mVectors.resize(last * mDims);
+    ++removed;
+  }
+  return removed;
+}
+
+void FlatIndex::search(const float* queries, int num, int k, float* scores,
+                       int* ids) const {
+  std::vector<TopK> heaps(num);
+  std::vector<TopK*> heapPtrs(num);
+  std::vector<const float*> queryPtrs(num);
+  for (int i = 0; i < num; ++i) {
+    heaps[i].reset(k);
+    heapPtrs[i] = &heaps[i];
+    queryPtrs[i] = queries + static_cast<std::size_t>(i) * mDims;
+  }
+  if (num > 0)
+    scanRows(getKernels(), queryPtrs.data(), heapPtrs.data(), num,
+             mVectors.data(), mIds.data(), mIds.size(), mDims);
+  for (int i = 0; i < num; ++i)
+    heaps[i].write(scores + static_cast<std::size_t>(i) * k,
+                   ids + static_cast<std::size_t>(i) * k);
+}
+
+void FlatIndex::exportTo(std::vector<int>& ids,
+                         std::vector<float>& vectors) const {
+  ids = mIds;
+  vectors = mVectors;
+}
+
+IvfIndex::IvfIndex(int dims, const IvfIndexConfig& config)
+    : FaceIndex(dims),
+      mConfig(config),
+      mCentroids(dims, 0.f),
+      mLists(1) {}
+
+int IvfIndex::chooseListNumber(std::size_t num) const {
+  std::size_t want = mConfig.nlist > 0
+                         ? static_cast<std::size_t>(mConfig.nlist)
+                         : static_cast<std::size_t>(
+                               std::lround(std::sqrt(static_cast<double>(num))));
+  want = std::min(want, num / MIN_POINTS_PER_LIST);
+  return static_cast<int>(std::max<std::size_t>(want, 1));
+}
+
+void IvfIndex::train(const float* vectors, std::size_t num) {
+  int nlist = chooseListNumber(num);
+  mCentroids.assign(static_cast<std::size_t>(nlist) * mDims, 0.f);
+  mLists.assign(nlist, List());
+  mTrainedSize = num;
+  if (nlist == 1) return;
+
+  // 等间隔取样本，初始中心取样本中等间隔的nlist个点
+  std::size_t sampleNum = std::min<std::size_t>(
+      num, static_cast<std::size_t>(nlist) * TRAIN_POINTS_PER_LIST);
+  std::vector<const float*> samples(sampleNum);
+  for (std::size_t i = 0; i < sampleNum; ++i)
+    samples[i] = vectors + (i * num / sampleNum) * mDims;
+  for (int c = 0; c < nlist; ++c)
+    std::copy(samples[c * sampleNum / nlist],
+              samples[c * sampleNum / nlist] + mDims,
+              mCentroids.begin() + static_cast<std::size_t>(c) * mDims);
+
+  std::vector<int> centroidIds(nlist);
+  for (int c = 0; c < nlist; ++c) centroidIds[c] = c;
+  std::vector<TopK> heaps(sampleNum);
+  std::vector<TopK*> heapPtrs(sampleNum);
+  for (std::size_t i = 0; i < sampleNum; ++i) heapPtrs[i] = &heaps[i];
+  std::vector<double> sums(static_cast<std::size_t>(nlist) * mDims);
+  std::vector<std::size_t> counts(nlist);
+  const Kernels& kernels = getKernels();
+
+  for (int iter = 0; iter < TRAIN_ITERATIONS; ++iter) {
+    for (auto& heap : heaps) heap.reset(1);
+    scanRows(kernels, samples.data(), heapPtrs.data(),
+             static_cast<int>(sampleNum), mCentroids.data(),
+             centroidIds.data(), nlist, mDims);
+    std::fill(sums.begin(), sums.end(), 0.0);
+    std::fill(counts.begin(), counts.end(), 0);
+    for (std::size_t i = 0; i < sampleNum; ++i) {
+      float score;
+      int c;
+      heaps[i].write(&score, &c);
+      ++counts[c];
+      double* sum = sums.data() + static_cast<std::size_t>(c) * mDims;
+      for (int d = 0; d < mDims; ++d) sum[d] += samples[i][d];
+    }
+    // 球面k-means：中心为归一化的均值，空的聚类重新取一个样本点
+    for (int c = 0; c < nlist; ++c) {
+      float* centroid = mCentroids.data() + static_cast<std::size_t>(c) * mDims;
+      if (counts[c] == 0) {
+        const float* s = samples[(c * 7919 + iter * 104729) % sampleNum];
+        std::copy(s, s + mDims, centroid);
+      } else {
+        const double* sum = sums.data() + static_cast<std::size_t>(c) * mDims;
+        for (int d = 0; d < mDims; ++d)
+          centroid[d] = static_cast<float>(sum[d] / counts[c]);
+      }
+      normalize(centroid, mDims);
+    }
+  }
+}
+
+void IvfIndex::assign(const int* ids, const float* vectors, int num) {
+  int nlist = static_cast<int>(mLists.size());
+  std::vector<int> centroidIds(nlist);
+  for (int c = 0; c < nlist; ++c) centroidIds[c] = c;
+  // 分块求每个向量最近的中心，块内的向量与中心成组计算内积
+  constexpr int ASSIGN_BLOCK = 256;
+  std::vector<TopK> heaps(std::min(num, ASSIGN_BLOCK));
+  std::vector<TopK*> heapPtrs(heaps.size());
+  std::vector<const float*> vectorPtrs(heaps.size());
+  for (std::size_t i = 0; i < heaps.size(); ++i) heapPtrs[i] = &heaps[i];
+  for (int begin = 0; begin < num; begin += ASSIGN_BLOCK) {
+    int n = std::min(ASSIGN_BLOCK, num - begin);
+    for (int i = 0; i < n; ++i) {
+      heaps[i].reset(1);
+      vectorPtrs[i] =
+          vectors + static_cast<std::size_t>(begin + i) * mDims;
+    }
+    if (nlist > 1)
+      scanRows(getKernels(), vectorPtrs.data(), heapPtrs.data(), n,
+               mCentroids.data(), centroidIds.data(), nlist, mDims);
+    for (int i = 0; i < n; ++i) {
+      int c = 0;
+      if (nlist > 1) {
+        float score;
+        heaps[i].write(&score, &c);
+      }
+      List& list = mLists[c];
+      mRows[ids[begin + i]] = {c, list.ids.size()};
+      list.ids.push_back(ids[begin + i]);
+      list.vectors.insert(list.vectors.end(), vectorPtrs[i],
+                          vectorPtrs[i] + mDims);
+    }
+  }
+}
+
+void IvfIndex::build(const int* ids, const float* vectors, int num) {
+  mRows.clear();
+  train(vectors, num);
+  assign(ids, vectors, num);
+}
+
+void IvfIndex::add(const int* ids, const float* vectors, int num) {
+  // 已存在的id先删除，再按新的向量分配列表
+  remove(ids, num);
+  std::size_t total = mRows.size() + num;
+  if (chooseListNumber(total) > static_cast<int>(mLists.size()) &&
+      total >= 2 * mTrainedSize) {
+    std::vector<int> allIds;
+    std::vector<float> allVectors;
+    exportTo(allIds, allVectors);
+    allIds.insert(allIds.end(), ids, ids + num);
+    allVectors.insert(allVectors.end(), vectors,
+                      vectors + static_cast<std::size_t>(num) * mDims);
+    build(allIds.data(), allVectors.data(), static_cast<int>(allIds.size()));
+    return;
+  }
+  assign(ids, vectors, num);
+}
+
+int IvfIndex::remove(const int* ids, int num) {
+  int removed = 0;
+  for (int i = 0; i < num; ++i) {
+    auto it = mRows.find(ids[i]);
+    if (it == mRows.end()) continue;
+    List& list = mLists[it->second.first];
+    std::size_t row = it->second.second;
+    std::size_t last = list.ids.size() - 1;
+    mRows.erase(it);
+    if (row != last) {
+      list.ids[row] = list.ids[last];
+      std::copy(list.vectors.begin() + last * mDims,
+                list.vectors.begin() + (last + 1) * mDims,
+                list.vectors.begin() + row * mDims);
+      mRows[list.ids[row]].second = row;
+    }
+    list.ids.pop_back();
+    list.vectors.resize(last * mDims);
+    ++removed;
+  }
+  return removed;
+}
+
+void IvfIndex::search(const float* queries, int num, int k, float* scores,
+                      int* ids) const {
+  if (num <= 0) return;
+  const Kernels& kernels = getKernels();
+  int nlist = static_cast<int>(mLists.size());
+  int nprobe = std::max(1, std::min(mConfig.nprobe, nlist));
+
+  std::vector<TopK> heaps(num);
+  std::vector<TopK*> heapPtrs(num);
+  std::vector<const float*> queryPtrs(num);
+  for (int i = 0; i < num; ++i) {
+    heaps[i].reset(nprobe);
+    heapPtrs[i] = &heaps[i];
+    queryPtrs[i] = queries + static_cast<std::size_t>(i) * mDims;
+  }
+
+  // 先为每个查询选出nprobe个列表，再按列表把查询分组
+  std::vector<std::vector<int>> listQueries(nlist);
+  if (nlist > 1) {
+    std::vector<int> centroidIds(nlist);
+    for (int c = 0; c < nlist; ++c) centroidIds[c] = c;
+    scanRows(kernels, queryPtrs.data(), heapPtrs.data(), num,
+             mCentroids.data(), centroidIds.data(), nlist, mDims);
+    std::vector<float> probeScores(nprobe);
+    std::vector<int> probeLists(nprobe);
+    for (int i = 0; i < num; ++i) {
+      heaps[i].write(probeScores.data(), probeLists.data());
+      for (int p = 0; p < nprobe; ++p) listQueries[probeLists[p]].push_back(i);
+    }
+  } else {
+    for (int i = 0; i < num; ++i) listQueries[0].push_back(i);
+  }
+
+  for (int i = 0; i < num; ++i) heaps[i].reset(k);
+  std::vector<const float*> groupQueries;
+  std::vector<TopK*> groupHeaps;
+  for (int c = 0; c < nlist; ++c) {
+    const List& list = mLists[c];
+    if (listQueries[c].empty() || list.ids.empty()) continue;
+    groupQueries.clear();
+    groupHeaps.clear();
+    for (int q : listQueries[c]) {
+      groupQueries.push_back(queryPtrs[q]);
+      groupHeaps.push_back(heapPtrs[q]);
+    }
+    scanRows(kernels, groupQueries.data(), groupHeaps.data(),
+             static_cast<int>(groupQueries.size()), list.vectors.data(),
+             list.ids.data(), list.ids.size(), mDims);
+  }
+  for (int i = 0; i < num; ++i)
+    heaps[i].write(scores + static_cast<std::size_t>(i) * k,
+                   ids + static_cast<std::size_t>(i) * k);
+}
+
+void IvfIndex::exportTo(std::vector<int>& ids,
+                        std::vector<float>& vectors) const {
+  ids.clear();
+  vectors.clear();
+  ids.reserve(mRows.size());
+  vectors.reserve(mRows.size() * mDims);
+  for (const auto& list : mLists) {
+    ids.insert(ids.end(), list.ids.begin(), list.ids.end());
+    vectors.insert(vectors.end(), list.vectors.begin(), list.vectors.end());
+  }
+}
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
@@ -8,29 +8,53 @@
 //===----------------------------------------------------------------------===//
 #include "faiss.h"
 
-#if BMCV_VERSION_MAJOR <= 1
-
-#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <nlohmann/json.hpp>
-#include <sstream>
 #include <string>
+#include <unordered_set>
 
+#include "common/common_defs.h"
+#include "common/http_defs.h"
 #include "common/logger.h"
 #include "element_factory.h"
+#include "face_gallery.h"
+#include "tpu_flat_index.h"
 
 namespace sophon_stream {
 namespace element {
 namespace faiss {
 Faiss::Faiss() {}
-Faiss::~Faiss() {
-  delete[] db_data;
-  delete[] output_dis;
-  delete[] output_inx;
-  bm_free_device(handle, query_data_dev_mem);
-  bm_free_device(handle, db_data_dev_mem);
-  bm_free_device(handle, buffer_dev_mem);
-  bm_free_device(handle, sorted_similarity_dev_mem);
-  bm_free_device(handle, sorted_index_dev_mem);
+Faiss::~Faiss() {}
+
+common::ErrorCode Faiss::createIndex(const std::string& backend, int dims,
+                                     const IvfIndexConfig& ivfConfig) {
+  if (backend == BACKEND_CPU_FLAT) {
+    mIndex.reset(new FlatIndex(dims));
+  } else if (backend == BACKEND_CPU_IVF) {
+    mIndex.reset(new IvfIndex(dims, ivfConfig));
+  } else if (backend == BACKEND_TPU) {
+#if BMCV_VERSION_MAJOR <= 1
+    auto index = std::make_unique<TpuFlatIndex>(getDeviceId(), dims,
+                                                 mMaxBatch, mTopK);
+    if (!index->init()) {
+      IVS_ERROR("Faiss element id: {0:d} can not init tpu index on device "
+                "{1:d}",
+                getId(), getDeviceId());
+      return common::ErrorCode::UNKNOWN;
+    }
+    mIndex = std::move(index);
+#else
+    IVS_ERROR("Faiss backend tpu needs bmcv_faiss_indexflatIP, use {0} or {1}",
+              BACKEND_CPU_FLAT, BACKEND_CPU_IVF);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+#endif
+  } else {
+    IVS_ERROR("Unknown faiss backend: {0}", backend);
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  }
+  return common::ErrorCode::SUCCESS;
 }
 
 common::ErrorCode Faiss::initInternal(const std::string& json) {
@@ -42,97 +66,155 @@ common::ErrorCode Faiss::initInternal(const std::string& json) {
       break;
     }
 
-    auto db_data_path =
-        configure.find(CONFIG_INTERNAL_DB_DATA_PATH_FILED)->get<std::string>();
-
-    std::vector<float> db_vec(0);
-    std::ifstream db_data_file;
-    db_data_file.open(db_data_path);
-    assert(db_data_file.is_open());
-    // 读取文件数据到数组
-    if (db_data_file) {
-      std::string line;
-      int row_count = 0;
-      while (std::getline(db_data_file, line)) {
-        std::vector<float> row;
-        std::stringstream ss(line);
-        float val;
-        int col_count = 0;
-        while (ss >> val) {
-          db_vec.push_back(val);
-          col_count++;
-        }
-        if (row_count == 0) {
-          vec_dims = col_count;
-        }
-        row_count++;
-      }
-      db_vecs_num = row_count;
-    }
-    db_data_file.close();
-
-    auto label_path =
-        configure.find(CONFIG_INTERNAL_LABEL_PATH_FILED)->get<std::string>();
-    std::ifstream istream;
-    istream.open(label_path);
-    assert(istream.is_open());
-    std::string line;
-    while (std::getline(istream, line)) {
-      line = line.substr(0, line.length());
-      mClassNames.push_back(line);
-    }
-    istream.close();
-
-    db_data = new float[db_vecs_num * vec_dims];
-    output_dis = new float[query_vecs_num * sort_cnt];
-    output_inx = new int[query_vecs_num * sort_cnt];
-    std::memcpy(db_data, db_vec.data(), db_vec.size() * sizeof(float));
-
-    bm_dev_request(&handle, 0);
-    bm_malloc_device_byte(handle, &buffer_dev_mem,
-                          query_vecs_num * db_vecs_num * sizeof(float));
-    bm_malloc_device_byte(handle, &sorted_similarity_dev_mem,
-                          query_vecs_num * sort_cnt * sizeof(float));
-    bm_malloc_device_byte(handle, &sorted_index_dev_mem,
-                          query_vecs_num * sort_cnt * sizeof(int));
-    bm_malloc_device_byte(handle, &query_data_dev_mem,
-                          query_vecs_num * vec_dims * sizeof(float));
-    bm_malloc_device_byte(handle, &db_data_dev_mem,
-                          db_vecs_num * vec_dims * sizeof(float));
-    bm_memcpy_s2d(handle, db_data_dev_mem, db_data);
+#if BMCV_VERSION_MAJOR <= 1
+    std::string backend =
+        configure.value(CONFIG_INTERNAL_BACKEND_FILED, BACKEND_TPU);
+#else
+    std::string backend =
+        configure.value(CONFIG_INTERNAL_BACKEND_FILED, BACKEND_CPU_FLAT);
+#endif
+    mMaxBatch = configure.value(CONFIG_INTERNAL_MAX_BATCH_FILED, mMaxBatch);
+    STREAM_CHECK(mMaxBatch > 0, "max_batch must be positive, please check "
+                                "your Faiss element configuration file");
+    mTopK = configure.value(CONFIG_INTERNAL_TOP_K_FILED, mTopK);
+    STREAM_CHECK(mTopK > 0, "top_k must be positive, please check your Faiss "
+                            "element configuration file");
+    mScoreThreshold = configure.value(CONFIG_INTERNAL_SCORE_THRESHOLD_FILED,
+                                      mScoreThreshold);
+    mUnknownLabel =
+        configure.value(CONFIG_INTERNAL_UNKNOWN_LABEL_FILED, mUnknownLabel);
+    TrackResultCacheConfig cacheConfig;
+    cacheConfig.maxFrames = configure.value(
+        CONFIG_INTERNAL_TRACK_CACHE_FRAMES_FILED, cacheConfig.maxFrames);
+    cacheConfig.minSimilarity =
+        configure.value(CONFIG_INTERNAL_TRACK_CACHE_SIMILARITY_FILED,
+                        cacheConfig.minSimilarity);
+    IvfIndexConfig ivfConfig;
+    ivfConfig.nlist = configure.value(CONFIG_INTERNAL_NLIST_FILED, 0);
+    ivfConfig.nprobe = configure.value(CONFIG_INTERNAL_NPROBE_FILED, 8);
+
+    // 不配置db_path时从空底库开始，通过http接口添加
+    FaceGallery gallery;
+    int dims = configure.value(CONFIG_INTERNAL_DIMS_FILED, 512);
+    auto dbIt = configure.find(CONFIG_INTERNAL_DB_DATA_PATH_FILED);
+    if (dbIt != configure.end()) {
+      std::string dbPath = dbIt->get<std::string>();
+      errorCode = gallery.load(
+          dbPath, configure.value(CONFIG_INTERNAL_LABEL_PATH_FILED, ""));
+      if (errorCode != common::ErrorCode::SUCCESS) break;
+      if (gallery.getCount() > 0) dims = gallery.getDims();
+      if (gallery.isMapped()) mSavePath = dbPath;
+    }
+    mSavePath = configure.value(CONFIG_INTERNAL_SAVE_PATH_FILED, mSavePath);
+
+    errorCode = createIndex(backend, dims, ivfConfig);
+    if (errorCode != common::ErrorCode::SUCCESS) break;
+    const auto& ids = gallery.getIds();
+    mIndex->build(ids.data(), gallery.getVectors(),
+                  static_cast<int>(ids.size()));
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      if (ids[i] >= static_cast<int>(mLabels.size()))
+        mLabels.resize(ids[i] + 1);
+      mLabels[ids[i]] = gallery.getLabels()[i];
+    }
+    mNextId = static_cast<int>(mLabels.size());
+    gallery.releaseVectors();
+    mTrackCache = std::make_unique<TrackResultCache>(cacheConfig, dims, mTopK);
 
+    IVS_INFO(
+        "Faiss element id: {0:d} backend: {1}, inner product kernel: {2}, "
+        "faces: {3:d}, dims: {4:d}, top_k: {5:d}, track_cache_frames: {6:d}",
+        getId(), mIndex->getName(), getInnerProductKernelName(),
+        static_cast<int>(mIndex->size()), dims, mTopK, cacheConfig.maxFrames);
   } while (false);
   return errorCode;
 }
 
-void Faiss::getFaceId(
-    std::shared_ptr<common::RecognizedObjectMetadata> resnetObj) {
-  if (resnetObj != nullptr) {
-    // float *input_data = new float[query_vecs_num * vec_dims];
-    float* input_data = resnetObj->feature_vector.get();
-    for (int i = 0; i < 10; i++) {
-      std::cout << input_data[i] << " ";
-    }
-    // 将 input_data 的值赋给 feature_vector
-    // bm_handle_t handle=obj->mFrame->mHandle;
-   {
-    std::lock_guard<std::mutex> lock(mutex);
-    bm_memcpy_s2d(handle, query_data_dev_mem, input_data);
-    bmcv_faiss_indexflatIP(handle, query_data_dev_mem, db_data_dev_mem,
-                           buffer_dev_mem, sorted_similarity_dev_mem,
-                           sorted_index_dev_mem, vec_dims, query_vecs_num,
-                           db_vecs_num, sort_cnt, is_transpose, input_dtype,
-                           output_dtype);
-
-    bm_memcpy_d2s(handle, output_dis, sorted_similarity_dev_mem);
-    bm_memcpy_d2s(handle, output_inx, sorted_index_dev_mem);
-   }
-    int label_index = output_inx[0];
-    resnetObj->mLabelName = mClassNames[label_index];
-    resnetObj->mTopKLabels.push_back(output_inx[0]);
+void Faiss::searchFaces(
+    const std::vector<std::shared_ptr<common::ObjectMetadata>>&
+        objectMetadatas) {
+  struct Face {
+    std::shared_ptr<common::RecognizedObjectMetadata> recog;
+    int channelId;
+    long long frameId;
+    long long trackId;
+  };
+  std::vector<Face> faces;
+  for (const auto& objectMetadata : objectMetadatas) {
+    // 分发后的子对象只有一个人脸，带有跟踪结果时按跟踪id缓存
+    long long trackId = -1;
+    if (objectMetadata->mTrackedObjectMetadatas.size() == 1 &&
+        objectMetadata->mRecognizedObjectMetadatas.size() == 1)
+      trackId = objectMetadata->mTrackedObjectMetadatas[0]->mTrackId;
+    for (const auto& resnetObj : objectMetadata->mRecognizedObjectMetadatas) {
+      if (resnetObj != nullptr && resnetObj->feature_vector != nullptr)
+        faces.push_back({resnetObj, objectMetadata->mFrame->mChannelIdInternal,
+                         objectMetadata->mFrame->mFrameId, trackId});
+    }
+  }
+  if (faces.empty()) return;
+
+  int dims = mIndex->getDims();
+  int num = static_cast<int>(faces.size());
+  std::vector<float> scores(static_cast<std::size_t>(num) * mTopK);
+  std::vector<int> ids(static_cast<std::size_t>(num) * mTopK);
+
+  std::shared_lock<std::shared_mutex> lock(mIndexMutex);
+  std::vector<int> misses;
+  for (int i = 0; i < num; ++i) {
+    std::size_t offset = static_cast<std::size_t>(i) * mTopK;
+    if (!mTrackCache->lookup(faces[i].channelId, faces[i].trackId,
+                             faces[i].frameId,
+                             faces[i].recog->feature_vector.get(),
+                             mGalleryVersion, ids.data() + offset,
+                             scores.data() + offset))
+      misses.push_back(i);
+  }
+
+  if (!misses.empty()) {
+    int missNum = static_cast<int>(misses.size());
+    std::vector<float> queries(static_cast<std::size_t>(missNum) * dims);
+    for (int i = 0; i < missNum; ++i)
+      std::memcpy(queries.data() + static_cast<std::size_t>(i) * dims,
+                  faces[misses[i]].recog->feature_vector.get(),
+                  dims * sizeof(float));
+    std::vector<float> missScores(static_cast<std::size_t>(missNum) * mTopK);
+    std::vector<int> missIds(static_cast<std::size_t>(missNum) * mTopK);
+    mIndex->search(queries.data(), missNum, mTopK, missScores.data(),
+                   missIds.data());
+    for (int i = 0; i < missNum; ++i) {
+      const Face& face = faces[misses[i]];
+      std::size_t from = static_cast<std::size_t>(i) * mTopK;
+      std::size_t to = static_cast<std::size_t>(misses[i]) * mTopK;
+      std::copy_n(missIds.data() + from, mTopK, ids.data() + to);
+      std::copy_n(missScores.data() + from, mTopK, scores.data() + to);
+      mTrackCache->update(face.channelId, face.trackId, face.frameId,
+                          face.recog->feature_vector.get(), mGalleryVersion,
+                          missIds.data() + from, missScores.data() + from);
+    }
+  }
+  IVS_DEBUG("Faiss element id: {0:d} faces: {1:d}, searched: {2:d}", getId(),
+            num, static_cast<int>(misses.size()));
+
+  for (int i = 0; i < num; ++i) {
+    std::size_t offset = static_cast<std::size_t>(i) * mTopK;
+    fillResult(*faces[i].recog, ids.data() + offset, scores.data() + offset);
   }
 }
 
+void Faiss::fillResult(common::RecognizedObjectMetadata& face, const int* ids,
+                       const float* scores) const {
+  for (int j = 0; j < mTopK; ++j) {
+    // 结果按相似度降序，第一个低于阈值的之后都不需要
+    if (ids[j] < 0 || scores[j] < mScoreThreshold) break;
+    face.mTopKLabels.push_back(ids[j]);
+    face.mScores.push_back(scores[j]);
+    face.mTopKLabelNames.push_back(mLabels[ids[j]]);
+  }
+  face.mLabelName =
+      face.mTopKLabelNames.empty() ? mUnknownLabel : face.mTopKLabelNames[0];
+}
+
 common::ErrorCode Faiss::doWork(int dataPipeId) {
   common::ErrorCode errorCode = common::ErrorCode::SUCCESS;
 
@@ -141,44 +223,234 @@ common::ErrorCode Faiss::doWork(int dataPipeId) {
   int outputPort = 0;
   if (!getSinkElementFlag()) {
     std::vector<int> outputPorts = getOutputPorts();
-    int outputPort = outputPorts[0];
+    outputPort = outputPorts[0];
   }
 
-  auto data = popInputData(inputPort, dataPipeId);
-  while (!data && (getThreadStatus() == ThreadStatus::RUN)) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    data = popInputData(inputPort, dataPipeId);
+  auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+  while (!data && shouldWaitInputData()) {
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
   }
   if (data == nullptr) return common::ErrorCode::SUCCESS;
 
-  auto objectMetadata = std::static_pointer_cast<common::ObjectMetadata>(data);
-  int subId = 0;
-  // 从resnet取出一个objectMetadata
-  // 从data里面取人脸，对一个个人脸做处理，首先需要取出
-  for (auto resnetObj : objectMetadata->mRecognizedObjectMetadatas) {
-    // mRecognizedObjectMetadatas是一个数组，每个数组包含人脸的框、特征等等,需要做的只是提取特征，填充label
-    Faiss::getFaceId(resnetObj);
+  // 已经到达的帧合并为一次检索，人脸数达到max_batch后不再继续取
+  std::vector<std::shared_ptr<common::ObjectMetadata>> objectMetadatas;
+  int faceNum = 0;
+  while (data != nullptr) {
+    auto objectMetadata =
+        std::static_pointer_cast<common::ObjectMetadata>(data);
+    faceNum += objectMetadata->mRecognizedObjectMetadatas.size();
+    objectMetadatas.push_back(objectMetadata);
+    if (faceNum >= mMaxBatch) break;
+    data = popInputData(inputPort, dataPipeId);
   }
+  searchFaces(objectMetadatas);
 
-  int channel_id_internal = objectMetadata->mFrame->mChannelIdInternal;
-  int outDataPipeId =
-      getSinkElementFlag()
-          ? 0
-          : (channel_id_internal % getOutputConnectorCapacity(outputPort));
-  errorCode = pushOutputData(outputPort, outDataPipeId,
-                             std::static_pointer_cast<void>(objectMetadata));
-  if (common::ErrorCode::SUCCESS != errorCode) {
-    IVS_WARN(
-        "Send data fail, element id: {0:d}, output port: {1:d}, data: "
-        "{2:p}",
-        getId(), outputPort, static_cast<void*>(objectMetadata.get()));
+  for (auto& objectMetadata : objectMetadatas) {
+    int channel_id_internal = objectMetadata->mFrame->mChannelIdInternal;
+    int outDataPipeId =
+        getSinkElementFlag()
+            ? 0
+            : (channel_id_internal % getOutputConnectorCapacity(outputPort));
+    errorCode = pushOutputData(outputPort, outDataPipeId,
+                               std::static_pointer_cast<void>(objectMetadata));
+    if (common::ErrorCode::SUCCESS != errorCode) {
+      IVS_WARN(
+          "Send data fail, element id: {0:d}, output port: {1:d}, data: "
+          "{2:p}",
+          getId(), outputPort, static_cast<void*>(objectMetadata.get()));
+    }
   }
   return errorCode;
 }
 
+void Faiss::registListenFunc(
+    sophon_stream::framework::ListenThread* listener) {
+  std::string id = "/" + std::to_string(getId());
+  listener->setHandler((postNameAddFaces + id).c_str(),
+                       sophon_stream::framework::RequestType::POST,
+                       std::bind(&Faiss::listenerAddFaces, this,
+                                 std::placeholders::_1, std::placeholders::_2));
+  listener->setHandler((postNameRemoveFaces + id).c_str(),
+                       sophon_stream::framework::RequestType::POST,
+                       std::bind(&Faiss::listenerRemoveFaces, this,
+                                 std::placeholders::_1, std::placeholders::_2));
+  listener->setHandler((postNameSaveGallery + id).c_str(),
+                       sophon_stream::framework::RequestType::POST,
+                       std::bind(&Faiss::listenerSaveGallery, this,
+                                 std::placeholders::_1, std::placeholders::_2));
+}
+
+void Faiss::listenerAddFaces(const httplib::Request& request,
+                             httplib::Response& response) {
+  common::Response resp;
+  resp.code = 0;
+  resp.msg = "success";
+  do {
+    auto body = nlohmann::json::parse(request.body, nullptr, false);
+    auto facesIt = body.is_object() ? body.find("faces") : body.end();
+    if (!body.is_object() || facesIt == body.end() || !facesIt->is_array()) {
+      resp.code = -1;
+      resp.msg = "faces must be array";
+      break;
+    }
+    int dims = mIndex->getDims();
+    std::vector<float> vectors;
+    std::vector<std::string> labels;
+    for (const auto& face : *facesIt) {
+      auto featureIt = face.is_object() ? face.find("feature") : face.end();
+      if (!face.is_object() || featureIt == face.end() ||
+          !featureIt->is_array() ||
+          featureIt->size() != static_cast<std::size_t>(dims) ||
+          !std::all_of(featureIt->begin(), featureIt->end(),
+                       [](const nlohmann::json& value) {
+                         return value.is_number();
+                       })) {
+        resp.code = -1;
+        resp.msg = "feature must be array of " + std::to_string(dims) +
+                   " numbers";
+        break;
+      }
+      for (const auto& value : *featureIt) vectors.push_back(value.get<float>());
+      labels.push_back(face.value("label", ""));
+    }
+    if (resp.code != 0) break;
+
+    int num = static_cast<int>(labels.size());
+    std::vector<int> ids(num);
+    std::unique_lock<std::shared_mutex> lock(mIndexMutex);
+    std::size_t before = mIndex->size();
+    for (int i = 0; i < num; ++i) ids[i] = mNextId++;
+    mIndex->add(ids.data(), vectors.data(), num);
+    if (mIndex->size() != before + num) {
+      resp.code = -1;
+      resp.msg = "add faces to index failed";
+      break;
+    }
+    mLabels.resize(mNextId);
+    ++mGalleryVersion;
+    for (int i = 0; i < num; ++i) {
+      mLabels[ids[i]] = labels[i];
+      resp.results.push_back({0, std::to_string(ids[i])});
+    }
+    IVS_INFO("Faiss element id: {0:d} add {1:d} faces, gallery size: {2:d}",
+             getId(), num, static_cast<int>(mIndex->size()));
+  } while (false);
+  if (resp.code != 0)
+    IVS_WARN("Faiss element id: {0:d} add faces failed, {1}", getId(),
+             resp.msg);
+  nlohmann::json json_res = resp;
+  response.set_content(json_res.dump(), "application/json");
+}
+
+void Faiss::listenerRemoveFaces(const httplib::Request& request,
+                                httplib::Response& response) {
+  common::Response resp;
+  resp.code = 0;
+  resp.msg = "success";
+  do {
+    auto body = nlohmann::json::parse(request.body, nullptr, false);
+    if (!body.is_object()) {
+      resp.code = -1;
+      resp.msg = "request body must be object";
+      break;
+    }
+    std::vector<int> ids;
+    std::unordered_set<std::string> labels;
+    auto idsIt = body.find("ids");
+    if (idsIt != body.end() && idsIt->is_array()) {
+      for (const auto& id : *idsIt) {
+        if (!id.is_number_integer()) {
+          resp.code = -1;
+          resp.msg = "ids must be array of integers";
+          break;
+        }
+        ids.push_back(id.get<int>());
+      }
+    }
+    if (resp.code != 0) break;
+    auto labelsIt = body.find("labels");
+    if (labelsIt != body.end() && labelsIt->is_array()) {
+      for (const auto& label : *labelsIt) {
+        if (!label.is_string()) {
+          resp.code = -1;
+          resp.msg = "labels must be array of strings";
+          break;
+        }
+        labels.insert(label.get<std::string>());
+      }
+    }
+    if (resp.code != 0) break;
+
+    std::unique_lock<std::shared_mutex> lock(mIndexMutex);
+    if (!labels.empty()) {
+      for (int id = 0; id < static_cast<int>(mLabels.size()); ++id)
+        if (labels.count(mLabels[id]) != 0) ids.push_back(id);
+    }
+    for (int id : ids) {
+      if (id < 0 || id >= static_cast<int>(mLabels.size())) continue;
+      if (mIndex->remove(&id, 1) == 0) continue;
+      mLabels[id].clear();
+      resp.results.push_back({0, std::to_string(id)});
+    }
+    if (!resp.results.empty()) ++mGalleryVersion;
+    IVS_INFO("Faiss element id: {0:d} remove {1:d} faces, gallery size: {2:d}",
+             getId(), static_cast<int>(resp.results.size()),
+             static_cast<int>(mIndex->size()));
+  } while (false);
+  if (resp.code != 0)
+    IVS_WARN("Faiss element id: {0:d} remove faces failed, {1}", getId(),
+             resp.msg);
+  nlohmann::json json_res = resp;
+  response.set_content(json_res.dump(), "application/json");
+}
+
+void Faiss::listenerSaveGallery(const httplib::Request& request,
+                                httplib::Response& response) {
+  common::Response resp;
+  resp.code = 0;
+  resp.msg = "success";
+  do {
+    // 只写入配置的save_path，不接受请求中的任意路径
+    const std::string& path = mSavePath;
+    if (path.empty()) {
+      resp.code = -1;
+      resp.msg = "save_path is not configured";
+      break;
+    }
+    auto body = nlohmann::json::parse(request.body, nullptr, false);
+    auto pathIt = body.is_object() ? body.find("path") : body.end();
+    if (body.is_object() && pathIt != body.end() &&
+        !(pathIt->is_string() && pathIt->get<std::string>() == path)) {
+      resp.code = -1;
+      resp.msg = "path must be the configured save_path";
+      break;
+    }
+    std::vector<int> ids;
+    std::vector<float> vectors;
+    std::vector<std::string> labels;
+    {
+      std::shared_lock<std::shared_mutex> lock(mIndexMutex);
+      mIndex->exportTo(ids, vectors);
+      labels.reserve(ids.size());
+      for (int id : ids) labels.push_back(mLabels[id]);
+    }
+    if (FaceGallery::saveBinary(path, mIndex->getDims(), ids, vectors,
+                                labels) != common::ErrorCode::SUCCESS) {
+      resp.code = -1;
+      resp.msg = "write " + path + " failed";
+      break;
+    }
+    IVS_INFO("Faiss element id: {0:d} save {1:d} faces to {2}", getId(),
+             static_cast<int>(ids.size()), path);
+  } while (false);
+  if (resp.code != 0)
+    IVS_WARN("Faiss element id: {0:d} save gallery failed, {1}", getId(),
+             resp.msg);
+  nlohmann::json json_res = resp;
+  response.set_content(json_res.dump(), "application/json");
+}
+
 REGISTER_WORKER("faiss", Faiss)
 }  // namespace faiss
 }  // namespace element
 }  // namespace sophon_stream
-
-#endif
\ No newline at end of file
@@ -0,0 +1,199 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tpu_flat_index.h"
+
+#if BMCV_VERSION_MAJOR <= 1
+
+#include <algorithm>
+#include <limits>
+
+#include "common/logger.h"
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+namespace {
+
+constexpr int IS_TRANSPOSE = 1;
+constexpr int INPUT_DTYPE = 5;
+constexpr int OUTPUT_DTYPE = 5;
+
+}  // namespace
+
+TpuFlatIndex::TpuFlatIndex(int devId, int dims, int maxBatch, int maxK)
+    : FaceIndex(dims), mDevId(devId), mMaxBatch(maxBatch), mMaxK(maxK) {}
+
+TpuFlatIndex::~TpuFlatIndex() {
+  if (mHandle == nullptr) return;
+  bm_free_device(mHandle, mQueryMem);
+  bm_free_device(mHandle, mSortedSimilarityMem);
+  bm_free_device(mHandle, mSortedIndexMem);
+  if (mCapacity > 0) {
+    bm_free_device(mHandle, mDbMem);
+    bm_free_device(mHandle, mBufferMem);
+  }
+  bm_dev_free(mHandle);
+}
+
+bool TpuFlatIndex::init() {
+  if (bm_dev_request(&mHandle, mDevId) != BM_SUCCESS) {
+    mHandle = nullptr;
+    return false;
+  }
+  mOutputScores.resize(static_cast<std::size_t>(mMaxBatch) * mMaxK);
+  mOutputRows.resize(static_cast<std::size_t>(mMaxBatch) * mMaxK);
+  return bm_malloc_device_byte(mHandle, &mQueryMem,
+                               mMaxBatch * mDims * sizeof(float)) ==
+             BM_SUCCESS &&
+         bm_malloc_device_byte(mHandle, &mSortedSimilarityMem,
+                               mMaxBatch * mMaxK * sizeof(float)) ==
+             BM_SUCCESS &&
+         bm_malloc_device_byte(mHandle, &mSortedIndexMem,
+                               mMaxBatch * mMaxK * sizeof(int)) == BM_SUCCESS;
+}
+
+bool TpuFlatIndex::reserve(std::size_t rows) {
+  if (rows <= mCapacity) return true;
+  std::size_t capacity =
+      std::max<std::size_t>({rows, mCapacity * 2, MIN_CAPACITY});
+  bm_device_mem_t dbMem;
+  bm_device_mem_t bufferMem;
+  if (bm_malloc_device_byte(mHandle, &dbMem,
+                            capacity * mDims * sizeof(float)) != BM_SUCCESS)
+    return false;
+  if (bm_malloc_device_byte(mHandle, &bufferMem,
+                            capacity * mMaxBatch * sizeof(float)) !=
+      BM_SUCCESS) {
+    bm_free_device(mHandle, dbMem);
+    return false;
+  }
+  if (mCapacity > 0) {
+    bm_free_device(mHandle, mDbMem);
+    bm_free_device(mHandle, mBufferMem);
+  }
+  mDbMem = dbMem;
+  mBufferMem = bufferMem;
+  mCapacity = capacity;
+  // 新的设备内存中还没有数据，已有的行整体重新上传
+  uploadRows(0, mIds.size());
+  return true;
+}
+
+void TpuFlatIndex::uploadRows(std::size_t begin, std::size_t end) {
+  if (begin >= end) return;
+  std::size_t rowBytes = mDims * sizeof(float);
+  bm_memcpy_s2d_partial_offset(
+      mHandle, mDbMem, mVectors.data() + begin * mDims,
+      static_cast<unsigned int>((end - begin) * rowBytes),
+      static_cast<unsigned int>(begin * rowBytes));
+}
+
+void TpuFlatIndex::add(const int* ids, const float* vectors, int num) {
+  std::size_t begin = mIds.size();
+  for (int i = 0; i < num; ++i) {
+    const float* v = vectors + static_cast<std::size_t>(i) * mDims;
+    auto it = mRows.find(ids[i]);
+    if (it != mRows.end()) {
+      std::copy(v, v + mDims, mVectors.begin() + it->second * mDims);
+      if (it->second < begin) uploadRows(it->second, it->second + 1);
+      continue;
+    }
+    mRows.emplace(ids[i], mIds.size());
+    mIds.push_back(ids[i]);
+    mVectors.insert(mVectors.end(), v, v + mDims);
+  }
+  if (mIds.size() > mCapacity) {
+    if (!reserve(mIds.size())) {
+      IVS_ERROR("Faiss tpu index can not allocate device memory for {0:d} rows",
+                static_cast<int>(mIds.size()));
+      // 保持主机和设备一致，丢弃本次新增的行
+      for (std::size_t row = begin; row < mIds.size(); ++row)
+        mRows.erase(mIds[row]);
+      mIds.resize(begin);
+      mVectors.resize(begin * mDims);
+    }
+    return;
+  }
+  uploadRows(begin, mIds.size());
+}
+
+int TpuFlatIndex::remove(const int* ids, int num) {
+  int removed = 0;
+  for (int i = 0; i < num; ++i) {
+    auto it = mRows.find(ids[i]);
+    if (it == mRows.end()) continue;
+    std::size_t row = it->second;
+    std::size_t last = mIds.size() - 1;
+    mRows.erase(it);
+    if (row != last) {
+      mIds[row] = mIds[last];
+      std::copy(mVectors.begin() + last * mDims,
+                mVectors.begin() + (last + 1) * mDims,
+                mVectors.begin() + row * mDims);
+      mRows[mIds[row]] = row;
+      uploadRows(row, row + 1);
+    }
+    mIds.pop_back();
+    mVectors.resize(last * mDims);
+    ++removed;
+  }
+  return removed;
+}
+
+void TpuFlatIndex::search(const float* queries, int num, int k, float* scores,
+                          int* ids) const {
+  int dbNum = static_cast<int>(mIds.size());
+  int sortCnt = std::min({k, mMaxK, dbNum});
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (int begin = 0; begin < num; begin += mMaxBatch) {
+    int batch = std::min(mMaxBatch, num - begin);
+    if (sortCnt > 0) {
+      bm_memcpy_s2d_partial(
+          mHandle, mQueryMem,
+          const_cast<float*>(queries + static_cast<std::size_t>(begin) * mDims),
+          batch * mDims * sizeof(float));
+      bmcv_faiss_indexflatIP(mHandle, mQueryMem, mDbMem, mBufferMem,
+                             mSortedSimilarityMem, mSortedIndexMem, mDims,
+                             batch, dbNum, sortCnt, IS_TRANSPOSE, INPUT_DTYPE,
+                             OUTPUT_DTYPE);
+      bm_memcpy_d2s_partial(mHandle, mOutputScores.data(), mSortedSimilarityMem,
+                            batch * sortCnt * sizeof(float));
+      bm_memcpy_d2s_partial(mHandle, mOutputRows.data(), mSortedIndexMem,
+                            batch * sortCnt * sizeof(int));
+    }
+    for (int q = 0; q < batch; ++q) {
+      float* outScores = scores + static_cast<std::size_t>(begin + q) * k;
+      int* outIds = ids + static_cast<std::size_t>(begin + q) * k;
+      for (int j = 0; j < k; ++j) {
+        int row = j < sortCnt ? mOutputRows[q * sortCnt + j] : -1;
+        if (row < 0 || row >= dbNum) {
+          outScores[j] = -std::numeric_limits<float>::infinity();
+          outIds[j] = -1;
+        } else {
+          outScores[j] = mOutputScores[q * sortCnt + j];
+          outIds[j] = mIds[row];
+        }
+      }
+    }
+  }
+}
+
+void TpuFlatIndex::exportTo(std::vector<int>& ids,
+                            std::vector<float>& vectors) const {
+  ids = mIds;
+  vectors = mVectors;
+}
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif
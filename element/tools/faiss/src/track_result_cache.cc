@@ -0,0 +1,109 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "track_result_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sophon_stream {
+namespace element {
+namespace faiss {
+
+namespace {
+
+float norm(const float* x, int dims) {
+  float sum = 0.f;
+  for (int i = 0; i < dims; ++i) sum += x[i] * x[i];
+  return std::sqrt(sum);
+}
+
+}  // namespace
+
+TrackResultCache::TrackResultCache(const TrackResultCacheConfig& config,
+                                   int dims, int k)
+    : mConfig(config), mDims(dims), mK(k) {}
+
+bool TrackResultCache::lookup(int channelId, long long trackId,
+                              long long frameId, const float* feature,
+                              std::uint64_t galleryVersion, int* ids,
+                              float* scores) {
+  if (!enabled() || trackId < 0) return false;
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto channelIt = mChannels.find(channelId);
+  if (channelIt == mChannels.end()) return false;
+  Channel& channel = channelIt->second;
+  expire(channel, frameId);
+  auto it = channel.entries.find(trackId);
+  if (it == channel.entries.end()) return false;
+  Entry& entry = it->second;
+  // 帧号回退说明通道重新开始，按未命中处理，由update()覆盖
+  if (entry.galleryVersion != galleryVersion ||
+      frameId < entry.searchFrameId ||
+      frameId - entry.searchFrameId >= mConfig.maxFrames) {
+    return false;
+  }
+  float featureNorm = norm(feature, mDims);
+  if (featureNorm <= 0.f) return false;
+  float dot = 0.f;
+  for (int i = 0; i < mDims; ++i) dot += entry.feature[i] * feature[i];
+  if (dot / featureNorm < mConfig.minSimilarity) return false;
+
+  entry.lastFrameId = frameId;
+  std::copy(entry.ids.begin(), entry.ids.end(), ids);
+  std::copy(entry.scores.begin(), entry.scores.end(), scores);
+  return true;
+}
+
+void TrackResultCache::update(int channelId, long long trackId,
+                              long long frameId, const float* feature,
+                              std::uint64_t galleryVersion, const int* ids,
+                              const float* scores) {
+  if (!enabled() || trackId < 0) return;
+  float featureNorm = norm(feature, mDims);
+  if (featureNorm <= 0.f) return;
+  std::lock_guard<std::mutex> lock(mMutex);
+  Channel& channel = mChannels[channelId];
+  expire(channel, frameId);
+  Entry& entry = channel.entries[trackId];
+  entry.feature.resize(mDims);
+  for (int i = 0; i < mDims; ++i) entry.feature[i] = feature[i] / featureNorm;
+  entry.ids.assign(ids, ids + mK);
+  entry.scores.assign(scores, scores + mK);
+  entry.searchFrameId = frameId;
+  entry.lastFrameId = frameId;
+  entry.galleryVersion = galleryVersion;
+}
+
+std::size_t TrackResultCache::size() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::size_t total = 0;
+  for (const auto& channel : mChannels) total += channel.second.entries.size();
+  return total;
+}
+
+void TrackResultCache::expire(Channel& channel, long long frameId) {
+  if (frameId >= channel.lastExpireFrameId &&
+      frameId - channel.lastExpireFrameId < mConfig.maxFrames) {
+    return;
+  }
+  channel.lastExpireFrameId = frameId;
+  for (auto it = channel.entries.begin(); it != channel.entries.end();) {
+    long long lastFrameId = it->second.lastFrameId;
+    if (lastFrameId > frameId || frameId - lastFrameId > mConfig.maxFrames) {
+      it = channel.entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace faiss
+}  // namespace element
+}  // namespace sophon_stream
@@ -10,62 +10,19 @@
 #ifndef SOPHON_STREAM_ELEMENT_FILTER_H_
 #define SOPHON_STREAM_ELEMENT_FILTER_H_
 
+#include <memory>
 #include <nlohmann/json.hpp>
-#include <queue>
+#include <string>
 
 #include "common/common_defs.h"
 #include "common/logger.h"
 #include "common/object_metadata.h"
 #include "element_factory.h"
+#include "filter_rules.h"
 namespace sophon_stream {
 namespace element {
 namespace filter {
-struct Area {
-  std::vector<common::Point<int>> points;
-};
-class Filter_Imp {
- public:
-  Filter_Imp(){};
-  bool isInPolygon(std::shared_ptr<common::ObjectMetadata> objectMetadata);
-  bool isinclasses(std::shared_ptr<common::ObjectMetadata> objectMetadata);
-  bool isOutsideWorkingHours(
-      std::shared_ptr<common::ObjectMetadata> objectMetadata);
-  bool istrack(std::shared_ptr<common::ObjectMetadata> objectMetadata,
-               std::unordered_map<std::string, int>& continue_frame_num_);
-  void push_class(int Class) { classes.push_back(Class); };
-  void set_alert_first_frames(int alert_first_frames_) {
-    alert_first_frames = alert_first_frames_;
-  };
-  void set_alert_frame_skip_nums(int alert_frame_skip_nums_) {
-    alert_frame_skip_nums = alert_frame_skip_nums_;
-  };
-  void push_time(std::pair<int64_t, int64_t> time) { times.push_back(time); };
-  void push_area(Area area) { areas.push_back(area); };
-  void set_type(int type_) { type = type_; };
-
- private:
-  std::vector<int> classes;
-  int alert_first_frames;
-  int alert_frame_skip_nums;
-  std::vector<std::pair<int64_t, int64_t>> times;
-  std::vector<Area> areas;
-  int type;  // 筛选类型
-
-  bool onSegment(const common::Point<int>& p, const common::Point<int>& q,
-                 const common::Point<int>& r);
-
-  int orientation(const common::Point<int>& p, const common::Point<int>& q,
-                  const common::Point<int>& r);
-
-  bool doIntersect(const common::Point<int>& p1, const common::Point<int>& q1,
-                   const common::Point<int>& p2, const common::Point<int>& q2);
 
-  bool isPointInsidePolygon(const common::Point<int>& p,
-                            const std::vector<common::Point<int>>& polygon);
-
-  bool isRectangleInsidePolygon(std::vector<common::Point<int>>& rectangle,
-                                const std::vector<common::Point<int>>& polygon);
-};
 class Filter : public ::sophon_stream::framework::Element {
  public:
   Filter();
@@ -74,34 +31,28 @@ class Filter : public ::sophon_stream::framework::Element {
 
   common::ErrorCode doWork(int dataPipeId) override;
 
-  static constexpr const char* CONFIG_INTERNAL_RULES_FILED = "rules";
-  static constexpr const char* CONFIG_INTERNAL_CHANNEL_ID_FILED = "channel_id";
-  static constexpr const char* CONFIG_INTERNAL_FILTERS_FILED = "filters";
-
-  static constexpr const char* CONFIG_INTERNAL_ALERT_FIRST_FRAME_FILED =
-      "alert_first_frame";
-  static constexpr const char* CONFIG_INTERNAL_ALERT_FRAME_SKIP_NUM_FILED =
-      "alert_frame_skip_nums";
-  static constexpr const char* CONFIG_INTERNAL_AREAS_FILED = "areas";
+  /**
+   * @brief 注册更新规则的http接口，规则在运行时整体替换
+   */
+  void registListenFunc(
+      sophon_stream::framework::ListenThread* listener) override;
 
-  static constexpr const char* CONFIG_INTERNAL_TOP_FILED = "top";
-  static constexpr const char* CONFIG_INTERNAL_LEFT_FILED = "left";
-  static constexpr const char* CONFIG_INTERNAL_CLASSES_FILED = "classes";
-  static constexpr const char* CONFIG_INTERNAL_TIMES_FILED = "times";
-  static constexpr const char* CONFIG_INTERNAL_TIME_START_FILED = "time_start";
-  static constexpr const char* CONFIG_INTERNAL_TIME_END_FILED = "time_end";
-  static constexpr const char* CONFIG_INTERNAL_TYPE_FILED = "type";
+  static constexpr const char* CONFIG_INTERNAL_RULES_FILED = "rules";
 
  private:
-  int64_t timeToMilliseconds(
-      const std::string& time);  // 把时间戳转换成一天内的时间
-
-  std::vector<std::vector<Filter_Imp>> Filter_imps;  // 不同路的不同过滤器
-  std::unordered_map<int, int>
-      channel_id_indexs;  // 每一路对应的channel_id的index
-  std::vector<std::unordered_map<std::string, int>>
-      continue_frame_num;  // 每一路连续追踪计数，map中key代表追踪的id,value代表追踪帧数
-  // std::mutex condit_mtx;
+  /**
+   * @brief 请求体为{"rules": [...]}或rules数组本身，格式与配置文件相同
+   */
+  void listenerSetRules(const httplib::Request& request,
+                        httplib::Response& response);
+
+  /**
+   * @brief 当前生效的规则，用std::atomic_load/std::atomic_store整体替换，
+   * 正在处理的帧继续使用替换前的规则
+   */
+  std::shared_ptr<RuleSet> mRuleSet;
+
+  std::string postNameSetRules = "/filter/SetRules";
 };
 
 }  // namespace filter
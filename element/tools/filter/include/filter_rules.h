@@ -0,0 +1,193 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_FILTER_RULES_H_
+#define SOPHON_STREAM_ELEMENT_FILTER_RULES_H_
+
+#include <cstdint>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/error_code.h"
+#include "common/graphics.h"
+#include "common/object_metadata.h"
+
+namespace sophon_stream {
+namespace element {
+namespace filter {
+
+/**
+ * @brief 编译后的多边形区域
+ * @details
+ * 点的坐标沿用配置中的(top, left)，mX为top，mY为left，检测框的四个角也按同样的方式构造。
+ * 编译时保存每条边及其包围盒，并把多边形的包围盒划分为kGridSize x kGridSize的网格，
+ * 每个格子（闭区间）标记为内部、外部或与边界相交，再对内部和外部格子分别建立前缀和。
+ * 判断检测框时先查询它覆盖的格子：全部在内部直接返回true，有外部格子直接返回false，
+ * 只有覆盖了边界格子时才逐边检查，结果与逐角点、逐边检查的原实现一致。
+ */
+class CompiledArea {
+ public:
+  static constexpr int kGridSize = 32;
+
+  explicit CompiledArea(std::vector<common::Point<int>> points);
+
+  /**
+   * @brief 检测框是否在区域内，与边界接触视为不在区域内
+   * @details 顶点数为0时总是返回true；顶点数为1或2时，点或线段与检测框（闭区间）相交即返回true
+   */
+  bool containsRect(int top, int left, int bottom, int right) const;
+
+  const std::vector<common::Point<int>>& getPoints() const { return mPoints; }
+
+ private:
+  struct Edge {
+    common::Point<int> p;
+    common::Point<int> q;
+    int minX, maxX, minY, maxY;
+  };
+
+  enum CellType : std::uint8_t { INSIDE, OUTSIDE, BOUNDARY };
+
+  /**
+   * @brief 严格内部的点返回true，不在边界上的点结果精确
+   */
+  bool isPointInside(double x, double y) const;
+
+  bool exactContainsRect(int top, int left, int bottom, int right) const;
+
+  /**
+   * @brief 前缀和表中[i0, i1] x [j0, j1]范围内的格子数
+   */
+  int countCells(const std::vector<std::uint16_t>& table, int i0, int j0,
+                 int i1, int j1) const;
+
+  std::vector<common::Point<int>> mPoints;
+  std::vector<Edge> mEdges;
+  int mMinX = 0, mMaxX = 0, mMinY = 0, mMaxY = 0;
+
+  std::int64_t mCellWidth = 1, mCellHeight = 1;
+  int mGridWidth = 0, mGridHeight = 0;
+  /**
+   * @brief (mGridWidth + 1) x (mGridHeight + 1)的二维前缀和
+   */
+  std::vector<std::uint16_t> mInsideTable;
+  std::vector<std::uint16_t> mOutsideTable;
+};
+
+/**
+ * @brief 一个编译后的筛选器，对应配置filters数组中的一项
+ */
+struct FilterRule {
+  int type = 0;  // 筛选类型，recognize:0  track:1 classes:other
+  int alertFirstFrames = 0;
+  int alertFrameSkipNums = 1;
+  /**
+   * @brief 一天内的毫秒数区间，闭区间
+   */
+  std::vector<std::pair<std::int64_t, std::int64_t>> times;
+  /**
+   * @brief [0, kMaxBitsetClass)内的类别用位图查询，其余类别有序存放
+   */
+  std::vector<std::uint64_t> classBits;
+  std::vector<int> otherClasses;
+  std::vector<CompiledArea> areas;
+
+  static constexpr int kMaxBitsetClass = 1 << 16;
+
+  bool hasClass(int cls) const;
+  bool isInWorkingHours(std::int64_t timestamp) const;
+  bool isAlertFrame(int count) const {
+    return count > alertFirstFrames &&
+           (count - alertFirstFrames - 1) % alertFrameSkipNums == 0;
+  }
+};
+
+/**
+ * @brief 一路码流的筛选器和连续追踪计数
+ * @details
+ * 追踪计数按track id（整数）和识别结果的label分别保存在有序数组中，
+ * 每帧用排序合并的方式更新，不再为每个track id构造字符串和哈希表。
+ */
+class ChannelRules {
+ public:
+  /**
+   * @brief 依次执行各个筛选器，返回tag，第i位为1代表满足第i个筛选器
+   * @details 与原实现一致，后面的筛选器看到的是前面筛选器裁剪后的结果
+   */
+  int apply(common::ObjectMetadata& objectMetadata);
+
+  std::vector<FilterRule> filters;
+
+ private:
+  void updateTrackCounts(const common::ObjectMetadata& objectMetadata);
+  bool isTrackAlert(const FilterRule& rule,
+                    common::ObjectMetadata& objectMetadata);
+
+  std::vector<std::pair<long long, int>> mTrackCounts;
+  std::vector<std::pair<std::string, int>> mLabelCounts;
+
+  // 复用的临时数组
+  std::vector<long long> mTrackIds;
+  std::vector<std::string> mLabels;
+  std::vector<std::pair<long long, int>> mNextTrackCounts;
+  std::vector<std::pair<std::string, int>> mNextLabelCounts;
+  std::vector<char> mKeep;
+};
+
+/**
+ * @brief 编译后的全部规则，可以整体替换
+ */
+class RuleSet {
+ public:
+  static constexpr const char* CONFIG_INTERNAL_CHANNEL_ID_FILED = "channel_id";
+  static constexpr const char* CONFIG_INTERNAL_FILTERS_FILED = "filters";
+
+  static constexpr const char* CONFIG_INTERNAL_ALERT_FIRST_FRAME_FILED =
+      "alert_first_frame";
+  static constexpr const char* CONFIG_INTERNAL_ALERT_FRAME_SKIP_NUM_FILED =
+      "alert_frame_skip_nums";
+  static constexpr const char* CONFIG_INTERNAL_AREAS_FILED = "areas";
+
+  static constexpr const char* CONFIG_INTERNAL_TOP_FILED = "top";
+  static constexpr const char* CONFIG_INTERNAL_LEFT_FILED = "left";
+  static constexpr const char* CONFIG_INTERNAL_CLASSES_FILED = "classes";
+  static constexpr const char* CONFIG_INTERNAL_TIMES_FILED = "times";
+  static constexpr const char* CONFIG_INTERNAL_TIME_START_FILED = "time_start";
+  static constexpr const char* CONFIG_INTERNAL_TIME_END_FILED = "time_end";
+  static constexpr const char* CONFIG_INTERNAL_TYPE_FILED = "type";
+
+  /**
+   * @brief 编译配置中的rules数组
+   * @param[out] error : 失败时的原因
+   */
+  static common::ErrorCode compile(const nlohmann::json& rules,
+                                   std::shared_ptr<RuleSet>& ruleSet,
+                                   std::string& error);
+
+  /**
+   * @brief channel_id没有对应的规则时返回nullptr
+   */
+  ChannelRules* findChannel(int channelId);
+
+  size_t getChannelNumber() const { return mChannels.size(); }
+
+ private:
+  std::unordered_map<int, int> mChannelIndexs;
+  std::vector<ChannelRules> mChannels;
+};
+
+}  // namespace filter
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_FILTER_RULES_H_
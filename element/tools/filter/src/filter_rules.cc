@@ -0,0 +1,521 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "filter_rules.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace sophon_stream {
+namespace element {
+namespace filter {
+
+namespace {
+
+using common::Point;
+
+bool onSegment(const Point<int>& p, const Point<int>& q, const Point<int>& r) {
+  return q.mX <= std::max(p.mX, r.mX) && q.mX >= std::min(p.mX, r.mX) &&
+         q.mY <= std::max(p.mY, r.mY) && q.mY >= std::min(p.mY, r.mY);
+}
+
+int orientation(const Point<int>& p, const Point<int>& q,
+                const Point<int>& r) {
+  double val =
+      1.0 * (q.mY - p.mY) * (r.mX - q.mX) - 1.0 * (q.mX - p.mX) * (r.mY - q.mY);
+  if (val == 0) return 0;    // colinear
+  return (val > 0) ? 1 : 2;  // clockwise or counterclockwise
+}
+
+/**
+ * @brief 两条线段相交或接触
+ */
+bool doIntersect(const Point<int>& p1, const Point<int>& q1,
+                 const Point<int>& p2, const Point<int>& q2) {
+  int o1 = orientation(p1, q1, p2);
+  int o2 = orientation(p1, q1, q2);
+  int o3 = orientation(p2, q2, p1);
+  int o4 = orientation(p2, q2, q1);
+
+  if (o1 != o2 && o3 != o4) return true;
+
+  if (o1 == 0 && onSegment(p1, p2, q1)) return true;
+  if (o2 == 0 && onSegment(p1, q2, q1)) return true;
+  if (o3 == 0 && onSegment(p2, p1, q2)) return true;
+  if (o4 == 0 && onSegment(p2, q1, q2)) return true;
+
+  return false;
+}
+
+/**
+ * @brief 线段与矩形（闭区间，top <= bottom，left <= right）相交
+ */
+bool segmentTouchesRect(const Point<int>& p, const Point<int>& q, int top,
+                        int left, int bottom, int right) {
+  auto inRect = [&](const Point<int>& point) {
+    return point.mX >= top && point.mX <= bottom && point.mY >= left &&
+           point.mY <= right;
+  };
+  if (inRect(p) || inRect(q)) return true;
+  Point<int> corners[4] = {Point<int>(top, left), Point<int>(top, right),
+                           Point<int>(bottom, right), Point<int>(bottom, left)};
+  for (int i = 0; i < 4; ++i) {
+    if (doIntersect(corners[i], corners[(i + 1) % 4], p, q)) return true;
+  }
+  return false;
+}
+
+int clampToInt(std::int64_t value) {
+  return static_cast<int>(
+      std::min<std::int64_t>(value, std::numeric_limits<int>::max()));
+}
+
+/**
+ * @brief 把时间戳转换成一天内的时间
+ */
+int64_t timeToMilliseconds(const std::string& time) {
+  int h, m, s;
+  char colon;
+  std::istringstream timeStream(time);
+  timeStream >> h >> colon >> m >> colon >> s;
+  return ((h * 3600) + (m * 60) + s) * 1000;
+}
+
+template <typename T>
+void compactObjects(std::vector<T>& objects, const std::vector<char>& keep) {
+  size_t kept = 0;
+  for (size_t j = 0; j < objects.size() && j < keep.size(); ++j) {
+    if (!keep[j]) continue;
+    if (kept != j) objects[kept] = std::move(objects[j]);
+    ++kept;
+  }
+  objects.resize(kept);
+}
+
+/**
+ * @brief 按keep保留检测结果，type为0/1时同步裁剪子目标/追踪结果
+ * @return 是否还有检测结果
+ */
+bool keepObjects(common::ObjectMetadata& objectMetadata, int type,
+                 const std::vector<char>& keep) {
+  compactObjects(objectMetadata.mDetectedObjectMetadatas, keep);
+  if (type == 0) {
+    compactObjects(objectMetadata.mSubObjectMetadatas, keep);
+  } else if (type == 1) {
+    compactObjects(objectMetadata.mTrackedObjectMetadatas, keep);
+  }
+  return !objectMetadata.mDetectedObjectMetadatas.empty();
+}
+
+/**
+ * @brief 用本帧出现的key更新有序的计数数组，本帧没有出现的key被删除
+ */
+template <typename Key>
+void mergeCounts(std::vector<Key>& keys, std::vector<std::pair<Key, int>>& counts,
+                 std::vector<std::pair<Key, int>>& next) {
+  std::sort(keys.begin(), keys.end());
+  next.clear();
+  auto it = counts.begin();
+  for (size_t i = 0; i < keys.size();) {
+    size_t j = i + 1;
+    while (j < keys.size() && keys[j] == keys[i]) ++j;
+    it = std::lower_bound(
+        it, counts.end(), keys[i],
+        [](const std::pair<Key, int>& a, const Key& b) { return a.first < b; });
+    int previous = (it != counts.end() && it->first == keys[i]) ? it->second : 0;
+    next.emplace_back(std::move(keys[i]), previous + static_cast<int>(j - i));
+    i = j;
+  }
+  counts.swap(next);
+}
+
+template <typename Key>
+int findCount(const std::vector<std::pair<Key, int>>& counts, const Key& key) {
+  auto it = std::lower_bound(
+      counts.begin(), counts.end(), key,
+      [](const std::pair<Key, int>& a, const Key& b) { return a.first < b; });
+  return (it != counts.end() && it->first == key) ? it->second : 0;
+}
+
+}  // namespace
+
+CompiledArea::CompiledArea(std::vector<common::Point<int>> points)
+    : mPoints(std::move(points)) {
+  if (mPoints.size() < 3) return;
+
+  mMinX = mMaxX = mPoints[0].mX;
+  mMinY = mMaxY = mPoints[0].mY;
+  for (size_t i = 0; i < mPoints.size(); ++i) {
+    const auto& p = mPoints[i];
+    const auto& q = mPoints[(i + 1) % mPoints.size()];
+    mEdges.push_back({p, q, std::min(p.mX, q.mX), std::max(p.mX, q.mX),
+                      std::min(p.mY, q.mY), std::max(p.mY, q.mY)});
+    mMinX = std::min(mMinX, p.mX);
+    mMaxX = std::max(mMaxX, p.mX);
+    mMinY = std::min(mMinY, p.mY);
+    mMaxY = std::max(mMaxY, p.mY);
+  }
+
+  std::int64_t extentX = static_cast<std::int64_t>(mMaxX) - mMinX;
+  std::int64_t extentY = static_cast<std::int64_t>(mMaxY) - mMinY;
+  mCellWidth = std::max<std::int64_t>(1, (extentX + kGridSize - 1) / kGridSize);
+  mCellHeight =
+      std::max<std::int64_t>(1, (extentY + kGridSize - 1) / kGridSize);
+  mGridWidth = extentX / mCellWidth + 1;
+  mGridHeight = extentY / mCellHeight + 1;
+
+  auto cellTop = [this](int i) {
+    return clampToInt(mMinX + i * mCellWidth);
+  };
+  auto cellLeft = [this](int j) {
+    return clampToInt(mMinY + j * mCellHeight);
+  };
+  // 坐标落在格子分界线上的点同时属于两侧的格子
+  auto firstCell = [](std::int64_t offset, std::int64_t size) {
+    return offset == 0 ? 0 : static_cast<int>((offset - 1) / size);
+  };
+
+  std::vector<CellType> cells(mGridWidth * mGridHeight, OUTSIDE);
+  std::vector<char> isBoundary(cells.size(), 0);
+  for (const auto& edge : mEdges) {
+    int i0 = firstCell(edge.minX - mMinX, mCellWidth);
+    int i1 = std::min<std::int64_t>(mGridWidth - 1,
+                                    (edge.maxX - mMinX) / mCellWidth);
+    int j0 = firstCell(edge.minY - mMinY, mCellHeight);
+    int j1 = std::min<std::int64_t>(mGridHeight - 1,
+                                    (edge.maxY - mMinY) / mCellHeight);
+    for (int i = i0; i <= i1; ++i) {
+      for (int j = j0; j <= j1; ++j) {
+        if (isBoundary[i * mGridHeight + j]) continue;
+        if (segmentTouchesRect(edge.p, edge.q, cellTop(i), cellLeft(j),
+                               cellTop(i + 1), cellLeft(j + 1))) {
+          isBoundary[i * mGridHeight + j] = 1;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < mGridWidth; ++i) {
+    for (int j = 0; j < mGridHeight; ++j) {
+      CellType& cell = cells[i * mGridHeight + j];
+      if (isBoundary[i * mGridHeight + j]) {
+        cell = BOUNDARY;
+      } else {
+        // 格子与边界不相交，中心点的结果代表整个格子
+        double x = mMinX + (i + 0.5) * mCellWidth;
+        double y = mMinY + (j + 0.5) * mCellHeight;
+        cell = isPointInside(x, y) ? INSIDE : OUTSIDE;
+      }
+    }
+  }
+
+  const int stride = mGridHeight + 1;
+  mInsideTable.assign((mGridWidth + 1) * stride, 0);
+  mOutsideTable.assign((mGridWidth + 1) * stride, 0);
+  for (int i = 0; i < mGridWidth; ++i) {
+    for (int j = 0; j < mGridHeight; ++j) {
+      CellType cell = cells[i * mGridHeight + j];
+      int index = (i + 1) * stride + j + 1;
+      mInsideTable[index] = mInsideTable[index - 1] +
+                            mInsideTable[index - stride] -
+                            mInsideTable[index - stride - 1] + (cell == INSIDE);
+      mOutsideTable[index] =
+          mOutsideTable[index - 1] + mOutsideTable[index - stride] -
+          mOutsideTable[index - stride - 1] + (cell == OUTSIDE);
+    }
+  }
+}
+
+int CompiledArea::countCells(const std::vector<std::uint16_t>& table, int i0,
+                             int j0, int i1, int j1) const {
+  const int stride = mGridHeight + 1;
+  return static_cast<int>(table[(i1 + 1) * stride + j1 + 1]) -
+         table[i0 * stride + j1 + 1] - table[(i1 + 1) * stride + j0] +
+         table[i0 * stride + j0];
+}
+
+bool CompiledArea::containsRect(int top, int left, int bottom,
+                                int right) const {
+  if (mPoints.empty()) return true;
+  if (top > bottom) std::swap(top, bottom);
+  if (left > right) std::swap(left, right);
+  if (mPoints.size() < 3) {
+    return segmentTouchesRect(mPoints.front(), mPoints.back(), top, left,
+                              bottom, right);
+  }
+
+  // 超出包围盒的角点一定在多边形外
+  if (top < mMinX || bottom > mMaxX || left < mMinY || right > mMaxY)
+    return false;
+
+  int i0 = (static_cast<std::int64_t>(top) - mMinX) / mCellWidth;
+  int i1 = (static_cast<std::int64_t>(bottom) - mMinX) / mCellWidth;
+  int j0 = (static_cast<std::int64_t>(left) - mMinY) / mCellHeight;
+  int j1 = (static_cast<std::int64_t>(right) - mMinY) / mCellHeight;
+  int cellNumber = (i1 - i0 + 1) * (j1 - j0 + 1);
+  if (countCells(mInsideTable, i0, j0, i1, j1) == cellNumber) return true;
+  if (countCells(mOutsideTable, i0, j0, i1, j1) > 0) return false;
+  return exactContainsRect(top, left, bottom, right);
+}
+
+bool CompiledArea::exactContainsRect(int top, int left, int bottom,
+                                     int right) const {
+  Point<int> corners[4] = {Point<int>(top, left), Point<int>(top, right),
+                           Point<int>(bottom, right), Point<int>(bottom, left)};
+  for (const auto& edge : mEdges) {
+    if (edge.maxX < top || edge.minX > bottom || edge.maxY < left ||
+        edge.minY > right)
+      continue;
+    for (int i = 0; i < 4; ++i) {
+      if (doIntersect(corners[i], corners[(i + 1) % 4], edge.p, edge.q))
+        return false;
+    }
+  }
+  // 检测框与边界不接触，整个框要么在内部要么在外部
+  return isPointInside(top, left);
+}
+
+bool CompiledArea::isPointInside(double x, double y) const {
+  bool inside = false;
+  for (const auto& edge : mEdges) {
+    double ax = edge.p.mX, ay = edge.p.mY;
+    double bx = edge.q.mX, by = edge.q.mY;
+    if ((ay > y) == (by > y)) continue;
+    // 交点在点的+x方向时翻转，用叉积比较避免除法
+    double lhs = (x - ax) * (by - ay);
+    double rhs = (y - ay) * (bx - ax);
+    if (by > ay ? lhs < rhs : lhs > rhs) inside = !inside;
+  }
+  return inside;
+}
+
+bool FilterRule::hasClass(int cls) const {
+  if (cls >= 0 && cls < kMaxBitsetClass) {
+    size_t word = cls >> 6;
+    return word < classBits.size() && ((classBits[word] >> (cls & 63)) & 1);
+  }
+  return std::binary_search(otherClasses.begin(), otherClasses.end(), cls);
+}
+
+bool FilterRule::isInWorkingHours(std::int64_t timestamp) const {
+  timestamp %= (1000 * 60 * 60 * 24);
+  for (const auto& time : times) {
+    if (timestamp <= time.second && timestamp >= time.first) return true;
+  }
+  return false;
+}
+
+int ChannelRules::apply(common::ObjectMetadata& objectMetadata) {
+  int tag = 0;
+  for (int i = 0; i < static_cast<int>(filters.size()); ++i) {
+    const FilterRule& rule = filters[i];
+    auto& detected = objectMetadata.mDetectedObjectMetadatas;
+
+    // 时间规则
+    if (!detected.empty() &&
+        !rule.isInWorkingHours(objectMetadata.mFrame->mTimestamp))
+      continue;
+
+    // 类别规则
+    mKeep.assign(detected.size(), 0);
+    for (size_t j = 0; j < detected.size(); ++j) {
+      mKeep[j] = rule.hasClass(detected[j]->mClassify);
+    }
+    if (!keepObjects(objectMetadata, rule.type, mKeep)) continue;
+
+    // 区域规则，记录每个检测框命中的第一个区域
+    mKeep.assign(detected.size(), 0);
+    for (size_t j = 0; j < detected.size(); ++j) {
+      const auto& box = detected[j]->mBox;
+      for (const auto& area : rule.areas) {
+        if (area.containsRect(box.top(), box.left(), box.bottom(),
+                              box.right())) {
+          objectMetadata.areas.push_back(area.getPoints());
+          mKeep[j] = 1;
+          break;
+        }
+      }
+    }
+    if (!keepObjects(objectMetadata, rule.type, mKeep)) continue;
+
+    // 追踪规则
+    updateTrackCounts(objectMetadata);
+    if (!isTrackAlert(rule, objectMetadata)) continue;
+
+    // 二进制代表，i位是1代表满足第i个筛选器，之后在业务里根据tag判断这个数据是经过几号筛选器过滤的
+    tag |= 1 << i;
+  }
+  return tag;
+}
+
+void ChannelRules::updateTrackCounts(
+    const common::ObjectMetadata& objectMetadata) {
+  mLabels.clear();
+  for (const auto& sub : objectMetadata.mSubObjectMetadatas) {
+    if (sub->mRecognizedObjectMetadatas.size() == 1)
+      mLabels.push_back(sub->mRecognizedObjectMetadatas[0]->mLabelName);
+  }
+  mTrackIds.clear();
+  for (const auto& tracked : objectMetadata.mTrackedObjectMetadatas) {
+    mTrackIds.push_back(tracked->mTrackId);
+  }
+  mergeCounts(mLabels, mLabelCounts, mNextLabelCounts);
+  mergeCounts(mTrackIds, mTrackCounts, mNextTrackCounts);
+}
+
+bool ChannelRules::isTrackAlert(const FilterRule& rule,
+                                common::ObjectMetadata& objectMetadata) {
+  if (rule.type != 0 && rule.type != 1) return true;
+
+  bool hasAlert = false;
+  for (const auto& count : mLabelCounts) {
+    if (rule.isAlertFrame(count.second)) {
+      hasAlert = true;
+      break;
+    }
+  }
+  for (size_t i = 0; i < mTrackCounts.size() && !hasAlert; ++i) {
+    hasAlert = rule.isAlertFrame(mTrackCounts[i].second);
+  }
+  if (!hasAlert) return false;
+
+  auto& detected = objectMetadata.mDetectedObjectMetadatas;
+  if (detected.empty()) return true;
+  mKeep.assign(detected.size(), 0);
+  for (size_t j = 0; j < detected.size(); ++j) {
+    int count = 0;
+    if (rule.type == 0) {
+      if (j < objectMetadata.mSubObjectMetadatas.size()) {
+        const auto& recognized =
+            objectMetadata.mSubObjectMetadatas[j]->mRecognizedObjectMetadatas;
+        if (!recognized.empty())
+          count = findCount(mLabelCounts, recognized[0]->mLabelName);
+      }
+    } else if (j < objectMetadata.mTrackedObjectMetadatas.size()) {
+      count = findCount(mTrackCounts,
+                        objectMetadata.mTrackedObjectMetadatas[j]->mTrackId);
+    }
+    mKeep[j] = rule.isAlertFrame(count);
+  }
+  // 与原实现一致，即使没有保留下任何检测结果也认为满足追踪规则
+  keepObjects(objectMetadata, rule.type, mKeep);
+  return true;
+}
+
+common::ErrorCode RuleSet::compile(const nlohmann::json& rules,
+                                   std::shared_ptr<RuleSet>& ruleSet,
+                                   std::string& error) {
+  auto fail = [&error](const std::string& what) {
+    error = what +
+            ", please check your Filter element configuration file";
+    return common::ErrorCode::PARSE_CONFIGURE_FAIL;
+  };
+  if (!rules.is_array()) return fail("rules must be array");
+
+  auto compiled = std::make_shared<RuleSet>();
+  for (auto& filterArray : rules) {
+    if (!filterArray.is_object()) return fail("rule must be object");
+    auto channelIdIt = filterArray.find(CONFIG_INTERNAL_CHANNEL_ID_FILED);
+    if (channelIdIt == filterArray.end() || !channelIdIt->is_number_integer())
+      return fail("channelid must be int");
+    auto filtersIt = filterArray.find(CONFIG_INTERNAL_FILTERS_FILED);
+    if (filtersIt == filterArray.end() || !filtersIt->is_array())
+      return fail("Filters must be array");
+
+    ChannelRules channel;
+    for (auto& filter : *filtersIt) {
+      if (!filter.is_object()) return fail("filter must be object");
+      FilterRule rule;
+
+      auto firstIt = filter.find(CONFIG_INTERNAL_ALERT_FIRST_FRAME_FILED);
+      if (firstIt != filter.end()) {
+        if (!firstIt->is_number_integer())
+          return fail("alert_first_frame must be int");
+        rule.alertFirstFrames = firstIt->get<int>();
+      }
+      auto skipIt = filter.find(CONFIG_INTERNAL_ALERT_FRAME_SKIP_NUM_FILED);
+      if (skipIt != filter.end()) {
+        if (!skipIt->is_number_integer() || skipIt->get<int>() <= 0)
+          return fail("alert_frame_skip_nums must be positive int");
+        rule.alertFrameSkipNums = skipIt->get<int>();
+      }
+
+      auto areasIt = filter.find(CONFIG_INTERNAL_AREAS_FILED);
+      if (areasIt == filter.end() || !areasIt->is_array())
+        return fail("areas must be array");
+      for (auto& polygon : *areasIt) {
+        if (!polygon.is_array()) return fail("polygon must be array");
+        std::vector<common::Point<int>> points;
+        for (auto& point : polygon) {
+          auto topIt = point.find(CONFIG_INTERNAL_TOP_FILED);
+          if (topIt == point.end() || !topIt->is_number_integer())
+            return fail("top must be int");
+          auto leftIt = point.find(CONFIG_INTERNAL_LEFT_FILED);
+          if (leftIt == point.end() || !leftIt->is_number_integer())
+            return fail("left must be int");
+          points.emplace_back(topIt->get<int>(), leftIt->get<int>());
+        }
+        rule.areas.emplace_back(std::move(points));
+      }
+
+      auto classesIt = filter.find(CONFIG_INTERNAL_CLASSES_FILED);
+      if (classesIt == filter.end() || !classesIt->is_array())
+        return fail("classes must be array");
+      for (auto& cls : *classesIt) {
+        if (!cls.is_number_integer()) return fail("cls must be int");
+        int value = cls.get<int>();
+        if (value >= 0 && value < FilterRule::kMaxBitsetClass) {
+          size_t word = value >> 6;
+          if (rule.classBits.size() <= word) rule.classBits.resize(word + 1, 0);
+          rule.classBits[word] |= std::uint64_t(1) << (value & 63);
+        } else {
+          rule.otherClasses.push_back(value);
+        }
+      }
+      std::sort(rule.otherClasses.begin(), rule.otherClasses.end());
+
+      auto timesIt = filter.find(CONFIG_INTERNAL_TIMES_FILED);
+      if (timesIt == filter.end() || !timesIt->is_array())
+        return fail("times must be array");
+      for (auto& timeObj : *timesIt) {
+        auto startIt = timeObj.find(CONFIG_INTERNAL_TIME_START_FILED);
+        if (startIt == timeObj.end() || !startIt->is_string())
+          return fail("time_start must be string");
+        auto endIt = timeObj.find(CONFIG_INTERNAL_TIME_END_FILED);
+        if (endIt == timeObj.end() || !endIt->is_string())
+          return fail("time_end must be string");
+        rule.times.emplace_back(timeToMilliseconds(startIt->get<std::string>()),
+                                timeToMilliseconds(endIt->get<std::string>()));
+      }
+
+      auto typeIt = filter.find(CONFIG_INTERNAL_TYPE_FILED);
+      if (typeIt == filter.end() || !typeIt->is_number_integer())
+        return fail("type must be int");
+      rule.type = typeIt->get<int>();
+
+      channel.filters.push_back(std::move(rule));
+    }
+    compiled->mChannelIndexs[channelIdIt->get<int>()] =
+        compiled->mChannels.size();
+    compiled->mChannels.push_back(std::move(channel));
+  }
+
+  ruleSet = std::move(compiled);
+  return common::ErrorCode::SUCCESS;
+}
+
+ChannelRules* RuleSet::findChannel(int channelId) {
+  auto it = mChannelIndexs.find(channelId);
+  if (it == mChannelIndexs.end()) return nullptr;
+  return &mChannels[it->second];
+}
+
+}  // namespace filter
+}  // namespace element
+}  // namespace sophon_stream
@@ -10,53 +10,17 @@
 #ifndef SOPHON_STREAM_ELEMENT_HTTP_PUSH_H_
 #define SOPHON_STREAM_ELEMENT_HTTP_PUSH_H_
 
-#include <mutex>
+#include <memory>
 #include <nlohmann/json.hpp>
-#include <queue>
 
 #include "common/object_metadata.h"
-#include "common/profiler.h"
 #include "element.h"
-#include "httplib.h"
+#include "push_sender.h"
 
 namespace sophon_stream {
 namespace element {
 namespace http_push {
 
-class HttpPushImpl_ {
- public:
-#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-  HttpPushImpl_(std::string& scheme, std::string& ip, int port, std::string cert, std::string key,
-		  std::string cacert_, bool verify_, std::string path_, int channel);
-#else
-  HttpPushImpl_(std::string& ip, int port, std::string path, int channel);
-#endif
-  bool pushQueue(std::shared_ptr<nlohmann::json> j);
-  void release();
-
- private:
-  std::queue<std::shared_ptr<nlohmann::json>> objQueue;
-  std::thread workThread;
-  void postFunc();
-  bool isRunning = true;
-  std::shared_ptr<nlohmann::json> popQueue();
-  size_t getQueueSize();
-  std::mutex mtx;
-  constexpr static int maxQueueLen = 20;
-
-  httplib::Client cli;
-#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-  std::string scheme;
-  std::string cacert;
-  std::string key;
-  bool verify;
-#endif
-  std::string path;
-
-  std::string mFpsProfilerName;
-  ::sophon_stream::common::FpsProfiler mFpsProfiler;
-};
-
 class HttpPush : public ::sophon_stream::framework::Element {
  public:
   HttpPush();
@@ -66,9 +30,31 @@ class HttpPush : public ::sophon_stream::framework::Element {
 
   common::ErrorCode doWork(int dataPipeId) override;
 
+  void onStart() override;
+
   static constexpr const char* CONFIG_INTERNAL_IP_FILED = "ip";
   static constexpr const char* CONFIG_INTERNAL_PORT_FILED = "port";
   static constexpr const char* CONFIG_INTERNAL_PATH_FILED = "path";
+  static constexpr const char* CONFIG_INTERNAL_FORMAT_FILED = "format";
+  static constexpr const char* CONFIG_INTERNAL_SENDERS_FILED = "senders";
+  static constexpr const char* CONFIG_INTERNAL_BATCH_SIZE_FILED = "batch_size";
+  static constexpr const char* CONFIG_INTERNAL_BATCH_TIMEOUT_MS_FILED =
+      "batch_timeout_ms";
+  static constexpr const char* CONFIG_INTERNAL_QUEUE_LENGTH_FILED =
+      "queue_length";
+  static constexpr const char* CONFIG_INTERNAL_MAX_RETRIES_FILED =
+      "max_retries";
+  static constexpr const char* CONFIG_INTERNAL_RETRY_INTERVAL_MS_FILED =
+      "retry_interval_ms";
+  static constexpr const char* CONFIG_INTERNAL_TIMEOUT_MS_FILED = "timeout_ms";
+  static constexpr const char* CONFIG_INTERNAL_GZIP_FILED = "gzip";
+  static constexpr const char* CONFIG_INTERNAL_SPILL_DIR_FILED = "spill_dir";
+  static constexpr const char* CONFIG_INTERNAL_SPILL_MAX_MB_FILED =
+      "spill_max_mb";
+  static constexpr const char* CONFIG_INTERNAL_SPILL_SEGMENT_MB_FILED =
+      "spill_segment_mb";
+  static constexpr const char* CONFIG_INTERNAL_SPILL_REPLAY_RATE_FILED =
+      "spill_replay_rate";
 #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
   static constexpr const char* CONFIG_INTERNAL_SCHEME_FILED = "scheme";
   static constexpr const char* CONFIG_INTERNAL_CERT_FILED = "cert";
@@ -78,18 +64,11 @@ class HttpPush : public ::sophon_stream::framework::Element {
 #endif
 
  private:
-  std::unordered_map<int, std::shared_ptr<HttpPushImpl_>> mapImpl_;
-  std::mutex mapMtx;
-  std::string ip_;
-  int port_;
-  std::string path_;
-#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-  std::string scheme_;
-  std::string cert_;
-  std::string key_;
-  std::string cacert_;
-  bool verify_;
-#endif
+  /**
+   * @brief 所有码流共用的发送器
+   */
+  std::unique_ptr<PushSender> mSender;
+  common::SerializeFormat format_ = common::SerializeFormat::JSON;
 };
 
 }  // namespace http_push
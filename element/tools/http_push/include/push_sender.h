@@ -0,0 +1,250 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_ELEMENT_HTTP_PUSH_PUSH_SENDER_H_
+#define SOPHON_STREAM_ELEMENT_HTTP_PUSH_PUSH_SENDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/binary_serialize.h"
+#include "common/profiler.h"
+#include "common/spill_queue.h"
+#include "httplib.h"
+
+namespace sophon_stream {
+namespace element {
+namespace http_push {
+
+/**
+ * @brief 一次待发送的结果，发送完成后放回空闲列表，缓冲区的容量逐帧复用
+ */
+struct PushPayload {
+  common::BinaryWriter writer;
+  const char* contentType = common::JSON_CONTENT_TYPE;
+};
+
+struct PushSenderConfig {
+  std::string ip;
+  int port = 8000;
+  std::string path;
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+  std::string scheme = "http";
+  std::string cert;
+  std::string key;
+  std::string cacert;
+  bool verify = false;
+#endif
+  /**
+   * @brief 发送线程数，每个线程持有一个keep-alive连接，码流按channel_id分到各线程上
+   */
+  int senders = 1;
+  /**
+   * @brief 每个请求最多合并的结果数量，为1时请求体与单条结果相同
+   */
+  int batchSize = 1;
+  /**
+   * @brief 凑批的最长等待时间，单位ms，为0时只合并队列中已有的结果
+   */
+  int batchTimeoutMs = 0;
+  /**
+   * @brief 每个发送线程的队列长度，队列满时丢弃新的结果
+   */
+  int queueLength = 64;
+  /**
+   * @brief 请求失败后的重试次数和重试间隔
+   */
+  int maxRetries = 2;
+  int retryIntervalMs = 100;
+  /**
+   * @brief 连接、读、写的超时时间，单位ms
+   */
+  int timeoutMs = 5000;
+  /**
+   * @brief 请求体使用gzip压缩，需要编译时找到zlib
+   */
+  bool gzip = false;
+  /**
+   * @brief 磁盘暂存目录，为空时不启用。每个发送线程使用其中的sender_<i>子目录
+   */
+  std::string spillDir;
+  /**
+   * @brief 所有发送线程合计的磁盘占用上限和段文件大小
+   */
+  std::uint64_t spillMaxBytes = 256ull << 20;
+  std::uint64_t spillSegmentBytes = 16ull << 20;
+  /**
+   * @brief 每个发送线程从磁盘重放的速率上限，条/秒，为0时不限速
+   */
+  int spillReplayRate = 500;
+};
+
+/**
+ * @brief 发送统计，通过/metrics输出
+ */
+struct PushStats {
+  /**
+   * @brief 发送成功的结果数量和请求数量
+   */
+  std::atomic<std::uint64_t> sentItems{0};
+  std::atomic<std::uint64_t> sentRequests{0};
+  /**
+   * @brief 队列已满被丢弃的结果数量
+   */
+  std::atomic<std::uint64_t> droppedItems{0};
+  /**
+   * @brief 重试次数用完仍然失败、被丢弃的结果数量
+   */
+  std::atomic<std::uint64_t> failedItems{0};
+  std::atomic<std::uint64_t> retries{0};
+  /**
+   * @brief 写入磁盘暂存的结果数量，以及从磁盘重放成功的结果数量
+   */
+  std::atomic<std::uint64_t> spilledItems{0};
+  std::atomic<std::uint64_t> replayedItems{0};
+  /**
+   * @brief 压缩前后的请求体字节数
+   */
+  std::atomic<std::uint64_t> rawBytes{0};
+  std::atomic<std::uint64_t> sentBytes{0};
+};
+
+/**
+ * @brief 多路码流共用的结果发送器
+ * @details
+ * 固定数量的发送线程，每个线程有自己的队列和一个keep-alive的httplib::Client。
+ * 同一路码流总是进入同一个队列，因此同一路的结果按顺序发送。
+ * 发送线程一次从队列中取出最多batchSize条结果合并为一个请求：JSON格式合并为数组，
+ * 二进制格式首尾相接（每条消息自带长度，可以顺序解析）。
+ * @details
+ * 配置spillDir后，队列已满或请求重试后仍然失败时，结果写入该线程的磁盘队列
+ * （common::SpillQueue），此后新结果也追加到磁盘队列，直到其中的结果全部重放完，
+ * 因此同一路的结果仍然按顺序发送。重放按spillReplayRate限速，失败时指数退避。
+ * 磁盘中的结果在进程重启后继续发送，至少发送一次，接收端可能收到重复的结果。
+ */
+class PushSender {
+ public:
+  /**
+   * @brief 失败退避的最长间隔，单位ms
+   */
+  static constexpr int MAX_BACKOFF_MS = 10000;
+
+  explicit PushSender(const PushSenderConfig& config);
+  ~PushSender();
+
+  /**
+   * @brief 启动发送线程
+   */
+  void start();
+  /**
+   * @brief 发送完队列中剩余的结果后停止发送线程，剩余结果不再重试
+   */
+  void stop();
+
+  /**
+   * @brief 取出一个空闲的payload，没有时新建
+   */
+  std::unique_ptr<PushPayload> acquirePayload();
+  /**
+   * @brief 放入channelId对应的队列，队列已满且没有磁盘队列时丢弃payload并放回空闲列表，
+   * 返回false
+   */
+  bool push(int channelId, std::unique_ptr<PushPayload> payload);
+
+  /**
+   * @brief 所有队列中等待发送的结果数量
+   */
+  size_t getQueueSize();
+
+  /**
+   * @brief 磁盘队列是否可用，spillDir为空或目录无法打开时为false
+   */
+  bool isSpillEnabled() const;
+  /**
+   * @brief 所有磁盘队列中等待重放的结果数量、占用的磁盘空间、超出上限被丢弃的结果数量
+   */
+  std::uint64_t getSpillSize();
+  std::uint64_t getSpillBytes();
+  std::uint64_t getSpillDropped();
+
+  const std::shared_ptr<PushStats>& getStats() const { return mStats; }
+
+  /**
+   * @brief gzip压缩，没有zlib时返回false
+   */
+  static bool gzipCompress(const std::string& input, std::string& output);
+  static bool gzipSupported();
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::unique_ptr<PushPayload>> queue;
+    std::thread thread;
+    std::unique_ptr<httplib::Client> client;
+    std::unique_ptr<common::SpillQueue> spill;
+    std::vector<common::SpillRecord> records;
+    std::string fpsProfilerName;
+    ::sophon_stream::common::FpsProfiler fpsProfiler;
+  };
+
+  void workFunc(Worker& worker);
+  /**
+   * @brief 等待并取出一批结果，内存队列为空时从磁盘队列读取，fromSpill置为true，
+   * 停止且内存队列为空时返回false
+   */
+  bool popBatch(Worker& worker, std::vector<std::unique_ptr<PushPayload>>& batch,
+                bool& fromSpill);
+  /**
+   * @brief 合并一批结果的请求体
+   */
+  void makeBody(const std::vector<std::unique_ptr<PushPayload>>& batch,
+                std::string& body) const;
+  /**
+   * @brief 发送一个请求，失败时按配置重试，返回是否成功
+   */
+  bool post(Worker& worker, const std::string& body, const char* contentType,
+            bool gzipped);
+  /**
+   * @brief 等待到deadline，停止时立即返回
+   */
+  void waitUntil(Worker& worker,
+                 std::chrono::steady_clock::time_point deadline);
+  /**
+   * @brief 依次把batch和内存队列中的结果写入磁盘队列，调用时持有worker.mutex
+   */
+  void spillLocked(Worker& worker,
+                   std::vector<std::unique_ptr<PushPayload>>& batch);
+  bool hasSpill(Worker& worker) const;
+  void recyclePayload(std::unique_ptr<PushPayload> payload);
+  std::unique_ptr<httplib::Client> makeClient() const;
+
+  const PushSenderConfig mConfig;
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+  std::atomic<bool> mRunning{false};
+  bool mSpillFailed = false;
+  std::shared_ptr<PushStats> mStats;
+
+  std::mutex mIdleMutex;
+  std::vector<std::unique_ptr<PushPayload>> mIdlePayloads;
+};
+
+}  // namespace http_push
+}  // namespace element
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_ELEMENT_HTTP_PUSH_PUSH_SENDER_H_
@@ -11,6 +11,7 @@
 
 #include "common/common_defs.h"
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "common/serialize.h"
 #include "element_factory.h"
 
@@ -19,9 +20,7 @@ namespace element {
 namespace http_push {
 HttpPush::HttpPush() {}
 HttpPush::~HttpPush() {
-  for (auto [k, v] : mapImpl_) {
-    v->release();
-  }
+  if (mSender) mSender->stop();
 }
 
 common::ErrorCode HttpPush::initInternal(const std::string& json) {
@@ -32,138 +31,212 @@ common::ErrorCode HttpPush::initInternal(const std::string& json) {
       errorCode = common::ErrorCode::PARSE_CONFIGURE_FAIL;
       break;
     }
+    PushSenderConfig config;
     auto ipIt = configure.find(CONFIG_INTERNAL_IP_FILED);
     STREAM_CHECK((ipIt != configure.end() && ipIt->is_string()),
                  "IP must be std::string, please check your http_push element "
                  "configuration file");
-    ip_ = ipIt->get<std::string>();
+    config.ip = ipIt->get<std::string>();
     auto portIt = configure.find(CONFIG_INTERNAL_PORT_FILED);
     STREAM_CHECK((portIt != configure.end() && portIt->is_number_integer()),
                  "Port must be integer, please check your http_push element "
                  "configuration file");
-    port_ = portIt->get<int>();
+    config.port = portIt->get<int>();
 
     auto pathIt = configure.find(CONFIG_INTERNAL_PATH_FILED);
     STREAM_CHECK((pathIt != configure.end() && pathIt->is_string()),
                  "Port must be string, please check your http_push element "
                  "configuration file");
-    path_ = pathIt->get<std::string>();
+    config.path = pathIt->get<std::string>();
+
+    auto formatIt = configure.find(CONFIG_INTERNAL_FORMAT_FILED);
+    if (formatIt != configure.end()) {
+      STREAM_CHECK(formatIt->is_string() &&
+                       common::parseSerializeFormat(
+                           formatIt->get<std::string>(), format_),
+                   "Format must be \"json\" or \"binary\", please check your "
+                   "http_push element configuration file");
+    }
 #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
     auto schemeIt = configure.find(CONFIG_INTERNAL_SCHEME_FILED);
     if (schemeIt == configure.end()) {
-        scheme_ = "http";
+        config.scheme = "http";
     } else {
-	scheme_ = schemeIt->get<std::string>();  // 获取值
-        STREAM_CHECK((scheme_ == "http" || scheme_ == "https"),
+	config.scheme = schemeIt->get<std::string>();  // 获取值
+        STREAM_CHECK((config.scheme == "http" || config.scheme == "https"),
                      "Scheme must be http or https, please check your http_push element "
                      "configuration file");
     }
 
     auto certIt = configure.find(CONFIG_INTERNAL_CERT_FILED);
     if (certIt == configure.end()) {
-        cert_ = "";
+        config.cert = "";
     } else {
         STREAM_CHECK(certIt->is_string(),
                  "Cert path must be string, please check your http_push element "
                  "configuration file");
-        cert_ = certIt->get<std::string>();
+        config.cert = certIt->get<std::string>();
     }
 
     auto keyIt = configure.find(CONFIG_INTERNAL_KEY_FILED);
     if (keyIt == configure.end()) {
-        key_ = "";
+        config.key = "";
     } else {
         STREAM_CHECK(keyIt->is_string(),
                  "Key path must be string, please check your http_push element "
                  "configuration file");
-        key_ = keyIt->get<std::string>();
+        config.key = keyIt->get<std::string>();
     }
 
     auto cacertIt = configure.find(CONFIG_INTERNAL_CACERT_FILED);
     if (cacertIt == configure.end()) {
-        cacert_ = "";
+        config.cacert = "";
     } else {
         STREAM_CHECK(cacertIt->is_string(),
                  "CACERT path must be string, please check your http_push element "
                  "configuration file");
-        cacert_ = cacertIt->get<std::string>();
+        config.cacert = cacertIt->get<std::string>();
     }
 
     auto verifyIt = configure.find(CONFIG_INTERNAL_VERIFY_FILED);
     if (verifyIt == configure.end()) {
-        verify_ = false;
+        config.verify = false;
     } else {
-        verify_ = verifyIt->get<bool>();
+        config.verify = verifyIt->get<bool>();
     }
 #endif
 
-  } while (false);
-  return errorCode;
-}
-
-#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-HttpPushImpl_::HttpPushImpl_(std::string& scheme, std::string& ip, int port, std::string cert, std::string key,
-		std::string cacert_, bool verify_, std::string path_, int channel)
-    : cli(scheme + "://" + ip + ":" + std::to_string(port), cert, key), cacert(cacert_), verify(verify_), path(path_) {
-  cli.set_ca_cert_path(cacert);
-  cli.enable_server_certificate_verification(verify);
-  workThread = std::thread(&HttpPushImpl_::postFunc, this);
-  mFpsProfilerName = "http_push_" + std::to_string(channel) + "_fps";
-  mFpsProfiler.config(mFpsProfilerName, 100);
-}
-#else
-HttpPushImpl_::HttpPushImpl_(std::string& ip, int port, std::string path_,
-                             int channel)
-    : cli(ip, port), path(path_) {
-  workThread = std::thread(&HttpPushImpl_::postFunc, this);
-  mFpsProfilerName = "http_push_" + std::to_string(channel) + "_fps";
-  mFpsProfiler.config(mFpsProfilerName, 100);
-}
-#endif
+    auto readInt = [&](const char* name, int& value, int minValue) {
+      auto it = configure.find(name);
+      if (it == configure.end()) return;
+      STREAM_CHECK(it->is_number_integer() && it->get<int>() >= minValue,
+                   name, " must be integer not less than ",
+                   std::to_string(minValue),
+                   ", please check your http_push element configuration file");
+      value = it->get<int>();
+    };
+    readInt(CONFIG_INTERNAL_SENDERS_FILED, config.senders, 1);
+    readInt(CONFIG_INTERNAL_BATCH_SIZE_FILED, config.batchSize, 1);
+    readInt(CONFIG_INTERNAL_BATCH_TIMEOUT_MS_FILED, config.batchTimeoutMs, 0);
+    readInt(CONFIG_INTERNAL_QUEUE_LENGTH_FILED, config.queueLength, 1);
+    readInt(CONFIG_INTERNAL_MAX_RETRIES_FILED, config.maxRetries, 0);
+    readInt(CONFIG_INTERNAL_RETRY_INTERVAL_MS_FILED, config.retryIntervalMs,
+            0);
+    readInt(CONFIG_INTERNAL_TIMEOUT_MS_FILED, config.timeoutMs, 1);
 
-void HttpPushImpl_::release() {
-  isRunning = false;
-  workThread.join();
-}
+    auto gzipIt = configure.find(CONFIG_INTERNAL_GZIP_FILED);
+    if (gzipIt != configure.end()) {
+      STREAM_CHECK(gzipIt->is_boolean(),
+                   "Gzip must be bool, please check your http_push element "
+                   "configuration file");
+      config.gzip = gzipIt->get<bool>();
+      STREAM_CHECK(!config.gzip || PushSender::gzipSupported(),
+                   "http_push is built without zlib, gzip is not supported");
+    }
 
-void HttpPushImpl_::postFunc() {
-  while (isRunning) {
-    auto ptr = popQueue();
-    if (ptr == nullptr) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
-      continue;
+    auto spillDirIt = configure.find(CONFIG_INTERNAL_SPILL_DIR_FILED);
+    if (spillDirIt != configure.end()) {
+      STREAM_CHECK(spillDirIt->is_string(),
+                   "Spill dir must be string, please check your http_push "
+                   "element configuration file");
+      config.spillDir = spillDirIt->get<std::string>();
     }
-    mFpsProfiler.add(1);
-    cli.Post(path.c_str(), ptr->dump(), "application/json");
-  }
-}
+    int spillMaxMb = config.spillMaxBytes >> 20;
+    int spillSegmentMb = config.spillSegmentBytes >> 20;
+    readInt(CONFIG_INTERNAL_SPILL_MAX_MB_FILED, spillMaxMb, 1);
+    readInt(CONFIG_INTERNAL_SPILL_SEGMENT_MB_FILED, spillSegmentMb, 1);
+    readInt(CONFIG_INTERNAL_SPILL_REPLAY_RATE_FILED, config.spillReplayRate, 0);
+    config.spillMaxBytes = static_cast<std::uint64_t>(spillMaxMb) << 20;
+    config.spillSegmentBytes = static_cast<std::uint64_t>(spillSegmentMb) << 20;
 
-bool HttpPushImpl_::pushQueue(std::shared_ptr<nlohmann::json> j) {
-  int len = getQueueSize();
-  if (len >= maxQueueLen) return false;
-  {
-    std::lock_guard<std::mutex> lock(mtx);
-    objQueue.push(j);
-  }
-  return true;
+    mSender = std::make_unique<PushSender>(config);
+    STREAM_CHECK(config.spillDir.empty() || mSender->isSpillEnabled(),
+                 "Open spill dir ", config.spillDir,
+                 " fail, please check your http_push element configuration "
+                 "file");
+    mSender->start();
+  } while (false);
+  return errorCode;
 }
 
-std::shared_ptr<nlohmann::json> HttpPushImpl_::popQueue() {
-  std::lock_guard<std::mutex> lock(mtx);
-  std::shared_ptr<nlohmann::json> j = nullptr;
-  if (objQueue.empty()) return j;
-  j = objQueue.front();
-  objQueue.pop();
-  return j;
-}
+void HttpPush::onStart() {
+  auto& registry = common::MetricsRegistry::getInstance();
+  common::MetricLabels labels = getMetricLabels();
+  std::weak_ptr<PushStats> weakStats = mSender->getStats();
+  auto getter = [weakStats](std::atomic<std::uint64_t> PushStats::*field) {
+    return [weakStats, field](double& value) {
+      auto stats = weakStats.lock();
+      if (!stats) return false;
+      value = ((*stats).*field).load(std::memory_order_relaxed);
+      return true;
+    };
+  };
 
-size_t HttpPushImpl_::getQueueSize() {
-  int len = -1;
-  {
-    std::lock_guard<std::mutex> lock(mtx);
-    len = objQueue.size();
-  }
-  return len;
+  registry.addCounter("sophon_stream_http_push_sent_total",
+                      "Results delivered to the collector.", labels,
+                      getter(&PushStats::sentItems));
+  registry.addCounter("sophon_stream_http_push_requests_total",
+                      "Successful requests, each carrying up to batch_size "
+                      "results.",
+                      labels, getter(&PushStats::sentRequests));
+  common::MetricLabels queueLabels = labels;
+  queueLabels.emplace_back("reason", "queue_full");
+  registry.addCounter("sophon_stream_http_push_dropped_total",
+                      "Results dropped before delivery.", queueLabels,
+                      getter(&PushStats::droppedItems));
+  common::MetricLabels failLabels = labels;
+  failLabels.emplace_back("reason", "post_failed");
+  registry.addCounter("sophon_stream_http_push_dropped_total",
+                      "Results dropped before delivery.", failLabels,
+                      getter(&PushStats::failedItems));
+  registry.addCounter("sophon_stream_http_push_retries_total",
+                      "Requests retried after a failed post.", labels,
+                      getter(&PushStats::retries));
+  common::MetricLabels rawLabels = labels;
+  rawLabels.emplace_back("encoding", "identity");
+  registry.addCounter("sophon_stream_http_push_body_bytes_total",
+                      "Request body bytes before and after compression.",
+                      rawLabels, getter(&PushStats::rawBytes));
+  common::MetricLabels sentLabels = labels;
+  sentLabels.emplace_back("encoding", "sent");
+  registry.addCounter("sophon_stream_http_push_body_bytes_total",
+                      "Request body bytes before and after compression.",
+                      sentLabels, getter(&PushStats::sentBytes));
+
+  PushSender* sender = mSender.get();
+  registry.addGauge("sophon_stream_http_push_queue_depth",
+                    "Results waiting in the sender queues.", labels,
+                    [weakStats, sender](double& value) {
+                      if (weakStats.expired()) return false;
+                      value = sender->getQueueSize();
+                      return true;
+                    });
+
+  if (!mSender->isSpillEnabled()) return;
+  registry.addCounter("sophon_stream_http_push_spilled_total",
+                      "Results written to the disk spill queue.", labels,
+                      getter(&PushStats::spilledItems));
+  registry.addCounter("sophon_stream_http_push_replayed_total",
+                      "Results replayed from the disk spill queue.", labels,
+                      getter(&PushStats::replayedItems));
+  auto senderGetter = [weakStats, sender](std::uint64_t (PushSender::*field)()) {
+    return [weakStats, sender, field](double& value) {
+      if (weakStats.expired()) return false;
+      value = (sender->*field)();
+      return true;
+    };
+  };
+  common::MetricLabels spillLabels = labels;
+  spillLabels.emplace_back("reason", "spill_full");
+  registry.addCounter("sophon_stream_http_push_dropped_total",
+                      "Results dropped before delivery.", spillLabels,
+                      senderGetter(&PushSender::getSpillDropped));
+  registry.addGauge("sophon_stream_http_push_spill_depth",
+                    "Results waiting in the disk spill queues.", labels,
+                    senderGetter(&PushSender::getSpillSize));
+  registry.addGauge("sophon_stream_http_push_spill_bytes",
+                    "Disk space used by the spill segments.", labels,
+                    senderGetter(&PushSender::getSpillBytes));
 }
 
 common::ErrorCode HttpPush::doWork(int dataPipeId) {
@@ -175,35 +248,29 @@ common::ErrorCode HttpPush::doWork(int dataPipeId) {
     outputPort = outputPorts[0];
   }
 
-  auto data = popInputData(inputPort, dataPipeId);
-  while (!data && (getThreadStatus() == ThreadStatus::RUN)) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    data = popInputData(inputPort, dataPipeId);
+  auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+  while (!data && shouldWaitInputData()) {
+    data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
   }
   if (data == nullptr) return common::ErrorCode::SUCCESS;
 
   auto objectMetadata = std::static_pointer_cast<common::ObjectMetadata>(data);
 
   if (!objectMetadata->mFrame->mEndOfStream) {
-    nlohmann::json serializedObj = objectMetadata;
-
-    int channel_id = objectMetadata->mFrame->mChannelId;
-    auto implIt = mapImpl_.find(channel_id);
-    if (implIt == mapImpl_.end()) {
-      std::lock_guard<std::mutex> lock(mapMtx);
-#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-      auto httpImpl = std::make_shared<HttpPushImpl_>(scheme_, ip_, port_, cert_, key_,
-		      cacert_, verify_, path_, channel_id);
-#else
-      auto httpImpl =
-          std::make_shared<HttpPushImpl_>(ip_, port_, path_, channel_id);
-#endif
-      mapImpl_[channel_id] = httpImpl;
-      mapImpl_[channel_id]->pushQueue(
-          std::make_shared<nlohmann::json>(serializedObj));
-    } else
-      implIt->second->pushQueue(
-          std::make_shared<nlohmann::json>(serializedObj));
+    auto payload = mSender->acquirePayload();
+    if (format_ == common::SerializeFormat::BINARY) {
+      common::serializeBinary(
+          payload->writer, *objectMetadata,
+          [](const common::Frame& frame, std::string& out) {
+            return common::frame_to_jpeg(frame, out);
+          });
+      payload->contentType = common::BINARY_CONTENT_TYPE;
+    } else {
+      nlohmann::json serializedObj = objectMetadata;
+      payload->writer.buffer() = serializedObj.dump();
+      payload->contentType = common::JSON_CONTENT_TYPE;
+    }
+    mSender->push(objectMetadata->mFrame->mChannelId, std::move(payload));
   }
 
   int channel_id_internal = objectMetadata->mFrame->mChannelIdInternal;
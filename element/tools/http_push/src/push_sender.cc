@@ -0,0 +1,403 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "push_sender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef HTTP_PUSH_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+#include "common/logger.h"
+
+namespace sophon_stream {
+namespace element {
+namespace http_push {
+
+PushSender::PushSender(const PushSenderConfig& config)
+    : mConfig(config), mStats(std::make_shared<PushStats>()) {
+  int senders = std::max(mConfig.senders, 1);
+  for (int i = 0; i < senders; ++i) {
+    auto worker = std::make_unique<Worker>();
+    worker->client = makeClient();
+    worker->fpsProfilerName = "http_push_sender_" + std::to_string(i) + "_fps";
+    worker->fpsProfiler.config(worker->fpsProfilerName, 100);
+    if (!mConfig.spillDir.empty()) {
+      common::SpillQueueConfig spillConfig;
+      spillConfig.dir = mConfig.spillDir + "/sender_" + std::to_string(i);
+      spillConfig.maxBytes = mConfig.spillMaxBytes / senders;
+      spillConfig.segmentBytes = mConfig.spillSegmentBytes;
+      worker->spill = std::make_unique<common::SpillQueue>(spillConfig);
+      if (!worker->spill->open()) mSpillFailed = true;
+    }
+    mWorkers.push_back(std::move(worker));
+  }
+}
+
+PushSender::~PushSender() { stop(); }
+
+std::unique_ptr<httplib::Client> PushSender::makeClient() const {
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+  auto client = std::make_unique<httplib::Client>(
+      mConfig.scheme + "://" + mConfig.ip + ":" + std::to_string(mConfig.port),
+      mConfig.cert, mConfig.key);
+  client->set_ca_cert_path(mConfig.cacert);
+  client->enable_server_certificate_verification(mConfig.verify);
+#else
+  auto client = std::make_unique<httplib::Client>(mConfig.ip, mConfig.port);
+#endif
+  client->set_keep_alive(true);
+  // 请求头和请求体分两次写入，keep-alive连接上不关闭Nagle会等待对端的延迟ACK
+  client->set_tcp_nodelay(true);
+  time_t sec = mConfig.timeoutMs / 1000;
+  time_t usec = (mConfig.timeoutMs % 1000) * 1000;
+  client->set_connection_timeout(sec, usec);
+  client->set_read_timeout(sec, usec);
+  client->set_write_timeout(sec, usec);
+  return client;
+}
+
+void PushSender::start() {
+  if (mRunning.exchange(true)) return;
+  for (auto& worker : mWorkers) {
+    worker->thread = std::thread(&PushSender::workFunc, this, std::ref(*worker));
+  }
+}
+
+void PushSender::stop() {
+  if (!mRunning.exchange(false)) return;
+  for (auto& worker : mWorkers) {
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+    }
+    worker->cond.notify_all();
+  }
+  for (auto& worker : mWorkers) {
+    if (worker->thread.joinable()) worker->thread.join();
+  }
+}
+
+std::unique_ptr<PushPayload> PushSender::acquirePayload() {
+  {
+    std::lock_guard<std::mutex> lock(mIdleMutex);
+    if (!mIdlePayloads.empty()) {
+      auto payload = std::move(mIdlePayloads.back());
+      mIdlePayloads.pop_back();
+      return payload;
+    }
+  }
+  return std::make_unique<PushPayload>();
+}
+
+void PushSender::recyclePayload(std::unique_ptr<PushPayload> payload) {
+  payload->writer.clear();
+  std::lock_guard<std::mutex> lock(mIdleMutex);
+  // 所有队列中的结果，加上每个线程正在发送的一批
+  size_t maxIdle = mWorkers.size() * (mConfig.queueLength + mConfig.batchSize);
+  if (mIdlePayloads.size() < maxIdle)
+    mIdlePayloads.push_back(std::move(payload));
+}
+
+bool PushSender::push(int channelId, std::unique_ptr<PushPayload> payload) {
+  Worker& worker = *mWorkers[static_cast<unsigned>(channelId) % mWorkers.size()];
+  bool accepted = true;
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    // 磁盘队列中还有结果时，新结果排在它们后面，保证同一路按顺序发送
+    if (!hasSpill(worker) &&
+        static_cast<int>(worker.queue.size()) < mConfig.queueLength) {
+      worker.queue.push_back(std::move(payload));
+    } else if (worker.spill != nullptr) {
+      accepted = worker.spill->append(payload->contentType,
+                                      payload->writer.buffer().data(),
+                                      payload->writer.buffer().size());
+      if (accepted)
+        mStats->spilledItems.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      accepted = false;
+      mStats->droppedItems.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (payload != nullptr) recyclePayload(std::move(payload));
+  if (accepted) worker.cond.notify_one();
+  return accepted;
+}
+
+bool PushSender::hasSpill(Worker& worker) const {
+  return worker.spill != nullptr && !worker.spill->empty();
+}
+
+bool PushSender::isSpillEnabled() const {
+  return !mConfig.spillDir.empty() && !mSpillFailed;
+}
+
+std::uint64_t PushSender::getSpillSize() {
+  std::uint64_t size = 0;
+  for (auto& worker : mWorkers) {
+    if (worker->spill) size += worker->spill->getPendingCount();
+  }
+  return size;
+}
+
+std::uint64_t PushSender::getSpillBytes() {
+  std::uint64_t bytes = 0;
+  for (auto& worker : mWorkers) {
+    if (worker->spill) bytes += worker->spill->getDiskBytes();
+  }
+  return bytes;
+}
+
+std::uint64_t PushSender::getSpillDropped() {
+  std::uint64_t dropped = 0;
+  for (auto& worker : mWorkers) {
+    if (worker->spill) dropped += worker->spill->getDroppedCount();
+  }
+  return dropped;
+}
+
+size_t PushSender::getQueueSize() {
+  size_t size = 0;
+  for (auto& worker : mWorkers) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    size += worker->queue.size();
+  }
+  return size;
+}
+
+bool PushSender::popBatch(Worker& worker,
+                          std::vector<std::unique_ptr<PushPayload>>& batch,
+                          bool& fromSpill) {
+  std::unique_lock<std::mutex> lock(worker.mutex);
+  worker.cond.wait(lock, [&] {
+    return !worker.queue.empty() || hasSpill(worker) || !mRunning;
+  });
+  fromSpill = worker.queue.empty();
+  if (fromSpill) {
+    // 停止时磁盘中的结果留到下次启动再发送
+    if (!mRunning) return false;
+    lock.unlock();
+    // 只有本线程读取和确认磁盘队列，peek到的记录不会被其它线程改动
+    size_t count = worker.spill->peek(worker.records, mConfig.batchSize);
+    for (size_t i = 0; i < count; ++i) {
+      common::SpillRecord& record = worker.records[i];
+      const char* contentType =
+          record.contentType == common::BINARY_CONTENT_TYPE
+              ? common::BINARY_CONTENT_TYPE
+              : common::JSON_CONTENT_TYPE;
+      if (i > 0 && contentType != batch[0]->contentType) break;
+      auto payload = acquirePayload();
+      payload->writer.buffer().swap(record.body);
+      payload->contentType = contentType;
+      batch.push_back(std::move(payload));
+    }
+    return true;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(mConfig.batchTimeoutMs);
+  const char* contentType = worker.queue.front()->contentType;
+  while (static_cast<int>(batch.size()) < mConfig.batchSize) {
+    if (!worker.queue.empty()) {
+      // 不同格式的结果不能合并到一个请求中
+      if (std::strcmp(worker.queue.front()->contentType, contentType) != 0)
+        break;
+      batch.push_back(std::move(worker.queue.front()));
+      worker.queue.pop_front();
+      continue;
+    }
+    if (mConfig.batchTimeoutMs <= 0 || !mRunning) break;
+    if (!worker.cond.wait_until(lock, deadline, [&] {
+          return !worker.queue.empty() || !mRunning;
+        }))
+      break;
+  }
+  return true;
+}
+
+void PushSender::makeBody(
+    const std::vector<std::unique_ptr<PushPayload>>& batch,
+    std::string& body) const {
+  body.clear();
+  if (mConfig.batchSize <= 1) {
+    body = batch[0]->writer.buffer();
+    return;
+  }
+  bool isJson = std::strcmp(batch[0]->contentType, common::JSON_CONTENT_TYPE) == 0;
+  size_t size = 2;
+  for (auto& payload : batch) size += payload->writer.buffer().size() + 1;
+  body.reserve(size);
+  if (isJson) body += '[';
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (isJson && i > 0) body += ',';
+    body += batch[i]->writer.buffer();
+  }
+  if (isJson) body += ']';
+}
+
+bool PushSender::post(Worker& worker, const std::string& body,
+                      const char* contentType, bool gzipped) {
+  httplib::Headers headers;
+  if (gzipped) headers.emplace("Content-Encoding", "gzip");
+  for (int attempt = 0;; ++attempt) {
+    auto res = worker.client->Post(mConfig.path.c_str(), headers, body.data(),
+                                   body.size(), contentType);
+    if (res && res->status >= 200 && res->status < 300) return true;
+    if (attempt >= mConfig.maxRetries || !mRunning) {
+      if (res) {
+        IVS_WARN("http_push post fail, path: {0}, status: {1}", mConfig.path,
+                 res->status);
+      } else {
+        IVS_WARN("http_push post fail, path: {0}, error: {1}", mConfig.path,
+                 httplib::to_string(res.error()));
+      }
+      return false;
+    }
+    mStats->retries.fetch_add(1, std::memory_order_relaxed);
+    // 停止时不再等待重试间隔
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.cond.wait_for(lock,
+                         std::chrono::milliseconds(mConfig.retryIntervalMs),
+                         [&] { return !mRunning; });
+  }
+}
+
+void PushSender::waitUntil(Worker& worker,
+                           std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(worker.mutex);
+  worker.cond.wait_until(lock, deadline, [&] { return !mRunning; });
+}
+
+void PushSender::spillLocked(Worker& worker,
+                             std::vector<std::unique_ptr<PushPayload>>& batch) {
+  auto append = [&](const PushPayload& payload) {
+    if (worker.spill->append(payload.contentType,
+                             payload.writer.buffer().data(),
+                             payload.writer.buffer().size()))
+      mStats->spilledItems.fetch_add(1, std::memory_order_relaxed);
+  };
+  for (auto& payload : batch) append(*payload);
+  while (!worker.queue.empty()) {
+    append(*worker.queue.front());
+    recyclePayload(std::move(worker.queue.front()));
+    worker.queue.pop_front();
+  }
+}
+
+void PushSender::workFunc(Worker& worker) {
+  using Clock = std::chrono::steady_clock;
+  std::vector<std::unique_ptr<PushPayload>> batch;
+  std::string body, compressed;
+  int backoffMs = std::max(mConfig.retryIntervalMs, 1);
+  Clock::time_point nextReplay = Clock::now();
+  auto backoff = [&]() {
+    waitUntil(worker, Clock::now() + std::chrono::milliseconds(backoffMs));
+    backoffMs = std::min(backoffMs * 2, MAX_BACKOFF_MS);
+  };
+  while (true) {
+    batch.clear();
+    bool fromSpill = false;
+    if (!popBatch(worker, batch, fromSpill)) break;
+    // 读取前磁盘队列中的记录可能已因超过上限被删除
+    if (batch.empty()) continue;
+
+    if (fromSpill && mConfig.spillReplayRate > 0) {
+      // 按速率上限推迟下一批，避免上报端恢复后被积压的结果压垮
+      Clock::time_point now = Clock::now();
+      if (nextReplay > now) waitUntil(worker, nextReplay);
+      nextReplay = std::max(now, nextReplay) +
+                   std::chrono::microseconds(batch.size() * 1000000 /
+                                             mConfig.spillReplayRate);
+    }
+
+    makeBody(batch, body);
+    mStats->rawBytes.fetch_add(body.size(), std::memory_order_relaxed);
+    // 压缩一次，重试时复用
+    bool gzipped = mConfig.gzip && gzipCompress(body, compressed);
+    const std::string& content = gzipped ? compressed : body;
+    const char* contentType = batch[0]->contentType;
+
+    bool sent = (!fromSpill || mRunning) &&
+                post(worker, content, contentType, gzipped);
+    bool spilled = false;
+    while (!sent && !fromSpill && worker.spill != nullptr) {
+      std::unique_lock<std::mutex> lock(worker.mutex);
+      // 磁盘队列为空时，这批和内存队列中的结果依次写入磁盘，顺序不变。
+      // 停止时不再等待，结果同样写入磁盘，下次启动后发送
+      if (!hasSpill(worker) || !mRunning) {
+        spillLocked(worker, batch);
+        spilled = true;
+        break;
+      }
+      lock.unlock();
+      // 磁盘队列中是这批发出之后才到达的结果，这批只能留在内存中退避重试
+      backoff();
+      sent = post(worker, content, contentType, gzipped);
+    }
+
+    if (sent) {
+      mStats->sentItems.fetch_add(batch.size(), std::memory_order_relaxed);
+      mStats->sentRequests.fetch_add(1, std::memory_order_relaxed);
+      mStats->sentBytes.fetch_add(content.size(), std::memory_order_relaxed);
+      worker.fpsProfiler.add(batch.size());
+      if (fromSpill) {
+        worker.spill->ack(batch.size());
+        mStats->replayedItems.fetch_add(batch.size(),
+                                        std::memory_order_relaxed);
+      }
+      backoffMs = std::max(mConfig.retryIntervalMs, 1);
+    } else if (fromSpill) {
+      // 未确认的结果留在磁盘队列头部，退避后重放
+      backoff();
+    } else if (!spilled) {
+      mStats->failedItems.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+    for (auto& payload : batch) recyclePayload(std::move(payload));
+  }
+  worker.client->stop();
+}
+
+bool PushSender::gzipSupported() {
+#ifdef HTTP_PUSH_ZLIB_SUPPORT
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool PushSender::gzipCompress(const std::string& input, std::string& output) {
+#ifdef HTTP_PUSH_ZLIB_SUPPORT
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  // windowBits 15 + 16 输出gzip格式；结果数据实时发送，用最快的压缩级别
+  if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  output.resize(deflateBound(&stream, input.size()));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  stream.avail_out = static_cast<uInt>(output.size());
+  int ret = deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  return ret == Z_STREAM_END;
+#else
+  (void)input;
+  (void)output;
+  return false;
+#endif
+}
+
+}  // namespace http_push
+}  // namespace element
+}  // namespace sophon_stream
@@ -104,11 +104,18 @@ common::ErrorCode Stitch::doWork(int dataPipeId) {
 
   common::ObjectMetadatas inputs;
 
+  // 不能阻塞等待时，所有inputPort都有数据再开始取，避免取出一半的数据被丢弃
+  if (!shouldWaitInputData()) {
+    for (auto inputPort : inputPorts) {
+      if (!hasInputData(inputPort, dataPipeId))
+        return common::ErrorCode::SUCCESS;
+    }
+  }
+
   for (auto inputPort : inputPorts) {
-    auto data = popInputData(inputPort, dataPipeId);
-    while (!data && (getThreadStatus() == ThreadStatus::RUN)) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      data = popInputData(inputPort, dataPipeId);
+    auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+    while (!data && shouldWaitInputData()) {
+      data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
     }
     if (data == nullptr) return common::ErrorCode::SUCCESS;
 
@@ -0,0 +1,381 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "base64.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STREAM_BASE64_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STREAM_BASE64_NEON 1
+#endif
+
+namespace sophon_stream {
+namespace common {
+
+namespace {
+
+constexpr char ENCODE_TABLE[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr std::uint8_t INVALID = 0xff;
+
+struct DecodeTable {
+  std::uint8_t values[256];
+
+  constexpr DecodeTable() : values() {
+    for (int i = 0; i < 256; ++i) values[i] = INVALID;
+    for (int i = 0; i < 64; ++i)
+      values[static_cast<std::uint8_t>(ENCODE_TABLE[i])] =
+          static_cast<std::uint8_t>(i);
+  }
+};
+
+constexpr DecodeTable DECODE_TABLE;
+
+/**
+ * @brief SIMD内核只处理完整的块，返回已处理的输入长度，剩余部分由标量实现完成
+ */
+using EncodeKernel = std::size_t (*)(const std::uint8_t* src, std::size_t size,
+                                     char* dst);
+/**
+ * @brief 遇到非法字符或'='时提前返回，由标量实现判断是否是合法的结尾
+ */
+using DecodeKernel = std::size_t (*)(const char* src, std::size_t size,
+                                     std::uint8_t* dst);
+
+std::size_t encodeNone(const std::uint8_t*, std::size_t, char*) { return 0; }
+
+std::size_t decodeNone(const char*, std::size_t, std::uint8_t*) { return 0; }
+
+#if STREAM_BASE64_X86
+
+// 编码：每12字节重排为4个32位字，拆出4个6位索引，再按索引所在区间加上偏移得到字符
+// 解码：按高低4位查表校验字符并换算为6位值，再用乘加合并为3字节
+
+__attribute__((target("ssse3"))) inline __m128i encodeLookupSsse3(
+    __m128i indices) {
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+  __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+  const __m128i shift = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+__attribute__((target("ssse3"))) std::size_t encodeSsse3(
+    const std::uint8_t* src, std::size_t size, char* dst) {
+  std::size_t i = 0;
+  // 每次读取16字节，只使用前12字节
+  for (; size - i >= 16; i += 12, dst += 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    in = _mm_shuffle_epi8(
+        in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i out = encodeLookupSsse3(_mm_or_si128(t1, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+  }
+  return i;
+}
+
+__attribute__((target("ssse3"))) std::size_t decodeSsse3(const char* src,
+                                                         std::size_t size,
+                                                         std::uint8_t* dst) {
+  const __m128i lutLo =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i lutHi =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lutRoll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask2F = _mm_set1_epi8(0x2f);
+  std::size_t i = 0;
+  // 每次写入16字节，只有前12字节有效；剩余至少24个字符时dst的空间足够
+  for (; size - i >= 24; i += 16, dst += 12) {
+    __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+    __m128i loNibbles = _mm_and_si128(str, mask2F);
+    __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                         _mm_setzero_si128())) != 0)
+      break;
+    __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+    __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+    str = _mm_add_epi8(str, roll);
+    __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+    __m128i out = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    out = _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                              13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) std::size_t encodeAvx2(const std::uint8_t* src,
+                                                       std::size_t size,
+                                                       char* dst) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4,
+      7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i shift = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  std::size_t i = 0;
+  // 两个128位通道各处理12字节，高通道读到第28字节
+  for (; size - i >= 28; i += 24, dst += 32) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    in = _mm256_shuffle_epi8(in, shuffle);
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result =
+        _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    __m256i out =
+        _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) std::size_t decodeAvx2(const char* src,
+                                                       std::size_t size,
+                                                       std::uint8_t* dst) {
+  const __m256i lutLo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a,
+      0x1b, 0x1b, 0x1b, 0x1a, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lutHi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lutRoll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4,
+      -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4,
+      10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i mask2F = _mm256_set1_epi8(0x2f);
+  std::size_t i = 0;
+  // 每次写入32字节，只有前24字节有效；剩余至少48个字符时dst的空间足够
+  for (; size - i >= 48; i += 32, dst += 24) {
+    __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+    __m256i loNibbles = _mm256_and_si256(str, mask2F);
+    __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm256_testz_si256(lo, hi)) break;
+    __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+    __m256i roll =
+        _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+    str = _mm256_add_epi8(str, roll);
+    __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+    __m256i out = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    out = _mm256_shuffle_epi8(out, shuffle);
+    out = _mm256_permutevar8x32_epi32(out,
+                                      _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+  }
+  return i;
+}
+
+#endif  // STREAM_BASE64_X86
+
+#if STREAM_BASE64_NEON
+
+std::size_t encodeNeon(const std::uint8_t* src, std::size_t size, char* dst) {
+  const std::uint8_t* table = reinterpret_cast<const std::uint8_t*>(ENCODE_TABLE);
+  uint8x16x4_t lut = {vld1q_u8(table), vld1q_u8(table + 16),
+                      vld1q_u8(table + 32), vld1q_u8(table + 48)};
+  const uint8x16_t mask3F = vdupq_n_u8(0x3f);
+  std::size_t i = 0;
+  for (; size - i >= 48; i += 48, dst += 64) {
+    uint8x16x3_t in = vld3q_u8(src + i);
+    uint8x16x4_t indices;
+    indices.val[0] = vshrq_n_u8(in.val[0], 2);
+    indices.val[1] = vandq_u8(
+        vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask3F);
+    indices.val[2] = vandq_u8(
+        vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask3F);
+    indices.val[3] = vandq_u8(in.val[2], mask3F);
+    uint8x16x4_t out;
+    for (int k = 0; k < 4; ++k) out.val[k] = vqtbl4q_u8(lut, indices.val[k]);
+    vst4q_u8(reinterpret_cast<std::uint8_t*>(dst), out);
+  }
+  return i;
+}
+
+std::size_t decodeNeon(const char* src, std::size_t size, std::uint8_t* dst) {
+  const std::uint8_t* table = DECODE_TABLE.values;
+  uint8x16x4_t lutLo = {vld1q_u8(table), vld1q_u8(table + 16),
+                        vld1q_u8(table + 32), vld1q_u8(table + 48)};
+  uint8x16x4_t lutHi = {vld1q_u8(table + 64), vld1q_u8(table + 80),
+                        vld1q_u8(table + 96), vld1q_u8(table + 112)};
+  const uint8x16_t bit6 = vdupq_n_u8(0x40);
+  std::size_t i = 0;
+  for (; size - i >= 64; i += 64, dst += 48) {
+    uint8x16x4_t str =
+        vld4q_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+    uint8x16x4_t values;
+    uint8x16_t error = vdupq_n_u8(0);
+    for (int k = 0; k < 4; ++k) {
+      // 0..63查lutLo，64..127查lutHi，越界的查表结果为0
+      values.val[k] = vorrq_u8(vqtbl4q_u8(lutLo, str.val[k]),
+                               vqtbl4q_u8(lutHi, veorq_u8(str.val[k], bit6)));
+      // 非法字符在表中为0xff，128以上的字符本身最高位为1
+      error = vorrq_u8(error, vorrq_u8(values.val[k], str.val[k]));
+    }
+    if (vmaxvq_u8(error) >= 0x80) break;
+    uint8x16x3_t out;
+    out.val[0] =
+        vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+    out.val[1] =
+        vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+    vst3q_u8(dst, out);
+  }
+  return i;
+}
+
+#endif  // STREAM_BASE64_NEON
+
+struct Base64Impl {
+  const char* name;
+  EncodeKernel encode;
+  DecodeKernel decode;
+};
+
+Base64Impl selectImpl() {
+#if STREAM_BASE64_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return {"avx2", encodeAvx2, decodeAvx2};
+  if (__builtin_cpu_supports("ssse3"))
+    return {"ssse3", encodeSsse3, decodeSsse3};
+#elif STREAM_BASE64_NEON
+  return {"neon", encodeNeon, decodeNeon};
+#endif
+  return {"scalar", encodeNone, decodeNone};
+}
+
+const Base64Impl& getImpl() {
+  static const Base64Impl impl = selectImpl();
+  return impl;
+}
+
+}  // namespace
+
+void base64EncodeScalar(const void* src, std::size_t size, char* dst) {
+  const std::uint8_t* in = static_cast<const std::uint8_t*>(src);
+  std::size_t i = 0;
+  for (; i + 3 <= size; i += 3, dst += 4) {
+    std::uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    dst[0] = ENCODE_TABLE[(v >> 18) & 0x3f];
+    dst[1] = ENCODE_TABLE[(v >> 12) & 0x3f];
+    dst[2] = ENCODE_TABLE[(v >> 6) & 0x3f];
+    dst[3] = ENCODE_TABLE[v & 0x3f];
+  }
+  if (i < size) {
+    std::uint32_t v = in[i] << 16;
+    if (i + 1 < size) v |= in[i + 1] << 8;
+    dst[0] = ENCODE_TABLE[(v >> 18) & 0x3f];
+    dst[1] = ENCODE_TABLE[(v >> 12) & 0x3f];
+    dst[2] = i + 1 < size ? ENCODE_TABLE[(v >> 6) & 0x3f] : '=';
+    dst[3] = '=';
+  }
+}
+
+bool base64DecodeScalar(const char* src, std::size_t size, void* dst,
+                        std::size_t& decodedSize) {
+  decodedSize = 0;
+  if (size % 4 != 0) return false;
+  const std::uint8_t* in = reinterpret_cast<const std::uint8_t*>(src);
+  std::uint8_t* out = static_cast<std::uint8_t*>(dst);
+  for (std::size_t i = 0; i < size; i += 4) {
+    std::uint8_t a = DECODE_TABLE.values[in[i]];
+    std::uint8_t b = DECODE_TABLE.values[in[i + 1]];
+    std::uint8_t c = DECODE_TABLE.values[in[i + 2]];
+    std::uint8_t d = DECODE_TABLE.values[in[i + 3]];
+    if (((a | b | c | d) & 0xc0) == 0) {
+      *out++ = static_cast<std::uint8_t>((a << 2) | (b >> 4));
+      *out++ = static_cast<std::uint8_t>((b << 4) | (c >> 2));
+      *out++ = static_cast<std::uint8_t>((c << 6) | d);
+      continue;
+    }
+    // 只有最后一组允许"xx=="或"xxx="
+    if (i + 4 != size || a == INVALID || b == INVALID || '=' != in[i + 3])
+      return false;
+    *out++ = static_cast<std::uint8_t>((a << 2) | (b >> 4));
+    if ('=' == in[i + 2]) break;
+    if (c == INVALID) return false;
+    *out++ = static_cast<std::uint8_t>((b << 4) | (c >> 2));
+  }
+  decodedSize = out - static_cast<std::uint8_t*>(dst);
+  return true;
+}
+
+void base64Encode(const void* src, std::size_t size, char* dst) {
+  const std::uint8_t* in = static_cast<const std::uint8_t*>(src);
+  std::size_t done = getImpl().encode(in, size, dst);
+  base64EncodeScalar(in + done, size - done, dst + done / 3 * 4);
+}
+
+bool base64Decode(const char* src, std::size_t size, void* dst,
+                  std::size_t& decodedSize) {
+  decodedSize = 0;
+  if (size % 4 != 0) return false;
+  std::uint8_t* out = static_cast<std::uint8_t*>(dst);
+  std::size_t done = getImpl().decode(src, size, out);
+  std::size_t tailSize = 0;
+  if (!base64DecodeScalar(src + done, size - done, out + done / 4 * 3,
+                          tailSize))
+    return false;
+  decodedSize = done / 4 * 3 + tailSize;
+  return true;
+}
+
+void base64Encode(const void* src, std::size_t size, std::string& out) {
+  std::size_t offset = out.size();
+  out.resize(offset + base64EncodedSize(size));
+  base64Encode(src, size, &out[offset]);
+}
+
+bool base64Decode(const std::string& src, std::string& out) {
+  std::size_t offset = out.size();
+  std::size_t decodedSize = 0;
+  out.resize(offset + base64DecodedMaxSize(src.size()));
+  if (!base64Decode(src.data(), src.size(), &out[offset], decodedSize)) {
+    out.resize(offset);
+    return false;
+  }
+  out.resize(offset + decodedSize);
+  return true;
+}
+
+const char* base64Backend() { return getImpl().name; }
+
+}  // namespace common
+}  // namespace sophon_stream
@@ -0,0 +1,74 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_BASE64_H_
+#define SOPHON_STREAM_COMMON_BASE64_H_
+
+#include <cstddef>
+#include <string>
+
+namespace sophon_stream {
+namespace common {
+
+/**
+ * @brief 编码size字节后的base64长度，包含末尾的'='
+ */
+constexpr std::size_t base64EncodedSize(std::size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+/**
+ * @brief 解码size个字符最多得到的字节数，用于预先分配输出缓冲区
+ */
+constexpr std::size_t base64DecodedMaxSize(std::size_t size) {
+  return size / 4 * 3;
+}
+
+/**
+ * @brief 标准base64编码（RFC 4648，带'='补齐），根据CPU选择AVX2/SSSE3/NEON实现
+ * @param dst 至少base64EncodedSize(size)字节，不写入结尾的'\0'
+ */
+void base64Encode(const void* src, std::size_t size, char* dst);
+
+/**
+ * @brief base64解码，不接受空白字符和data URL头部
+ * @param dst 至少base64DecodedMaxSize(size)字节
+ * @param[out] decodedSize 解码得到的字节数
+ * @return 长度不是4的倍数或含有非法字符时返回false
+ */
+bool base64Decode(const char* src, std::size_t size, void* dst,
+                  std::size_t& decodedSize);
+
+/**
+ * @brief 编码并追加到out末尾
+ */
+void base64Encode(const void* src, std::size_t size, std::string& out);
+
+/**
+ * @brief 解码并追加到out末尾，失败时out保持不变
+ */
+bool base64Decode(const std::string& src, std::string& out);
+
+/**
+ * @brief 逐字节的标量实现，作为SIMD实现的参照
+ */
+void base64EncodeScalar(const void* src, std::size_t size, char* dst);
+
+bool base64DecodeScalar(const char* src, std::size_t size, void* dst,
+                        std::size_t& decodedSize);
+
+/**
+ * @brief 当前使用的实现："avx2"、"ssse3"、"neon"或"scalar"
+ */
+const char* base64Backend();
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_BASE64_H_
@@ -0,0 +1,327 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "binary_serialize.h"
+
+#include <algorithm>
+
+#include "common/base64.h"
+#include "common/object_metadata.h"
+
+namespace sophon_stream {
+namespace common {
+
+namespace {
+
+constexpr char BINARY_MAGIC[4] = {'S', 'S', 'T', 'B'};
+constexpr std::uint16_t BINARY_VERSION = 1;
+
+void putHeader(BinaryWriter& writer, BinaryMessageType type) {
+  writer.buffer().append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  writer.put<std::uint16_t>(BINARY_VERSION);
+  writer.put<std::uint16_t>(static_cast<std::uint16_t>(type));
+}
+
+template <typename T>
+void putCount(BinaryWriter& writer, const T& values) {
+  writer.put<std::uint32_t>(static_cast<std::uint32_t>(values.size()));
+}
+
+void putResult(BinaryWriter& writer, const ObjectMetadata& obj,
+               const JpegEncoder& encoder) {
+  const Frame* frame = obj.mFrame.get();
+  writer.put<std::int32_t>(frame ? frame->mChannelId : -1);
+  writer.put<std::int64_t>(frame ? frame->mFrameId : -1);
+  writer.put<std::int64_t>(frame ? frame->mTimestamp : 0);
+  writer.put<std::int32_t>(frame ? frame->mWidth : 0);
+  writer.put<std::int32_t>(frame ? frame->mHeight : 0);
+  writer.put<std::uint8_t>(frame && frame->mEndOfStream ? 1 : 0);
+  writer.put<float>(obj.fps);
+  writer.put<std::int32_t>(obj.mSubId);
+  writer.put<std::int32_t>(obj.mGraphId);
+
+  // JPEG直接编码到缓冲区末尾，之后回填长度
+  std::string& buffer = writer.buffer();
+  std::size_t lengthOffset = buffer.size();
+  writer.put<std::uint32_t>(0);
+  if (frame && encoder && !frame->mEndOfStream && frame->mSpData) {
+    std::size_t begin = buffer.size();
+    if (encoder(*frame, buffer)) {
+      std::uint32_t length = static_cast<std::uint32_t>(buffer.size() - begin);
+      std::memcpy(&buffer[lengthOffset], &length, sizeof(length));
+    } else {
+      buffer.resize(begin);
+    }
+  }
+
+  putCount(writer, obj.mDetectedObjectMetadatas);
+  for (auto& detObj : obj.mDetectedObjectMetadatas) {
+    writer.put<std::int32_t>(detObj->mBox.mX);
+    writer.put<std::int32_t>(detObj->mBox.mY);
+    writer.put<std::int32_t>(detObj->mBox.mWidth);
+    writer.put<std::int32_t>(detObj->mBox.mHeight);
+    writer.put<std::int32_t>(detObj->mClassify);
+    writer.putArray<float>(detObj->mScores);
+  }
+
+  putCount(writer, obj.mTrackedObjectMetadatas);
+  for (auto& trackObj : obj.mTrackedObjectMetadatas) {
+    writer.put<std::int64_t>(trackObj->mTrackId);
+  }
+
+  putCount(writer, obj.mPosedObjectMetadatas);
+  for (auto& poseObj : obj.mPosedObjectMetadatas) {
+    writer.putArray<float>(poseObj->keypoints);
+  }
+
+  putCount(writer, obj.mRecognizedObjectMetadatas);
+  for (auto& recogObj : obj.mRecognizedObjectMetadatas) {
+    writer.putString(recogObj->mLabelName);
+    writer.putArray<float>(recogObj->mScores);
+    writer.putArray<std::int32_t>(recogObj->mTopKLabels);
+    putCount(writer, recogObj->mTopKLabelNames);
+    for (auto& name : recogObj->mTopKLabelNames) writer.putString(name);
+  }
+
+  putCount(writer, obj.mFaceObjectMetadatas);
+  for (auto& faceObj : obj.mFaceObjectMetadatas) {
+    writer.put<std::int32_t>(faceObj->top);
+    writer.put<std::int32_t>(faceObj->bottom);
+    writer.put<std::int32_t>(faceObj->left);
+    writer.put<std::int32_t>(faceObj->right);
+    for (float x : faceObj->points_x) writer.put<float>(x);
+    for (float y : faceObj->points_y) writer.put<float>(y);
+    writer.put<float>(faceObj->score);
+  }
+
+  putCount(writer, obj.mSubObjectMetadatas);
+  for (auto& subObj : obj.mSubObjectMetadatas) {
+    putResult(writer, *subObj, encoder);
+  }
+}
+
+/**
+ * @brief 按格式顺序读取字段，越界后所有读取都失败
+ */
+class BinaryReader {
+ public:
+  BinaryReader(const void* data, std::size_t size)
+      : mData(static_cast<const char*>(data)), mSize(size) {}
+
+  template <typename T>
+  bool get(T& value) {
+    if (mSize - mOffset < sizeof(T)) return false;
+    std::memcpy(&value, mData + mOffset, sizeof(T));
+    mOffset += sizeof(T);
+    return true;
+  }
+
+  bool getRaw(const char*& data, std::size_t size) {
+    if (mSize - mOffset < size) return false;
+    data = mData + mOffset;
+    mOffset += size;
+    return true;
+  }
+
+  bool getString(std::string& value) {
+    std::uint16_t length = 0;
+    const char* data = nullptr;
+    if (!get(length) || !getRaw(data, length)) return false;
+    value.assign(data, length);
+    return true;
+  }
+
+  template <typename T>
+  bool getArray(nlohmann::json& j) {
+    std::uint32_t count = 0;
+    if (!get(count)) return false;
+    j = nlohmann::json::array();
+    for (std::uint32_t i = 0; i < count; ++i) {
+      T value;
+      if (!get(value)) return false;
+      j.push_back(value);
+    }
+    return true;
+  }
+
+ private:
+  const char* mData;
+  std::size_t mSize;
+  std::size_t mOffset = 0;
+};
+
+/**
+ * @brief 输出与serialize.h中to_json相同的字段名，空数组不输出
+ */
+bool readResult(BinaryReader& reader, nlohmann::json& j) {
+  std::int32_t channelId, width, height, subId, graphId;
+  std::int64_t frameId, timestamp;
+  std::uint8_t endOfStream;
+  float fps;
+  std::uint32_t jpegSize;
+  const char* jpeg = nullptr;
+  if (!reader.get(channelId) || !reader.get(frameId) ||
+      !reader.get(timestamp) || !reader.get(width) || !reader.get(height) ||
+      !reader.get(endOfStream) || !reader.get(fps) || !reader.get(subId) ||
+      !reader.get(graphId) || !reader.get(jpegSize) ||
+      !reader.getRaw(jpeg, jpegSize)) {
+    return false;
+  }
+
+  std::uint32_t count = 0;
+  if (!reader.get(count)) return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    nlohmann::json det;
+    std::int32_t x, y, w, h, classify;
+    if (!reader.get(x) || !reader.get(y) || !reader.get(w) ||
+        !reader.get(h) || !reader.get(classify) ||
+        !reader.getArray<float>(det["mScores"])) {
+      return false;
+    }
+    det["mBox"] = {{"mX", x}, {"mY", y}, {"mWidth", w}, {"mHeight", h}};
+    det["mClassify"] = classify;
+    j["mDetectedObjectMetadatas"].push_back(std::move(det));
+  }
+
+  if (!reader.get(count)) return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::int64_t trackId;
+    if (!reader.get(trackId)) return false;
+    j["mTrackedObjectMetadatas"].push_back({{"mTrackId", trackId}});
+  }
+
+  if (!reader.get(count)) return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    nlohmann::json pose;
+    if (!reader.getArray<float>(pose["keypoints"])) return false;
+    j["mPosedObjectMetadatas"].push_back(std::move(pose));
+  }
+
+  if (!reader.get(count)) return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    nlohmann::json recog;
+    std::string labelName;
+    if (!reader.getString(labelName) ||
+        !reader.getArray<float>(recog["mScores"]) ||
+        !reader.getArray<std::int32_t>(recog["mTopKLabels"])) {
+      return false;
+    }
+    recog["mLabelName"] = labelName;
+    recog["mTopKLabelNames"] = nlohmann::json::array();
+    std::uint32_t nameCount = 0;
+    if (!reader.get(nameCount)) return false;
+    for (std::uint32_t k = 0; k < nameCount; ++k) {
+      std::string name;
+      if (!reader.getString(name)) return false;
+      recog["mTopKLabelNames"].push_back(std::move(name));
+    }
+    j["mRecognizedObjectMetadatas"].push_back(std::move(recog));
+  }
+
+  if (!reader.get(count)) return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::int32_t top, bottom, left, right;
+    float pointsX[5], pointsY[5], score;
+    if (!reader.get(top) || !reader.get(bottom) || !reader.get(left) ||
+        !reader.get(right)) {
+      return false;
+    }
+    for (float& x : pointsX) {
+      if (!reader.get(x)) return false;
+    }
+    for (float& y : pointsY) {
+      if (!reader.get(y)) return false;
+    }
+    if (!reader.get(score)) return false;
+    j["mFaceObjectMetadata"].push_back({{"top", top},
+                                        {"bottom", bottom},
+                                        {"left", left},
+                                        {"right", right},
+                                        {"points_x", pointsX},
+                                        {"points_y", pointsY},
+                                        {"score", score}});
+  }
+
+  std::string spData;
+  base64Encode(jpeg, jpegSize, spData);
+  j["mFps"] = fps;
+  j["mFrame"] = {{"mChannelId", channelId},     {"mFrameId", frameId},
+                 {"mTimestamp", timestamp},     {"mWidth", width},
+                 {"mHeight", height},           {"mEndOfStream", endOfStream != 0},
+                 {"mSpData", std::move(spData)}};
+  j["mSubId"] = subId;
+  j["mGraphId"] = graphId;
+
+  if (!reader.get(count)) return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    nlohmann::json subJ;
+    if (!readResult(reader, subJ)) return false;
+    j["mSubObjectMetadatas"].push_back(std::move(subJ));
+  }
+  return true;
+}
+
+}  // namespace
+
+void BinaryWriter::putString(const std::string& value) {
+  std::uint16_t length =
+      static_cast<std::uint16_t>(std::min<std::size_t>(value.size(), 0xffff));
+  put<std::uint16_t>(length);
+  mBuffer.append(value.data(), length);
+}
+
+bool parseSerializeFormat(const std::string& name, SerializeFormat& format) {
+  if ("json" == name) {
+    format = SerializeFormat::JSON;
+    return true;
+  }
+  if ("binary" == name) {
+    format = SerializeFormat::BINARY;
+    return true;
+  }
+  return false;
+}
+
+void serializeBinary(BinaryWriter& writer, const ObjectMetadata& obj,
+                     const JpegEncoder& encoder) {
+  putHeader(writer, BinaryMessageType::RESULT);
+  putResult(writer, obj, encoder);
+}
+
+void serializeBinaryStatus(BinaryWriter& writer, const std::string& error) {
+  putHeader(writer, BinaryMessageType::STATUS);
+  writer.putString(error);
+}
+
+bool binaryToJson(const void* data, std::size_t size, nlohmann::json& j) {
+  BinaryReader reader(data, size);
+  const char* magic = nullptr;
+  std::uint16_t version = 0, type = 0;
+  if (!reader.getRaw(magic, sizeof(BINARY_MAGIC)) ||
+      0 != std::memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) ||
+      !reader.get(version) || BINARY_VERSION != version || !reader.get(type)) {
+    return false;
+  }
+  j = nlohmann::json::object();
+  switch (static_cast<BinaryMessageType>(type)) {
+    case BinaryMessageType::RESULT:
+      return readResult(reader, j);
+    case BinaryMessageType::STATUS: {
+      std::string error;
+      if (!reader.getString(error)) return false;
+      j["error"] = error;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+}  // namespace common
+}  // namespace sophon_stream
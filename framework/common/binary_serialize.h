@@ -0,0 +1,141 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_BINARY_SERIALIZE_H_
+#define SOPHON_STREAM_COMMON_BINARY_SERIALIZE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#include "nlohmann/json.hpp"
+
+namespace sophon_stream {
+namespace common {
+
+struct ObjectMetadata;
+struct Frame;
+
+/*
+ * ObjectMetadata结果的二进制格式，作为serialize.h中JSON格式的替代
+ * 所有整数和浮点数均为小端序，字符串和数组以长度前缀开头，不做任何对齐：
+ * message   := magic "SSTB" | u16 version(=1) | u16 type | body
+ * type 1    := result
+ * result    := i32 channel_id | i64 frame_id | i64 timestamp | i32 width |
+ *              i32 height | u8 end_of_stream | f32 fps | i32 sub_id |
+ *              i32 graph_id | bytes jpeg |
+ *              u32 n, detected[n] | u32 n, tracked[n] | u32 n, posed[n] |
+ *              u32 n, recognized[n] | u32 n, face[n] | u32 n, result[n]
+ * detected  := i32 x | i32 y | i32 width | i32 height | i32 classify |
+ *              floats scores
+ * tracked   := i64 track_id
+ * posed     := floats keypoints
+ * recognized:= str label_name | floats scores | ints top_k_labels |
+ *              strs top_k_label_names
+ * face      := i32 top | i32 bottom | i32 left | i32 right |
+ *              f32 points_x[5] | f32 points_y[5] | f32 score
+ * type 2    := status: str error
+ * bytes     := u32 len | u8[len]，jpeg为原始JPEG数据，不做base64编码，len为0表示没有图像
+ * str       := u16 len | char[len]
+ * floats    := u32 n | f32[n]
+ * ints      := u32 n | i32[n]
+ * strs      := u32 n | str[n]
+ * 末尾的result[n]为mSubObjectMetadatas，递归使用同样的格式（不含消息头）
+ */
+
+/**
+ * @brief 向缓冲区追加二进制字段，clear()后缓冲区的容量保留，可以逐帧复用
+ */
+class BinaryWriter {
+ public:
+  /**
+   * @brief 清空内容，保留已分配的容量，用于复用同一个缓冲区
+   */
+  void clear() { mBuffer.clear(); }
+
+  void reserve(std::size_t size) { mBuffer.reserve(size); }
+
+  const std::string& buffer() const { return mBuffer; }
+  std::string& buffer() { return mBuffer; }
+
+  template <typename T>
+  void put(T value) {
+    static_assert(std::is_arithmetic<T>::value, "arithmetic type required");
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    mBuffer.append(bytes, sizeof(T));
+  }
+
+  void putBytes(const void* data, std::size_t size) {
+    put<std::uint32_t>(static_cast<std::uint32_t>(size));
+    if (size > 0) mBuffer.append(static_cast<const char*>(data), size);
+  }
+
+  void putString(const std::string& value);
+
+  template <typename T, typename Container>
+  void putArray(const Container& values) {
+    put<std::uint32_t>(static_cast<std::uint32_t>(values.size()));
+    for (auto value : values) put<T>(static_cast<T>(value));
+  }
+
+ private:
+  std::string mBuffer;
+};
+
+static_assert(sizeof(float) == 4, "binary format requires 32-bit float");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "BinaryWriter writes fields in host byte order");
+
+constexpr const char* BINARY_CONTENT_TYPE = "application/x-sophon-stream";
+constexpr const char* JSON_CONTENT_TYPE = "application/json";
+
+enum class BinaryMessageType : std::uint16_t { RESULT = 1, STATUS = 2 };
+
+/**
+ * @brief 结果的输出格式，由http_push和http_report的"format"字段选择
+ */
+enum class SerializeFormat { JSON, BINARY };
+
+/**
+ * @brief 解析"format"字段，"json"或"binary"
+ * @return 无法识别时返回false
+ */
+bool parseSerializeFormat(const std::string& name, SerializeFormat& format);
+
+/**
+ * @brief 将帧编码为JPEG并追加到out末尾，返回false表示不输出图像
+ */
+using JpegEncoder = std::function<bool(const Frame& frame, std::string& out)>;
+
+/**
+ * @brief 写入一条result消息，writer原有内容保留，调用者需要时先clear()
+ * @param encoder 为空时不输出图像；mSubObjectMetadatas中的帧同样使用encoder编码
+ */
+void serializeBinary(BinaryWriter& writer, const ObjectMetadata& obj,
+                     const JpegEncoder& encoder);
+
+/**
+ * @brief 写入一条status消息
+ */
+void serializeBinaryStatus(BinaryWriter& writer, const std::string& error);
+
+/**
+ * @brief 将二进制消息还原为与serialize.h相同结构的JSON，图像以base64字符串给出
+ * @return 数据不完整或格式不正确时返回false
+ */
+bool binaryToJson(const void* data, std::size_t size, nlohmann::json& j);
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_BINARY_SERIALIZE_H_
@@ -45,6 +45,22 @@ struct PointMetadata {
 struct DetectedObjectMetadata {
   DetectedObjectMetadata() : mClassify(-1), mTrackIouThreshold(0.f) {}
 
+  /**
+   * @brief 恢复到刚构造时的状态，由ObjectPool回收时调用，vector保留容量
+   */
+  void reset() {
+    mBox = common::Rectangle<int>();
+    mCroppedBox = common::Rectangle<int>();
+    mItemName.clear();
+    mLabelName.clear();
+    mScores.clear();
+    mTopKLabels.clear();
+    mClassify = -1;
+    mClassifyName.clear();
+    mTrackIouThreshold = 0.f;
+    mKeyPoints.clear();
+  }
+
   int getLabel() const {
     if (mTopKLabels.empty()) {
       return -1;
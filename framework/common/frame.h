@@ -46,6 +46,11 @@ struct Frame {
         mHeightStep(0),
         mDataSize(0) {}
 
+  /**
+   * @brief 恢复到刚构造时的状态，由ObjectPool回收时调用
+   */
+  void reset() { *this = Frame(); }
+
   bool empty() const {
     return 0 == mChannel || 0 == mChannelStep || 0 == mWidth ||
            0 == mWidthStep || 0 == mHeight || 0 == mHeightStep ||
@@ -0,0 +1,179 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "frame_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace sophon_stream {
+namespace common {
+
+std::int64_t FrameTrace::nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void FrameTrace::enter(int elementId) {
+  std::int64_t now = nowNs();
+  std::lock_guard<std::mutex> lock(mMutex);
+  mSpans.push_back({elementId, now, -1});
+}
+
+void FrameTrace::exit(int elementId) {
+  std::int64_t now = nowNs();
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto it = mSpans.rbegin(); it != mSpans.rend(); ++it) {
+    if (it->elementId == elementId && it->exitNs < 0) {
+      it->exitNs = now;
+      return;
+    }
+  }
+  mSpans.push_back({elementId, now, now});
+}
+
+std::vector<FrameTraceSpan> FrameTrace::getSpans() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mSpans;
+}
+
+std::int64_t FrameTrace::getLatencyNs() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mSpans.empty()) return 0;
+  std::int64_t begin = mSpans.front().enterNs;
+  std::int64_t end = begin;
+  for (auto& span : mSpans) {
+    end = std::max(end, std::max(span.enterNs, span.exitNs));
+  }
+  return end - begin;
+}
+
+FrameTraceCollector& FrameTraceCollector::getInstance() {
+  static FrameTraceCollector inst;
+  return inst;
+}
+
+void FrameTraceCollector::setElementName(int graphId, int elementId,
+                                         const std::string& name) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mElementNames[std::make_pair(graphId, elementId)] = name;
+}
+
+void FrameTraceCollector::onSink(int graphId, int channelId,
+                                 std::int64_t frameId,
+                                 const std::shared_ptr<FrameTrace>& trace) {
+  if (!trace) return;
+  std::int64_t latency = trace->getLatencyNs();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto key = std::make_pair(graphId, channelId);
+  auto& channelLatency = mChannelLatencies[key];
+  if (!channelLatency.histogram) {
+    channelLatency.histogram = std::make_shared<LatencyHistogram>();
+    MetricsRegistry::getInstance().addHistogram(
+        "sophon_stream_frame_latency_seconds",
+        "End-to-end latency of traced frames from the source element to the "
+        "sink element.",
+        {{"graph_id", std::to_string(graphId)},
+         {"channel_id", std::to_string(channelId)}},
+        channelLatency.histogram);
+  }
+  channelLatency.histogram->observe(std::chrono::nanoseconds(latency));
+  channelLatency.latencies.push_back(latency);
+  if (channelLatency.latencies.size() > LATENCY_WINDOW) {
+    channelLatency.latencies.pop_front();
+  }
+  ++channelLatency.count;
+
+  if (trace->isSampled()) {
+    mSampledFrames.push_back({graphId, channelId, frameId, trace->getSpans()});
+    if (mSampledFrames.size() > MAX_SAMPLED_FRAMES) {
+      mSampledFrames.pop_front();
+    }
+  }
+}
+
+nlohmann::json FrameTraceCollector::getLatencySummary() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  nlohmann::json channels = nlohmann::json::array();
+  for (auto& pair : mChannelLatencies) {
+    std::vector<std::int64_t> latencies(pair.second.latencies.begin(),
+                                        pair.second.latencies.end());
+    if (latencies.empty()) continue;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+      std::size_t index = static_cast<std::size_t>(p * (latencies.size() - 1));
+      return latencies[index] / 1e6;
+    };
+    nlohmann::json item;
+    item["graph_id"] = pair.first.first;
+    item["channel_id"] = pair.first.second;
+    item["count"] = pair.second.count;
+    item["window"] = latencies.size();
+    item["p50_ms"] = percentile(0.5);
+    item["p99_ms"] = percentile(0.99);
+    item["max_ms"] = latencies.back() / 1e6;
+    channels.push_back(item);
+  }
+  return channels;
+}
+
+nlohmann::json FrameTraceCollector::getChromeTrace() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  nlohmann::json events = nlohmann::json::array();
+  auto toUs = [](std::int64_t ns) { return ns / 1000.0; };
+  for (auto& frame : mSampledFrames) {
+    nlohmann::json args = {{"frame_id", frame.frameId}};
+    const FrameTraceSpan* previous = nullptr;
+    for (auto& span : frame.spans) {
+      std::int64_t exitNs = span.exitNs < 0 ? span.enterNs : span.exitNs;
+      if (previous && span.enterNs > previous->exitNs) {
+        events.push_back({{"name", "queue"},
+                          {"cat", "queue"},
+                          {"ph", "X"},
+                          {"ts", toUs(previous->exitNs)},
+                          {"dur", toUs(span.enterNs - previous->exitNs)},
+                          {"pid", frame.graphId},
+                          {"tid", frame.channelId},
+                          {"args", args}});
+      }
+      std::string name = std::to_string(span.elementId);
+      auto nameIt =
+          mElementNames.find(std::make_pair(frame.graphId, span.elementId));
+      if (mElementNames.end() != nameIt) {
+        name = nameIt->second + " (" + name + ")";
+      }
+      events.push_back({{"name", name},
+                        {"cat", "element"},
+                        {"ph", "X"},
+                        {"ts", toUs(span.enterNs)},
+                        {"dur", toUs(exitNs - span.enterNs)},
+                        {"pid", frame.graphId},
+                        {"tid", frame.channelId},
+                        {"args", args}});
+      if (span.exitNs >= 0) previous = &span;
+    }
+  }
+  nlohmann::json trace;
+  trace["traceEvents"] = events;
+  trace["displayTimeUnit"] = "ms";
+  return trace;
+}
+
+bool FrameTraceCollector::dumpChromeTrace(const std::string& path) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out << getChromeTrace().dump();
+  return out.good();
+}
+
+}  // namespace common
+}  // namespace sophon_stream
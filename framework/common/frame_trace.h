@@ -0,0 +1,142 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_FRAME_TRACE_H_
+#define SOPHON_STREAM_COMMON_FRAME_TRACE_H_
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/metrics.h"
+#include "common/no_copyable.h"
+#include "nlohmann/json.hpp"
+
+namespace sophon_stream {
+namespace common {
+
+/**
+ * @brief 一帧在一个element内停留的时间段，时间为steady_clock的纳秒数
+ */
+struct FrameTraceSpan {
+  int elementId;
+  std::int64_t enterNs;
+  std::int64_t exitNs;
+};
+
+/**
+ * @brief 一帧从source element到sink element经过各element的时间记录
+ * @brief 由graph开启trace后在Element::popInputData/pushOutputData中打点，
+ * 未开启时ObjectMetadata::mTrace为空，不产生任何开销
+ */
+class FrameTrace : public NoCopyable {
+ public:
+  explicit FrameTrace(bool sampled) : mSampled(sampled) {}
+
+  static std::int64_t nowNs();
+
+  /**
+   * @brief 数据被element取出时调用
+   */
+  void enter(int elementId);
+
+  /**
+   * @brief 数据被element送出时调用，与该element最近一次未结束的enter配对；
+   * 没有对应的enter时（source element）记录一个起止时间相同的时间段
+   */
+  void exit(int elementId);
+
+  std::vector<FrameTraceSpan> getSpans() const;
+
+  /**
+   * @brief 第一次enter到最后一次exit的时间
+   */
+  std::int64_t getLatencyNs() const;
+
+  /**
+   * @brief 是否需要保存完整记录用于导出chrome trace
+   */
+  bool isSampled() const { return mSampled; }
+
+ private:
+  const bool mSampled;
+  mutable std::mutex mMutex;
+  std::vector<FrameTraceSpan> mSpans;
+};
+
+/**
+ * @brief sink端的trace汇总
+ * @brief 按graph和码流统计最近LATENCY_WINDOW帧端到端耗时的p50/p99，
+ * 并保存最近MAX_SAMPLED_FRAMES个被采样帧的完整记录，用于导出chrome trace
+ */
+class FrameTraceCollector : public NoCopyable {
+ public:
+  static constexpr std::size_t LATENCY_WINDOW = 1024;
+  static constexpr std::size_t MAX_SAMPLED_FRAMES = 256;
+
+  static FrameTraceCollector& getInstance();
+
+  /**
+   * @brief 注册element名称，导出chrome trace时使用
+   */
+  void setElementName(int graphId, int elementId, const std::string& name);
+
+  /**
+   * @brief 一帧到达sink element
+   */
+  void onSink(int graphId, int channelId, std::int64_t frameId,
+              const std::shared_ptr<FrameTrace>& trace);
+
+  /**
+   * @brief 各码流端到端耗时的统计，单位为毫秒
+   */
+  nlohmann::json getLatencySummary();
+
+  /**
+   * @brief Chrome trace event format，可在chrome://tracing或Perfetto中打开
+   * @brief pid为graph_id，tid为码流id；除element内的耗时外，
+   * 相邻两个element之间的等待时间以"queue"事件表示
+   */
+  nlohmann::json getChromeTrace();
+
+  /**
+   * @brief 将getChromeTrace()的结果写入文件
+   * @return 写入成功返回true
+   */
+  bool dumpChromeTrace(const std::string& path);
+
+ private:
+  struct ChannelLatency {
+    std::deque<std::int64_t> latencies;
+    std::uint64_t count = 0;
+    std::shared_ptr<LatencyHistogram> histogram;
+  };
+
+  struct SampledFrame {
+    int graphId;
+    int channelId;
+    std::int64_t frameId;
+    std::vector<FrameTraceSpan> spans;
+  };
+
+  std::mutex mMutex;
+  std::map<std::pair<int, int>, ChannelLatency> mChannelLatencies;
+  std::deque<SampledFrame> mSampledFrames;
+  std::map<std::pair<int, int>, std::string> mElementNames;
+};
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_FRAME_TRACE_H_
@@ -0,0 +1,209 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "metrics.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace sophon_stream {
+namespace common {
+
+namespace {
+
+std::string escapeLabelValue(const std::string& value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if ('\\' == c) {
+      escaped += "\\\\";
+    } else if ('"' == c) {
+      escaped += "\\\"";
+    } else if ('\n' == c) {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+/**
+ * @brief 格式化为{k1="v1",k2="v2"}，extra用于直方图的le标签
+ */
+std::string formatLabels(const MetricLabels& labels,
+                         const std::string& extra = "") {
+  if (labels.empty() && extra.empty()) return "";
+  std::string text = "{";
+  for (std::size_t i = 0; i < labels.size(); ++i) {
+    if (i > 0) text += ",";
+    text += labels[i].first + "=\"" + escapeLabelValue(labels[i].second) + "\"";
+  }
+  if (!extra.empty()) {
+    if (!labels.empty()) text += ",";
+    text += extra;
+  }
+  text += "}";
+  return text;
+}
+
+std::string formatValue(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() {
+  for (auto& bucket : mBuckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::observe(std::chrono::nanoseconds duration) {
+  std::int64_t ns = duration.count();
+  if (ns < 0) ns = 0;
+  std::uint64_t us = static_cast<std::uint64_t>(ns) / 1000;
+  // 上界为2^(index+MIN_BUCKET_SHIFT)us，即ceil(log2(us)) - MIN_BUCKET_SHIFT
+  int index = 0;
+  if (us > (1ull << MIN_BUCKET_SHIFT)) {
+    index = 64 - __builtin_clzll(us - 1) - MIN_BUCKET_SHIFT;
+    if (index > BUCKET_NUMBER) index = BUCKET_NUMBER;
+  }
+  mBuckets[index].fetch_add(1, std::memory_order_relaxed);
+  mSumNs.fetch_add(ns, std::memory_order_relaxed);
+  mCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getBucketBound(int index) {
+  return static_cast<double>(1ull << (index + MIN_BUCKET_SHIFT)) / 1e6;
+}
+
+std::vector<std::uint64_t> LatencyHistogram::getBucketCounts() const {
+  std::vector<std::uint64_t> counts(BUCKET_NUMBER + 1);
+  for (int i = 0; i <= BUCKET_NUMBER; ++i) {
+    counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+std::uint64_t LatencyHistogram::getCount() const {
+  return mCount.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getSum() const {
+  return mSumNs.load(std::memory_order_relaxed) / 1e9;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+  static MetricsRegistry inst;
+  return inst;
+}
+
+void MetricsRegistry::addHistogram(const std::string& name,
+                                   const std::string& help,
+                                   const MetricLabels& labels,
+                                   std::shared_ptr<LatencyHistogram> histogram) {
+  Series series;
+  series.labels = labels;
+  series.histogram = histogram;
+  addSeries(name, help, "histogram", series);
+}
+
+void MetricsRegistry::addGauge(const std::string& name,
+                               const std::string& help,
+                               const MetricLabels& labels, ValueGetter getter) {
+  Series series;
+  series.labels = labels;
+  series.getter = getter;
+  addSeries(name, help, "gauge", series);
+}
+
+void MetricsRegistry::addCounter(const std::string& name,
+                                 const std::string& help,
+                                 const MetricLabels& labels,
+                                 ValueGetter getter) {
+  Series series;
+  series.labels = labels;
+  series.getter = getter;
+  addSeries(name, help, "counter", series);
+}
+
+void MetricsRegistry::addSeries(const std::string& name,
+                                const std::string& help,
+                                const std::string& type, Series series) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto& family = mFamilies[name];
+  family.help = help;
+  family.type = type;
+  family.series[formatLabels(series.labels)] = series;
+}
+
+std::string MetricsRegistry::dumpPrometheus() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::ostringstream out;
+  for (auto familyIt = mFamilies.begin(); familyIt != mFamilies.end();) {
+    const std::string& name = familyIt->first;
+    auto& family = familyIt->second;
+    std::ostringstream samples;
+    for (auto seriesIt = family.series.begin();
+         seriesIt != family.series.end();) {
+      const std::string& labelText = seriesIt->first;
+      Series& series = seriesIt->second;
+      if (series.getter) {
+        double value = 0;
+        if (!series.getter(value)) {
+          seriesIt = family.series.erase(seriesIt);
+          continue;
+        }
+        samples << name << labelText << " " << formatValue(value) << "\n";
+      } else {
+        auto histogram = series.histogram.lock();
+        if (!histogram) {
+          seriesIt = family.series.erase(seriesIt);
+          continue;
+        }
+        // 先读桶再读总数，保证+Inf桶不小于各有限桶
+        auto counts = histogram->getBucketCounts();
+        std::uint64_t cumulative = 0;
+        for (int i = 0; i < LatencyHistogram::BUCKET_NUMBER; ++i) {
+          cumulative += counts[i];
+          samples << name << "_bucket"
+                  << formatLabels(series.labels,
+                                  "le=\"" +
+                                      formatValue(
+                                          LatencyHistogram::getBucketBound(i)) +
+                                      "\"")
+                  << " " << cumulative << "\n";
+        }
+        cumulative += counts[LatencyHistogram::BUCKET_NUMBER];
+        samples << name << "_bucket"
+                << formatLabels(series.labels, "le=\"+Inf\"") << " "
+                << cumulative << "\n";
+        samples << name << "_sum" << labelText << " "
+                << formatValue(histogram->getSum()) << "\n";
+        samples << name << "_count" << labelText << " " << cumulative << "\n";
+      }
+      ++seriesIt;
+    }
+    if (family.series.empty()) {
+      familyIt = mFamilies.erase(familyIt);
+      continue;
+    }
+    out << "# HELP " << name << " " << family.help << "\n";
+    out << "# TYPE " << name << " " << family.type << "\n";
+    out << samples.str();
+    ++familyIt;
+  }
+  return out.str();
+}
+
+}  // namespace common
+}  // namespace sophon_stream
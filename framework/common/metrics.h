@@ -0,0 +1,142 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_METRICS_H_
+#define SOPHON_STREAM_COMMON_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace common {
+
+/**
+ * @brief 指标的标签，按给定顺序输出
+ */
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief 无锁耗时直方图
+ * @brief 桶上界为2^4us, 2^5us, ..., 2^22us(约4.2s)以及+Inf，
+ * observe()只做几次relaxed原子加，可以在数据通路上调用
+ */
+class LatencyHistogram : public NoCopyable {
+ public:
+  /**
+   * @brief 有限桶的数量，另有一个+Inf桶
+   */
+  static constexpr int BUCKET_NUMBER = 19;
+  static constexpr int MIN_BUCKET_SHIFT = 4;
+
+  LatencyHistogram();
+
+  void observe(std::chrono::nanoseconds duration);
+
+  /**
+   * @brief 第index个有限桶的上界，单位为秒
+   */
+  static double getBucketBound(int index);
+
+  /**
+   * @brief 读取各桶的计数（非累计），最后一个为+Inf桶
+   * @note 与observe()并发时各计数之间可能不完全一致
+   */
+  std::vector<std::uint64_t> getBucketCounts() const;
+
+  std::uint64_t getCount() const;
+
+  /**
+   * @brief 所有观测值之和，单位为秒
+   */
+  double getSum() const;
+
+ private:
+  std::atomic<std::uint64_t> mBuckets[BUCKET_NUMBER + 1];
+  std::atomic<std::uint64_t> mCount{0};
+  std::atomic<std::uint64_t> mSumNs{0};
+};
+
+/**
+ * @brief 进程内所有指标的注册表，以Prometheus文本格式输出
+ * @brief 注册表只持有指标的弱引用，指标的所有者（element、dataPipe）析构后自动移除。
+ * 注册和导出需要加锁，只应在启动阶段和抓取时调用，数据通路上只访问指标对象本身
+ */
+class MetricsRegistry : public NoCopyable {
+ public:
+  /**
+   * @brief 抓取时读取指标当前值，返回false表示指标所有者已析构，需要移除
+   */
+  using ValueGetter = std::function<bool(double& value)>;
+
+  static MetricsRegistry& getInstance();
+
+  /**
+   * @brief 注册直方图，相同name和labels的旧指标被替换
+   */
+  void addHistogram(const std::string& name, const std::string& help,
+                    const MetricLabels& labels,
+                    std::shared_ptr<LatencyHistogram> histogram);
+
+  /**
+   * @brief 注册gauge，抓取时调用getter取值，例如队列长度
+   */
+  void addGauge(const std::string& name, const std::string& help,
+                const MetricLabels& labels, ValueGetter getter);
+
+  /**
+   * @brief 注册counter，getter返回的值应单调递增，例如丢弃数量
+   */
+  void addCounter(const std::string& name, const std::string& help,
+                  const MetricLabels& labels, ValueGetter getter);
+
+  /**
+   * @brief 以Prometheus text exposition format 0.0.4输出所有指标
+   */
+  std::string dumpPrometheus();
+
+  static constexpr const char* PROMETHEUS_CONTENT_TYPE =
+      "text/plain; version=0.0.4; charset=utf-8";
+
+ private:
+  struct Series {
+    MetricLabels labels;
+    std::weak_ptr<LatencyHistogram> histogram;
+    ValueGetter getter;
+  };
+
+  struct Family {
+    std::string help;
+    std::string type;
+    /**
+     * @brief 以格式化后的标签为key，保证同一组标签只有一条序列
+     */
+    std::map<std::string, Series> series;
+  };
+
+  void addSeries(const std::string& name, const std::string& help,
+                 const std::string& type, Series series);
+
+  std::mutex mMutex;
+  std::map<std::string, Family> mFamilies;
+};
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_METRICS_H_
@@ -20,6 +20,7 @@
 #include "error_code.h"
 #include "face_object_metadata.h"
 #include "frame.h"
+#include "frame_trace.h"
 #include "graphics.h"
 #include "posed_object_metadata.h"
 #include "recognized_object_metadata.h"
@@ -68,6 +69,41 @@ struct ObjectMetadata {
         is_main(false),
         numBranches(0) {}
 
+  /**
+   * @brief 恢复到刚构造时的状态，由ObjectPool回收时调用
+   * @brief vector只清空不释放，保留容量供下一帧复用
+   */
+  void reset() {
+    mErrorCode = common::ErrorCode::SUCCESS;
+    mFrame.reset();
+    mFilter = false;
+    mSkipElements.clear();
+    mInputBMtensors.reset();
+    mOutputBMtensors.reset();
+    mSubInputBMtensors.reset();
+    mSubOutputBMtensors.reset();
+    mModelConfigureMap.reset();
+    mSpDataInformation.reset();
+    mTransformFrame.reset();
+    mSubObjectMetadatas.clear();
+    tag = 0;
+    fps = 0.f;
+    numBranches = 0;
+    mSubId = 0;
+    mGraphId = 0;
+    is_main = false;
+    mPartiallyConverged = false;
+    mTrackedObjectMetadatas.clear();
+    mDetectedObjectMetadatas.clear();
+    mPosedObjectMetadatas.clear();
+    mRecognizedObjectMetadatas.clear();
+    mSegmentedObjectMetadatas.clear();
+    mFaceObjectMetadatas.clear();
+    resize_vector.clear();
+    areas.clear();
+    mTrace.reset();
+  }
+
   int getChannelId() const {
     if (mFrame) {
       return mFrame->mChannelId;
@@ -134,6 +170,11 @@ struct ObjectMetadata {
    */
   bool is_main;
 
+  /**
+   * @brief converger等待分支超时后放行时置为true，此时mSubObjectMetadatas中部分分支的结果可能不完整
+   */
+  bool mPartiallyConverged = false;
+
   /**
    * @brief 跟踪结果的vector，一个目标对应一个TrackedObjectMetadata
    */
@@ -172,6 +213,11 @@ struct ObjectMetadata {
    */
   std::vector<int> resize_vector;
   std::vector<std::vector<common::Point<int>>> areas;
+
+  /**
+   * @brief 经过各element的时间记录，graph开启trace时由source element创建，否则为空
+   */
+  std::shared_ptr<FrameTrace> mTrace;
 };
 
 using ObjectMetadatas = std::vector<std::shared_ptr<ObjectMetadata>>;
@@ -0,0 +1,216 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "object_pool.h"
+
+#include <new>
+
+#include "common/metrics.h"
+#include "common/object_metadata.h"
+
+namespace sophon_stream {
+namespace common {
+
+namespace {
+
+/**
+ * @brief 定长内存块的空闲链表，用于分配shared_ptr的控制块
+ */
+template <std::size_t Size>
+class BlockCache : public NoCopyable {
+ public:
+  static constexpr std::size_t MAX_IDLE_BLOCKS = 65536;
+
+  static BlockCache& getInstance() {
+    static BlockCache* inst = new BlockCache();
+    return *inst;
+  }
+
+  void* allocate() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (!mBlocks.empty()) {
+        void* block = mBlocks.back();
+        mBlocks.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(Size);
+  }
+
+  void deallocate(void* block) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mBlocks.size() < MAX_IDLE_BLOCKS) {
+        mBlocks.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+ private:
+  BlockCache() = default;
+
+  std::mutex mMutex;
+  std::vector<void*> mBlocks;
+};
+
+template <typename U>
+struct BlockAllocator {
+  using value_type = U;
+
+  static_assert(alignof(U) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                "over-aligned control block");
+
+  BlockAllocator() = default;
+  template <typename V>
+  BlockAllocator(const BlockAllocator<V>&) {}
+
+  U* allocate(std::size_t n) {
+    if (1 != n) return static_cast<U*>(::operator new(n * sizeof(U)));
+    return static_cast<U*>(BlockCache<sizeof(U)>::getInstance().allocate());
+  }
+
+  void deallocate(U* p, std::size_t n) {
+    if (1 != n) {
+      ::operator delete(p);
+      return;
+    }
+    BlockCache<sizeof(U)>::getInstance().deallocate(p);
+  }
+};
+
+template <typename U, typename V>
+bool operator==(const BlockAllocator<U>&, const BlockAllocator<V>&) {
+  return true;
+}
+
+template <typename U, typename V>
+bool operator!=(const BlockAllocator<U>&, const BlockAllocator<V>&) {
+  return false;
+}
+
+template <typename T>
+const char* getPoolTypeName();
+
+template <>
+const char* getPoolTypeName<ObjectMetadata>() {
+  return "ObjectMetadata";
+}
+
+template <>
+const char* getPoolTypeName<Frame>() {
+  return "Frame";
+}
+
+template <>
+const char* getPoolTypeName<DetectedObjectMetadata>() {
+  return "DetectedObjectMetadata";
+}
+
+template <>
+const char* getPoolTypeName<TrackedObjectMetadata>() {
+  return "TrackedObjectMetadata";
+}
+
+}  // namespace
+
+template <typename T>
+ObjectPool<T>& ObjectPool<T>::getInstance() {
+  static ObjectPool* inst = new ObjectPool();
+  return *inst;
+}
+
+template <typename T>
+ObjectPool<T>::ObjectPool() {
+  auto& registry = MetricsRegistry::getInstance();
+  MetricLabels labels = {{"type", getPoolTypeName<T>()}};
+  registry.addCounter(
+      "sophon_stream_object_pool_created_total",
+      "Objects allocated because the pool had no idle object.", labels,
+      [this](double& value) {
+        value = getCreatedCount();
+        return true;
+      });
+  registry.addCounter("sophon_stream_object_pool_reused_total",
+                      "Objects taken from the pool instead of allocated.",
+                      labels, [this](double& value) {
+                        value = getReusedCount();
+                        return true;
+                      });
+  registry.addGauge("sophon_stream_object_pool_idle",
+                    "Idle objects kept in the pool.", labels,
+                    [this](double& value) {
+                      value = getIdleCount();
+                      return true;
+                    });
+}
+
+template <typename T>
+std::shared_ptr<T> ObjectPool<T>::acquire() {
+  T* object = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mIdleObjects.empty()) {
+      object = mIdleObjects.back();
+      mIdleObjects.pop_back();
+    }
+  }
+  if (object) {
+    mReused.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    object = new T();
+    mCreated.fetch_add(1, std::memory_order_relaxed);
+  }
+  return std::shared_ptr<T>(
+      object, [this](T* p) { release(p); }, BlockAllocator<T>());
+}
+
+template <typename T>
+void ObjectPool<T>::release(T* object) {
+  // reset()可能释放子对象并归还到其它池，因此在加锁之前调用
+  object->reset();
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mIdleObjects.size() < mMaxIdle) {
+      mIdleObjects.push_back(object);
+      return;
+    }
+  }
+  delete object;
+}
+
+template <typename T>
+void ObjectPool<T>::setMaxIdle(std::size_t maxIdle) {
+  std::vector<T*> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxIdle = maxIdle;
+    while (mIdleObjects.size() > mMaxIdle) {
+      evicted.push_back(mIdleObjects.back());
+      mIdleObjects.pop_back();
+    }
+  }
+  for (T* object : evicted) delete object;
+}
+
+template <typename T>
+std::size_t ObjectPool<T>::getIdleCount() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mIdleObjects.size();
+}
+
+template class ObjectPool<ObjectMetadata>;
+template class ObjectPool<Frame>;
+template class ObjectPool<DetectedObjectMetadata>;
+template class ObjectPool<TrackedObjectMetadata>;
+
+}  // namespace common
+}  // namespace sophon_stream
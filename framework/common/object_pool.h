@@ -0,0 +1,103 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_OBJECT_POOL_H_
+#define SOPHON_STREAM_COMMON_OBJECT_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace common {
+
+struct ObjectMetadata;
+struct Frame;
+struct DetectedObjectMetadata;
+struct TrackedObjectMetadata;
+
+/**
+ * @brief 可回收对象的池
+ * @brief acquire()返回的shared_ptr在最后一个引用释放时不析构对象，而是调用T::reset()
+ * 清空内容后放回池中。reset()保留vector等成员的容量，对象再次使用时不需要重新分配内存；
+ * shared_ptr的控制块也从定长内存块的空闲链表中分配，稳定运行后每帧不再产生堆分配。
+ * @brief 只对ObjectMetadata、Frame、DetectedObjectMetadata、TrackedObjectMetadata
+ * 显式实例化，实现位于libivslogger中，element动态库被卸载后池中的对象仍可安全释放
+ */
+template <typename T>
+class ObjectPool : public NoCopyable {
+ public:
+  /**
+   * @brief 默认最多缓存的空闲对象数量，超出的对象直接析构
+   */
+  static constexpr std::size_t DEFAULT_MAX_IDLE = 16384;
+
+  /**
+   * @brief 池对象在进程退出前不析构，保证其它静态对象析构时仍可归还对象
+   */
+  static ObjectPool& getInstance();
+
+  /**
+   * @brief 取出一个空闲对象，没有空闲对象时新建
+   */
+  std::shared_ptr<T> acquire();
+
+  void setMaxIdle(std::size_t maxIdle);
+
+  /**
+   * @brief 新建的对象数量
+   */
+  std::uint64_t getCreatedCount() const {
+    return mCreated.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 从池中取出复用的对象数量
+   */
+  std::uint64_t getReusedCount() const {
+    return mReused.load(std::memory_order_relaxed);
+  }
+
+  std::size_t getIdleCount();
+
+ private:
+  ObjectPool();
+
+  void release(T* object);
+
+  std::mutex mMutex;
+  std::vector<T*> mIdleObjects;
+  std::size_t mMaxIdle = DEFAULT_MAX_IDLE;
+
+  std::atomic<std::uint64_t> mCreated{0};
+  std::atomic<std::uint64_t> mReused{0};
+};
+
+extern template class ObjectPool<ObjectMetadata>;
+extern template class ObjectPool<Frame>;
+extern template class ObjectPool<DetectedObjectMetadata>;
+extern template class ObjectPool<TrackedObjectMetadata>;
+
+/**
+ * @brief 从对应的ObjectPool中取出对象，用法与std::make_shared<T>()相同
+ */
+template <typename T>
+std::shared_ptr<T> makePooled() {
+  return ObjectPool<T>::getInstance().acquire();
+}
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_OBJECT_POOL_H_
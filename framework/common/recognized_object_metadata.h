@@ -45,6 +45,10 @@ struct RecognizedObjectMetadata {
   std::string mLabelName;
   std::vector<float> mScores;
   std::vector<int> mTopKLabels;
+  /**
+   * @brief 与mTopKLabels一一对应的标签名，不需要名称的算法可以为空
+   */
+  std::vector<std::string> mTopKLabelNames;
   std::vector<std::shared_ptr<LabelMetadata> > mTopKLabelMetadatas;
   std::shared_ptr<float> feature_vector;
 };
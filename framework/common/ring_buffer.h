@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_RING_BUFFER_H_
+#define SOPHON_STREAM_COMMON_RING_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace common {
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief 有界无锁单生产者单消费者环形队列
+ * @brief 读写下标单调递增，槽位为下标对容量取模，因此容量不要求是2的幂
+ */
+template <typename T>
+class SpscRingBuffer : public NoCopyable {
+ public:
+  explicit SpscRingBuffer(std::size_t capacity)
+      : mCapacity(capacity), mSlots(new T[capacity]) {}
+
+  /**
+   * @brief 仅允许一个生产者线程调用
+   * @return 队列已满返回false，value保持不变
+   */
+  bool push(T& value) {
+    std::size_t tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mHead.load(std::memory_order_acquire) >= mCapacity) {
+      return false;
+    }
+    mSlots[tail % mCapacity] = std::move(value);
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 仅允许一个消费者线程调用
+   * @return 队列为空返回false
+   */
+  bool pop(T& value) {
+    std::size_t head = mHead.load(std::memory_order_relaxed);
+    if (head == mTail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(mSlots[head % mCapacity]);
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 近似元素数量，并发读写时仅供参考
+   */
+  std::size_t size() const {
+    std::size_t head = mHead.load(std::memory_order_acquire);
+    std::size_t tail = mTail.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  std::size_t capacity() const { return mCapacity; }
+
+ private:
+  const std::size_t mCapacity;
+  std::unique_ptr<T[]> mSlots;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mHead{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mTail{0};
+};
+
+/**
+ * @brief 有界无锁多生产者单消费者环形队列
+ * @brief 每个槽位带一个序号：序号等于写下标时可写，等于写下标+1时可读。
+ * 生产者通过CAS竞争写下标，消费者独占读下标
+ */
+template <typename T>
+class MpscRingBuffer : public NoCopyable {
+ public:
+  explicit MpscRingBuffer(std::size_t capacity)
+      : mCapacity(capacity), mSlots(new Slot[capacity]) {
+    for (std::size_t i = 0; i < mCapacity; ++i) {
+      mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief 允许多个生产者线程并发调用
+   * @return 队列已满返回false，value保持不变
+   */
+  bool push(T& value) {
+    std::size_t tail = mTail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &mSlots[tail % mCapacity];
+      std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) -
+                            static_cast<std::ptrdiff_t>(tail);
+      if (diff == 0) {
+        if (mTail.compare_exchange_weak(tail, tail + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        tail = mTail.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(value);
+    slot->sequence.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 仅允许一个消费者线程调用
+   * @return 队列为空返回false
+   */
+  bool pop(T& value) {
+    std::size_t head = mHead.load(std::memory_order_relaxed);
+    Slot& slot = mSlots[head % mCapacity];
+    std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != head + 1) {
+      return false;
+    }
+    value = std::move(slot.value);
+    mHead.store(head + 1, std::memory_order_relaxed);
+    slot.sequence.store(head + mCapacity, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 近似元素数量，并发读写时仅供参考
+   */
+  std::size_t size() const {
+    std::size_t head = mHead.load(std::memory_order_acquire);
+    std::size_t tail = mTail.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  std::size_t capacity() const { return mCapacity; }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  const std::size_t mCapacity;
+  std::unique_ptr<Slot[]> mSlots;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mHead{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mTail{0};
+};
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_RING_BUFFER_H_
@@ -20,6 +20,7 @@
 // #include "common/logger.h"
 // #include "detected_object_metadata.h"
 // #include "face_object_metadata.h"
+#include "base64.h"
 #include "frame.h"
 #include "graphics.h"
 #include "object_metadata.h"
@@ -70,69 +71,26 @@ void extended_to_json(const char* key, nlohmann::json& j, const T& value) {
     NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(EXTEND_JSON_TO, __VA_ARGS__)) \
   }
 
-const std::string base64_chars =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-    "abcdefghijklmnopqrstuvwxyz"
-    "0123456789+/";
-
 /// Encode a char buffer into a base64 string
 /**
  * @param input The input data
  * @param len The length of input in bytes
  * @return A base64 encoded string representing input
  */
-std::string base64_encode(unsigned char const* input, size_t len) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (len--) {
-    char_array_3[i++] = *(input++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] =
-          ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] =
-          ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for (i = 0; (i < 4); i++) {
-        ret += base64_chars[char_array_4[i]];
-      }
-      i = 0;
-    }
-  }
-
-  if (i) {
-    for (j = i; j < 3; j++) {
-      char_array_3[j] = '\0';
-    }
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] =
-        ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] =
-        ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-
-    for (j = 0; (j < i + 1); j++) {
-      ret += base64_chars[char_array_4[j]];
-    }
-
-    while ((i++ < 3)) {
-      ret += '=';
-    }
-  }
-
+inline std::string base64_encode(unsigned char const* input, size_t len) {
+  std::string ret(base64EncodedSize(len), '\0');
+  base64Encode(input, len, &ret[0]);
   return ret;
 }
 
-std::string frame_to_base64(Frame& frame) {
+/**
+ * @brief 将帧编码为JPEG，优先使用OSD叠加后的图像
+ * @param consume 以(unsigned char* data, size_t size)调用，返回后JPEG数据即被释放
+ */
+template <typename Consumer>
+bool frame_encode_jpeg(const Frame& frame, Consumer&& consume) {
 #if ENABLE_TIME_LOG
-  timeval time1, time2, time3, time4, time5;
-  gettimeofday(&time1, NULL);
+  timeval time2, time3, time4;
 #endif
   unsigned char* jpegData = nullptr;
   size_t nBytes = 0;
@@ -158,47 +116,60 @@ std::string frame_to_base64(Frame& frame) {
 #if ENABLE_TIME_LOG
   gettimeofday(&time3, NULL);
 #endif
-  bmcv_image_jpeg_enc(handle_, 1, &yuv_, (void**)&jpegData, &nBytes);
+  bm_status_t ret =
+      bmcv_image_jpeg_enc(handle_, 1, &yuv_, (void**)&jpegData, &nBytes);
 #if ENABLE_TIME_LOG
   gettimeofday(&time4, NULL);
-#endif
-  bm_image_destroy(yuv_);
-
-#if BASE64_CPU
-  // for cpu
-  std::string res = base64_encode(jpegData, nBytes);
-#else
-  // for bmcv
-  unsigned long origin_len[2] = {nBytes, 0};
-  unsigned long encode_len[2] = {(origin_len[0] + 2) / 3 * 4, 0};
-  std::string res(encode_len[0], '\0');
-  bmcv_base64_enc(handle_, bm_mem_from_system(jpegData),
-                  bm_mem_from_system(const_cast<char*>(res.c_str())),
-                  origin_len);
-#endif
-
-#if ENABLE_TIME_LOG
-  gettimeofday(&time5, NULL);
   double time_delta1 =
-      1000 * ((time5.tv_sec - time1.tv_sec) +
-              (double)(time5.tv_usec - time1.tv_usec) / 1000000.0);
-  double time_delta2 =
       1000 * ((time3.tv_sec - time2.tv_sec) +
               (double)(time3.tv_usec - time2.tv_usec) / 1000000.0);
-  double time_delta3 =
+  double time_delta2 =
       1000 * ((time4.tv_sec - time3.tv_sec) +
               (double)(time4.tv_usec - time3.tv_usec) / 1000000.0);
-  double time_delta4 =
-      1000 * ((time5.tv_sec - time4.tv_sec) +
-              (double)(time5.tv_usec - time4.tv_usec) / 1000000.0);
-
-  IVS_INFO(
-      "storage convert time = {0}, jpeg_enc time = {1}, base64_enc time = {2}, "
-      "total time = {3}",
-      time_delta2, time_delta3, time_delta4, time_delta1);
+
+  IVS_INFO("storage convert time = {0}, jpeg_enc time = {1}", time_delta1,
+           time_delta2);
 #endif
+  bm_image_destroy(yuv_);
 
+  if (BM_SUCCESS != ret || jpegData == nullptr) return false;
+  consume(jpegData, nBytes);
   delete jpegData;
+  return true;
+}
+
+/**
+ * @brief 将帧编码为JPEG
+ * @param[out] out JPEG数据追加到out末尾
+ */
+bool frame_to_jpeg(const Frame& frame, std::string& out) {
+  return frame_encode_jpeg(frame, [&out](unsigned char* jpegData,
+                                         size_t nBytes) {
+    out.append(reinterpret_cast<const char*>(jpegData), nBytes);
+  });
+}
+
+/**
+ * @brief 将帧编码为JPEG后直接做base64编码，不复制JPEG数据
+ */
+std::string frame_to_base64(Frame& frame) {
+  std::string res;
+  frame_encode_jpeg(frame, [&](unsigned char* jpegData, size_t nBytes) {
+#if BASE64_CPU
+    // for cpu
+    res.resize(base64EncodedSize(nBytes));
+    base64Encode(jpegData, nBytes, &res[0]);
+#else
+    // for bmcv
+    bm_handle_t handle_ = bm_image_get_handle(frame.mSpData.get());
+    unsigned long origin_len[2] = {nBytes, 0};
+    unsigned long encode_len[2] = {(origin_len[0] + 2) / 3 * 4, 0};
+    res.resize(encode_len[0]);
+    bmcv_base64_enc(handle_, bm_mem_from_system(jpegData),
+                    bm_mem_from_system(const_cast<char*>(res.c_str())),
+                    origin_len);
+#endif
+  });
   return res;
 }
 
@@ -221,7 +192,7 @@ NLOHMANN_JSONIFY_ALL_THINGS(DetectedObjectMetadata, mBox, mScores, mClassify)
 NLOHMANN_JSONIFY_ALL_THINGS(PosedObjectMetadata, keypoints)
 
 NLOHMANN_JSONIFY_ALL_THINGS(RecognizedObjectMetadata, mLabelName, mScores,
-                            mTopKLabels)
+                            mTopKLabels, mTopKLabelNames)
 
 NLOHMANN_JSONIFY_ALL_THINGS(SegmentedObjectMetadata, mFrame)
 
@@ -0,0 +1,397 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "spill_queue.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "common/logger.h"
+
+namespace sophon_stream {
+namespace common {
+
+namespace {
+
+constexpr std::uint32_t RECORD_MAGIC = 0x4c505353;  // "SSPL"
+constexpr const char* SEGMENT_SUFFIX = ".seg";
+constexpr const char* ACK_FILE = "ack";
+
+struct RecordHeader {
+  std::uint32_t magic;
+  std::uint32_t size;
+  std::uint32_t checksum;
+  std::uint16_t typeSize;
+  std::uint16_t reserved;
+};
+
+constexpr std::uint64_t HEADER_SIZE = sizeof(RecordHeader);
+
+std::uint64_t recordSize(std::uint64_t typeSize, std::uint64_t size) {
+  return (HEADER_SIZE + typeSize + size + 7) & ~std::uint64_t(7);
+}
+
+/**
+ * @brief FNV-1a，覆盖长度字段，写了一半的记录通不过校验
+ */
+std::uint32_t checksum(std::uint32_t size, std::uint16_t typeSize,
+                       const char* type, const char* data) {
+  std::uint32_t hash = 2166136261u;
+  auto update = [&hash](const void* bytes, std::size_t length) {
+    auto p = static_cast<const unsigned char*>(bytes);
+    for (std::size_t i = 0; i < length; ++i) {
+      hash ^= p[i];
+      hash *= 16777619u;
+    }
+  };
+  update(&size, sizeof(size));
+  update(&typeSize, sizeof(typeSize));
+  update(type, typeSize);
+  update(data, size);
+  return hash;
+}
+
+bool makeDirs(const std::string& dir) {
+  for (std::size_t pos = 1; pos <= dir.size(); ++pos) {
+    if (pos != dir.size() && dir[pos] != '/') continue;
+    std::string sub = dir.substr(0, pos);
+    if (mkdir(sub.c_str(), 0755) != 0 && errno != EEXIST) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+SpillQueue::SpillQueue(const SpillQueueConfig& config) : mConfig(config) {}
+
+SpillQueue::~SpillQueue() {
+  for (auto& segment : mSegments) munmap(segment.data, segment.size);
+  if (mAck != nullptr) munmap(mAck, sizeof(AckPosition));
+}
+
+std::string SpillQueue::segmentPath(std::uint64_t id) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%020llu%s",
+                static_cast<unsigned long long>(id), SEGMENT_SUFFIX);
+  return mConfig.dir + "/" + name;
+}
+
+bool SpillQueue::mapSegment(Segment& segment, bool create) {
+  std::string path = segmentPath(segment.id);
+  int fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR,
+                  0644);
+  if (fd < 0) {
+    IVS_ERROR("Open spill segment {0} fail: {1}", path, std::strerror(errno));
+    return false;
+  }
+  if (create) {
+    // 预先分配磁盘空间，磁盘满时在这里失败，而不是写mmap时收到SIGBUS
+    int ret = posix_fallocate(fd, 0, mConfig.segmentBytes);
+    if (ret != 0) {
+      IVS_ERROR("Allocate spill segment {0} fail: {1}", path,
+                std::strerror(ret));
+      ::close(fd);
+      unlink(path.c_str());
+      return false;
+    }
+    segment.size = mConfig.segmentBytes;
+  } else {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+      ::close(fd);
+      return false;
+    }
+    segment.size = st.st_size;
+  }
+  void* data = mmap(nullptr, segment.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    IVS_ERROR("Map spill segment {0} fail: {1}", path, std::strerror(errno));
+    return false;
+  }
+  segment.data = static_cast<char*>(data);
+  return true;
+}
+
+void SpillQueue::scanSegment(Segment& segment) {
+  segment.end = 0;
+  segment.records = 0;
+  while (segment.end + HEADER_SIZE <= segment.size) {
+    RecordHeader header;
+    std::memcpy(&header, segment.data + segment.end, HEADER_SIZE);
+    if (header.magic != RECORD_MAGIC) break;
+    std::uint64_t total = recordSize(header.typeSize, header.size);
+    if (segment.end + total > segment.size) break;
+    const char* type = segment.data + segment.end + HEADER_SIZE;
+    if (checksum(header.size, header.typeSize, type,
+                 type + header.typeSize) != header.checksum)
+      break;
+    segment.end += total;
+    ++segment.records;
+  }
+}
+
+void SpillQueue::setAck(std::uint64_t segment, std::uint64_t offset) {
+  // 先写偏移再写段号：两次写入之间崩溃时得到{旧段, 0}，只会重复发送，不会跳过记录
+  mAck->offset = offset;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  mAck->segment = segment;
+}
+
+bool SpillQueue::open() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mAck != nullptr) return true;
+  if (mConfig.dir.empty() || !makeDirs(mConfig.dir)) {
+    IVS_ERROR("Create spill dir {0} fail", mConfig.dir);
+    return false;
+  }
+
+  std::string ackPath = mConfig.dir + "/" + ACK_FILE;
+  int fd = ::open(ackPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0 || ftruncate(fd, sizeof(AckPosition)) != 0) {
+    IVS_ERROR("Open spill ack file {0} fail: {1}", ackPath,
+              std::strerror(errno));
+    if (fd >= 0) ::close(fd);
+    return false;
+  }
+  void* ack = mmap(nullptr, sizeof(AckPosition), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ack == MAP_FAILED) {
+    IVS_ERROR("Map spill ack file {0} fail", ackPath);
+    return false;
+  }
+  mAck = static_cast<AckPosition*>(ack);
+
+  std::vector<std::uint64_t> ids;
+  if (DIR* dir = opendir(mConfig.dir.c_str())) {
+    while (struct dirent* entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      std::size_t suffix = name.size() - std::strlen(SEGMENT_SUFFIX);
+      if (name.size() <= std::strlen(SEGMENT_SUFFIX) ||
+          name.compare(suffix, std::string::npos, SEGMENT_SUFFIX) != 0 ||
+          name.find_first_not_of("0123456789") != suffix)
+        continue;
+      ids.push_back(std::strtoull(name.c_str(), nullptr, 10));
+    }
+    closedir(dir);
+  }
+  std::sort(ids.begin(), ids.end());
+
+  for (std::uint64_t id : ids) {
+    // 确认位置之前的段已经发送完，只是删除前进程退出了
+    if (id < mAck->segment) {
+      unlink(segmentPath(id).c_str());
+      continue;
+    }
+    Segment segment;
+    segment.id = id;
+    if (!mapSegment(segment, false)) {
+      IVS_WARN("Skip broken spill segment {0}", segmentPath(id));
+      continue;
+    }
+    scanSegment(segment);
+    mSegments.push_back(segment);
+  }
+
+  mFrontAcked = 0;
+  mPending = 0;
+  if (!mSegments.empty()) {
+    Segment& front = mSegments.front();
+    if (front.id != mAck->segment) {
+      // 确认位置所在的段已被删除，从现存最旧的段开始
+      setAck(front.id, 0);
+    }
+    std::uint64_t offset = 0;
+    while (offset < front.end && offset < mAck->offset) {
+      RecordHeader header;
+      std::memcpy(&header, front.data + offset, HEADER_SIZE);
+      offset += recordSize(header.typeSize, header.size);
+      ++mFrontAcked;
+    }
+    setAck(front.id, offset);
+    for (auto& segment : mSegments) mPending += segment.records;
+    mPending -= mFrontAcked;
+    while (mSegments.size() > 1 && mAck->offset >= mSegments.front().end)
+      popFrontSegment();
+  }
+  if (mPending > 0) {
+    IVS_INFO("Spill queue {0} recovered {1} records", mConfig.dir, mPending);
+  }
+  return true;
+}
+
+void SpillQueue::popFrontSegment() {
+  Segment front = mSegments.front();
+  mSegments.pop_front();
+  mFrontAcked = 0;
+  if (mSegments.empty()) {
+    setAck(front.id + 1, 0);
+  } else {
+    setAck(mSegments.front().id, 0);
+  }
+  munmap(front.data, front.size);
+  unlink(segmentPath(front.id).c_str());
+}
+
+bool SpillQueue::rollSegment() {
+  if (!mSegments.empty()) {
+    Segment& back = mSegments.back();
+    msync(back.data, back.size, MS_ASYNC);
+  }
+  std::uint64_t maxBytes = std::max(mConfig.maxBytes, mConfig.segmentBytes);
+  std::uint64_t diskBytes = 0;
+  for (auto& segment : mSegments) diskBytes += segment.size;
+  while (!mSegments.empty() && diskBytes + mConfig.segmentBytes > maxBytes) {
+    diskBytes -= mSegments.front().size;
+    std::uint64_t lost = mSegments.front().records - mFrontAcked;
+    if (lost > 0) {
+      IVS_WARN("Spill queue {0} is full, drop {1} oldest records",
+               mConfig.dir, lost);
+    }
+    mDropped += lost;
+    mDroppedSincePeek += lost;
+    mPending -= lost;
+    popFrontSegment();
+  }
+
+  Segment segment;
+  segment.id =
+      mSegments.empty() ? mAck->segment + 1 : mSegments.back().id + 1;
+  if (!mapSegment(segment, true)) return false;
+  if (mSegments.empty()) {
+    setAck(segment.id, 0);
+    mFrontAcked = 0;
+  }
+  mSegments.push_back(segment);
+  while (mSegments.size() > 1 && mAck->offset >= mSegments.front().end)
+    popFrontSegment();
+  return true;
+}
+
+bool SpillQueue::append(const char* contentType, const char* data,
+                        std::size_t size) {
+  std::size_t typeSize = std::strlen(contentType);
+  std::uint64_t total = recordSize(typeSize, size);
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mAck == nullptr || typeSize > UINT16_MAX ||
+      total > mConfig.segmentBytes) {
+    ++mDropped;
+    return false;
+  }
+  if (mSegments.empty() ||
+      mSegments.back().end + total > mSegments.back().size) {
+    if (!rollSegment()) {
+      ++mDropped;
+      return false;
+    }
+  }
+
+  Segment& back = mSegments.back();
+  char* record = back.data + back.end;
+  RecordHeader header;
+  header.magic = RECORD_MAGIC;
+  header.size = static_cast<std::uint32_t>(size);
+  header.typeSize = static_cast<std::uint16_t>(typeSize);
+  header.reserved = 0;
+  header.checksum = checksum(header.size, header.typeSize, contentType, data);
+  std::memcpy(record + HEADER_SIZE, contentType, typeSize);
+  std::memcpy(record + HEADER_SIZE + typeSize, data, size);
+  // 段文件可能是重启前写过的，先清掉下一条记录的magic，再写入本条记录头
+  if (back.end + total + sizeof(std::uint32_t) <= back.size)
+    std::memset(record + total, 0, sizeof(std::uint32_t));
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  std::memcpy(record, &header, HEADER_SIZE);
+  back.end += total;
+  ++back.records;
+  ++mPending;
+  return true;
+}
+
+std::size_t SpillQueue::peek(std::vector<SpillRecord>& records,
+                             std::size_t maxCount) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::size_t count = 0;
+  mDroppedSincePeek = 0;
+  if (mAck == nullptr) return count;
+  std::uint64_t offset = mAck->offset;
+  for (auto& segment : mSegments) {
+    for (; offset < segment.end && count < maxCount; ++count) {
+      RecordHeader header;
+      std::memcpy(&header, segment.data + offset, HEADER_SIZE);
+      const char* type = segment.data + offset + HEADER_SIZE;
+      if (records.size() <= count) records.emplace_back();
+      records[count].contentType.assign(type, header.typeSize);
+      records[count].body.assign(type + header.typeSize, header.size);
+      offset += recordSize(header.typeSize, header.size);
+    }
+    if (count >= maxCount) break;
+    offset = 0;
+  }
+  return count;
+}
+
+void SpillQueue::ack(std::size_t count) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  count -= std::min<std::uint64_t>(count, mDroppedSincePeek);
+  mDroppedSincePeek = 0;
+  while (count > 0 && !mSegments.empty()) {
+    Segment& front = mSegments.front();
+    if (mAck->offset >= front.end) {
+      if (mSegments.size() == 1) break;
+      popFrontSegment();
+      continue;
+    }
+    RecordHeader header;
+    std::memcpy(&header, front.data + mAck->offset, HEADER_SIZE);
+    setAck(front.id,
+           mAck->offset + recordSize(header.typeSize, header.size));
+    ++mFrontAcked;
+    --mPending;
+    --count;
+  }
+  // 写入段之外的段全部确认后即可删除
+  while (mSegments.size() > 1 && mAck->offset >= mSegments.front().end)
+    popFrontSegment();
+}
+
+bool SpillQueue::empty() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mPending == 0;
+}
+
+std::uint64_t SpillQueue::getPendingCount() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mPending;
+}
+
+std::uint64_t SpillQueue::getDiskBytes() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::uint64_t bytes = 0;
+  for (auto& segment : mSegments) bytes += segment.size;
+  return bytes;
+}
+
+std::uint64_t SpillQueue::getDroppedCount() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mDropped;
+}
+
+}  // namespace common
+}  // namespace sophon_stream
@@ -0,0 +1,150 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_COMMON_SPILL_QUEUE_H_
+#define SOPHON_STREAM_COMMON_SPILL_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace common {
+
+struct SpillQueueConfig {
+  /**
+   * @brief 段文件和确认位置文件所在的目录，不存在时创建
+   */
+  std::string dir;
+  /**
+   * @brief 磁盘占用上限，超出时删除最旧的段文件，其中未发送的记录被丢弃
+   */
+  std::uint64_t maxBytes = 256ull << 20;
+  /**
+   * @brief 单个段文件的大小，单条记录不能超过一个段
+   */
+  std::uint64_t segmentBytes = 16ull << 20;
+};
+
+struct SpillRecord {
+  std::string contentType;
+  std::string body;
+};
+
+/**
+ * @brief 落盘的先进先出队列，用于上报端不可用时暂存结果
+ * @details
+ * 数据只追加写入固定大小的段文件（预先分配空间后mmap），每条记录为
+ * {magic, 长度, 校验和, contentType长度} + contentType + body，
+ * 写满后新建下一个段。读取端通过peek()取出队首的记录，发送成功后ack()，
+ * 确认位置{段号, 偏移}保存在单独mmap的ack文件中，整段确认后删除该段文件。
+ * @details
+ * 重启后从ack文件记录的位置继续读取，并逐条校验记录找到每个段的有效末尾，
+ * 进程崩溃时写了一半的记录会被丢弃。ack在发送成功之后才写入，
+ * 崩溃前已发送但未确认的记录会被再次发送（至少一次）。
+ * 数据依赖页缓存回写落盘，不对每条记录fsync，掉电时可能丢失最近几秒的记录。
+ */
+class SpillQueue : public NoCopyable {
+ public:
+  explicit SpillQueue(const SpillQueueConfig& config);
+  ~SpillQueue();
+
+  /**
+   * @brief 创建目录，加载已有的段文件和确认位置
+   * @return 目录或ack文件无法创建时返回false
+   */
+  bool open();
+
+  /**
+   * @brief 追加一条记录
+   * @return 记录超过段大小或磁盘空间不足时返回false，记录被丢弃
+   */
+  bool append(const char* contentType, const char* data, std::size_t size);
+
+  /**
+   * @brief 从队首开始复制最多maxCount条未确认的记录，不移动确认位置
+   * @return 复制的记录数量，records中多余的元素保留容量
+   */
+  std::size_t peek(std::vector<SpillRecord>& records, std::size_t maxCount);
+
+  /**
+   * @brief 确认队首的count条记录。peek()之后因超过磁盘上限被删除的记录从count中扣除，
+   * 不会误确认其后尚未发送的记录
+   */
+  void ack(std::size_t count);
+
+  bool empty();
+  /**
+   * @brief 未确认的记录数量
+   */
+  std::uint64_t getPendingCount();
+  /**
+   * @brief 段文件占用的磁盘空间
+   */
+  std::uint64_t getDiskBytes();
+  /**
+   * @brief 因超过磁盘上限或写入失败被丢弃的记录数量
+   */
+  std::uint64_t getDroppedCount();
+
+ private:
+  struct Segment {
+    std::uint64_t id = 0;
+    char* data = nullptr;
+    std::uint64_t size = 0;
+    /**
+     * @brief 有效记录的末尾，最后一个段即为写入位置
+     */
+    std::uint64_t end = 0;
+    std::uint64_t records = 0;
+  };
+
+  /**
+   * @brief mmap到ack文件中的确认位置
+   */
+  struct AckPosition {
+    std::uint64_t segment;
+    std::uint64_t offset;
+  };
+
+  std::string segmentPath(std::uint64_t id) const;
+  bool mapSegment(Segment& segment, bool create);
+  /**
+   * @brief 逐条校验段内的记录，确定有效末尾和记录数量
+   */
+  void scanSegment(Segment& segment);
+  bool rollSegment();
+  /**
+   * @brief 删除队首的段，确认位置移到下一个段的开头
+   */
+  void popFrontSegment();
+  void setAck(std::uint64_t segment, std::uint64_t offset);
+
+  const SpillQueueConfig mConfig;
+  std::mutex mMutex;
+  std::deque<Segment> mSegments;
+  AckPosition* mAck = nullptr;
+  /**
+   * @brief 队首段中已确认的记录数量
+   */
+  std::uint64_t mFrontAcked = 0;
+  std::uint64_t mPending = 0;
+  std::uint64_t mDropped = 0;
+  std::uint64_t mDroppedSincePeek = 0;
+};
+
+}  // namespace common
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_COMMON_SPILL_QUEUE_H_
@@ -12,6 +12,22 @@ enum TrackFlag { TrNormal, TrLast };
 struct TrackedObjectMetadata {
   TrackedObjectMetadata() : mPerferScore(0.f), mCoverArea(0) {}
 
+  /**
+   * @brief 恢复到刚构造时的状态，由ObjectPool回收时调用
+   */
+  void reset() {
+    mUuid.clear();
+    mPerferScore = 0.f;
+    mCoverArea = 0;
+    mName.clear();
+    mTrackerFilter = false;
+    mTrackId = -1;
+    mTrackFlag = TrNormal;
+    mQualityScore = 0.0;
+    mCaptureTime.clear();
+    mImagePath.clear();
+  }
+
   std::string mUuid;
   float mPerferScore;
   int mCoverArea;
@@ -0,0 +1,184 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// TARGET_ARCH=host时代替libsophon的bmcv_api_ext.h。
+// 图像数据放在host内存中，裁剪、缩放、格式转换、convert_to和jpeg编解码
+// 在CPU上实现，支持的格式见framework/host/README.md。
+
+#ifndef SOPHON_STREAM_HOST_BMCV_API_EXT_H_
+#define SOPHON_STREAM_HOST_BMCV_API_EXT_H_
+
+#include "bmlib_runtime.h"
+
+// 与libsophon一致按C链接导出
+extern "C" {
+
+#define BMCV_HEAP_ANY (-1)
+
+typedef enum bm_image_format_ext_ {
+  FORMAT_YUV420P,
+  FORMAT_YUV422P,
+  FORMAT_YUV444P,
+  FORMAT_NV12,
+  FORMAT_NV21,
+  FORMAT_NV16,
+  FORMAT_NV61,
+  FORMAT_NV24,
+  FORMAT_RGB_PLANAR,
+  FORMAT_BGR_PLANAR,
+  FORMAT_RGB_PACKED,
+  FORMAT_BGR_PACKED,
+  FORMAT_RGBP_SEPARATE,
+  FORMAT_BGRP_SEPARATE,
+  FORMAT_GRAY,
+  FORMAT_COMPRESSED,
+  FORMAT_HSV_PLANAR,
+  FORMAT_ARGB_PACKED,
+  FORMAT_ABGR_PACKED,
+  FORMAT_YUV444_PACKED,
+  FORMAT_YVU444_PACKED,
+  FORMAT_YUV422_YUYV,
+  FORMAT_YUV422_YVYU,
+  FORMAT_YUV422_UYVY,
+  FORMAT_YUV422_VYUY,
+  FORMAT_RGBYP_PLANAR,
+  FORMAT_HSV180_PACKED,
+  FORMAT_HSV256_PACKED,
+  FORMAT_BAYER,
+  FORMAT_BAYER_RG8
+} bm_image_format_ext;
+
+typedef enum bm_image_data_format_ext_ {
+  DATA_TYPE_EXT_FLOAT32,
+  DATA_TYPE_EXT_1N_BYTE,
+  DATA_TYPE_EXT_4N_BYTE,
+  DATA_TYPE_EXT_1N_BYTE_SIGNED,
+  DATA_TYPE_EXT_4N_BYTE_SIGNED,
+  DATA_TYPE_EXT_FP16,
+  DATA_TYPE_EXT_BF16
+} bm_image_data_format_ext;
+
+struct bm_image_private;
+
+typedef struct bm_image {
+  int width;
+  int height;
+  bm_image_format_ext image_format;
+  bm_image_data_format_ext data_type;
+  struct bm_image_private* image_private;
+} bm_image;
+
+typedef struct bmcv_rect {
+  int start_x;
+  int start_y;
+  int crop_w;
+  int crop_h;
+} bmcv_rect_t;
+
+typedef struct bmcv_padding_atrr_s {
+  unsigned int dst_crop_stx;
+  unsigned int dst_crop_sty;
+  unsigned int dst_crop_w;
+  unsigned int dst_crop_h;
+  unsigned char padding_r;
+  unsigned char padding_g;
+  unsigned char padding_b;
+  int if_memset;
+} bmcv_padding_atrr_t;
+
+typedef struct bmcv_copy_to_atrr_s {
+  int start_x;
+  int start_y;
+  unsigned char padding_r;
+  unsigned char padding_g;
+  unsigned char padding_b;
+  int if_padding;
+} bmcv_copy_to_atrr_t;
+
+typedef struct bmcv_convert_to_attr_s {
+  float alpha_0;
+  float beta_0;
+  float alpha_1;
+  float beta_1;
+  float alpha_2;
+  float beta_2;
+} bmcv_convert_to_attr;
+
+typedef enum bmcv_resize_algorithm_ {
+  BMCV_INTER_NEAREST = 0,
+  BMCV_INTER_LINEAR = 1,
+  BMCV_INTER_BICUBIC = 2
+} bmcv_resize_algorithm;
+
+bm_status_t bm_image_create(bm_handle_t handle, int img_h, int img_w,
+                            bm_image_format_ext image_format,
+                            bm_image_data_format_ext data_type,
+                            bm_image* image, int* stride = NULL);
+/**
+ * @brief 释放bm_image_alloc_dev_mem申请的内存，attach的内存由调用者释放
+ */
+bm_status_t bm_image_destroy(bm_image image);
+bm_handle_t bm_image_get_handle(bm_image* image);
+bool bm_image_is_attached(bm_image image);
+int bm_image_get_plane_num(bm_image image);
+bm_status_t bm_image_get_stride(bm_image image, int* stride);
+bm_status_t bm_image_get_byte_size(bm_image image, int* size);
+bm_status_t bm_image_get_device_mem(bm_image image, bm_device_mem_t* mem);
+bm_status_t bm_image_alloc_dev_mem(bm_image image, int heap_id = BMCV_HEAP_ANY);
+bm_status_t bm_image_alloc_dev_mem_heap_mask(bm_image image, int heap_mask);
+bm_status_t bm_image_attach(bm_image image, bm_device_mem_t* device_memory);
+bm_status_t bm_image_detach(bm_image image);
+bm_status_t bm_image_copy_host_to_device(bm_image image, void* buffers[]);
+bm_status_t bm_image_copy_device_to_host(bm_image image, void* buffers[]);
+bm_status_t bm_image_alloc_contiguous_mem(int image_num, bm_image* images,
+                                          int heap_id = BMCV_HEAP_ANY);
+bm_status_t bm_image_free_contiguous_mem(int image_num, bm_image* images);
+bm_status_t bm_image_attach_contiguous_mem(int image_num, bm_image* images,
+                                           bm_device_mem_t dmem);
+bm_status_t bm_image_detach_contiguous_mem(int image_num, bm_image* images);
+
+bm_status_t bmcv_image_vpp_convert(
+    bm_handle_t handle, int output_num, bm_image input, bm_image* output,
+    bmcv_rect_t* crop_rect = NULL,
+    bmcv_resize_algorithm algorithm = BMCV_INTER_LINEAR);
+bm_status_t bmcv_image_vpp_convert_padding(
+    bm_handle_t handle, int output_num, bm_image input, bm_image* output,
+    bmcv_padding_atrr_t* padding_attr, bmcv_rect_t* crop_rect = NULL,
+    bmcv_resize_algorithm algorithm = BMCV_INTER_LINEAR);
+bm_status_t bmcv_image_crop(bm_handle_t handle, int crop_num,
+                            bmcv_rect_t* rects, bm_image input,
+                            bm_image* output);
+bm_status_t bmcv_image_storage_convert(bm_handle_t handle, int image_num,
+                                       bm_image* input, bm_image* output);
+bm_status_t bmcv_image_copy_to(bm_handle_t handle,
+                               bmcv_copy_to_atrr_t copy_to_attr,
+                               bm_image input, bm_image output);
+bm_status_t bmcv_image_convert_to(bm_handle_t handle, int input_num,
+                                  bmcv_convert_to_attr convert_to_attr,
+                                  bm_image* input, bm_image* output);
+/**
+ * @brief p_jpeg_data[i]为空时用malloc申请，由调用者free
+ */
+bm_status_t bmcv_image_jpeg_enc(bm_handle_t handle, int image_num,
+                                bm_image* src, void* p_jpeg_data[],
+                                size_t* out_size, int quality_factor = 85);
+/**
+ * @brief dst[i]没有创建时按jpeg的尺寸创建FORMAT_YUV420P的图像
+ */
+bm_status_t bmcv_image_jpeg_dec(bm_handle_t handle, void* p_jpeg_data[],
+                                size_t* in_size, int image_num, bm_image* dst);
+/**
+ * @brief len[0]为输入的字节数，返回时len[1]为输出的字节数
+ */
+bm_status_t bmcv_base64_enc(bm_handle_t handle, bm_device_mem_t src,
+                            bm_device_mem_t dst, unsigned long len[2]);
+
+}  // extern "C"
+
+#endif  // SOPHON_STREAM_HOST_BMCV_API_EXT_H_
@@ -0,0 +1,170 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// TARGET_ARCH=host时代替libsophon的bmlib_runtime.h。
+// 只声明framework和element用到的部分，类型布局与libsophon一致，
+// 设备内存用host内存实现，设备地址即host指针。
+
+#ifndef SOPHON_STREAM_HOST_BMLIB_RUNTIME_H_
+#define SOPHON_STREAM_HOST_BMLIB_RUNTIME_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// 与libsophon一致按C链接导出
+extern "C" {
+
+typedef enum {
+  BM_SUCCESS = 0,
+  BM_ERR_DEVNOTREADY = 1,
+  BM_ERR_FAILURE = 2,
+  BM_ERR_TIMEOUT = 3,
+  BM_ERR_PARAM = 4,
+  BM_ERR_NOMEM = 5,
+  BM_ERR_DATA = 6,
+  BM_ERR_BUSY = 7,
+  BM_ERR_NOFEATURE = 8,
+  BM_NOT_SUPPORTED = 9
+} bm_status_t;
+
+struct bm_context;
+typedef struct bm_context* bm_handle_t;
+
+typedef enum {
+  BM_MEM_TYPE_DEVICE = 0,
+  BM_MEM_TYPE_HOST = 1,
+  BM_MEM_TYPE_SYSTEM = 2,
+  BM_MEM_TYPE_INT8_DEVICE = 3,
+  BM_MEM_TYPE_INVALID = 4
+} bm_mem_type_t;
+
+typedef union {
+  struct {
+    bm_mem_type_t mem_type : 3;
+    unsigned int gmem_heapid : 3;
+    unsigned int reserved : 26;
+  } u;
+  unsigned int rawflags;
+} bm_mem_flags_t;
+
+typedef struct bm_mem_desc {
+  union {
+    struct {
+      unsigned long device_addr;
+      unsigned int reserved;
+      int dmabuf_fd;
+    } device;
+    struct {
+      void* system_addr;
+      unsigned int reserved0;
+      int reserved1;
+    } system;
+  } u;
+  bm_mem_flags_t flags;
+  unsigned int size;
+} bm_mem_desc_t;
+
+typedef struct bm_mem_desc bm_device_mem_t;
+typedef struct bm_mem_desc bm_system_mem_t;
+
+struct bm_misc_info {
+  int pcie_soc_mode;  // 0: pcie, 1: soc
+  int ddr_ecc_enable;
+  long long ddr0a_size;
+  long long ddr0b_size;
+  long long ddr1_size;
+  long long ddr2_size;
+  unsigned int chipid;
+  unsigned int chipid_bit_mask;
+  unsigned int driver_version;
+  int domain_bdf;
+  int board_version;
+  int a53_enable;
+  int dyn_enable;
+};
+
+// host运行时报告的芯片号，不走BM1684X专有的tpu_kernel路径
+#define BM_HOST_CHIPID 0x1684
+
+bm_status_t bm_dev_request(bm_handle_t* handle, int devid);
+void bm_dev_free(bm_handle_t handle);
+int bm_get_devid(bm_handle_t handle);
+bm_status_t bm_dev_getcount(int* count);
+bm_status_t bm_get_misc_info(bm_handle_t handle, struct bm_misc_info* pmisc_info);
+bm_status_t bm_get_chipid(bm_handle_t handle, unsigned int* p_chipid);
+bm_status_t bm_thread_sync(bm_handle_t handle);
+bm_status_t bm_thread_sync_from_core(bm_handle_t handle, int core_id);
+
+bm_device_mem_t bm_mem_from_device(unsigned long long device_addr,
+                                   unsigned int len);
+bm_system_mem_t bm_mem_from_system(void* system_addr);
+bm_device_mem_t bm_mem_null(void);
+unsigned long long bm_mem_get_device_addr(bm_device_mem_t mem);
+void bm_mem_set_device_addr(bm_device_mem_t* pmem, unsigned long long addr);
+unsigned int bm_mem_get_device_size(bm_device_mem_t mem);
+void bm_mem_set_device_size(bm_device_mem_t* pmem, unsigned int size);
+void bm_set_device_mem(bm_device_mem_t* pmem, unsigned int size,
+                       unsigned long long addr);
+
+bm_status_t bm_malloc_device_byte(bm_handle_t handle, bm_device_mem_t* pmem,
+                                  unsigned int size);
+bm_status_t bm_malloc_device_byte_heap(bm_handle_t handle,
+                                       bm_device_mem_t* pmem, int heap_id,
+                                       unsigned int size);
+bm_status_t bm_malloc_device_byte_heap_mask(bm_handle_t handle,
+                                            bm_device_mem_t* pmem,
+                                            int heap_id_mask,
+                                            unsigned int size);
+void bm_free_device(bm_handle_t handle, bm_device_mem_t mem);
+
+bm_status_t bm_memcpy_s2d(bm_handle_t handle, bm_device_mem_t dst, void* src);
+bm_status_t bm_memcpy_d2s(bm_handle_t handle, void* dst, bm_device_mem_t src);
+bm_status_t bm_memcpy_s2d_partial(bm_handle_t handle, bm_device_mem_t dst,
+                                  void* src, unsigned int size);
+bm_status_t bm_memcpy_d2s_partial(bm_handle_t handle, void* dst,
+                                  bm_device_mem_t src, unsigned int size);
+bm_status_t bm_memcpy_s2d_partial_offset(bm_handle_t handle,
+                                         bm_device_mem_t dst, void* src,
+                                         unsigned int size,
+                                         unsigned int offset);
+bm_status_t bm_memcpy_d2s_partial_offset(bm_handle_t handle, void* dst,
+                                         bm_device_mem_t src,
+                                         unsigned int size,
+                                         unsigned int offset);
+bm_status_t bm_memcpy_d2d_byte(bm_handle_t handle, bm_device_mem_t dst,
+                               size_t dst_offset, bm_device_mem_t src,
+                               size_t src_offset, size_t size);
+bm_status_t bm_memset_device(bm_handle_t handle, const int value,
+                             bm_device_mem_t mem);
+
+// host内存本身可以直接访问，map即返回设备地址，invalidate和flush不做任何事
+bm_status_t bm_mem_mmap_device_mem(bm_handle_t handle, bm_device_mem_t* dmem,
+                                   unsigned long long* vmem);
+bm_status_t bm_mem_unmap_device_mem(bm_handle_t handle, void* vmem, int size);
+bm_status_t bm_mem_invalidate_device_mem(bm_handle_t handle,
+                                         bm_device_mem_t* dmem);
+bm_status_t bm_mem_flush_device_mem(bm_handle_t handle, bm_device_mem_t* dmem);
+
+// tpu_kernel只在BM1684X上可用，host运行时加载模块总是失败
+typedef void* tpu_kernel_module_t;
+typedef int tpu_kernel_function_t;
+
+tpu_kernel_module_t tpu_kernel_load_module_file(bm_handle_t handle,
+                                                const char* module_file);
+tpu_kernel_function_t tpu_kernel_get_function(bm_handle_t handle,
+                                              tpu_kernel_module_t module,
+                                              const char* function);
+bm_status_t tpu_kernel_launch(bm_handle_t handle, tpu_kernel_function_t func_id,
+                              void* param, size_t size);
+bm_status_t tpu_kernel_unload_module(bm_handle_t handle,
+                                     tpu_kernel_module_t p_module);
+
+}  // extern "C"
+
+#endif  // SOPHON_STREAM_HOST_BMLIB_RUNTIME_H_
@@ -0,0 +1,121 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// TARGET_ARCH=host时代替libsophon的bmruntime_interface.h。
+// bmrt_load_bmodel读取的是描述网络输入输出的json文件，
+// 推理由host_network.h中注册的NetworkBackend在CPU上完成。
+
+#ifndef SOPHON_STREAM_HOST_BMRUNTIME_INTERFACE_H_
+#define SOPHON_STREAM_HOST_BMRUNTIME_INTERFACE_H_
+
+#include "bmlib_runtime.h"
+
+// 与libsophon一致按C链接导出
+extern "C" {
+
+typedef enum bm_data_type_e {
+  BM_FLOAT32 = 0,
+  BM_FLOAT16 = 1,
+  BM_INT8 = 2,
+  BM_UINT8 = 3,
+  BM_INT16 = 4,
+  BM_UINT16 = 5,
+  BM_INT32 = 6,
+  BM_UINT32 = 7,
+  BM_BFLOAT16 = 8
+} bm_data_type_t;
+
+typedef enum bm_store_mode_e {
+  BM_STORE_1N = 0,
+  BM_STORE_2N = 1,
+  BM_STORE_4N = 2
+} bm_store_mode_t;
+
+#define BM_MAX_DIMS_NUM 8
+
+typedef struct bm_shape_s {
+  int num_dims;
+  int dims[BM_MAX_DIMS_NUM];
+} bm_shape_t;
+
+typedef struct bm_tensor_s {
+  bm_data_type_t dtype;
+  bm_shape_t shape;
+  bm_device_mem_t device_mem;
+  bm_store_mode_t st_mode;
+} bm_tensor_t;
+
+typedef struct bm_stage_info_s {
+  bm_shape_t* input_shapes;
+  bm_shape_t* output_shapes;
+  bm_device_mem_t* input_mems;
+  bm_device_mem_t* output_mems;
+} bm_stage_info_t;
+
+typedef struct bm_net_info_s {
+  const char* name;
+  bool is_dynamic;
+  int input_num;
+  char const** input_names;
+  bm_data_type_t* input_dtypes;
+  float* input_scales;
+  int output_num;
+  char const** output_names;
+  bm_data_type_t* output_dtypes;
+  float* output_scales;
+  int stage_num;
+  bm_stage_info_t* stages;
+  size_t* max_input_bytes;
+  size_t* max_output_bytes;
+  int* input_zero_point;
+  int* output_zero_point;
+  int* input_loc_devices;
+  int* output_loc_devices;
+  int core_num;
+} bm_net_info_t;
+
+size_t bmrt_data_type_size(bm_data_type_t dtype);
+uint64_t bmrt_shape_count(const bm_shape_t* shape);
+bool bmrt_shape_is_same(const bm_shape_t* left, const bm_shape_t* right);
+size_t bmrt_tensor_bytesize(const bm_tensor_t* tensor);
+size_t bmrt_tensor_device_size(const bm_tensor_t* tensor);
+bool bmrt_tensor(bm_tensor_t* tensor, void* p_bmrt, bm_data_type_t dtype,
+                 bm_shape_t shape);
+
+void* bmrt_create(bm_handle_t bm_handle);
+void bmrt_destroy(void* p_bmrt);
+void* bmrt_get_bm_handle(void* p_bmrt);
+/**
+ * @brief 加载网络描述文件，格式见framework/host/README.md
+ */
+bool bmrt_load_bmodel(void* p_bmrt, const char* bmodel_path);
+int bmrt_get_network_number(void* p_bmrt);
+/**
+ * @brief network_names由调用者free
+ */
+void bmrt_get_network_names(void* p_bmrt, const char*** network_names);
+const bm_net_info_t* bmrt_get_network_info(void* p_bmrt, const char* net_name);
+
+bool bmrt_launch_tensor(void* p_bmrt, const char* net_name,
+                        const bm_tensor_t input_tensors[], int input_num,
+                        bm_tensor_t output_tensors[], int output_num);
+bool bmrt_launch_tensor_ex(void* p_bmrt, const char* net_name,
+                           const bm_tensor_t input_tensors[], int input_num,
+                           bm_tensor_t output_tensors[], int output_num,
+                           bool user_mem, bool user_stmode);
+bool bmrt_launch_tensor_multi_cores(void* p_bmrt, const char* net_name,
+                                    const bm_tensor_t input_tensors[],
+                                    int input_num, bm_tensor_t output_tensors[],
+                                    int output_num, bool user_mem,
+                                    bool user_stmode, const int* core_list,
+                                    int core_num);
+
+}  // extern "C"
+
+#endif  // SOPHON_STREAM_HOST_BMRUNTIME_INTERFACE_H_
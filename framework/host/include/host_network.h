@@ -0,0 +1,64 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_HOST_HOST_NETWORK_H_
+#define SOPHON_STREAM_HOST_HOST_NETWORK_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "bmruntime_interface.h"
+#include "nlohmann/json.hpp"
+
+namespace sophon_stream {
+namespace host {
+
+/**
+ * @brief host运行时中一个网络的推理实现
+ * @details
+ * bmrt_launch_tensor_ex调用forward时输入输出的device_mem都是host内存，
+ * shape为本次推理的stage，dims[0]为batch。
+ * 同一个网络可能被多个element线程同时调用，forward需要线程安全
+ */
+class NetworkBackend {
+ public:
+  virtual ~NetworkBackend() = default;
+
+  /**
+   * @return 失败时bmrt_launch_tensor_ex返回false
+   */
+  virtual bool forward(const bm_net_info_t& info, const bm_tensor_t* inputs,
+                       int inputNum, bm_tensor_t* outputs, int outputNum) = 0;
+};
+
+/**
+ * @param[in] config : 网络描述文件中该网络的backend字段
+ * @return 配置错误时返回nullptr
+ */
+using NetworkBackendMaker =
+    std::function<std::unique_ptr<NetworkBackend>(const nlohmann::json& config)>;
+
+/**
+ * @brief 注册backend，网络描述文件中backend.type为name的网络用maker创建
+ * @details
+ * 内置deterministic和replay两种，见framework/host/README.md。
+ * 需要在bmrt_load_bmodel之前注册，重名时返回false
+ */
+bool registerNetworkBackend(const std::string& name, NetworkBackendMaker maker);
+
+/**
+ * @brief 按类型创建backend，找不到类型或配置错误时返回nullptr
+ */
+std::unique_ptr<NetworkBackend> makeNetworkBackend(const nlohmann::json& config);
+
+}  // namespace host
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_HOST_HOST_NETWORK_H_
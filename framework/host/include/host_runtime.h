@@ -0,0 +1,38 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_HOST_HOST_RUNTIME_H_
+#define SOPHON_STREAM_HOST_HOST_RUNTIME_H_
+
+#include <cstddef>
+
+namespace sophon_stream {
+namespace host {
+
+struct DeviceMemoryStats {
+  /**
+   * @brief 尚未bm_free_device的内存
+   */
+  std::size_t bytes = 0;
+  std::size_t blocks = 0;
+  /**
+   * @brief 累计申请次数
+   */
+  std::size_t allocations = 0;
+};
+
+/**
+ * @brief host运行时的设备内存统计，用于在回归测试中检查显存泄漏
+ */
+DeviceMemoryStats getDeviceMemoryStats();
+
+}  // namespace host
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_HOST_HOST_RUNTIME_H_
@@ -0,0 +1,1035 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// bmcv图像操作的CPU实现。
+// 裁剪、缩放和格式转换统一先把源区域转成BGR packed，缩放后再写成目标格式，
+// 只支持DATA_TYPE_EXT_1N_BYTE；convert_to按内存中的通道顺序逐通道做线性变换。
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// jpeglib.h依赖size_t和FILE，需要在<cstdio>之后引用
+#include <jpeglib.h>
+
+#include "bmcv_api_ext.h"
+#include "host_memory.h"
+
+#define HOST_MAX_PLANES 4
+
+struct bm_image_private {
+  bm_handle_t handle = nullptr;
+  int planeNum = 0;
+  int stride[HOST_MAX_PLANES] = {0};
+  int planeHeight[HOST_MAX_PLANES] = {0};
+  bm_device_mem_t mem[HOST_MAX_PLANES];
+  bool attached = false;
+  /**
+   * @brief mem由bm_image_alloc_dev_mem申请，destroy时释放
+   */
+  bool owned = false;
+};
+
+namespace sophon_stream {
+namespace host {
+
+namespace {
+
+int dataTypeSize(bm_image_data_format_ext dataType) {
+  switch (dataType) {
+    case DATA_TYPE_EXT_FLOAT32:
+      return 4;
+    case DATA_TYPE_EXT_FP16:
+    case DATA_TYPE_EXT_BF16:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
+/**
+ * @brief 各平面默认的每行元素数和行数
+ */
+bool planeLayout(bm_image_format_ext format, int w, int h, int* planeNum,
+                 int* rowElements, int* rows) {
+  int halfW = (w + 1) / 2, halfH = (h + 1) / 2;
+  auto set = [&](std::initializer_list<int> elements,
+                 std::initializer_list<int> heights) {
+    *planeNum = static_cast<int>(elements.size());
+    std::copy(elements.begin(), elements.end(), rowElements);
+    std::copy(heights.begin(), heights.end(), rows);
+  };
+  switch (format) {
+    case FORMAT_YUV420P:
+      set({w, halfW, halfW}, {h, halfH, halfH});
+      break;
+    case FORMAT_YUV422P:
+      set({w, halfW, halfW}, {h, h, h});
+      break;
+    case FORMAT_YUV444P:
+    case FORMAT_RGBP_SEPARATE:
+    case FORMAT_BGRP_SEPARATE:
+      set({w, w, w}, {h, h, h});
+      break;
+    case FORMAT_NV12:
+    case FORMAT_NV21:
+      set({w, halfW * 2}, {h, halfH});
+      break;
+    case FORMAT_NV16:
+    case FORMAT_NV61:
+      set({w, halfW * 2}, {h, h});
+      break;
+    case FORMAT_NV24:
+      set({w, w * 2}, {h, h});
+      break;
+    case FORMAT_RGB_PLANAR:
+    case FORMAT_BGR_PLANAR:
+    case FORMAT_HSV_PLANAR:
+      set({w}, {h * 3});
+      break;
+    case FORMAT_RGB_PACKED:
+    case FORMAT_BGR_PACKED:
+    case FORMAT_YUV444_PACKED:
+    case FORMAT_YVU444_PACKED:
+    case FORMAT_HSV180_PACKED:
+    case FORMAT_HSV256_PACKED:
+      set({w * 3}, {h});
+      break;
+    case FORMAT_ARGB_PACKED:
+    case FORMAT_ABGR_PACKED:
+      set({w * 4}, {h});
+      break;
+    case FORMAT_YUV422_YUYV:
+    case FORMAT_YUV422_YVYU:
+    case FORMAT_YUV422_UYVY:
+    case FORMAT_YUV422_VYUY:
+      set({w * 2}, {h});
+      break;
+    case FORMAT_RGBYP_PLANAR:
+      set({w, w, w, w}, {h, h, h, h});
+      break;
+    case FORMAT_GRAY:
+    case FORMAT_BAYER:
+    case FORMAT_BAYER_RG8:
+    case FORMAT_COMPRESSED:
+      set({w}, {h});
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+bool isCreated(const bm_image& image) { return image.image_private != nullptr; }
+
+bool hasMemory(const bm_image& image) {
+  return isCreated(image) && image.image_private->planeNum > 0 &&
+         bm_mem_get_device_addr(image.image_private->mem[0]) != 0;
+}
+
+unsigned char* planeData(const bm_image& image, int plane) {
+  return hostPointer(image.image_private->mem[plane]);
+}
+
+int planeBytes(const bm_image& image, int plane) {
+  return image.image_private->stride[plane] *
+         image.image_private->planeHeight[plane];
+}
+
+/**
+ * @brief 每个通道一行的起始地址和相邻像素的元素间隔，只用于不分块采样的格式
+ */
+struct ChannelLayout {
+  int channels = 0;
+  int step = 1;
+  /**
+   * @brief 返回第c个通道（按内存顺序）第y行的起始地址
+   */
+  unsigned char* row(const bm_image& image, int c, int y) const {
+    auto priv = image.image_private;
+    switch (image.image_format) {
+      case FORMAT_RGB_PLANAR:
+      case FORMAT_BGR_PLANAR:
+        return planeData(image, 0) +
+               static_cast<std::size_t>(c * image.height + y) * priv->stride[0];
+      case FORMAT_RGBP_SEPARATE:
+      case FORMAT_BGRP_SEPARATE:
+        return planeData(image, c) +
+               static_cast<std::size_t>(y) * priv->stride[c];
+      default:
+        return planeData(image, 0) +
+               static_cast<std::size_t>(y) * priv->stride[0] +
+               c * dataTypeSize(image.data_type);
+    }
+  }
+};
+
+bool channelLayout(bm_image_format_ext format, ChannelLayout* layout) {
+  switch (format) {
+    case FORMAT_RGB_PLANAR:
+    case FORMAT_BGR_PLANAR:
+    case FORMAT_RGBP_SEPARATE:
+    case FORMAT_BGRP_SEPARATE:
+      layout->channels = 3;
+      layout->step = 1;
+      return true;
+    case FORMAT_RGB_PACKED:
+    case FORMAT_BGR_PACKED:
+      layout->channels = 3;
+      layout->step = 3;
+      return true;
+    case FORMAT_GRAY:
+      layout->channels = 1;
+      layout->step = 1;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isBgrOrder(bm_image_format_ext format) {
+  return format == FORMAT_BGR_PLANAR || format == FORMAT_BGR_PACKED ||
+         format == FORMAT_BGRP_SEPARATE;
+}
+
+/**
+ * @brief YUV格式的色度采样方式
+ */
+struct ChromaLayout {
+  int shiftX = 0;
+  int shiftY = 0;
+  /**
+   * @brief UV在同一个平面中交错存放
+   */
+  bool interleaved = false;
+  bool vFirst = false;
+};
+
+bool chromaLayout(bm_image_format_ext format, ChromaLayout* layout) {
+  switch (format) {
+    case FORMAT_YUV420P:
+      *layout = {1, 1, false, false};
+      return true;
+    case FORMAT_YUV422P:
+      *layout = {1, 0, false, false};
+      return true;
+    case FORMAT_YUV444P:
+      *layout = {0, 0, false, false};
+      return true;
+    case FORMAT_NV12:
+      *layout = {1, 1, true, false};
+      return true;
+    case FORMAT_NV21:
+      *layout = {1, 1, true, true};
+      return true;
+    case FORMAT_NV16:
+      *layout = {1, 0, true, false};
+      return true;
+    case FORMAT_NV61:
+      *layout = {1, 0, true, true};
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isConvertible(const bm_image& image) {
+  ChannelLayout channels;
+  ChromaLayout chroma;
+  return hasMemory(image) && image.data_type == DATA_TYPE_EXT_1N_BYTE &&
+         (channelLayout(image.image_format, &channels) ||
+          chromaLayout(image.image_format, &chroma));
+}
+
+unsigned char saturate(int value) {
+  return static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+}
+
+// BT.601 limited range，与VPP一致，系数放大1024倍
+void yuvToBgr(int y, int u, int v, unsigned char* bgr) {
+  int c = 1192 * (std::max(y, 16) - 16);
+  int d = u - 128, e = v - 128;
+  bgr[0] = saturate((c + 2066 * d + 512) >> 10);
+  bgr[1] = saturate((c - 401 * d - 833 * e + 512) >> 10);
+  bgr[2] = saturate((c + 1634 * e + 512) >> 10);
+}
+
+int bgrToY(const unsigned char* bgr) {
+  return (100 * bgr[0] + 516 * bgr[1] + 263 * bgr[2] + 512 + (16 << 10)) >> 10;
+}
+
+int bgrToU(int b, int g, int r) {
+  return (450 * b - 298 * g - 152 * r + 512 + (128 << 10)) >> 10;
+}
+
+int bgrToV(int b, int g, int r) {
+  return (-73 * b - 377 * g + 450 * r + 512 + (128 << 10)) >> 10;
+}
+
+/**
+ * @brief 把image中rect区域转成BGR packed
+ */
+void readBgr(const bm_image& image, const bmcv_rect_t& rect,
+             std::vector<unsigned char>& bgr) {
+  bgr.resize(static_cast<std::size_t>(rect.crop_w) * rect.crop_h * 3);
+  ChannelLayout channels;
+  ChromaLayout chroma;
+  if (channelLayout(image.image_format, &channels)) {
+    bool bgrOrder = isBgrOrder(image.image_format);
+    for (int y = 0; y < rect.crop_h; ++y) {
+      unsigned char* out = &bgr[static_cast<std::size_t>(y) * rect.crop_w * 3];
+      if (channels.channels == 1) {
+        const unsigned char* gray =
+            channels.row(image, 0, rect.start_y + y) + rect.start_x;
+        for (int x = 0; x < rect.crop_w; ++x)
+          out[3 * x] = out[3 * x + 1] = out[3 * x + 2] = gray[x];
+        continue;
+      }
+      for (int c = 0; c < 3; ++c) {
+        const unsigned char* in = channels.row(image, c, rect.start_y + y) +
+                                  rect.start_x * channels.step;
+        int target = bgrOrder ? c : 2 - c;
+        for (int x = 0; x < rect.crop_w; ++x)
+          out[3 * x + target] = in[x * channels.step];
+      }
+    }
+    return;
+  }
+  chromaLayout(image.image_format, &chroma);
+  auto priv = image.image_private;
+  for (int y = 0; y < rect.crop_h; ++y) {
+    int sy = rect.start_y + y;
+    int cy = sy >> chroma.shiftY;
+    const unsigned char* luma = planeData(image, 0) +
+                                static_cast<std::size_t>(sy) * priv->stride[0];
+    const unsigned char* plane1 = planeData(image, 1) +
+                                  static_cast<std::size_t>(cy) * priv->stride[1];
+    const unsigned char* plane2 =
+        chroma.interleaved ? nullptr
+                           : planeData(image, 2) +
+                                 static_cast<std::size_t>(cy) * priv->stride[2];
+    unsigned char* out = &bgr[static_cast<std::size_t>(y) * rect.crop_w * 3];
+    for (int x = 0; x < rect.crop_w; ++x) {
+      int sx = rect.start_x + x;
+      int cx = sx >> chroma.shiftX;
+      int u, v;
+      if (chroma.interleaved) {
+        u = plane1[2 * cx];
+        v = plane1[2 * cx + 1];
+        if (chroma.vFirst) std::swap(u, v);
+      } else {
+        u = plane1[cx];
+        v = plane2[cx];
+      }
+      yuvToBgr(luma[sx], u, v, out + 3 * x);
+    }
+  }
+}
+
+/**
+ * @brief 把BGR packed写入image中从(startX, startY)开始的width x height区域
+ */
+void writeBgr(const bm_image& image, int startX, int startY, int width,
+              int height, const unsigned char* bgr) {
+  ChannelLayout channels;
+  ChromaLayout chroma;
+  if (channelLayout(image.image_format, &channels)) {
+    bool bgrOrder = isBgrOrder(image.image_format);
+    for (int y = 0; y < height; ++y) {
+      const unsigned char* in = bgr + static_cast<std::size_t>(y) * width * 3;
+      if (channels.channels == 1) {
+        unsigned char* gray = channels.row(image, 0, startY + y) + startX;
+        for (int x = 0; x < width; ++x)
+          gray[x] = saturate(
+              (117 * in[3 * x] + 601 * in[3 * x + 1] + 306 * in[3 * x + 2] +
+               512) >>
+              10);
+        continue;
+      }
+      for (int c = 0; c < 3; ++c) {
+        unsigned char* out =
+            channels.row(image, c, startY + y) + startX * channels.step;
+        int source = bgrOrder ? c : 2 - c;
+        for (int x = 0; x < width; ++x)
+          out[x * channels.step] = in[3 * x + source];
+      }
+    }
+    return;
+  }
+  chromaLayout(image.image_format, &chroma);
+  auto priv = image.image_private;
+  for (int y = 0; y < height; ++y) {
+    unsigned char* luma = planeData(image, 0) +
+                          static_cast<std::size_t>(startY + y) * priv->stride[0];
+    const unsigned char* in = bgr + static_cast<std::size_t>(y) * width * 3;
+    for (int x = 0; x < width; ++x) luma[startX + x] = saturate(bgrToY(in + 3 * x));
+  }
+  // 每个色度样本取区域内对应像素的平均值
+  int blockW = 1 << chroma.shiftX, blockH = 1 << chroma.shiftY;
+  int cx0 = startX >> chroma.shiftX, cx1 = (startX + width - 1) >> chroma.shiftX;
+  int cy0 = startY >> chroma.shiftY, cy1 = (startY + height - 1) >> chroma.shiftY;
+  for (int cy = cy0; cy <= cy1; ++cy) {
+    unsigned char* plane1 = planeData(image, 1) +
+                            static_cast<std::size_t>(cy) * priv->stride[1];
+    unsigned char* plane2 =
+        chroma.interleaved ? nullptr
+                           : planeData(image, 2) +
+                                 static_cast<std::size_t>(cy) * priv->stride[2];
+    int y0 = std::max(cy * blockH, startY) - startY;
+    int y1 = std::min((cy + 1) * blockH, startY + height) - startY;
+    for (int cx = cx0; cx <= cx1; ++cx) {
+      int x0 = std::max(cx * blockW, startX) - startX;
+      int x1 = std::min((cx + 1) * blockW, startX + width) - startX;
+      int b = 0, g = 0, r = 0, count = 0;
+      for (int y = y0; y < y1; ++y) {
+        const unsigned char* in = bgr + (static_cast<std::size_t>(y) * width + x0) * 3;
+        for (int x = x0; x < x1; ++x, in += 3) {
+          b += in[0];
+          g += in[1];
+          r += in[2];
+          ++count;
+        }
+      }
+      unsigned char u = saturate(bgrToU(b / count, g / count, r / count));
+      unsigned char v = saturate(bgrToV(b / count, g / count, r / count));
+      if (chroma.interleaved) {
+        plane1[2 * cx] = chroma.vFirst ? v : u;
+        plane1[2 * cx + 1] = chroma.vFirst ? u : v;
+      } else {
+        plane1[cx] = u;
+        plane2[cx] = v;
+      }
+    }
+  }
+}
+
+void fillBgr(const bm_image& image, unsigned char b, unsigned char g,
+             unsigned char r) {
+  std::vector<unsigned char> row(static_cast<std::size_t>(image.width) * 3);
+  for (int x = 0; x < image.width; ++x) {
+    row[3 * x] = b;
+    row[3 * x + 1] = g;
+    row[3 * x + 2] = r;
+  }
+  std::vector<unsigned char> bgr;
+  bgr.reserve(row.size() * image.height);
+  for (int y = 0; y < image.height; ++y)
+    bgr.insert(bgr.end(), row.begin(), row.end());
+  writeBgr(image, 0, 0, image.width, image.height, bgr.data());
+}
+
+/**
+ * @brief BGR packed缩放，LINEAR与OpenCV INTER_LINEAR一样按像素中心对齐
+ */
+void resizeBgr(const std::vector<unsigned char>& src, int srcW, int srcH,
+               std::vector<unsigned char>& dst, int dstW, int dstH,
+               bmcv_resize_algorithm algorithm) {
+  dst.resize(static_cast<std::size_t>(dstW) * dstH * 3);
+  if (srcW == dstW && srcH == dstH) {
+    dst = src;
+    return;
+  }
+  float scaleX = static_cast<float>(srcW) / dstW;
+  float scaleY = static_cast<float>(srcH) / dstH;
+  if (algorithm == BMCV_INTER_NEAREST) {
+    for (int y = 0; y < dstH; ++y) {
+      int sy = std::min(static_cast<int>(y * scaleY), srcH - 1);
+      for (int x = 0; x < dstW; ++x) {
+        int sx = std::min(static_cast<int>(x * scaleX), srcW - 1);
+        std::memcpy(&dst[(static_cast<std::size_t>(y) * dstW + x) * 3],
+                    &src[(static_cast<std::size_t>(sy) * srcW + sx) * 3], 3);
+      }
+    }
+    return;
+  }
+  // 权重放大2048倍
+  std::vector<int> x0(dstW), x1(dstW), wx(dstW);
+  for (int x = 0; x < dstW; ++x) {
+    float fx = std::max((x + 0.5f) * scaleX - 0.5f, 0.f);
+    x0[x] = std::min(static_cast<int>(fx), srcW - 1);
+    x1[x] = std::min(x0[x] + 1, srcW - 1);
+    wx[x] = static_cast<int>((fx - x0[x]) * 2048 + 0.5f);
+  }
+  for (int y = 0; y < dstH; ++y) {
+    float fy = std::max((y + 0.5f) * scaleY - 0.5f, 0.f);
+    int y0 = std::min(static_cast<int>(fy), srcH - 1);
+    int y1 = std::min(y0 + 1, srcH - 1);
+    int wy = static_cast<int>((fy - y0) * 2048 + 0.5f);
+    const unsigned char* row0 = &src[static_cast<std::size_t>(y0) * srcW * 3];
+    const unsigned char* row1 = &src[static_cast<std::size_t>(y1) * srcW * 3];
+    unsigned char* out = &dst[static_cast<std::size_t>(y) * dstW * 3];
+    for (int x = 0; x < dstW; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        int top = row0[x0[x] * 3 + c] * (2048 - wx[x]) + row0[x1[x] * 3 + c] * wx[x];
+        int bottom =
+            row1[x0[x] * 3 + c] * (2048 - wx[x]) + row1[x1[x] * 3 + c] * wx[x];
+        out[x * 3 + c] = static_cast<unsigned char>(
+            (static_cast<std::int64_t>(top) * (2048 - wy) +
+             static_cast<std::int64_t>(bottom) * wy + (1 << 21)) >>
+            22);
+      }
+    }
+  }
+}
+
+bool rectInside(const bmcv_rect_t& rect, int width, int height) {
+  return rect.crop_w > 0 && rect.crop_h > 0 && rect.start_x >= 0 &&
+         rect.start_y >= 0 && rect.start_x + rect.crop_w <= width &&
+         rect.start_y + rect.crop_h <= height;
+}
+
+/**
+ * @brief 把input的rect区域缩放到output中(dstX, dstY, dstW, dstH)的位置
+ */
+bm_status_t convertRegion(const bm_image& input, const bmcv_rect_t& rect,
+                          const bm_image& output, int dstX, int dstY, int dstW,
+                          int dstH, bmcv_resize_algorithm algorithm) {
+  if (!isConvertible(input) || !isConvertible(output)) return BM_NOT_SUPPORTED;
+  if (!rectInside(rect, input.width, input.height) ||
+      !rectInside({dstX, dstY, dstW, dstH}, output.width, output.height))
+    return BM_ERR_PARAM;
+  std::vector<unsigned char> source, resized;
+  readBgr(input, rect, source);
+  resizeBgr(source, rect.crop_w, rect.crop_h, resized, dstW, dstH, algorithm);
+  writeBgr(output, dstX, dstY, dstW, dstH, resized.data());
+  return BM_SUCCESS;
+}
+
+float loadElement(const unsigned char* data, bm_image_data_format_ext type,
+                  int index) {
+  switch (type) {
+    case DATA_TYPE_EXT_FLOAT32:
+      return reinterpret_cast<const float*>(data)[index];
+    case DATA_TYPE_EXT_1N_BYTE_SIGNED:
+      return reinterpret_cast<const std::int8_t*>(data)[index];
+    default:
+      return data[index];
+  }
+}
+
+std::uint16_t floatToHalf(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::uint32_t sign = (bits >> 16) & 0x8000;
+  int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+  std::uint32_t mantissa = bits & 0x7fffff;
+  if (exponent <= 0) {
+    if (exponent < -10) return static_cast<std::uint16_t>(sign);
+    mantissa |= 0x800000;
+    int shift = 14 - exponent;
+    std::uint32_t half = mantissa >> shift;
+    if ((mantissa >> (shift - 1)) & 1) ++half;
+    return static_cast<std::uint16_t>(sign | half);
+  }
+  if (exponent >= 31) return static_cast<std::uint16_t>(sign | 0x7c00);
+  std::uint32_t half = (exponent << 10) | (mantissa >> 13);
+  if (mantissa & 0x1000) ++half;
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+void storeElement(unsigned char* data, bm_image_data_format_ext type,
+                  int index, float value) {
+  switch (type) {
+    case DATA_TYPE_EXT_FLOAT32:
+      reinterpret_cast<float*>(data)[index] = value;
+      break;
+    case DATA_TYPE_EXT_FP16:
+      reinterpret_cast<std::uint16_t*>(data)[index] = floatToHalf(value);
+      break;
+    case DATA_TYPE_EXT_1N_BYTE_SIGNED:
+      reinterpret_cast<std::int8_t*>(data)[index] = static_cast<std::int8_t>(
+          std::min(std::max(std::nearbyint(value), -128.f), 127.f));
+      break;
+    default:
+      data[index] = static_cast<unsigned char>(
+          std::min(std::max(std::nearbyint(value), 0.f), 255.f));
+      break;
+  }
+}
+
+struct JpegErrorManager {
+  jpeg_error_mgr manager;
+  std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr info) {
+  std::longjmp(reinterpret_cast<JpegErrorManager*>(info->err)->jump, 1);
+}
+
+/**
+ * @brief 编码BGR packed，返回malloc申请的jpeg数据
+ */
+unsigned char* encodeJpeg(const std::vector<unsigned char>& bgr, int width,
+                          int height, int quality, std::size_t* size) {
+  std::vector<unsigned char> rgb(static_cast<std::size_t>(width) * 3);
+  jpeg_compress_struct info;
+  JpegErrorManager error;
+  info.err = jpeg_std_error(&error.manager);
+  error.manager.error_exit = jpegErrorExit;
+  unsigned char* buffer = nullptr;
+  unsigned long bytes = 0;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_compress(&info);
+    std::free(buffer);
+    return nullptr;
+  }
+  jpeg_create_compress(&info);
+  jpeg_mem_dest(&info, &buffer, &bytes);
+  info.image_width = width;
+  info.image_height = height;
+  info.input_components = 3;
+  info.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&info);
+  jpeg_set_quality(&info, quality, TRUE);
+  jpeg_start_compress(&info, TRUE);
+  while (info.next_scanline < info.image_height) {
+    const unsigned char* in =
+        &bgr[static_cast<std::size_t>(info.next_scanline) * width * 3];
+    for (int x = 0; x < width; ++x) {
+      rgb[3 * x] = in[3 * x + 2];
+      rgb[3 * x + 1] = in[3 * x + 1];
+      rgb[3 * x + 2] = in[3 * x];
+    }
+    JSAMPROW row = rgb.data();
+    jpeg_write_scanlines(&info, &row, 1);
+  }
+  jpeg_finish_compress(&info);
+  jpeg_destroy_compress(&info);
+  *size = bytes;
+  return buffer;
+}
+
+/**
+ * @brief 解码为BGR packed
+ */
+bool decodeJpeg(const void* data, std::size_t size,
+                std::vector<unsigned char>& bgr, int* width, int* height) {
+  jpeg_decompress_struct info;
+  JpegErrorManager error;
+  info.err = jpeg_std_error(&error.manager);
+  error.manager.error_exit = jpegErrorExit;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_decompress(&info);
+    return false;
+  }
+  jpeg_create_decompress(&info);
+  jpeg_mem_src(&info, static_cast<const unsigned char*>(data),
+               static_cast<unsigned long>(size));
+  jpeg_read_header(&info, TRUE);
+  info.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&info);
+  *width = info.output_width;
+  *height = info.output_height;
+  bgr.resize(static_cast<std::size_t>(*width) * *height * 3);
+  while (info.output_scanline < info.output_height) {
+    unsigned char* out =
+        &bgr[static_cast<std::size_t>(info.output_scanline) * *width * 3];
+    JSAMPROW row = out;
+    jpeg_read_scanlines(&info, &row, 1);
+    for (int x = 0; x < *width; ++x) std::swap(out[3 * x], out[3 * x + 2]);
+  }
+  jpeg_finish_decompress(&info);
+  jpeg_destroy_decompress(&info);
+  return true;
+}
+
+}  // namespace
+
+}  // namespace host
+}  // namespace sophon_stream
+
+using namespace sophon_stream::host;
+
+bm_status_t bm_image_create(bm_handle_t handle, int img_h, int img_w,
+                            bm_image_format_ext image_format,
+                            bm_image_data_format_ext data_type,
+                            bm_image* image, int* stride) {
+  if (image == nullptr || img_w <= 0 || img_h <= 0) return BM_ERR_PARAM;
+  int planeNum = 0;
+  int rowElements[HOST_MAX_PLANES], rows[HOST_MAX_PLANES];
+  if (!planeLayout(image_format, img_w, img_h, &planeNum, rowElements, rows))
+    return BM_NOT_SUPPORTED;
+  auto priv = new bm_image_private;
+  priv->handle = handle;
+  priv->planeNum = planeNum;
+  for (int i = 0; i < planeNum; ++i) {
+    int minimum = rowElements[i] * dataTypeSize(data_type);
+    if (stride != nullptr && stride[i] < minimum) {
+      delete priv;
+      return BM_ERR_PARAM;
+    }
+    priv->stride[i] = stride != nullptr ? stride[i] : minimum;
+    priv->planeHeight[i] = rows[i];
+    priv->mem[i] = bm_mem_null();
+  }
+  image->width = img_w;
+  image->height = img_h;
+  image->image_format = image_format;
+  image->data_type = data_type;
+  image->image_private = priv;
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_destroy(bm_image image) {
+  if (!isCreated(image)) return BM_ERR_PARAM;
+  auto priv = image.image_private;
+  if (priv->owned) {
+    for (int i = 0; i < priv->planeNum; ++i)
+      bm_free_device(priv->handle, priv->mem[i]);
+  }
+  delete priv;
+  return BM_SUCCESS;
+}
+
+bm_handle_t bm_image_get_handle(bm_image* image) {
+  return image != nullptr && isCreated(*image) ? image->image_private->handle
+                                               : nullptr;
+}
+
+bool bm_image_is_attached(bm_image image) {
+  return isCreated(image) && image.image_private->attached;
+}
+
+int bm_image_get_plane_num(bm_image image) {
+  return isCreated(image) ? image.image_private->planeNum : 0;
+}
+
+bm_status_t bm_image_get_stride(bm_image image, int* stride) {
+  if (!isCreated(image) || stride == nullptr) return BM_ERR_PARAM;
+  for (int i = 0; i < image.image_private->planeNum; ++i)
+    stride[i] = image.image_private->stride[i];
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_get_byte_size(bm_image image, int* size) {
+  if (!isCreated(image) || size == nullptr) return BM_ERR_PARAM;
+  for (int i = 0; i < image.image_private->planeNum; ++i)
+    size[i] = planeBytes(image, i);
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_get_device_mem(bm_image image, bm_device_mem_t* mem) {
+  if (!hasMemory(image) || mem == nullptr) return BM_ERR_PARAM;
+  for (int i = 0; i < image.image_private->planeNum; ++i)
+    mem[i] = image.image_private->mem[i];
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_alloc_dev_mem(bm_image image, int heap_id) {
+  if (!isCreated(image)) return BM_ERR_PARAM;
+  auto priv = image.image_private;
+  if (priv->attached) return BM_ERR_BUSY;
+  for (int i = 0; i < priv->planeNum; ++i) {
+    if (!allocateDeviceMemory(&priv->mem[i], planeBytes(image, i))) {
+      for (int j = 0; j < i; ++j) bm_free_device(priv->handle, priv->mem[j]);
+      return BM_ERR_NOMEM;
+    }
+  }
+  priv->attached = true;
+  priv->owned = true;
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_alloc_dev_mem_heap_mask(bm_image image, int heap_mask) {
+  return bm_image_alloc_dev_mem(image, BMCV_HEAP_ANY);
+}
+
+bm_status_t bm_image_attach(bm_image image, bm_device_mem_t* device_memory) {
+  if (!isCreated(image) || device_memory == nullptr) return BM_ERR_PARAM;
+  auto priv = image.image_private;
+  for (int i = 0; i < priv->planeNum; ++i) {
+    if (bm_mem_get_device_size(device_memory[i]) <
+        static_cast<unsigned int>(planeBytes(image, i)))
+      return BM_ERR_PARAM;
+  }
+  bm_image_detach(image);
+  for (int i = 0; i < priv->planeNum; ++i) priv->mem[i] = device_memory[i];
+  priv->attached = true;
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_detach(bm_image image) {
+  if (!isCreated(image)) return BM_ERR_PARAM;
+  auto priv = image.image_private;
+  if (priv->owned) {
+    for (int i = 0; i < priv->planeNum; ++i)
+      bm_free_device(priv->handle, priv->mem[i]);
+  }
+  for (int i = 0; i < priv->planeNum; ++i) priv->mem[i] = bm_mem_null();
+  priv->attached = false;
+  priv->owned = false;
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_copy_host_to_device(bm_image image, void* buffers[]) {
+  if (!hasMemory(image) || buffers == nullptr) return BM_ERR_PARAM;
+  for (int i = 0; i < image.image_private->planeNum; ++i)
+    std::memcpy(planeData(image, i), buffers[i], planeBytes(image, i));
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_copy_device_to_host(bm_image image, void* buffers[]) {
+  if (!hasMemory(image) || buffers == nullptr) return BM_ERR_PARAM;
+  for (int i = 0; i < image.image_private->planeNum; ++i)
+    std::memcpy(buffers[i], planeData(image, i), planeBytes(image, i));
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_alloc_contiguous_mem(int image_num, bm_image* images,
+                                          int heap_id) {
+  if (image_num <= 0 || images == nullptr) return BM_ERR_PARAM;
+  unsigned int total = 0;
+  for (int i = 0; i < image_num; ++i) {
+    if (!isCreated(images[i])) return BM_ERR_PARAM;
+    for (int p = 0; p < images[i].image_private->planeNum; ++p)
+      total += planeBytes(images[i], p);
+  }
+  bm_device_mem_t mem;
+  if (!allocateDeviceMemory(&mem, total)) return BM_ERR_NOMEM;
+  return bm_image_attach_contiguous_mem(image_num, images, mem);
+}
+
+bm_status_t bm_image_free_contiguous_mem(int image_num, bm_image* images) {
+  if (image_num <= 0 || images == nullptr || !hasMemory(images[0]))
+    return BM_ERR_PARAM;
+  bm_device_mem_t mem = images[0].image_private->mem[0];
+  bm_image_detach_contiguous_mem(image_num, images);
+  bm_free_device(nullptr, mem);
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_image_attach_contiguous_mem(int image_num, bm_image* images,
+                                           bm_device_mem_t dmem) {
+  if (image_num <= 0 || images == nullptr) return BM_ERR_PARAM;
+  unsigned long long address = bm_mem_get_device_addr(dmem);
+  for (int i = 0; i < image_num; ++i) {
+    if (!isCreated(images[i])) return BM_ERR_PARAM;
+    bm_device_mem_t planes[HOST_MAX_PLANES];
+    for (int p = 0; p < images[i].image_private->planeNum; ++p) {
+      planes[p] = bm_mem_from_device(address, planeBytes(images[i], p));
+      address += planeBytes(images[i], p);
+    }
+    bm_status_t ret = bm_image_attach(images[i], planes);
+    if (ret != BM_SUCCESS) return ret;
+  }
+  return address <= bm_mem_get_device_addr(dmem) + dmem.size ? BM_SUCCESS
+                                                              : BM_ERR_PARAM;
+}
+
+bm_status_t bm_image_detach_contiguous_mem(int image_num, bm_image* images) {
+  if (image_num <= 0 || images == nullptr) return BM_ERR_PARAM;
+  for (int i = 0; i < image_num; ++i) bm_image_detach(images[i]);
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_vpp_convert(bm_handle_t handle, int output_num,
+                                   bm_image input, bm_image* output,
+                                   bmcv_rect_t* crop_rect,
+                                   bmcv_resize_algorithm algorithm) {
+  if (output == nullptr || output_num <= 0) return BM_ERR_PARAM;
+  for (int i = 0; i < output_num; ++i) {
+    bmcv_rect_t rect = crop_rect != nullptr
+                           ? crop_rect[i]
+                           : bmcv_rect_t{0, 0, input.width, input.height};
+    bm_status_t ret = convertRegion(input, rect, output[i], 0, 0,
+                                    output[i].width, output[i].height,
+                                    algorithm);
+    if (ret != BM_SUCCESS) return ret;
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_vpp_convert_padding(bm_handle_t handle, int output_num,
+                                           bm_image input, bm_image* output,
+                                           bmcv_padding_atrr_t* padding_attr,
+                                           bmcv_rect_t* crop_rect,
+                                           bmcv_resize_algorithm algorithm) {
+  if (output == nullptr || output_num <= 0 || padding_attr == nullptr)
+    return BM_ERR_PARAM;
+  for (int i = 0; i < output_num; ++i) {
+    const bmcv_padding_atrr_t& padding = padding_attr[i];
+    if (!isConvertible(output[i])) return BM_NOT_SUPPORTED;
+    if (padding.if_memset)
+      fillBgr(output[i], padding.padding_b, padding.padding_g,
+              padding.padding_r);
+    bmcv_rect_t rect = crop_rect != nullptr
+                           ? crop_rect[i]
+                           : bmcv_rect_t{0, 0, input.width, input.height};
+    bm_status_t ret = convertRegion(
+        input, rect, output[i], padding.dst_crop_stx, padding.dst_crop_sty,
+        padding.dst_crop_w, padding.dst_crop_h, algorithm);
+    if (ret != BM_SUCCESS) return ret;
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_crop(bm_handle_t handle, int crop_num,
+                            bmcv_rect_t* rects, bm_image input,
+                            bm_image* output) {
+  if (rects == nullptr || output == nullptr || crop_num <= 0)
+    return BM_ERR_PARAM;
+  for (int i = 0; i < crop_num; ++i) {
+    if (rects[i].crop_w != output[i].width ||
+        rects[i].crop_h != output[i].height)
+      return BM_ERR_PARAM;
+    bm_status_t ret =
+        convertRegion(input, rects[i], output[i], 0, 0, output[i].width,
+                      output[i].height, BMCV_INTER_NEAREST);
+    if (ret != BM_SUCCESS) return ret;
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_storage_convert(bm_handle_t handle, int image_num,
+                                       bm_image* input, bm_image* output) {
+  if (input == nullptr || output == nullptr || image_num <= 0)
+    return BM_ERR_PARAM;
+  for (int i = 0; i < image_num; ++i) {
+    if (input[i].width != output[i].width ||
+        input[i].height != output[i].height)
+      return BM_ERR_PARAM;
+    bm_status_t ret = convertRegion(
+        input[i], {0, 0, input[i].width, input[i].height}, output[i], 0, 0,
+        output[i].width, output[i].height, BMCV_INTER_NEAREST);
+    if (ret != BM_SUCCESS) return ret;
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_copy_to(bm_handle_t handle,
+                               bmcv_copy_to_atrr_t copy_to_attr,
+                               bm_image input, bm_image output) {
+  if (!isConvertible(input) || !isConvertible(output)) return BM_NOT_SUPPORTED;
+  if (copy_to_attr.if_padding)
+    fillBgr(output, copy_to_attr.padding_b, copy_to_attr.padding_g,
+            copy_to_attr.padding_r);
+  return convertRegion(input, {0, 0, input.width, input.height}, output,
+                       copy_to_attr.start_x, copy_to_attr.start_y, input.width,
+                       input.height, BMCV_INTER_NEAREST);
+}
+
+bm_status_t bmcv_image_convert_to(bm_handle_t handle, int input_num,
+                                  bmcv_convert_to_attr convert_to_attr,
+                                  bm_image* input, bm_image* output) {
+  if (input == nullptr || output == nullptr || input_num <= 0)
+    return BM_ERR_PARAM;
+  const float alpha[3] = {convert_to_attr.alpha_0, convert_to_attr.alpha_1,
+                          convert_to_attr.alpha_2};
+  const float beta[3] = {convert_to_attr.beta_0, convert_to_attr.beta_1,
+                         convert_to_attr.beta_2};
+  for (int i = 0; i < input_num; ++i) {
+    ChannelLayout in, out;
+    if (!hasMemory(input[i]) || !hasMemory(output[i]) ||
+        !channelLayout(input[i].image_format, &in) ||
+        !channelLayout(output[i].image_format, &out) ||
+        in.channels != out.channels || input[i].data_type == DATA_TYPE_EXT_FP16 ||
+        input[i].data_type == DATA_TYPE_EXT_BF16 ||
+        output[i].data_type == DATA_TYPE_EXT_BF16)
+      return BM_NOT_SUPPORTED;
+    if (input[i].width != output[i].width ||
+        input[i].height != output[i].height)
+      return BM_ERR_PARAM;
+    for (int c = 0; c < in.channels; ++c) {
+      for (int y = 0; y < input[i].height; ++y) {
+        const unsigned char* src = in.row(input[i], c, y);
+        unsigned char* dst = out.row(output[i], c, y);
+        for (int x = 0; x < input[i].width; ++x)
+          storeElement(dst, output[i].data_type, x * out.step,
+                       loadElement(src, input[i].data_type, x * in.step) *
+                               alpha[c] +
+                           beta[c]);
+      }
+    }
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_jpeg_enc(bm_handle_t handle, int image_num,
+                                bm_image* src, void* p_jpeg_data[],
+                                size_t* out_size, int quality_factor) {
+  if (src == nullptr || p_jpeg_data == nullptr || out_size == nullptr)
+    return BM_ERR_PARAM;
+  for (int i = 0; i < image_num; ++i) {
+    if (!isConvertible(src[i])) return BM_NOT_SUPPORTED;
+    std::vector<unsigned char> bgr;
+    readBgr(src[i], {0, 0, src[i].width, src[i].height}, bgr);
+    std::size_t size = 0;
+    unsigned char* jpeg = encodeJpeg(bgr, src[i].width, src[i].height,
+                                     quality_factor, &size);
+    if (jpeg == nullptr) return BM_ERR_FAILURE;
+    if (p_jpeg_data[i] == nullptr) {
+      p_jpeg_data[i] = std::malloc(size);
+    } else if (out_size[i] != 0 && out_size[i] < size) {
+      std::free(jpeg);
+      return BM_ERR_NOMEM;
+    }
+    std::memcpy(p_jpeg_data[i], jpeg, size);
+    std::free(jpeg);
+    out_size[i] = size;
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_image_jpeg_dec(bm_handle_t handle, void* p_jpeg_data[],
+                                size_t* in_size, int image_num,
+                                bm_image* dst) {
+  if (p_jpeg_data == nullptr || in_size == nullptr || dst == nullptr)
+    return BM_ERR_PARAM;
+  for (int i = 0; i < image_num; ++i) {
+    std::vector<unsigned char> bgr;
+    int width = 0, height = 0;
+    if (!decodeJpeg(p_jpeg_data[i], in_size[i], bgr, &width, &height))
+      return BM_ERR_DATA;
+    if (!isCreated(dst[i])) {
+      bm_status_t ret = bm_image_create(handle, height, width, FORMAT_YUV420P,
+                                        DATA_TYPE_EXT_1N_BYTE, &dst[i]);
+      if (ret != BM_SUCCESS) return ret;
+    }
+    if (dst[i].width != width || dst[i].height != height) return BM_ERR_PARAM;
+    if (!hasMemory(dst[i])) {
+      bm_status_t ret = bm_image_alloc_dev_mem(dst[i]);
+      if (ret != BM_SUCCESS) return ret;
+    }
+    if (!isConvertible(dst[i])) return BM_NOT_SUPPORTED;
+    writeBgr(dst[i], 0, 0, width, height, bgr.data());
+  }
+  return BM_SUCCESS;
+}
+
+bm_status_t bmcv_base64_enc(bm_handle_t handle, bm_device_mem_t src,
+                            bm_device_mem_t dst, unsigned long len[2]) {
+  static const char table[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const unsigned char* in = hostPointer(src);
+  unsigned char* out = hostPointer(dst);
+  if (in == nullptr || out == nullptr || len == nullptr) return BM_ERR_PARAM;
+  unsigned long n = len[0], o = 0, i = 0;
+  for (; i + 3 <= n; i += 3) {
+    std::uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    out[o++] = table[v >> 18];
+    out[o++] = table[(v >> 12) & 63];
+    out[o++] = table[(v >> 6) & 63];
+    out[o++] = table[v & 63];
+  }
+  if (i < n) {
+    std::uint32_t v = in[i] << 16;
+    if (i + 1 < n) v |= in[i + 1] << 8;
+    out[o++] = table[v >> 18];
+    out[o++] = table[(v >> 12) & 63];
+    out[o++] = i + 1 < n ? table[(v >> 6) & 63] : '=';
+    out[o++] = '=';
+  }
+  len[1] = o;
+  return BM_SUCCESS;
+}
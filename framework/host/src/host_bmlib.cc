@@ -0,0 +1,309 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "bmlib_runtime.h"
+#include "common/logger.h"
+#include "host_memory.h"
+#include "host_runtime.h"
+
+namespace sophon_stream {
+namespace host {
+
+namespace {
+
+constexpr std::size_t DEVICE_MEMORY_ALIGNMENT = 64;
+
+/**
+ * @brief 已申请的设备内存，key为地址
+ */
+struct DeviceMemoryRegistry {
+  std::mutex mutex;
+  std::unordered_map<unsigned long long, unsigned int> blocks;
+  DeviceMemoryStats stats;
+};
+
+DeviceMemoryRegistry& registry() {
+  static DeviceMemoryRegistry instance;
+  return instance;
+}
+
+}  // namespace
+
+bool allocateDeviceMemory(bm_device_mem_t* mem, unsigned int size) {
+  std::size_t bytes = (std::max<std::size_t>(size, 1) +
+                       DEVICE_MEMORY_ALIGNMENT - 1) /
+                      DEVICE_MEMORY_ALIGNMENT * DEVICE_MEMORY_ALIGNMENT;
+  void* data = std::aligned_alloc(DEVICE_MEMORY_ALIGNMENT, bytes);
+  if (data == nullptr) return false;
+  // 设备内存不保证清零，这里清零使未写入的部分（如batch补齐）结果确定
+  std::memset(data, 0, bytes);
+  bm_set_device_mem(mem, size, reinterpret_cast<unsigned long long>(data));
+
+  auto& instance = registry();
+  std::lock_guard<std::mutex> lock(instance.mutex);
+  instance.blocks[reinterpret_cast<unsigned long long>(data)] = size;
+  instance.stats.bytes += size;
+  ++instance.stats.blocks;
+  ++instance.stats.allocations;
+  return true;
+}
+
+void freeDeviceMemory(const bm_device_mem_t& mem) {
+  unsigned long long address = bm_mem_get_device_addr(mem);
+  auto& instance = registry();
+  {
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    auto it = instance.blocks.find(address);
+    if (it == instance.blocks.end()) {
+      IVS_WARN(
+          "bm_free_device: address {0:#x} was not allocated by "
+          "bm_malloc_device_byte",
+          address);
+      return;
+    }
+    instance.stats.bytes -= it->second;
+    --instance.stats.blocks;
+    instance.blocks.erase(it);
+  }
+  std::free(reinterpret_cast<void*>(address));
+}
+
+DeviceMemoryStats getDeviceMemoryStats() {
+  auto& instance = registry();
+  std::lock_guard<std::mutex> lock(instance.mutex);
+  return instance.stats;
+}
+
+}  // namespace host
+}  // namespace sophon_stream
+
+using sophon_stream::host::hostPointer;
+
+bm_status_t bm_dev_request(bm_handle_t* handle, int devid) {
+  if (handle == nullptr) return BM_ERR_PARAM;
+  *handle = new bm_context;
+  (*handle)->devId = devid;
+  return BM_SUCCESS;
+}
+
+void bm_dev_free(bm_handle_t handle) { delete handle; }
+
+int bm_get_devid(bm_handle_t handle) {
+  return handle == nullptr ? 0 : handle->devId;
+}
+
+bm_status_t bm_dev_getcount(int* count) {
+  if (count == nullptr) return BM_ERR_PARAM;
+  *count = 1;
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_get_misc_info(bm_handle_t handle,
+                             struct bm_misc_info* pmisc_info) {
+  if (pmisc_info == nullptr) return BM_ERR_PARAM;
+  std::memset(pmisc_info, 0, sizeof(*pmisc_info));
+  // 按pcie模式运行，BMNNTensor用d2s读输出
+  pmisc_info->pcie_soc_mode = 0;
+  pmisc_info->chipid = BM_HOST_CHIPID;
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_get_chipid(bm_handle_t handle, unsigned int* p_chipid) {
+  if (p_chipid == nullptr) return BM_ERR_PARAM;
+  *p_chipid = BM_HOST_CHIPID;
+  return BM_SUCCESS;
+}
+
+// host运行时的所有操作都是同步完成的
+bm_status_t bm_thread_sync(bm_handle_t handle) { return BM_SUCCESS; }
+
+bm_status_t bm_thread_sync_from_core(bm_handle_t handle, int core_id) {
+  return BM_SUCCESS;
+}
+
+bm_device_mem_t bm_mem_from_device(unsigned long long device_addr,
+                                   unsigned int len) {
+  bm_device_mem_t mem;
+  bm_set_device_mem(&mem, len, device_addr);
+  return mem;
+}
+
+bm_system_mem_t bm_mem_from_system(void* system_addr) {
+  bm_system_mem_t mem;
+  std::memset(&mem, 0, sizeof(mem));
+  mem.u.system.system_addr = system_addr;
+  mem.flags.u.mem_type = BM_MEM_TYPE_SYSTEM;
+  return mem;
+}
+
+bm_device_mem_t bm_mem_null(void) {
+  bm_device_mem_t mem;
+  std::memset(&mem, 0, sizeof(mem));
+  mem.flags.u.mem_type = BM_MEM_TYPE_INVALID;
+  return mem;
+}
+
+unsigned long long bm_mem_get_device_addr(bm_device_mem_t mem) {
+  return mem.u.device.device_addr;
+}
+
+void bm_mem_set_device_addr(bm_device_mem_t* pmem, unsigned long long addr) {
+  pmem->u.device.device_addr = addr;
+}
+
+unsigned int bm_mem_get_device_size(bm_device_mem_t mem) { return mem.size; }
+
+void bm_mem_set_device_size(bm_device_mem_t* pmem, unsigned int size) {
+  pmem->size = size;
+}
+
+void bm_set_device_mem(bm_device_mem_t* pmem, unsigned int size,
+                       unsigned long long addr) {
+  std::memset(pmem, 0, sizeof(*pmem));
+  pmem->u.device.device_addr = addr;
+  pmem->flags.u.mem_type = BM_MEM_TYPE_DEVICE;
+  pmem->size = size;
+}
+
+bm_status_t bm_malloc_device_byte(bm_handle_t handle, bm_device_mem_t* pmem,
+                                  unsigned int size) {
+  if (pmem == nullptr) return BM_ERR_PARAM;
+  return sophon_stream::host::allocateDeviceMemory(pmem, size) ? BM_SUCCESS
+                                                               : BM_ERR_NOMEM;
+}
+
+bm_status_t bm_malloc_device_byte_heap(bm_handle_t handle,
+                                       bm_device_mem_t* pmem, int heap_id,
+                                       unsigned int size) {
+  return bm_malloc_device_byte(handle, pmem, size);
+}
+
+bm_status_t bm_malloc_device_byte_heap_mask(bm_handle_t handle,
+                                            bm_device_mem_t* pmem,
+                                            int heap_id_mask,
+                                            unsigned int size) {
+  return bm_malloc_device_byte(handle, pmem, size);
+}
+
+void bm_free_device(bm_handle_t handle, bm_device_mem_t mem) {
+  if (bm_mem_get_device_addr(mem) == 0) return;
+  sophon_stream::host::freeDeviceMemory(mem);
+}
+
+bm_status_t bm_memcpy_s2d(bm_handle_t handle, bm_device_mem_t dst, void* src) {
+  return bm_memcpy_s2d_partial_offset(handle, dst, src, dst.size, 0);
+}
+
+bm_status_t bm_memcpy_d2s(bm_handle_t handle, void* dst, bm_device_mem_t src) {
+  return bm_memcpy_d2s_partial_offset(handle, dst, src, src.size, 0);
+}
+
+bm_status_t bm_memcpy_s2d_partial(bm_handle_t handle, bm_device_mem_t dst,
+                                  void* src, unsigned int size) {
+  return bm_memcpy_s2d_partial_offset(handle, dst, src, size, 0);
+}
+
+bm_status_t bm_memcpy_d2s_partial(bm_handle_t handle, void* dst,
+                                  bm_device_mem_t src, unsigned int size) {
+  return bm_memcpy_d2s_partial_offset(handle, dst, src, size, 0);
+}
+
+bm_status_t bm_memcpy_s2d_partial_offset(bm_handle_t handle,
+                                         bm_device_mem_t dst, void* src,
+                                         unsigned int size,
+                                         unsigned int offset) {
+  if (hostPointer(dst) == nullptr || src == nullptr) return BM_ERR_PARAM;
+  if (static_cast<unsigned long long>(offset) + size > dst.size)
+    return BM_ERR_PARAM;
+  std::memcpy(hostPointer(dst) + offset, src, size);
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_memcpy_d2s_partial_offset(bm_handle_t handle, void* dst,
+                                         bm_device_mem_t src,
+                                         unsigned int size,
+                                         unsigned int offset) {
+  if (hostPointer(src) == nullptr || dst == nullptr) return BM_ERR_PARAM;
+  if (static_cast<unsigned long long>(offset) + size > src.size)
+    return BM_ERR_PARAM;
+  std::memcpy(dst, hostPointer(src) + offset, size);
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_memcpy_d2d_byte(bm_handle_t handle, bm_device_mem_t dst,
+                               size_t dst_offset, bm_device_mem_t src,
+                               size_t src_offset, size_t size) {
+  if (hostPointer(dst) == nullptr || hostPointer(src) == nullptr)
+    return BM_ERR_PARAM;
+  if (dst_offset + size > dst.size || src_offset + size > src.size)
+    return BM_ERR_PARAM;
+  std::memmove(hostPointer(dst) + dst_offset, hostPointer(src) + src_offset,
+               size);
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_memset_device(bm_handle_t handle, const int value,
+                             bm_device_mem_t mem) {
+  if (hostPointer(mem) == nullptr) return BM_ERR_PARAM;
+  // 与libsophon一致，按4字节的value填充
+  unsigned char* data = hostPointer(mem);
+  for (unsigned int i = 0; i < mem.size; ++i)
+    data[i] = static_cast<unsigned char>(value >> (8 * (i % 4)));
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_mem_mmap_device_mem(bm_handle_t handle, bm_device_mem_t* dmem,
+                                   unsigned long long* vmem) {
+  if (dmem == nullptr || vmem == nullptr) return BM_ERR_PARAM;
+  *vmem = reinterpret_cast<unsigned long long>(hostPointer(*dmem));
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_mem_unmap_device_mem(bm_handle_t handle, void* vmem,
+                                    int size) {
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_mem_invalidate_device_mem(bm_handle_t handle,
+                                         bm_device_mem_t* dmem) {
+  return BM_SUCCESS;
+}
+
+bm_status_t bm_mem_flush_device_mem(bm_handle_t handle,
+                                    bm_device_mem_t* dmem) {
+  return BM_SUCCESS;
+}
+
+tpu_kernel_module_t tpu_kernel_load_module_file(bm_handle_t handle,
+                                                const char* module_file) {
+  IVS_ERROR("tpu_kernel is not supported by the host runtime");
+  return nullptr;
+}
+
+tpu_kernel_function_t tpu_kernel_get_function(bm_handle_t handle,
+                                              tpu_kernel_module_t module,
+                                              const char* function) {
+  return -1;
+}
+
+bm_status_t tpu_kernel_launch(bm_handle_t handle, tpu_kernel_function_t func_id,
+                              void* param, size_t size) {
+  return BM_NOT_SUPPORTED;
+}
+
+bm_status_t tpu_kernel_unload_module(bm_handle_t handle,
+                                     tpu_kernel_module_t p_module) {
+  return BM_SUCCESS;
+}
@@ -0,0 +1,416 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bmruntime_interface.h"
+#include "common/logger.h"
+#include "host_memory.h"
+#include "host_network.h"
+
+namespace sophon_stream {
+namespace host {
+
+namespace {
+
+/**
+ * @brief 网络描述文件中的一个网络，bm_net_info_t中的指针都指向这里的成员
+ */
+struct HostNetwork {
+  std::string name;
+  std::vector<std::string> inputNames;
+  std::vector<std::string> outputNames;
+  std::vector<const char*> inputNamePointers;
+  std::vector<const char*> outputNamePointers;
+  std::vector<bm_data_type_t> inputDtypes;
+  std::vector<bm_data_type_t> outputDtypes;
+  std::vector<float> inputScales;
+  std::vector<float> outputScales;
+  std::vector<int> inputZeroPoints;
+  std::vector<int> outputZeroPoints;
+  std::vector<std::vector<bm_shape_t>> inputShapes;
+  std::vector<std::vector<bm_shape_t>> outputShapes;
+  std::vector<bm_stage_info_t> stages;
+  std::vector<size_t> maxInputBytes;
+  std::vector<size_t> maxOutputBytes;
+  bm_net_info_t info;
+
+  /**
+   * @brief 模拟的设备耗时：latencyUs + latencyPerFrameUs * batch
+   */
+  int latencyUs = 0;
+  int latencyPerFrameUs = 0;
+  std::unique_ptr<NetworkBackend> backend;
+};
+
+struct HostRuntime {
+  bm_handle_t handle = nullptr;
+  std::vector<std::unique_ptr<HostNetwork>> networks;
+};
+
+bool parseDtype(const std::string& name, bm_data_type_t* dtype) {
+  static const std::pair<const char*, bm_data_type_t> dtypes[] = {
+      {"FLOAT32", BM_FLOAT32}, {"FLOAT16", BM_FLOAT16}, {"INT8", BM_INT8},
+      {"UINT8", BM_UINT8},     {"INT16", BM_INT16},     {"UINT16", BM_UINT16},
+      {"INT32", BM_INT32},     {"UINT32", BM_UINT32},   {"BFLOAT16", BM_BFLOAT16}};
+  for (const auto& item : dtypes) {
+    if (name == item.first) {
+      *dtype = item.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief 解析inputs或outputs，shape不含batch维
+ */
+bool parseTensors(const nlohmann::json& tensors, std::vector<std::string>& names,
+                  std::vector<bm_data_type_t>& dtypes,
+                  std::vector<float>& scales, std::vector<int>& zeroPoints,
+                  std::vector<std::vector<int>>& shapes) {
+  if (!tensors.is_array() || tensors.empty()) return false;
+  for (const auto& tensor : tensors) {
+    bm_data_type_t dtype;
+    if (!parseDtype(tensor.value("dtype", std::string("FLOAT32")), &dtype))
+      return false;
+    auto shape = tensor.value("shape", std::vector<int>());
+    if (shape.empty() || shape.size() >= BM_MAX_DIMS_NUM) return false;
+    names.push_back(tensor.value("name", "tensor" + std::to_string(names.size())));
+    dtypes.push_back(dtype);
+    scales.push_back(tensor.value("scale", 1.0f));
+    zeroPoints.push_back(tensor.value("zero_point", 0));
+    shapes.push_back(shape);
+  }
+  return true;
+}
+
+bm_shape_t makeShape(int batch, const std::vector<int>& shape) {
+  bm_shape_t result;
+  std::memset(&result, 0, sizeof(result));
+  result.num_dims = static_cast<int>(shape.size()) + 1;
+  result.dims[0] = batch;
+  for (size_t i = 0; i < shape.size(); ++i) result.dims[i + 1] = shape[i];
+  return result;
+}
+
+std::unique_ptr<HostNetwork> parseNetwork(const nlohmann::json& config) {
+  auto network = std::make_unique<HostNetwork>();
+  network->name = config.value("name", std::string());
+  if (network->name.empty()) {
+    IVS_ERROR("host network without name");
+    return nullptr;
+  }
+  std::vector<std::vector<int>> inputShapes, outputShapes;
+  if (!parseTensors(config.value("inputs", nlohmann::json()),
+                    network->inputNames, network->inputDtypes,
+                    network->inputScales, network->inputZeroPoints,
+                    inputShapes) ||
+      !parseTensors(config.value("outputs", nlohmann::json()),
+                    network->outputNames, network->outputDtypes,
+                    network->outputScales, network->outputZeroPoints,
+                    outputShapes)) {
+    IVS_ERROR("invalid inputs or outputs of host network {0}", network->name);
+    return nullptr;
+  }
+  auto batches = config.value("batches", std::vector<int>{1});
+  std::sort(batches.begin(), batches.end());
+  batches.erase(std::unique(batches.begin(), batches.end()), batches.end());
+  if (batches.empty() || batches.front() <= 0) {
+    IVS_ERROR("invalid batches of host network {0}", network->name);
+    return nullptr;
+  }
+  network->latencyUs = config.value("latency_us", 0);
+  network->latencyPerFrameUs = config.value("latency_per_frame_us", 0);
+  network->backend = makeNetworkBackend(
+      config.value("backend", nlohmann::json{{"type", "deterministic"}}));
+  if (!network->backend) {
+    IVS_ERROR("invalid backend of host network {0}", network->name);
+    return nullptr;
+  }
+
+  size_t inputNum = network->inputNames.size();
+  size_t outputNum = network->outputNames.size();
+  for (const auto& name : network->inputNames)
+    network->inputNamePointers.push_back(name.c_str());
+  for (const auto& name : network->outputNames)
+    network->outputNamePointers.push_back(name.c_str());
+  network->maxInputBytes.assign(inputNum, 0);
+  network->maxOutputBytes.assign(outputNum, 0);
+  for (int batch : batches) {
+    std::vector<bm_shape_t> inputs, outputs;
+    for (size_t i = 0; i < inputNum; ++i) {
+      inputs.push_back(makeShape(batch, inputShapes[i]));
+      network->maxInputBytes[i] = std::max<size_t>(
+          network->maxInputBytes[i],
+          bmrt_shape_count(&inputs.back()) *
+              bmrt_data_type_size(network->inputDtypes[i]));
+    }
+    for (size_t i = 0; i < outputNum; ++i) {
+      outputs.push_back(makeShape(batch, outputShapes[i]));
+      network->maxOutputBytes[i] = std::max<size_t>(
+          network->maxOutputBytes[i],
+          bmrt_shape_count(&outputs.back()) *
+              bmrt_data_type_size(network->outputDtypes[i]));
+    }
+    network->inputShapes.push_back(std::move(inputs));
+    network->outputShapes.push_back(std::move(outputs));
+  }
+  for (size_t s = 0; s < batches.size(); ++s) {
+    bm_stage_info_t stage;
+    std::memset(&stage, 0, sizeof(stage));
+    stage.input_shapes = network->inputShapes[s].data();
+    stage.output_shapes = network->outputShapes[s].data();
+    network->stages.push_back(stage);
+  }
+
+  bm_net_info_t& info = network->info;
+  std::memset(&info, 0, sizeof(info));
+  info.name = network->name.c_str();
+  info.is_dynamic = false;
+  info.input_num = static_cast<int>(inputNum);
+  info.input_names = network->inputNamePointers.data();
+  info.input_dtypes = network->inputDtypes.data();
+  info.input_scales = network->inputScales.data();
+  info.output_num = static_cast<int>(outputNum);
+  info.output_names = network->outputNamePointers.data();
+  info.output_dtypes = network->outputDtypes.data();
+  info.output_scales = network->outputScales.data();
+  info.stage_num = static_cast<int>(network->stages.size());
+  info.stages = network->stages.data();
+  info.max_input_bytes = network->maxInputBytes.data();
+  info.max_output_bytes = network->maxOutputBytes.data();
+  info.input_zero_point = network->inputZeroPoints.data();
+  info.output_zero_point = network->outputZeroPoints.data();
+  info.core_num = 1;
+  return network;
+}
+
+HostNetwork* findNetwork(void* p_bmrt, const char* net_name) {
+  if (p_bmrt == nullptr || net_name == nullptr) return nullptr;
+  for (auto& network : static_cast<HostRuntime*>(p_bmrt)->networks) {
+    if (network->name == net_name) return network.get();
+  }
+  return nullptr;
+}
+
+/**
+ * @brief 按设备排队等待模拟的推理耗时
+ */
+void simulateLatency(bm_handle_t handle, const HostNetwork& network,
+                     int batch) {
+  int latencyUs = network.latencyUs + network.latencyPerFrameUs * batch;
+  if (latencyUs <= 0) return;
+  auto latency = std::chrono::microseconds(latencyUs);
+  std::chrono::steady_clock::time_point finish;
+  if (handle != nullptr) {
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    finish = std::max(handle->busyUntil, std::chrono::steady_clock::now()) +
+             latency;
+    handle->busyUntil = finish;
+  } else {
+    finish = std::chrono::steady_clock::now() + latency;
+  }
+  std::this_thread::sleep_until(finish);
+}
+
+}  // namespace
+
+}  // namespace host
+}  // namespace sophon_stream
+
+using sophon_stream::host::HostNetwork;
+using sophon_stream::host::HostRuntime;
+
+size_t bmrt_data_type_size(bm_data_type_t dtype) {
+  switch (dtype) {
+    case BM_FLOAT32:
+    case BM_INT32:
+    case BM_UINT32:
+      return 4;
+    case BM_FLOAT16:
+    case BM_BFLOAT16:
+    case BM_INT16:
+    case BM_UINT16:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
+uint64_t bmrt_shape_count(const bm_shape_t* shape) {
+  uint64_t count = 1;
+  for (int i = 0; i < shape->num_dims; ++i) count *= shape->dims[i];
+  return count;
+}
+
+bool bmrt_shape_is_same(const bm_shape_t* left, const bm_shape_t* right) {
+  if (left->num_dims != right->num_dims) return false;
+  for (int i = 0; i < left->num_dims; ++i)
+    if (left->dims[i] != right->dims[i]) return false;
+  return true;
+}
+
+size_t bmrt_tensor_bytesize(const bm_tensor_t* tensor) {
+  return bmrt_shape_count(&tensor->shape) * bmrt_data_type_size(tensor->dtype);
+}
+
+size_t bmrt_tensor_device_size(const bm_tensor_t* tensor) {
+  return tensor->device_mem.size;
+}
+
+bool bmrt_tensor(bm_tensor_t* tensor, void* p_bmrt, bm_data_type_t dtype,
+                 bm_shape_t shape) {
+  if (tensor == nullptr) return false;
+  tensor->dtype = dtype;
+  tensor->shape = shape;
+  tensor->st_mode = BM_STORE_1N;
+  return sophon_stream::host::allocateDeviceMemory(
+      &tensor->device_mem,
+      static_cast<unsigned int>(bmrt_tensor_bytesize(tensor)));
+}
+
+void* bmrt_create(bm_handle_t bm_handle) {
+  auto runtime = new HostRuntime;
+  runtime->handle = bm_handle;
+  return runtime;
+}
+
+void bmrt_destroy(void* p_bmrt) { delete static_cast<HostRuntime*>(p_bmrt); }
+
+void* bmrt_get_bm_handle(void* p_bmrt) {
+  return p_bmrt == nullptr ? nullptr : static_cast<HostRuntime*>(p_bmrt)->handle;
+}
+
+bool bmrt_load_bmodel(void* p_bmrt, const char* bmodel_path) {
+  if (p_bmrt == nullptr || bmodel_path == nullptr) return false;
+  std::ifstream file(bmodel_path);
+  if (!file.is_open()) {
+    IVS_ERROR("can not open host network description {0}", bmodel_path);
+    return false;
+  }
+  nlohmann::json config = nlohmann::json::parse(file, nullptr, false);
+  if (config.is_discarded() || !config.contains("networks") ||
+      !config["networks"].is_array()) {
+    IVS_ERROR("invalid host network description {0}", bmodel_path);
+    return false;
+  }
+  std::vector<std::unique_ptr<HostNetwork>> networks;
+  for (const auto& item : config["networks"]) {
+    auto network = sophon_stream::host::parseNetwork(item);
+    if (!network) return false;
+    networks.push_back(std::move(network));
+  }
+  auto runtime = static_cast<HostRuntime*>(p_bmrt);
+  for (auto& network : networks) runtime->networks.push_back(std::move(network));
+  return true;
+}
+
+int bmrt_get_network_number(void* p_bmrt) {
+  if (p_bmrt == nullptr) return 0;
+  return static_cast<int>(static_cast<HostRuntime*>(p_bmrt)->networks.size());
+}
+
+void bmrt_get_network_names(void* p_bmrt, const char*** network_names) {
+  int number = bmrt_get_network_number(p_bmrt);
+  *network_names = static_cast<const char**>(
+      std::malloc(sizeof(const char*) * std::max(number, 1)));
+  for (int i = 0; i < number; ++i)
+    (*network_names)[i] =
+        static_cast<HostRuntime*>(p_bmrt)->networks[i]->name.c_str();
+}
+
+const bm_net_info_t* bmrt_get_network_info(void* p_bmrt, const char* net_name) {
+  auto network = sophon_stream::host::findNetwork(p_bmrt, net_name);
+  return network == nullptr ? nullptr : &network->info;
+}
+
+bool bmrt_launch_tensor(void* p_bmrt, const char* net_name,
+                        const bm_tensor_t input_tensors[], int input_num,
+                        bm_tensor_t output_tensors[], int output_num) {
+  return bmrt_launch_tensor_ex(p_bmrt, net_name, input_tensors, input_num,
+                               output_tensors, output_num, false, false);
+}
+
+bool bmrt_launch_tensor_ex(void* p_bmrt, const char* net_name,
+                           const bm_tensor_t input_tensors[], int input_num,
+                           bm_tensor_t output_tensors[], int output_num,
+                           bool user_mem, bool user_stmode) {
+  auto network = sophon_stream::host::findNetwork(p_bmrt, net_name);
+  if (network == nullptr) {
+    IVS_ERROR("host network {0} not found", net_name ? net_name : "");
+    return false;
+  }
+  const bm_net_info_t& info = network->info;
+  if (input_num != info.input_num || output_num != info.output_num)
+    return false;
+
+  // 静态网络的输入shape必须与某个stage一致
+  int stage = -1;
+  for (int s = 0; s < info.stage_num && stage < 0; ++s) {
+    bool same = true;
+    for (int i = 0; i < input_num && same; ++i)
+      same = bmrt_shape_is_same(&input_tensors[i].shape,
+                                &info.stages[s].input_shapes[i]);
+    if (same) stage = s;
+  }
+  if (stage < 0) {
+    IVS_ERROR("input shape of host network {0} matches no stage", info.name);
+    return false;
+  }
+  for (int i = 0; i < input_num; ++i) {
+    if (bm_mem_get_device_addr(input_tensors[i].device_mem) == 0 ||
+        bm_mem_get_device_size(input_tensors[i].device_mem) <
+            bmrt_tensor_bytesize(&input_tensors[i]))
+      return false;
+  }
+  for (int i = 0; i < output_num; ++i) {
+    bm_tensor_t& output = output_tensors[i];
+    output.dtype = info.output_dtypes[i];
+    output.shape = info.stages[stage].output_shapes[i];
+    output.st_mode = BM_STORE_1N;
+    auto bytes = static_cast<unsigned int>(bmrt_tensor_bytesize(&output));
+    if (user_mem) {
+      if (bm_mem_get_device_size(output.device_mem) < bytes) return false;
+    } else if (!sophon_stream::host::allocateDeviceMemory(&output.device_mem,
+                                                          bytes)) {
+      return false;
+    }
+  }
+
+  bool ok = network->backend->forward(info, input_tensors, input_num,
+                                      output_tensors, output_num);
+  if (!ok && !user_mem) {
+    for (int i = 0; i < output_num; ++i)
+      bm_free_device(nullptr, output_tensors[i].device_mem);
+  }
+  sophon_stream::host::simulateLatency(
+      static_cast<HostRuntime*>(p_bmrt)->handle, *network,
+      input_tensors[0].shape.dims[0]);
+  return ok;
+}
+
+bool bmrt_launch_tensor_multi_cores(void* p_bmrt, const char* net_name,
+                                    const bm_tensor_t input_tensors[],
+                                    int input_num, bm_tensor_t output_tensors[],
+                                    int output_num, bool user_mem,
+                                    bool user_stmode, const int* core_list,
+                                    int core_num) {
+  return bmrt_launch_tensor_ex(p_bmrt, net_name, input_tensors, input_num,
+                               output_tensors, output_num, user_mem,
+                               user_stmode);
+}
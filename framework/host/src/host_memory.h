@@ -0,0 +1,49 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_HOST_SRC_HOST_MEMORY_H_
+#define SOPHON_STREAM_HOST_SRC_HOST_MEMORY_H_
+
+#include <chrono>
+#include <mutex>
+
+#include "bmlib_runtime.h"
+
+struct bm_context {
+  int devId = 0;
+  /**
+   * @brief 模拟的推理耗时按设备排队，同一设备上的推理不重叠
+   */
+  std::mutex mutex;
+  std::chrono::steady_clock::time_point busyUntil;
+};
+
+namespace sophon_stream {
+namespace host {
+
+/**
+ * @brief 设备内存和system内存对应的host指针
+ */
+inline unsigned char* hostPointer(const bm_device_mem_t& mem) {
+  if (mem.flags.u.mem_type == BM_MEM_TYPE_SYSTEM)
+    return static_cast<unsigned char*>(mem.u.system.system_addr);
+  return reinterpret_cast<unsigned char*>(mem.u.device.device_addr);
+}
+
+/**
+ * @brief 申请清零的host内存作为设备内存，失败时返回false
+ */
+bool allocateDeviceMemory(bm_device_mem_t* mem, unsigned int size);
+
+void freeDeviceMemory(const bm_device_mem_t& mem);
+
+}  // namespace host
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_HOST_SRC_HOST_MEMORY_H_
@@ -0,0 +1,271 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "host_network.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "common/logger.h"
+#include "host_memory.h"
+
+namespace sophon_stream {
+namespace host {
+
+namespace {
+
+std::uint16_t floatToHalf(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::uint32_t sign = (bits >> 16) & 0x8000;
+  int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+  std::uint32_t mantissa = bits & 0x7fffff;
+  if (exponent <= 0) {
+    if (exponent < -10) return static_cast<std::uint16_t>(sign);
+    mantissa |= 0x800000;
+    int shift = 14 - exponent;
+    std::uint32_t half = mantissa >> shift;
+    if ((mantissa >> (shift - 1)) & 1) ++half;
+    return static_cast<std::uint16_t>(sign | half);
+  }
+  if (exponent >= 31) return static_cast<std::uint16_t>(sign | 0x7c00);
+  std::uint32_t half = (exponent << 10) | (mantissa >> 13);
+  if (mantissa & 0x1000) ++half;
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+/**
+ * @brief 按dtype写入第index个值，整数类型按value / scale + zeroPoint量化
+ */
+void storeValue(bm_data_type_t dtype, float scale, int zeroPoint, void* data,
+                std::size_t index, float value) {
+  float quantized = std::nearbyint(value / (scale == 0 ? 1 : scale)) + zeroPoint;
+  auto clamp = [quantized](float low, float high) {
+    return std::min(std::max(quantized, low), high);
+  };
+  switch (dtype) {
+    case BM_FLOAT32:
+      static_cast<float*>(data)[index] = value;
+      break;
+    case BM_FLOAT16:
+      static_cast<std::uint16_t*>(data)[index] = floatToHalf(value);
+      break;
+    case BM_BFLOAT16: {
+      std::uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      static_cast<std::uint16_t*>(data)[index] =
+          static_cast<std::uint16_t>(bits >> 16);
+      break;
+    }
+    case BM_INT8:
+      static_cast<std::int8_t*>(data)[index] =
+          static_cast<std::int8_t>(clamp(-128, 127));
+      break;
+    case BM_UINT8:
+      static_cast<std::uint8_t*>(data)[index] =
+          static_cast<std::uint8_t>(clamp(0, 255));
+      break;
+    case BM_INT16:
+      static_cast<std::int16_t*>(data)[index] =
+          static_cast<std::int16_t>(clamp(-32768, 32767));
+      break;
+    case BM_UINT16:
+      static_cast<std::uint16_t*>(data)[index] =
+          static_cast<std::uint16_t>(clamp(0, 65535));
+      break;
+    case BM_INT32:
+      static_cast<std::int32_t*>(data)[index] =
+          static_cast<std::int32_t>(quantized);
+      break;
+    case BM_UINT32:
+      static_cast<std::uint32_t*>(data)[index] =
+          static_cast<std::uint32_t>(std::max(quantized, 0.f));
+      break;
+  }
+}
+
+std::uint64_t mix(std::uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+std::uint64_t hashBytes(const unsigned char* data, std::size_t size,
+                        std::uint64_t hash) {
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ULL + 0x9e3779b97f4a7c15ULL;
+  }
+  for (; i < size; ++i) hash = (hash ^ data[i]) * 0x100000001b3ULL;
+  return mix(hash);
+}
+
+/**
+ * @brief 输出由输入内容决定的伪随机值
+ * @details
+ * 每一帧的输出只取决于seed和该帧的输入，与batch的组成无关，
+ * 同样的输入在任意batch下得到同样的输出，可以用于回归比较
+ */
+class DeterministicBackend : public NetworkBackend {
+ public:
+  explicit DeterministicBackend(const nlohmann::json& config)
+      : mSeed(config.value("seed", 0ULL)),
+        mMin(config.value("min", 0.f)),
+        mMax(config.value("max", 1.f)) {}
+
+  bool forward(const bm_net_info_t& info, const bm_tensor_t* inputs,
+               int inputNum, bm_tensor_t* outputs, int outputNum) override {
+    int batch = inputs[0].shape.dims[0];
+    for (int b = 0; b < batch; ++b) {
+      std::uint64_t hash = mix(mSeed + 1);
+      for (int i = 0; i < inputNum; ++i) {
+        std::size_t frameBytes = bmrt_tensor_bytesize(&inputs[i]) / batch;
+        hash = hashBytes(hostPointer(inputs[i].device_mem) + b * frameBytes,
+                         frameBytes, hash);
+      }
+      for (int o = 0; o < outputNum; ++o) {
+        std::uint64_t state = mix(hash + o);
+        std::size_t count = bmrt_shape_count(&outputs[o].shape) / batch;
+        void* data = hostPointer(outputs[o].device_mem);
+        for (std::size_t k = 0; k < count; ++k) {
+          state += 0x9e3779b97f4a7c15ULL;
+          float unit = (mix(state) >> 40) * (1.f / (1 << 24));
+          storeValue(outputs[o].dtype, info.output_scales[o],
+                     info.output_zero_point ? info.output_zero_point[o] : 0,
+                     data, b * count + k, mMin + (mMax - mMin) * unit);
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  const std::uint64_t mSeed;
+  const float mMin;
+  const float mMax;
+};
+
+/**
+ * @brief 依次回放录制的输出
+ * @details
+ * files中每个输出一个文件，文件内是按输出dtype存放的逐帧输出，
+ * 每帧的大小为不含batch维的输出大小；所有帧用完后从头开始
+ */
+class ReplayBackend : public NetworkBackend {
+ public:
+  bool load(const nlohmann::json& config) {
+    auto files = config.value("files", std::vector<std::string>());
+    for (const auto& path : files) {
+      std::ifstream file(path, std::ios::binary);
+      if (!file.is_open()) {
+        IVS_ERROR("can not open replay file {0}", path);
+        return false;
+      }
+      mRecords.emplace_back(std::istreambuf_iterator<char>(file),
+                            std::istreambuf_iterator<char>());
+    }
+    return !mRecords.empty();
+  }
+
+  bool forward(const bm_net_info_t& info, const bm_tensor_t* inputs,
+               int inputNum, bm_tensor_t* outputs, int outputNum) override {
+    if (outputNum != static_cast<int>(mRecords.size())) {
+      IVS_ERROR("{0}: {1:d} replay files for {2:d} outputs", info.name,
+                static_cast<int>(mRecords.size()), outputNum);
+      return false;
+    }
+    int batch = inputs[0].shape.dims[0];
+    std::size_t first = mNextFrame.fetch_add(batch);
+    for (int o = 0; o < outputNum; ++o) {
+      std::size_t frameBytes = bmrt_tensor_bytesize(&outputs[o]) / batch;
+      std::size_t frames = frameBytes ? mRecords[o].size() / frameBytes : 0;
+      if (frames == 0 || mRecords[o].size() % frameBytes != 0) {
+        IVS_ERROR(
+            "{0}: replay file of output {1:d} is not a whole number of "
+            "{2:d}-byte frames",
+            info.name, o, frameBytes);
+        return false;
+      }
+      unsigned char* data = hostPointer(outputs[o].device_mem);
+      for (int b = 0; b < batch; ++b) {
+        std::memcpy(data + b * frameBytes,
+                    mRecords[o].data() + (first + b) % frames * frameBytes,
+                    frameBytes);
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::vector<std::vector<char>> mRecords;
+  std::atomic<std::size_t> mNextFrame{0};
+};
+
+struct BackendRegistry {
+  std::mutex mutex;
+  std::map<std::string, NetworkBackendMaker> makers;
+
+  BackendRegistry() {
+    makers["deterministic"] = [](const nlohmann::json& config) {
+      return std::unique_ptr<NetworkBackend>(new DeterministicBackend(config));
+    };
+    makers["replay"] = [](const nlohmann::json& config) {
+      auto backend = std::make_unique<ReplayBackend>();
+      return backend->load(config) ? std::unique_ptr<NetworkBackend>(
+                                         std::move(backend))
+                                   : nullptr;
+    };
+  }
+};
+
+BackendRegistry& registry() {
+  static BackendRegistry instance;
+  return instance;
+}
+
+}  // namespace
+
+bool registerNetworkBackend(const std::string& name,
+                            NetworkBackendMaker maker) {
+  auto& instance = registry();
+  std::lock_guard<std::mutex> lock(instance.mutex);
+  return instance.makers.emplace(name, std::move(maker)).second;
+}
+
+std::unique_ptr<NetworkBackend> makeNetworkBackend(
+    const nlohmann::json& config) {
+  std::string type = config.value("type", std::string("deterministic"));
+  NetworkBackendMaker maker;
+  {
+    auto& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    auto it = instance.makers.find(type);
+    if (it == instance.makers.end()) {
+      IVS_ERROR("unknown host network backend {0}", type);
+      return nullptr;
+    }
+    maker = it->second;
+  }
+  return maker(config);
+}
+
+}  // namespace host
+}  // namespace sophon_stream
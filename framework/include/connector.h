@@ -18,10 +18,18 @@ namespace framework {
 
 class Connector : public ::sophon_stream::common::NoCopyable {
  public:
-  Connector(int dataPipeCount);
+  Connector(int dataPipeCount,
+            const DataPipeConfig& config = DataPipeConfig());
 
   std::shared_ptr<void> popData(int id);
+  std::shared_ptr<void> popData(int id, std::chrono::microseconds timeout);
   common::ErrorCode pushData(int id, std::shared_ptr<void> data);
+  common::ErrorCode pushData(int id, std::shared_ptr<void> data,
+                             std::chrono::milliseconds timeout);
+  /**
+   * @brief 唤醒Connector中所有dataPipe上阻塞的线程
+   */
+  void wakeup();
   /**
    * @brief 获取Connector中dataPipe的数量
    * @return int 当前Connector中dataPipe数量
@@ -30,10 +38,24 @@ class Connector : public ::sophon_stream::common::NoCopyable {
 
   std::shared_ptr<DataPipe> getDataPipe(int id) const;
 
+  DataPipeType getType() const { return mConfig.type; }
+
+  const DataPipeConfig& getConfig() const { return mConfig; }
+
+  /**
+   * @brief 为Connector中所有dataPipe设置丢弃策略所需的数据解析方法
+   */
+  void setDataInfoGetter(DataPipe::DataInfoGetter getter);
+
+  /**
+   * @brief 为Connector中所有dataPipe设置push回调，回调参数为dataPipe的id
+   */
+  void setPushHandler(std::function<void(int)> handler);
 
  private:
   std::vector<std::shared_ptr<DataPipe>> mDataPipes;
   int mCapacity = 0;
+  DataPipeConfig mConfig;
 };
 
 }  // namespace framework
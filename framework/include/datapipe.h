@@ -10,26 +10,113 @@
 #ifndef SOPHON_STREAM_FRAMEWORK_DATAPIPE_H_
 #define SOPHON_STREAM_FRAMEWORK_DATAPIPE_H_
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 
 #include "common/error_code.h"
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "common/no_copyable.h"
+#include "common/ring_buffer.h"
 
 namespace sophon_stream {
 namespace framework {
 
+#define DEFAULT_DATA_PIPE_CAPACITY 20
+
+/**
+ * @brief DataPipe的队列实现
+ * @brief MUTEX: std::deque + std::mutex，支持任意数量的生产者和消费者
+ * @brief SPSC: 无锁环形队列，只允许一个生产者线程和一个消费者线程
+ * @brief MPSC: 无锁环形队列，允许多个生产者线程和一个消费者线程
+ */
+enum class DataPipeType {
+  MUTEX,
+  SPSC,
+  MPSC,
+};
+
+/**
+ * @brief 解析graph配置中connection的queue_type字段
+ * @param[in] name : "mutex", "spsc", "mpsc"或"lockfree"
+ * @param[out] type : 解析结果，"lockfree"解析为MPSC，由graph根据拓扑决定是否降为SPSC
+ * @return 名称合法返回true
+ */
+bool dataPipeTypeFromString(const std::string& name, DataPipeType& type);
+
+const char* dataPipeTypeToString(DataPipeType type);
+
+/**
+ * @brief 队列已满时的处理策略
+ * @brief BLOCK: 生产者阻塞等待，直到队列有空位
+ * @brief DROP_OLDEST: 丢弃队首最旧的数据，为新数据腾出空位
+ * @brief DROP_NEWEST: 丢弃当前要push的新数据
+ * @brief KEEP_LATEST_PER_CHANNEL: 丢弃与新数据同一路码流中最旧的数据，
+ * 该路码流在队列中没有数据时退化为DROP_OLDEST
+ * @brief 除BLOCK外的策略只对MUTEX类型的队列生效，且不会丢弃码流结束帧
+ */
+enum class OverflowPolicy {
+  BLOCK,
+  DROP_OLDEST,
+  DROP_NEWEST,
+  KEEP_LATEST_PER_CHANNEL,
+};
+
+/**
+ * @brief 解析graph配置中connection的overflow_policy字段
+ * @param[in] name : "block", "drop_oldest", "drop_newest"或"keep_latest_per_channel"
+ * @param[out] policy : 解析结果
+ * @return 名称合法返回true
+ */
+bool overflowPolicyFromString(const std::string& name, OverflowPolicy& policy);
+
+const char* overflowPolicyToString(OverflowPolicy policy);
+
+/**
+ * @brief 单个DataPipe的配置，对应graph配置中的一条connection
+ */
+struct DataPipeConfig {
+  DataPipeType type = DataPipeType::MUTEX;
+  std::size_t capacity = DEFAULT_DATA_PIPE_CAPACITY;
+  OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK;
+
+  bool operator==(const DataPipeConfig& other) const {
+    return type == other.type && capacity == other.capacity &&
+           overflowPolicy == other.overflowPolicy;
+  }
+  bool operator!=(const DataPipeConfig& other) const {
+    return !(*this == other);
+  }
+};
+
 class DataPipe : public ::sophon_stream::common::NoCopyable {
  public:
   using PushHandler = std::function<void()>;
 
-  DataPipe();
+  /**
+   * @brief 丢弃策略需要的数据信息
+   * @brief channel: 数据所属码流，用于KEEP_LATEST_PER_CHANNEL
+   * @brief droppable: 为false时该数据不会被丢弃，例如码流结束帧
+   */
+  struct DataInfo {
+    int channel = -1;
+    bool droppable = true;
+  };
+  /**
+   * @brief DataPipe不关心数据的具体类型，由上层提供解析数据信息的方法
+   */
+  using DataInfoGetter =
+      std::function<DataInfo(const std::shared_ptr<void>& data)>;
+
+  DataPipe(const DataPipeConfig& config = DataPipeConfig());
 
   ~DataPipe();
 
@@ -39,21 +126,125 @@ class DataPipe : public ::sophon_stream::common::NoCopyable {
    */
   std::shared_ptr<void> popData();
 
+  /**
+   * @brief 从队首弹出数据，队列为空时阻塞等待
+   * @param[in] timeout : 最长等待时间，组batch时需要微秒精度
+   * @return std::shared_ptr<void>
+   * 等待期间有数据到达则弹出队首；超时或被wakeup()唤醒时返回nullptr
+   */
+  std::shared_ptr<void> popData(std::chrono::microseconds timeout);
+
   /**
    * @brief 向队列末尾push数据
    * @return common::ErrorCode
    * 成功返回common::ErrorCode::SUCCESS，失败返回common::ErrorCode::DATA_PIPE_FULL
    */
   common::ErrorCode pushData(std::shared_ptr<void> data);
+
+  /**
+   * @brief 向队列末尾push数据，队列已满时阻塞等待
+   * @param[in] timeout : 最长等待时间
+   * @return common::ErrorCode
+   * 成功返回common::ErrorCode::SUCCESS，超时或被wakeup()唤醒时返回common::ErrorCode::DATA_PIPE_FULL
+   */
+  common::ErrorCode pushData(std::shared_ptr<void> data,
+                             std::chrono::milliseconds timeout);
+
+  /**
+   * @brief 唤醒所有阻塞在popData/pushData上的线程，用于element停止时退出等待
+   */
+  void wakeup();
   /**
    * @brief 获取当前队列中元素的数量
    * @return mDataQueue中元素数量
    */
   int getSize();
 
+  DataPipeType getType() const { return mType; }
+
+  const DataPipeConfig& getConfig() const { return mConfig; }
+
+  void setDataInfoGetter(DataInfoGetter getter);
+
+  /**
+   * @brief 设置push成功后的回调，pool调度下用于通知消费者element调度任务
+   * @note 需在数据开始流动前设置
+   */
+  void setPushHandler(PushHandler handler) { mPushHandler = handler; }
+
+  /**
+   * @brief 获取因队列已满而被丢弃的数据数量
+   */
+  std::uint64_t getDropCount() const {
+    return mDropCount.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 数据从入队到被取出的等待时间，用于定位积压的环节
+   */
+  std::shared_ptr<common::LatencyHistogram> getWaitTimeHistogram() const {
+    return mWaitTimeHistogram;
+  }
+
  private:
-  std::deque<std::shared_ptr<void> > mDataQueue;
+  /**
+   * @brief 队列中的元素，记录入队时间用于统计等待时间
+   */
+  struct QueueItem {
+    std::shared_ptr<void> data;
+    std::chrono::steady_clock::time_point pushTime;
+  };
+
+  /**
+   * @brief 按mType分派到具体队列实现的非阻塞读写
+   * @note tryPush失败时item.data保持不变
+   */
+  bool tryPush(QueueItem& item);
+  bool tryPop(std::shared_ptr<void>& data);
+
+  /**
+   * @brief 队列已满时按mConfig.overflowPolicy丢弃一个数据，调用者需持有mDataQueueMutex
+   * @return 丢弃了队列中的旧数据或新数据本身时返回true；没有可丢弃的数据时返回false
+   * @note 若丢弃的是新数据本身，item.data被置空
+   */
+  bool dropForOverflowLocked(QueueItem& item);
+
+  void notifyNotEmpty();
+  void notifyNotFull();
+
+  DataPipeConfig mConfig;
+  DataPipeType mType;
+
+  DataInfoGetter mDataInfoGetter;
+  PushHandler mPushHandler;
+  std::atomic<std::uint64_t> mDropCount{0};
+  std::shared_ptr<common::LatencyHistogram> mWaitTimeHistogram;
+
+  std::deque<QueueItem> mDataQueue;
   mutable std::mutex mDataQueueMutex;
+
+  std::unique_ptr<common::SpscRingBuffer<QueueItem> > mSpscQueue;
+  std::unique_ptr<common::MpscRingBuffer<QueueItem> > mMpscQueue;
+
+  /**
+   * @brief 阻塞等待相关的状态，与队列本身的同步相互独立，
+   * 只有存在等待线程时push/pop才需要获取mWaitMutex
+   */
+  std::mutex mWaitMutex;
+  /**
+   * @brief push成功后唤醒一个等待的消费者
+   */
+  std::condition_variable mNotEmptyCond;
+  /**
+   * @brief pop成功后唤醒一个等待的生产者
+   */
+  std::condition_variable mNotFullCond;
+  std::atomic<int> mWaitingConsumers{0};
+  std::atomic<int> mWaitingProducers{0};
+  /**
+   * @brief 每次wakeup()自增，等待中的线程据此判断是否被主动唤醒
+   */
+  std::size_t mWakeupSeq = 0;
   std::size_t mCapacity;
 
   const std::chrono::milliseconds timeout{200};
@@ -29,10 +29,12 @@
 #include "common/error_code.h"
 #include "common/http_defs.h"
 // #include "common/logger.h"
+#include "common/metrics.h"
 #include "common/no_copyable.h"
 #include "connector.h"
 #include "datapipe.h"
 #include "listen_thread.h"
+#include "worker_pool.h"
 
 namespace sophon_stream {
 namespace framework {
@@ -60,9 +62,12 @@ class Element : public ::sophon_stream::common::NoCopyable {
    * @param[in] srcElementPort : Output port of source element
    * @param[in,out] dstElement : Destination element
    * @param[in] dstElementPort : Input port of destination element
+   * @param[in] dataPipeConfig : 新建inputConnector时使用的队列实现、容量和溢出策略，
+   * 若dstElementPort的connector已存在则沿用已有配置
    */
   static void connect(Element& srcElement, int srcElementPort,
-                      Element& dstElement, int dstElementPort);
+                      Element& dstElement, int dstElementPort,
+                      const DataPipeConfig& dataPipeConfig = DataPipeConfig());
 
   Element();
 
@@ -89,6 +94,14 @@ class Element : public ::sophon_stream::common::NoCopyable {
    */
   std::shared_ptr<void> popInputData(int inputPort, int dataPipeId);
 
+  /**
+   * @brief 从指定inputPort的指定dataPipe中弹出数据，队列为空时阻塞等待
+   * @brief 超时或element停止时返回nullptr，调用方无需再自行sleep轮询
+   * @param[in] timeout : 最长等待时间，一般使用DATA_PIPE_WAIT_TIMEOUT
+   */
+  std::shared_ptr<void> popInputData(int inputPort, int dataPipeId,
+                                     std::chrono::microseconds timeout);
+
   /**
    * @brief 向指定inputPort的指定dataPipe推入数据，用于启动解码任务
    * @param[in] data : sophon_stream::element::decode::ChannelTask结构体指针
@@ -127,6 +140,11 @@ class Element : public ::sophon_stream::common::NoCopyable {
 
   int getId() const { return mId; }
 
+  /**
+   * @brief element在工厂中注册的名称，如"yolov5"，用于日志和监控指标
+   */
+  const std::string& getName() const { return mName; }
+
   int getGraphId() const { return mGraphId; }
   virtual void setGraphId(int id) { mGraphId = id; }
 
@@ -148,6 +166,7 @@ class Element : public ::sophon_stream::common::NoCopyable {
   };
 
   inline void setId(const int id) { mId = id; }
+  inline void setName(const std::string& name) { mName = name; }
   inline void setSide(const std::string side) { mSide = side; }
   inline void setSinkFlag(const bool flag) { mSinkElementFlag = flag; }
   inline void setDeviceId(const int id) { mDeviceId = id; }
@@ -163,6 +182,11 @@ class Element : public ::sophon_stream::common::NoCopyable {
   static constexpr const char* JSON_IS_SINK_FILED = "is_sink";
   static constexpr const char* JSON_INNER_ELEMENTS_ID = "inner_elements_id";
 
+  /**
+   * @brief 阻塞读写dataPipe时的默认等待时间，超时后重新检查线程状态
+   */
+  static constexpr std::chrono::milliseconds DATA_PIPE_WAIT_TIMEOUT{200};
+
   std::map<int, std::shared_ptr<framework::Connector>>& getInputConnectorMap() {
     return mInputConnectorMap;
   }
@@ -186,6 +210,34 @@ class Element : public ::sophon_stream::common::NoCopyable {
   inline ListenThread* getListener() { return listenThreadPtr; }
   inline virtual void setListener(ListenThread* p) { listenThreadPtr = p; }
 
+  /**
+   * @brief 设置后element由workerPool调度，start()时不再创建线程；需在start()之前调用
+   * @param[in] workerPool : 为nullptr时恢复为每个dataPipe一个线程
+   */
+  void setWorkerPool(std::shared_ptr<WorkerPool> workerPool) {
+    mWorkerPool = workerPool;
+  }
+
+  SchedulerType getSchedulerType() const {
+    return mWorkerPool ? SchedulerType::POOL : SchedulerType::THREAD;
+  }
+
+  /**
+   * @brief 开启后在popInputData/pushOutputData中为ObjectMetadata记录经过时间，需在start()之前调用
+   * @param[in] sampleInterval : source element每隔多少帧采样一帧保存完整记录，
+   * 用于导出chrome trace，0表示不采样
+   */
+  void setTrace(bool enable, int sampleInterval) {
+    mTraceEnabled = enable;
+    mTraceSampleInterval = sampleInterval;
+  }
+
+  /**
+   * @brief pool调度下单个任务最多连续调用doWork的次数，超过后重新排队，
+   * 避免一个element长期占用worker
+   */
+  static constexpr int POOL_TASK_MAX_ROUNDS = 16;
+
  protected:
   /**
    * @brief 从配置文件初始化某个派生element的特有属性
@@ -206,9 +258,26 @@ class Element : public ::sophon_stream::common::NoCopyable {
 
   /**
    * @brief 派生element中实现自身功能
+   * @brief pool调度下popInputData不会阻塞，doWork取不到数据时应尽快返回，
+   * 队列中再有数据时会被重新调度，参见shouldWaitInputData()
    */
   virtual common::ErrorCode doWork(int dataPipeId) = 0;
 
+  /**
+   * @brief popInputData没有取到数据时，doWork是否应继续等待
+   * @brief 线程调度下element处于RUN状态时返回true；
+   * pool调度下返回false，doWork应处理已取到的数据后返回
+   */
+  bool shouldWaitInputData() const {
+    return ThreadStatus::RUN == mThreadStatus && !mWorkerPool;
+  }
+
+  /**
+   * @brief 指定inputPort的指定dataPipe中是否有数据，
+   * 需要从多个inputPort各取一个数据的element在pool调度下据此判断能否开始处理
+   */
+  bool hasInputData(int inputPort, int dataPipeId);
+
   std::vector<int> getInputPorts();
   std::vector<int> getOutputPorts();
 
@@ -221,9 +290,86 @@ class Element : public ::sophon_stream::common::NoCopyable {
    */
   int getInputConnectorCapacity(int inputPort);
 
+  /**
+   * @brief 监控指标的公共标签：graph_id, element_id, element，
+   * 派生element注册自己的指标时在此基础上追加
+   */
+  common::MetricLabels getMetricLabels() const;
+
  private:
+  /**
+   * @brief pool调度下每个dataPipe对应一个任务，同一时刻只有一个worker执行，
+   * 因此同一dataPipe内（即同一路码流）的数据仍按顺序处理
+   */
+  struct PoolTaskState {
+    /**
+     * @brief 任务已提交或正在执行
+     */
+    std::atomic<bool> scheduled{false};
+    /**
+     * @brief 上次执行doWork之后有新数据到达
+     */
+    std::atomic<bool> notified{false};
+    /**
+     * @brief 从该dataPipe成功取出的数据数量，用于判断doWork是否有进展
+     */
+    std::atomic<std::uint64_t> popCount{0};
+  };
+
+  void schedulePoolTask(int dataPipeId);
+  void runPoolTask(int dataPipeId);
+  bool hasAnyInputData(int dataPipeId);
+
+  /**
+   * @brief 调用doWork并统计耗时，从doWork中第一次取到数据开始计时，
+   * 不计入线程调度下阻塞等待输入的时间
+   */
+  void doWorkWithMetrics(int dataPipeId);
+
+  /**
+   * @brief 向MetricsRegistry注册当前element的指标，start()时调用
+   */
+  void registerMetrics();
+  /**
+   * @brief 注册指定inputPort上各dataPipe的队列长度、等待时间等指标
+   */
+  void registerInputConnectorMetrics(int inputPort);
+
+  /**
+   * @brief 数据从connect()建立的inputPort取出时记录进入时间，
+   * 其他inputPort（如decode的channelTask）上的数据不是ObjectMetadata，不做处理
+   */
+  void traceEnter(int inputPort, const std::shared_ptr<void>& data);
+  /**
+   * @brief 数据送出时记录离开时间，source element在此创建trace，sink element在此汇总
+   */
+  void traceExit(const std::shared_ptr<void>& data);
+
+  bool mTraceEnabled = false;
+  int mTraceSampleInterval = 0;
+
+  /**
+   * @brief doWork中处理数据的耗时
+   */
+  std::shared_ptr<common::LatencyHistogram> mWorkTimeHistogram;
+  /**
+   * @brief outputPort到pushOutputData因下游队列已满而阻塞的时间，只记录发生阻塞的push
+   * @brief start()时为每个outputPort创建，之后只读
+   */
+  std::map<int, std::shared_ptr<common::LatencyHistogram>>
+      mPushBlockedTimeHistograms;
+
+  std::shared_ptr<WorkerPool> mWorkerPool;
+  std::unique_ptr<PoolTaskState[]> mPoolTaskStates;
+  /**
+   * @brief 已提交但尚未执行完的任务数量，stop()时等待其归零
+   */
+  std::atomic<int> mPoolTaskCount{0};
+
   int mId;
 
+  std::string mName;
+
   int mGraphId;
 
   std::string mSide;
@@ -105,13 +105,16 @@ class Engine : public ::sophon_stream::common::NoCopyable {
 //mGraphMap: 用于存储图的映射，graphId 映射到 Graph 对象的共享指针。
 //mGraphMapLock: 互斥锁，用于保护对 mGraphMap 的访问，确保线程安全。
 //mGraphIds: 存储图的ID列表。
-listenThreadPtr: 指向监听线程的指针。
+//listenThreadPtr: 指向监听线程的指针。
   std::map<int /* graphId */, std::shared_ptr<framework::Graph> > mGraphMap;
   std::mutex mGraphMapLock;
 
   std::vector<int> mGraphIds;
 
   ListenThread* listenThreadPtr;
+
+//mWorkerPool: scheduler为pool的graph共享的线程池，第一个使用pool的graph添加时创建。
+  std::shared_ptr<WorkerPool> mWorkerPool;
 };
 
 //using SingletonEngine = common::Singleton<Engine>;: 定义 SingletonEngine 为 Engine 类的单例实例类型，确保全局只有一个 Engine 实例。
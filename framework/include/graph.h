@@ -70,25 +70,106 @@ class Graph : public ::sophon_stream::common::NoCopyable {
 
   inline void setListener(ListenThread* p) { listenThreadPtr = p; }
 
+  SchedulerType getSchedulerType() const { return mSchedulerType; }
+
+  /**
+   * @brief graph配置中指定的pool线程数，未指定时为0
+   */
+  int getPoolThreadNumber() const { return mPoolThreadNumber; }
+
+  /**
+   * @brief 设置scheduler为pool时使用的WorkerPool，需在start()之前调用
+   */
+  void setWorkerPool(std::shared_ptr<WorkerPool> workerPool) {
+    mWorkerPool = workerPool;
+  }
+
   static constexpr const char* JSON_GRAPH_ID_FIELD = "graph_id";
   static constexpr const char* JSON_WORKERS_FIELD = "elements";
   static constexpr const char* JSON_CONNECTIONS_FIELD = "connections";
+  static constexpr const char* JSON_SCHEDULER_FIELD = "scheduler";
+  static constexpr const char* JSON_POOL_THREAD_NUMBER_FIELD =
+      "pool_thread_number";
+  static constexpr const char* JSON_TRACE_FIELD = "trace";
+  static constexpr const char* JSON_TRACE_SAMPLE_INTERVAL_FIELD =
+      "trace_sample_interval";
+  static constexpr const char* JSON_TRACE_FILE_FIELD = "trace_file";
   static constexpr const char* JSON_MODEL_SHARED_OBJECT_FIELD = "shared_object";
   static constexpr const char* JSON_WORKER_NAME_FIELD = "name";
   static constexpr const char* JSON_CONNECTION_SRC_ID_FIELD = "src_id";
   static constexpr const char* JSON_CONNECTION_SRC_PORT_FIELD = "src_port";
   static constexpr const char* JSON_CONNECTION_DST_ID_FIELD = "dst_id";
   static constexpr const char* JSON_CONNECTION_DST_PORT_FIELD = "dst_port";
+  static constexpr const char* JSON_CONNECTION_QUEUE_TYPE_FIELD = "queue_type";
+  static constexpr const char* JSON_CONNECTION_CAPACITY_FIELD = "capacity";
+  static constexpr const char* JSON_CONNECTION_OVERFLOW_POLICY_FIELD =
+      "overflow_policy";
 
  private:
   common::ErrorCode initElements(const std::string& json);
   common::ErrorCode initConnections(const std::string& json);
-  common::ErrorCode connect(int srcId, int srcPort, int dstId, int dstPort);
+  common::ErrorCode connect(
+      int srcId, int srcPort, int dstId, int dstPort,
+      const DataPipeConfig& dataPipeConfig = DataPipeConfig());
+
+  struct ConnectionConfig {
+    int srcId;
+    int srcPort;
+    int dstId;
+    int dstPort;
+    DataPipeConfig dataPipeConfig;
+  };
+
+  /**
+   * @brief 为配置了无锁队列的connection选择SPSC或MPSC
+   * @brief 只有目标port唯一的上游是单线程、且非source的element时才能使用SPSC
+   * @brief 配置了丢弃策略的connection只能使用MUTEX队列
+   */
+  void resolveDataPipeTypes(std::vector<ConnectionConfig>& connections);
+
+  /**
+   * @brief 注册http接口，查询graph中所有dataPipe的配置、当前长度和丢弃数量
+   * @brief GET /graph/dataPipeStatus/{graphId}
+   * @brief 开启trace时还会注册 GET /graph/traceLatency/{graphId} 和 GET /graph/chromeTrace/{graphId}
+   */
+  void registListenFunc(ListenThread* listener);
+
+  void listenerGetDataPipeStatus(const httplib::Request& request,
+                                 httplib::Response& response);
+
+  /**
+   * @brief 返回当前graph各码流端到端耗时的p50/p99
+   */
+  void listenerGetTraceLatency(const httplib::Request& request,
+                               httplib::Response& response);
+
+  /**
+   * @brief 返回当前graph采样帧的chrome trace
+   */
+  void listenerGetChromeTrace(const httplib::Request& request,
+                              httplib::Response& response);
 
   int mId;
 
   std::atomic<ThreadStatus> mThreadStatus;
 
+  SchedulerType mSchedulerType = SchedulerType::THREAD;
+  int mPoolThreadNumber = 0;
+  std::shared_ptr<WorkerPool> mWorkerPool;
+
+  /**
+   * @brief 是否为经过的每一帧记录各element的耗时
+   */
+  bool mTraceEnabled = false;
+  /**
+   * @brief 每隔多少帧采样一帧保存完整记录，0表示不采样
+   */
+  int mTraceSampleInterval = 0;
+  /**
+   * @brief 非空时stop()后将采样帧的chrome trace写入该文件
+   */
+  std::string mTraceFile;
+
   std::vector<std::shared_ptr<void> > mSharedObjectHandles;
 
   std::map<int /* elementId */, std::shared_ptr<framework::Element> >
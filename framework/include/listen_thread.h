@@ -10,13 +10,21 @@
 #ifndef SOPHON_STREAM_FRAMEWORK_LISTEN_THREAD_H_
 #define SOPHON_STREAM_FRAMEWORK_LISTEN_THREAD_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
 
+#include "common/binary_serialize.h"
 #include "common/error_code.h"
 #include "common/http_defs.h"
 #include "common/profiler.h"
+#include "common/spill_queue.h"
 #include "httplib.h"
 #include "nlohmann/json.hpp"
 namespace sophon_stream {
@@ -27,25 +35,77 @@ struct http_config {
   std::string ip = "0.0.0.0";
   int port = 8000;
   std::string path = "/task/test";
+  common::SerializeFormat format = common::SerializeFormat::JSON;
+  /**
+   * @brief 仅用于上报，磁盘暂存目录，为空时不启用
+   */
+  std::string spill_dir;
+  int spill_max_mb = 64;
+  /**
+   * @brief 从磁盘重放的速率上限，条/秒，为0时不限速
+   */
+  int spill_replay_rate = 50;
 };
+/**
+ * @brief 上报线程
+ * @details
+ * 请求失败后按指数退避重试。配置spill_dir后，内存队列已满或上报端不可用时，
+ * 请求写入磁盘队列（common::SpillQueue），上报端恢复后按顺序限速重放，
+ * 进程重启后从上次确认的位置继续；未配置时重试maxRetryTimes次后丢弃。
+ * 状态请求只保留在内存中，不写入磁盘，失败时重试maxRetryTimes次后丢弃。
+ */
 class ReportImpl_ {
  public:
-  ReportImpl_(std::string& ip, int port, std::string path, int channel);
-  bool pushQueue(std::shared_ptr<nlohmann::json> j);
+  explicit ReportImpl_(const http_config& config);
+  /**
+   * @brief 加入一条已序列化的请求，contentType为JSON_CONTENT_TYPE或BINARY_CONTENT_TYPE
+   * @param persistent 为false时不写入磁盘队列，内存队列已满时直接丢弃，用于状态请求
+   */
+  bool pushQueue(std::string body, const char* contentType,
+                 bool persistent = true);
   void release();
+  /**
+   * @brief 磁盘队列是否可用
+   */
+  bool isSpillEnabled() const { return spill != nullptr; }
 
  private:
-  std::queue<std::shared_ptr<nlohmann::json>> objQueue;
+  struct ReportPayload {
+    std::string body;
+    const char* contentType;
+    bool persistent;
+  };
+
+  std::deque<ReportPayload> objQueue;
   std::thread workThread;
   void postFunc();
-  bool isRunning = true;
-  std::shared_ptr<nlohmann::json> popQueue();
-  size_t getQueueSize();
+  /**
+   * @brief 发送一次请求，不重试
+   */
+  bool post(const ReportPayload& payload);
+  /**
+   * @brief 等待ms毫秒，停止时立即返回
+   */
+  void waitFor(int ms);
+  bool hasSpill();
+  /**
+   * @brief 依次把payload和内存队列中的请求写入磁盘队列，调用时持有mtx，
+   * 非persistent的请求直接丢弃
+   */
+  void spillLocked(const ReportPayload* payload);
+  std::atomic<bool> isRunning{true};
   std::mutex mtx;
+  std::condition_variable cond;
   constexpr static int maxQueueLen = 20;
+  constexpr static int maxRetryTimes = 5;
+  constexpr static int retryIntervalMs = 100;
+  constexpr static int maxBackoffMs = 10000;
 
   httplib::Client cli;
   std::string path;
+  std::unique_ptr<common::SpillQueue> spill;
+  std::vector<common::SpillRecord> records;
+  int replayRate = 0;
 };
 class ListenThread {
  public:
@@ -62,10 +122,19 @@ class ListenThread {
 
   bool pushQueue(std::shared_ptr<nlohmann::json> j);
 
+  /**
+   * @brief 上报状态，同一错误码在statusReportIntervalMs内只上报一次
+   */
   void report_status(common::ErrorCode errorcode);
   static constexpr const char* JSON_IP_FILED = "ip";
   static constexpr const char* JSON_PORT_FILED = "port";
   static constexpr const char* JSON_PATH_FILED = "path";
+  static constexpr const char* JSON_FORMAT_FILED = "format";
+  static constexpr const char* JSON_SPILL_DIR_FILED = "spill_dir";
+  static constexpr const char* JSON_SPILL_MAX_MB_FILED = "spill_max_mb";
+  static constexpr const char* JSON_SPILL_REPLAY_RATE_FILED =
+      "spill_replay_rate";
+  static constexpr const char* METRICS_PATH = "/metrics";
 
  private:
   httplib::Server server;
@@ -75,12 +144,24 @@ class ListenThread {
   std::thread listen_thread_;
   bool isRunning = true;
   bool if_report_ = false;
+  /**
+   * @brief 队列已满时element每次等待超时都会调用report_status，按错误码限频
+   */
+  constexpr static int statusReportIntervalMs = 5000;
+  std::mutex status_mtx_;
+  std::map<common::ErrorCode, std::chrono::steady_clock::time_point>
+      last_status_report_;
   //   std::queue<httplib::Request*> send_queue_;
 
   nlohmann::json handle_task_test(const std::string& json);
 
   static void handle_task_interact(const httplib::Request& request,
                                    httplib::Response& reponse);
+  /**
+   * @brief GET /metrics，以Prometheus文本格式返回MetricsRegistry中的所有指标
+   */
+  static void handle_metrics(const httplib::Request& request,
+                             httplib::Response& response);
   static void listen_loop();
 };
 
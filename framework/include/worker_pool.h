@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SOPHON_STREAM_FRAMEWORK_WORKER_POOL_H_
+#define SOPHON_STREAM_FRAMEWORK_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/no_copyable.h"
+
+namespace sophon_stream {
+namespace framework {
+
+/**
+ * @brief element的调度方式
+ * @brief THREAD: 每个dataPipe独占一个线程，线程内循环调用doWork
+ * @brief POOL: 所有element共享engine的WorkerPool，dataPipe有数据时才调度doWork
+ */
+enum class SchedulerType {
+  THREAD,
+  POOL,
+};
+
+/**
+ * @brief 解析graph配置中的scheduler字段
+ * @param[in] name : "thread"或"pool"
+ * @return 名称合法返回true
+ */
+bool schedulerTypeFromString(const std::string& name, SchedulerType& type);
+
+const char* schedulerTypeToString(SchedulerType type);
+
+/**
+ * @brief 带任务窃取的线程池
+ * @brief 每个worker有自己的任务队列，worker线程内提交的任务放入自己的队列，
+ * 其他线程提交的任务放入全局队列；worker空闲时先取自己的队列，再取全局队列，
+ * 最后从其他worker的队列中窃取
+ * @brief 同时执行任务的worker数量不超过threadNumber。任务在BlockingScope中阻塞时让出名额，
+ * 由备用worker接替执行其他任务，避免所有worker都阻塞在已满的队列上
+ */
+class WorkerPool : public ::sophon_stream::common::NoCopyable {
+ public:
+  using Task = std::function<void()>;
+
+  /**
+   * @param[in] threadNumber : 同时执行任务的worker数量
+   * @param[in] maxThreadNumber : worker线程总数，多出的线程用于在任务阻塞时接替执行
+   */
+  WorkerPool(int threadNumber, int maxThreadNumber);
+
+  ~WorkerPool();
+
+  void start();
+
+  /**
+   * @brief 停止所有worker，未执行的任务被丢弃
+   */
+  void stop();
+
+  void submit(Task task);
+
+  int getThreadNumber() const { return mThreadNumber; }
+
+  /**
+   * @brief 当前线程所属的WorkerPool，非worker线程返回nullptr
+   */
+  static WorkerPool* current();
+
+  /**
+   * @brief 标记worker即将阻塞等待，作用域内该worker不占用执行名额
+   * @brief 在非worker线程中构造时不做任何事
+   */
+  class BlockingScope : public ::sophon_stream::common::NoCopyable {
+   public:
+    BlockingScope();
+    ~BlockingScope();
+
+   private:
+    WorkerPool* mPool;
+  };
+
+ private:
+  struct Worker {
+    std::deque<Task> tasks;
+    std::mutex mutex;
+    std::thread thread;
+  };
+
+  void run(int workerId);
+
+  /**
+   * @brief 依次从自己的队列、全局队列、其他worker的队列中取任务
+   */
+  bool popTask(int workerId, Task& task);
+
+  void enterBlocking();
+  void leaveBlocking();
+
+  const int mThreadNumber;
+
+  std::vector<std::unique_ptr<Worker> > mWorkers;
+
+  std::deque<Task> mGlobalTasks;
+  std::mutex mGlobalTasksMutex;
+
+  /**
+   * @brief 尚未被取走的任务数量
+   */
+  std::atomic<int> mPendingTasks{0};
+  /**
+   * @brief 正在执行任务且未处于BlockingScope中的worker数量
+   */
+  std::atomic<int> mActiveWorkers{0};
+
+  std::mutex mParkMutex;
+  std::condition_variable mParkCond;
+
+  std::atomic<bool> mRunning{false};
+};
+
+}  // namespace framework
+}  // namespace sophon_stream
+
+#endif  // SOPHON_STREAM_FRAMEWORK_WORKER_POOL_H_
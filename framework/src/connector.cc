@@ -12,24 +12,56 @@
 namespace sophon_stream {
 namespace framework {
 
-Connector::Connector(int dataPipeCount) {
+Connector::Connector(int dataPipeCount, const DataPipeConfig& config) {
   mCapacity = dataPipeCount;
   mDataPipes.reserve(mCapacity);
   for (int i = 0; i < mCapacity; ++i) {
-    auto datapipe = std::make_shared<DataPipe>();
+    auto datapipe = std::make_shared<DataPipe>(config);
     mDataPipes.push_back(datapipe);
   }
+  mConfig = mCapacity > 0 ? mDataPipes[0]->getConfig() : config;
 }
 
 std::shared_ptr<void> Connector::popData(int id) {
   return getDataPipe(id)->popData();
 }
 
+std::shared_ptr<void> Connector::popData(int id,
+                                         std::chrono::microseconds timeout) {
+  return getDataPipe(id)->popData(timeout);
+}
+
 common::ErrorCode Connector::pushData(
     int id, std::shared_ptr<void> data) {
   return getDataPipe(id)->pushData(data);
 }
 
+common::ErrorCode Connector::pushData(int id, std::shared_ptr<void> data,
+                                      std::chrono::milliseconds timeout) {
+  return getDataPipe(id)->pushData(data, timeout);
+}
+
+void Connector::wakeup() {
+  for (auto& dataPipe : mDataPipes) {
+    dataPipe->wakeup();
+  }
+}
+
+void Connector::setDataInfoGetter(DataPipe::DataInfoGetter getter) {
+  for (auto& dataPipe : mDataPipes) {
+    dataPipe->setDataInfoGetter(getter);
+  }
+}
+
+void Connector::setPushHandler(std::function<void(int)> handler) {
+  for (int i = 0; i < mCapacity; ++i) {
+    if (handler) {
+      mDataPipes[i]->setPushHandler(std::bind(handler, i));
+    } else {
+      mDataPipes[i]->setPushHandler(nullptr);
+    }
+  }
+}
 
 int Connector::getCapacity() const { return mCapacity; }
 
@@ -12,37 +12,285 @@
 namespace sophon_stream {
 namespace framework {
 
-#define DEFAULT_DATA_PIPE_CAPACITY 20
+bool dataPipeTypeFromString(const std::string& name, DataPipeType& type) {
+  if (name == "mutex") {
+    type = DataPipeType::MUTEX;
+  } else if (name == "spsc") {
+    type = DataPipeType::SPSC;
+  } else if (name == "mpsc" || name == "lockfree") {
+    type = DataPipeType::MPSC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* dataPipeTypeToString(DataPipeType type) {
+  switch (type) {
+    case DataPipeType::SPSC:
+      return "spsc";
+    case DataPipeType::MPSC:
+      return "mpsc";
+    default:
+      return "mutex";
+  }
+}
+
+bool overflowPolicyFromString(const std::string& name, OverflowPolicy& policy) {
+  if (name == "block") {
+    policy = OverflowPolicy::BLOCK;
+  } else if (name == "drop_oldest") {
+    policy = OverflowPolicy::DROP_OLDEST;
+  } else if (name == "drop_newest") {
+    policy = OverflowPolicy::DROP_NEWEST;
+  } else if (name == "keep_latest_per_channel") {
+    policy = OverflowPolicy::KEEP_LATEST_PER_CHANNEL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* overflowPolicyToString(OverflowPolicy policy) {
+  switch (policy) {
+    case OverflowPolicy::DROP_OLDEST:
+      return "drop_oldest";
+    case OverflowPolicy::DROP_NEWEST:
+      return "drop_newest";
+    case OverflowPolicy::KEEP_LATEST_PER_CHANNEL:
+      return "keep_latest_per_channel";
+    default:
+      return "block";
+  }
+}
 
-DataPipe::DataPipe() : mCapacity(DEFAULT_DATA_PIPE_CAPACITY) {}
+DataPipe::DataPipe(const DataPipeConfig& config)
+    : mConfig(config),
+      mType(config.type),
+      mWaitTimeHistogram(std::make_shared<common::LatencyHistogram>()),
+      mCapacity(config.capacity > 0 ? config.capacity
+                                    : DEFAULT_DATA_PIPE_CAPACITY) {
+  mConfig.capacity = mCapacity;
+  if (DataPipeType::MUTEX != mType &&
+      OverflowPolicy::BLOCK != mConfig.overflowPolicy) {
+    // 无锁队列无法从中间或队首由生产者删除数据
+    IVS_WARN("Overflow policy {0} is not supported by {1} data pipe, use block",
+             overflowPolicyToString(mConfig.overflowPolicy),
+             dataPipeTypeToString(mType));
+    mConfig.overflowPolicy = OverflowPolicy::BLOCK;
+  }
+  if (DataPipeType::SPSC == mType) {
+    mSpscQueue =
+        std::make_unique<common::SpscRingBuffer<QueueItem> >(mCapacity);
+  } else if (DataPipeType::MPSC == mType) {
+    mMpscQueue =
+        std::make_unique<common::MpscRingBuffer<QueueItem> >(mCapacity);
+  }
+}
 
 DataPipe::~DataPipe() {}
 
+void DataPipe::setDataInfoGetter(DataInfoGetter getter) {
+  std::lock_guard<std::mutex> lock(mDataQueueMutex);
+  mDataInfoGetter = getter;
+}
+
+bool DataPipe::dropForOverflowLocked(QueueItem& item) {
+  auto getInfo = [this](const std::shared_ptr<void>& item) {
+    return mDataInfoGetter ? mDataInfoGetter(item) : DataInfo();
+  };
+
+  switch (mConfig.overflowPolicy) {
+    case OverflowPolicy::DROP_NEWEST: {
+      if (!getInfo(item.data).droppable) return false;
+      item.data.reset();
+      break;
+    }
+    case OverflowPolicy::DROP_OLDEST: {
+      auto it = mDataQueue.begin();
+      while (it != mDataQueue.end() && !getInfo(it->data).droppable) ++it;
+      if (it == mDataQueue.end()) return false;
+      mDataQueue.erase(it);
+      break;
+    }
+    case OverflowPolicy::KEEP_LATEST_PER_CHANNEL: {
+      int channel = getInfo(item.data).channel;
+      auto oldest = mDataQueue.end();
+      auto it = mDataQueue.begin();
+      for (; it != mDataQueue.end(); ++it) {
+        DataInfo info = getInfo(it->data);
+        if (!info.droppable) continue;
+        if (info.channel == channel) break;
+        if (oldest == mDataQueue.end()) oldest = it;
+      }
+      if (it == mDataQueue.end()) it = oldest;
+      if (it == mDataQueue.end()) return false;
+      mDataQueue.erase(it);
+      break;
+    }
+    default:
+      return false;
+  }
+  mDropCount.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool DataPipe::tryPush(QueueItem& item) {
+  // 每次尝试都重新取时间，生产者阻塞的时间不计入队列等待时间
+  item.pushTime = std::chrono::steady_clock::now();
+  switch (mType) {
+    case DataPipeType::SPSC:
+      return mSpscQueue->push(item);
+    case DataPipeType::MPSC:
+      return mMpscQueue->push(item);
+    default: {
+      std::lock_guard<std::mutex> lock(mDataQueueMutex);
+      if (mDataQueue.size() >= mCapacity) {
+        if (!dropForOverflowLocked(item)) return false;
+        // DROP_NEWEST丢弃的是新数据本身，无需入队
+        if (!item.data) return true;
+      }
+      mDataQueue.push_back(std::move(item));
+      return true;
+    }
+  }
+}
+
+bool DataPipe::tryPop(std::shared_ptr<void>& data) {
+  QueueItem item;
+  bool popped = false;
+  switch (mType) {
+    case DataPipeType::SPSC:
+      popped = mSpscQueue->pop(item);
+      break;
+    case DataPipeType::MPSC:
+      popped = mMpscQueue->pop(item);
+      break;
+    default: {
+      std::lock_guard<std::mutex> lock(mDataQueueMutex);
+      if (mDataQueue.empty()) return false;
+      item = std::move(mDataQueue.front());
+      mDataQueue.pop_front();
+      popped = true;
+      break;
+    }
+  }
+  if (!popped) return false;
+  mWaitTimeHistogram->observe(std::chrono::steady_clock::now() - item.pushTime);
+  data = std::move(item.data);
+  return true;
+}
+
+void DataPipe::notifyNotEmpty() {
+  // 与popData(timeout)中登记等待者、再次检查队列的顺序配对，
+  // 保证不会漏掉唤醒；没有等待者时不触碰mWaitMutex
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mWaitingConsumers.load(std::memory_order_relaxed) > 0) {
+    { std::lock_guard<std::mutex> lock(mWaitMutex); }
+    mNotEmptyCond.notify_one();
+  }
+}
+
+void DataPipe::notifyNotFull() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mWaitingProducers.load(std::memory_order_relaxed) > 0) {
+    { std::lock_guard<std::mutex> lock(mWaitMutex); }
+    mNotFullCond.notify_one();
+  }
+}
+
 common::ErrorCode DataPipe::pushData(std::shared_ptr<void> data) {
-  std::unique_lock<std::mutex> lock(mDataQueueMutex);
-  if(mDataQueue.size() < mCapacity) {
-    mDataQueue.push_back(data);
+  QueueItem item{std::move(data)};
+  if (!tryPush(item)) {
+    return common::ErrorCode::DATA_PIPE_FULL;
+  }
+  notifyNotEmpty();
+  if (mPushHandler) mPushHandler();
+  return common::ErrorCode::SUCCESS;
+}
+
+common::ErrorCode DataPipe::pushData(std::shared_ptr<void> data,
+                                     std::chrono::milliseconds timeout) {
+  QueueItem item{std::move(data)};
+  if (tryPush(item)) {
+    notifyNotEmpty();
+    if (mPushHandler) mPushHandler();
     return common::ErrorCode::SUCCESS;
   }
-  return common::ErrorCode::DATA_PIPE_FULL;
+
+  bool pushed = false;
+  {
+    std::unique_lock<std::mutex> lock(mWaitMutex);
+    std::size_t wakeupSeq = mWakeupSeq;
+    mWaitingProducers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    mNotFullCond.wait_for(lock, timeout, [&] {
+      pushed = tryPush(item);
+      return pushed || mWakeupSeq != wakeupSeq;
+    });
+    mWaitingProducers.fetch_sub(1);
+  }
+  if (!pushed) {
+    return common::ErrorCode::DATA_PIPE_FULL;
+  }
+  notifyNotEmpty();
+  if (mPushHandler) mPushHandler();
+  return common::ErrorCode::SUCCESS;
 }
 
-std::shared_ptr<void> DataPipe::popData()
-{
-  std::lock_guard<std::mutex> lock(mDataQueueMutex);
+std::shared_ptr<void> DataPipe::popData() {
   std::shared_ptr<void> data = nullptr;
-  if(!mDataQueue.empty())
+  if (tryPop(data)) {
+    notifyNotFull();
+  }
+  return data;
+}
+
+std::shared_ptr<void> DataPipe::popData(std::chrono::microseconds timeout) {
+  std::shared_ptr<void> data = nullptr;
+  if (tryPop(data)) {
+    notifyNotFull();
+    return data;
+  }
+
+  bool popped = false;
   {
-   data = mDataQueue.front();
-   mDataQueue.pop_front(); 
+    std::unique_lock<std::mutex> lock(mWaitMutex);
+    std::size_t wakeupSeq = mWakeupSeq;
+    mWaitingConsumers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    mNotEmptyCond.wait_for(lock, timeout, [&] {
+      popped = tryPop(data);
+      return popped || mWakeupSeq != wakeupSeq;
+    });
+    mWaitingConsumers.fetch_sub(1);
+  }
+  if (popped) {
+    notifyNotFull();
   }
   return data;
 }
 
+void DataPipe::wakeup() {
+  {
+    std::lock_guard<std::mutex> lock(mWaitMutex);
+    ++mWakeupSeq;
+  }
+  mNotEmptyCond.notify_all();
+  mNotFullCond.notify_all();
+}
+
 int DataPipe::getSize() {
-  std::lock_guard<std::mutex> lock(mDataQueueMutex);
-  int sz = mDataQueue.size();
-  return sz;
+  switch (mType) {
+    case DataPipeType::SPSC:
+      return mSpscQueue->size();
+    case DataPipeType::MPSC:
+      return mMpscQueue->size();
+    default: {
+      std::lock_guard<std::mutex> lock(mDataQueueMutex);
+      return mDataQueue.size();
+    }
+  }
 }
 
 }  // namespace framework
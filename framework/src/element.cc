@@ -1,18 +1,60 @@
 #include "element.h"
 
+#include <algorithm>
+
+#include "common/object_metadata.h"
+
 namespace sophon_stream {
 namespace framework {
 
+namespace {
+/**
+ * @brief 当前线程正在执行的doWork第一次取到数据的时间，未取到数据时为默认值
+ */
+thread_local std::chrono::steady_clock::time_point tlsWorkBeginTime;
+
+void markWorkBegin() {
+  if (std::chrono::steady_clock::time_point() == tlsWorkBeginTime) {
+    tlsWorkBeginTime = std::chrono::steady_clock::now();
+  }
+}
+}  // namespace
+
 void Element::connect(Element& srcElement, int srcElementPort,
-                      Element& dstElement, int dstElementPort) {
+                      Element& dstElement, int dstElementPort,
+                      const DataPipeConfig& dataPipeConfig) {
   auto& inputConnector = dstElement.mInputConnectorMap[dstElementPort];
   if (!inputConnector) {
-    inputConnector =
-        std::make_shared<framework::Connector>(dstElement.getThreadNumber());
+    inputConnector = std::make_shared<framework::Connector>(
+        dstElement.getThreadNumber(), dataPipeConfig);
+    if (OverflowPolicy::BLOCK != dataPipeConfig.overflowPolicy) {
+      // element之间传递的都是ObjectMetadata，码流结束帧不允许丢弃
+      inputConnector->setDataInfoGetter(
+          [](const std::shared_ptr<void>& data) {
+            DataPipe::DataInfo info;
+            auto objectMetadata =
+                std::static_pointer_cast<common::ObjectMetadata>(data);
+            if (objectMetadata && objectMetadata->mFrame) {
+              info.channel = objectMetadata->mFrame->mChannelIdInternal;
+              info.droppable = !objectMetadata->mFrame->mEndOfStream;
+            }
+            return info;
+          });
+    }
     IVS_DEBUG(
         "InputConnector initialized, mId = {0}, inputPort = {1}, dataPipeNum = "
-        "{2}",
-        dstElement.getId(), dstElementPort, dstElement.getThreadNumber());
+        "{2}, dataPipeType = {3}, capacity = {4}, overflowPolicy = {5}",
+        dstElement.getId(), dstElementPort, dstElement.getThreadNumber(),
+        dataPipeTypeToString(dataPipeConfig.type), dataPipeConfig.capacity,
+        overflowPolicyToString(dataPipeConfig.overflowPolicy));
+  } else if (inputConnector->getConfig() != dataPipeConfig) {
+    const DataPipeConfig& config = inputConnector->getConfig();
+    IVS_WARN(
+        "InputConnector already initialized with dataPipeType {0}, capacity "
+        "{1}, overflowPolicy {2}, ignore new config. mId = {3}, inputPort = {4}",
+        dataPipeTypeToString(config.type), config.capacity,
+        overflowPolicyToString(config.overflowPolicy), dstElement.getId(),
+        dstElementPort);
   }
   dstElement.addInputPort(dstElementPort);
   srcElement.addOutputPort(srcElementPort);
@@ -20,7 +62,9 @@ void Element::connect(Element& srcElement, int srcElementPort,
 }
 
 Element::Element()
-    : mId(-1),
+    : mWorkTimeHistogram(std::make_shared<common::LatencyHistogram>()),
+      mId(-1),
+      mGraphId(-1),
       mDeviceId(-1),
       mThreadNumber(1),
       mThreadStatus(ThreadStatus::STOP) {}
@@ -110,6 +154,36 @@ common::ErrorCode Element::start() {
 
   mThreadStatus = ThreadStatus::RUN;
 
+  // group element的输入与内部element共享，指标由内部element统计
+  if (!getGroup()) {
+    registerMetrics();
+    if (mTraceEnabled) {
+      common::FrameTraceCollector::getInstance().setElementName(mGraphId, mId,
+                                                                mName);
+    }
+  }
+
+  if (mWorkerPool) {
+    // group element的输入connector与内部preElement共享，由preElement调度
+    if (!getGroup()) {
+      onStart();
+      if (!mPoolTaskStates) {
+        mPoolTaskStates.reset(new PoolTaskState[mThreadNumber]);
+      }
+      for (auto& inputConnectorPair : mInputConnectorMap) {
+        if (!inputConnectorPair.second) continue;
+        inputConnectorPair.second->setPushHandler(
+            std::bind(&Element::schedulePoolTask, this, std::placeholders::_1));
+      }
+      // start之前已入队的数据
+      for (int i = 0; i < mThreadNumber; ++i) {
+        schedulePoolTask(i);
+      }
+    }
+    IVS_INFO("Start element finish, element id: {0:d}, scheduler: pool", mId);
+    return common::ErrorCode::SUCCESS;
+  }
+
   mThreads.reserve(mThreadNumber);
   for (int i = 0; i < mThreadNumber; ++i) {
     mThreads.push_back(
@@ -130,11 +204,24 @@ common::ErrorCode Element::stop() {
 
   mThreadStatus = ThreadStatus::STOP;
 
+  // 唤醒阻塞在输入队列上的线程，使其尽快退出
+  for (auto& inputConnectorPair : mInputConnectorMap) {
+    if (inputConnectorPair.second) inputConnectorPair.second->wakeup();
+  }
+
   for (auto thread : mThreads) {
     thread->join();
   }
   mThreads.clear();
 
+  if (mWorkerPool && mPoolTaskStates) {
+    // 已提交的任务看到STOP后会直接返回；上游仍可能push数据，push回调保持不变
+    while (mPoolTaskCount.load() > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    onStop();
+  }
+
   IVS_INFO("Stop element thread finish, element id: {0:d}", mId);
   return common::ErrorCode::SUCCESS;
 }
@@ -163,6 +250,12 @@ common::ErrorCode Element::resume() {
 
   mThreadStatus = ThreadStatus::RUN;
 
+  if (mWorkerPool && mPoolTaskStates) {
+    for (int i = 0; i < mThreadNumber; ++i) {
+      schedulePoolTask(i);
+    }
+  }
+
   IVS_INFO("Resume element thread finish, element id: {0:d}", mId);
   return common::ErrorCode::SUCCESS;
 }
@@ -174,12 +267,189 @@ void Element::run(int dataPipeId) {
   // mId,
   //              dataPipeId, gettid());
   while (ThreadStatus::RUN == mThreadStatus) {
-    doWork(dataPipeId);
+    doWorkWithMetrics(dataPipeId);
     std::this_thread::yield();
   }
   onStop();
 }
 
+void Element::schedulePoolTask(int dataPipeId) {
+  // 先计数再检查状态，保证stop()返回后不会再有任务访问当前element
+  mPoolTaskCount.fetch_add(1);
+  auto& state = mPoolTaskStates[dataPipeId];
+  state.notified.store(true);
+  if (ThreadStatus::RUN != mThreadStatus || state.scheduled.exchange(true)) {
+    mPoolTaskCount.fetch_sub(1);
+    return;
+  }
+  mWorkerPool->submit(std::bind(&Element::runPoolTask, this, dataPipeId));
+}
+
+void Element::runPoolTask(int dataPipeId) {
+  auto& state = mPoolTaskStates[dataPipeId];
+  // 有新数据到达，或者上一轮取到了数据且队列中仍有数据时继续处理
+  auto hasMoreWork = [&](std::uint64_t popCount) {
+    return state.notified.load() ||
+           (state.popCount.load() != popCount && hasAnyInputData(dataPipeId));
+  };
+
+  bool moreWork = false;
+  for (int round = 0;
+       round < POOL_TASK_MAX_ROUNDS && ThreadStatus::RUN == mThreadStatus;
+       ++round) {
+    state.notified.store(false);
+    // 上一轮已经把数据取完，不必调用doWork
+    if (!hasAnyInputData(dataPipeId)) {
+      moreWork = false;
+      break;
+    }
+    std::uint64_t popCount = state.popCount.load();
+    doWorkWithMetrics(dataPipeId);
+    moreWork = hasMoreWork(popCount);
+    if (!moreWork) break;
+  }
+
+  state.scheduled.store(false);
+  if (moreWork || state.notified.load()) {
+    schedulePoolTask(dataPipeId);
+  }
+  mPoolTaskCount.fetch_sub(1);
+}
+
+void Element::doWorkWithMetrics(int dataPipeId) {
+  tlsWorkBeginTime = std::chrono::steady_clock::time_point();
+  doWork(dataPipeId);
+  if (std::chrono::steady_clock::time_point() != tlsWorkBeginTime) {
+    mWorkTimeHistogram->observe(std::chrono::steady_clock::now() -
+                                tlsWorkBeginTime);
+    tlsWorkBeginTime = std::chrono::steady_clock::time_point();
+  }
+}
+
+common::MetricLabels Element::getMetricLabels() const {
+  return {{"graph_id", std::to_string(mGraphId)},
+          {"element_id", std::to_string(mId)},
+          {"element", mName}};
+}
+
+void Element::registerMetrics() {
+  auto& registry = common::MetricsRegistry::getInstance();
+  common::MetricLabels labels = getMetricLabels();
+
+  registry.addHistogram("sophon_stream_element_work_seconds",
+                        "Time spent in doWork from the first popped input "
+                        "until doWork returns.",
+                        labels, mWorkTimeHistogram);
+
+  for (int outputPort : mOutputPorts) {
+    auto& histogram = mPushBlockedTimeHistograms[outputPort];
+    if (!histogram) histogram = std::make_shared<common::LatencyHistogram>();
+    common::MetricLabels portLabels = labels;
+    portLabels.emplace_back("output_port", std::to_string(outputPort));
+    registry.addHistogram("sophon_stream_element_push_blocked_seconds",
+                          "Time pushOutputData waited because the downstream "
+                          "data pipe was full. Only blocked pushes are "
+                          "observed.",
+                          portLabels, histogram);
+  }
+
+  for (auto& inputConnectorPair : mInputConnectorMap) {
+    registerInputConnectorMetrics(inputConnectorPair.first);
+  }
+}
+
+void Element::registerInputConnectorMetrics(int inputPort) {
+  auto inputConnectorIt = mInputConnectorMap.find(inputPort);
+  if (mInputConnectorMap.end() == inputConnectorIt ||
+      !inputConnectorIt->second) {
+    return;
+  }
+  auto& registry = common::MetricsRegistry::getInstance();
+  auto connector = inputConnectorIt->second;
+  for (int i = 0; i < connector->getCapacity(); ++i) {
+    auto dataPipe = connector->getDataPipe(i);
+    common::MetricLabels labels = getMetricLabels();
+    labels.emplace_back("input_port", std::to_string(inputPort));
+    labels.emplace_back("data_pipe", std::to_string(i));
+
+    registry.addHistogram(
+        "sophon_stream_datapipe_wait_seconds",
+        "Time data stayed in the data pipe before being popped.", labels,
+        dataPipe->getWaitTimeHistogram());
+
+    // 抓取时dataPipe可能已随element析构，只持有弱引用
+    std::weak_ptr<DataPipe> weakDataPipe = dataPipe;
+    registry.addGauge("sophon_stream_datapipe_depth",
+                      "Number of data currently queued in the data pipe.",
+                      labels, [weakDataPipe](double& value) {
+                        auto dataPipe = weakDataPipe.lock();
+                        if (!dataPipe) return false;
+                        value = dataPipe->getSize();
+                        return true;
+                      });
+    registry.addGauge("sophon_stream_datapipe_capacity",
+                      "Capacity of the data pipe.", labels,
+                      [weakDataPipe](double& value) {
+                        auto dataPipe = weakDataPipe.lock();
+                        if (!dataPipe) return false;
+                        value = dataPipe->getConfig().capacity;
+                        return true;
+                      });
+    registry.addCounter("sophon_stream_datapipe_dropped_total",
+                        "Data dropped by the data pipe overflow policy.",
+                        labels, [weakDataPipe](double& value) {
+                          auto dataPipe = weakDataPipe.lock();
+                          if (!dataPipe) return false;
+                          value = dataPipe->getDropCount();
+                          return true;
+                        });
+  }
+}
+
+void Element::traceEnter(int inputPort, const std::shared_ptr<void>& data) {
+  if (std::find(mInputPorts.begin(), mInputPorts.end(), inputPort) ==
+      mInputPorts.end()) {
+    return;
+  }
+  auto objectMetadata = std::static_pointer_cast<common::ObjectMetadata>(data);
+  if (objectMetadata->mTrace) objectMetadata->mTrace->enter(mId);
+}
+
+void Element::traceExit(const std::shared_ptr<void>& data) {
+  auto objectMetadata = std::static_pointer_cast<common::ObjectMetadata>(data);
+  if (!objectMetadata) return;
+  if (!objectMetadata->mTrace) {
+    // 只有source element创建trace，中途新建的ObjectMetadata（如distributor的子任务）不记录
+    if (!mInputPorts.empty()) return;
+    std::int64_t frameId = objectMetadata->getFrameId();
+    bool sampled = mTraceSampleInterval > 0 && frameId >= 0 &&
+                   frameId % mTraceSampleInterval == 0;
+    objectMetadata->mTrace = std::make_shared<common::FrameTrace>(sampled);
+  }
+  objectMetadata->mTrace->exit(mId);
+  if (mSinkElementFlag && !objectMetadata->getEndofStream()) {
+    common::FrameTraceCollector::getInstance().onSink(
+        mGraphId, objectMetadata->getChannelId(), objectMetadata->getFrameId(),
+        objectMetadata->mTrace);
+  }
+}
+
+bool Element::hasInputData(int inputPort, int dataPipeId) {
+  auto inputConnectorIt = mInputConnectorMap.find(inputPort);
+  if (mInputConnectorMap.end() == inputConnectorIt ||
+      !inputConnectorIt->second) {
+    return false;
+  }
+  return inputConnectorIt->second->getDataPipe(dataPipeId)->getSize() > 0;
+}
+
+bool Element::hasAnyInputData(int dataPipeId) {
+  for (auto& inputConnectorPair : mInputConnectorMap) {
+    if (hasInputData(inputConnectorPair.first, dataPipeId)) return true;
+  }
+  return false;
+}
+
 common::ErrorCode Element::pushInputData(int inputPort, int dataPipeId,
                                          std::shared_ptr<void> data) {
   IVS_DEBUG("push data, element id: {0:d}, input port: {1:d}, data: {2:p}", mId,
@@ -188,16 +458,20 @@ common::ErrorCode Element::pushInputData(int inputPort, int dataPipeId,
   auto& inputConnector = mInputConnectorMap[inputPort];
   if (!inputConnector) {
     inputConnector = std::make_shared<framework::Connector>(mThreadNumber);
+    if (mWorkerPool && mPoolTaskStates) {
+      inputConnector->setPushHandler(
+          std::bind(&Element::schedulePoolTask, this, std::placeholders::_1));
+    }
     IVS_DEBUG(
         "InputConnector initialized, mId = {0}, inputPort = {1}, dataPipeNum = "
         "{2}",
         mId, inputPort, mThreadNumber);
+    registerInputConnectorMetrics(inputPort);
   }
-  while (mInputConnectorMap[inputPort]->pushData(dataPipeId, data) !=
+  while (inputConnector->pushData(dataPipeId, data, DATA_PIPE_WAIT_TIMEOUT) !=
          common::ErrorCode::SUCCESS) {
     listenThreadPtr->report_status(common::ErrorCode::DECODE_CHANNEL_PIPE_FULL);
-    IVS_DEBUG("Input DataPipe is full, now sleeping...");
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    IVS_DEBUG("Input DataPipe is full, now waiting...");
   }
   return common::ErrorCode::SUCCESS;
 }
@@ -206,7 +480,30 @@ std::shared_ptr<void> Element::popInputData(int inputPort, int dataPipeId) {
   if (mInputConnectorMap[inputPort] == nullptr)
     mInputConnectorMap[inputPort] =
         std::make_shared<framework::Connector>(mThreadNumber);
-  return mInputConnectorMap[inputPort]->popData(dataPipeId);
+  auto data = mInputConnectorMap[inputPort]->popData(dataPipeId);
+  if (data) {
+    markWorkBegin();
+    if (mPoolTaskStates) mPoolTaskStates[dataPipeId].popCount.fetch_add(1);
+    if (mTraceEnabled) traceEnter(inputPort, data);
+  }
+  return data;
+}
+
+std::shared_ptr<void> Element::popInputData(int inputPort, int dataPipeId,
+                                            std::chrono::microseconds timeout) {
+  // pool调度下不阻塞worker，队列再有数据时会重新调度
+  if (ThreadStatus::RUN != mThreadStatus || mWorkerPool) {
+    return popInputData(inputPort, dataPipeId);
+  }
+  if (mInputConnectorMap[inputPort] == nullptr)
+    mInputConnectorMap[inputPort] =
+        std::make_shared<framework::Connector>(mThreadNumber);
+  auto data = mInputConnectorMap[inputPort]->popData(dataPipeId, timeout);
+  if (data) {
+    markWorkBegin();
+    if (mTraceEnabled) traceEnter(inputPort, data);
+  }
+  return data;
 }
 
 void Element::setSinkHandler(int outputPort, SinkHandler dataHandler) {
@@ -219,6 +516,7 @@ common::ErrorCode Element::pushOutputData(int outputPort, int dataPipeId,
                                           std::shared_ptr<void> data) {
   IVS_DEBUG("send data, element id: {0:d}, output port: {1:d}, data:{2:p}", mId,
             outputPort, data.get());
+  if (mTraceEnabled) traceExit(data);
   if (mSinkElementFlag) {
     auto handlerIt = mSinkHandlerMap.find(outputPort);
     if (mSinkHandlerMap.end() != handlerIt) {
@@ -229,14 +527,29 @@ common::ErrorCode Element::pushOutputData(int outputPort, int dataPipeId,
       }
     }
   }
-  while (mOutputConnectorMap[outputPort].lock()->pushData(dataPipeId, data) !=
-         common::ErrorCode::SUCCESS) {
-    listenThreadPtr->report_status(common::ErrorCode::DATA_PIPE_FULL);
-    IVS_DEBUG(
-        "DataPipe is full, now sleeping. ElementID is {0}, outputPort is {1}, "
-        "dataPipeId is {2}",
-        mId, outputPort, dataPipeId);
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto outputConnector = mOutputConnectorMap[outputPort].lock();
+  if (outputConnector->pushData(dataPipeId, data) ==
+      common::ErrorCode::SUCCESS) {
+    return common::ErrorCode::SUCCESS;
+  }
+  auto blockedBegin = std::chrono::steady_clock::now();
+  {
+    // 在pool worker上阻塞时让出执行名额，由其他worker继续消费下游队列
+    WorkerPool::BlockingScope blockingScope;
+    while (outputConnector->pushData(dataPipeId, data,
+                                     DATA_PIPE_WAIT_TIMEOUT) !=
+           common::ErrorCode::SUCCESS) {
+      listenThreadPtr->report_status(common::ErrorCode::DATA_PIPE_FULL);
+      IVS_DEBUG(
+          "DataPipe is full, now waiting. ElementID is {0}, outputPort is {1}, "
+          "dataPipeId is {2}",
+          mId, outputPort, dataPipeId);
+    }
+  }
+  auto histogramIt = mPushBlockedTimeHistograms.find(outputPort);
+  if (mPushBlockedTimeHistograms.end() != histogramIt) {
+    histogramIt->second->observe(std::chrono::steady_clock::now() -
+                                 blockedBegin);
   }
   return common::ErrorCode::SUCCESS;
 
@@ -39,7 +39,9 @@ std::shared_ptr<framework::Element> ElementFactory::make(
     const std::string& elementName) {
   auto elementMakerIt = mElementMakerMap.find(elementName);
   if (mElementMakerMap.end() != elementMakerIt && elementMakerIt->second) {
-    return elementMakerIt->second();
+    auto element = elementMakerIt->second();
+    if (element) element->setName(elementName);
+    return element;
   } else {
     IVS_ERROR("Can not find element maker, name: {0}", elementName);
     return std::shared_ptr<framework::Element>();
@@ -3,6 +3,9 @@
 //#include "common/logger.h": 引入日志记录模块，提供日志记录的功能。
 #include "engine.h"
 
+#include <algorithm>
+#include <thread>
+
 #include "common/logger.h"
 //namespace sophon_stream::framework: 将代码置于 sophon_stream::framework 命名空间中，组织代码并避免命名冲突。
 namespace sophon_stream {
@@ -133,6 +136,28 @@ common::ErrorCode Engine::addGraph(const std::string& json) {
       return errorCode;
     }
 
+    if (SchedulerType::POOL == graph->getSchedulerType()) {
+      if (!mWorkerPool) {
+        int threadNumber = graph->getPoolThreadNumber();
+        if (threadNumber <= 0) {
+          threadNumber = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // 多出的worker只在任务阻塞于已满的队列时接替执行
+        mWorkerPool = std::make_shared<WorkerPool>(threadNumber,
+                                                   threadNumber * 2);
+        mWorkerPool->start();
+      } else if (graph->getPoolThreadNumber() > 0 &&
+                 graph->getPoolThreadNumber() !=
+                     mWorkerPool->getThreadNumber()) {
+        IVS_WARN(
+            "Worker pool already started with {0:d} threads, ignore "
+            "pool_thread_number {1:d}, graph id: {2:d}",
+            mWorkerPool->getThreadNumber(), graph->getPoolThreadNumber(),
+            graph->getId());
+      }
+      graph->setWorkerPool(mWorkerPool);
+    }
+
     errorCode = graph->start();
     listenThreadPtr->report_status(errorCode);
 
@@ -15,6 +15,7 @@
 #include <set>
 #include <string>
 
+#include "common/frame_trace.h"
 #include "common/logger.h"
 #include "element_factory.h"
 
@@ -54,6 +55,42 @@ common::ErrorCode Graph::init(const std::string& json) {
 
     mId = graphIdIt->get<int>();
 
+    auto schedulerIt = configure.find(JSON_SCHEDULER_FIELD);
+    if (configure.end() != schedulerIt) {
+      if (!schedulerIt->is_string() ||
+          !schedulerTypeFromString(schedulerIt->get<std::string>(),
+                                   mSchedulerType)) {
+        IVS_ERROR(
+            "{0} must be thread or pool in graph json configure, json: {1}",
+            JSON_SCHEDULER_FIELD, json);
+        errorCode = common::ErrorCode::PARSE_CONFIGURE_FAIL;
+        break;
+      }
+    }
+
+    auto poolThreadNumberIt = configure.find(JSON_POOL_THREAD_NUMBER_FIELD);
+    if (configure.end() != poolThreadNumberIt &&
+        poolThreadNumberIt->is_number_integer()) {
+      mPoolThreadNumber = poolThreadNumberIt->get<int>();
+    }
+
+    auto traceIt = configure.find(JSON_TRACE_FIELD);
+    if (configure.end() != traceIt && traceIt->is_boolean()) {
+      mTraceEnabled = traceIt->get<bool>();
+    }
+
+    auto traceSampleIntervalIt =
+        configure.find(JSON_TRACE_SAMPLE_INTERVAL_FIELD);
+    if (configure.end() != traceSampleIntervalIt &&
+        traceSampleIntervalIt->is_number_integer()) {
+      mTraceSampleInterval = traceSampleIntervalIt->get<int>();
+    }
+
+    auto traceFileIt = configure.find(JSON_TRACE_FILE_FIELD);
+    if (configure.end() != traceFileIt && traceFileIt->is_string()) {
+      mTraceFile = traceFileIt->get<std::string>();
+    }
+
     auto elementsIt = configure.find(JSON_WORKERS_FIELD);
     if (configure.end() != elementsIt) {
       errorCode = initElements(elementsIt->dump());
@@ -70,6 +107,10 @@ common::ErrorCode Graph::init(const std::string& json) {
       }
     }
 
+    if (listenThreadPtr) {
+      registListenFunc(listenThreadPtr);
+    }
+
   } while (false);
 
   if (common::ErrorCode::SUCCESS != errorCode) {
@@ -104,12 +145,21 @@ common::ErrorCode Graph::start() {
     return common::ErrorCode::THREAD_STATUS_ERROR;
   }
 
+  if (SchedulerType::POOL == mSchedulerType && !mWorkerPool) {
+    IVS_WARN("Worker pool is not set, use thread scheduler, graph id: {0:d}",
+             mId);
+  }
+
   for (auto pair : mElementMap) {
     auto element = pair.second;
     if (!element) {
       continue;
     }
 
+    if (SchedulerType::POOL == mSchedulerType) {
+      element->setWorkerPool(mWorkerPool);
+    }
+    element->setTrace(mTraceEnabled, mTraceSampleInterval);
     element->start();
   }
 
@@ -138,6 +188,16 @@ common::ErrorCode Graph::stop() {
 
   mThreadStatus = ThreadStatus::STOP;
 
+  if (mTraceEnabled && !mTraceFile.empty()) {
+    auto& collector = common::FrameTraceCollector::getInstance();
+    if (collector.dumpChromeTrace(mTraceFile)) {
+      IVS_INFO("Dump chrome trace to {0}, graph id: {1:d}", mTraceFile, mId);
+    } else {
+      IVS_WARN("Dump chrome trace to {0} fail, graph id: {1:d}", mTraceFile,
+               mId);
+    }
+  }
+
   IVS_INFO("Stop graph thread finish, graph id: {0:d}", mId);
   return common::ErrorCode::SUCCESS;
 }
@@ -308,6 +368,7 @@ common::ErrorCode Graph::initConnections(const std::string& json) {
       break;
     }
 
+    std::vector<ConnectionConfig> connections;
     for (auto connectionConfigure : connectionsConfigure) {
       if (!connectionConfigure.is_object()) {
         IVS_ERROR(
@@ -358,9 +419,68 @@ common::ErrorCode Graph::initConnections(const std::string& json) {
         dstElementPort = dstElementPortIt->get<int>();
       }
 
-      errorCode = connect(srcElementIdIt->get<int>(), srcElementPort,
-                          dstElementIdIt->get<int>(), dstElementPort);
+      DataPipeConfig dataPipeConfig;
+      auto queueTypeIt =
+          connectionConfigure.find(JSON_CONNECTION_QUEUE_TYPE_FIELD);
+      if (connectionConfigure.end() != queueTypeIt) {
+        if (!queueTypeIt->is_string() ||
+            !dataPipeTypeFromString(queueTypeIt->get<std::string>(),
+                                    dataPipeConfig.type)) {
+          IVS_ERROR(
+              "{0} must be one of mutex/lockfree/spsc/mpsc in connection json "
+              "configure, graph id: {1:d}, json: {2}",
+              JSON_CONNECTION_QUEUE_TYPE_FIELD, mId,
+              connectionConfigure.dump());
+          errorCode = common::ErrorCode::PARSE_CONFIGURE_FAIL;
+          break;
+        }
+      }
+
+      auto capacityIt =
+          connectionConfigure.find(JSON_CONNECTION_CAPACITY_FIELD);
+      if (connectionConfigure.end() != capacityIt) {
+        if (!capacityIt->is_number_integer() || capacityIt->get<int>() <= 0) {
+          IVS_ERROR(
+              "{0} must be a positive integer in connection json configure, "
+              "graph id: {1:d}, json: {2}",
+              JSON_CONNECTION_CAPACITY_FIELD, mId, connectionConfigure.dump());
+          errorCode = common::ErrorCode::PARSE_CONFIGURE_FAIL;
+          break;
+        }
+        dataPipeConfig.capacity = capacityIt->get<int>();
+      }
+
+      auto overflowPolicyIt =
+          connectionConfigure.find(JSON_CONNECTION_OVERFLOW_POLICY_FIELD);
+      if (connectionConfigure.end() != overflowPolicyIt) {
+        if (!overflowPolicyIt->is_string() ||
+            !overflowPolicyFromString(overflowPolicyIt->get<std::string>(),
+                                      dataPipeConfig.overflowPolicy)) {
+          IVS_ERROR(
+              "{0} must be one of block/drop_oldest/drop_newest/"
+              "keep_latest_per_channel in connection json configure, graph "
+              "id: {1:d}, json: {2}",
+              JSON_CONNECTION_OVERFLOW_POLICY_FIELD, mId,
+              connectionConfigure.dump());
+          errorCode = common::ErrorCode::PARSE_CONFIGURE_FAIL;
+          break;
+        }
+      }
+
+      connections.push_back({srcElementIdIt->get<int>(), srcElementPort,
+                             dstElementIdIt->get<int>(), dstElementPort,
+                             dataPipeConfig});
+    }
+    if (common::ErrorCode::SUCCESS != errorCode) {
+      break;
+    }
+
+    resolveDataPipeTypes(connections);
 
+    for (auto& connection : connections) {
+      errorCode = connect(connection.srcId, connection.srcPort,
+                          connection.dstId, connection.dstPort,
+                          connection.dataPipeConfig);
       if (common::ErrorCode::SUCCESS != errorCode) {
         break;
       }
@@ -375,8 +495,57 @@ common::ErrorCode Graph::initConnections(const std::string& json) {
   return errorCode;
 }
 
+void Graph::resolveDataPipeTypes(std::vector<ConnectionConfig>& connections) {
+  std::map<std::pair<int, int>, int> producerCounts;
+  std::set<int> dstIds;
+  for (auto& connection : connections) {
+    ++producerCounts[std::make_pair(connection.dstId, connection.dstPort)];
+    dstIds.insert(connection.dstId);
+  }
+
+  for (auto& connection : connections) {
+    DataPipeType& dataPipeType = connection.dataPipeConfig.type;
+    if (DataPipeType::MUTEX == dataPipeType) continue;
+
+    if (OverflowPolicy::BLOCK != connection.dataPipeConfig.overflowPolicy) {
+      IVS_WARN(
+          "Connection {0}:{1} -> {2}:{3} uses overflow policy {4}, which "
+          "needs a mutex queue, ignore queue_type {5}, graph id: {6:d}",
+          connection.srcId, connection.srcPort, connection.dstId,
+          connection.dstPort,
+          overflowPolicyToString(connection.dataPipeConfig.overflowPolicy),
+          dataPipeTypeToString(dataPipeType), mId);
+      dataPipeType = DataPipeType::MUTEX;
+      continue;
+    }
+
+    // source element(如decode)由内部的各路线程push数据，不满足单生产者
+    bool singleProducer =
+        producerCounts[std::make_pair(connection.dstId, connection.dstPort)] ==
+            1 &&
+        dstIds.count(connection.srcId) != 0;
+    auto srcElementIt = mElementMap.find(connection.srcId);
+    if (mElementMap.end() == srcElementIt || !srcElementIt->second ||
+        srcElementIt->second->getThreadNumber() != 1) {
+      singleProducer = false;
+    }
+
+    DataPipeType resolved =
+        singleProducer ? DataPipeType::SPSC : DataPipeType::MPSC;
+    if (DataPipeType::SPSC == dataPipeType && !singleProducer) {
+      IVS_WARN(
+          "Connection {0}:{1} -> {2}:{3} has more than one producer thread, "
+          "use mpsc instead of spsc, graph id: {4:d}",
+          connection.srcId, connection.srcPort, connection.dstId,
+          connection.dstPort, mId);
+    }
+    dataPipeType = resolved;
+  }
+}
+
 common::ErrorCode Graph::connect(int srcId, int srcPort, int dstId,
-                                 int dstPort) {
+                                 int dstPort,
+                                 const DataPipeConfig& dataPipeConfig) {
   auto srcElementIt = mElementMap.find(srcId);
   if (mElementMap.end() == srcElementIt) {
     IVS_ERROR("Can not find element, graphd id: {0:d}, element id: {1:d}", mId,
@@ -407,7 +576,8 @@ common::ErrorCode Graph::connect(int srcId, int srcPort, int dstId,
     return common::ErrorCode::UNKNOWN;
   }
 
-  framework::Element::connect(*srcElement, srcPort, *dstElement, dstPort);
+  framework::Element::connect(*srcElement, srcPort, *dstElement, dstPort,
+                              dataPipeConfig);
 
   srcElement->afterConnect(false, true);
   dstElement->afterConnect(true, false);
@@ -487,5 +657,90 @@ std::pair<std::string, int> Graph::getSideAndDeviceId(int elementId) {
 }
 
 int Graph::getId() const { return mId; }
+
+void Graph::registListenFunc(ListenThread* listener) {
+  std::string handlerName = "/graph/dataPipeStatus/" + std::to_string(mId);
+  listener->setHandler(handlerName, RequestType::GET,
+                       std::bind(&Graph::listenerGetDataPipeStatus, this,
+                                 std::placeholders::_1, std::placeholders::_2));
+  if (mTraceEnabled) {
+    listener->setHandler(
+        "/graph/traceLatency/" + std::to_string(mId), RequestType::GET,
+        std::bind(&Graph::listenerGetTraceLatency, this, std::placeholders::_1,
+                  std::placeholders::_2));
+    listener->setHandler(
+        "/graph/chromeTrace/" + std::to_string(mId), RequestType::GET,
+        std::bind(&Graph::listenerGetChromeTrace, this, std::placeholders::_1,
+                  std::placeholders::_2));
+  }
+}
+
+void Graph::listenerGetDataPipeStatus(const httplib::Request& request,
+                                      httplib::Response& response) {
+  nlohmann::json dataPipes = nlohmann::json::array();
+  std::map<std::string, std::uint64_t> policyDropCounts;
+  for (auto& pair : mElementMap) {
+    auto element = pair.second;
+    if (!element) continue;
+    for (auto& connectorPair : element->getInputConnectorMap()) {
+      auto connector = connectorPair.second;
+      if (!connector) continue;
+      for (int i = 0; i < connector->getCapacity(); ++i) {
+        auto dataPipe = connector->getDataPipe(i);
+        if (!dataPipe) continue;
+        const DataPipeConfig& config = dataPipe->getConfig();
+        std::string policy = overflowPolicyToString(config.overflowPolicy);
+        nlohmann::json item;
+        item["element_id"] = pair.first;
+        item["port"] = connectorPair.first;
+        item["data_pipe_id"] = i;
+        item["queue_type"] = dataPipeTypeToString(config.type);
+        item["capacity"] = config.capacity;
+        item["overflow_policy"] = policy;
+        item["size"] = dataPipe->getSize();
+        item["dropped"] = dataPipe->getDropCount();
+        dataPipes.push_back(item);
+        policyDropCounts[policy] += dataPipe->getDropCount();
+      }
+    }
+  }
+
+  common::Response resp;
+  resp.code = 0;
+  resp.msg = "success";
+  nlohmann::json json_res = resp;
+  json_res["Result"] = {{"graph_id", mId},
+                        {"dropped_by_policy", policyDropCounts},
+                        {"data_pipes", dataPipes}};
+  response.set_content(json_res.dump(), "application/json");
+}
+
+void Graph::listenerGetTraceLatency(const httplib::Request& request,
+                                    httplib::Response& response) {
+  nlohmann::json channels = nlohmann::json::array();
+  for (auto& item :
+       common::FrameTraceCollector::getInstance().getLatencySummary()) {
+    if (item["graph_id"] == mId) channels.push_back(item);
+  }
+
+  common::Response resp;
+  resp.code = 0;
+  resp.msg = "success";
+  nlohmann::json json_res = resp;
+  json_res["Result"] = {{"graph_id", mId}, {"channels", channels}};
+  response.set_content(json_res.dump(), "application/json");
+}
+
+void Graph::listenerGetChromeTrace(const httplib::Request& request,
+                                   httplib::Response& response) {
+  nlohmann::json trace =
+      common::FrameTraceCollector::getInstance().getChromeTrace();
+  nlohmann::json events = nlohmann::json::array();
+  for (auto& event : trace["traceEvents"]) {
+    if (event["pid"] == mId) events.push_back(event);
+  }
+  trace["traceEvents"] = events;
+  response.set_content(trace.dump(), "application/json");
+}
 }  // namespace framework
 }  // namespace sophon_stream
@@ -10,65 +10,156 @@
 #include "listen_thread.h"
 
 #include "common/logger.h"
+#include "common/metrics.h"
 
 namespace sophon_stream {
 namespace framework {
-ReportImpl_::ReportImpl_(std::string& ip, int port, std::string path_,
-                         int channel)
-    : cli(ip, port), path(path_) {
+ReportImpl_::ReportImpl_(const http_config& config)
+    : cli(config.ip, config.port),
+      path(config.path),
+      replayRate(config.spill_replay_rate) {
+  // 默认连接超时为300s，上报端断网时会长时间阻塞上报线程
+  cli.set_connection_timeout(5, 0);
+  if (!config.spill_dir.empty()) {
+    common::SpillQueueConfig spillConfig;
+    spillConfig.dir = config.spill_dir;
+    spillConfig.maxBytes = static_cast<std::uint64_t>(config.spill_max_mb)
+                           << 20;
+    spillConfig.segmentBytes =
+        std::min(spillConfig.segmentBytes, spillConfig.maxBytes);
+    spill = std::make_unique<common::SpillQueue>(spillConfig);
+    if (!spill->open()) {
+      IVS_ERROR("Open report spill dir {0} fail, spill is disabled",
+                config.spill_dir);
+      spill = nullptr;
+    }
+  }
   workThread = std::thread(&ReportImpl_::postFunc, this);
 }
 
 void ReportImpl_::release() {
-  isRunning = false;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    isRunning = false;
+  }
+  cond.notify_all();
   workThread.join();
 }
 
-void ReportImpl_::postFunc() {
-  while (isRunning) {
-    auto ptr = popQueue();
-    if (ptr == nullptr) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-      continue;
-    }
-    int retry_times = 5;
-    while (retry_times--) {
-      auto res = cli.Post(path.c_str(), ptr->dump(), "application/json");
-      std::string err_str = to_string(res.error());
-      if (err_str != "Success (no error)")
-        IVS_ERROR("Report error:{0}", err_str);
-      else
-        break;
-    }
+bool ReportImpl_::post(const ReportPayload& payload) {
+  auto res = cli.Post(path.c_str(), payload.body.data(), payload.body.size(),
+                      payload.contentType);
+  if (res && res->status >= 200 && res->status < 300) return true;
+  if (res) {
+    IVS_ERROR("Report error, status: {0}", res->status);
+  } else {
+    IVS_ERROR("Report error:{0}", to_string(res.error()));
   }
+  return false;
 }
 
-bool ReportImpl_::pushQueue(std::shared_ptr<nlohmann::json> j) {
-  int len = getQueueSize();
-  if (len >= maxQueueLen) return false;
-  {
-    std::lock_guard<std::mutex> lock(mtx);
-    objQueue.push(j);
+void ReportImpl_::waitFor(int ms) {
+  std::unique_lock<std::mutex> lock(mtx);
+  cond.wait_for(lock, std::chrono::milliseconds(ms),
+                [this] { return !isRunning; });
+}
+
+bool ReportImpl_::hasSpill() { return spill != nullptr && !spill->empty(); }
+
+void ReportImpl_::spillLocked(const ReportPayload* payload) {
+  if (payload != nullptr && payload->persistent)
+    spill->append(payload->contentType, payload->body.data(),
+                  payload->body.size());
+  for (auto& queued : objQueue) {
+    if (queued.persistent)
+      spill->append(queued.contentType, queued.body.data(), queued.body.size());
   }
-  return true;
+  objQueue.clear();
 }
 
-std::shared_ptr<nlohmann::json> ReportImpl_::popQueue() {
-  std::lock_guard<std::mutex> lock(mtx);
-  std::shared_ptr<nlohmann::json> j = nullptr;
-  if (objQueue.empty()) return j;
-  j = objQueue.front();
-  objQueue.pop();
-  return j;
+void ReportImpl_::postFunc() {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point nextReplay = Clock::now();
+  ReportPayload payload;
+  while (true) {
+    bool fromSpill = false;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cond.wait(lock,
+                [this] { return !objQueue.empty() || hasSpill() || !isRunning; });
+      if (!isRunning) {
+        // 内存中未发送的请求写入磁盘，下次启动后发送
+        if (spill != nullptr) spillLocked(nullptr);
+        break;
+      }
+      fromSpill = objQueue.empty();
+      if (!fromSpill) {
+        payload = std::move(objQueue.front());
+        objQueue.pop_front();
+      }
+    }
+    if (fromSpill) {
+      if (spill->peek(records, 1) == 0) continue;
+      payload.body.swap(records[0].body);
+      payload.contentType = records[0].contentType == common::BINARY_CONTENT_TYPE
+                                ? common::BINARY_CONTENT_TYPE
+                                : common::JSON_CONTENT_TYPE;
+      payload.persistent = true;
+      if (replayRate > 0) {
+        // 限速重放，避免上报端恢复后被积压的请求压垮
+        Clock::time_point now = Clock::now();
+        if (nextReplay > now) {
+          std::unique_lock<std::mutex> lock(mtx);
+          cond.wait_until(lock, nextReplay, [this] { return !isRunning; });
+        }
+        nextReplay = std::max(now, nextReplay) +
+                     std::chrono::microseconds(1000000 / replayRate);
+      }
+    }
+
+    bool sent = isRunning && post(payload);
+    int backoffMs = retryIntervalMs;
+    for (int attempt = 1; !sent && isRunning; ++attempt) {
+      if (spill != nullptr && !fromSpill && payload.persistent) {
+        std::lock_guard<std::mutex> lock(mtx);
+        // 磁盘队列为空时连同内存队列一起写入磁盘，顺序不变，之后从磁盘重放；
+        // 否则磁盘中都是更晚的请求，这条只能留在内存中重试
+        if (!hasSpill()) {
+          spillLocked(&payload);
+          break;
+        }
+      } else if ((spill == nullptr || !payload.persistent) &&
+                 attempt >= maxRetryTimes) {
+        break;
+      }
+      waitFor(backoffMs);
+      backoffMs = std::min(backoffMs * 2, maxBackoffMs);
+      sent = isRunning && post(payload);
+    }
+    if (sent && fromSpill) spill->ack(1);
+    if (!sent && !fromSpill && !isRunning && spill != nullptr) {
+      std::lock_guard<std::mutex> lock(mtx);
+      spillLocked(&payload);
+    }
+  }
 }
 
-size_t ReportImpl_::getQueueSize() {
-  int len = -1;
+bool ReportImpl_::pushQueue(std::string body, const char* contentType,
+                            bool persistent) {
   {
     std::lock_guard<std::mutex> lock(mtx);
-    len = objQueue.size();
+    // 磁盘队列中还有请求时，新请求排在它们后面；状态请求不参与排序
+    if ((!persistent || !hasSpill()) &&
+        static_cast<int>(objQueue.size()) < maxQueueLen) {
+      objQueue.push_back(
+          ReportPayload{std::move(body), contentType, persistent});
+    } else if (!persistent || spill == nullptr ||
+               !spill->append(contentType, body.data(), body.size())) {
+      return false;
+    }
   }
-  return len;
+  cond.notify_one();
+  return true;
 }
 
 ListenThread* ListenThread::getInstance() {
@@ -101,6 +192,23 @@ void ListenThread::init(const nlohmann::json& report_json,
     report_config.port = report_json.find(JSON_PORT_FILED)->get<int>();
     report_config.ip = report_json.find(JSON_IP_FILED)->get<std::string>();
     report_config.path = report_json.find(JSON_PATH_FILED)->get<std::string>();
+    auto spillDirIt = report_json.find(JSON_SPILL_DIR_FILED);
+    if (spillDirIt != report_json.end())
+      report_config.spill_dir = spillDirIt->get<std::string>();
+    auto spillMaxIt = report_json.find(JSON_SPILL_MAX_MB_FILED);
+    if (spillMaxIt != report_json.end())
+      report_config.spill_max_mb = std::max(spillMaxIt->get<int>(), 1);
+    auto replayRateIt = report_json.find(JSON_SPILL_REPLAY_RATE_FILED);
+    if (replayRateIt != report_json.end())
+      report_config.spill_replay_rate = std::max(replayRateIt->get<int>(), 0);
+    auto formatIt = report_json.find(JSON_FORMAT_FILED);
+    if (formatIt != report_json.end() &&
+        !(formatIt->is_string() &&
+          common::parseSerializeFormat(formatIt->get<std::string>(),
+                                       report_config.format))) {
+      IVS_ERROR("Unknown report format {0}, use json", formatIt->dump());
+      report_config.format = common::SerializeFormat::JSON;
+    }
   }
   if (listen_json.contains(JSON_PORT_FILED)) {
     listen_config.port = listen_json.find(JSON_PORT_FILED)->get<int>();
@@ -120,19 +228,19 @@ void ListenThread::init(const nlohmann::json& report_json,
   if (if_report_) {
     IVS_INFO("Start to Init Report Thread... Path is {0}:{1}{2}",
              report_config.ip, report_config.port, report_config.path);
-    client = std::make_shared<ReportImpl_>(report_config.ip, report_config.port,
-                                           report_config.path, 0);
+    client = std::make_shared<ReportImpl_>(report_config);
     IVS_INFO("Complete to Init Report Thread... Path is {0}:{1}{2}",
              report_config.ip, report_config.port, report_config.path);
   }
 
-  
+  setHandler(METRICS_PATH, RequestType::GET, &ListenThread::handle_metrics);
+
   listen_thread_ = std::thread(&ListenThread::listen_loop);
   IVS_INFO("Complete to Init Listen Thread... Path is {0}:{1}{2}",
            listen_config.ip, listen_config.port, listen_config.path);
 }
 bool ListenThread::pushQueue(std::shared_ptr<nlohmann::json> j) {
-  return client->pushQueue(j);
+  return client->pushQueue(j->dump(), common::JSON_CONTENT_TYPE);
 }
 void ListenThread::stop() {
   IVS_INFO("Start to Stop Listen Thread... Path is {0}:{1}{2}",
@@ -193,8 +301,31 @@ void ListenThread::handle_task_interact(const httplib::Request& request,
   response.set_content(str_ret, "application/json");
 }
 
+void ListenThread::handle_metrics(const httplib::Request& request,
+                                  httplib::Response& response) {
+  response.set_content(common::MetricsRegistry::getInstance().dumpPrometheus(),
+                       common::MetricsRegistry::PROMETHEUS_CONTENT_TYPE);
+}
+
 void ListenThread::report_status(common::ErrorCode errorcode) {
   if (!if_report_) return;
+  {
+    std::lock_guard<std::mutex> lock(status_mtx_);
+    auto now = std::chrono::steady_clock::now();
+    auto it = last_status_report_.find(errorcode);
+    if (it != last_status_report_.end() &&
+        now - it->second < std::chrono::milliseconds(statusReportIntervalMs))
+      return;
+    last_status_report_[errorcode] = now;
+  }
+  if (report_config.format == common::SerializeFormat::BINARY) {
+    common::BinaryWriter writer;
+    common::serializeBinaryStatus(writer,
+                                  common::ErrorCodeToString(errorcode));
+    client->pushQueue(std::move(writer.buffer()), common::BINARY_CONTENT_TYPE,
+                      false);
+    return;
+  }
   std::shared_ptr<nlohmann::json> j_patch =
       std::make_shared<nlohmann::json>(R"({
         "error": "config not good"
@@ -202,7 +333,7 @@ void ListenThread::report_status(common::ErrorCode errorcode) {
 
   std::string error = common::ErrorCodeToString(errorcode);
   (*j_patch)["error"] = error;
-  pushQueue(j_patch);
+  client->pushQueue(j_patch->dump(), common::JSON_CONTENT_TYPE, false);
   return;
 }
 }  // namespace framework
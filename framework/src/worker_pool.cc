@@ -0,0 +1,185 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#include "worker_pool.h"
+
+#include <sys/prctl.h>
+
+#include <algorithm>
+
+#include "common/logger.h"
+
+namespace sophon_stream {
+namespace framework {
+
+namespace {
+thread_local WorkerPool* tlsWorkerPool = nullptr;
+thread_local int tlsWorkerId = -1;
+}  // namespace
+
+bool schedulerTypeFromString(const std::string& name, SchedulerType& type) {
+  if (name == "thread") {
+    type = SchedulerType::THREAD;
+  } else if (name == "pool") {
+    type = SchedulerType::POOL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* schedulerTypeToString(SchedulerType type) {
+  switch (type) {
+    case SchedulerType::POOL:
+      return "pool";
+    default:
+      return "thread";
+  }
+}
+
+WorkerPool::WorkerPool(int threadNumber, int maxThreadNumber)
+    : mThreadNumber(threadNumber > 0 ? threadNumber : 1) {
+  int workerNumber = std::max(mThreadNumber, maxThreadNumber);
+  mWorkers.reserve(workerNumber);
+  for (int i = 0; i < workerNumber; ++i) {
+    mWorkers.push_back(std::make_unique<Worker>());
+  }
+}
+
+WorkerPool::~WorkerPool() { stop(); }
+
+void WorkerPool::start() {
+  if (mRunning.exchange(true)) return;
+  IVS_INFO("Start worker pool, thread number: {0:d}, max thread number: {1:d}",
+           mThreadNumber, static_cast<int>(mWorkers.size()));
+  for (int i = 0; i < static_cast<int>(mWorkers.size()); ++i) {
+    mWorkers[i]->thread = std::thread(&WorkerPool::run, this, i);
+  }
+}
+
+void WorkerPool::stop() {
+  if (!mRunning.exchange(false)) return;
+  {
+    std::lock_guard<std::mutex> lock(mParkMutex);
+  }
+  mParkCond.notify_all();
+  for (auto& worker : mWorkers) {
+    if (worker->thread.joinable()) worker->thread.join();
+    worker->tasks.clear();
+  }
+  mGlobalTasks.clear();
+  mPendingTasks.store(0);
+  IVS_INFO("Stop worker pool finish");
+}
+
+WorkerPool* WorkerPool::current() { return tlsWorkerPool; }
+
+void WorkerPool::submit(Task task) {
+  if (this == tlsWorkerPool) {
+    // 下游任务优先留在当前worker执行，数据大概率还在缓存中
+    auto& worker = mWorkers[tlsWorkerId];
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->tasks.push_back(std::move(task));
+  } else {
+    std::lock_guard<std::mutex> lock(mGlobalTasksMutex);
+    mGlobalTasks.push_back(std::move(task));
+  }
+  mPendingTasks.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(mParkMutex);
+  }
+  mParkCond.notify_one();
+}
+
+bool WorkerPool::popTask(int workerId, Task& task) {
+  {
+    auto& worker = mWorkers[workerId];
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (!worker->tasks.empty()) {
+      task = std::move(worker->tasks.front());
+      worker->tasks.pop_front();
+      mPendingTasks.fetch_sub(1);
+      return true;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mGlobalTasksMutex);
+    if (!mGlobalTasks.empty()) {
+      task = std::move(mGlobalTasks.front());
+      mGlobalTasks.pop_front();
+      mPendingTasks.fetch_sub(1);
+      return true;
+    }
+  }
+  int workerNumber = mWorkers.size();
+  for (int i = 1; i < workerNumber; ++i) {
+    auto& victim = mWorkers[(workerId + i) % workerNumber];
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (!victim->tasks.empty()) {
+      // 从队尾窃取，与队列所有者从队首取任务错开
+      task = std::move(victim->tasks.back());
+      victim->tasks.pop_back();
+      mPendingTasks.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkerPool::run(int workerId) {
+  tlsWorkerPool = this;
+  tlsWorkerId = workerId;
+  prctl(PR_SET_NAME, ("pool_" + std::to_string(workerId)).c_str());
+
+  std::unique_lock<std::mutex> lock(mParkMutex);
+  while (mRunning) {
+    if (mPendingTasks.load() == 0 || mActiveWorkers.load() >= mThreadNumber) {
+      mParkCond.wait(lock);
+      continue;
+    }
+    mActiveWorkers.fetch_add(1);
+    lock.unlock();
+
+    Task task;
+    while (mRunning && popTask(workerId, task)) {
+      task();
+      task = nullptr;
+      // 有worker离开BlockingScope后执行名额可能超出，多出的worker让出名额
+      if (mActiveWorkers.load() > mThreadNumber) break;
+    }
+
+    lock.lock();
+    mActiveWorkers.fetch_sub(1);
+    if (mPendingTasks.load() > 0) mParkCond.notify_one();
+  }
+
+  tlsWorkerPool = nullptr;
+  tlsWorkerId = -1;
+}
+
+void WorkerPool::enterBlocking() {
+  mActiveWorkers.fetch_sub(1);
+  {
+    std::lock_guard<std::mutex> lock(mParkMutex);
+  }
+  mParkCond.notify_one();
+}
+
+void WorkerPool::leaveBlocking() { mActiveWorkers.fetch_add(1); }
+
+WorkerPool::BlockingScope::BlockingScope() : mPool(WorkerPool::current()) {
+  if (mPool) mPool->enterBlocking();
+}
+
+WorkerPool::BlockingScope::~BlockingScope() {
+  if (mPool) mPool->leaveBlocking();
+}
+
+}  // namespace framework
+}  // namespace sophon_stream
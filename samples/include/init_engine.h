@@ -30,7 +30,17 @@ constexpr const char* JSON_CONFIG_SRC_ID_FILED = "src_element_id";
 constexpr const char* JSON_CONFIG_SRC_PORT_FILED = "src_port";
 constexpr const char* JSON_CONFIG_DST_ID_FILED = "dst_element_id";
 constexpr const char* JSON_CONFIG_DST_PORT_FILED = "dst_port";
+constexpr const char* JSON_CONFIG_QUEUE_TYPE_FILED = "queue_type";
+constexpr const char* JSON_CONFIG_CAPACITY_FILED = "capacity";
+constexpr const char* JSON_CONFIG_OVERFLOW_POLICY_FILED = "overflow_policy";
 constexpr const char* JSON_CONFIG_INNER_ELEMENTS_ID = "inner_elements_id";
+constexpr const char* JSON_CONFIG_SCHEDULER_FILED = "scheduler";
+constexpr const char* JSON_CONFIG_POOL_THREAD_NUMBER_FILED =
+    "pool_thread_number";
+constexpr const char* JSON_CONFIG_TRACE_FILED = "trace";
+constexpr const char* JSON_CONFIG_TRACE_SAMPLE_INTERVAL_FILED =
+    "trace_sample_interval";
+constexpr const char* JSON_CONFIG_TRACE_FILE_FILED = "trace_file";
 
 void parse_element_json(
     const nlohmann::detail::iter_impl<nlohmann::json> elements_it,
@@ -109,6 +119,19 @@ void parse_connection_json(
     connectConf["src_port"] = src_port;
     connectConf["dst_id"] = dst_element_id;
     connectConf["dst_port"] = dst_port;
+    auto queue_type_it = connect_config.find(JSON_CONFIG_QUEUE_TYPE_FILED);
+    if (queue_type_it != connect_config.end()) {
+      connectConf[JSON_CONFIG_QUEUE_TYPE_FILED] = *queue_type_it;
+    }
+    auto capacity_it = connect_config.find(JSON_CONFIG_CAPACITY_FILED);
+    if (capacity_it != connect_config.end()) {
+      connectConf[JSON_CONFIG_CAPACITY_FILED] = *capacity_it;
+    }
+    auto overflow_policy_it =
+        connect_config.find(JSON_CONFIG_OVERFLOW_POLICY_FILED);
+    if (overflow_policy_it != connect_config.end()) {
+      connectConf[JSON_CONFIG_OVERFLOW_POLICY_FILED] = *overflow_policy_it;
+    }
     graphConfigure["connections"].push_back(connectConf);
   }
 }
@@ -124,6 +147,16 @@ void init_engine(
 
     int graph_id = graph_it.find(JSON_CONFIG_GRAPH_ID_FILED)->get<int>();
     graphConfigure["graph_id"] = graph_id;
+    // graph级别的可选配置原样传给engine
+    for (auto optional_filed :
+         {JSON_CONFIG_SCHEDULER_FILED, JSON_CONFIG_POOL_THREAD_NUMBER_FILED,
+          JSON_CONFIG_TRACE_FILED, JSON_CONFIG_TRACE_SAMPLE_INTERVAL_FILED,
+          JSON_CONFIG_TRACE_FILE_FILED}) {
+      auto optional_it = graph_it.find(optional_filed);
+      if (optional_it != graph_it.end()) {
+        graphConfigure[optional_filed] = *optional_it;
+      }
+    }
     int device_id = graph_it.find(JSON_CONFIG_DEVICE_ID_FILED)->get<int>();
     auto elements_it = graph_it.find(JSON_CONFIG_ELEMENTS_FILED);
     parse_element_json(elements_it, elementsConfigure, device_id, src_id_port,
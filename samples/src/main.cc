@@ -56,6 +56,12 @@ constexpr const char* JSON_CONFIG_HTTP_LISTEN_CONFIG_FILED = "http_listen";
 constexpr const char* JSON_CONFIG_HTTP_CONFIG_IP_FILED = "ip";
 constexpr const char* JSON_CONFIG_HTTP_CONFIG_PORT_FILED = "port";
 constexpr const char* JSON_CONFIG_HTTP_CONFIG_PATH_FILED = "path";
+constexpr const char* JSON_CONFIG_HTTP_CONFIG_FORMAT_FILED = "format";
+constexpr const char* JSON_CONFIG_HTTP_CONFIG_SPILL_DIR_FILED = "spill_dir";
+constexpr const char* JSON_CONFIG_HTTP_CONFIG_SPILL_MAX_MB_FILED =
+    "spill_max_mb";
+constexpr const char* JSON_CONFIG_HTTP_CONFIG_SPILL_REPLAY_RATE_FILED =
+    "spill_replay_rate";
 
 demo_config parse_demo_json(std::string& json_path) {
   std::ifstream istream;
@@ -213,6 +219,17 @@ demo_config parse_demo_json(std::string& json_path) {
     config.report_config["path"] =
         http_report_it->find(JSON_CONFIG_HTTP_CONFIG_PATH_FILED)
             ->get<std::string>();
+    auto format_it =
+        http_report_it->find(JSON_CONFIG_HTTP_CONFIG_FORMAT_FILED);
+    if (format_it != http_report_it->end())
+      config.report_config["format"] = *format_it;
+    for (const char* filed : {JSON_CONFIG_HTTP_CONFIG_SPILL_DIR_FILED,
+                              JSON_CONFIG_HTTP_CONFIG_SPILL_MAX_MB_FILED,
+                              JSON_CONFIG_HTTP_CONFIG_SPILL_REPLAY_RATE_FILED}) {
+      auto spill_it = http_report_it->find(filed);
+      if (spill_it != http_report_it->end())
+        config.report_config[filed] = *spill_it;
+    }
   }
   if (demo_json.contains(JSON_CONFIG_HTTP_LISTEN_CONFIG_FILED)) {
     auto http_listen_it = demo_json.find(JSON_CONFIG_HTTP_LISTEN_CONFIG_FILED);
@@ -0,0 +1,202 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 检查common/base64.h的SIMD实现与标量实现的结果一致，并对比编解码吞吐：
+// legacy: 原serialize.h中逐字符追加到std::string的编码，以及decode使用的
+//         websocketpp::base64_decode
+// scalar: base64EncodeScalar/base64DecodeScalar，写入预先分配的缓冲区
+// simd:   base64Encode/base64Decode，按CPU选择AVX2/SSSE3/NEON
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <websocketpp/base64/base64.hpp>
+
+#include "common/base64.h"
+
+namespace {
+
+using sophon_stream::common::base64Backend;
+using sophon_stream::common::base64Decode;
+using sophon_stream::common::base64DecodedMaxSize;
+using sophon_stream::common::base64DecodeScalar;
+using sophon_stream::common::base64Encode;
+using sophon_stream::common::base64EncodedSize;
+using sophon_stream::common::base64EncodeScalar;
+
+struct BenchmarkConfig {
+  int iterations = 200;
+  /**
+   * @brief 每次编码的数据大小，单位KB，默认约为一张1080p JPEG的大小
+   */
+  int sizeKB = 300;
+};
+
+const std::string LEGACY_CHARS =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string legacyEncode(unsigned char const* input, size_t len) {
+  std::string ret;
+  int i = 0;
+  int j = 0;
+  unsigned char char_array_3[3];
+  unsigned char char_array_4[4];
+
+  while (len--) {
+    char_array_3[i++] = *(input++);
+    if (i == 3) {
+      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+      char_array_4[1] =
+          ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+      char_array_4[2] =
+          ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+      char_array_4[3] = char_array_3[2] & 0x3f;
+      for (i = 0; (i < 4); i++) ret += LEGACY_CHARS[char_array_4[i]];
+      i = 0;
+    }
+  }
+  if (i) {
+    for (j = i; j < 3; j++) char_array_3[j] = '\0';
+    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+    char_array_4[1] =
+        ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+    char_array_4[2] =
+        ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+    char_array_4[3] = char_array_3[2] & 0x3f;
+    for (j = 0; (j < i + 1); j++) ret += LEGACY_CHARS[char_array_4[j]];
+    while ((i++ < 3)) ret += '=';
+  }
+  return ret;
+}
+
+std::string randomBytes(std::mt19937& rng, std::size_t size) {
+  std::string data(size, '\0');
+  for (auto& c : data) c = static_cast<char>(rng());
+  return data;
+}
+
+bool checkCorrectness() {
+  std::mt19937 rng(0);
+  // 覆盖各SIMD内核的块边界和尾部长度
+  for (std::size_t size = 0; size < 4096; ++size) {
+    std::string data = randomBytes(rng, size);
+    std::string simd(base64EncodedSize(size), '\0');
+    std::string scalar(base64EncodedSize(size), '\0');
+    base64Encode(data.data(), size, &simd[0]);
+    base64EncodeScalar(data.data(), size, &scalar[0]);
+    if (simd != scalar || simd != websocketpp::base64_encode(data)) {
+      std::cerr << "encode mismatch, size " << size << std::endl;
+      return false;
+    }
+
+    std::string decoded(base64DecodedMaxSize(simd.size()), '\0');
+    std::size_t decodedSize = 0;
+    if (!base64Decode(simd.data(), simd.size(), &decoded[0], decodedSize) ||
+        decodedSize != size ||
+        0 != std::memcmp(decoded.data(), data.data(), size)) {
+      std::cerr << "decode mismatch, size " << size << std::endl;
+      return false;
+    }
+
+    if (size == 0) continue;
+    // 任意位置的非法字符都应被拒绝
+    static const char INVALID_CHARS[] = {'!', '-', '_', ' ', '\n', '\x80'};
+    std::string corrupted = simd;
+    corrupted[rng() % corrupted.size()] = INVALID_CHARS[rng() % 6];
+    if (base64Decode(corrupted.data(), corrupted.size(), &decoded[0],
+                     decodedSize)) {
+      std::cerr << "invalid input accepted, size " << size << std::endl;
+      return false;
+    }
+  }
+
+  static const char* VALID[] = {"", "TQ==", "TWE=", "TWFu"};
+  static const char* INVALID[] = {"TQ=", "T===", "TQ==TQ==", "=QQQ", "TQ=A"};
+  std::string out;
+  for (const char* s : VALID) {
+    out.clear();
+    if (!base64Decode(s, out)) {
+      std::cerr << "valid input rejected: " << s << std::endl;
+      return false;
+    }
+  }
+  for (const char* s : INVALID) {
+    out.clear();
+    if (base64Decode(s, out)) {
+      std::cerr << "invalid input accepted: " << s << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Func>
+void runBenchmark(const std::string& name, const BenchmarkConfig& config,
+                  std::size_t bytes, Func&& func) {
+  for (int i = 0; i < 3; ++i) func();
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < config.iterations; ++i) func();
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - begin).count();
+  std::cout << name << ": " << seconds * 1e6 / config.iterations
+            << " us/iter, "
+            << bytes * config.iterations / seconds / (1 << 20) << " MB/s"
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.iterations = std::atoi(argv[1]);
+  if (argc > 2) config.sizeKB = std::atoi(argv[2]);
+  if (config.iterations <= 0 || config.sizeKB <= 0) {
+    std::cerr << "usage: " << argv[0] << " [iterations] [size_kb]"
+              << std::endl;
+    return 1;
+  }
+
+  std::cout << "backend: " << base64Backend() << std::endl;
+  if (!checkCorrectness()) return 1;
+  std::cout << "correctness: ok" << std::endl;
+
+  std::mt19937 rng(1);
+  std::string data = randomBytes(rng, config.sizeKB * 1024);
+  std::string encoded(base64EncodedSize(data.size()), '\0');
+  std::string decoded(base64DecodedMaxSize(encoded.size()), '\0');
+  base64Encode(data.data(), data.size(), &encoded[0]);
+  std::size_t decodedSize = 0;
+  volatile std::size_t sink = 0;
+
+  runBenchmark("encode legacy", config, data.size(), [&]() {
+    sink = legacyEncode(reinterpret_cast<const unsigned char*>(data.data()),
+                        data.size())
+               .size();
+  });
+  runBenchmark("encode scalar", config, data.size(), [&]() {
+    base64EncodeScalar(data.data(), data.size(), &encoded[0]);
+  });
+  runBenchmark("encode simd  ", config, data.size(), [&]() {
+    base64Encode(data.data(), data.size(), &encoded[0]);
+  });
+  runBenchmark("decode legacy", config, data.size(), [&]() {
+    sink = websocketpp::base64_decode(encoded).size();
+  });
+  runBenchmark("decode scalar", config, data.size(), [&]() {
+    base64DecodeScalar(encoded.data(), encoded.size(), &decoded[0],
+                       decodedSize);
+  });
+  runBenchmark("decode simd  ", config, data.size(), [&]() {
+    base64Decode(encoded.data(), encoded.size(), &decoded[0], decodedSize);
+  });
+  return 0;
+}
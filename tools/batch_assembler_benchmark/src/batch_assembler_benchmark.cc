@@ -0,0 +1,345 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比检测element原来的组batch方式（legacy：一直等到凑满max_batch）与
+// BatchAssembler在不同max_batch_wait_us下的吞吐和时延。
+// 多路码流按泊松过程向同一个DataPipe推送帧，推理线程组batch后用sleep模拟推理，
+// 耗时为 infer_base_us + infer_per_frame_us * bmodel batch，补齐的帧同样计入耗时。
+// 每个负载点输出吞吐、p50/p99时延和最差一路码流的p99，可据此画出吞吐-p99曲线。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "algorithmApi/batch_assembler.h"
+#include "datapipe.h"
+
+namespace {
+
+using sophon_stream::element::BatchAssembler;
+using sophon_stream::framework::DataPipe;
+using Clock = std::chrono::steady_clock;
+
+struct Item {
+  int channel = 0;
+  int seq = 0;
+  bool endOfStream = false;
+  bool filtered = false;
+  Clock::time_point pushTime;
+};
+
+BatchAssembler::ItemInfo getItemInfo(const std::shared_ptr<void>& data) {
+  auto item = std::static_pointer_cast<Item>(data);
+  BatchAssembler::ItemInfo info;
+  info.channel = item->channel;
+  info.endOfStream = item->endOfStream;
+  info.filtered = item->filtered;
+  return info;
+}
+
+std::shared_ptr<void> makeItem(int channel, int seq, bool endOfStream = false,
+                               bool filtered = false) {
+  auto item = std::make_shared<Item>();
+  item->channel = channel;
+  item->seq = seq;
+  item->endOfStream = endOfStream;
+  item->filtered = filtered;
+  item->pushTime = Clock::now();
+  return item;
+}
+
+bool failed(const char* what) {
+  std::printf("check %s: FAILED\n", what);
+  return false;
+}
+
+/**
+ * @brief 用预先排好的数据检查组batch的规则
+ */
+bool checkRules() {
+  bool ok = true;
+  std::deque<std::shared_ptr<void>> queue;
+  auto pop = [&](std::chrono::microseconds) -> std::shared_ptr<void> {
+    if (queue.empty()) return nullptr;
+    auto data = queue.front();
+    queue.pop_front();
+    return data;
+  };
+  auto wait = [] { return true; };
+  auto noWait = [] { return false; };
+  auto channelOf = [](const std::shared_ptr<void>& data) {
+    return std::static_pointer_cast<Item>(data)->channel;
+  };
+
+  // batch选择：能留下数据时不补齐，否则取不小于数据数的最小batch
+  std::vector<int> sizes = {1, 4, 8};
+  if (BatchAssembler::selectBatchSize(sizes, 3, true) != 1 ||
+      BatchAssembler::selectBatchSize(sizes, 3, false) != 4 ||
+      BatchAssembler::selectBatchSize(sizes, 6, true) != 4 ||
+      BatchAssembler::selectBatchSize(sizes, 8, false) != 8 ||
+      BatchAssembler::selectBatchSize({4}, 3, true) != 4)
+    ok = failed("batch size selection");
+
+  // 轮流取：一路码流积压时其他码流的帧仍进入同一个batch
+  {
+    BatchAssembler assembler({4}, std::chrono::microseconds(-1), 1,
+                             getItemInfo);
+    for (int i = 0; i < 6; ++i) queue.push_back(makeItem(0, i));
+    queue.push_back(makeItem(1, 0));
+    queue.push_back(makeItem(1, 1));
+    auto batch = assembler.assemble(0, pop, wait);
+    int fromOne = 0;
+    for (auto& data : batch.items) fromOne += channelOf(data) == 1;
+    if (batch.items.size() != 4 || fromOne != 2)
+      ok = failed("round robin across channels");
+    // 下一个batch接着取剩下的帧，码流内按顺序
+    batch = assembler.assemble(0, pop, noWait);
+    int expected = 2;
+    for (auto& data : batch.items) {
+      auto item = std::static_pointer_cast<Item>(data);
+      if (item->channel != 0 || item->seq != expected++)
+        ok = failed("order within channel");
+    }
+  }
+
+  // 码流结束帧不等待，并排在items的最后；filtered随batch推送但不参与处理
+  {
+    BatchAssembler assembler({4}, std::chrono::microseconds(-1), 1,
+                             getItemInfo);
+    queue.push_back(makeItem(0, 0, true));
+    queue.push_back(makeItem(1, 0, false, true));
+    queue.push_back(makeItem(1, 1));
+    auto batch = assembler.assemble(0, pop, wait);
+    if (batch.items.size() != 2 || batch.all.size() != 3 ||
+        !std::static_pointer_cast<Item>(batch.items.back())->endOfStream)
+      ok = failed("end of stream last, filtered passed through");
+  }
+
+  // 超时：只有一帧时等待maxWait后返回
+  {
+    const auto maxWait = std::chrono::microseconds(3000);
+    BatchAssembler assembler({1, 4}, maxWait, 1, getItemInfo);
+    queue.push_back(makeItem(0, 0));
+    auto begin = Clock::now();
+    auto batch = assembler.assemble(0, pop, wait);
+    auto elapsed = Clock::now() - begin;
+    if (batch.items.size() != 1 || batch.batchSize != 1 || elapsed < maxWait ||
+        elapsed > maxWait * 10)
+      ok = failed("deadline");
+  }
+  std::printf("rules: %s\n", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+struct BenchmarkConfig {
+  int channels = 8;
+  std::vector<int> batchSizes = {1, 4};
+  int inferBaseUs = 3000;
+  int inferPerFrameUs = 2000;
+  /**
+   * @brief 第0路码流的帧率是其他码流的hot倍
+   */
+  int hot = 1;
+  double seconds = 2;
+};
+
+struct Result {
+  double throughput = 0;
+  double p50 = 0;
+  double p99 = 0;
+  double worstChannelP99 = 0;
+  double meanBatch = 0;
+  double padding = 0;
+  bool ordered = true;
+  bool complete = true;
+};
+
+double percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0;
+  std::size_t index = std::min(values.size() - 1,
+                               static_cast<std::size_t>(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+/**
+ * @brief 一个负载点
+ * @param maxWaitUs legacy为原来的组batch方式，否则为max_batch_wait_us
+ */
+Result run(const BenchmarkConfig& config, double totalFps, bool legacy,
+           int maxWaitUs) {
+  DataPipe pipe;
+  const int maxBatch = config.batchSizes.back();
+  std::atomic<bool> producing{true};
+
+  // 第0路码流的帧率为其他码流的hot倍
+  double unit = totalFps / (config.channels - 1 + config.hot);
+  std::vector<int> produced(config.channels, 0);
+  std::vector<std::thread> producers;
+  auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(config.seconds));
+  for (int c = 0; c < config.channels; ++c) {
+    double fps = c == 0 ? unit * config.hot : unit;
+    producers.emplace_back([&, c, fps]() {
+      std::mt19937 rng(c + 1);
+      std::exponential_distribution<double> interval(fps);
+      auto next = Clock::now();
+      int seq = 0;
+      while (true) {
+        next += std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(interval(rng)));
+        if (next >= end) break;
+        std::this_thread::sleep_until(next);
+        pipe.pushData(makeItem(c, seq++), std::chrono::milliseconds(200));
+      }
+      produced[c] = seq;
+    });
+  }
+
+  std::vector<std::vector<double>> latencies(config.channels);
+  std::vector<int> nextSeq(config.channels, 0);
+  Result result;
+  std::uint64_t batches = 0, frames = 0, slots = 0;
+  auto pop = [&](std::chrono::microseconds timeout) {
+    return timeout.count() > 0 ? pipe.popData(timeout) : pipe.popData();
+  };
+  auto canWait = [&] { return producing.load(); };
+  BatchAssembler assembler(config.batchSizes,
+                           std::chrono::microseconds(maxWaitUs), 1,
+                           getItemInfo);
+
+  auto begin = Clock::now();
+  std::thread consumer([&]() {
+    while (true) {
+      std::vector<std::shared_ptr<void>> items;
+      int batchSize = 0;
+      if (legacy) {
+        // 原doWork：一直等到凑满max_batch，推理时补齐到max_batch
+        while (items.size() < static_cast<std::size_t>(maxBatch)) {
+          auto data = pipe.popData(std::chrono::milliseconds(200));
+          if (!data) {
+            if (canWait()) continue;
+            break;
+          }
+          items.push_back(data);
+        }
+        batchSize = items.empty() ? 0 : maxBatch;
+      } else {
+        auto batch = assembler.assemble(0, pop, canWait);
+        items = std::move(batch.items);
+        batchSize = batch.batchSize;
+      }
+      if (items.empty()) {
+        if (!producing && pipe.getSize() == 0) break;
+        continue;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(
+          config.inferBaseUs + config.inferPerFrameUs * batchSize));
+      auto now = Clock::now();
+      ++batches;
+      frames += items.size();
+      slots += batchSize;
+      for (auto& data : items) {
+        auto item = std::static_pointer_cast<Item>(data);
+        if (item->seq != nextSeq[item->channel]++) result.ordered = false;
+        latencies[item->channel].push_back(
+            std::chrono::duration<double, std::milli>(now - item->pushTime)
+                .count());
+      }
+    }
+  });
+  for (auto& producer : producers) producer.join();
+  producing = false;
+  consumer.join();
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+
+  std::vector<double> all;
+  for (int c = 0; c < config.channels; ++c) {
+    if (nextSeq[c] != produced[c]) result.complete = false;
+    all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    result.worstChannelP99 =
+        std::max(result.worstChannelP99, percentile(latencies[c], 0.99));
+  }
+  result.throughput = frames / seconds;
+  result.p50 = percentile(all, 0.5);
+  result.p99 = percentile(all, 0.99);
+  result.meanBatch = batches ? static_cast<double>(frames) / batches : 0;
+  result.padding = slots ? 100.0 * (slots - frames) / slots : 0;
+  return result;
+}
+
+std::vector<int> parseList(const char* text) {
+  std::vector<int> values;
+  std::stringstream stream(text);
+  std::string token;
+  while (std::getline(stream, token, ','))
+    if (!token.empty()) values.push_back(std::atoi(token.c_str()));
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  std::vector<int> waits = {0, 2000, 5000, 20000};
+  if (argc > 1) config.channels = std::max(2, std::atoi(argv[1]));
+  if (argc > 2) config.batchSizes = parseList(argv[2]);
+  if (argc > 3) config.inferBaseUs = std::atoi(argv[3]);
+  if (argc > 4) config.inferPerFrameUs = std::atoi(argv[4]);
+  if (argc > 5) waits = parseList(argv[5]);
+  if (argc > 6) config.hot = std::max(1, std::atoi(argv[6]));
+  if (argc > 7) config.seconds = std::atof(argv[7]);
+  if (config.batchSizes.empty()) config.batchSizes = {1};
+
+  if (!checkRules()) return 1;
+
+  const int maxBatch = config.batchSizes.back();
+  double capacity =
+      maxBatch * 1e6 /
+      (config.inferBaseUs + config.inferPerFrameUs * maxBatch);
+  std::printf(
+      "channels: %d (channel 0 x%d), batch sizes:", config.channels,
+      config.hot);
+  for (int size : config.batchSizes) std::printf(" %d", size);
+  std::printf(", infer: %d + %d * batch us, capacity: %.1f fps\n",
+              config.inferBaseUs, config.inferPerFrameUs, capacity);
+  std::printf("%-10s %5s %8s %8s %8s %8s %9s %6s %6s\n", "mode", "load",
+              "offered", "fps", "p50(ms)", "p99(ms)", "worst p99", "batch",
+              "pad%");
+
+  bool ok = true;
+  for (double load : {0.1, 0.3, 0.6, 0.9}) {
+    double offered = capacity * load;
+    std::vector<std::pair<std::string, int>> modes = {{"legacy", -1}};
+    for (int wait : waits) modes.push_back({"wait " + std::to_string(wait), wait});
+    for (auto& mode : modes) {
+      bool legacy = mode.first == "legacy";
+      Result result = run(config, offered, legacy, mode.second);
+      ok = ok && result.ordered && result.complete;
+      std::printf("%-10s %4.0f%% %8.1f %8.1f %8.2f %8.2f %9.2f %6.2f %5.1f%%\n",
+                  mode.first.c_str(), load * 100, offered, result.throughput,
+                  result.p50, result.p99, result.worstChannelP99,
+                  result.meanBatch, result.padding);
+    }
+  }
+  std::printf("order and completeness: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
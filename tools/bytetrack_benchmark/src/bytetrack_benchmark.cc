@@ -0,0 +1,693 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 回放检测序列，对比bytetrack关联阶段的两种实现：
+// legacy: 原BYTETracker中的ious + lapjv，二维vector保存代价矩阵，
+//         扩展成(rows + cols)方阵后调用lapjv_internal
+// sparse: bytetrack_association.h的SIMD IoU内核 + SparseLapjv，缓冲区逐帧复用
+// 每帧以上一帧的检测框作为轨迹，与当前帧的检测框做一次IoU关联。
+// 另外检查packed卡尔曼滤波与原cv::KalmanFilter实现的结果一致，
+// 以及bytetrack element批量模式与逐路跟踪的结果一致。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bytetrack.h"
+#include "bytetrack_association.h"
+#include "bytetrack_kalmanfilter.h"
+#include "bytetrack_lapjv.h"
+#include "common/object_metadata.h"
+
+namespace {
+
+std::atomic<std::uint64_t> gAllocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using sophon_stream::common::DetectedObjectMetadata;
+using sophon_stream::common::Frame;
+using sophon_stream::common::ObjectMetadata;
+using sophon_stream::element::bytetrack::Bytetrack;
+using sophon_stream::element::bytetrack::BytetrackContext;
+using sophon_stream::element::bytetrack::BYTETracker;
+using sophon_stream::element::bytetrack::iouDistanceMatrix;
+using sophon_stream::element::bytetrack::iouDistanceMatrixScalar;
+using sophon_stream::element::bytetrack::iouKernelBackend;
+using sophon_stream::element::bytetrack::KalmanBatch;
+using sophon_stream::element::bytetrack::KalmanFilter;
+using sophon_stream::element::bytetrack::KalmanState;
+using sophon_stream::element::bytetrack::lapjv_internal;
+using sophon_stream::element::bytetrack::SparseLapjv;
+using sophon_stream::element::bytetrack::TlbrBoxes;
+
+using Box = std::vector<float>;
+using Boxes = std::vector<Box>;
+
+struct BenchmarkConfig {
+  int frames = 500;
+  int objects = 200;
+  /**
+   * @brief MOT格式的检测结果文件，为空时生成随机运动的人群
+   */
+  std::string detFile;
+  float trackThresh = 0.5f;
+  float matchThresh = 0.7f;
+};
+
+/**
+ * @brief 读取MOT格式的det.txt：frame,id,x,y,w,h,score,...
+ */
+bool loadDetections(const BenchmarkConfig& config,
+                    std::vector<Boxes>& sequence) {
+  std::ifstream in(config.detFile);
+  if (!in) {
+    std::cerr << "failed to open " << config.detFile << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    int frame = 0, id = 0;
+    float x = 0, y = 0, w = 0, h = 0, score = 1;
+    if (!(fields >> frame >> id >> x >> y >> w >> h)) continue;
+    fields >> score;
+    if (frame <= 0 || frame > config.frames || score < config.trackThresh)
+      continue;
+    if (sequence.size() < static_cast<std::size_t>(frame))
+      sequence.resize(frame);
+    sequence[frame - 1].push_back({x, y, x + w, y + h});
+  }
+  return !sequence.empty();
+}
+
+/**
+ * @brief 1080p画面中随机游走的行人，带抖动和漏检
+ */
+void generateDetections(const BenchmarkConfig& config,
+                        std::vector<Boxes>& sequence, unsigned seed = 0) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::normal_distribution<float> jitter(0.f, 2.f);
+  struct Person {
+    float x, y, w, h, vx, vy;
+  };
+  std::vector<Person> people(config.objects);
+  for (auto& p : people) {
+    p.w = 30 + 40 * uniform(rng);
+    p.h = p.w * (2.2f + 0.6f * uniform(rng));
+    p.x = uniform(rng) * (1920 - p.w);
+    p.y = uniform(rng) * (1080 - p.h);
+    p.vx = 4 * (uniform(rng) - 0.5f);
+    p.vy = 2 * (uniform(rng) - 0.5f);
+  }
+  sequence.resize(config.frames);
+  for (auto& boxes : sequence) {
+    for (auto& p : people) {
+      p.x += p.vx;
+      p.y += p.vy;
+      if (p.x < 0 || p.x + p.w > 1920) p.vx = -p.vx;
+      if (p.y < 0 || p.y + p.h > 1080) p.vy = -p.vy;
+      if (uniform(rng) < 0.05f) continue;
+      float x = p.x + jitter(rng);
+      float y = p.y + jitter(rng);
+      boxes.push_back({x, y, x + p.w + jitter(rng), y + p.h + jitter(rng)});
+    }
+  }
+}
+
+void legacyIous(Boxes& atlbrs, Boxes& btlbrs,
+                std::vector<std::vector<float>>& results) {
+  if (atlbrs.size() * btlbrs.size() == 0) return;
+  results.resize(atlbrs.size());
+  for (int i = 0; i < results.size(); i++) results[i].resize(btlbrs.size());
+  for (int k = 0; k < btlbrs.size(); k++) {
+    float box_area =
+        (btlbrs[k][2] - btlbrs[k][0] + 1) * (btlbrs[k][3] - btlbrs[k][1] + 1);
+    for (int n = 0; n < atlbrs.size(); n++) {
+      float iw = std::min(atlbrs[n][2], btlbrs[k][2]) -
+                 std::max(atlbrs[n][0], btlbrs[k][0]) + 1;
+      results[n][k] = 0.0;
+      if (iw > 0) {
+        float ih = std::min(atlbrs[n][3], btlbrs[k][3]) -
+                   std::max(atlbrs[n][1], btlbrs[k][1]) + 1;
+        if (ih > 0) {
+          float ua = (atlbrs[n][2] - atlbrs[n][0] + 1) *
+                         (atlbrs[n][3] - atlbrs[n][1] + 1) +
+                     box_area - iw * ih;
+          results[n][k] = iw * ih / ua;
+        }
+      }
+    }
+  }
+}
+
+void legacyIouDistance(const Boxes& atracks, const Boxes& btracks,
+                       std::vector<std::vector<float>>& cost_matrix) {
+  if (atracks.size() * btracks.size() == 0) return;
+  Boxes atlbrs(atracks), btlbrs(btracks);
+  std::vector<std::vector<float>> _ious;
+  legacyIous(atlbrs, btlbrs, _ious);
+  for (int i = 0; i < _ious.size(); i++) {
+    std::vector<float> _iou;
+    for (int j = 0; j < _ious[i].size(); j++) _iou.push_back(1 - _ious[i][j]);
+    cost_matrix.push_back(_iou);
+  }
+}
+
+void legacyLinearAssignment(const std::vector<std::vector<float>>& cost,
+                            int rows, int cols, float thresh,
+                            std::vector<std::pair<int, int>>& matches,
+                            std::vector<int>& unmatched_a,
+                            std::vector<int>& unmatched_b) {
+  if (cost.empty()) {
+    for (int i = 0; i < rows; i++) unmatched_a.push_back(i);
+    for (int i = 0; i < cols; i++) unmatched_b.push_back(i);
+    return;
+  }
+  int n = rows + cols;
+  std::vector<std::vector<float>> extended(n, std::vector<float>(n));
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      if (i < rows && j < cols)
+        extended[i][j] = cost[i][j];
+      else if (i >= rows && j >= cols)
+        extended[i][j] = 0;
+      else
+        extended[i][j] = thresh / 2.0;
+    }
+  }
+  double** cost_ptr = new double*[n];
+  for (int i = 0; i < n; i++) {
+    cost_ptr[i] = new double[n];
+    for (int j = 0; j < n; j++) cost_ptr[i][j] = extended[i][j];
+  }
+  int* x_c = new int[n];
+  int* y_c = new int[n];
+  lapjv_internal(n, cost_ptr, x_c, y_c);
+  for (int i = 0; i < rows; i++) {
+    if (x_c[i] < cols)
+      matches.emplace_back(i, x_c[i]);
+    else
+      unmatched_a.push_back(i);
+  }
+  for (int j = 0; j < cols; j++) {
+    if (y_c[j] >= rows) unmatched_b.push_back(j);
+  }
+  for (int i = 0; i < n; i++) delete[] cost_ptr[i];
+  delete[] cost_ptr;
+  delete[] x_c;
+  delete[] y_c;
+}
+
+void packBoxes(const Boxes& boxes, TlbrBoxes& packed) {
+  packed.clear();
+  for (const Box& box : boxes) packed.push_back(box[0], box[1], box[2], box[3]);
+}
+
+/**
+ * @brief 匹配对的 sum(cost - thresh)，与扩展方阵上的目标函数只差一个常数
+ */
+double assignmentCost(const std::vector<float>& cost, int cols, float thresh,
+                      const std::vector<std::pair<int, int>>& matches) {
+  double total = 0;
+  for (const auto& match : matches)
+    total += cost[match.first * cols + match.second] - thresh;
+  return total;
+}
+
+bool checkCorrectness(const BenchmarkConfig& config,
+                      const std::vector<Boxes>& sequence) {
+  TlbrBoxes tracks, dets;
+  std::vector<float> simd, scalar;
+  SparseLapjv solver;
+  std::vector<std::pair<int, int>> matches, legacyMatches;
+  std::vector<int> ua, ub, legacyUa, legacyUb;
+  int ties = 0;
+  for (std::size_t f = 1; f < sequence.size(); ++f) {
+    const Boxes& a = sequence[f - 1];
+    const Boxes& b = sequence[f];
+    packBoxes(a, tracks);
+    packBoxes(b, dets);
+    iouDistanceMatrix(tracks, dets, simd);
+    iouDistanceMatrixScalar(tracks, dets, scalar);
+    std::vector<std::vector<float>> legacy;
+    legacyIouDistance(a, b, legacy);
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      for (std::size_t j = 0; j < b.size(); ++j) {
+        float expected = legacy[i][j];
+        if (std::fabs(simd[i * b.size() + j] - expected) > 1e-6f ||
+            std::fabs(scalar[i * b.size() + j] - expected) > 1e-6f) {
+          std::cerr << "iou mismatch at frame " << f << std::endl;
+          return false;
+        }
+      }
+    }
+
+    // 同时检查较小的门限，让连通分量更大
+    for (float thresh : {config.matchThresh, 0.5f, 0.9f}) {
+      solver.solve(simd.data(), a.size(), b.size(), thresh, matches, ua, ub);
+      legacyMatches.clear();
+      legacyUa.clear();
+      legacyUb.clear();
+      legacyLinearAssignment(legacy, a.size(), b.size(), thresh, legacyMatches,
+                             legacyUa, legacyUb);
+      if (matches == legacyMatches && ua == legacyUa && ub == legacyUb)
+        continue;
+      // 代价相同的多个最优解之间可以任选
+      double diff = assignmentCost(simd, b.size(), thresh, matches) -
+                    assignmentCost(simd, b.size(), thresh, legacyMatches);
+      if (std::fabs(diff) > 1e-4) {
+        std::cerr << "assignment mismatch at frame " << f << ", thresh "
+                  << thresh << ", cost diff " << diff << std::endl;
+        return false;
+      }
+      ++ties;
+    }
+  }
+  std::cout << "correctness: ok (" << ties
+            << " frames with equal-cost alternative assignments)" << std::endl;
+  return true;
+}
+
+/**
+ * @brief 原KalmanFilter中基于cv::KalmanFilter的predict/update，作为packed实现的参考
+ */
+class OpenCvKalmanFilter {
+ public:
+  OpenCvKalmanFilter() : mFilter(8, 4) {
+    mFilter.transitionMatrix = cv::Mat::eye(8, 8, CV_32F);
+    for (int i = 0; i < 4; ++i) mFilter.transitionMatrix.at<float>(i, i + 4) = 1;
+    mFilter.measurementMatrix = cv::Mat::eye(4, 8, CV_32F);
+  }
+
+  void predict(KalmanState& state) {
+    float std_pos = STD_WEIGHT_POSITION * state.mean[3] *
+                    STD_WEIGHT_POSITION * state.mean[3];
+    float std_vel = STD_WEIGHT_VELOCITY * state.mean[3] *
+                    STD_WEIGHT_VELOCITY * state.mean[3];
+    float noise[8] = {std_pos, std_pos, 1e-4f,   std_pos,
+                      std_vel, std_vel, 1e-10f, std_vel};
+    mFilter.processNoiseCov = cv::Mat::zeros(8, 8, CV_32F);
+    for (int i = 0; i < 8; ++i) mFilter.processNoiseCov.at<float>(i, i) = noise[i];
+    mFilter.statePost = cv::Mat(8, 1, CV_32F, state.mean).clone();
+    mFilter.errorCovPost = cv::Mat(8, 8, CV_32F, state.covariance).clone();
+    mFilter.predict();
+    store(state);
+  }
+
+  void update(KalmanState& state, const std::array<float, 4>& measurement) {
+    float std_pos = STD_WEIGHT_POSITION * state.mean[3] *
+                    STD_WEIGHT_POSITION * state.mean[3];
+    float noise[4] = {std_pos, std_pos, 1e-2f, std_pos};
+    mFilter.measurementNoiseCov = cv::Mat::zeros(4, 4, CV_32F);
+    for (int i = 0; i < 4; ++i)
+      mFilter.measurementNoiseCov.at<float>(i, i) = noise[i];
+    mFilter.statePre = cv::Mat(8, 1, CV_32F, state.mean).clone();
+    mFilter.errorCovPre = cv::Mat(8, 8, CV_32F, state.covariance).clone();
+    mFilter.correct(
+        cv::Mat(4, 1, CV_32F, const_cast<float*>(measurement.data())).clone());
+    store(state);
+  }
+
+ private:
+  static constexpr float STD_WEIGHT_POSITION = 1.f / 20;
+  static constexpr float STD_WEIGHT_VELOCITY = 1.f / 160;
+
+  void store(KalmanState& state) const {
+    for (int i = 0; i < 8; ++i) {
+      state.mean[i] = mFilter.statePost.at<float>(i, 0);
+      for (int j = 0; j < 8; ++j)
+        state.covariance[i * 8 + j] = mFilter.errorCovPost.at<float>(i, j);
+    }
+  }
+
+  cv::KalmanFilter mFilter;
+};
+
+/**
+ * @brief 两个状态之差，均值以标准差sqrt(P_ii)为单位，协方差以sqrt(P_ii * P_jj)为单位
+ */
+double kalmanStateDiff(const KalmanState& a, const KalmanState& b) {
+  double diff = 0;
+  for (int i = 0; i < 8; ++i) {
+    double sigmaI = std::sqrt(b.covariance[i * 8 + i]);
+    diff = std::max(diff, std::fabs(a.mean[i] - b.mean[i]) / sigmaI);
+    for (int j = 0; j < 8; ++j) {
+      double sigmaJ = std::sqrt(b.covariance[j * 8 + j]);
+      diff = std::max(diff, std::fabs(a.covariance[i * 8 + j] -
+                                      b.covariance[i * 8 + j]) /
+                                (sigmaI * sigmaJ));
+    }
+  }
+  return diff;
+}
+
+/**
+ * @brief 37条匀速运动的轨迹（不是8的整数倍，覆盖补齐的分组）跟踪100帧，
+ * 每帧统一预测，部分轨迹没有观测、不做校正，逐帧比较packed实现与cv::KalmanFilter
+ */
+bool checkKalman() {
+  constexpr int TRACKS = 37;
+  constexpr int FRAMES = 100;
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::normal_distribution<float> jitter(0.f, 1.f);
+
+  std::vector<std::array<float, 4>> targets(TRACKS), velocities(TRACKS);
+  for (int k = 0; k < TRACKS; ++k) {
+    float h = 60 + 120 * uniform(rng);
+    targets[k] = {1920 * uniform(rng), 1080 * uniform(rng),
+                  0.35f + 0.15f * uniform(rng), h};
+    velocities[k] = {4 * (uniform(rng) - 0.5f), 2 * (uniform(rng) - 0.5f), 0,
+                     0.2f * (uniform(rng) - 0.5f)};
+  }
+
+  KalmanFilter packed;
+  OpenCvKalmanFilter opencv;
+  std::vector<KalmanState> states(TRACKS), reference(TRACKS);
+  for (int k = 0; k < TRACKS; ++k) {
+    packed.initiate(targets[k].data(), states[k]);
+    reference[k] = states[k];
+  }
+
+  KalmanBatch batch;
+  double maxDiff = 0;
+  for (int f = 0; f < FRAMES; ++f) {
+    batch.clear();
+    for (int k = 0; k < TRACKS; ++k) {
+      batch.states.push_back(&states[k]);
+      opencv.predict(reference[k]);
+    }
+    packed.predict(batch);
+    for (int k = 0; k < TRACKS; ++k)
+      maxDiff = std::max(maxDiff, kalmanStateDiff(states[k], reference[k]));
+
+    batch.clear();
+    for (int k = 0; k < TRACKS; ++k) {
+      for (int i = 0; i < 4; ++i) targets[k][i] += velocities[k][i];
+      if ((f + k) % 5 == 0) continue;
+      std::array<float, 4> z = {targets[k][0] + jitter(rng),
+                                targets[k][1] + jitter(rng),
+                                targets[k][2] + 0.01f * jitter(rng),
+                                targets[k][3] + jitter(rng)};
+      batch.states.push_back(&states[k]);
+      batch.measurements.push_back(z);
+      opencv.update(reference[k], z);
+    }
+    packed.update(batch);
+    for (int k = 0; k < TRACKS; ++k)
+      maxDiff = std::max(maxDiff, kalmanStateDiff(states[k], reference[k]));
+  }
+
+  if (!(maxDiff < 1e-3)) {
+    std::cout << "kalman vs opencv: mismatch (max diff " << maxDiff
+              << " sigma)" << std::endl;
+    return false;
+  }
+  std::cout << "kalman vs opencv: ok (" << TRACKS << " tracks, " << FRAMES
+            << " frames, max diff " << maxDiff << " sigma)" << std::endl;
+  return true;
+}
+
+/**
+ * @brief 一帧的跟踪结果，每个元素为(track id, x, y, width, height)
+ */
+using TrackResult = std::vector<std::array<long long, 5>>;
+
+std::shared_ptr<ObjectMetadata> makeFrame(int channel, int frameId,
+                                          const Boxes& boxes,
+                                          const std::vector<float>& scores) {
+  auto obj = std::make_shared<ObjectMetadata>();
+  obj->mFrame = std::make_shared<Frame>();
+  obj->mFrame->mChannelId = channel;
+  obj->mFrame->mChannelIdInternal = channel;
+  obj->mFrame->mFrameId = frameId;
+  obj->mFrame->mWidth = 1920;
+  obj->mFrame->mHeight = 1080;
+  obj->mFrame->mSpData = std::make_shared<bm_image>();
+  obj->mFrame->mSpData->width = 1920;
+  obj->mFrame->mSpData->height = 1080;
+  for (std::size_t i = 0; i < boxes.size(); ++i) {
+    auto det = std::make_shared<DetectedObjectMetadata>();
+    det->mBox.mX = boxes[i][0];
+    det->mBox.mY = boxes[i][1];
+    det->mBox.mWidth = boxes[i][2] - boxes[i][0];
+    det->mBox.mHeight = boxes[i][3] - boxes[i][1];
+    det->mClassify = 0;
+    det->mScores.push_back(scores[i]);
+    obj->mDetectedObjectMetadatas.push_back(det);
+  }
+  return obj;
+}
+
+TrackResult trackResult(const ObjectMetadata& obj) {
+  TrackResult result;
+  for (std::size_t i = 0; i < obj.mTrackedObjectMetadatas.size(); ++i) {
+    const auto& box = obj.mDetectedObjectMetadatas[i]->mBox;
+    result.push_back({obj.mTrackedObjectMetadatas[i]->mTrackId, box.mX, box.mY,
+                      box.mWidth, box.mHeight});
+  }
+  return result;
+}
+
+/**
+ * @brief track id由全局计数器分配，与各路交替处理的顺序有关，
+ * 按每一路中第一次出现的顺序重新编号后再比较
+ */
+void renumberTrackIds(std::vector<TrackResult>& frames) {
+  std::map<long long, long long> ids;
+  for (auto& frame : frames) {
+    for (auto& track : frame) {
+      auto it = ids.emplace(track[0], ids.size()).first;
+      track[0] = it->second;
+    }
+  }
+}
+
+/**
+ * @brief 多路码流交替送入批量模式的bytetrack element，与每路单独调用BYTETracker::update的结果比较
+ */
+bool checkBatchReplay() {
+  constexpr int CHANNELS = 7;
+  constexpr int THREADS = 2;
+  constexpr int MAX_BATCH = 5;
+  BenchmarkConfig sequenceConfig;
+  sequenceConfig.frames = 120;
+  sequenceConfig.objects = 20;
+
+  std::vector<std::vector<Boxes>> sequences(CHANNELS);
+  std::vector<std::vector<std::vector<float>>> scores(CHANNELS);
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> score(0.2f, 1.f);
+  for (int c = 0; c < CHANNELS; ++c) {
+    generateDetections(sequenceConfig, sequences[c], c + 1);
+    for (const Boxes& boxes : sequences[c]) {
+      scores[c].emplace_back();
+      for (std::size_t i = 0; i < boxes.size(); ++i)
+        scores[c].back().push_back(score(rng));
+    }
+  }
+
+  // 与Bytetrack::initContext的默认值相同
+  auto context = std::make_shared<BytetrackContext>();
+  context->trackThresh = 0.5f;
+  context->highThresh = 0.6f;
+  context->matchThresh = 0.7f;
+  context->frameRate = 30;
+  context->trackBuffer = 30;
+  context->minBoxArea = 10;
+  context->correctBox = true;
+  context->agnostic = true;
+  context->batchMode = false;
+  context->maxBatch = MAX_BATCH;
+
+  std::vector<std::vector<TrackResult>> expected(CHANNELS);
+  for (int c = 0; c < CHANNELS; ++c) {
+    BYTETracker tracker(context);
+    for (int f = 0; f < sequenceConfig.frames; ++f) {
+      auto obj = makeFrame(c, f, sequences[c][f], scores[c][f]);
+      tracker.update(obj);
+      expected[c].push_back(trackResult(*obj));
+    }
+    renumberTrackIds(expected[c]);
+  }
+
+  Bytetrack element;
+  nlohmann::json configure = {
+      {"id", 0},
+      {"thread_number", THREADS},
+      {"configure", {{"batch_mode", true}, {"max_batch", MAX_BATCH}}}};
+  if (element.init(configure.dump()) !=
+      sophon_stream::common::ErrorCode::SUCCESS) {
+    std::cout << "batch vs per-channel: init failed" << std::endl;
+    return false;
+  }
+  element.addInputPort(0);
+  element.addOutputPort(0);
+  element.setSinkFlag(true);
+  std::mutex mutex;
+  std::vector<std::vector<TrackResult>> actual(
+      CHANNELS, std::vector<TrackResult>(sequenceConfig.frames));
+  std::atomic<int> received{0};
+  element.setSinkHandler(0, [&](std::shared_ptr<void> data) {
+    auto obj = std::static_pointer_cast<ObjectMetadata>(data);
+    std::lock_guard<std::mutex> lock(mutex);
+    actual[obj->mFrame->mChannelIdInternal][obj->mFrame->mFrameId] =
+        trackResult(*obj);
+    received.fetch_add(1);
+  });
+  element.start();
+  // 各路逐帧交替送入，每个dataPipe负责多路
+  for (int f = 0; f < sequenceConfig.frames; ++f) {
+    for (int c = 0; c < CHANNELS; ++c) {
+      element.pushInputData(0, c % THREADS,
+                            makeFrame(c, f, sequences[c][f], scores[c][f]));
+    }
+  }
+  int total = CHANNELS * sequenceConfig.frames;
+  for (int i = 0; i < 500 && received.load() < total; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  element.stop();
+  if (received.load() != total) {
+    std::cout << "batch vs per-channel: mismatch (received " << received.load()
+              << " of " << total << " frames)" << std::endl;
+    return false;
+  }
+
+  for (int c = 0; c < CHANNELS; ++c) {
+    renumberTrackIds(actual[c]);
+    for (int f = 0; f < sequenceConfig.frames; ++f) {
+      if (actual[c][f] != expected[c][f]) {
+        std::cout << "batch vs per-channel: mismatch at channel " << c
+                  << ", frame " << f << std::endl;
+        return false;
+      }
+    }
+  }
+  std::cout << "batch vs per-channel: ok (" << CHANNELS << " channels, "
+            << sequenceConfig.frames << " frames, " << THREADS
+            << " threads, max_batch " << MAX_BATCH << ")" << std::endl;
+  return true;
+}
+
+template <typename Func>
+void runBenchmark(const std::string& name, const std::vector<Boxes>& sequence,
+                  Func&& func) {
+  for (std::size_t f = 1; f < sequence.size() && f < 10; ++f)
+    func(sequence[f - 1], sequence[f]);
+  std::uint64_t allocationsBegin = gAllocations.load();
+  auto begin = std::chrono::steady_clock::now();
+  for (std::size_t f = 1; f < sequence.size(); ++f)
+    func(sequence[f - 1], sequence[f]);
+  auto end = std::chrono::steady_clock::now();
+  std::uint64_t allocations = gAllocations.load() - allocationsBegin;
+  double frames = sequence.size() - 1;
+  double seconds = std::chrono::duration<double>(end - begin).count();
+  std::cout << name << ": " << seconds * 1e6 / frames << " us/frame, "
+            << allocations / frames << " allocations/frame" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.frames = std::atoi(argv[1]);
+  if (argc > 2) config.objects = std::atoi(argv[2]);
+  if (argc > 3) config.detFile = argv[3];
+  if (config.frames <= 1 ||
+      (config.objects <= 0 && config.detFile.empty())) {
+    std::cerr << "usage: " << argv[0] << " [frames] [objects] [mot_det_file]"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<Boxes> sequence;
+  if (!config.detFile.empty()) {
+    if (!loadDetections(config, sequence)) return 1;
+  } else {
+    generateDetections(config, sequence);
+  }
+  std::size_t boxes = 0;
+  for (const auto& frame : sequence) boxes += frame.size();
+  std::cout << "frames: " << sequence.size()
+            << ", boxes/frame: " << boxes / sequence.size()
+            << ", iou backend: " << iouKernelBackend() << std::endl;
+  if (sequence.size() < 2) return 1;
+  if (!checkCorrectness(config, sequence) || !checkKalman() ||
+      !checkBatchReplay()) {
+    return 1;
+  }
+
+  float thresh = config.matchThresh;
+  std::vector<std::pair<int, int>> matches;
+  std::vector<int> ua, ub;
+  runBenchmark("legacy iou    ", sequence, [&](const Boxes& a, const Boxes& b) {
+    std::vector<std::vector<float>> cost;
+    legacyIouDistance(a, b, cost);
+  });
+  runBenchmark("legacy total  ", sequence, [&](const Boxes& a, const Boxes& b) {
+    std::vector<std::vector<float>> cost;
+    legacyIouDistance(a, b, cost);
+    matches.clear();
+    ua.clear();
+    ub.clear();
+    legacyLinearAssignment(cost, a.size(), b.size(), thresh, matches, ua, ub);
+  });
+
+  TlbrBoxes tracks, dets;
+  std::vector<float> cost;
+  SparseLapjv solver;
+  runBenchmark("scalar iou    ", sequence, [&](const Boxes& a, const Boxes& b) {
+    packBoxes(a, tracks);
+    packBoxes(b, dets);
+    iouDistanceMatrixScalar(tracks, dets, cost);
+  });
+  runBenchmark("simd iou      ", sequence, [&](const Boxes& a, const Boxes& b) {
+    packBoxes(a, tracks);
+    packBoxes(b, dets);
+    iouDistanceMatrix(tracks, dets, cost);
+  });
+  runBenchmark("sparse total  ", sequence, [&](const Boxes& a, const Boxes& b) {
+    packBoxes(a, tracks);
+    packBoxes(b, dets);
+    iouDistanceMatrix(tracks, dets, cost);
+    solver.solve(cost.data(), a.size(), b.size(), thresh, matches, ua, ub);
+  });
+  return 0;
+}
@@ -0,0 +1,235 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比DataPipe的两种取数据方式：
+// poll：原element的做法，popData()取不到数据时sleep 10ms再取，队列满时push每5ms重试一次
+// block：popData(timeout)/pushData(data, timeout)，在条件变量上等待，有数据时立即唤醒
+// 空闲测试中若干线程等待空队列，统计进程CPU占用和每秒唤醒次数；
+// 时延测试中数据按固定帧率经过多级DataPipe，统计每一级从push到被pop的p50/p99时延和端到端p99时延。
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "datapipe.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using sophon_stream::common::ErrorCode;
+using sophon_stream::framework::DataPipe;
+
+// 与Element::DATA_PIPE_WAIT_TIMEOUT一致
+constexpr std::chrono::milliseconds WAIT_TIMEOUT{200};
+constexpr std::chrono::milliseconds POLL_INTERVAL{10};
+constexpr std::chrono::milliseconds PUSH_RETRY_INTERVAL{5};
+
+enum class Mode { POLL, BLOCK };
+
+const char* modeName(Mode mode) { return mode == Mode::POLL ? "poll" : "block"; }
+
+struct BenchmarkConfig {
+  int idleThreads = 64;
+  int hops = 8;
+  int fps = 30;
+  double seconds = 3;
+};
+
+struct Item {
+  Clock::time_point sourceTime;
+  Clock::time_point hopTime;
+};
+
+/**
+ * @brief 按mode从pipe中取数据，running为false时返回nullptr
+ */
+std::shared_ptr<void> pop(Mode mode, DataPipe& pipe,
+                          const std::atomic<bool>& running,
+                          std::atomic<long>& wakeups) {
+  while (running.load(std::memory_order_relaxed)) {
+    wakeups.fetch_add(1, std::memory_order_relaxed);
+    if (mode == Mode::BLOCK) {
+      auto data = pipe.popData(WAIT_TIMEOUT);
+      if (data) return data;
+    } else {
+      auto data = pipe.popData();
+      if (data) return data;
+      std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+  }
+  return nullptr;
+}
+
+void push(Mode mode, DataPipe& pipe, std::shared_ptr<void> data,
+          const std::atomic<bool>& running) {
+  while (running.load(std::memory_order_relaxed)) {
+    if (mode == Mode::BLOCK) {
+      if (pipe.pushData(data, WAIT_TIMEOUT) == ErrorCode::SUCCESS) return;
+    } else {
+      if (pipe.pushData(data) == ErrorCode::SUCCESS) return;
+      std::this_thread::sleep_for(PUSH_RETRY_INTERVAL);
+    }
+  }
+}
+
+double cpuSeconds() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+struct IdleResult {
+  double cpuPercent = 0;
+  double wakeupsPerSecond = 0;
+};
+
+/**
+ * @brief idleThreads个线程等待各自的空队列
+ */
+IdleResult runIdle(Mode mode, const BenchmarkConfig& config) {
+  std::vector<std::unique_ptr<DataPipe>> pipes;
+  for (int i = 0; i < config.idleThreads; ++i)
+    pipes.push_back(std::make_unique<DataPipe>());
+  std::atomic<bool> running{true};
+  std::atomic<long> wakeups{0};
+  std::vector<std::thread> threads;
+  for (auto& pipe : pipes) {
+    threads.emplace_back([&, pipe = pipe.get()]() {
+      pop(mode, *pipe, running, wakeups);
+    });
+  }
+  // 等线程都进入等待后再开始统计
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  double cpuBegin = cpuSeconds();
+  long wakeupsBegin = wakeups.load();
+  auto begin = Clock::now();
+  std::this_thread::sleep_for(
+      std::chrono::duration<double>(config.seconds));
+  double wall = std::chrono::duration<double>(Clock::now() - begin).count();
+  IdleResult result;
+  result.cpuPercent = (cpuSeconds() - cpuBegin) / wall * 100;
+  result.wakeupsPerSecond = (wakeups.load() - wakeupsBegin) / wall;
+
+  running = false;
+  for (auto& pipe : pipes) pipe->wakeup();
+  for (auto& thread : threads) thread.join();
+  return result;
+}
+
+double percentile(std::vector<double>& values, double p) {
+  if (values.empty()) return 0;
+  std::size_t index = static_cast<std::size_t>(p * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+struct LatencyResult {
+  double hopP50 = 0;
+  double hopP99 = 0;
+  double endToEndP99 = 0;
+  int frames = 0;
+};
+
+/**
+ * @brief 数据按fps依次经过hops级DataPipe，每一级由一个线程取出后转发到下一级
+ */
+LatencyResult runLatency(Mode mode, const BenchmarkConfig& config) {
+  std::vector<std::unique_ptr<DataPipe>> pipes;
+  for (int i = 0; i < config.hops; ++i)
+    pipes.push_back(std::make_unique<DataPipe>());
+  std::atomic<bool> running{true};
+  std::atomic<long> wakeups{0};
+  std::atomic<int> received{0};
+  std::vector<std::vector<double>> hopLatencies(config.hops);
+  std::vector<double> endToEnd;
+  std::vector<std::thread> threads;
+  for (int hop = 0; hop < config.hops; ++hop) {
+    threads.emplace_back([&, hop]() {
+      while (auto data = pop(mode, *pipes[hop], running, wakeups)) {
+        auto item = std::static_pointer_cast<Item>(data);
+        auto now = Clock::now();
+        hopLatencies[hop].push_back(elapsedMs(item->hopTime, now));
+        if (hop + 1 == config.hops) {
+          // 最后一级只记录端到端时延
+          endToEnd.push_back(elapsedMs(item->sourceTime, now));
+          ++received;
+          continue;
+        }
+        item->hopTime = now;
+        push(mode, *pipes[hop + 1], item, running);
+      }
+    });
+  }
+
+  int total = static_cast<int>(config.fps * config.seconds);
+  auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / config.fps));
+  auto next = Clock::now();
+  for (int i = 0; i < total; ++i) {
+    std::this_thread::sleep_until(next);
+    next += interval;
+    auto item = std::make_shared<Item>();
+    item->sourceTime = item->hopTime = Clock::now();
+    push(mode, *pipes[0], item, running);
+  }
+  auto deadline = Clock::now() + std::chrono::seconds(1);
+  while (received.load() < total && Clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  running = false;
+  for (auto& pipe : pipes) pipe->wakeup();
+  for (auto& thread : threads) thread.join();
+
+  std::vector<double> hops;
+  for (auto& latencies : hopLatencies)
+    hops.insert(hops.end(), latencies.begin(), latencies.end());
+  LatencyResult result;
+  result.hopP50 = percentile(hops, 0.5);
+  result.hopP99 = percentile(hops, 0.99);
+  result.endToEndP99 = percentile(endToEnd, 0.99);
+  result.frames = static_cast<int>(endToEnd.size());
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // usage: datapipe_benchmark [idle_threads] [hops] [fps] [seconds]
+  BenchmarkConfig config;
+  if (argc > 1) config.idleThreads = std::max(1, std::atoi(argv[1]));
+  if (argc > 2) config.hops = std::max(1, std::atoi(argv[2]));
+  if (argc > 3) config.fps = std::max(1, std::atoi(argv[3]));
+  if (argc > 4) config.seconds = std::max(0.1, std::atof(argv[4]));
+
+  std::printf("idle threads: %d, hops: %d, fps: %d, seconds: %.1f\n",
+              config.idleThreads, config.hops, config.fps, config.seconds);
+  std::printf("%-6s %9s %10s %12s %12s %12s %7s\n", "mode", "idle cpu%",
+              "wakeups/s", "hop p50(ms)", "hop p99(ms)", "e2e p99(ms)",
+              "frames");
+  for (Mode mode : {Mode::POLL, Mode::BLOCK}) {
+    IdleResult idle = runIdle(mode, config);
+    LatencyResult latency = runLatency(mode, config);
+    std::printf("%-6s %9.2f %10.0f %12.3f %12.3f %12.3f %7d\n", modeName(mode),
+                idle.cpuPercent, idle.wakeupsPerSecond, latency.hopP50,
+                latency.hopP99, latency.endToEndP99, latency.frames);
+  }
+  return 0;
+}
@@ -0,0 +1,330 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 用HostMemoryAllocator代替设备内存，检查DeviceMemoryPool的正确性，
+// 并按algorithmApi/inference.h中batch推理的申请方式对比三种做法：
+// direct: 每个batch直接申请合并的输入、batch输出和每帧的输出，释放时直接归还
+// pool:   同样的申请经过DeviceMemoryPool
+// views:  经过DeviceMemoryPool，并且每帧的输出直接引用batch输出，不申请不复制
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "algorithmApi/device_memory_pool.h"
+
+namespace {
+
+using sophon_stream::element::DeviceMemoryAllocator;
+using sophon_stream::element::DeviceMemoryBlock;
+using sophon_stream::element::DeviceMemoryPool;
+using sophon_stream::element::DeviceMemoryPoolStats;
+using sophon_stream::element::HostMemoryAllocator;
+
+using Slab = std::shared_ptr<const DeviceMemoryBlock>;
+
+/**
+ * @brief 在HostMemoryAllocator上加固定的申请和释放耗时，模拟设备内存的申请开销，
+ * 并统计峰值占用
+ */
+class SimulatedDeviceAllocator : public DeviceMemoryAllocator {
+ public:
+  explicit SimulatedDeviceAllocator(int latencyUs) : mLatencyUs(latencyUs) {}
+
+  DeviceMemoryBlock allocate(std::size_t size) override {
+    wait();
+    DeviceMemoryBlock block = mHost.allocate(size);
+    std::size_t live = mHost.getLiveBytes();
+    std::size_t peak = mPeakBytes.load();
+    while (live > peak && !mPeakBytes.compare_exchange_weak(peak, live)) {
+    }
+    return block;
+  }
+
+  void free(const DeviceMemoryBlock& block) override {
+    wait();
+    mHost.free(block);
+  }
+
+  const HostMemoryAllocator& host() const { return mHost; }
+  std::size_t getPeakBytes() const { return mPeakBytes; }
+
+ private:
+  void wait() {
+    if (mLatencyUs <= 0) return;
+    auto end = std::chrono::steady_clock::now() +
+               std::chrono::microseconds(mLatencyUs);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+  }
+
+  const int mLatencyUs;
+  HostMemoryAllocator mHost;
+  std::atomic<std::size_t> mPeakBytes{0};
+};
+
+/**
+ * @brief 不经过pool时也用引用计数的块，释放时直接归还
+ */
+Slab acquireDirect(const std::shared_ptr<DeviceMemoryAllocator>& allocator,
+                   std::size_t size) {
+  DeviceMemoryBlock block = allocator->allocate(size);
+  if (!block.address) return nullptr;
+  return Slab(new DeviceMemoryBlock(block),
+              [allocator](const DeviceMemoryBlock* p) {
+                allocator->free(*p);
+                delete p;
+              });
+}
+
+bool failed(const char* what) {
+  std::printf("check %s: FAILED\n", what);
+  return false;
+}
+
+/**
+ * @brief 多线程随机申请和释放，检查使用中的块互不重叠、内容不被改写，
+ * 统计值与下层allocator一致，trim后内存全部归还
+ */
+bool checkPool(int threads) {
+  auto host = std::make_shared<HostMemoryAllocator>();
+  const std::size_t maxCached = 8 << 20;
+  bool ok = true;
+  {
+    auto pool = std::make_shared<DeviceMemoryPool>(host, maxCached);
+    std::mutex mutex;
+    // 使用中的块，key为起始地址，value为结束地址
+    std::map<std::uint64_t, std::uint64_t> live;
+    std::atomic<bool> overlap{false}, corrupted{false}, oversize{false};
+
+    auto worker = [&](int id) {
+      std::mt19937 rng(id);
+      std::uniform_int_distribution<std::size_t> sizeDist(1, 3 << 20);
+      std::deque<std::pair<Slab, std::size_t>> held;
+      for (int i = 0; i < 3000; ++i) {
+        std::size_t size = sizeDist(rng) >> (rng() % 8);
+        Slab slab = pool->acquire(size);
+        if (!slab || slab->size < size) {
+          oversize = true;
+          continue;
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          auto next = live.lower_bound(slab->address);
+          if ((next != live.end() && next->first < slab->address + size) ||
+              (next != live.begin() &&
+               std::prev(next)->second > slab->address))
+            overlap = true;
+          live[slab->address] = slab->address + size;
+        }
+        std::memset(reinterpret_cast<void*>(slab->address), id + 1, size);
+        held.emplace_back(std::move(slab), size);
+        while (held.size() > 8 || (!held.empty() && rng() % 3 == 0)) {
+          std::size_t index = rng() % held.size();
+          auto& entry = held[index];
+          const unsigned char* data =
+              reinterpret_cast<const unsigned char*>(entry.first->address);
+          if (data[0] != id + 1 || data[entry.second - 1] != id + 1)
+            corrupted = true;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            live.erase(entry.first->address);
+          }
+          held.erase(held.begin() + index);
+        }
+      }
+      for (auto& entry : held) {
+        std::lock_guard<std::mutex> lock(mutex);
+        live.erase(entry.first->address);
+      }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) workers.emplace_back(worker, t);
+    for (auto& thread : workers) thread.join();
+
+    DeviceMemoryPoolStats stats = pool->getStats();
+    if (overlap) ok = failed("live blocks do not overlap");
+    if (corrupted) ok = failed("block contents intact");
+    if (oversize) ok = failed("block size >= request");
+    if (stats.inUseBytes != 0 || stats.requestedBytes != 0)
+      ok = failed("nothing in use after release");
+    if (stats.cachedBytes > maxCached) ok = failed("cache limit");
+    if (stats.upstreamAllocations != host->getAllocations() ||
+        stats.upstreamFrees != host->getFrees())
+      ok = failed("upstream counters");
+    if (stats.cachedBytes != host->getLiveBytes())
+      ok = failed("cached bytes match upstream live bytes");
+    std::printf(
+        "pool check: %llu acquires, %.1f%% hits, %llu upstream allocations\n",
+        static_cast<unsigned long long>(stats.hits + stats.misses),
+        100.0 * stats.hits / std::max<std::uint64_t>(stats.hits + stats.misses, 1),
+        static_cast<unsigned long long>(stats.upstreamAllocations));
+    pool->trim();
+  }
+  // pool析构后所有块都应归还
+  if (host->getLiveBytes() != 0 ||
+      host->getAllocations() != host->getFrees())
+    ok = failed("all memory returned after trim");
+
+  // 取整浪费不超过25%
+  for (std::size_t size = 1; size < (64 << 20); size = size * 9 / 8 + 1) {
+    std::size_t rounded = DeviceMemoryPool::roundSize(size);
+    if (rounded < size ||
+        (size > DeviceMemoryPool::MIN_BLOCK_SIZE && rounded > size * 5 / 4)) {
+      ok = failed("size class waste <= 25%");
+      break;
+    }
+  }
+  std::printf("pool check: %s\n", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+struct WorkloadConfig {
+  int threads = 2;
+  int batches = 500;
+  int batch = 4;
+  /**
+   * @brief 后处理尚未释放的batch数，这些batch的每帧输出仍被引用
+   */
+  int inFlight = 4;
+  int allocUs = 0;
+  /**
+   * @brief yolov5s 640x640 fp32：合并的输入和三个检测头的batch输出，单位字节
+   */
+  std::size_t inputBytes = 4ull * 3 * 640 * 640 * 4;
+  std::vector<std::size_t> outputBytes = {4ull * 3 * 80 * 80 * 85 * 4,
+                                          4ull * 3 * 40 * 40 * 85 * 4,
+                                          4ull * 3 * 20 * 20 * 85 * 4};
+};
+
+struct WorkloadResult {
+  double msPerBatch = 0;
+  std::uint64_t upstreamAllocations = 0;
+  std::size_t peakBytes = 0;
+  double wastePercent = 0;
+};
+
+/**
+ * @brief 每个线程模拟一个推理线程：申请合并的输入和batch输出，把batch输出
+ * 拆给每帧（复制或引用），输入在推理后释放，每帧的输出在inFlight个batch之后
+ * 按随机顺序释放
+ */
+WorkloadResult runWorkload(const WorkloadConfig& config,
+                           const std::string& mode) {
+  auto device = std::make_shared<SimulatedDeviceAllocator>(config.allocUs);
+  std::shared_ptr<DeviceMemoryPool> pool;
+  if (mode != "direct")
+    pool = std::make_shared<DeviceMemoryPool>(device, std::size_t(1) << 30);
+  bool views = mode == "views";
+  auto acquire = [&](std::size_t size) {
+    return pool ? pool->acquire(size) : acquireDirect(device, size);
+  };
+
+  std::atomic<std::size_t> wasteSamples{0};
+  std::atomic<std::uint64_t> wastePermille{0};
+  auto worker = [&](int id) {
+    std::mt19937 rng(id);
+    std::deque<std::vector<std::shared_ptr<void>>> pending;
+    for (int b = 0; b < config.batches; ++b) {
+      Slab input = acquire(config.inputBytes);
+      std::vector<Slab> outputs;
+      for (std::size_t bytes : config.outputBytes)
+        outputs.push_back(acquire(bytes));
+      input.reset();
+
+      // splitOutputMemIntoObjectMetadatas
+      std::vector<std::shared_ptr<void>> frames;
+      for (int f = 0; f < config.batch; ++f) {
+        if (views) {
+          auto batchOutputs = std::make_shared<std::vector<Slab>>(outputs);
+          frames.push_back(batchOutputs);
+          continue;
+        }
+        auto frameOutputs = std::make_shared<std::vector<Slab>>();
+        for (std::size_t j = 0; j < outputs.size(); ++j) {
+          std::size_t bytes = config.outputBytes[j] / config.batch;
+          Slab slab = acquire(bytes);
+          std::memcpy(reinterpret_cast<void*>(slab->address),
+                      reinterpret_cast<const char*>(outputs[j]->address) +
+                          f * bytes,
+                      bytes);
+          frameOutputs->push_back(std::move(slab));
+        }
+        frames.push_back(frameOutputs);
+      }
+      outputs.clear();
+      std::shuffle(frames.begin(), frames.end(), rng);
+      pending.push_back(std::move(frames));
+      if (pending.size() > static_cast<std::size_t>(config.inFlight))
+        pending.pop_front();
+      if (pool && b % 50 == 0) {
+        DeviceMemoryPoolStats stats = pool->getStats();
+        if (stats.inUseBytes > 0) {
+          ++wasteSamples;
+          wastePermille += 1000 * (stats.inUseBytes - stats.requestedBytes) /
+                           stats.inUseBytes;
+        }
+      }
+    }
+  };
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < config.threads; ++t) workers.emplace_back(worker, t);
+  for (auto& thread : workers) thread.join();
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count();
+
+  WorkloadResult result;
+  result.msPerBatch = ms / (config.threads * config.batches);
+  result.upstreamAllocations = device->host().getAllocations();
+  result.peakBytes = device->getPeakBytes();
+  if (wasteSamples > 0)
+    result.wastePercent = wastePermille / 10.0 / wasteSamples;
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  WorkloadConfig config;
+  if (argc > 1) config.threads = std::atoi(argv[1]);
+  if (argc > 2) config.batches = std::atoi(argv[2]);
+  if (argc > 3) config.inFlight = std::atoi(argv[3]);
+  if (argc > 4) config.allocUs = std::atoi(argv[4]);
+
+  if (!checkPool(std::max(config.threads, 2))) return 1;
+
+  std::printf(
+      "threads: %d, batches: %d, batch: %d, in flight: %d, alloc: %d us\n",
+      config.threads, config.batches, config.batch, config.inFlight,
+      config.allocUs);
+  for (const char* mode : {"direct", "pool", "views"}) {
+    WorkloadResult result = runWorkload(config, mode);
+    std::printf(
+        "%-6s: %7.3f ms/batch, upstream allocations: %7llu, peak: %6.1f MB, "
+        "waste: %4.1f%%\n",
+        mode, result.msPerBatch,
+        static_cast<unsigned long long>(result.upstreamAllocations),
+        result.peakBytes / 1048576.0, result.wastePercent);
+  }
+  return 0;
+}
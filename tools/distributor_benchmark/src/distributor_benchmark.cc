@@ -0,0 +1,414 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比distributor element两种分发实现的耗时，并逐帧检查分发结果一致：
+// legacy: 原实现，规则按{间隔: {类名: 端口}}保存，每个检测框按类名查表，
+//         每个目标每个端口各crop一次
+// compiled: distributor_rules.h + crop_batch.h，规则在初始化时编译为类别id到端口的位图，
+//           一帧的所有crop合并为一次批量调用，同一目标发往多个端口时共用crop结果
+// crop用CPU上的图像代替bm_image，不依赖硬件
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "crop_batch.h"
+#include "distributor_rules.h"
+
+namespace {
+
+using sophon_stream::element::distributor::CropBatch;
+using sophon_stream::element::distributor::DistribRules;
+using sophon_stream::element::distributor::RouteSelection;
+using Clock = std::chrono::steady_clock;
+
+constexpr int IMAGE_WIDTH = 1920;
+constexpr int IMAGE_HEIGHT = 1080;
+constexpr int CLASS_NUM = 80;
+constexpr int MAX_CROP_BATCH = 256;
+constexpr float FPS = 25.f;
+
+/**
+ * @brief 代替bm_image的CPU图像，BGR packed
+ */
+struct CpuImage {
+  int width = 0;
+  int height = 0;
+  std::vector<std::uint8_t> data;
+};
+
+using CpuCropBatch = CropBatch<CpuImage>;
+
+/**
+ * @brief 代替bmcv_image_crop，记录调用次数
+ */
+struct CpuCropper {
+  int calls = 0;
+
+  bool operator()(const CpuImage& input,
+                  const std::vector<CpuCropBatch::Rect>& rects,
+                  std::vector<std::shared_ptr<CpuImage>>& outputs) {
+    ++calls;
+    for (const auto& rect : rects) {
+      if (rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0 ||
+          rect.x + rect.width > input.width ||
+          rect.y + rect.height > input.height)
+        return false;
+    }
+    for (const auto& rect : rects) {
+      auto output = std::make_shared<CpuImage>();
+      output->width = rect.width;
+      output->height = rect.height;
+      output->data.resize(static_cast<size_t>(rect.width) * rect.height * 3);
+      for (int row = 0; row < rect.height; ++row) {
+        const std::uint8_t* src =
+            input.data.data() +
+            (static_cast<size_t>(rect.y + row) * input.width + rect.x) * 3;
+        std::copy(src, src + rect.width * 3,
+                  output->data.data() + static_cast<size_t>(row) * rect.width * 3);
+      }
+      outputs.push_back(output);
+    }
+    return true;
+  }
+};
+
+struct Box {
+  int classId;
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct Frame {
+  int channel;
+  std::int64_t frameId;
+  float time;
+  bool eos;
+  std::vector<Box> boxes;
+};
+
+/**
+ * @brief 一次分发：目标下标，端口和crop结果，整图分发的目标下标为-1
+ */
+struct Dispatch {
+  int index;
+  int port;
+  std::shared_ptr<CpuImage> image;
+};
+
+/**
+ * @brief 计时结束后用于比较的分发结果：{目标下标，端口，crop结果的校验和}
+ */
+using DispatchKey = std::tuple<int, int, std::uint64_t>;
+
+std::uint64_t checksum(const CpuImage* image) {
+  if (image == nullptr) return 0;
+  std::uint64_t sum = 1469598103934665603ull;
+  for (std::uint8_t v : image->data) sum = (sum ^ v) * 1099511628211ull;
+  return sum ^ (static_cast<std::uint64_t>(image->width) << 32) ^ image->height;
+}
+
+/**
+ * @brief 原distributor.cc中的规则解析和doWork中的分发逻辑
+ */
+namespace legacy {
+
+class Distributor {
+ public:
+  void init(const nlohmann::json& rules,
+            const std::vector<std::string>& classNames) {
+    mClassNames = classNames;
+    for (auto& rule : rules) {
+      auto routes = rule.find("routes");
+      auto time_interval_it = rule.find("time_interval");
+      if (time_interval_it != rule.end() && time_interval_it->is_number()) {
+        float time_interval = time_interval_it->get<float>();
+        mTimeIntervals.push_back(time_interval);
+        addRoutes(*routes, mTimeDistribRules[time_interval]);
+      }
+      auto frame_interval_it = rule.find("frame_interval");
+      if (frame_interval_it != rule.end() &&
+          frame_interval_it->is_number_integer()) {
+        int frame_interval = frame_interval_it->get<int>();
+        mFrameIntervals.push_back(frame_interval);
+        addRoutes(*routes, mFrameDistribRules[frame_interval]);
+      }
+      if (time_interval_it == rule.end() && frame_interval_it == rule.end()) {
+        mFrameIntervals.push_back(1);
+        addRoutes(*routes, mFrameDistribRules[1]);
+      }
+    }
+    std::sort(mTimeIntervals.begin(), mTimeIntervals.end());
+    mTimeIntervals.erase(
+        std::unique(mTimeIntervals.begin(), mTimeIntervals.end()),
+        mTimeIntervals.end());
+    std::sort(mFrameIntervals.begin(), mFrameIntervals.end());
+    mFrameIntervals.erase(
+        std::unique(mFrameIntervals.begin(), mFrameIntervals.end()),
+        mFrameIntervals.end());
+  }
+
+  void doWork(const Frame& frame, const CpuImage& image, CpuCropper& cropper,
+              std::vector<Dispatch>& dispatches) {
+    if (mChannelLastTimes.find(frame.channel) == mChannelLastTimes.end()) {
+      mChannelLastTimes[frame.channel] =
+          std::vector<float>(mTimeIntervals.size(), -99.0);
+    }
+    float cur_time = frame.time;
+    std::unordered_map<std::string, std::unordered_set<int>> class2ports;
+    for (size_t i = 0; i < mChannelLastTimes[frame.channel].size(); ++i) {
+      if (cur_time - mChannelLastTimes[frame.channel][i] > mTimeIntervals[i] ||
+          frame.eos) {
+        mChannelLastTimes[frame.channel][i] = cur_time;
+        for (auto& class_port : mTimeDistribRules[mTimeIntervals[i]])
+          class2ports[class_port.first].insert(class_port.second);
+      }
+    }
+    for (size_t i = 0; i < mFrameIntervals.size(); ++i) {
+      if (frame.frameId % mFrameIntervals[i] == 0 || frame.eos) {
+        for (auto& class_port : mFrameDistribRules[mFrameIntervals[i]])
+          class2ports[class_port.first].insert(class_port.second);
+      }
+    }
+    if (class2ports.empty()) return;
+
+    for (size_t i = 0; i < frame.boxes.size(); ++i) {
+      const Box& box = frame.boxes[i];
+      std::string class_name = mClassNames[box.classId];
+      if (class2ports.find(class_name) != class2ports.end()) {
+        for (int target_port : class2ports[class_name]) {
+          std::vector<std::shared_ptr<CpuImage>> outputs;
+          cropper(image, {{box.x, box.y, box.width, box.height}}, outputs);
+          dispatches.push_back({static_cast<int>(i), target_port, outputs[0]});
+        }
+      }
+    }
+    if (class2ports.find("full_frame") != class2ports.end()) {
+      for (int target_port : class2ports["full_frame"])
+        dispatches.push_back({-1, target_port, nullptr});
+    }
+  }
+
+ private:
+  static void addRoutes(const nlohmann::json& routes,
+                        std::unordered_map<std::string, int>& rules) {
+    for (auto& route : routes) {
+      int port_id = route["port"].get<int>();
+      auto class_names = route["classes"].get<std::vector<std::string>>();
+      if (class_names.empty()) rules["full_frame"] = port_id;
+      for (auto& class_name : class_names) rules[class_name] = port_id;
+    }
+  }
+
+  std::vector<std::string> mClassNames;
+  std::unordered_map<float, std::unordered_map<std::string, int>>
+      mTimeDistribRules;
+  std::unordered_map<int, std::unordered_map<std::string, int>>
+      mFrameDistribRules;
+  std::vector<float> mTimeIntervals;
+  std::vector<int> mFrameIntervals;
+  std::unordered_map<int, std::vector<float>> mChannelLastTimes;
+};
+
+}  // namespace legacy
+
+/**
+ * @brief 新的分发逻辑，与Distributor::doWork中检测框和整图的部分一致
+ */
+void compiledWork(DistribRules& rules, const Frame& frame,
+                  const CpuImage& image, CpuCropper& cropper,
+                  std::vector<Dispatch>& dispatches) {
+  RouteSelection selection;
+  rules.select(frame.channel, frame.frameId, frame.time, frame.eos, selection);
+  if (!selection.hasRoutes) return;
+
+  CpuCropBatch cropBatch(MAX_CROP_BATCH);
+  std::vector<int> cropIndexs(frame.boxes.size(), -1);
+  for (size_t i = 0; i < frame.boxes.size(); ++i) {
+    const Box& box = frame.boxes[i];
+    if (selection.getPorts(box.classId) == 0) continue;
+    cropIndexs[i] = cropBatch.add(box.x, box.y, box.width, box.height);
+  }
+  if (!cropBatch.empty()) cropBatch.run(image, std::ref(cropper));
+
+  for (size_t i = 0; i < frame.boxes.size(); ++i) {
+    if (cropIndexs[i] < 0) continue;
+    const auto& cropped = cropBatch.get(cropIndexs[i]);
+    std::uint64_t ports = selection.getPorts(frame.boxes[i].classId);
+    while (ports) {
+      dispatches.push_back(
+          {static_cast<int>(i), __builtin_ctzll(ports), cropped});
+      ports &= ports - 1;
+    }
+  }
+  std::uint64_t ports = selection.fullFramePorts;
+  while (ports) {
+    dispatches.push_back({-1, __builtin_ctzll(ports), nullptr});
+    ports &= ports - 1;
+  }
+}
+
+struct BenchmarkConfig {
+  int frames = 500;
+  int channels = 4;
+  int objects = 100;
+};
+
+std::vector<std::string> makeClassNames() {
+  std::vector<std::string> classNames = {"person", "bicycle", "car",
+                                         "motorbike", "aeroplane", "bus",
+                                         "train", "truck"};
+  while (static_cast<int>(classNames.size()) < CLASS_NUM)
+    classNames.push_back("class_" + std::to_string(classNames.size()));
+  return classNames;
+}
+
+/**
+ * @brief 时间间隔、帧间隔和每帧分发三类规则，包括整图分发、一个类别发往多个端口、
+ * 同一间隔下同名类别重复配置、不在类别文件中的类名
+ */
+nlohmann::json makeRules() {
+  return nlohmann::json::parse(R"([
+    {"time_interval": 1,
+     "routes": [{"classes": ["person", "car"], "port": 0},
+                {"classes": [], "port": 1}]},
+    {"time_interval": 0.5,
+     "routes": [{"classes": ["bus", "truck", "class_20"], "port": 5}]},
+    {"frame_interval": 3,
+     "routes": [{"classes": ["car", "bus", "truck"], "port": 2},
+                {"classes": ["person", "not_a_class"], "port": 3}]},
+    {"frame_interval": 3,
+     "routes": [{"classes": ["bus"], "port": 6}]},
+    {"routes": [{"classes": ["person", "bicycle", "class_10", "class_11",
+                             "class_12"], "port": 4}]}
+  ])");
+}
+
+std::vector<Frame> makeFrames(const BenchmarkConfig& config,
+                              std::mt19937& rng) {
+  std::vector<Frame> frames;
+  for (int f = 0; f < config.frames; ++f) {
+    for (int c = 0; c < config.channels; ++c) {
+      Frame frame;
+      frame.channel = c;
+      frame.frameId = f;
+      frame.time = f / FPS;
+      frame.eos = f == config.frames - 1;
+      for (int i = 0; i < config.objects; ++i) {
+        Box box;
+        // 一半目标集中在前几个类别
+        box.classId = rng() % 2 ? rng() % 8 : rng() % CLASS_NUM;
+        box.width = 16 + rng() % 200;
+        box.height = 16 + rng() % 200;
+        box.x = rng() % (IMAGE_WIDTH - box.width);
+        box.y = rng() % (IMAGE_HEIGHT - box.height);
+        frame.boxes.push_back(box);
+      }
+      frames.push_back(std::move(frame));
+    }
+  }
+  return frames;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.frames = std::atoi(argv[1]);
+  if (argc > 2) config.channels = std::atoi(argv[2]);
+  if (argc > 3) config.objects = std::atoi(argv[3]);
+  if (config.frames <= 0 || config.channels <= 0 || config.objects <= 0) {
+    std::cerr << "usage: " << argv[0] << " [frames] [channels] [objects]"
+              << std::endl;
+    return 1;
+  }
+
+  std::mt19937 rng(2024);
+  CpuImage image;
+  image.width = IMAGE_WIDTH;
+  image.height = IMAGE_HEIGHT;
+  image.data.resize(static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT * 3);
+  for (auto& v : image.data) v = static_cast<std::uint8_t>(rng());
+  auto frames = makeFrames(config, rng);
+  auto classNames = makeClassNames();
+  nlohmann::json rules = makeRules();
+
+  legacy::Distributor legacyDistributor;
+  legacyDistributor.init(rules, classNames);
+  DistribRules compiledRules;
+  std::string error;
+  if (compiledRules.compile(rules, classNames, error) !=
+      sophon_stream::common::ErrorCode::SUCCESS) {
+    std::cerr << "compile rules fail: " << error << std::endl;
+    return 1;
+  }
+
+  // 原实现的端口顺序取决于unordered_set，排序后比较
+  auto toKeys = [](const std::vector<Dispatch>& dispatches) {
+    std::vector<DispatchKey> keys;
+    for (const auto& dispatch : dispatches)
+      keys.emplace_back(dispatch.index, dispatch.port,
+                        checksum(dispatch.image.get()));
+    std::sort(keys.begin(), keys.end());
+    return keys;
+  };
+
+  // 逐帧计时并比较，crop结果在比较后释放
+  CpuCropper legacyCropper, compiledCropper;
+  double legacySeconds = 0, compiledSeconds = 0;
+  size_t dispatchNumber = 0;
+  std::vector<Dispatch> legacyResult, compiledResult;
+  for (const Frame& frame : frames) {
+    legacyResult.clear();
+    compiledResult.clear();
+    auto legacyBegin = Clock::now();
+    legacyDistributor.doWork(frame, image, legacyCropper, legacyResult);
+    auto compiledBegin = Clock::now();
+    compiledWork(compiledRules, frame, image, compiledCropper, compiledResult);
+    auto compiledEnd = Clock::now();
+    legacySeconds +=
+        std::chrono::duration<double>(compiledBegin - legacyBegin).count();
+    compiledSeconds +=
+        std::chrono::duration<double>(compiledEnd - compiledBegin).count();
+
+    if (toKeys(legacyResult) != toKeys(compiledResult)) {
+      std::cerr << "result mismatch at channel " << frame.channel
+                << ", frame " << frame.frameId << std::endl;
+      return 1;
+    }
+    dispatchNumber += legacyResult.size();
+  }
+
+  std::cout << "frames: " << config.frames
+            << ", channels: " << config.channels
+            << ", objects per frame: " << config.objects << std::endl;
+  std::cout << "correctness: ok ("
+            << static_cast<double>(dispatchNumber) / frames.size()
+            << " dispatches/frame)" << std::endl;
+  std::cout << "legacy  : " << legacySeconds * 1e6 / frames.size()
+            << " us/frame, " << legacyCropper.calls << " crop calls"
+            << std::endl;
+  std::cout << "compiled: " << compiledSeconds * 1e6 / frames.size()
+            << " us/frame, " << compiledCropper.calls << " crop calls"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,453 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比faiss element的底库加载和CPU检索：
+// load:   原实现的std::stringstream逐行解析 / FaceGallery::loadText / mmap二进制
+// search: 逐个查询的标量暴力检索（原实现每个人脸一次查询） / 批量FlatIndex / IvfIndex
+// update: 通过FaceIndex::add/remove增删底库后检索结果的正确性
+// convert模式把文本底库转换为二进制底库。
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "face_gallery.h"
+#include "face_index.h"
+
+namespace {
+
+using sophon_stream::element::faiss::FaceGallery;
+using sophon_stream::element::faiss::FaceIndex;
+using sophon_stream::element::faiss::FlatIndex;
+using sophon_stream::element::faiss::getInnerProductKernelName;
+using sophon_stream::element::faiss::IvfIndex;
+using sophon_stream::element::faiss::IvfIndexConfig;
+
+constexpr int TOP_K = 5;
+
+struct BenchmarkConfig {
+  int gallerySize = 100000;
+  int dims = 512;
+  int queries = 2048;
+  int batch = 32;
+  int nlist = 0;
+  int nprobe = 8;
+  int textRows = 10000;
+  std::string dir = "/tmp/faiss_benchmark";
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+void normalize(float* v, int dims) {
+  double norm = 0;
+  for (int i = 0; i < dims; ++i) norm += static_cast<double>(v[i]) * v[i];
+  float scale = static_cast<float>(1.0 / std::sqrt(norm));
+  for (int i = 0; i < dims; ++i) v[i] *= scale;
+}
+
+/**
+ * @brief 模拟人脸特征：每个身份一个中心，底库中每人约10张，特征为中心加噪声后归一化
+ */
+std::vector<float> synthesizeGallery(const BenchmarkConfig& config,
+                                     std::mt19937& rng) {
+  int identities = std::max(1, config.gallerySize / 10);
+  std::normal_distribution<float> normal(0.f, 1.f);
+  std::vector<float> centers(static_cast<std::size_t>(identities) *
+                             config.dims);
+  for (auto& v : centers) v = normal(rng);
+  for (int i = 0; i < identities; ++i)
+    normalize(centers.data() + static_cast<std::size_t>(i) * config.dims,
+              config.dims);
+  std::vector<float> gallery(static_cast<std::size_t>(config.gallerySize) *
+                             config.dims);
+  std::uniform_int_distribution<int> pick(0, identities - 1);
+  const float noise = 0.6f / std::sqrt(static_cast<float>(config.dims));
+  for (int i = 0; i < config.gallerySize; ++i) {
+    const float* c =
+        centers.data() + static_cast<std::size_t>(pick(rng)) * config.dims;
+    float* v = gallery.data() + static_cast<std::size_t>(i) * config.dims;
+    for (int d = 0; d < config.dims; ++d) v[d] = c[d] + noise * normal(rng);
+    normalize(v, config.dims);
+  }
+  return gallery;
+}
+
+std::vector<float> synthesizeQueries(const BenchmarkConfig& config,
+                                     const std::vector<float>& gallery,
+                                     std::mt19937& rng) {
+  std::normal_distribution<float> normal(0.f, 1.f);
+  std::uniform_int_distribution<int> pick(0, config.gallerySize - 1);
+  const float noise = 0.4f / std::sqrt(static_cast<float>(config.dims));
+  std::vector<float> queries(static_cast<std::size_t>(config.queries) *
+                             config.dims);
+  for (int i = 0; i < config.queries; ++i) {
+    const float* g =
+        gallery.data() + static_cast<std::size_t>(pick(rng)) * config.dims;
+    float* q = queries.data() + static_cast<std::size_t>(i) * config.dims;
+    for (int d = 0; d < config.dims; ++d) q[d] = g[d] + noise * normal(rng);
+    normalize(q, config.dims);
+  }
+  return queries;
+}
+
+/**
+ * @brief 原实现每个人脸单独检索一次，这里用标量内积和partial_sort模拟
+ */
+void searchLegacy(const std::vector<float>& gallery, int rows, int dims,
+                  const float* query, std::vector<std::pair<float, int>>& buf,
+                  float* scores, int* ids) {
+  buf.resize(rows);
+  for (int r = 0; r < rows; ++r) {
+    const float* x = gallery.data() + static_cast<std::size_t>(r) * dims;
+    float s = 0.f;
+    for (int d = 0; d < dims; ++d) s += query[d] * x[d];
+    buf[r] = {s, r};
+  }
+  int k = std::min(TOP_K, rows);
+  std::partial_sort(buf.begin(), buf.begin() + k, buf.end(),
+                    [](const std::pair<float, int>& a,
+                       const std::pair<float, int>& b) {
+                      return a.first > b.first;
+                    });
+  for (int j = 0; j < k; ++j) {
+    scores[j] = buf[j].first;
+    ids[j] = buf[j].second;
+  }
+}
+
+/**
+ * @brief 原实现的文本解析
+ */
+int loadLegacyText(const std::string& path, std::vector<float>& db) {
+  std::ifstream file(path);
+  std::string line;
+  int rows = 0;
+  while (std::getline(file, line)) {
+    std::stringstream ss(line);
+    float val;
+    while (ss >> val) db.push_back(val);
+    ++rows;
+  }
+  return rows;
+}
+
+void writeText(const std::string& dbPath, const std::string& labelPath,
+               const std::vector<float>& gallery, int rows, int dims) {
+  FILE* db = std::fopen(dbPath.c_str(), "w");
+  FILE* labels = std::fopen(labelPath.c_str(), "w");
+  for (int r = 0; r < rows; ++r) {
+    for (int d = 0; d < dims; ++d)
+      std::fprintf(db, d == 0 ? "%.8e" : " %.8e",
+                   gallery[static_cast<std::size_t>(r) * dims + d]);
+    std::fprintf(db, "\n");
+    std::fprintf(labels, "person_%d\n", r / 10);
+  }
+  std::fclose(db);
+  std::fclose(labels);
+}
+
+bool runLoad(const BenchmarkConfig& config, const std::vector<float>& gallery) {
+  int rows = std::min(config.textRows, config.gallerySize);
+  std::string dbPath = config.dir + "/db.txt";
+  std::string labelPath = config.dir + "/label.name";
+  std::string binPath = config.dir + "/gallery.bin";
+  writeText(dbPath, labelPath, gallery, rows, config.dims);
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<float> legacy;
+  int legacyRows = loadLegacyText(dbPath, legacy);
+  double legacyMs = elapsedMs(begin);
+
+  begin = std::chrono::steady_clock::now();
+  FaceGallery text;
+  if (text.load(dbPath, labelPath) !=
+      sophon_stream::common::ErrorCode::SUCCESS)
+    return false;
+  double textMs = elapsedMs(begin);
+  if (legacyRows != rows || static_cast<int>(text.getCount()) != rows ||
+      !std::equal(legacy.begin(), legacy.end(), text.getVectors())) {
+    std::cerr << "load: text gallery differs from legacy parser" << std::endl;
+    return false;
+  }
+
+  std::vector<float> vectors(gallery.begin(),
+                             gallery.begin() +
+                                 static_cast<std::size_t>(rows) * config.dims);
+  if (FaceGallery::saveBinary(binPath, config.dims, text.getIds(), vectors,
+                              text.getLabels()) !=
+      sophon_stream::common::ErrorCode::SUCCESS)
+    return false;
+  begin = std::chrono::steady_clock::now();
+  FaceGallery binary;
+  if (binary.load(binPath, "") != sophon_stream::common::ErrorCode::SUCCESS)
+    return false;
+  FlatIndex index(binary.getDims());
+  index.build(binary.getIds().data(), binary.getVectors(), rows);
+  double binaryMs = elapsedMs(begin);
+  if (!binary.isMapped() || binary.getLabels() != text.getLabels() ||
+      !std::equal(vectors.begin(), vectors.end(), binary.getVectors())) {
+    std::cerr << "load: binary gallery differs from text gallery" << std::endl;
+    return false;
+  }
+  std::cout << "load " << rows << " x " << config.dims
+            << ": legacy stringstream " << legacyMs << " ms, strtof "
+            << textMs << " ms, binary mmap + build " << binaryMs << " ms"
+            << std::endl;
+  std::remove(dbPath.c_str());
+  std::remove(labelPath.c_str());
+  std::remove(binPath.c_str());
+  return true;
+}
+
+struct SearchResult {
+  std::vector<float> scores;
+  std::vector<int> ids;
+};
+
+SearchResult runBatched(const FaceIndex& index, const BenchmarkConfig& config,
+                        const std::vector<float>& queries, double& qps) {
+  SearchResult result;
+  result.scores.resize(static_cast<std::size_t>(config.queries) * TOP_K);
+  result.ids.resize(result.scores.size());
+  auto begin = std::chrono::steady_clock::now();
+  for (int q = 0; q < config.queries; q += config.batch) {
+    int n = std::min(config.batch, config.queries - q);
+    index.search(queries.data() + static_cast<std::size_t>(q) * config.dims, n,
+                 TOP_K, result.scores.data() + static_cast<std::size_t>(q) * TOP_K,
+                 result.ids.data() + static_cast<std::size_t>(q) * TOP_K);
+  }
+  qps = config.queries / (elapsedMs(begin) / 1000.0);
+  return result;
+}
+
+double recallAt1(const SearchResult& exact, const SearchResult& result) {
+  int hit = 0;
+  int total = static_cast<int>(exact.ids.size() / TOP_K);
+  for (int q = 0; q < total; ++q)
+    if (exact.ids[q * TOP_K] == result.ids[q * TOP_K]) ++hit;
+  return static_cast<double>(hit) / total;
+}
+
+bool runSearch(const BenchmarkConfig& config, const std::vector<float>& gallery,
+               const std::vector<float>& queries) {
+  std::vector<int> ids(config.gallerySize);
+  std::iota(ids.begin(), ids.end(), 0);
+
+  // 原实现：每个查询单独扫描底库
+  SearchResult exact;
+  exact.scores.resize(static_cast<std::size_t>(config.queries) * TOP_K);
+  exact.ids.resize(exact.scores.size());
+  std::vector<std::pair<float, int>> buf;
+  auto begin = std::chrono::steady_clock::now();
+  for (int q = 0; q < config.queries; ++q)
+    searchLegacy(gallery, config.gallerySize, config.dims,
+                 queries.data() + static_cast<std::size_t>(q) * config.dims,
+                 buf, exact.scores.data() + q * TOP_K,
+                 exact.ids.data() + q * TOP_K);
+  double legacyQps = config.queries / (elapsedMs(begin) / 1000.0);
+
+  FlatIndex flat(config.dims);
+  flat.build(ids.data(), gallery.data(), config.gallerySize);
+  double flatQps = 0;
+  SearchResult flatResult = runBatched(flat, config, queries, flatQps);
+  for (std::size_t i = 0; i < exact.ids.size(); ++i) {
+    if (std::fabs(exact.scores[i] - flatResult.scores[i]) > 1e-4f) {
+      std::cerr << "search: flat score " << flatResult.scores[i]
+                << " differs from legacy " << exact.scores[i] << " at " << i
+                << std::endl;
+      return false;
+    }
+  }
+
+  IvfIndexConfig ivfConfig;
+  ivfConfig.nlist = config.nlist;
+  ivfConfig.nprobe = config.nprobe;
+  IvfIndex ivf(config.dims, ivfConfig);
+  begin = std::chrono::steady_clock::now();
+  ivf.build(ids.data(), gallery.data(), config.gallerySize);
+  double trainMs = elapsedMs(begin);
+  double ivfQps = 0;
+  SearchResult ivfResult = runBatched(ivf, config, queries, ivfQps);
+
+  std::cout << "search " << config.queries << " queries, gallery "
+            << config.gallerySize << " x " << config.dims << ", batch "
+            << config.batch << ", top " << TOP_K << std::endl;
+  std::cout << "legacy per query: " << legacyQps << " queries/s" << std::endl;
+  std::cout << "cpu_flat        : " << flatQps << " queries/s, recall@1 "
+            << recallAt1(exact, flatResult) << std::endl;
+  std::cout << "cpu_ivf         : " << ivfQps << " queries/s, recall@1 "
+            << recallAt1(exact, ivfResult) << ", nlist " << ivf.getListNumber()
+            << ", nprobe " << config.nprobe << ", train " << trainMs << " ms"
+            << std::endl;
+  return true;
+}
+
+/**
+ * @brief 增删后检索：删除的id不再出现，新增的向量能被自己检索到
+ */
+bool checkUpdate(FaceIndex& index, const BenchmarkConfig& config,
+                 const std::vector<float>& gallery, std::mt19937& rng) {
+  int initial = config.gallerySize / 2;
+  std::vector<int> ids(config.gallerySize);
+  std::iota(ids.begin(), ids.end(), 0);
+  index.build(ids.data(), gallery.data(), initial);
+
+  const int step = std::max(1, config.gallerySize / 20);
+  std::unordered_set<int> removed;
+  auto begin = std::chrono::steady_clock::now();
+  int operations = 0;
+  for (int next = initial; next < config.gallerySize; next += step) {
+    int n = std::min(step, config.gallerySize - next);
+    index.add(ids.data() + next, gallery.data() +
+                                     static_cast<std::size_t>(next) * config.dims,
+              n);
+    std::vector<int> toRemove;
+    std::uniform_int_distribution<int> pick(0, next + n - 1);
+    for (int i = 0; i < n / 2; ++i) {
+      int id = pick(rng);
+      if (removed.insert(id).second) toRemove.push_back(id);
+    }
+    if (index.remove(toRemove.data(), toRemove.size()) !=
+        static_cast<int>(toRemove.size())) {
+      std::cerr << "update: " << index.getName()
+                << " did not remove all ids" << std::endl;
+      return false;
+    }
+    operations += n + toRemove.size();
+  }
+  double updateMs = elapsedMs(begin);
+  if (index.size() != config.gallerySize - removed.size()) {
+    std::cerr << "update: " << index.getName() << " size " << index.size()
+              << ", expect " << config.gallerySize - removed.size()
+              << std::endl;
+    return false;
+  }
+
+  // 用底库自身的向量查询，未删除的应检索到自己，删除的不应出现
+  const int checks = 512;
+  std::vector<float> scores(TOP_K);
+  std::vector<int> result(TOP_K);
+  int selfHit = 0;
+  int present = 0;
+  for (int i = 0; i < checks; ++i) {
+    int id = (i * 7919) % config.gallerySize;
+    index.search(gallery.data() + static_cast<std::size_t>(id) * config.dims,
+                 1, TOP_K, scores.data(), result.data());
+    for (int r : result) {
+      if (removed.count(r) != 0) {
+        std::cerr << "update: " << index.getName() << " returned removed id "
+                  << r << std::endl;
+        return false;
+      }
+    }
+    if (removed.count(id) == 0) {
+      ++present;
+      if (result[0] == id) ++selfHit;
+    }
+  }
+  std::vector<int> exportIds;
+  std::vector<float> exportVectors;
+  index.exportTo(exportIds, exportVectors);
+  for (std::size_t i = 0; i < exportIds.size(); ++i) {
+    if (!std::equal(exportVectors.begin() + i * config.dims,
+                    exportVectors.begin() + (i + 1) * config.dims,
+                    gallery.begin() + static_cast<std::size_t>(exportIds[i]) *
+                                          config.dims)) {
+      std::cerr << "update: " << index.getName() << " exported wrong vector"
+                << std::endl;
+      return false;
+    }
+  }
+  std::cout << "update " << index.getName() << ": " << operations
+            << " adds/removes in " << updateMs << " ms, size " << index.size()
+            << ", self hit " << selfHit << "/" << present << std::endl;
+  return true;
+}
+
+int convert(int argc, char* argv[]) {
+  if (argc != 5) {
+    std::cerr << "usage: " << argv[0] << " convert <db.txt> <label.name> <out>"
+              << std::endl;
+    return 1;
+  }
+  FaceGallery gallery;
+  if (gallery.loadText(argv[2], argv[3]) !=
+      sophon_stream::common::ErrorCode::SUCCESS)
+    return 1;
+  std::vector<float> vectors(
+      gallery.getVectors(),
+      gallery.getVectors() + gallery.getCount() * gallery.getDims());
+  if (FaceGallery::saveBinary(argv[4], gallery.getDims(), gallery.getIds(),
+                              vectors, gallery.getLabels()) !=
+      sophon_stream::common::ErrorCode::SUCCESS)
+    return 1;
+  std::cout << "convert " << gallery.getCount() << " x " << gallery.getDims()
+            << " to " << argv[4] << std::endl;
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "convert") return convert(argc, argv);
+
+  BenchmarkConfig config;
+  if (argc > 1) config.gallerySize = std::atoi(argv[1]);
+  if (argc > 2) config.dims = std::atoi(argv[2]);
+  if (argc > 3) config.batch = std::atoi(argv[3]);
+  if (argc > 4) config.nlist = std::atoi(argv[4]);
+  if (argc > 5) config.nprobe = std::atoi(argv[5]);
+  if (argc > 6) config.dir = argv[6];
+  if (config.gallerySize <= 0 || config.dims <= 0 || config.batch <= 0 ||
+      config.nprobe <= 0) {
+    std::cerr << "usage: " << argv[0]
+              << " [gallery_size] [dims] [batch] [nlist] [nprobe] [dir]\n"
+              << "       " << argv[0] << " convert <db.txt> <label.name> <out>"
+              << std::endl;
+    return 1;
+  }
+  std::string mkdir = "mkdir -p " + config.dir;
+  if (std::system(mkdir.c_str()) != 0) return 1;
+
+  std::cout << "inner product kernel: " << getInnerProductKernelName()
+            << std::endl;
+  std::mt19937 rng(1);
+  std::vector<float> gallery = synthesizeGallery(config, rng);
+  std::vector<float> queries = synthesizeQueries(config, gallery, rng);
+
+  if (!runLoad(config, gallery)) return 1;
+  if (!runSearch(config, gallery, queries)) return 1;
+
+  FlatIndex flat(config.dims);
+  IvfIndexConfig ivfConfig;
+  ivfConfig.nlist = config.nlist;
+  ivfConfig.nprobe = config.nprobe;
+  IvfIndex ivf(config.dims, ivfConfig);
+  if (!checkUpdate(flat, config, gallery, rng)) return 1;
+  if (!checkUpdate(ivf, config, gallery, rng)) return 1;
+  rmdir(config.dir.c_str());
+  return 0;
+}
@@ -0,0 +1,541 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比filter element两种规则实现的耗时，并逐帧检查结果一致：
+// legacy: 原Filter_Imp，每帧对每个检测框逐角点、逐边判断所有多边形，
+//         追踪计数以字符串形式的track id为key放在unordered_map中
+// compiled: filter_rules.h，规则在初始化时编译为类别位图、带网格的多边形和有序的整数计数
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "filter_rules.h"
+
+namespace {
+
+namespace common = sophon_stream::common;
+using sophon_stream::element::filter::ChannelRules;
+using sophon_stream::element::filter::RuleSet;
+using Clock = std::chrono::steady_clock;
+
+constexpr int IMAGE_WIDTH = 1920;
+constexpr int IMAGE_HEIGHT = 1080;
+constexpr int CLASS_NUM = 80;
+
+/**
+ * @brief 原filter.cc中的Filter_Imp，判断逻辑保持原样
+ */
+namespace legacy {
+
+class Filter_Imp {
+ public:
+  bool isInPolygon(std::shared_ptr<common::ObjectMetadata> objectMetadata);
+  bool isinclasses(std::shared_ptr<common::ObjectMetadata> objectMetadata);
+  bool isOutsideWorkingHours(
+      std::shared_ptr<common::ObjectMetadata> objectMetadata);
+  bool istrack(std::shared_ptr<common::ObjectMetadata> objectMetadata,
+               std::unordered_map<std::string, int>& continue_frame_num_);
+
+  std::vector<int> classes;
+  int alert_first_frames;
+  int alert_frame_skip_nums;
+  std::vector<std::pair<int64_t, int64_t>> times;
+  std::vector<std::vector<common::Point<int>>> areas;
+  int type;
+
+ private:
+  bool onSegment(const common::Point<int>& p, const common::Point<int>& q,
+                 const common::Point<int>& r);
+  int orientation(const common::Point<int>& p, const common::Point<int>& q,
+                  const common::Point<int>& r);
+  bool doIntersect(const common::Point<int>& p1, const common::Point<int>& q1,
+                   const common::Point<int>& p2, const common::Point<int>& q2);
+  bool isPointInsidePolygon(const common::Point<int>& p,
+                            const std::vector<common::Point<int>>& polygon);
+  bool isRectangleInsidePolygon(std::vector<common::Point<int>>& rectangle,
+                                const std::vector<common::Point<int>>& polygon);
+  void keep(std::shared_ptr<common::ObjectMetadata> objectMetadata,
+            const std::vector<bool>& flags);
+};
+
+void Filter_Imp::keep(std::shared_ptr<common::ObjectMetadata> objectMetadata,
+                      const std::vector<bool>& flags) {
+  std::vector<std::shared_ptr<common::DetectedObjectMetadata>> detected;
+  std::vector<std::shared_ptr<common::ObjectMetadata>> sub;
+  std::vector<std::shared_ptr<common::TrackedObjectMetadata>> tracked;
+  for (size_t j = 0; j < flags.size(); j++) {
+    if (!flags[j]) continue;
+    detected.push_back(objectMetadata->mDetectedObjectMetadatas[j]);
+    if (type == 0) {
+      sub.push_back(objectMetadata->mSubObjectMetadatas[j]);
+    } else if (type == 1) {
+      tracked.push_back(objectMetadata->mTrackedObjectMetadatas[j]);
+    }
+  }
+  objectMetadata->mDetectedObjectMetadatas = detected;
+  if (type == 0) {
+    objectMetadata->mSubObjectMetadatas = sub;
+  } else if (type == 1) {
+    objectMetadata->mTrackedObjectMetadatas = tracked;
+  }
+}
+
+bool Filter_Imp::isOutsideWorkingHours(
+    std::shared_ptr<common::ObjectMetadata> objectMetadata) {
+  for (size_t i = 0; i < times.size(); i++) {
+    std::int64_t timestamp =
+        objectMetadata->mFrame->mTimestamp % ((1000 * 60 * 60 * 24));
+    if (timestamp <= times[i].second && timestamp >= times[i].first)
+      return true;
+  }
+  return false;
+}
+
+bool Filter_Imp::isinclasses(
+    std::shared_ptr<common::ObjectMetadata> objectMetadata) {
+  bool flag_tot = false;
+  std::vector<bool> flags;
+  for (size_t j = 0; j < objectMetadata->mDetectedObjectMetadatas.size(); j++) {
+    bool flag = false;
+    for (size_t i = 0; i < classes.size(); i++) {
+      int name = objectMetadata->mDetectedObjectMetadatas[j]->mClassify;
+      flag |= name == classes[i];
+      if (flag) break;
+    }
+    flags.push_back(flag);
+    flag_tot |= flag;
+  }
+  keep(objectMetadata, flags);
+  return flag_tot;
+}
+
+bool Filter_Imp::isInPolygon(
+    std::shared_ptr<common::ObjectMetadata> objectMetadata) {
+  bool flag_tot = false;
+  std::vector<bool> flags;
+  for (size_t j = 0; j < objectMetadata->mDetectedObjectMetadatas.size(); j++) {
+    bool flag = false;
+    int top = objectMetadata->mDetectedObjectMetadatas[j]->mBox.top();
+    int bottom = objectMetadata->mDetectedObjectMetadatas[j]->mBox.bottom();
+    int left = objectMetadata->mDetectedObjectMetadatas[j]->mBox.left();
+    int right = objectMetadata->mDetectedObjectMetadatas[j]->mBox.right();
+    std::vector<common::Point<int>> rectangle = {
+        common::Point<int>(top, left), common::Point<int>(top, right),
+        common::Point<int>(bottom, right), common::Point<int>(bottom, left)};
+    for (size_t i = 0; i < areas.size(); ++i) {
+      flag |= isRectangleInsidePolygon(rectangle, areas[i]);
+      if (flag) {
+        objectMetadata->areas.push_back(areas[i]);
+        break;
+      }
+    }
+    flags.push_back(flag);
+    flag_tot |= flag;
+  }
+  keep(objectMetadata, flags);
+  return flag_tot;
+}
+
+bool Filter_Imp::istrack(
+    std::shared_ptr<common::ObjectMetadata> objectMetadata,
+    std::unordered_map<std::string, int>& continue_frame_num_) {
+  if (type != 1 && type != 0) return true;
+  std::unordered_map<std::string, int> up_list;
+  for (auto i : continue_frame_num_) {
+    if (i.second > alert_first_frames) {
+      if (((i.second - alert_first_frames - 1) % alert_frame_skip_nums) == 0) {
+        up_list[i.first] = 1;
+      }
+    }
+  }
+  if (up_list.size() == 0) return false;
+  if (objectMetadata->mDetectedObjectMetadatas.size()) {
+    std::vector<bool> flags;
+    for (size_t i = 0; i < objectMetadata->mDetectedObjectMetadatas.size();
+         i++) {
+      std::string name;
+      if (type == 0) {
+        name = objectMetadata->mSubObjectMetadatas[i]
+                   ->mRecognizedObjectMetadatas[0]
+                   ->mLabelName;
+      } else if (type == 1) {
+        name = std::to_string(
+            objectMetadata->mTrackedObjectMetadatas[i]->mTrackId);
+      }
+      flags.push_back(up_list.find(name) != up_list.end());
+    }
+    keep(objectMetadata, flags);
+  }
+  return up_list.size() > 0;
+}
+
+bool Filter_Imp::onSegment(const common::Point<int>& p,
+                           const common::Point<int>& q,
+                           const common::Point<int>& r) {
+  return q.mX <= std::max(p.mX, r.mX) && q.mX >= std::min(p.mX, r.mX) &&
+         q.mY <= std::max(p.mY, r.mY) && q.mY >= std::min(p.mY, r.mY);
+}
+
+int Filter_Imp::orientation(const common::Point<int>& p,
+                            const common::Point<int>& q,
+                            const common::Point<int>& r) {
+  double val =
+      1.0 * (q.mY - p.mY) * (r.mX - q.mX) - 1.0 * (q.mX - p.mX) * (r.mY - q.mY);
+  if (val == 0) return 0;
+  return (val > 0) ? 1 : 2;
+}
+
+bool Filter_Imp::doIntersect(const common::Point<int>& p1,
+                             const common::Point<int>& q1,
+                             const common::Point<int>& p2,
+                             const common::Point<int>& q2) {
+  int o1 = orientation(p1, q1, p2);
+  int o2 = orientation(p1, q1, q2);
+  int o3 = orientation(p2, q2, p1);
+  int o4 = orientation(p2, q2, q1);
+  if (o1 != o2 && o3 != o4) return true;
+  if (o1 == 0 && onSegment(p1, p2, q1)) return true;
+  if (o2 == 0 && onSegment(p1, q2, q1)) return true;
+  if (o3 == 0 && onSegment(p2, p1, q2)) return true;
+  if (o4 == 0 && onSegment(p2, q1, q2)) return true;
+  return false;
+}
+
+bool Filter_Imp::isPointInsidePolygon(
+    const common::Point<int>& p,
+    const std::vector<common::Point<int>>& polygon) {
+  int n = polygon.size();
+  if (n < 3) return true;
+  common::Point<int> extreme = {std::numeric_limits<int>::max(), p.mY};
+  int count = 0, i = 0;
+  do {
+    int next = (i + 1) % n;
+    if (doIntersect(polygon[i], polygon[next], p, extreme)) {
+      if (orientation(polygon[i], p, polygon[next]) == 0)
+        return onSegment(polygon[i], p, polygon[next]);
+      count++;
+    }
+    i = next;
+  } while (i != 0);
+  return count & 1;
+}
+
+bool Filter_Imp::isRectangleInsidePolygon(
+    std::vector<common::Point<int>>& rectangle,
+    const std::vector<common::Point<int>>& polygon) {
+  if (polygon.size() == 0) return true;
+  bool flag = true;
+  if (polygon.size() < 3) {
+    for (const common::Point<int>& corner : polygon) {
+      if (isPointInsidePolygon(corner, rectangle)) return true;
+    }
+    for (size_t i = 0; i < rectangle.size() && flag; ++i) {
+      int nextRectIndex = (i + 1) % rectangle.size();
+      for (size_t j = 0; j < polygon.size(); ++j) {
+        int nextPolyIndex = (j + 1) % polygon.size();
+        if (doIntersect(rectangle[i], rectangle[nextRectIndex], polygon[j],
+                        polygon[nextPolyIndex]))
+          return true;
+      }
+    }
+    return false;
+  }
+  for (const common::Point<int>& corner : rectangle) {
+    flag &= isPointInsidePolygon(corner, polygon);
+    if (!flag) break;
+  }
+  for (size_t i = 0; i < rectangle.size() && flag; ++i) {
+    int nextRectIndex = (i + 1) % rectangle.size();
+    for (size_t j = 0; j < polygon.size(); ++j) {
+      int nextPolyIndex = (j + 1) % polygon.size();
+      flag &= (!doIntersect(rectangle[i], rectangle[nextRectIndex],
+                            polygon[j], polygon[nextPolyIndex]));
+      if (!flag) break;
+    }
+  }
+  return flag;
+}
+
+/**
+ * @brief 原Filter::doWork中对一路码流执行全部筛选器的部分
+ */
+int apply(std::vector<Filter_Imp>& filters,
+          std::unordered_map<std::string, int>& continue_frame_num,
+          std::shared_ptr<common::ObjectMetadata> objectMetadata) {
+  int tag = 0;
+  for (size_t i = 0; i < filters.size(); i++) {
+    bool flag = true;
+    if (objectMetadata->mDetectedObjectMetadatas.size())
+      flag &= filters[i].isOutsideWorkingHours(objectMetadata);
+    if (!flag) continue;
+    flag &= filters[i].isinclasses(objectMetadata);
+    if (!flag) continue;
+    flag &= filters[i].isInPolygon(objectMetadata);
+    if (!flag) continue;
+
+    std::unordered_map<std::string, int> names;
+    for (auto& sub : objectMetadata->mSubObjectMetadatas) {
+      if (sub->mRecognizedObjectMetadatas.size() == 1) {
+        std::string name = sub->mRecognizedObjectMetadatas[0]->mLabelName;
+        continue_frame_num[name]++;
+        names[name] = continue_frame_num[name];
+      }
+    }
+    for (auto& tracked : objectMetadata->mTrackedObjectMetadatas) {
+      std::string name = std::to_string(tracked->mTrackId);
+      continue_frame_num[name]++;
+      names[name] = continue_frame_num[name];
+    }
+    continue_frame_num.clear();
+    for (auto j : names) continue_frame_num[j.first] = j.second;
+
+    flag &= filters[i].istrack(objectMetadata, continue_frame_num);
+    if (!flag) continue;
+    tag |= 1 << i;
+  }
+  return tag;
+}
+
+}  // namespace legacy
+
+struct BenchmarkConfig {
+  int frames = 200;
+  int polygons = 50;
+  int objects = 300;
+};
+
+/**
+ * @brief 随机生成星形多边形，顶点坐标取奇数，检测框坐标取偶数，
+ * 避免原实现在射线穿过顶点时重复计数造成的误判，使两种实现的结果可以逐帧比较
+ */
+nlohmann::json makePolygon(std::mt19937& rng) {
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  int vertexNumber = 4 + rng() % 5;
+  float centerTop = 100 + unit(rng) * (IMAGE_HEIGHT - 200);
+  float centerLeft = 100 + unit(rng) * (IMAGE_WIDTH - 200);
+  float radius = 80 + unit(rng) * 220;
+  std::vector<float> angles;
+  for (int i = 0; i < vertexNumber; ++i) angles.push_back(unit(rng) * 6.2832f);
+  std::sort(angles.begin(), angles.end());
+  nlohmann::json polygon = nlohmann::json::array();
+  for (float angle : angles) {
+    float r = radius * (0.6f + 0.4f * unit(rng));
+    // 顶点限制在画面内，原实现射线的终点为INT_MAX，负坐标会使差值溢出
+    int top = static_cast<int>(centerTop + r * std::sin(angle));
+    int left = static_cast<int>(centerLeft + r * std::cos(angle));
+    top = std::min(std::max(top, 1), IMAGE_HEIGHT - 3) | 1;
+    left = std::min(std::max(left, 1), IMAGE_WIDTH - 3) | 1;
+    polygon.push_back({{"top", top}, {"left", left}});
+  }
+  return polygon;
+}
+
+nlohmann::json makeRules(const BenchmarkConfig& config, std::mt19937& rng) {
+  // 筛选器0：类别0~39的追踪目标，首次出现2帧后每3帧上报一次
+  // 筛选器1：只按类别和区域筛选
+  nlohmann::json filters = nlohmann::json::array();
+  for (int f = 0; f < 2; ++f) {
+    nlohmann::json filter;
+    filter["alert_first_frame"] = 2;
+    filter["alert_frame_skip_nums"] = 3;
+    filter["areas"] = nlohmann::json::array();
+    for (int i = 0; i < config.polygons; ++i)
+      filter["areas"].push_back(makePolygon(rng));
+    filter["classes"] = nlohmann::json::array();
+    for (int c = 0; c < (f == 0 ? 40 : CLASS_NUM); c += (f == 0 ? 1 : 2))
+      filter["classes"].push_back(c);
+    filter["times"] = {{{"time_start", "00 00 00"}, {"time_end", "23 59 59"}}};
+    filter["type"] = f == 0 ? 1 : 2;
+    filters.push_back(filter);
+  }
+  return nlohmann::json::array({{{"channel_id", 0}, {"filters", filters}}});
+}
+
+std::vector<legacy::Filter_Imp> makeLegacyFilters(const nlohmann::json& rules) {
+  std::vector<legacy::Filter_Imp> filters;
+  for (auto& rule : rules[0]["filters"]) {
+    legacy::Filter_Imp filter;
+    filter.alert_first_frames = rule["alert_first_frame"];
+    filter.alert_frame_skip_nums = rule["alert_frame_skip_nums"];
+    for (auto& polygon : rule["areas"]) {
+      std::vector<common::Point<int>> points;
+      for (auto& point : polygon) points.emplace_back(point["top"], point["left"]);
+      filter.areas.push_back(points);
+    }
+    for (auto& cls : rule["classes"]) filter.classes.push_back(cls);
+    filter.times.emplace_back(0, 86399000);
+    filter.type = rule["type"];
+    filters.push_back(filter);
+  }
+  return filters;
+}
+
+struct FrameObject {
+  int top, left, height, width;
+  int classify;
+  long long trackId;
+};
+
+std::vector<std::vector<FrameObject>> makeFrames(const BenchmarkConfig& config,
+                                                 std::mt19937& rng) {
+  std::vector<FrameObject> objects(config.objects);
+  long long nextTrackId = 0;
+  for (auto& object : objects) object.trackId = nextTrackId++;
+  std::vector<std::vector<FrameObject>> frames;
+  for (int f = 0; f < config.frames; ++f) {
+    for (auto& object : objects) {
+      // 每帧约5%的目标离开画面，换成新的track id
+      if (rng() % 20 == 0) object.trackId = nextTrackId++;
+      object.height = 10 + rng() % 60 * 2;
+      object.width = 10 + rng() % 60 * 2;
+      object.top = rng() % ((IMAGE_HEIGHT - object.height) / 2) * 2;
+      object.left = rng() % ((IMAGE_WIDTH - object.width) / 2) * 2;
+      object.classify = object.trackId % CLASS_NUM;
+    }
+    frames.push_back(objects);
+  }
+  return frames;
+}
+
+std::shared_ptr<common::ObjectMetadata> makeMetadata(
+    const std::vector<FrameObject>& objects, int frameId) {
+  auto objectMetadata = std::make_shared<common::ObjectMetadata>();
+  objectMetadata->mFrame = std::make_shared<common::Frame>();
+  objectMetadata->mFrame->mFrameId = frameId;
+  objectMetadata->mFrame->mTimestamp = 1700000000000LL + frameId * 40;
+  for (const auto& object : objects) {
+    auto detected = std::make_shared<common::DetectedObjectMetadata>();
+    detected->mBox.mX = object.left;
+    detected->mBox.mY = object.top;
+    detected->mBox.mWidth = object.width;
+    detected->mBox.mHeight = object.height;
+    detected->mClassify = object.classify;
+    objectMetadata->mDetectedObjectMetadatas.push_back(detected);
+    auto tracked = std::make_shared<common::TrackedObjectMetadata>();
+    tracked->mTrackId = object.trackId;
+    objectMetadata->mTrackedObjectMetadatas.push_back(tracked);
+  }
+  return objectMetadata;
+}
+
+bool sameResult(const common::ObjectMetadata& a,
+                const common::ObjectMetadata& b) {
+  if (a.tag != b.tag || a.areas.size() != b.areas.size() ||
+      a.mDetectedObjectMetadatas.size() != b.mDetectedObjectMetadatas.size() ||
+      a.mTrackedObjectMetadatas.size() != b.mTrackedObjectMetadatas.size())
+    return false;
+  for (size_t i = 0; i < a.mDetectedObjectMetadatas.size(); ++i) {
+    const auto& boxA = a.mDetectedObjectMetadatas[i]->mBox;
+    const auto& boxB = b.mDetectedObjectMetadatas[i]->mBox;
+    if (boxA.mX != boxB.mX || boxA.mY != boxB.mY) return false;
+  }
+  for (size_t i = 0; i < a.mTrackedObjectMetadatas.size(); ++i) {
+    if (a.mTrackedObjectMetadatas[i]->mTrackId !=
+        b.mTrackedObjectMetadatas[i]->mTrackId)
+      return false;
+  }
+  for (size_t i = 0; i < a.areas.size(); ++i) {
+    if (a.areas[i].size() != b.areas[i].size()) return false;
+    for (size_t j = 0; j < a.areas[i].size(); ++j) {
+      if (a.areas[i][j].mX != b.areas[i][j].mX ||
+          a.areas[i][j].mY != b.areas[i][j].mY)
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.frames = std::atoi(argv[1]);
+  if (argc > 2) config.polygons = std::atoi(argv[2]);
+  if (argc > 3) config.objects = std::atoi(argv[3]);
+  if (config.frames <= 0 || config.polygons <= 0 || config.objects <= 0) {
+    std::cerr << "usage: " << argv[0] << " [frames] [polygons] [objects]"
+              << std::endl;
+    return 1;
+  }
+
+  std::mt19937 rng(2024);
+  nlohmann::json rules = makeRules(config, rng);
+  auto frames = makeFrames(config, rng);
+
+  auto compileBegin = Clock::now();
+  std::shared_ptr<RuleSet> ruleSet;
+  std::string error;
+  if (RuleSet::compile(rules, ruleSet, error) !=
+      sophon_stream::common::ErrorCode::SUCCESS) {
+    std::cerr << "compile rules fail: " << error << std::endl;
+    return 1;
+  }
+  double compileMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - compileBegin)
+          .count();
+  auto legacyFilters = makeLegacyFilters(rules);
+  std::unordered_map<std::string, int> continueFrameNum;
+  ChannelRules* channelRules = ruleSet->findChannel(0);
+
+  std::vector<std::shared_ptr<common::ObjectMetadata>> legacyInputs,
+      compiledInputs;
+  for (int f = 0; f < config.frames; ++f) {
+    legacyInputs.push_back(makeMetadata(frames[f], f));
+    compiledInputs.push_back(makeMetadata(frames[f], f));
+  }
+
+  auto legacyBegin = Clock::now();
+  for (auto& objectMetadata : legacyInputs) {
+    objectMetadata->tag =
+        legacy::apply(legacyFilters, continueFrameNum, objectMetadata);
+  }
+  double legacySeconds =
+      std::chrono::duration<double>(Clock::now() - legacyBegin).count();
+
+  auto compiledBegin = Clock::now();
+  for (auto& objectMetadata : compiledInputs) {
+    objectMetadata->tag = channelRules->apply(*objectMetadata);
+  }
+  double compiledSeconds =
+      std::chrono::duration<double>(Clock::now() - compiledBegin).count();
+
+  int alertFrames = 0;
+  size_t keptObjects = 0;
+  for (int f = 0; f < config.frames; ++f) {
+    if (!sameResult(*legacyInputs[f], *compiledInputs[f])) {
+      std::cerr << "result mismatch at frame " << f << std::endl;
+      return 1;
+    }
+    alertFrames += legacyInputs[f]->tag != 0;
+    keptObjects += legacyInputs[f]->mDetectedObjectMetadatas.size();
+  }
+
+  std::cout << "frames: " << config.frames
+            << ", polygons per filter: " << config.polygons
+            << ", objects per frame: " << config.objects
+            << ", compile: " << compileMs << " ms" << std::endl;
+  std::cout << "correctness: ok (" << alertFrames << " frames tagged, "
+            << static_cast<double>(keptObjects) / config.frames
+            << " objects/frame kept)" << std::endl;
+  std::cout << "legacy  : " << legacySeconds * 1e6 / config.frames
+            << " us/frame" << std::endl;
+  std::cout << "compiled: " << compiledSeconds * 1e6 / config.frames
+            << " us/frame" << std::endl;
+  return 0;
+}
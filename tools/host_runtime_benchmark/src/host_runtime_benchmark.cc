@@ -0,0 +1,448 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 检查并测量host运行时（TARGET_ARCH=host）。
+// 用framework的BMNNContext/BMNNNetwork加载json网络描述，检查deterministic后端的
+// 输出与batch组成无关、replay后端按帧回放、输入shape不匹配时推理失败；
+// 再检查yolov5前处理用到的bmcv操作、jpeg编解码和base64，最后确认设备内存全部释放。
+// 检查通过后输出前处理链路和推理的CPU耗时。
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bmcv_api_ext.h"
+#include "common/bmnn_utils.h"
+#include "host_runtime.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* MODEL_PATH = "host_runtime_benchmark_model.json";
+const char* REPLAY_PATH = "host_runtime_benchmark_replay.bin";
+
+bool failed(const char* what) {
+  std::printf("check %s: FAILED\n", what);
+  return false;
+}
+
+double elapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+/**
+ * @brief 写入检查用的网络描述和回放文件，replay_net每帧输出为{f, f + 0.5}
+ */
+void writeModel(int width, int height, int latencyUs) {
+  std::ofstream model(MODEL_PATH);
+  model << R"({"networks": [
+  {"name": "check_net", "batches": [1, 4],
+   "inputs": [{"name": "images", "dtype": "FLOAT32", "shape": [3, 32, 32]}],
+   "outputs": [{"name": "boxes", "dtype": "FLOAT32", "shape": [100, 85]},
+               {"name": "scores", "dtype": "INT8", "scale": 0.5, "shape": [16]}],
+   "backend": {"type": "deterministic", "seed": 7, "min": 0, "max": 1}},
+  {"name": "replay_net", "batches": [4],
+   "inputs": [{"name": "images", "dtype": "UINT8", "shape": [8]}],
+   "outputs": [{"name": "output0", "dtype": "FLOAT32", "shape": [2]}],
+   "backend": {"type": "replay", "files": [")"
+        << REPLAY_PATH << R"("]}},
+  {"name": "yolov5s", "batches": [1, 4],
+   "inputs": [{"name": "images", "dtype": "FLOAT32", "shape": [3, )"
+        << height << ", " << width << R"(]}],
+   "outputs": [{"name": "output0", "dtype": "FLOAT32", "shape": [25200, 85]}],
+   "latency_us": )"
+        << latencyUs << R"(,
+   "backend": {"type": "deterministic"}}
+]})";
+  std::ofstream replay(REPLAY_PATH, std::ios::binary);
+  for (int frame = 0; frame < 3; ++frame) {
+    float values[2] = {static_cast<float>(frame), frame + 0.5f};
+    replay.write(reinterpret_cast<const char*>(values), sizeof(values));
+  }
+}
+
+std::shared_ptr<bm_tensor_t> makeInput(bm_data_type_t dtype, int batch,
+                                       std::initializer_list<int> dims) {
+  auto tensor = std::make_shared<bm_tensor_t>();
+  tensor->dtype = dtype;
+  tensor->st_mode = BM_STORE_1N;
+  tensor->shape.num_dims = 1 + static_cast<int>(dims.size());
+  tensor->shape.dims[0] = batch;
+  std::copy(dims.begin(), dims.end(), tensor->shape.dims + 1);
+  bm_malloc_device_byte(nullptr, &tensor->device_mem,
+                        bmrt_tensor_bytesize(tensor.get()));
+  return tensor;
+}
+
+/**
+ * @brief 按网络最大输出申请的输出tensor，shape为batch对应stage的输出shape
+ * @details BMNNNetwork::forward不回写bmrt申请的输出，和element一样预先申请
+ */
+std::vector<std::shared_ptr<bm_tensor_t>> makeOutputs(void* bmrt,
+                                                      const char* name,
+                                                      int batch) {
+  const bm_net_info_t* info = bmrt_get_network_info(bmrt, name);
+  int stage = 0;
+  while (stage + 1 < info->stage_num &&
+         info->stages[stage].input_shapes[0].dims[0] != batch)
+    ++stage;
+  std::vector<std::shared_ptr<bm_tensor_t>> outputs;
+  for (int i = 0; i < info->output_num; ++i) {
+    auto tensor = std::make_shared<bm_tensor_t>();
+    tensor->dtype = info->output_dtypes[i];
+    tensor->st_mode = BM_STORE_1N;
+    tensor->shape = info->stages[stage].output_shapes[i];
+    bm_malloc_device_byte(nullptr, &tensor->device_mem,
+                          info->max_output_bytes[i]);
+    outputs.push_back(tensor);
+  }
+  return outputs;
+}
+
+void freeTensors(const std::vector<std::shared_ptr<bm_tensor_t>>& tensors) {
+  for (const auto& tensor : tensors) bm_free_device(nullptr, tensor->device_mem);
+}
+
+std::vector<unsigned char> readTensor(const bm_tensor_t& tensor) {
+  std::vector<unsigned char> data(bmrt_tensor_bytesize(&tensor));
+  bm_memcpy_d2s_partial(nullptr, data.data(), tensor.device_mem,
+                        static_cast<unsigned int>(data.size()));
+  return data;
+}
+
+bool checkRuntime(BMNNContext& context) {
+  bool ok = true;
+  BMNNNetwork network(context.bmrt(), "check_net");
+  const std::size_t frameBytes = 3 * 32 * 32 * sizeof(float);
+
+  // 4帧一起推理与逐帧推理的输出应完全相同
+  auto batchInput = makeInput(BM_FLOAT32, 4, {3, 32, 32});
+  std::vector<float> pixels(3 * 32 * 32 * 4);
+  for (std::size_t i = 0; i < pixels.size(); ++i)
+    pixels[i] = static_cast<float>((i * 2654435761u) % 1000) / 1000.f;
+  bm_memcpy_s2d(nullptr, batchInput->device_mem, pixels.data());
+  std::vector<std::shared_ptr<bm_tensor_t>> inputs = {batchInput};
+  auto batchOutputs = makeOutputs(context.bmrt(), "check_net", 4);
+  if (network.forward(inputs, batchOutputs) != 0) return failed("batch 4 forward");
+  auto batchBoxes = readTensor(*batchOutputs[0]);
+  auto batchScores = readTensor(*batchOutputs[1]);
+
+  for (int frame = 0; frame < 4; ++frame) {
+    auto input = makeInput(BM_FLOAT32, 1, {3, 32, 32});
+    bm_memcpy_s2d(nullptr, input->device_mem,
+                  reinterpret_cast<unsigned char*>(pixels.data()) +
+                      frame * frameBytes);
+    std::vector<std::shared_ptr<bm_tensor_t>> single = {input};
+    auto outputs = makeOutputs(context.bmrt(), "check_net", 1);
+    if (network.forward(single, outputs) != 0) {
+      ok = failed("batch 1 forward");
+    } else {
+      auto boxes = readTensor(*outputs[0]);
+      auto scores = readTensor(*outputs[1]);
+      if (std::memcmp(boxes.data(), batchBoxes.data() + frame * boxes.size(),
+                      boxes.size()) != 0 ||
+          std::memcmp(scores.data(), batchScores.data() + frame * scores.size(),
+                      scores.size()) != 0)
+        ok = failed("output independent of batch composition");
+    }
+    freeTensors(single);
+    freeTensors(outputs);
+  }
+
+  // FLOAT32输出在[min, max)内，INT8输出按scale量化
+  const float* boxes = reinterpret_cast<const float*>(batchBoxes.data());
+  for (std::size_t i = 0; i < batchBoxes.size() / sizeof(float); ++i) {
+    if (boxes[i] < 0.f || boxes[i] >= 1.f) {
+      ok = failed("float output range");
+      break;
+    }
+  }
+  for (unsigned char value : batchScores) {
+    if (static_cast<signed char>(value) < 0 ||
+        static_cast<signed char>(value) > 2) {
+      ok = failed("int8 output quantization");
+      break;
+    }
+  }
+  freeTensors(batchOutputs);
+
+  // bmodel中没有batch 3，推理应失败
+  auto badInput = makeInput(BM_FLOAT32, 3, {3, 32, 32});
+  bm_tensor_t badOutputs[2];
+  if (bmrt_launch_tensor_ex(context.bmrt(), "check_net", badInput.get(), 1,
+                            badOutputs, 2, false, false))
+    ok = failed("unknown batch rejected");
+  freeTensors(inputs);
+  freeTensors({badInput});
+
+  // replay后端按帧循环回放
+  BMNNNetwork replay(context.bmrt(), "replay_net");
+  std::vector<std::shared_ptr<bm_tensor_t>> replayInputs = {
+      makeInput(BM_UINT8, 4, {8})};
+  auto replayOutputs = makeOutputs(context.bmrt(), "replay_net", 4);
+  if (replay.forward(replayInputs, replayOutputs) != 0) {
+    ok = failed("replay forward");
+  } else {
+    auto data = readTensor(*replayOutputs[0]);
+    const float* values = reinterpret_cast<const float*>(data.data());
+    const float expected[8] = {0, 0.5f, 1, 1.5f, 2, 2.5f, 0, 0.5f};
+    if (!std::equal(expected, expected + 8, values))
+      ok = failed("replay frames in order");
+  }
+  freeTensors(replayInputs);
+  freeTensors(replayOutputs);
+  return ok;
+}
+
+/**
+ * @brief 生成BGR packed的渐变图
+ */
+std::vector<unsigned char> gradient(int width, int height) {
+  std::vector<unsigned char> bgr(static_cast<std::size_t>(width) * height * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      unsigned char* pixel = &bgr[(static_cast<std::size_t>(y) * width + x) * 3];
+      pixel[0] = static_cast<unsigned char>(x * 255 / std::max(width - 1, 1));
+      pixel[1] = static_cast<unsigned char>(y * 255 / std::max(height - 1, 1));
+      pixel[2] = static_cast<unsigned char>(128 + (x - y) / 8);
+    }
+  }
+  return bgr;
+}
+
+bool createImage(int width, int height, bm_image_format_ext format,
+                 bm_image_data_format_ext dtype, bm_image* image) {
+  return bm_image_create(nullptr, height, width, format, dtype, image) ==
+             BM_SUCCESS &&
+         bm_image_alloc_dev_mem(*image) == BM_SUCCESS;
+}
+
+/**
+ * @brief 解码出的YUV420P图片，与decode element的输出相同
+ */
+bool decodedFrame(int width, int height, bm_image* frame) {
+  bm_image bgr;
+  if (!createImage(width, height, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE,
+                   &bgr) ||
+      !createImage(width, height, FORMAT_YUV420P, DATA_TYPE_EXT_1N_BYTE, frame))
+    return false;
+  auto pixels = gradient(width, height);
+  void* buffers[1] = {pixels.data()};
+  bool ok = bm_image_copy_host_to_device(bgr, buffers) == BM_SUCCESS &&
+            bmcv_image_storage_convert(nullptr, 1, &bgr, frame) == BM_SUCCESS;
+  bm_image_destroy(bgr);
+  return ok;
+}
+
+/**
+ * @brief yolov5前处理：letterbox缩放到RGB planar并补114，再转FLOAT32归一化
+ */
+bool letterbox(const bm_image& frame, bm_image& resized, bm_image& tensor) {
+  float ratio = std::min(static_cast<float>(resized.width) / frame.width,
+                         static_cast<float>(resized.height) / frame.height);
+  bmcv_padding_atrr_t padding;
+  padding.dst_crop_w = static_cast<unsigned int>(frame.width * ratio);
+  padding.dst_crop_h = static_cast<unsigned int>(frame.height * ratio);
+  padding.dst_crop_stx = (resized.width - padding.dst_crop_w) / 2;
+  padding.dst_crop_sty = (resized.height - padding.dst_crop_h) / 2;
+  padding.padding_r = padding.padding_g = padding.padding_b = 114;
+  padding.if_memset = 1;
+  bmcv_rect_t crop = {0, 0, frame.width, frame.height};
+  bmcv_convert_to_attr convert = {1 / 255.f, 0, 1 / 255.f, 0, 1 / 255.f, 0};
+  bm_image input = frame, output = resized;
+  return bmcv_image_vpp_convert_padding(nullptr, 1, input, &output, &padding,
+                                        &crop) == BM_SUCCESS &&
+         bmcv_image_convert_to(nullptr, 1, convert, &output, &tensor) ==
+             BM_SUCCESS;
+}
+
+bool checkBmcv() {
+  bool ok = true;
+  const int width = 320, height = 180;
+  bm_image frame, resized, tensor;
+  if (!decodedFrame(width, height, &frame) ||
+      !createImage(160, 160, FORMAT_RGB_PLANAR, DATA_TYPE_EXT_1N_BYTE,
+                   &resized) ||
+      !createImage(160, 160, FORMAT_RGB_PLANAR, DATA_TYPE_EXT_FLOAT32, &tensor))
+    return failed("image creation");
+  if (!letterbox(frame, resized, tensor)) return failed("letterbox");
+
+  bm_device_mem_t mem;
+  bm_image_get_device_mem(tensor, &mem);
+  std::vector<float> planar(3 * 160 * 160);
+  bm_memcpy_d2s(nullptr, planar.data(), mem);
+  // 320x180缩放为160x90，上下各补35行
+  if (std::fabs(planar[0] - 114 / 255.f) > 1e-6f ||
+      std::fabs(planar[2 * 160 * 160 + 159 * 160 + 159] - 114 / 255.f) > 1e-6f)
+    ok = failed("letterbox padding");
+  auto source = gradient(width, height);
+  float error = 0;
+  for (int y = 40; y < 120; y += 8) {
+    for (int x = 8; x < 152; x += 8) {
+      const unsigned char* pixel =
+          &source[(static_cast<std::size_t>(y - 35) * 2 * width + x * 2) * 3];
+      for (int c = 0; c < 3; ++c)
+        error = std::max(
+            error, std::fabs(planar[c * 160 * 160 + y * 160 + x] * 255 -
+                             pixel[2 - c]));
+    }
+  }
+  // YUV420P往返和缩放的误差
+  if (error > 12) ok = failed("letterbox content");
+
+  // crop得到的区域与原图一致
+  bm_image bgr, cropped;
+  createImage(width, height, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE, &bgr);
+  void* buffers[1] = {source.data()};
+  bm_image_copy_host_to_device(bgr, buffers);
+  createImage(64, 32, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE, &cropped);
+  bmcv_rect_t rect = {100, 50, 64, 32};
+  if (bmcv_image_crop(nullptr, 1, &rect, bgr, &cropped) != BM_SUCCESS) {
+    ok = failed("crop");
+  } else {
+    std::vector<unsigned char> crop(64 * 32 * 3);
+    void* cropBuffers[1] = {crop.data()};
+    bm_image_copy_device_to_host(cropped, cropBuffers);
+    for (int y = 0; y < 32 && ok; ++y) {
+      if (std::memcmp(&crop[y * 64 * 3],
+                      &source[((50 + y) * width + 100) * 3], 64 * 3) != 0)
+        ok = failed("crop content");
+    }
+  }
+
+  // jpeg编码后解码，与原图的平均误差
+  void* jpeg = nullptr;
+  size_t jpegSize = 0;
+  bm_image decoded;
+  decoded.image_private = nullptr;
+  if (bmcv_image_jpeg_enc(nullptr, 1, &bgr, &jpeg, &jpegSize) != BM_SUCCESS ||
+      bmcv_image_jpeg_dec(nullptr, &jpeg, &jpegSize, 1, &decoded) !=
+          BM_SUCCESS) {
+    ok = failed("jpeg encode and decode");
+  } else {
+    bm_image roundTrip;
+    createImage(width, height, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE,
+                &roundTrip);
+    bmcv_image_storage_convert(nullptr, 1, &decoded, &roundTrip);
+    std::vector<unsigned char> result(source.size());
+    void* resultBuffers[1] = {result.data()};
+    bm_image_copy_device_to_host(roundTrip, resultBuffers);
+    double sum = 0;
+    for (std::size_t i = 0; i < result.size(); ++i)
+      sum += std::abs(result[i] - source[i]);
+    if (sum / result.size() > 4) ok = failed("jpeg round trip");
+    bm_image_destroy(roundTrip);
+    bm_image_destroy(decoded);
+  }
+  std::free(jpeg);
+
+  // base64与serialize中的用法一致
+  char text[] = "Man", encoded[16] = {0};
+  unsigned long lengths[2] = {2, 0};
+  bmcv_base64_enc(nullptr, bm_mem_from_system(text), bm_mem_from_system(encoded),
+                  lengths);
+  if (lengths[1] != 4 || std::strncmp(encoded, "TWE=", 4) != 0)
+    ok = failed("base64");
+
+  bm_image_destroy(cropped);
+  bm_image_destroy(bgr);
+  bm_image_destroy(tensor);
+  bm_image_destroy(resized);
+  bm_image_destroy(frame);
+  return ok;
+}
+
+/**
+ * @brief 1080p解码帧经letterbox前处理后按batch推理的耗时
+ */
+void measure(BMNNContext& context, int width, int height, int iterations) {
+  const int batch = 4;
+  BMNNNetwork network(context.bmrt(), "yolov5s");
+  bm_image frame, resized[batch], tensors[batch];
+  decodedFrame(1920, 1080, &frame);
+  for (int i = 0; i < batch; ++i) {
+    createImage(width, height, FORMAT_RGB_PLANAR, DATA_TYPE_EXT_1N_BYTE,
+                &resized[i]);
+    bm_image_create(nullptr, height, width, FORMAT_RGB_PLANAR,
+                    DATA_TYPE_EXT_FLOAT32, &tensors[i]);
+  }
+  // 与检测element一样，batch内各帧的tensor在连续内存中作为网络输入
+  bm_image_alloc_contiguous_mem(batch, tensors);
+  auto input = std::make_shared<bm_tensor_t>();
+  input->dtype = BM_FLOAT32;
+  input->st_mode = BM_STORE_1N;
+  input->shape = {4, {batch, 3, height, width}};
+  bm_image_get_device_mem(tensors[0], &input->device_mem);
+  input->device_mem.size =
+      static_cast<unsigned int>(bmrt_tensor_bytesize(input.get()));
+  std::vector<std::shared_ptr<bm_tensor_t>> inputs = {input};
+  auto outputs = makeOutputs(context.bmrt(), "yolov5s", batch);
+
+  double preMs = 0, inferMs = 0;
+  for (int it = 0; it < iterations; ++it) {
+    auto start = Clock::now();
+    for (int i = 0; i < batch; ++i) letterbox(frame, resized[i], tensors[i]);
+    preMs += elapsedMs(start);
+    start = Clock::now();
+    network.forward(inputs, outputs);
+    inferMs += elapsedMs(start);
+  }
+  std::printf("%-28s %10s %10s\n", "stage", "ms/batch", "ms/frame");
+  std::printf("%-28s %10.2f %10.2f\n", "letterbox 1920x1080 (cpu)",
+              preMs / iterations, preMs / iterations / batch);
+  std::printf("%-28s %10.2f %10.2f\n", "forward deterministic",
+              inferMs / iterations, inferMs / iterations / batch);
+
+  freeTensors(outputs);
+  bm_image_free_contiguous_mem(batch, tensors);
+  for (int i = 0; i < batch; ++i) {
+    bm_image_destroy(tensors[i]);
+    bm_image_destroy(resized[i]);
+  }
+  bm_image_destroy(frame);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int width = argc > 1 ? std::atoi(argv[1]) : 640;
+  int height = argc > 2 ? std::atoi(argv[2]) : 640;
+  int iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 10;
+  int latencyUs = argc > 4 ? std::atoi(argv[4]) : 0;
+  writeModel(width, height, latencyUs);
+
+  auto before = sophon_stream::host::getDeviceMemoryStats();
+  bool ok = true;
+  {
+    auto handle = std::make_shared<BMNNHandle>(0);
+    BMNNContext context(handle, MODEL_PATH);
+    ok = checkRuntime(context) && ok;
+    std::printf("runtime: %s\n", ok ? "ok" : "FAILED");
+    bool bmcvOk = checkBmcv();
+    std::printf("bmcv: %s\n", bmcvOk ? "ok" : "FAILED");
+    ok = ok && bmcvOk;
+    if (ok) measure(context, width, height, iterations);
+    bmrt_destroy(context.bmrt());
+  }
+  auto after = sophon_stream::host::getDeviceMemoryStats();
+  bool released = after.blocks == before.blocks && after.bytes == before.bytes;
+  std::printf("device memory: %s (%zu allocations, %zu blocks left)\n",
+              released ? "ok" : "LEAKED", after.allocations - before.allocations,
+              after.blocks - before.blocks);
+  return ok && released ? 0 : 1;
+}
@@ -0,0 +1,380 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比http_push两种发送方式，接收端为本进程内的httplib::Server：
+// legacy: 原HttpPushImpl_，每路码流一个httplib::Client和一个发送线程，
+//         每条结果同步发送一个请求，队列超过20条时丢弃
+// pooled: push_sender.h，固定数量的发送线程和keep-alive连接，按条数或时间合并为一个请求，
+//         可选gzip，统计丢弃和重试
+// 接收端检查每一路收到的序号严格递增，可以按比例返回503验证重试
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "httplib.h"
+#include "push_sender.h"
+
+namespace {
+
+using sophon_stream::element::http_push::PushPayload;
+using sophon_stream::element::http_push::PushSender;
+using sophon_stream::element::http_push::PushSenderConfig;
+using Clock = std::chrono::steady_clock;
+
+constexpr const char* PUSH_PATH = "/stream/test";
+
+struct BenchmarkConfig {
+  int channels = 128;
+  int fps = 25;
+  int seconds = 5;
+  int objects = 20;
+  int senders = 4;
+  int batchSize = 32;
+  int batchTimeoutMs = 20;
+  bool gzip = false;
+  /**
+   * @brief 接收端每处理一个请求的耗时，单位us
+   */
+  int serverCostUs = 200;
+  /**
+   * @brief 接收端每failEvery个请求返回一次503，为0时不返回错误
+   */
+  int failEvery = 0;
+};
+
+/**
+ * @brief 模拟结果收集服务
+ */
+class Collector {
+ public:
+  explicit Collector(const BenchmarkConfig& config) : mConfig(config) {
+    // 真实的收集服务一般不会限制一个keep-alive连接上的请求数
+    mServer.set_keep_alive_max_count(100000);
+    mServer.set_tcp_nodelay(true);
+    mServer.Post(PUSH_PATH, [this](const httplib::Request& req,
+                                   httplib::Response& res) {
+      handle(req, res);
+    });
+    mPort = mServer.bind_to_any_port("127.0.0.1");
+    mThread = std::thread([this] { mServer.listen_after_bind(); });
+  }
+
+  ~Collector() {
+    mServer.stop();
+    mThread.join();
+  }
+
+  int getPort() const { return mPort; }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRequests = 0;
+    mItems = 0;
+    mConnections.clear();
+    mLastSeq.clear();
+    mOutOfOrder = 0;
+  }
+
+  size_t mRequests = 0;
+  size_t mItems = 0;
+  size_t mOutOfOrder = 0;
+  std::set<std::pair<std::string, int>> mConnections;
+  std::mutex mMutex;
+
+ private:
+  void handle(const httplib::Request& req, httplib::Response& res) {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(mConfig.serverCostUs));
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mConnections.emplace(req.remote_addr, req.remote_port);
+      if (mConfig.failEvery > 0 && ++mCalls % mConfig.failEvery == 0) {
+        res.status = 503;
+        return;
+      }
+    }
+    auto body = nlohmann::json::parse(req.body, nullptr, false);
+    if (body.is_discarded()) {
+      res.status = 400;
+      return;
+    }
+    if (!body.is_array()) body = nlohmann::json::array({body});
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mRequests;
+    for (auto& item : body) {
+      int channel = item["mFrame"]["mChannelId"].get<int>();
+      std::int64_t seq = item["mFrame"]["mFrameId"].get<std::int64_t>();
+      auto it = mLastSeq.find(channel);
+      if (it != mLastSeq.end() && seq <= it->second) ++mOutOfOrder;
+      mLastSeq[channel] = seq;
+      ++mItems;
+    }
+    res.set_content("{\"code\":0}", "application/json");
+  }
+
+  const BenchmarkConfig mConfig;
+  httplib::Server mServer;
+  int mPort = 0;
+  std::thread mThread;
+  size_t mCalls = 0;
+  std::map<int, std::int64_t> mLastSeq;
+};
+
+/**
+ * @brief 与serialize.h输出的字段结构相同的一帧结果
+ */
+std::string makeResult(int channel, std::int64_t frameId, int objects,
+                       std::mt19937& rng) {
+  nlohmann::json frame;
+  frame["mChannelId"] = channel;
+  frame["mFrameId"] = frameId;
+  frame["mTimestamp"] = frameId * 40;
+  frame["mWidth"] = 1920;
+  frame["mHeight"] = 1080;
+  nlohmann::json result;
+  result["mFrame"] = frame;
+  result["mFps"] = 25.0;
+  nlohmann::json detected = nlohmann::json::array();
+  for (int i = 0; i < objects; ++i) {
+    nlohmann::json box = {{"mX", rng() % 1800},
+                          {"mY", rng() % 1000},
+                          {"mWidth", 20 + rng() % 100},
+                          {"mHeight", 20 + rng() % 100}};
+    detected.push_back({{"mBox", box},
+                        {"mClassify", rng() % 80},
+                        {"mScores", {0.5 + (rng() % 50) / 100.0}}});
+  }
+  result["mDetectedObjectMetadatas"] = detected;
+  return result.dump();
+}
+
+/**
+ * @brief 原http_push.cc中的HttpPushImpl_，发送逻辑保持原样
+ */
+namespace legacy {
+
+class HttpPushImpl_ {
+ public:
+  HttpPushImpl_(const std::string& ip, int port, std::string path)
+      : cli(ip, port), path(path) {
+    workThread = std::thread(&HttpPushImpl_::postFunc, this);
+  }
+
+  bool pushQueue(std::string body) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (objQueue.size() >= maxQueueLen) return false;
+    objQueue.push(std::move(body));
+    return true;
+  }
+
+  void release() {
+    isRunning = false;
+    workThread.join();
+  }
+
+  size_t getQueueSize() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return objQueue.size();
+  }
+
+ private:
+  void postFunc() {
+    while (isRunning) {
+      std::string body;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!objQueue.empty()) {
+          body = std::move(objQueue.front());
+          objQueue.pop();
+        }
+      }
+      if (body.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        continue;
+      }
+      cli.Post(path.c_str(), body.data(), body.size(), "application/json");
+    }
+  }
+
+  std::queue<std::string> objQueue;
+  std::thread workThread;
+  std::atomic<bool> isRunning{true};
+  std::mutex mtx;
+  static constexpr size_t maxQueueLen = 20;
+  httplib::Client cli;
+  std::string path;
+};
+
+}  // namespace legacy
+
+struct RunResult {
+  double seconds = 0;
+  size_t produced = 0;
+  size_t dropped = 0;
+  size_t failed = 0;
+  size_t retries = 0;
+  size_t rawBytes = 0;
+  size_t sentBytes = 0;
+  int threads = 0;
+};
+
+/**
+ * @brief 按fps逐帧产生所有码流的结果，push返回false时计为丢弃
+ */
+template <typename PushFunc>
+void produce(const BenchmarkConfig& config,
+             const std::vector<std::vector<std::string>>& results,
+             PushFunc push, RunResult& result) {
+  auto begin = Clock::now();
+  int frames = config.fps * config.seconds;
+  for (int f = 0; f < frames; ++f) {
+    std::this_thread::sleep_until(begin + std::chrono::microseconds(
+                                              1000000LL * f / config.fps));
+    for (int c = 0; c < config.channels; ++c) {
+      ++result.produced;
+      if (!push(c, results[c][f])) ++result.dropped;
+    }
+  }
+}
+
+RunResult runLegacy(const BenchmarkConfig& config, int port,
+                    const std::vector<std::vector<std::string>>& results) {
+  RunResult result;
+  auto begin = Clock::now();
+  std::vector<std::unique_ptr<legacy::HttpPushImpl_>> impls;
+  for (int c = 0; c < config.channels; ++c) {
+    impls.push_back(
+        std::make_unique<legacy::HttpPushImpl_>("127.0.0.1", port, PUSH_PATH));
+  }
+  produce(config, results,
+          [&](int channel, const std::string& body) {
+            return impls[channel]->pushQueue(body);
+          },
+          result);
+  // 原实现release时直接退出，这里等待队列发送完，与pooled的stop()一致
+  for (auto& impl : impls) {
+    while (impl->getQueueSize() > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    impl->release();
+  }
+  result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+  result.threads = config.channels;
+  return result;
+}
+
+RunResult runPooled(const BenchmarkConfig& config, int port,
+                    const std::vector<std::vector<std::string>>& results) {
+  RunResult result;
+  PushSenderConfig senderConfig;
+  senderConfig.ip = "127.0.0.1";
+  senderConfig.port = port;
+  senderConfig.path = PUSH_PATH;
+  senderConfig.senders = config.senders;
+  senderConfig.batchSize = config.batchSize;
+  senderConfig.batchTimeoutMs = config.batchTimeoutMs;
+  senderConfig.retryIntervalMs = 10;
+  senderConfig.gzip = config.gzip;
+
+  auto begin = Clock::now();
+  PushSender sender(senderConfig);
+  sender.start();
+  produce(config, results,
+          [&](int channel, const std::string& body) {
+            auto payload = sender.acquirePayload();
+            payload->writer.buffer() = body;
+            return sender.push(channel, std::move(payload));
+          },
+          result);
+  sender.stop();
+  result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+  const auto& stats = sender.getStats();
+  result.failed = stats->failedItems;
+  result.retries = stats->retries;
+  result.rawBytes = stats->rawBytes;
+  result.sentBytes = stats->sentBytes;
+  result.threads = config.senders;
+  return result;
+}
+
+void report(const char* name, const RunResult& result, Collector& collector) {
+  std::lock_guard<std::mutex> lock(collector.mMutex);
+  std::cout << name << ": " << result.threads << " threads, "
+            << collector.mConnections.size() << " connections, "
+            << collector.mRequests << " requests, " << collector.mItems << "/"
+            << result.produced << " results delivered, " << result.dropped
+            << " dropped, " << result.failed << " failed, " << result.retries
+            << " retries, " << collector.mOutOfOrder << " out of order, "
+            << result.seconds << " s" << std::endl;
+  if (result.sentBytes > 0) {
+    std::cout << "  body bytes: " << result.rawBytes << " raw, "
+              << result.sentBytes << " sent" << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.channels = std::atoi(argv[1]);
+  if (argc > 2) config.senders = std::atoi(argv[2]);
+  if (argc > 3) config.batchSize = std::atoi(argv[3]);
+  if (argc > 4) config.gzip = std::atoi(argv[4]) != 0;
+  if (argc > 5) config.failEvery = std::atoi(argv[5]);
+  if (argc > 6) config.seconds = std::atoi(argv[6]);
+  if (config.channels <= 0 || config.senders <= 0 || config.batchSize <= 0 ||
+      config.failEvery < 0 || config.seconds <= 0) {
+    std::cerr << "usage: " << argv[0]
+              << " [channels] [senders] [batch_size] [gzip] [fail_every] "
+                 "[seconds]"
+              << std::endl;
+    return 1;
+  }
+  if (config.gzip && !PushSender::gzipSupported()) {
+    std::cerr << "built without zlib, gzip is not supported" << std::endl;
+    return 1;
+  }
+
+  std::mt19937 rng(2024);
+  std::vector<std::vector<std::string>> results(config.channels);
+  for (int c = 0; c < config.channels; ++c) {
+    for (int f = 0; f < config.fps * config.seconds; ++f)
+      results[c].push_back(makeResult(c, f, config.objects, rng));
+  }
+
+  std::cout << "channels: " << config.channels << ", fps: " << config.fps
+            << ", seconds: " << config.seconds
+            << ", result size: " << results[0][0].size() << " bytes"
+            << ", server cost: " << config.serverCostUs << " us/request"
+            << std::endl;
+
+  Collector collector(config);
+  // 原实现不重试，接收端返回错误的请求直接丢失，只在不注入错误时对比
+  if (config.failEvery == 0) {
+    RunResult legacyResult = runLegacy(config, collector.getPort(), results);
+    report("legacy", legacyResult, collector);
+    collector.reset();
+  }
+  RunResult pooledResult = runPooled(config, collector.getPort(), results);
+  report("pooled", pooledResult, collector);
+  return 0;
+}
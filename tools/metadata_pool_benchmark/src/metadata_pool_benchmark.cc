@@ -0,0 +1,139 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 统计每帧ObjectMetadata相关的堆分配次数：
+// 按decode -> yolo后处理 -> bytetrack -> sink的顺序构造和释放每帧的元数据，
+// 分别使用std::make_shared和ObjectPool，替换全局operator new计数。
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "common/object_metadata.h"
+#include "common/object_pool.h"
+
+namespace {
+
+std::atomic<std::uint64_t> gAllocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using sophon_stream::common::DetectedObjectMetadata;
+using sophon_stream::common::Frame;
+using sophon_stream::common::makePooled;
+using sophon_stream::common::ObjectMetadata;
+using sophon_stream::common::TrackedObjectMetadata;
+
+struct BenchmarkConfig {
+  int frames = 10000;
+  int objects = 20;
+  /**
+   * @brief 同时在pipeline中的帧数量，模拟各element队列中缓存的帧
+   */
+  int inFlight = 32;
+};
+
+template <bool Pooled, typename T>
+std::shared_ptr<T> make() {
+  if (Pooled) return makePooled<T>();
+  return std::make_shared<T>();
+}
+
+template <bool Pooled>
+std::shared_ptr<ObjectMetadata> runFrame(const BenchmarkConfig& config,
+                                         int frameId) {
+  // decode
+  auto objectMetadata = make<Pooled, ObjectMetadata>();
+  objectMetadata->mFrame = make<Pooled, Frame>();
+  objectMetadata->mFrame->mFrameId = frameId;
+
+  // yolo后处理
+  for (int i = 0; i < config.objects; ++i) {
+    auto detData = make<Pooled, DetectedObjectMetadata>();
+    detData->mBox.mX = i;
+    detData->mBox.mWidth = 16;
+    detData->mBox.mHeight = 16;
+    detData->mScores.push_back(0.5f);
+    detData->mClassify = 0;
+    objectMetadata->mDetectedObjectMetadatas.push_back(detData);
+  }
+
+  // bytetrack
+  objectMetadata->mDetectedObjectMetadatas.clear();
+  objectMetadata->mTrackedObjectMetadatas.clear();
+  for (int i = 0; i < config.objects; ++i) {
+    auto detData = make<Pooled, DetectedObjectMetadata>();
+    auto trackData = make<Pooled, TrackedObjectMetadata>();
+    detData->mBox.mX = i;
+    detData->mScores.push_back(0.5f);
+    trackData->mTrackId = i;
+    objectMetadata->mDetectedObjectMetadatas.push_back(detData);
+    objectMetadata->mTrackedObjectMetadatas.push_back(trackData);
+  }
+  return objectMetadata;
+}
+
+template <bool Pooled>
+void runBenchmark(const std::string& name, const BenchmarkConfig& config) {
+  // 环形缓冲区，写入新帧时释放inFlight帧之前的帧，即sink释放最早的帧
+  std::vector<std::shared_ptr<ObjectMetadata>> pipeline(config.inFlight);
+  // 预热，使池中缓存足够的对象
+  for (int i = 0; i < config.inFlight * 2; ++i) {
+    pipeline[i % config.inFlight] = runFrame<Pooled>(config, i);
+  }
+
+  std::uint64_t allocationsBegin = gAllocations.load();
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < config.frames; ++i) {
+    pipeline[i % config.inFlight] = runFrame<Pooled>(config, i);
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::uint64_t allocations = gAllocations.load() - allocationsBegin;
+
+  double seconds = std::chrono::duration<double>(end - begin).count();
+  std::cout << name << ": " << static_cast<double>(allocations) / config.frames
+            << " allocations/frame, " << seconds * 1e6 / config.frames
+            << " us/frame" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.frames = std::atoi(argv[1]);
+  if (argc > 2) config.objects = std::atoi(argv[2]);
+  if (argc > 3) config.inFlight = std::atoi(argv[3]);
+  if (config.frames <= 0 || config.objects < 0 || config.inFlight <= 0) {
+    std::cerr << "usage: " << argv[0] << " [frames] [objects] [in_flight]"
+              << std::endl;
+    return 1;
+  }
+
+  runBenchmark<false>("make_shared", config);
+  runBenchmark<true>("pool       ", config);
+  return 0;
+}
@@ -0,0 +1,293 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比posec3d前处理生成heatmap的两种实现：
+// legacy: 原Posec3dPreProcess::generatePoseTarget，关键点存放在嵌套的
+//         shared_ptr<vector>中，逐像素计算exp和pow，按列遍历
+// flat:   posec3d_heatmap.h中的generatePoseHeatmap，关键点连续存放，
+//         一维高斯表按行取最大值，按采样帧多线程
+// canvas: PoseHeatmapCanvas，滑动窗口下每路复用同一块heatmap，
+//         只清零上一次写入的区域
+// 先检查输出在float舍入误差内一致，再统计每个clip耗时的中位数。
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "posec3d_heatmap.h"
+
+namespace {
+
+using sophon_stream::element::posec3d::generatePoseHeatmap;
+using sophon_stream::element::posec3d::PoseHeatmapCanvas;
+using sophon_stream::element::posec3d::PoseHeatmapParams;
+using sophon_stream::element::posec3d::PoseSequence;
+
+using fpptr_dim3 = std::vector<
+    std::shared_ptr<std::vector<std::shared_ptr<std::vector<float>>>>>;
+using fpptr_dim2 = std::vector<std::shared_ptr<std::vector<float>>>;
+
+struct BenchmarkConfig {
+  int frames = 72;
+  int persons = 2;
+  int threads = 4;
+  int numClips = 10;
+  int keypoints = 17;
+  int clipLen = 48;
+  int size = 64;
+  float sigma = 0.6f;
+  float scale = 0.5f;
+  int repeats = 9;
+};
+
+/**
+ * @brief 原generatePoseTarget生成heatmap的部分，scaling为1
+ */
+void legacyPoseTarget(fpptr_dim3& sampled_keypoints,
+                      fpptr_dim3& sampled_keypoint_scores, int num_c,
+                      int img_h, int img_w, float* heatmap, int out_num,
+                      float sigma, float input_scale, int clip_len) {
+  const float eps = 1e-4;
+  int num_frame = sampled_keypoints.size();
+  float* data = heatmap;
+  memset((void*)data, 0, out_num * sizeof(float));
+  int heatmap_start_indx = out_num / 2;
+  for (int i = 0; i < num_frame; i++) {
+    for (int j = 0; j < num_c; j++) {
+      for (std::size_t person_id = 0; person_id < sampled_keypoints[i]->size();
+           person_id++) {
+        if (sampled_keypoint_scores[i]->at(person_id)->at(j) < eps) continue;
+
+        float mu_x = sampled_keypoints[i]->at(person_id)->at(j * 2);
+        float mu_y = sampled_keypoints[i]->at(person_id)->at(j * 2 + 1);
+
+        int st_x = std::max(int(mu_x - 3 * sigma), 0);
+        int ed_x = std::min(int(mu_x + 3 * sigma) + 1, img_w);
+        int st_y = std::max(int(mu_y - 3 * sigma), 0);
+        int ed_y = std::min(int(mu_y + 3 * sigma) + 1, img_h);
+        if (st_x >= ed_x || st_y >= ed_y) continue;
+
+        float* base = data + i / clip_len * num_c * clip_len * img_h * img_w +
+                      j * clip_len * img_h * img_w +
+                      i % clip_len * img_h * img_w;
+        for (int patch_x = st_x; patch_x < ed_x; patch_x++)
+          for (int patch_y = st_y; patch_y < ed_y; patch_y++) {
+            float value = exp(-(std::pow(patch_x - mu_x, 2) +
+                                std::pow(patch_y - mu_y, 2)) /
+                              2 / std::pow(sigma, 2)) *
+                          sampled_keypoint_scores[i]->at(person_id)->at(j);
+            value *= input_scale;
+            if (value > *(base + patch_y * img_w + patch_x)) {
+              *(base + patch_y * img_w + patch_x) = value;
+              *(base + patch_y * img_w + patch_x + heatmap_start_indx) = value;
+            }
+          }
+      }
+    }
+  }
+}
+
+/**
+ * @brief 每个人在画面内随机游走，部分关键点置信度为0或超出画面
+ */
+void makePoses(const BenchmarkConfig& config, PoseSequence& poses,
+               fpptr_dim3& keypoints, fpptr_dim3& scores) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::normal_distribution<float> step(0.f, 0.8f);
+  std::vector<float> centers(config.persons * 2);
+  for (float& value : centers)
+    value = config.size * (0.2f + 0.6f * uniform(rng));
+
+  poses.reset(config.keypoints);
+  for (int f = 0; f < config.frames; ++f) {
+    poses.beginFrame();
+    auto frameKeypoints = std::make_shared<fpptr_dim2>();
+    auto frameScores = std::make_shared<fpptr_dim2>();
+    for (int p = 0; p < config.persons; ++p) {
+      centers[p * 2] += step(rng);
+      centers[p * 2 + 1] += step(rng);
+      std::vector<float> kps(config.keypoints * 2);
+      std::vector<float> kpScores(config.keypoints);
+      for (int k = 0; k < config.keypoints; ++k) {
+        kps[k * 2] =
+            centers[p * 2] + (uniform(rng) - 0.5f) * config.size * 0.6f;
+        kps[k * 2 + 1] =
+            centers[p * 2 + 1] + (uniform(rng) - 0.5f) * config.size * 0.9f;
+        float score = uniform(rng);
+        kpScores[k] = score < 0.1f ? 0.f : score;
+      }
+      poses.addPerson(kps, kpScores);
+      frameKeypoints->push_back(std::make_shared<std::vector<float>>(kps));
+      frameScores->push_back(std::make_shared<std::vector<float>>(kpScores));
+    }
+    keypoints.push_back(frameKeypoints);
+    scores.push_back(frameScores);
+  }
+}
+
+/**
+ * @return 与expected不一致的float个数
+ */
+std::size_t countMismatches(const float* actual,
+                            const std::vector<float>& expected,
+                            float& maxDiff) {
+  maxDiff = 0.f;
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    float diff = std::fabs(actual[i] - expected[i]);
+    maxDiff = std::max(maxDiff, diff);
+    if (diff > 1e-6f * std::max(1.f, std::fabs(expected[i]))) ++mismatches;
+  }
+  return mismatches;
+}
+
+/**
+ * @brief 调用repeats次fn(r)，返回单次耗时的中位数；内存带宽受干扰时均值波动较大
+ */
+template <typename Fn>
+double medianMs(int repeats, Fn fn) {
+  std::vector<double> times;
+  for (int r = 0; r < repeats; ++r) {
+    auto begin = std::chrono::steady_clock::now();
+    fn(r);
+    times.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - begin)
+                        .count());
+  }
+  std::nth_element(times.begin(), times.begin() + times.size() / 2,
+                   times.end());
+  return times[times.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.frames = std::atoi(argv[1]);
+  if (argc > 2) config.persons = std::atoi(argv[2]);
+  if (argc > 3) config.threads = std::atoi(argv[3]);
+  if (argc > 4) config.numClips = std::atoi(argv[4]);
+
+  PoseSequence poses;
+  fpptr_dim3 keypoints, scores;
+  makePoses(config, poses, keypoints, scores);
+
+  // 与uniformSampleFrames一样，每个clip在全部帧中均匀取clipLen帧
+  std::vector<int> inds;
+  fpptr_dim3 sampledKeypoints, sampledScores;
+  for (int c = 0; c < config.numClips; ++c) {
+    for (int t = 0; t < config.clipLen; ++t) {
+      int frame = (t * config.frames / config.clipLen + c) % config.frames;
+      inds.push_back(frame);
+      sampledKeypoints.push_back(keypoints[frame]);
+      sampledScores.push_back(scores[frame]);
+    }
+  }
+
+  PoseHeatmapParams params;
+  params.channels = config.keypoints;
+  params.clipLen = config.clipLen;
+  params.height = config.size;
+  params.width = config.size;
+  params.sigma = config.sigma;
+  params.scale = config.scale;
+  std::size_t outNum = static_cast<std::size_t>(config.numClips) * 2 *
+                       config.keypoints * config.clipLen * config.size *
+                       config.size;
+  std::vector<float> expected(outNum), actual(outNum);
+  std::printf("frames: %d, persons: %d, clips: %d, heatmap: %.1f MB\n",
+              config.frames, config.persons, config.numClips,
+              outNum * sizeof(float) / 1048576.0);
+
+  legacyPoseTarget(sampledKeypoints, sampledScores, config.keypoints,
+                   config.size, config.size, expected.data(),
+                   static_cast<int>(outNum), config.sigma, config.scale,
+                   config.clipLen);
+  std::vector<int> threadNumbers = {1};
+  if (config.threads > 1) threadNumbers.push_back(config.threads);
+  for (int threads : threadNumbers) {
+    std::fill(actual.begin(), actual.end(), -1.f);
+    if (!generatePoseHeatmap(poses, inds, params, actual.data(), outNum,
+                             threads)) {
+      std::printf("generatePoseHeatmap rejected the layout\n");
+      return 1;
+    }
+    float maxDiff = 0.f;
+    std::size_t mismatches = countMismatches(actual.data(), expected, maxDiff);
+    std::printf("equivalence (%d threads): %s, max abs diff: %g\n", threads,
+                mismatches == 0 ? "ok" : "FAILED", maxDiff);
+    if (mismatches != 0) return 1;
+  }
+
+  // 先用另一组采样帧画一次，检查第二次只清零上次写入的区域后结果仍然一致
+  std::vector<int> shiftedInds(inds.rbegin(), inds.rend());
+  PoseHeatmapCanvas canvas;
+  canvas.generate(poses, shiftedInds, params, outNum, config.threads);
+  canvas.generate(poses, inds, params, outNum, config.threads);
+  {
+    float maxDiff = 0.f;
+    std::size_t mismatches = countMismatches(canvas.data(), expected, maxDiff);
+    std::printf("equivalence (canvas reuse): %s, max abs diff: %g\n",
+                mismatches == 0 ? "ok" : "FAILED", maxDiff);
+    if (mismatches != 0) return 1;
+  }
+  // 采样帧超出容量时返回false，heatmap应全为0；人数较多时上一次是整块清零，
+  // 需要把上一次写入的高斯核也清零
+  {
+    std::vector<int> tooMany(inds);
+    tooMany.insert(tooMany.end(), inds.begin(), inds.end());
+    bool rejected =
+        !canvas.generate(poses, tooMany, params, outNum, config.threads);
+    bool zero = std::all_of(canvas.data(), canvas.data() + canvas.size(),
+                            [](float value) { return value == 0.f; });
+    std::printf("canvas rejects oversized clip: %s\n",
+                rejected && zero ? "ok" : "FAILED");
+    if (!rejected || !zero) return 1;
+  }
+
+  // 两种实现都要把整个heatmap写一遍，清零的耗时是下限
+  std::printf("memset only     : %8.2f ms/clip\n",
+              medianMs(config.repeats, [&](int) {
+                std::memset(actual.data(), 0, outNum * sizeof(float));
+              }));
+  std::printf("legacy          : %8.2f ms/clip\n",
+              medianMs(config.repeats, [&](int) {
+                legacyPoseTarget(sampledKeypoints, sampledScores,
+                                 config.keypoints, config.size, config.size,
+                                 expected.data(), static_cast<int>(outNum),
+                                 config.sigma, config.scale, config.clipLen);
+              }));
+  for (int threads : threadNumbers) {
+    std::printf("flat %2d threads : %8.2f ms/clip\n", threads,
+                medianMs(config.repeats, [&](int) {
+                  generatePoseHeatmap(poses, inds, params, actual.data(),
+                                      outNum, threads);
+                }));
+  }
+  // 原pcie流程每个clip都new一块heatmap，这里包括申请内存和缺页的开销
+  std::printf("new + flat      : %8.2f ms/clip\n",
+              medianMs(config.repeats, [&](int) {
+                std::unique_ptr<float[]> heatmap(new float[outNum]);
+                generatePoseHeatmap(poses, inds, params, heatmap.get(),
+                                    outNum, config.threads);
+              }));
+  std::printf("canvas          : %8.2f ms/clip\n",
+              medianMs(config.repeats, [&](int r) {
+                canvas.generate(poses, r % 2 ? inds : shiftedInds, params,
+                                outNum, config.threads);
+              }));
+  return 0;
+}
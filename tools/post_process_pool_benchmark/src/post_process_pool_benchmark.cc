@@ -0,0 +1,204 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比推理线程自己做后处理（inline）与把后处理交给PostProcessPool（pool）时的TPU空闲比例：
+// 推理用一把全局锁加sleep模拟，同一时刻只有一个batch占用TPU；后处理用CPU空转模拟。
+// 多路码流按channel % infer_threads分配到推理线程，与element的dataPipe一致，
+// 检查每一路码流推送到下游时帧号仍然有序。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "algorithmApi/post_process_pool.h"
+
+namespace {
+
+using sophon_stream::element::PostProcessPool;
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkConfig {
+  int channels = 4;
+  int framesPerChannel = 200;
+  int batch = 4;
+  int inferUs = 4000;
+  int postUs = 6000;
+  int inferThreads = 1;
+  int postThreads = 4;
+};
+
+struct Frame {
+  int channel;
+  int frameId;
+};
+
+void spin(int us) {
+  auto end = Clock::now() + std::chrono::microseconds(us);
+  while (Clock::now() < end) {
+  }
+}
+
+/**
+ * @brief 模拟的TPU，一次只执行一个batch，累计忙碌时间
+ */
+class SimulatedTpu {
+ public:
+  void infer(int us) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto begin = Clock::now();
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    mBusy += Clock::now() - begin;
+  }
+
+  double busySeconds() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::chrono::duration<double>(mBusy).count();
+  }
+
+ private:
+  std::mutex mMutex;
+  Clock::duration mBusy{0};
+};
+
+/**
+ * @brief 模拟的下游，记录每一路码流收到的最后一个帧号
+ */
+class Sink {
+ public:
+  explicit Sink(int channels) : mLastFrameId(channels, -1) {}
+
+  void push(const std::vector<Frame>& frames) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto& frame : frames) {
+      if (frame.frameId != mLastFrameId[frame.channel] + 1) mOrdered = false;
+      mLastFrameId[frame.channel] = frame.frameId;
+      ++mFrames;
+    }
+  }
+
+  bool ordered() const { return mOrdered; }
+  int frames() const { return mFrames; }
+
+ private:
+  std::mutex mMutex;
+  std::vector<int> mLastFrameId;
+  bool mOrdered = true;
+  int mFrames = 0;
+};
+
+struct Result {
+  double seconds;
+  double tpuIdle;
+  int frames;
+  bool ordered;
+};
+
+Result run(const BenchmarkConfig& config, bool usePool) {
+  SimulatedTpu tpu;
+  Sink sink(config.channels);
+  PostProcessPool pool(config.postThreads, 0, config.inferThreads);
+  if (usePool) pool.start();
+
+  auto begin = Clock::now();
+  std::vector<std::thread> threads;
+  for (int pipe = 0; pipe < config.inferThreads; ++pipe) {
+    threads.emplace_back([&, pipe] {
+      // 当前推理线程负责的码流，轮流从各路取帧组成batch
+      std::vector<int> channels;
+      for (int c = pipe; c < config.channels; c += config.inferThreads)
+        channels.push_back(c);
+      std::vector<int> nextFrameId(channels.size(), 0);
+      std::mt19937 rng(pipe);
+      std::uniform_real_distribution<float> jitter(0.5f, 1.5f);
+      size_t cursor = 0;
+      int remaining = channels.size() * config.framesPerChannel;
+      while (remaining > 0) {
+        std::vector<Frame> frames;
+        while (static_cast<int>(frames.size()) < config.batch &&
+               remaining > 0) {
+          size_t i = cursor++ % channels.size();
+          if (nextFrameId[i] == config.framesPerChannel) continue;
+          frames.push_back({channels[i], nextFrameId[i]++});
+          --remaining;
+        }
+
+        tpu.infer(config.inferUs);
+        // 后处理耗时随检测框数量波动，使各batch的完成顺序与提交顺序不同
+        int postUs = config.postUs * frames.size() / config.batch *
+                     jitter(rng);
+        if (usePool) {
+          pool.submit(
+              pipe, [postUs](int) { spin(postUs); },
+              [&sink, frames]() { sink.push(frames); });
+        } else {
+          spin(postUs);
+          sink.push(frames);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  pool.stop();
+  double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+  return {seconds, 1 - tpu.busySeconds() / seconds, sink.frames(),
+          sink.ordered()};
+}
+
+void print(const char* name, const Result& result) {
+  std::cout << name << ": " << result.frames / result.seconds
+            << " fps, tpu idle " << result.tpuIdle * 100 << "%"
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.channels = std::atoi(argv[1]);
+  if (argc > 2) config.inferUs = std::atoi(argv[2]);
+  if (argc > 3) config.postUs = std::atoi(argv[3]);
+  if (argc > 4) config.inferThreads = std::atoi(argv[4]);
+  if (argc > 5) config.postThreads = std::atoi(argv[5]);
+  if (argc > 6) config.framesPerChannel = std::atoi(argv[6]);
+  if (config.channels <= 0 || config.inferUs < 0 || config.postUs < 0 ||
+      config.inferThreads <= 0 || config.postThreads <= 0 ||
+      config.framesPerChannel <= 0) {
+    std::cerr << "usage: " << argv[0]
+              << " [channels] [infer_us] [post_us] [infer_threads]"
+                 " [post_threads] [frames_per_channel]"
+              << std::endl;
+    return 1;
+  }
+  config.inferThreads = std::min(config.inferThreads, config.channels);
+
+  std::cout << "channels: " << config.channels << ", batch: " << config.batch
+            << ", infer: " << config.inferUs << " us/batch, post: "
+            << config.postUs << " us/batch, infer threads: "
+            << config.inferThreads << ", post threads: " << config.postThreads
+            << std::endl;
+
+  Result inlineResult = run(config, false);
+  Result poolResult = run(config, true);
+  const int expected = config.channels * config.framesPerChannel;
+  if (inlineResult.frames != expected || poolResult.frames != expected ||
+      !inlineResult.ordered || !poolResult.ordered) {
+    std::cerr << "frames lost or out of order" << std::endl;
+    return 1;
+  }
+  std::cout << "order: ok" << std::endl;
+  print("inline", inlineResult);
+  print("pool  ", poolResult);
+  return 0;
+}
@@ -0,0 +1,255 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比element线程调度与pool调度的合成压测：
+// 多个只做CPU空转的element串成一条链，多路码流并发送入，统计吞吐、线程数和上下文切换次数，
+// 并检查每一路码流到达sink时帧号仍然有序。element之间的connection可以选择mutex、spsc、mpsc队列。
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "element.h"
+#include "worker_pool.h"
+
+namespace {
+
+using sophon_stream::common::ErrorCode;
+using sophon_stream::framework::DataPipeConfig;
+using sophon_stream::framework::DataPipeType;
+using sophon_stream::framework::Element;
+using sophon_stream::framework::ListenThread;
+using sophon_stream::framework::WorkerPool;
+
+struct SyntheticFrame {
+  int channel;
+  int frameId;
+};
+
+class SyntheticElement : public Element {
+ public:
+  explicit SyntheticElement(int workUs) : mWorkUs(workUs) {}
+
+ protected:
+  ErrorCode initInternal(const std::string& json) override {
+    return ErrorCode::SUCCESS;
+  }
+
+  ErrorCode doWork(int dataPipeId) override {
+    int inputPort = getInputPorts()[0];
+    auto data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+    while (!data && shouldWaitInputData()) {
+      data = popInputData(inputPort, dataPipeId, DATA_PIPE_WAIT_TIMEOUT);
+    }
+    if (data == nullptr) return ErrorCode::SUCCESS;
+
+    // 模拟前后处理的CPU开销
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(mWorkUs);
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+
+    auto frame = std::static_pointer_cast<SyntheticFrame>(data);
+    int outputPort = 0;
+    int outDataPipeId =
+        getSinkElementFlag()
+            ? 0
+            : (frame->channel % getOutputConnectorCapacity(outputPort));
+    return pushOutputData(outputPort, outDataPipeId, data);
+  }
+
+ private:
+  int mWorkUs;
+};
+
+struct BenchmarkConfig {
+  int elements = 16;
+  int threads = 8;
+  int channels = 16;
+  int frames = 500;
+  int workUs = 50;
+  int poolThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<DataPipeType> queueTypes = {
+      DataPipeType::MUTEX, DataPipeType::SPSC, DataPipeType::MPSC};
+};
+
+struct BenchmarkResult {
+  double seconds = 0;
+  int threads = 0;
+  long contextSwitches = 0;
+  int outOfOrder = 0;
+  int received = 0;
+};
+
+int currentThreadCount() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 8, "Threads:") == 0) return std::stoi(line.substr(8));
+  }
+  return -1;
+}
+
+long currentContextSwitches() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+BenchmarkResult runBenchmark(const BenchmarkConfig& config,
+                             DataPipeType queueType,
+                             std::shared_ptr<WorkerPool> workerPool) {
+  std::vector<std::shared_ptr<SyntheticElement>> elements;
+  for (int i = 0; i < config.elements; ++i) {
+    auto element = std::make_shared<SyntheticElement>(config.workUs);
+    element->setId(i);
+    element->setThreadNumber(config.threads);
+    element->setListener(ListenThread::getInstance());
+    elements.push_back(element);
+  }
+  // 每个element都把码流channel送到第channel % threads个dataPipe，下游的每个dataPipe
+  // 只由上游同一个dataPipe的doWork push，因此element之间可以使用spsc队列。
+  // 第一个element的输入由各路码流线程push，保持mutex队列
+  DataPipeConfig dataPipeConfig;
+  dataPipeConfig.type = queueType;
+  for (int i = 0; i + 1 < config.elements; ++i) {
+    Element::connect(*elements[i], 0, *elements[i + 1], 0, dataPipeConfig);
+  }
+  elements[0]->addInputPort(0);
+  auto sink = elements.back();
+  sink->setSinkFlag(true);
+  sink->addOutputPort(0);
+
+  BenchmarkResult result;
+  std::mutex sinkMutex;
+  std::map<int, int> lastFrameIds;
+  std::atomic<int> received{0};
+  sink->setSinkHandler(0, [&](std::shared_ptr<void> data) {
+    auto frame = std::static_pointer_cast<SyntheticFrame>(data);
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    auto it = lastFrameIds.find(frame->channel);
+    if (it != lastFrameIds.end() && it->second >= frame->frameId) {
+      ++result.outOfOrder;
+    }
+    lastFrameIds[frame->channel] = frame->frameId;
+    received.fetch_add(1);
+  });
+
+  long contextSwitches = currentContextSwitches();
+  auto begin = std::chrono::steady_clock::now();
+  for (auto& element : elements) {
+    element->setWorkerPool(workerPool);
+    element->start();
+  }
+
+  // 与decode相同，每一路码流由单独的线程送入
+  std::vector<std::thread> sources;
+  for (int channel = 0; channel < config.channels; ++channel) {
+    sources.emplace_back([&, channel]() {
+      for (int frameId = 0; frameId < config.frames; ++frameId) {
+        auto frame = std::make_shared<SyntheticFrame>();
+        frame->channel = channel;
+        frame->frameId = frameId;
+        elements[0]->pushInputData(0, channel % config.threads, frame);
+      }
+    });
+  }
+
+  int total = config.channels * config.frames;
+  while (received.load() < total) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    result.threads = std::max(result.threads, currentThreadCount());
+  }
+  auto end = std::chrono::steady_clock::now();
+  result.contextSwitches = currentContextSwitches() - contextSwitches;
+
+  for (auto& source : sources) source.join();
+  for (auto& element : elements) element->stop();
+
+  result.seconds = std::chrono::duration<double>(end - begin).count();
+  result.received = received.load();
+  return result;
+}
+
+void printResult(const std::string& name, const BenchmarkResult& result) {
+  double fps = result.received / result.seconds;
+  std::cout << name << ": " << result.seconds << " s, " << fps
+            << " frames/s, peak threads " << result.threads
+            << ", context switches " << result.contextSwitches
+            << ", out of order " << result.outOfOrder << std::endl;
+}
+
+bool parseQueueTypes(const std::string& names,
+                     std::vector<DataPipeType>& types) {
+  types.clear();
+  std::stringstream stream(names);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    DataPipeType type;
+    // lockfree由graph根据拓扑决定，这里需要明确指定
+    if (name == "lockfree" ||
+        !sophon_stream::framework::dataPipeTypeFromString(name, type)) {
+      return false;
+    }
+    types.push_back(type);
+  }
+  return !types.empty();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // usage: scheduler_benchmark [elements] [threads] [channels] [frames] [work_us]
+  //                            [pool_threads] [queue_types]
+  BenchmarkConfig config;
+  int* fields[] = {&config.elements, &config.threads,  &config.channels,
+                   &config.frames,   &config.workUs,   &config.poolThreads};
+  for (int i = 1; i < argc && i <= 6; ++i) {
+    *fields[i - 1] = std::atoi(argv[i]);
+  }
+  if (argc > 7 && !parseQueueTypes(argv[7], config.queueTypes)) {
+    std::cerr << "queue_types must be a comma separated list of "
+                 "mutex/spsc/mpsc: "
+              << argv[7] << std::endl;
+    return -1;
+  }
+  std::cout << "elements " << config.elements << ", threads per element "
+            << config.threads << ", channels " << config.channels
+            << ", frames per channel " << config.frames << ", work "
+            << config.workUs << " us, pool threads " << config.poolThreads
+            << std::endl;
+
+  for (DataPipeType queueType : config.queueTypes) {
+    std::string queueName =
+        sophon_stream::framework::dataPipeTypeToString(queueType);
+    queueName.resize(6, ' ');
+    printResult("thread " + queueName,
+                runBenchmark(config, queueType, nullptr));
+
+    auto workerPool = std::make_shared<WorkerPool>(config.poolThreads,
+                                                   config.poolThreads * 2);
+    workerPool->start();
+    printResult("pool   " + queueName,
+                runBenchmark(config, queueType, workerPool));
+    workerPool->stop();
+  }
+
+  return 0;
+}
@@ -0,0 +1,208 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 对比http_push的两种序列化方式：
+// json:   与serialize.h中to_json相同的字段，图像base64编码后dump为字符串
+// binary: binary_serialize.h的二进制格式，写入复用的BinaryWriter
+// 图像使用固定大小的随机数据代替JPEG编码结果，两种方式的JPEG编码耗时相同，不计入。
+// serialize.h中的to_json依赖bmcv做JPEG编码，这里按相同的字段顺序构造JSON。
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+
+#include "common/binary_serialize.h"
+#include "common/object_metadata.h"
+
+namespace {
+
+std::atomic<std::uint64_t> gAllocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using sophon_stream::common::BinaryWriter;
+using sophon_stream::common::DetectedObjectMetadata;
+using sophon_stream::common::Frame;
+using sophon_stream::common::ObjectMetadata;
+using sophon_stream::common::TrackedObjectMetadata;
+
+struct BenchmarkConfig {
+  int frames = 2000;
+  int objects = 20;
+  /**
+   * @brief 模拟的JPEG大小，单位KB
+   */
+  int jpegKB = 100;
+};
+
+std::string base64Encode(const std::string& data) {
+  static const char table[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((data.size() + 2) / 3 * 4);
+  std::size_t i = 0;
+  for (; i + 2 < data.size(); i += 3) {
+    std::uint32_t v = (static_cast<unsigned char>(data[i]) << 16) |
+                      (static_cast<unsigned char>(data[i + 1]) << 8) |
+                      static_cast<unsigned char>(data[i + 2]);
+    out += table[(v >> 18) & 0x3f];
+    out += table[(v >> 12) & 0x3f];
+    out += table[(v >> 6) & 0x3f];
+    out += table[v & 0x3f];
+  }
+  if (i < data.size()) {
+    std::uint32_t v = static_cast<unsigned char>(data[i]) << 16;
+    if (i + 1 < data.size()) v |= static_cast<unsigned char>(data[i + 1]) << 8;
+    out += table[(v >> 18) & 0x3f];
+    out += table[(v >> 12) & 0x3f];
+    out += i + 1 < data.size() ? table[(v >> 6) & 0x3f] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+std::shared_ptr<ObjectMetadata> makeObjectMetadata(
+    const BenchmarkConfig& config) {
+  auto objectMetadata = std::make_shared<ObjectMetadata>();
+  objectMetadata->mFrame = std::make_shared<Frame>();
+  objectMetadata->mFrame->mChannelId = 3;
+  objectMetadata->mFrame->mFrameId = 12345;
+  objectMetadata->mFrame->mTimestamp = 1700000000000;
+  objectMetadata->mFrame->mWidth = 1920;
+  objectMetadata->mFrame->mHeight = 1080;
+  // 只用于表示帧中有图像，内容由encoder给出
+  objectMetadata->mFrame->mSpData = std::make_shared<bm_image>();
+  objectMetadata->fps = 25.5f;
+  for (int i = 0; i < config.objects; ++i) {
+    auto detData = std::make_shared<DetectedObjectMetadata>();
+    detData->mBox.mX = 10 * i;
+    detData->mBox.mY = 5 * i;
+    detData->mBox.mWidth = 64;
+    detData->mBox.mHeight = 128;
+    detData->mClassify = i % 80;
+    detData->mScores.push_back(0.5f + 0.01f * i);
+    objectMetadata->mDetectedObjectMetadatas.push_back(detData);
+    auto trackData = std::make_shared<TrackedObjectMetadata>();
+    trackData->mTrackId = 1000 + i;
+    objectMetadata->mTrackedObjectMetadatas.push_back(trackData);
+  }
+  return objectMetadata;
+}
+
+nlohmann::json toJson(const ObjectMetadata& obj, const std::string& jpeg) {
+  nlohmann::json j;
+  for (auto& detObj : obj.mDetectedObjectMetadatas) {
+    nlohmann::json det;
+    det["mBox"] = {{"mX", detObj->mBox.mX},
+                   {"mY", detObj->mBox.mY},
+                   {"mWidth", detObj->mBox.mWidth},
+                   {"mHeight", detObj->mBox.mHeight}};
+    det["mScores"] = detObj->mScores;
+    det["mClassify"] = detObj->mClassify;
+    j["mDetectedObjectMetadatas"].push_back(det);
+  }
+  for (auto& trackObj : obj.mTrackedObjectMetadatas) {
+    j["mTrackedObjectMetadatas"].push_back({{"mTrackId", trackObj->mTrackId}});
+  }
+  j["mFps"] = obj.fps;
+  const Frame& frame = *obj.mFrame;
+  j["mFrame"] = {{"mChannelId", frame.mChannelId},
+                 {"mFrameId", frame.mFrameId},
+                 {"mTimestamp", frame.mTimestamp},
+                 {"mWidth", frame.mWidth},
+                 {"mHeight", frame.mHeight},
+                 {"mEndOfStream", frame.mEndOfStream},
+                 {"mSpData", base64Encode(jpeg)}};
+  j["mSubId"] = obj.mSubId;
+  j["mGraphId"] = obj.mGraphId;
+  return j;
+}
+
+template <typename Func>
+void runBenchmark(const std::string& name, const BenchmarkConfig& config,
+                  Func&& serialize) {
+  // 预热，使复用的缓冲区达到稳定容量
+  std::size_t bytes = 0;
+  for (int i = 0; i < 10; ++i) bytes = serialize();
+
+  std::uint64_t allocationsBegin = gAllocations.load();
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < config.frames; ++i) bytes = serialize();
+  auto end = std::chrono::steady_clock::now();
+  std::uint64_t allocations = gAllocations.load() - allocationsBegin;
+
+  double seconds = std::chrono::duration<double>(end - begin).count();
+  std::cout << name << ": " << bytes << " bytes/frame, "
+            << static_cast<double>(allocations) / config.frames
+            << " allocations/frame, " << seconds * 1e6 / config.frames
+            << " us/frame" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.frames = std::atoi(argv[1]);
+  if (argc > 2) config.objects = std::atoi(argv[2]);
+  if (argc > 3) config.jpegKB = std::atoi(argv[3]);
+  if (config.frames <= 0 || config.objects < 0 || config.jpegKB < 0) {
+    std::cerr << "usage: " << argv[0] << " [frames] [objects] [jpeg_kb]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string jpeg(config.jpegKB * 1024, '\0');
+  std::mt19937 rng(0);
+  for (auto& c : jpeg) c = static_cast<char>(rng());
+  auto objectMetadata = makeObjectMetadata(config);
+  auto encoder = [&jpeg](const Frame&, std::string& out) {
+    out.append(jpeg);
+    return true;
+  };
+
+  // 解码后的结果应与JSON格式完全一致
+  BinaryWriter writer;
+  sophon_stream::common::serializeBinary(writer, *objectMetadata, encoder);
+  nlohmann::json decoded;
+  if (!sophon_stream::common::binaryToJson(writer.buffer().data(),
+                                           writer.buffer().size(), decoded) ||
+      decoded != toJson(*objectMetadata, jpeg)) {
+    std::cerr << "binary result does not match json result" << std::endl;
+    return 1;
+  }
+
+  runBenchmark("json  ", config, [&]() {
+    std::string body = toJson(*objectMetadata, jpeg).dump();
+    return body.size();
+  });
+  runBenchmark("binary", config, [&]() {
+    writer.clear();
+    sophon_stream::common::serializeBinary(writer, *objectMetadata, encoder);
+    return writer.buffer().size();
+  });
+  return 0;
+}
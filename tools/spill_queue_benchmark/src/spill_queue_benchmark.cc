@@ -0,0 +1,416 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 验证common/spill_queue.h的磁盘暂存队列：
+// throughput: 2KB记录的追加和读取确认速度
+// crash:      子进程边写边确认，随机时刻SIGKILL，父进程重新打开后检查记录连续、
+//             确认位置不倒退超过一条，然后继续下一轮
+// cap:        写入超过磁盘上限的数据，检查占用不超过上限、丢弃的是最旧的记录
+// outage:     PushSender向本进程内的httplib::Server发送，中途接收端一段时间内返回503，
+//             对比不启用和启用磁盘暂存时送达的数量、顺序和恢复后的重放速率
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/spill_queue.h"
+#include "httplib.h"
+#include "push_sender.h"
+
+namespace {
+
+using sophon_stream::common::SpillQueue;
+using sophon_stream::common::SpillQueueConfig;
+using sophon_stream::common::SpillRecord;
+using sophon_stream::element::http_push::PushSender;
+using sophon_stream::element::http_push::PushSenderConfig;
+using Clock = std::chrono::steady_clock;
+
+constexpr const char* PUSH_PATH = "/stream/test";
+constexpr const char* CONTENT_TYPE = "application/json";
+
+struct BenchmarkConfig {
+  std::string dir = "/tmp/spill_queue_benchmark";
+  int channels = 16;
+  int senders = 4;
+  int fps = 25;
+  int seconds = 10;
+  /**
+   * @brief 接收端在[outageBegin, outageBegin + outageSeconds)秒内不可用
+   */
+  int outageBegin = 2;
+  int outageSeconds = 4;
+  int replayRate = 500;
+  int crashRounds = 20;
+};
+
+void removeDir(const std::string& dir) {
+  std::string cmd = "rm -rf '" + dir + "'";
+  if (std::system(cmd.c_str()) != 0) std::cerr << "rm " << dir << " fail\n";
+}
+
+std::string makeRecord(std::uint64_t seq, size_t size) {
+  std::string record = std::to_string(seq);
+  record.resize(size, 'x');
+  return record;
+}
+
+std::uint64_t recordSeq(const std::string& record) {
+  return std::strtoull(record.c_str(), nullptr, 10);
+}
+
+/**
+ * @brief 读出队列中所有未确认的记录序号，不确认
+ */
+std::vector<std::uint64_t> pendingSeqs(SpillQueue& queue) {
+  std::vector<SpillRecord> records;
+  size_t count = queue.peek(records, queue.getPendingCount());
+  std::vector<std::uint64_t> seqs;
+  for (size_t i = 0; i < count; ++i) seqs.push_back(recordSeq(records[i].body));
+  return seqs;
+}
+
+bool consecutive(const std::vector<std::uint64_t>& seqs) {
+  for (size_t i = 1; i < seqs.size(); ++i) {
+    if (seqs[i] != seqs[i - 1] + 1) return false;
+  }
+  return true;
+}
+
+void runThroughput(const BenchmarkConfig& config) {
+  std::string dir = config.dir + "/throughput";
+  removeDir(dir);
+  SpillQueueConfig queueConfig;
+  queueConfig.dir = dir;
+  queueConfig.maxBytes = 1ull << 30;
+  SpillQueue queue(queueConfig);
+  queue.open();
+
+  const int count = 100000;
+  const size_t size = 2048;
+  std::string record = makeRecord(0, size);
+  auto begin = Clock::now();
+  for (int i = 0; i < count; ++i)
+    queue.append(CONTENT_TYPE, record.data(), record.size());
+  double appendSeconds =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+
+  std::vector<SpillRecord> records;
+  begin = Clock::now();
+  size_t replayed = 0;
+  while (size_t n = queue.peek(records, 32)) {
+    queue.ack(n);
+    replayed += n;
+  }
+  double replaySeconds =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+  std::cout << "throughput: " << count << " x " << size << " bytes, append "
+            << count / appendSeconds << " records/s ("
+            << count * size / appendSeconds / (1 << 20) << " MB/s), replay "
+            << replayed / replaySeconds << " records/s, disk after replay "
+            << queue.getDiskBytes() / (1 << 20) << " MB" << std::endl;
+}
+
+/**
+ * @brief 子进程：从nextSeq开始追加，同时按一半的速度确认，acked记录最后确认的序号
+ */
+[[noreturn]] void crashChild(const std::string& dir, std::uint64_t nextSeq,
+                             std::atomic<std::uint64_t>* acked) {
+  SpillQueueConfig queueConfig;
+  queueConfig.dir = dir;
+  queueConfig.maxBytes = 1ull << 30;
+  queueConfig.segmentBytes = 1ull << 20;
+  SpillQueue queue(queueConfig);
+  if (!queue.open()) _exit(1);
+  std::mt19937 rng(static_cast<unsigned>(nextSeq));
+  std::vector<SpillRecord> records;
+  for (std::uint64_t seq = nextSeq;; ++seq) {
+    std::string record = makeRecord(seq, 64 + rng() % 4096);
+    queue.append(CONTENT_TYPE, record.data(), record.size());
+    if (seq % 2 == 0 && queue.peek(records, 1) == 1) {
+      std::uint64_t head = recordSeq(records[0].body);
+      queue.ack(1);
+      acked->store(head);
+    }
+  }
+}
+
+bool runCrash(const BenchmarkConfig& config) {
+  std::string dir = config.dir + "/crash";
+  removeDir(dir);
+  auto* acked = static_cast<std::atomic<std::uint64_t>*>(
+      mmap(nullptr, sizeof(std::atomic<std::uint64_t>),
+           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+  new (acked) std::atomic<std::uint64_t>(0);
+
+  std::mt19937 rng(7);
+  std::uint64_t nextSeq = 1;
+  for (int round = 0; round < config.crashRounds; ++round) {
+    std::uint64_t ackedBefore = acked->load();
+    pid_t pid = fork();
+    if (pid == 0) crashChild(dir, nextSeq, acked);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50 + rng() % 200));
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+
+    SpillQueueConfig queueConfig;
+    queueConfig.dir = dir;
+    queueConfig.maxBytes = 1ull << 30;
+    queueConfig.segmentBytes = 1ull << 20;
+    SpillQueue queue(queueConfig);
+    if (!queue.open()) {
+      std::cout << "crash: round " << round << " open fail" << std::endl;
+      return false;
+    }
+    std::vector<std::uint64_t> seqs = pendingSeqs(queue);
+    std::uint64_t lastAcked = std::max(acked->load(), ackedBefore);
+    // ack()返回后才写入lastAcked，两者之间被杀时队首比lastAcked多前进一条
+    bool ok = !seqs.empty() && consecutive(seqs) &&
+              (seqs.front() == lastAcked + 1 || seqs.front() == lastAcked + 2);
+    if (!ok) {
+      std::cout << "crash: round " << round << " broken, " << seqs.size()
+                << " pending, first "
+                << (seqs.empty() ? 0 : seqs.front()) << ", last acked "
+                << lastAcked << std::endl;
+      return false;
+    }
+    acked->store(seqs.front() - 1);
+    nextSeq = seqs.back() + 1;
+  }
+  std::cout << "crash: " << config.crashRounds << " rounds killed, "
+            << nextSeq - 1 << " records written, all recovered in order, "
+            << "ack position never behind the last ack" << std::endl;
+  munmap(acked, sizeof(std::atomic<std::uint64_t>));
+  return true;
+}
+
+bool runCap(const BenchmarkConfig& config) {
+  std::string dir = config.dir + "/cap";
+  removeDir(dir);
+  SpillQueueConfig queueConfig;
+  queueConfig.dir = dir;
+  queueConfig.maxBytes = 4ull << 20;
+  queueConfig.segmentBytes = 1ull << 20;
+  SpillQueue queue(queueConfig);
+  queue.open();
+  const std::uint64_t count = 10000;
+  std::uint64_t maxDisk = 0;
+  for (std::uint64_t seq = 1; seq <= count; ++seq) {
+    std::string record = makeRecord(seq, 1000);
+    queue.append(CONTENT_TYPE, record.data(), record.size());
+    maxDisk = std::max(maxDisk, queue.getDiskBytes());
+  }
+  std::vector<std::uint64_t> seqs = pendingSeqs(queue);
+  bool ok = maxDisk <= queueConfig.maxBytes && consecutive(seqs) &&
+            !seqs.empty() && seqs.back() == count &&
+            queue.getDroppedCount() + seqs.size() == count;
+  std::cout << "cap: " << count << " x 1000 bytes into 4 MB, max disk "
+            << maxDisk / (1 << 20) << " MB, " << queue.getDroppedCount()
+            << " oldest dropped, " << seqs.size() << " kept ("
+            << (seqs.empty() ? 0 : seqs.front()) << ".." << count << ")"
+            << (ok ? "" : " BROKEN") << std::endl;
+  return ok;
+}
+
+/**
+ * @brief 结果收集服务，不可用期间所有请求返回503
+ */
+class Collector {
+ public:
+  Collector() {
+    mServer.set_keep_alive_max_count(100000);
+    mServer.set_tcp_nodelay(true);
+    mServer.Post(PUSH_PATH, [this](const httplib::Request& req,
+                                   httplib::Response& res) {
+      handle(req, res);
+    });
+    mPort = mServer.bind_to_any_port("127.0.0.1");
+    mThread = std::thread([this] { mServer.listen_after_bind(); });
+  }
+
+  ~Collector() {
+    mServer.stop();
+    mThread.join();
+  }
+
+  int getPort() const { return mPort; }
+
+  void setDown(bool down) { mDown = down; }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mItems = 0;
+    mOutOfOrder = 0;
+    mRejected = 0;
+    mLastSeq.clear();
+    mLastReceive = Clock::time_point();
+  }
+
+  size_t mItems = 0;
+  size_t mOutOfOrder = 0;
+  size_t mRejected = 0;
+  Clock::time_point mLastReceive;
+  std::mutex mMutex;
+
+ private:
+  void handle(const httplib::Request& req, httplib::Response& res) {
+    if (mDown) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mRejected;
+      res.status = 503;
+      return;
+    }
+    auto body = nlohmann::json::parse(req.body, nullptr, false);
+    if (body.is_discarded()) {
+      res.status = 400;
+      return;
+    }
+    if (!body.is_array()) body = nlohmann::json::array({body});
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& item : body) {
+      int channel = item["channel"].get<int>();
+      std::int64_t seq = item["seq"].get<std::int64_t>();
+      auto it = mLastSeq.find(channel);
+      if (it != mLastSeq.end() && seq <= it->second) ++mOutOfOrder;
+      mLastSeq[channel] = seq;
+      ++mItems;
+    }
+    mLastReceive = Clock::now();
+    res.set_content("{\"code\":0}", "application/json");
+  }
+
+  httplib::Server mServer;
+  int mPort = 0;
+  std::thread mThread;
+  std::atomic<bool> mDown{false};
+  std::map<int, std::int64_t> mLastSeq;
+};
+
+void runOutage(const BenchmarkConfig& config, Collector& collector,
+               bool spill) {
+  std::string dir = config.dir + "/outage";
+  removeDir(dir);
+  collector.reset();
+  PushSenderConfig senderConfig;
+  senderConfig.ip = "127.0.0.1";
+  senderConfig.port = collector.getPort();
+  senderConfig.path = PUSH_PATH;
+  senderConfig.senders = config.senders;
+  senderConfig.batchSize = 16;
+  senderConfig.batchTimeoutMs = 20;
+  senderConfig.retryIntervalMs = 10;
+  senderConfig.timeoutMs = 1000;
+  if (spill) {
+    senderConfig.spillDir = dir;
+    senderConfig.spillReplayRate = config.replayRate;
+  }
+  PushSender sender(senderConfig);
+  sender.start();
+
+  auto begin = Clock::now();
+  int frames = config.fps * config.seconds;
+  size_t produced = 0, dropped = 0;
+  std::uint64_t maxSpill = 0;
+  Clock::time_point recoverTime;
+  for (int f = 0; f < frames; ++f) {
+    std::this_thread::sleep_until(begin + std::chrono::microseconds(
+                                              1000000LL * f / config.fps));
+    if (f == config.outageBegin * config.fps) collector.setDown(true);
+    if (f == (config.outageBegin + config.outageSeconds) * config.fps) {
+      collector.setDown(false);
+      recoverTime = Clock::now();
+    }
+    for (int c = 0; c < config.channels; ++c) {
+      auto payload = sender.acquirePayload();
+      payload->writer.buffer() =
+          "{\"channel\":" + std::to_string(c) + ",\"seq\":" +
+          std::to_string(f) + ",\"data\":\"" + std::string(1024, 'x') + "\"}";
+      ++produced;
+      if (!sender.push(c, std::move(payload))) ++dropped;
+    }
+    maxSpill = std::max(maxSpill, sender.getSpillSize());
+  }
+  // 等待内存队列和磁盘队列都发送完
+  auto deadline = Clock::now() + std::chrono::seconds(60);
+  while ((sender.getQueueSize() > 0 || sender.getSpillSize() > 0) &&
+         Clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  sender.stop();
+
+  const auto& stats = sender.getStats();
+  std::lock_guard<std::mutex> lock(collector.mMutex);
+  std::cout << (spill ? "spill:    " : "no spill: ") << collector.mItems
+            << "/" << produced << " results delivered, " << dropped
+            << " dropped (queue full), " << stats->failedItems
+            << " failed after retries, " << collector.mRejected
+            << " requests rejected, " << collector.mOutOfOrder
+            << " out of order";
+  if (spill) {
+    double drain =
+        std::chrono::duration<double>(collector.mLastReceive - recoverTime)
+            .count();
+    std::cout << ", " << stats->spilledItems << " spilled (max "
+              << maxSpill << " on disk), " << stats->replayedItems
+              << " replayed, drained " << drain << " s after recovery";
+  }
+  std::cout << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  if (argc > 1) config.channels = std::atoi(argv[1]);
+  if (argc > 2) config.senders = std::atoi(argv[2]);
+  if (argc > 3) config.outageSeconds = std::atoi(argv[3]);
+  if (argc > 4) config.replayRate = std::atoi(argv[4]);
+  if (argc > 5) config.dir = argv[5];
+  config.seconds = config.outageBegin + config.outageSeconds + 4;
+  if (config.channels <= 0 || config.senders <= 0 ||
+      config.outageSeconds <= 0 || config.replayRate < 0) {
+    std::cerr << "usage: " << argv[0]
+              << " [channels] [senders] [outage_seconds] [replay_rate] [dir]"
+              << std::endl;
+    return 1;
+  }
+
+  runThroughput(config);
+  bool ok = runCrash(config);
+  ok = runCap(config) && ok;
+
+  std::cout << "outage: " << config.channels << " channels x " << config.fps
+            << " fps, " << config.senders << " senders, collector down "
+            << config.outageBegin << "s.." << config.outageBegin +
+                                                   config.outageSeconds
+            << "s of " << config.seconds << "s, replay rate "
+            << config.replayRate << "/s per sender" << std::endl;
+  Collector collector;
+  runOutage(config, collector, false);
+  runOutage(config, collector, true);
+  removeDir(config.dir);
+  return ok ? 0 : 1;
+}
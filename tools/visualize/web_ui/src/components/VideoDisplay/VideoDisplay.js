@@ -12,6 +12,7 @@ import ConfigContext from '../DisplayLayer/DisplayLayer';
 import MenuItem from '@material-ui/core/MenuItem';
 import Select from '@material-ui/core/Select';
 import './VideoDisplay.css'
+import { decodeResult } from '../../utils/resultDecoder';
 
 const serverIpAddress = window.location.hostname;
 const serverip = 'http://' + serverIpAddress + ':8000'
@@ -25,8 +26,27 @@ const VideoDisplay = () => {
   const [isFirstRender, setIsFirstRender] = useState(true);
 
   let img = new Image();
+  // ws_enc_type为SERIALIZED_BINARY时，当前帧的检测结果，与img一起绘制
+  let result = null;
   const fps = 25;
 
+  const drawResult = (canvasCtx, width, height) => {
+    if (!result || !result.mFrame.mWidth || !result.mFrame.mHeight) return;
+    const scaleX = width / result.mFrame.mWidth;
+    const scaleY = height / result.mFrame.mHeight;
+    canvasCtx.strokeStyle = '#00ff00';
+    canvasCtx.fillStyle = '#00ff00';
+    canvasCtx.lineWidth = 2;
+    canvasCtx.font = '14px sans-serif';
+    result.mDetectedObjectMetadatas.forEach((det, i) => {
+      const { mX, mY, mWidth, mHeight } = det.mBox;
+      canvasCtx.strokeRect(mX * scaleX, mY * scaleY, mWidth * scaleX, mHeight * scaleY);
+      const track = result.mTrackedObjectMetadatas[i];
+      const label = track ? `${det.mClassify} id:${track.mTrackId}` : `${det.mClassify}`;
+      canvasCtx.fillText(label, mX * scaleX, mY * scaleY - 4);
+    });
+  };
+
   const drawCanvas = () => {
     setTimeout(() => {
       img.onload = () => {
@@ -34,6 +54,8 @@ const VideoDisplay = () => {
         let canvasCtx = canvas.getContext('2d');
         const { width, height } = canvas;
         canvasCtx.drawImage(img, 0, 0, width, height);
+        drawResult(canvasCtx, width, height);
+        if (img.src.startsWith('blob:')) URL.revokeObjectURL(img.src);
       };
     }, 1000 / fps);
   };
@@ -68,6 +90,7 @@ const VideoDisplay = () => {
 
     let port = 9000 + parseInt(selectedChannel);
     const ws = new WebSocket('ws://' + serverIpAddress + `:${port}`);
+    ws.binaryType = 'arraybuffer';
     ws.onerror = (e) => {
       window.alert('Websocket connect error in this channel, do not switch channel too quickly, please try it latter!');
     }
@@ -78,7 +101,21 @@ const VideoDisplay = () => {
     });
 
     ws.addEventListener('message', ({ data }) => {
-      img.src = 'data:image/jpeg;base64,' + data;
+      if (typeof data === 'string') {
+        result = null;
+        img.src = 'data:image/jpeg;base64,' + data;
+        return;
+      }
+      let decoded;
+      try {
+        decoded = decodeResult(data);
+      } catch (e) {
+        console.error(e);
+        return;
+      }
+      if (decoded.error || !decoded.mFrame.mJpeg) return;
+      result = decoded;
+      img.src = URL.createObjectURL(new Blob([decoded.mFrame.mJpeg], { type: 'image/jpeg' }));
     });
 
     drawCanvas();
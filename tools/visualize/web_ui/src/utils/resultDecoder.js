@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 解析framework/common/binary_serialize.h定义的二进制结果格式，
+// 返回的字段与JSON格式相同，图像以Uint8Array形式放在mFrame.mJpeg中
+
+const MAGIC = 'SSTB';
+const VERSION = 1;
+const TYPE_RESULT = 1;
+const TYPE_STATUS = 2;
+
+class Reader {
+  constructor(buffer) {
+    this.view = new DataView(buffer);
+    this.bytes = new Uint8Array(buffer);
+    this.offset = 0;
+  }
+
+  check(size) {
+    if (this.offset + size > this.view.byteLength) {
+      throw new Error('truncated sophon-stream binary message');
+    }
+  }
+
+  u8() { this.check(1); return this.view.getUint8(this.offset++); }
+  u16() { this.check(2); const v = this.view.getUint16(this.offset, true); this.offset += 2; return v; }
+  u32() { this.check(4); const v = this.view.getUint32(this.offset, true); this.offset += 4; return v; }
+  i32() { this.check(4); const v = this.view.getInt32(this.offset, true); this.offset += 4; return v; }
+  f32() { this.check(4); const v = this.view.getFloat32(this.offset, true); this.offset += 4; return v; }
+  i64() {
+    this.check(8);
+    const v = this.view.getBigInt64(this.offset, true);
+    this.offset += 8;
+    return Number(v);
+  }
+
+  raw(size) {
+    this.check(size);
+    const v = this.bytes.subarray(this.offset, this.offset + size);
+    this.offset += size;
+    return v;
+  }
+
+  str() { return new TextDecoder().decode(this.raw(this.u16())); }
+  floats() { const n = this.u32(); const v = []; for (let i = 0; i < n; i++) v.push(this.f32()); return v; }
+  strs() { const n = this.u32(); const v = []; for (let i = 0; i < n; i++) v.push(this.str()); return v; }
+  ints() { const n = this.u32(); const v = []; for (let i = 0; i < n; i++) v.push(this.i32()); return v; }
+  array(readItem) { const n = this.u32(); const v = []; for (let i = 0; i < n; i++) v.push(readItem()); return v; }
+}
+
+const readResult = (r) => {
+  const frame = {};
+  frame.mChannelId = r.i32();
+  frame.mFrameId = r.i64();
+  frame.mTimestamp = r.i64();
+  frame.mWidth = r.i32();
+  frame.mHeight = r.i32();
+  frame.mEndOfStream = r.u8() !== 0;
+  const result = { mFrame: frame };
+  result.mFps = r.f32();
+  result.mSubId = r.i32();
+  result.mGraphId = r.i32();
+  const jpegSize = r.u32();
+  if (jpegSize > 0) frame.mJpeg = r.raw(jpegSize);
+
+  result.mDetectedObjectMetadatas = r.array(() => ({
+    mBox: { mX: r.i32(), mY: r.i32(), mWidth: r.i32(), mHeight: r.i32() },
+    mClassify: r.i32(),
+    mScores: r.floats(),
+  }));
+  result.mTrackedObjectMetadatas = r.array(() => ({ mTrackId: r.i64() }));
+  result.mPosedObjectMetadatas = r.array(() => ({ keypoints: r.floats() }));
+  result.mRecognizedObjectMetadatas = r.array(() => ({
+    mLabelName: r.str(),
+    mScores: r.floats(),
+    mTopKLabels: r.ints(),
+    mTopKLabelNames: r.strs(),
+  }));
+  result.mFaceObjectMetadata = r.array(() => {
+    const face = { top: r.i32(), bottom: r.i32(), left: r.i32(), right: r.i32() };
+    face.points_x = [];
+    for (let i = 0; i < 5; i++) face.points_x.push(r.f32());
+    face.points_y = [];
+    for (let i = 0; i < 5; i++) face.points_y.push(r.f32());
+    face.score = r.f32();
+    return face;
+  });
+  result.mSubObjectMetadatas = r.array(() => readResult(r));
+  return result;
+};
+
+/**
+ * 解析一条二进制消息，status消息返回{error: string}，格式不正确时抛出异常
+ */
+export const decodeResult = (buffer) => {
+  const r = new Reader(buffer);
+  const magic = String.fromCharCode(...r.raw(4));
+  if (magic !== MAGIC) throw new Error('not a sophon-stream binary message');
+  const version = r.u16();
+  if (version !== VERSION) throw new Error(`unsupported version ${version}`);
+  const type = r.u16();
+  if (type === TYPE_STATUS) return { error: r.str() };
+  if (type !== TYPE_RESULT) throw new Error(`unknown message type ${type}`);
+  return readResult(r);
+};
+
+export default decodeResult;
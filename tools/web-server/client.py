@@ -8,6 +8,7 @@ import requests
 import argparse
 from datetime import datetime
 from config_algorithm import *
+import stream_binary
 algorithms=Algorithms()
 
 
@@ -30,7 +31,10 @@ headers = {
 @app.route('/flask_test/', methods=['POST'])
 def build_result():
     global Type,idx
-    json_data = request.json
+    if request.content_type == stream_binary.CONTENT_TYPE:
+        json_data = stream_binary.decode(request.get_data())
+    else:
+        json_data = request.json
     # print(json_data["error"])
     if not os.path.exists("results/"):
             os.makedirs("results/")
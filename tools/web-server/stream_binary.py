@@ -0,0 +1,135 @@
+# 解析framework/common/binary_serialize.h定义的二进制结果格式
+# http_push和http_report的"format"为"binary"时，请求的Content-Type为
+# application/x-sophon-stream，decode()返回与JSON格式相同结构的dict，
+# 图像以base64字符串放在mFrame.mSpData中，空数组与JSON格式一样不输出
+import base64
+import struct
+
+CONTENT_TYPE = "application/x-sophon-stream"
+
+MAGIC = b"SSTB"
+VERSION = 1
+TYPE_RESULT = 1
+TYPE_STATUS = 2
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = memoryview(data)
+        self.offset = 0
+
+    def unpack(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.offset + size > len(self.data):
+            raise ValueError("truncated sophon-stream binary message")
+        values = struct.unpack_from(fmt, self.data, self.offset)
+        self.offset += size
+        return values
+
+    def one(self, fmt):
+        return self.unpack(fmt)[0]
+
+    def raw(self, size):
+        if self.offset + size > len(self.data):
+            raise ValueError("truncated sophon-stream binary message")
+        value = self.data[self.offset:self.offset + size]
+        self.offset += size
+        return value
+
+    def string(self):
+        return bytes(self.raw(self.one("<H"))).decode("utf-8")
+
+    def floats(self):
+        n = self.one("<I")
+        return list(self.unpack("<%df" % n))
+
+    def ints(self):
+        n = self.one("<I")
+        return list(self.unpack("<%di" % n))
+
+    def strings(self):
+        return [self.string() for _ in range(self.one("<I"))]
+
+    def array(self, read_item):
+        return [read_item() for _ in range(self.one("<I"))]
+
+
+def _read_detected(r):
+    x, y, w, h, classify = r.unpack("<5i")
+    return {"mBox": {"mX": x, "mY": y, "mWidth": w, "mHeight": h},
+            "mClassify": classify, "mScores": r.floats()}
+
+
+def _read_recognized(r):
+    label = r.string()
+    scores = r.floats()
+    top_k = r.ints()
+    names = r.strings()
+    return {"mLabelName": label, "mScores": scores, "mTopKLabels": top_k,
+            "mTopKLabelNames": names}
+
+
+def _read_face(r):
+    top, bottom, left, right = r.unpack("<4i")
+    points_x = list(r.unpack("<5f"))
+    points_y = list(r.unpack("<5f"))
+    return {"top": top, "bottom": bottom, "left": left, "right": right,
+            "points_x": points_x, "points_y": points_y, "score": r.one("<f")}
+
+
+def _read_result(r):
+    channel_id, frame_id, timestamp, width, height, eos = r.unpack("<iqqiiB")
+    fps, sub_id, graph_id = r.unpack("<fii")
+    frame = {"mChannelId": channel_id, "mFrameId": frame_id,
+             "mTimestamp": timestamp, "mWidth": width, "mHeight": height,
+             "mEndOfStream": bool(eos)}
+    jpeg_size = r.one("<I")
+    frame["mSpData"] = base64.b64encode(r.raw(jpeg_size)).decode("ascii")
+    # 与serialize.h的to_json一致，空数组不输出
+    result = {}
+    arrays = [
+        ("mDetectedObjectMetadatas", lambda: _read_detected(r)),
+        ("mTrackedObjectMetadatas", lambda: {"mTrackId": r.one("<q")}),
+        ("mPosedObjectMetadatas", lambda: {"keypoints": r.floats()}),
+        ("mRecognizedObjectMetadatas", lambda: _read_recognized(r)),
+        ("mFaceObjectMetadata", lambda: _read_face(r)),
+    ]
+    for key, read_item in arrays:
+        items = r.array(read_item)
+        if items:
+            result[key] = items
+    result["mFps"] = fps
+    result["mFrame"] = frame
+    result["mSubId"] = sub_id
+    result["mGraphId"] = graph_id
+    sub_results = r.array(lambda: _read_result(r))
+    if sub_results:
+        result["mSubObjectMetadatas"] = sub_results
+    return result
+
+
+def decode(data):
+    """解析一条二进制消息，status消息返回{"error": str}，格式不正确时抛出ValueError"""
+    return _read_message(_Reader(data))
+
+
+def decode_all(data):
+    """解析首尾相接的多条二进制消息，用于http_push的batch_size大于1的请求"""
+    r = _Reader(data)
+    messages = []
+    while r.offset < len(r.data):
+        messages.append(_read_message(r))
+    return messages
+
+
+def _read_message(r):
+    if bytes(r.raw(4)) != MAGIC:
+        raise ValueError("not a sophon-stream binary message")
+    version, msg_type = r.unpack("<HH")
+    if version != VERSION:
+        raise ValueError("unsupported version %d" % version)
+    if msg_type == TYPE_STATUS:
+        return {"error": r.string()}
+    if msg_type != TYPE_RESULT:
+        raise ValueError("unknown message type %d" % msg_type)
+    return _read_result(r)
@@ -0,0 +1,800 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-STREAM is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// 回放yolo输出张量，对比CPU后处理（阈值过滤 + 解码 + NMS）的两种实现：
+// legacy: 原yolov5/yolov8/yolox后处理中的逐框标量解码和O(n^2)的NMS
+// decoder: algorithmApi/yolo_decode.h，先在logit空间提前拒绝，SIMD求类别最大值，
+//          批量exp/sigmoid，按类别分组排序后用SIMD内核做NMS
+// 两者都只计算到网络输入尺度下的框，换算回原图的部分各element不变，不参与对比。
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "algorithmApi/yolo_decode.h"
+
+namespace {
+
+using sophon_stream::element::makeYoloDecodeConfig;
+using sophon_stream::element::yoloDecodeBackend;
+using sophon_stream::element::YoloDecodeConfig;
+using sophon_stream::element::YoloDecoder;
+using sophon_stream::element::YoloDetection;
+using sophon_stream::element::yoloExp;
+using sophon_stream::element::yoloSigmoid;
+
+constexpr int NET_SIZE = 640;
+constexpr int STRIDES[3] = {8, 16, 32};
+const std::vector<std::vector<std::vector<int>>> ANCHORS{
+    {{10, 13}, {16, 30}, {33, 23}},
+    {{30, 61}, {62, 45}, {59, 119}},
+    {{116, 90}, {156, 198}, {373, 326}}};
+
+/**
+ * @brief 与各element的context字段同名，供makeYoloDecodeConfig使用
+ */
+struct ThreshContext {
+  float thresh_conf_min = 0.25f;
+  float thresh_nms = 0.45f;
+  bool class_thresh_valid = false;
+  std::vector<std::string> class_names;
+  std::unordered_map<std::string, float> thresh_conf;
+};
+
+enum class Layout { Yolov5, Yolov5Decoded, Yolov8, Yolov8Opt, Yolox };
+
+struct LayoutInfo {
+  const char* name;
+  Layout layout;
+};
+
+const LayoutInfo LAYOUTS[] = {{"yolov5", Layout::Yolov5},
+                              {"yolov5_decoded", Layout::Yolov5Decoded},
+                              {"yolov8", Layout::Yolov8},
+                              {"yolov8_opt", Layout::Yolov8Opt},
+                              {"yolox", Layout::Yolox}};
+
+struct BenchmarkConfig {
+  Layout layout = Layout::Yolov8;
+  const char* layoutName = "yolov8";
+  int frames = 200;
+  int classNum = 80;
+  std::string tensorFile;
+};
+
+int gridCells() {
+  int cells = 0;
+  for (int stride : STRIDES) cells += (NET_SIZE / stride) * (NET_SIZE / stride);
+  return cells;
+}
+
+int boxNum(Layout layout) {
+  return layout == Layout::Yolov5 || layout == Layout::Yolov5Decoded
+             ? gridCells() * 3
+             : gridCells();
+}
+
+int nout(Layout layout, int classNum) {
+  return layout == Layout::Yolov8 || layout == Layout::Yolov8Opt
+             ? classNum + 4
+             : classNum + 5;
+}
+
+std::size_t frameSize(Layout layout, int classNum) {
+  return static_cast<std::size_t>(boxNum(layout)) * nout(layout, classNum);
+}
+
+// ---------------------------------------------------------------------------
+// 合成数据：每帧随机放置若干目标，目标附近的格点输出抖动后的框和高分，其余为背景
+
+struct SceneObject {
+  float cx, cy, w, h;
+  int classId;
+};
+
+float logitOf(float p) { return std::log(p / (1 - p)); }
+
+void synthesizeFrame(const BenchmarkConfig& config, std::mt19937& rng,
+                     float* out) {
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::normal_distribution<float> jitter(0.f, 1.f);
+  const int classNum = config.classNum;
+  const int n = nout(config.layout, classNum);
+  const int boxes = boxNum(config.layout);
+
+  std::vector<SceneObject> objects(15 + rng() % 30);
+  for (auto& obj : objects) {
+    obj.w = 16 + unit(rng) * 200;
+    obj.h = 16 + unit(rng) * 300;
+    obj.cx = obj.w / 2 + unit(rng) * (NET_SIZE - obj.w);
+    obj.cy = obj.h / 2 + unit(rng) * (NET_SIZE - obj.h);
+    obj.classId = rng() % classNum;
+  }
+
+  if (config.layout == Layout::Yolov5) {
+    // [layer][anchor][h][w][5 + class]，全部为logits
+    float* ptr = out;
+    for (int l = 0; l < 3; ++l) {
+      int feat = NET_SIZE / STRIDES[l];
+      float stride = STRIDES[l];
+      for (int a = 0; a < 3; ++a) {
+        for (int cell = 0; cell < feat * feat; ++cell, ptr += n) {
+          int gx = cell % feat;
+          int gy = cell / feat;
+          ptr[0] = jitter(rng);
+          ptr[1] = jitter(rng);
+          ptr[2] = jitter(rng);
+          ptr[3] = jitter(rng);
+          ptr[4] = -12 + unit(rng) * 8;
+          for (int c = 0; c < classNum; ++c) ptr[5 + c] = -8 + unit(rng) * 6;
+          for (const auto& obj : objects) {
+            float tx = (obj.cx / stride - gx + 0.5f) / 2;
+            float ty = (obj.cy / stride - gy + 0.5f) / 2;
+            float tw = std::sqrt(obj.w / ANCHORS[l][a][0]) / 2;
+            float th = std::sqrt(obj.h / ANCHORS[l][a][1]) / 2;
+            if (tx <= 0.05f || tx >= 0.95f || ty <= 0.05f || ty >= 0.95f ||
+                tw <= 0.1f || tw >= 0.9f || th <= 0.1f || th >= 0.9f)
+              continue;
+            ptr[0] = logitOf(tx) + 0.1f * jitter(rng);
+            ptr[1] = logitOf(ty) + 0.1f * jitter(rng);
+            ptr[2] = logitOf(tw) + 0.1f * jitter(rng);
+            ptr[3] = logitOf(th) + 0.1f * jitter(rng);
+            ptr[4] = -1 + unit(rng) * 5;
+            ptr[5 + obj.classId] = unit(rng) * 5;
+            break;
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  // 其余布局都是已解码的框，分数已经过sigmoid
+  std::vector<float> row(n);
+  std::vector<int> gridX(boxes), gridY(boxes), strides(boxes);
+  for (int i = 0, l = 0, begin = 0; l < 3; ++l) {
+    int feat = NET_SIZE / STRIDES[l];
+    for (int cell = 0; cell < feat * feat; ++cell, ++i) {
+      gridX[i] = cell % feat;
+      gridY[i] = cell / feat;
+      strides[i] = STRIDES[l];
+    }
+    begin += feat * feat;
+  }
+  const bool objectness = config.layout != Layout::Yolov8 &&
+                          config.layout != Layout::Yolov8Opt;
+  const int classOffset = objectness ? 5 : 4;
+  for (int i = 0; i < boxes; ++i) {
+    for (int c = 0; c < classNum; ++c)
+      row[classOffset + c] = unit(rng) * 0.05f;
+    if (objectness) row[4] = unit(rng) * 0.1f;
+    float cx = unit(rng) * NET_SIZE;
+    float cy = unit(rng) * NET_SIZE;
+    float w = 8 + unit(rng) * 64;
+    float h = 8 + unit(rng) * 64;
+    if (unit(rng) < 0.03f) {
+      const auto& obj = objects[rng() % objects.size()];
+      cx = obj.cx * (1 + 0.05f * jitter(rng));
+      cy = obj.cy * (1 + 0.05f * jitter(rng));
+      w = obj.w * (1 + 0.1f * jitter(rng));
+      h = obj.h * (1 + 0.1f * jitter(rng));
+      if (objectness) row[4] = 0.3f + unit(rng) * 0.7f;
+      row[classOffset + obj.classId] = 0.2f + unit(rng) * 0.8f;
+    }
+    w = std::max(w, 1.f);
+    h = std::max(h, 1.f);
+    if (config.layout == Layout::Yolox) {
+      int j = i % gridCells();
+      row[0] = cx / strides[j] - gridX[j];
+      row[1] = cy / strides[j] - gridY[j];
+      row[2] = std::log(w / strides[j]);
+      row[3] = std::log(h / strides[j]);
+    } else {
+      row[0] = cx;
+      row[1] = cy;
+      row[2] = w;
+      row[3] = h;
+    }
+    if (config.layout == Layout::Yolov8) {
+      for (int k = 0; k < n; ++k)
+        out[static_cast<std::size_t>(k) * boxes + i] = row[k];
+    } else {
+      std::copy(row.begin(), row.end(),
+                out + static_cast<std::size_t>(i) * n);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// 原实现，摘自各element的postProcess，去掉了换算回原图的部分。
+// 原实现给框加上class_id * max_wh的偏移来实现按类别NMS，偏移后的坐标达到10^5量级，
+// float的舍入会让框移动1个像素，截断到0也只对类别0生效；这里改为在NMS中直接跳过
+// 不同类别的框，保留原实现的语义，去掉偏移带来的误差
+
+struct IntBox {
+  int x, y, width, height;
+  float score;
+  int class_id;
+};
+
+struct FloatBox {
+  float left, top, right, bottom, width, height;
+  float score;
+  unsigned int class_id;
+};
+
+float legacySigmoid(float x) { return 1.0 / (1 + expf(-x)); }
+
+int legacyArgmax(const float* data, int num) {
+  float max_value = 0.0;
+  int max_index = 0;
+  for (int i = 0; i < num; ++i) {
+    float value = data[i];
+    if (value > max_value) {
+      max_value = value;
+      max_index = i;
+    }
+  }
+  return max_index;
+}
+
+void legacyNms(std::vector<IntBox>& dets, float nmsConfidence) {
+  int length = dets.size();
+  int index = length - 1;
+
+  std::sort(dets.begin(), dets.end(),
+            [](const IntBox& a, const IntBox& b) { return a.score < b.score; });
+
+  std::vector<float> areas(length);
+  for (int i = 0; i < length; i++) {
+    areas[i] = dets[i].width * dets[i].height;
+  }
+
+  while (index > 0) {
+    int i = 0;
+    while (i < index) {
+      if (dets[index].class_id != dets[i].class_id) {
+        i++;
+        continue;
+      }
+      float left = std::max(dets[index].x, dets[i].x);
+      float top = std::max(dets[index].y, dets[i].y);
+      float right = std::min(dets[index].x + dets[index].width,
+                             dets[i].x + dets[i].width);
+      float bottom = std::min(dets[index].y + dets[index].height,
+                              dets[i].y + dets[i].height);
+      float overlap =
+          std::max(0.0f, right - left) * std::max(0.0f, bottom - top);
+      if (overlap / (areas[index] + areas[i] - overlap) > nmsConfidence) {
+        areas.erase(areas.begin() + i);
+        dets.erase(dets.begin() + i);
+        index--;
+      } else {
+        i++;
+      }
+    }
+    index--;
+  }
+}
+
+void legacyYolov5(const BenchmarkConfig& config, const ThreshContext& context,
+                  const float* data, std::vector<IntBox>& boxes) {
+  const int nout = config.classNum + 5;
+  const float log_conf_threshold =
+      -std::log(1 / context.thresh_conf_min - 1);
+  boxes.clear();
+  if (config.layout == Layout::Yolov5) {
+    std::vector<float> decoded(boxNum(config.layout) * 7);
+    float* dst = decoded.data();
+    const float* tensor_data = data;
+    for (int tidx = 0; tidx < 3; ++tidx) {
+      int feat_h = NET_SIZE / STRIDES[tidx];
+      int feat_w = feat_h;
+      int area = feat_h * feat_w;
+      int feature_size = area * nout;
+      for (int anchor_idx = 0; anchor_idx < 3; anchor_idx++) {
+        const float* ptr = tensor_data + anchor_idx * feature_size;
+        for (int i = 0; i < area; i++) {
+          if (ptr[4] > log_conf_threshold) {
+            dst[0] = (legacySigmoid(ptr[0]) * 2 - 0.5 + i % feat_w) / feat_w *
+                     NET_SIZE;
+            dst[1] = (legacySigmoid(ptr[1]) * 2 - 0.5 + i / feat_w) / feat_h *
+                     NET_SIZE;
+            dst[2] = pow((legacySigmoid(ptr[2]) * 2), 2) *
+                     ANCHORS[tidx][anchor_idx][0];
+            dst[3] = pow((legacySigmoid(ptr[3]) * 2), 2) *
+                     ANCHORS[tidx][anchor_idx][1];
+            dst[4] = legacySigmoid(ptr[4]);
+            dst[5] = ptr[5];
+            dst[6] = 5;
+            for (int d = 6; d < nout; d++) {
+              if (ptr[d] > dst[5]) {
+                dst[5] = ptr[d];
+                dst[6] = d;
+              }
+            }
+            dst[6] -= 5;
+            float score = dst[4];
+            int class_id = dst[6];
+            float confidence = dst[5];
+            float box_transformed_m_conf_threshold =
+                -std::log(score / context.thresh_conf_min - 1);
+            if (confidence > box_transformed_m_conf_threshold) {
+              IntBox box;
+              box.x = dst[0] - dst[2] / 2;
+              if (box.x < 0) box.x = 0;
+              box.y = dst[1] - dst[3] / 2;
+              if (box.y < 0) box.y = 0;
+              box.width = dst[2];
+              box.height = dst[3];
+              box.class_id = class_id;
+              box.score = legacySigmoid(confidence) * score;
+              boxes.push_back(box);
+            }
+          }
+          dst += 7;
+          ptr += nout;
+        }
+      }
+      tensor_data += 3 * feature_size;
+    }
+  } else {
+    for (int i = 0; i < boxNum(config.layout); i++) {
+      const float* ptr = data + i * nout;
+      float score = ptr[4];
+      int class_id = legacyArgmax(&ptr[5], config.classNum);
+      float confidence = ptr[class_id + 5];
+      if (score > context.thresh_conf_min &&
+          confidence * score > context.thresh_conf_min) {
+        IntBox box;
+        box.x = int(ptr[0] - ptr[2] / 2);
+        if (box.x < 0) box.x = 0;
+        box.y = int(ptr[1] - ptr[3] / 2);
+        if (box.y < 0) box.y = 0;
+        box.width = ptr[2];
+        box.height = ptr[3];
+        box.class_id = class_id;
+        box.score = confidence * score;
+        boxes.push_back(box);
+      }
+    }
+  }
+  legacyNms(boxes, context.thresh_nms);
+}
+
+void legacyYolov8(const BenchmarkConfig& config, const ThreshContext& context,
+                  const float* output_data, std::vector<IntBox>& boxes) {
+  const int feature_num = boxNum(config.layout);
+  const int nout = config.classNum + 4;
+  const int max_det = 300;
+  boxes.clear();
+  for (int i = 0; i < feature_num; i++) {
+    float max_value = 0.0;
+    int max_index = 0;
+    for (int j = 0; j < config.classNum; j++) {
+      float cur_value = config.layout == Layout::Yolov8
+                            ? output_data[(4 + j) * feature_num + i]
+                            : output_data[i * nout + 4 + j];
+      if (cur_value > max_value) {
+        max_value = cur_value;
+        max_index = j;
+      }
+    }
+    if (max_value >= context.thresh_conf_min) {
+      auto value = [&](int k) {
+        return config.layout == Layout::Yolov8
+                   ? output_data[k * feature_num + i]
+                   : output_data[i * nout + k];
+      };
+      float centerX = value(0);
+      float centerY = value(1);
+      float width = value(2);
+      float height = value(3);
+      // 原实现用x1, y1, x2, y2保存，这里换成x, y, width, height
+      int x1 = centerX - width / 2;
+      int y1 = centerY - height / 2;
+      int x2 = x1 + width;
+      int y2 = y1 + height;
+      boxes.push_back({x1, y1, x2 - x1, y2 - y1, max_value, max_index});
+    }
+  }
+  legacyNms(boxes, context.thresh_nms);
+  if (boxes.size() > max_det) {
+    boxes.erase(boxes.begin(), boxes.begin() + (boxes.size() - max_det));
+  }
+}
+
+void legacyYolox(const BenchmarkConfig& config, const ThreshContext& context,
+                 const float* tensor, const std::vector<int>& grids_x,
+                 const std::vector<int>& grids_y,
+                 const std::vector<int>& expanded_strides,
+                 std::vector<FloatBox>& picked_boxes) {
+  const int numDim3 = config.classNum + 5;
+  const int frame_width = NET_SIZE;
+  const int frame_height = NET_SIZE;
+  const float scale = 1.0;
+  const int m_min_box_area = 100;
+  std::vector<FloatBox> yolobox_vec;
+  for (size_t i = 0; i < grids_x.size(); ++i) {
+    float box_objectness = tensor[i * numDim3 + 4];
+    if (box_objectness < context.thresh_conf_min) continue;
+    int max_class_idx = legacyArgmax(&tensor[i * numDim3 + 5], config.classNum);
+    float box_prob = box_objectness * tensor[i * numDim3 + 5 + max_class_idx];
+    if (box_prob > context.thresh_conf_min) {
+      float center_x = (tensor[i * numDim3 + 0] + grids_x[i]) * expanded_strides[i];
+      float center_y = (tensor[i * numDim3 + 1] + grids_y[i]) * expanded_strides[i];
+      float w_temp = exp(tensor[i * numDim3 + 2]) * expanded_strides[i];
+      float h_temp = exp(tensor[i * numDim3 + 3]) * expanded_strides[i];
+      center_x *= scale;
+      center_y *= scale;
+      w_temp *= scale;
+      h_temp *= scale;
+      float left = center_x - w_temp / 2;
+      float top = center_y - h_temp / 2;
+      float right = center_x + w_temp / 2;
+      float bottom = center_y + h_temp / 2;
+      FloatBox box;
+      if (w_temp < 0 || h_temp < 0 || w_temp >= frame_width ||
+          h_temp > frame_height)
+        continue;
+      box.left = (left >= 0) ? left : 0;
+      box.top = (top >= 0) ? top : 0;
+      box.right = (right < frame_width) ? right : (frame_width - 1);
+      box.bottom = (bottom < frame_height) ? bottom : (frame_height - 1);
+      box.width = box.right - box.left;
+      box.height = box.bottom - box.top;
+      if (box.width < 0 || box.height < 0) continue;
+      box.score = box_prob;
+      box.class_id = max_class_idx;
+      if (w_temp * h_temp > m_min_box_area) yolobox_vec.push_back(box);
+    }
+  }
+  std::sort(yolobox_vec.begin(), yolobox_vec.end(),
+            [](const FloatBox& a, const FloatBox& b) { return a.score > b.score; });
+  picked_boxes.clear();
+  const int n = yolobox_vec.size();
+  std::vector<int> suppressed(n, 0);
+  for (int i = 0; i < n; i++) {
+    if (suppressed[i] == 1) continue;
+    picked_boxes.push_back(yolobox_vec[i]);
+    const FloatBox& a = yolobox_vec[i];
+    for (int j = i + 1; j < n; j++) {
+      if (suppressed[j] == 1) continue;
+      const FloatBox& b = yolobox_vec[j];
+      float x = std::min(a.right, b.right) - std::max(a.left, b.left);
+      float y = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
+      float w = x > 0 ? x : 0;
+      float h = y > 0 ? y : 0;
+      float inter = w * h;
+      float u = a.width * a.height + b.width * b.height - inter;
+      if (inter / u > context.thresh_nms) suppressed[j] = 1;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// 新实现，候选框的整数化和范围检查与修改后的各element一致
+
+struct Grid {
+  std::vector<int> x, y, stride;
+};
+
+Grid makeGrid() {
+  Grid grid;
+  for (int stride : STRIDES) {
+    int feat = NET_SIZE / stride;
+    for (int m = 0; m < feat; ++m) {
+      for (int n = 0; n < feat; ++n) {
+        grid.x.push_back(n);
+        grid.y.push_back(m);
+        grid.stride.push_back(stride);
+      }
+    }
+  }
+  return grid;
+}
+
+void decodeFrame(const BenchmarkConfig& config, const Grid& grid,
+                 const float* data, YoloDecoder& decoder,
+                 std::vector<YoloDetection>& detections) {
+  const int n = nout(config.layout, config.classNum);
+  decoder.clear();
+  switch (config.layout) {
+    case Layout::Yolov5: {
+      const float* ptr = data;
+      for (int l = 0; l < 3; ++l) {
+        int feat = NET_SIZE / STRIDES[l];
+        decoder.decodeAnchorGrid(ptr, feat, feat, n, ANCHORS[l], NET_SIZE,
+                                 NET_SIZE);
+        ptr += static_cast<std::size_t>(3) * feat * feat * n;
+      }
+      break;
+    }
+    case Layout::Yolov5Decoded:
+      decoder.decodeRows(data, boxNum(config.layout), n, true);
+      break;
+    case Layout::Yolov8:
+      decoder.decodeColumns(data, boxNum(config.layout), n);
+      break;
+    case Layout::Yolov8Opt:
+      decoder.decodeRows(data, boxNum(config.layout), n, false);
+      break;
+    case Layout::Yolox:
+      decoder.decodeGridStride(data, boxNum(config.layout), n, grid.x.data(),
+                               grid.y.data(), grid.stride.data());
+      break;
+  }
+
+  auto& candidates = decoder.candidates();
+  if (config.layout == Layout::Yolov5 ||
+      config.layout == Layout::Yolov5Decoded) {
+    for (auto& det : candidates) {
+      int width = det.x2 - det.x1;
+      int height = det.y2 - det.y1;
+      det.x1 = std::max(int(det.x1), 0);
+      det.y1 = std::max(int(det.y1), 0);
+      det.x2 = det.x1 + width;
+      det.y2 = det.y1 + height;
+    }
+  } else if (config.layout == Layout::Yolox) {
+    size_t kept = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      YoloDetection det = candidates[i];
+      float w_temp = det.x2 - det.x1;
+      float h_temp = det.y2 - det.y1;
+      if (w_temp < 0 || h_temp < 0 || w_temp >= NET_SIZE || h_temp > NET_SIZE)
+        continue;
+      if (w_temp * h_temp <= 100) continue;
+      det.x1 = std::max(det.x1, 0.f);
+      det.y1 = std::max(det.y1, 0.f);
+      det.x2 = det.x2 < NET_SIZE ? det.x2 : NET_SIZE - 1;
+      det.y2 = det.y2 < NET_SIZE ? det.y2 : NET_SIZE - 1;
+      if (det.x2 - det.x1 < 0 || det.y2 - det.y1 < 0) continue;
+      candidates[kept++] = det;
+    }
+    candidates.resize(kept);
+  } else {
+    for (auto& det : candidates) {
+      int x1 = det.x1;
+      int y1 = det.y1;
+      det.x2 = int(x1 + (det.x2 - det.x1));
+      det.y2 = int(y1 + (det.y2 - det.y1));
+      det.x1 = x1;
+      det.y1 = y1;
+    }
+  }
+  decoder.nms(detections);
+}
+
+YoloDecodeConfig makeConfig(const BenchmarkConfig& config,
+                            ThreshContext& context, bool scalar) {
+  YoloDecodeConfig decodeConfig = makeYoloDecodeConfig(context);
+  decodeConfig.agnostic = config.layout == Layout::Yolox;
+  decodeConfig.maxDet = config.layout == Layout::Yolov8 ||
+                                config.layout == Layout::Yolov8Opt
+                            ? 300
+                            : 0;
+  decodeConfig.scalarKernels = scalar;
+  return decodeConfig;
+}
+
+// ---------------------------------------------------------------------------
+// 对比
+
+/**
+ * @brief 统一成按分数从高到低排列的x1, y1, x2, y2
+ */
+std::vector<YoloDetection> normalize(const std::vector<IntBox>& boxes) {
+  std::vector<YoloDetection> out;
+  for (const auto& box : boxes)
+    out.push_back({float(box.x), float(box.y), float(box.x + box.width),
+                   float(box.y + box.height), box.score, box.class_id});
+  std::stable_sort(out.begin(), out.end(),
+                   [](const YoloDetection& a, const YoloDetection& b) {
+                     return a.score > b.score;
+                   });
+  return out;
+}
+
+std::vector<YoloDetection> normalize(const std::vector<FloatBox>& boxes) {
+  std::vector<YoloDetection> out;
+  for (const auto& box : boxes)
+    out.push_back({box.left, box.top, box.right, box.bottom, box.score,
+                   int(box.class_id)});
+  return out;
+}
+
+/**
+ * @brief 整数框允许1个像素的截断误差（原实现在double中计算sigmoid并加上类别偏移），
+ * 浮点框允许0.01个像素
+ */
+bool sameDetections(std::vector<YoloDetection> a, std::vector<YoloDetection> b,
+                    float coordTolerance) {
+  // 分数相同的框在两种实现中的先后顺序可能不同
+  auto order = [](const YoloDetection& l, const YoloDetection& r) {
+    if (l.score != r.score) return l.score > r.score;
+    if (l.classId != r.classId) return l.classId < r.classId;
+    return l.x1 < r.x1 || (l.x1 == r.x1 && l.y1 < r.y1);
+  };
+  std::sort(a.begin(), a.end(), order);
+  std::sort(b.begin(), b.end(), order);
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].classId != b[i].classId) return false;
+    if (std::fabs(a[i].score - b[i].score) > 1e-5f * std::max(1.f, a[i].score))
+      return false;
+    if (std::fabs(a[i].x1 - b[i].x1) > coordTolerance ||
+        std::fabs(a[i].y1 - b[i].y1) > coordTolerance ||
+        std::fabs(a[i].x2 - b[i].x2) > coordTolerance ||
+        std::fabs(a[i].y2 - b[i].y2) > coordTolerance)
+      return false;
+  }
+  return true;
+}
+
+std::vector<YoloDetection> runLegacy(const BenchmarkConfig& config,
+                                     const ThreshContext& context,
+                                     const Grid& grid, const float* data) {
+  if (config.layout == Layout::Yolox) {
+    std::vector<FloatBox> boxes;
+    legacyYolox(config, context, data, grid.x, grid.y, grid.stride, boxes);
+    return normalize(boxes);
+  }
+  std::vector<IntBox> boxes;
+  if (config.layout == Layout::Yolov5 || config.layout == Layout::Yolov5Decoded)
+    legacyYolov5(config, context, data, boxes);
+  else
+    legacyYolov8(config, context, data, boxes);
+  return normalize(boxes);
+}
+
+bool checkKernels() {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-20.f, 20.f);
+  std::vector<float> in(1037), out(in.size());
+  for (auto& v : in) v = dist(rng);
+  double maxError = 0;
+  yoloExp(in.data(), out.data(), in.size());
+  for (size_t i = 0; i < in.size(); ++i)
+    maxError = std::max(maxError, std::fabs(out[i] / std::exp(double(in[i])) - 1));
+  yoloSigmoid(in.data(), out.data(), in.size());
+  for (size_t i = 0; i < in.size(); ++i)
+    maxError = std::max(
+        maxError, std::fabs(out[i] * (1 + std::exp(-double(in[i]))) - 1));
+  std::cout << "exp/sigmoid max relative error: " << maxError << std::endl;
+  return maxError < 1e-6;
+}
+
+double timeFrames(const std::vector<float>& tensors, std::size_t size,
+                  int frames,
+                  const std::function<void(const float*)>& func) {
+  int recorded = tensors.size() / size;
+  for (int i = 0; i < std::min(frames, 3); ++i) func(tensors.data());
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; ++i) func(tensors.data() + (i % recorded) * size);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - begin).count() /
+         frames;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchmarkConfig config;
+  bool validLayout = argc <= 1;
+  for (const auto& info : LAYOUTS) {
+    if (argc > 1 && info.name == std::string(argv[1])) {
+      config.layout = info.layout;
+      config.layoutName = info.name;
+      validLayout = true;
+    }
+  }
+  if (argc > 2) config.frames = std::atoi(argv[2]);
+  if (argc > 3) config.classNum = std::atoi(argv[3]);
+  if (argc > 4) config.tensorFile = argv[4];
+  if (!validLayout || config.frames <= 0 || config.classNum <= 0) {
+    std::cerr << "usage: " << argv[0]
+              << " [yolov5|yolov5_decoded|yolov8|yolov8_opt|yolox] [frames]"
+                 " [class_num] [tensor_file]"
+              << std::endl;
+    return 1;
+  }
+
+  const std::size_t size = frameSize(config.layout, config.classNum);
+  std::vector<float> tensors;
+  if (config.tensorFile.empty()) {
+    std::mt19937 rng(1);
+    int recorded = std::min(config.frames, 50);
+    tensors.resize(size * recorded);
+    for (int i = 0; i < recorded; ++i)
+      synthesizeFrame(config, rng, tensors.data() + i * size);
+  } else {
+    std::ifstream file(config.tensorFile, std::ios::binary | std::ios::ate);
+    if (!file) {
+      std::cerr << "cannot open " << config.tensorFile << std::endl;
+      return 1;
+    }
+    std::size_t bytes = file.tellg();
+    if (bytes < size * sizeof(float) || bytes % (size * sizeof(float)) != 0) {
+      std::cerr << config.tensorFile << ": size " << bytes
+                << " is not a multiple of one frame (" << size * sizeof(float)
+                << " bytes)" << std::endl;
+      return 1;
+    }
+    tensors.resize(bytes / sizeof(float));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(tensors.data()), bytes);
+  }
+  const int recorded = tensors.size() / size;
+
+  std::cout << "layout: " << config.layoutName << ", classes: "
+            << config.classNum << ", recorded frames: " << recorded
+            << ", backend: " << yoloDecodeBackend() << std::endl;
+  if (!checkKernels()) return 1;
+
+  ThreshContext context;
+  Grid grid = makeGrid();
+  YoloDecoder decoder(makeConfig(config, context, false));
+  YoloDecoder scalarDecoder(makeConfig(config, context, true));
+  std::vector<YoloDetection> detections, scalarDetections;
+
+  // 逐帧对比：decoder与原实现一致，SIMD与标量内核一致
+  const float tolerance = config.layout == Layout::Yolox ? 0.01f : 1.f;
+  std::size_t total = 0;
+  for (int i = 0; i < recorded; ++i) {
+    const float* data = tensors.data() + i * size;
+    auto legacy = runLegacy(config, context, grid, data);
+    decodeFrame(config, grid, data, decoder, detections);
+    decodeFrame(config, grid, data, scalarDecoder, scalarDetections);
+    if (!sameDetections(legacy, detections, tolerance)) {
+      std::cerr << "frame " << i << ": decoder differs from legacy ("
+                << detections.size() << " vs " << legacy.size() << " boxes)"
+                << std::endl;
+      return 1;
+    }
+    if (!sameDetections(detections, scalarDetections, 1e-3f)) {
+      std::cerr << "frame " << i << ": simd differs from scalar" << std::endl;
+      return 1;
+    }
+    total += detections.size();
+  }
+  std::cout << "correctness: ok (" << double(total) / recorded
+            << " boxes/frame)" << std::endl;
+
+  std::cout << "legacy        : "
+            << timeFrames(tensors, size, config.frames,
+                          [&](const float* data) {
+                            runLegacy(config, context, grid, data);
+                          })
+            << " us/frame" << std::endl;
+  std::cout << "decoder scalar: "
+            << timeFrames(tensors, size, config.frames,
+                          [&](const float* data) {
+                            decodeFrame(config, grid, data, scalarDecoder,
+                                        scalarDetections);
+                          })
+            << " us/frame" << std::endl;
+  std::cout << "decoder simd  : "
+            << timeFrames(tensors, size, config.frames,
+                          [&](const float* data) {
+                            decodeFrame(config, grid, data, decoder,
+                                        detections);
+                          })
+            << " us/frame" << std::endl;
+  return 0;
+}